@@ -30,6 +30,12 @@
  * |[
  * gst-launch-1.0 -v filesrc location=mjpeg.avi ! avidemux !  queue ! jpegdec ! videoconvert ! videoscale ! autovideosink
  * ]| The above pipeline decode the mjpeg stream and renders it to the screen.
+ * |[
+ * gst-launch-1.0 -v v4l2src ! image/jpeg,width=1280,height=720 ! jpegdec ! video/x-raw,width=320,height=180 ! fakesink
+ * ]| When downstream only accepts a smaller size that libjpeg can produce
+ * directly (1/2, 1/4 or 1/8 of the image size), jpegdec decodes at that size
+ * by scaling in the DCT domain, which is a lot cheaper than decoding the full
+ * image and scaling it down afterwards.
  * </refsect2>
  */
 
@@ -56,12 +62,19 @@
 
 #define JPEG_DEFAULT_IDCT_METHOD	JDCT_FASTEST
 #define JPEG_DEFAULT_MAX_ERRORS 	0
+#define JPEG_DEFAULT_MAX_THREADS	1
+#define JPEG_DEFAULT_CROP		0
 
 enum
 {
   PROP_0,
   PROP_IDCT_METHOD,
-  PROP_MAX_ERRORS
+  PROP_MAX_ERRORS,
+  PROP_MAX_THREADS,
+  PROP_CROP_LEFT,
+  PROP_CROP_RIGHT,
+  PROP_CROP_TOP,
+  PROP_CROP_BOTTOM
 };
 
 /* *INDENT-OFF* */
@@ -98,6 +111,7 @@ static gboolean gst_jpeg_dec_set_format (GstVideoDecoder * dec,
 static gboolean gst_jpeg_dec_start (GstVideoDecoder * bdec);
 static gboolean gst_jpeg_dec_stop (GstVideoDecoder * bdec);
 static gboolean gst_jpeg_dec_flush (GstVideoDecoder * bdec);
+static GstFlowReturn gst_jpeg_dec_finish (GstVideoDecoder * bdec);
 static GstFlowReturn gst_jpeg_dec_parse (GstVideoDecoder * bdec,
     GstVideoCodecFrame * frame, GstAdapter * adapter, gboolean at_eos);
 static GstFlowReturn gst_jpeg_dec_handle_frame (GstVideoDecoder * bdec,
@@ -107,6 +121,8 @@ static gboolean gst_jpeg_dec_decide_allocation (GstVideoDecoder * bdec,
 static gboolean gst_jpeg_dec_sink_event (GstVideoDecoder * bdec,
     GstEvent * event);
 
+static void gst_jpeg_dec_update_latency (GstJpegDec * dec);
+
 #define gst_jpeg_dec_parent_class parent_class
 G_DEFINE_TYPE (GstJpegDec, gst_jpeg_dec, GST_TYPE_VIDEO_DECODER);
 
@@ -115,7 +131,9 @@ gst_jpeg_dec_finalize (GObject * object)
 {
   GstJpegDec *dec = GST_JPEG_DEC (object);
 
-  jpeg_destroy_decompress (&dec->cinfo);
+  jpeg_destroy_decompress (&dec->ctx.cinfo);
+  g_mutex_clear (&dec->jobs_lock);
+  g_cond_clear (&dec->jobs_cond);
   if (dec->input_state)
     gst_video_codec_state_unref (dec->input_state);
 
@@ -162,6 +180,76 @@ gst_jpeg_dec_class_init (GstJpegDecClass * klass)
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS | G_PARAM_DEPRECATED));
 #endif
 
+  /**
+   * GstJpegDec:max-threads:
+   *
+   * Number of frames to decode in parallel, each in its own thread. MJPEG
+   * frames don't depend on each other, so this scales well with the number
+   * of cores, at the price of up to that many frames of extra latency.
+   * (0 = number of processors, 1 = decode in the streaming thread)
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_THREADS,
+      g_param_spec_int ("max-threads", "Maximum Decode Threads",
+          "Maximum number of frames to decode in parallel "
+          "(0 = automatic, 1 = no parallel decoding)",
+          0, G_MAXINT, JPEG_DEFAULT_MAX_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
+
+  /**
+   * GstJpegDec:crop-left:
+   *
+   * Number of pixels to cut off the left side of the image. Only the
+   * remaining region of interest is decoded where libjpeg supports it.
+   * The crop is given in pixels of the full size image and scaled along
+   * when decoding at reduced size.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_CROP_LEFT,
+      g_param_spec_int ("crop-left", "Crop Left",
+          "Pixels to crop at left", 0, G_MAXINT, JPEG_DEFAULT_CROP,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+  /**
+   * GstJpegDec:crop-right:
+   *
+   * Number of pixels to cut off the right side of the image.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_CROP_RIGHT,
+      g_param_spec_int ("crop-right", "Crop Right",
+          "Pixels to crop at right", 0, G_MAXINT, JPEG_DEFAULT_CROP,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+  /**
+   * GstJpegDec:crop-top:
+   *
+   * Number of pixels to cut off the top of the image.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_CROP_TOP,
+      g_param_spec_int ("crop-top", "Crop Top",
+          "Pixels to crop at top", 0, G_MAXINT, JPEG_DEFAULT_CROP,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+  /**
+   * GstJpegDec:crop-bottom:
+   *
+   * Number of pixels to cut off the bottom of the image.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_CROP_BOTTOM,
+      g_param_spec_int ("crop-bottom", "Crop Bottom",
+          "Pixels to crop at bottom", 0, G_MAXINT, JPEG_DEFAULT_CROP,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_PLAYING));
+
   gst_element_class_add_static_pad_template (element_class,
       &gst_jpeg_dec_src_pad_template);
   gst_element_class_add_static_pad_template (element_class,
@@ -173,6 +261,8 @@ gst_jpeg_dec_class_init (GstJpegDecClass * klass)
   vdec_class->start = gst_jpeg_dec_start;
   vdec_class->stop = gst_jpeg_dec_stop;
   vdec_class->flush = gst_jpeg_dec_flush;
+  vdec_class->finish = gst_jpeg_dec_finish;
+  vdec_class->drain = gst_jpeg_dec_finish;
   vdec_class->parse = gst_jpeg_dec_parse;
   vdec_class->set_format = gst_jpeg_dec_set_format;
   vdec_class->handle_frame = gst_jpeg_dec_handle_frame;
@@ -247,32 +337,49 @@ METHODDEF (void)
   longjmp (err_mgr->setjmp_buffer, 1);
 }
 
+static void
+gst_jpeg_dec_context_init (GstJpegDec * dec, GstJpegDecContext * ctx)
+{
+  /* setup jpeglib */
+  memset (&ctx->cinfo, 0, sizeof (ctx->cinfo));
+  memset (&ctx->jerr, 0, sizeof (ctx->jerr));
+  ctx->cinfo.err = jpeg_std_error (&ctx->jerr.pub);
+  ctx->jerr.pub.output_message = gst_jpeg_dec_my_output_message;
+  ctx->jerr.pub.emit_message = gst_jpeg_dec_my_emit_message;
+  ctx->jerr.pub.error_exit = gst_jpeg_dec_my_error_exit;
+
+  jpeg_create_decompress (&ctx->cinfo);
+
+  ctx->cinfo.src = (struct jpeg_source_mgr *) &ctx->jsrc;
+  ctx->cinfo.src->init_source = gst_jpeg_dec_init_source;
+  ctx->cinfo.src->fill_input_buffer = gst_jpeg_dec_fill_input_buffer;
+  ctx->cinfo.src->skip_input_data = gst_jpeg_dec_skip_input_data;
+  ctx->cinfo.src->resync_to_restart = gst_jpeg_dec_resync_to_restart;
+  ctx->cinfo.src->term_source = gst_jpeg_dec_term_source;
+  ctx->jsrc.dec = dec;
+}
+
 static void
 gst_jpeg_dec_init (GstJpegDec * dec)
 {
   GST_DEBUG ("initializing");
 
-  /* setup jpeglib */
-  memset (&dec->cinfo, 0, sizeof (dec->cinfo));
-  memset (&dec->jerr, 0, sizeof (dec->jerr));
-  dec->cinfo.err = jpeg_std_error (&dec->jerr.pub);
-  dec->jerr.pub.output_message = gst_jpeg_dec_my_output_message;
-  dec->jerr.pub.emit_message = gst_jpeg_dec_my_emit_message;
-  dec->jerr.pub.error_exit = gst_jpeg_dec_my_error_exit;
-
-  jpeg_create_decompress (&dec->cinfo);
-
-  dec->cinfo.src = (struct jpeg_source_mgr *) &dec->jsrc;
-  dec->cinfo.src->init_source = gst_jpeg_dec_init_source;
-  dec->cinfo.src->fill_input_buffer = gst_jpeg_dec_fill_input_buffer;
-  dec->cinfo.src->skip_input_data = gst_jpeg_dec_skip_input_data;
-  dec->cinfo.src->resync_to_restart = gst_jpeg_dec_resync_to_restart;
-  dec->cinfo.src->term_source = gst_jpeg_dec_term_source;
-  dec->jsrc.dec = dec;
+  gst_jpeg_dec_context_init (dec, &dec->ctx);
+
+  g_queue_init (&dec->jobs);
+  g_mutex_init (&dec->jobs_lock);
+  g_cond_init (&dec->jobs_cond);
+
+  dec->scale_denom = 1;
 
   /* init properties */
   dec->idct_method = JPEG_DEFAULT_IDCT_METHOD;
   dec->max_errors = JPEG_DEFAULT_MAX_ERRORS;
+  dec->max_threads = JPEG_DEFAULT_MAX_THREADS;
+  dec->crop_left = JPEG_DEFAULT_CROP;
+  dec->crop_right = JPEG_DEFAULT_CROP;
+  dec->crop_top = JPEG_DEFAULT_CROP;
+  dec->crop_bottom = JPEG_DEFAULT_CROP;
 
   gst_video_decoder_set_use_default_pad_acceptcaps (GST_VIDEO_DECODER_CAST
       (dec), TRUE);
@@ -599,6 +706,8 @@ gst_jpeg_dec_set_format (GstVideoDecoder * dec, GstVideoCodecState * state)
     gst_video_codec_state_unref (jpeg->input_state);
   jpeg->input_state = gst_video_codec_state_ref (state);
 
+  gst_jpeg_dec_update_latency (jpeg);
+
   return TRUE;
 }
 
@@ -619,49 +728,51 @@ hresamplecpy1 (guint8 * dest, const guint8 * src, guint len)
 }
 
 static void
-gst_jpeg_dec_free_buffers (GstJpegDec * dec)
+gst_jpeg_dec_free_buffers (GstJpegDecContext * ctx)
 {
   gint i;
 
   for (i = 0; i < 16; i++) {
-    g_free (dec->idr_y[i]);
-    g_free (dec->idr_u[i]);
-    g_free (dec->idr_v[i]);
-    dec->idr_y[i] = NULL;
-    dec->idr_u[i] = NULL;
-    dec->idr_v[i] = NULL;
+    g_free (ctx->idr_y[i]);
+    g_free (ctx->idr_u[i]);
+    g_free (ctx->idr_v[i]);
+    ctx->idr_y[i] = NULL;
+    ctx->idr_u[i] = NULL;
+    ctx->idr_v[i] = NULL;
   }
 
-  dec->idr_width_allocated = 0;
+  ctx->idr_width_allocated = 0;
 }
 
 static inline gboolean
-gst_jpeg_dec_ensure_buffers (GstJpegDec * dec, guint maxrowbytes)
+gst_jpeg_dec_ensure_buffers (GstJpegDec * dec, GstJpegDecContext * ctx,
+    guint maxrowbytes)
 {
   gint i;
 
-  if (G_LIKELY (dec->idr_width_allocated == maxrowbytes))
+  if (G_LIKELY (ctx->idr_width_allocated == maxrowbytes))
     return TRUE;
 
   /* FIXME: maybe just alloc one or three blocks altogether? */
   for (i = 0; i < 16; i++) {
-    dec->idr_y[i] = g_try_realloc (dec->idr_y[i], maxrowbytes);
-    dec->idr_u[i] = g_try_realloc (dec->idr_u[i], maxrowbytes);
-    dec->idr_v[i] = g_try_realloc (dec->idr_v[i], maxrowbytes);
+    ctx->idr_y[i] = g_try_realloc (ctx->idr_y[i], maxrowbytes);
+    ctx->idr_u[i] = g_try_realloc (ctx->idr_u[i], maxrowbytes);
+    ctx->idr_v[i] = g_try_realloc (ctx->idr_v[i], maxrowbytes);
 
-    if (G_UNLIKELY (!dec->idr_y[i] || !dec->idr_u[i] || !dec->idr_v[i])) {
+    if (G_UNLIKELY (!ctx->idr_y[i] || !ctx->idr_u[i] || !ctx->idr_v[i])) {
       GST_WARNING_OBJECT (dec, "out of memory, i=%d, bytes=%u", i, maxrowbytes);
       return FALSE;
     }
   }
 
-  dec->idr_width_allocated = maxrowbytes;
+  ctx->idr_width_allocated = maxrowbytes;
   GST_LOG_OBJECT (dec, "allocated temp memory, %u bytes/row", maxrowbytes);
   return TRUE;
 }
 
 static void
-gst_jpeg_dec_decode_grayscale (GstJpegDec * dec, GstVideoFrame * frame)
+gst_jpeg_dec_decode_grayscale (GstJpegDec * dec, GstJpegDecContext * ctx,
+    GstVideoFrame * frame)
 {
   guchar *rows[16];
   guchar **scanarray[1] = { rows };
@@ -676,18 +787,19 @@ gst_jpeg_dec_decode_grayscale (GstJpegDec * dec, GstVideoFrame * frame)
   width = GST_VIDEO_FRAME_WIDTH (frame);
   height = GST_VIDEO_FRAME_HEIGHT (frame);
 
-  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec, GST_ROUND_UP_32 (width))))
+  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec, ctx,
+              GST_ROUND_UP_32 (width))))
     return;
 
   base[0] = GST_VIDEO_FRAME_COMP_DATA (frame, 0);
   pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (frame, 0);
   rstride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0);
 
-  memcpy (rows, dec->idr_y, 16 * sizeof (gpointer));
+  memcpy (rows, ctx->idr_y, 16 * sizeof (gpointer));
 
   i = 0;
   while (i < height) {
-    lines = jpeg_read_raw_data (&dec->cinfo, scanarray, DCTSIZE);
+    lines = jpeg_read_raw_data (&ctx->cinfo, scanarray, DCTSIZE);
     if (G_LIKELY (lines > 0)) {
       for (j = 0; (j < DCTSIZE) && (i < height); j++, i++) {
         gint p;
@@ -706,7 +818,8 @@ gst_jpeg_dec_decode_grayscale (GstJpegDec * dec, GstVideoFrame * frame)
 }
 
 static void
-gst_jpeg_dec_decode_rgb (GstJpegDec * dec, GstVideoFrame * frame)
+gst_jpeg_dec_decode_rgb (GstJpegDec * dec, GstJpegDecContext * ctx,
+    GstVideoFrame * frame)
 {
   guchar *r_rows[16], *g_rows[16], *b_rows[16];
   guchar **scanarray[3] = { r_rows, g_rows, b_rows };
@@ -721,7 +834,8 @@ gst_jpeg_dec_decode_rgb (GstJpegDec * dec, GstVideoFrame * frame)
   width = GST_VIDEO_FRAME_WIDTH (frame);
   height = GST_VIDEO_FRAME_HEIGHT (frame);
 
-  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec, GST_ROUND_UP_32 (width))))
+  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec, ctx,
+              GST_ROUND_UP_32 (width))))
     return;
 
   for (i = 0; i < 3; i++)
@@ -730,13 +844,13 @@ gst_jpeg_dec_decode_rgb (GstJpegDec * dec, GstVideoFrame * frame)
   pstride = GST_VIDEO_FRAME_COMP_PSTRIDE (frame, 0);
   rstride = GST_VIDEO_FRAME_COMP_STRIDE (frame, 0);
 
-  memcpy (r_rows, dec->idr_y, 16 * sizeof (gpointer));
-  memcpy (g_rows, dec->idr_u, 16 * sizeof (gpointer));
-  memcpy (b_rows, dec->idr_v, 16 * sizeof (gpointer));
+  memcpy (r_rows, ctx->idr_y, 16 * sizeof (gpointer));
+  memcpy (g_rows, ctx->idr_u, 16 * sizeof (gpointer));
+  memcpy (b_rows, ctx->idr_v, 16 * sizeof (gpointer));
 
   i = 0;
   while (i < height) {
-    lines = jpeg_read_raw_data (&dec->cinfo, scanarray, DCTSIZE);
+    lines = jpeg_read_raw_data (&ctx->cinfo, scanarray, DCTSIZE);
     if (G_LIKELY (lines > 0)) {
       for (j = 0; (j < DCTSIZE) && (i < height); j++, i++) {
         gint p;
@@ -759,8 +873,8 @@ gst_jpeg_dec_decode_rgb (GstJpegDec * dec, GstVideoFrame * frame)
 }
 
 static void
-gst_jpeg_dec_decode_indirect (GstJpegDec * dec, GstVideoFrame * frame, gint r_v,
-    gint r_h, gint comp)
+gst_jpeg_dec_decode_indirect (GstJpegDec * dec, GstJpegDecContext * ctx,
+    GstVideoFrame * frame, gint r_v, gint r_h, gint comp)
 {
   guchar *y_rows[16], *u_rows[16], *v_rows[16];
   guchar **scanarray[3] = { y_rows, u_rows, v_rows };
@@ -776,7 +890,8 @@ gst_jpeg_dec_decode_indirect (GstJpegDec * dec, GstVideoFrame * frame, gint r_v,
   width = GST_VIDEO_FRAME_WIDTH (frame);
   height = GST_VIDEO_FRAME_HEIGHT (frame);
 
-  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec, GST_ROUND_UP_32 (width))))
+  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec, ctx,
+              GST_ROUND_UP_32 (width))))
     return;
 
   for (i = 0; i < 3; i++) {
@@ -788,9 +903,9 @@ gst_jpeg_dec_decode_indirect (GstJpegDec * dec, GstVideoFrame * frame, gint r_v,
         (GST_VIDEO_FRAME_COMP_HEIGHT (frame, i) - 1));
   }
 
-  memcpy (y_rows, dec->idr_y, 16 * sizeof (gpointer));
-  memcpy (u_rows, dec->idr_u, 16 * sizeof (gpointer));
-  memcpy (v_rows, dec->idr_v, 16 * sizeof (gpointer));
+  memcpy (y_rows, ctx->idr_y, 16 * sizeof (gpointer));
+  memcpy (u_rows, ctx->idr_u, 16 * sizeof (gpointer));
+  memcpy (v_rows, ctx->idr_v, 16 * sizeof (gpointer));
 
   /* fill chroma components for grayscale */
   if (comp == 1) {
@@ -802,7 +917,7 @@ gst_jpeg_dec_decode_indirect (GstJpegDec * dec, GstVideoFrame * frame, gint r_v,
   }
 
   for (i = 0; i < height; i += r_v * DCTSIZE) {
-    lines = jpeg_read_raw_data (&dec->cinfo, scanarray, r_v * DCTSIZE);
+    lines = jpeg_read_raw_data (&ctx->cinfo, scanarray, r_v * DCTSIZE);
     if (G_LIKELY (lines > 0)) {
       for (j = 0, k = 0; j < (r_v * DCTSIZE); j += r_v, k++) {
         if (G_LIKELY (base[0] <= last[0])) {
@@ -839,7 +954,8 @@ gst_jpeg_dec_decode_indirect (GstJpegDec * dec, GstVideoFrame * frame, gint r_v,
 }
 
 static GstFlowReturn
-gst_jpeg_dec_decode_direct (GstJpegDec * dec, GstVideoFrame * frame)
+gst_jpeg_dec_decode_direct (GstJpegDec * dec, GstJpegDecContext * ctx,
+    GstVideoFrame * frame)
 {
   guchar **line[3];             /* the jpeg line buffer         */
   guchar *y[4 * DCTSIZE] = { NULL, };   /* alloc enough for the lines   */
@@ -855,9 +971,9 @@ gst_jpeg_dec_decode_direct (GstJpegDec * dec, GstVideoFrame * frame)
   line[1] = u;
   line[2] = v;
 
-  v_samp[0] = dec->cinfo.comp_info[0].v_samp_factor;
-  v_samp[1] = dec->cinfo.comp_info[1].v_samp_factor;
-  v_samp[2] = dec->cinfo.comp_info[2].v_samp_factor;
+  v_samp[0] = ctx->cinfo.comp_info[0].v_samp_factor;
+  v_samp[1] = ctx->cinfo.comp_info[1].v_samp_factor;
+  v_samp[2] = ctx->cinfo.comp_info[2].v_samp_factor;
 
   if (G_UNLIKELY (v_samp[0] > 2 || v_samp[1] > 2 || v_samp[2] > 2))
     goto format_not_supported;
@@ -900,7 +1016,7 @@ gst_jpeg_dec_decode_direct (GstJpegDec * dec, GstVideoFrame * frame)
         line[2][j] = last[2];
     }
 
-    lines = jpeg_read_raw_data (&dec->cinfo, line, v_samp[0] * DCTSIZE);
+    lines = jpeg_read_raw_data (&ctx->cinfo, line, v_samp[0] * DCTSIZE);
     if (G_UNLIKELY (!lines)) {
       GST_INFO_OBJECT (dec, "jpeg_read_raw_data() returned 0");
     }
@@ -909,15 +1025,568 @@ gst_jpeg_dec_decode_direct (GstJpegDec * dec, GstVideoFrame * frame)
 
 format_not_supported:
   {
-    gboolean ret = GST_FLOW_OK;
+    /* this might run in a worker thread, the caller posts the error */
+    GST_WARNING_OBJECT (dec, "unsupported v_samp factors: %u %u %u",
+        v_samp[0], v_samp[1], v_samp[2]);
+    return GST_FLOW_NOT_SUPPORTED;
+  }
+}
 
-    GST_VIDEO_DECODER_ERROR (dec, 1, STREAM, DECODE,
-        (_("Failed to decode JPEG image")),
-        ("Unsupported subsampling schema: v_samp factors: %u %u %u", v_samp[0],
-            v_samp[1], v_samp[2]), ret);
+/* Scaled and cropped images are decoded with jpeg_read_scanlines(), since
+ * jpeglib may pick a different DCT size per component when scaling, so the
+ * raw component layout no longer matches what the direct and indirect paths
+ * expect. With libjpeg-turbo only the rows and iMCU columns covering @region
+ * are decoded, otherwise the rest is decoded and dropped. */
+static void
+gst_jpeg_dec_decode_scanlines (GstJpegDec * dec, GstJpegDecContext * ctx,
+    GstVideoFrame * frame, const GstJpegDecRegion * region)
+{
+  j_decompress_ptr cinfo = &ctx->cinfo;
+  guchar *rows[1];
+  guint8 *base[3];
+  gint width, height, x, y, comps;
+  gint stride[3];
+  gint i, k;
+
+  width = GST_VIDEO_FRAME_WIDTH (frame);
+  height = GST_VIDEO_FRAME_HEIGHT (frame);
+  x = region ? region->x : 0;
+  y = region ? region->y : 0;
+
+  GST_DEBUG_OBJECT (dec, "scanline decoding, 1/%u, %dx%d at %d,%d",
+      cinfo->scale_denom, width, height, x, y);
+
+  if (region == NULL && cinfo->out_color_space != JCS_YCbCr) {
+    /* RGB and grayscale scanlines are in the output format already */
+    base[0] = GST_VIDEO_FRAME_PLANE_DATA (frame, 0);
+    stride[0] = GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0);
+
+    while (cinfo->output_scanline < height) {
+      rows[0] = base[0] + cinfo->output_scanline * stride[0];
+      if (G_UNLIKELY (jpeg_read_scanlines (cinfo, rows, 1) == 0)) {
+        GST_INFO_OBJECT (dec, "jpeg_read_scanlines() returned 0");
+        break;
+      }
+    }
+    return;
+  }
+
+#ifdef HAVE_JPEG_CROP_SCANLINE
+  if (region) {
+    JDIMENSION xoffset = x, crop_width = width;
+
+    /* this widens the columns to iMCU boundaries, so x becomes relative to
+     * the now narrower scanlines */
+    jpeg_crop_scanline (cinfo, &xoffset, &crop_width);
+    x -= xoffset;
+    if (y > 0)
+      jpeg_skip_scanlines (cinfo, y);
+  }
+#endif
+
+  comps = cinfo->output_components;
+  if (G_UNLIKELY (!gst_jpeg_dec_ensure_buffers (dec, ctx,
+              GST_ROUND_UP_32 (cinfo->output_width * comps))))
+    return;
+
+  rows[0] = ctx->idr_y[0];
+
+  /* rows above the region that could not be skipped */
+  while (cinfo->output_scanline < y) {
+    if (G_UNLIKELY (jpeg_read_scanlines (cinfo, rows, 1) == 0)) {
+      GST_INFO_OBJECT (dec, "jpeg_read_scanlines() returned 0");
+      return;
+    }
+  }
+
+  if (cinfo->out_color_space != JCS_YCbCr) {
+    base[0] = GST_VIDEO_FRAME_PLANE_DATA (frame, 0);
+    stride[0] = GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0);
+
+    for (i = 0; i < height; i++) {
+      if (G_UNLIKELY (jpeg_read_scanlines (cinfo, rows, 1) == 0)) {
+        GST_INFO_OBJECT (dec, "jpeg_read_scanlines() returned 0");
+        return;
+      }
+      memcpy (base[0], rows[0] + x * comps, width * comps);
+      base[0] += stride[0];
+    }
+  } else {
+    for (i = 0; i < 3; i++) {
+      base[i] = GST_VIDEO_FRAME_COMP_DATA (frame, i);
+      stride[i] = GST_VIDEO_FRAME_COMP_STRIDE (frame, i);
+    }
+
+    /* jpeglib gives us interleaved 4:4:4 YCbCr, pick the chroma samples we
+     * need for I420 from it. Upsampling is done by replication, so this gives
+     * back the decoded chroma samples */
+    for (i = 0; i < height; i++) {
+      const guint8 *src = rows[0] + x * 3;
+
+      if (G_UNLIKELY (jpeg_read_scanlines (cinfo, rows, 1) == 0)) {
+        GST_INFO_OBJECT (dec, "jpeg_read_scanlines() returned 0");
+        return;
+      }
+
+      for (k = 0; k < width; k++)
+        base[0][k] = src[k * 3];
+
+      if ((i & 1) == 0) {
+        for (k = 0; k < (width + 1) / 2; k++) {
+          base[1][k] = src[k * 6 + 1];
+          base[2][k] = src[k * 6 + 2];
+        }
+        base[1] += stride[1];
+        base[2] += stride[2];
+      }
+
+      base[0] += stride[0];
+    }
+  }
+
+  /* jpeg_finish_decompress() wants all scanlines to be consumed */
+#ifdef HAVE_JPEG_CROP_SCANLINE
+  if (cinfo->output_scanline < cinfo->output_height)
+    jpeg_skip_scanlines (cinfo,
+        cinfo->output_height - cinfo->output_scanline);
+#else
+  while (cinfo->output_scanline < cinfo->output_height) {
+    if (G_UNLIKELY (jpeg_read_scanlines (cinfo, rows, 1) == 0)) {
+      GST_INFO_OBJECT (dec, "jpeg_read_scanlines() returned 0");
+      break;
+    }
+  }
+#endif
+}
+
+/* Fills @region with the part of a @width x @height image decoded at
+ * 1/@scale_denom that is to be output. Returns FALSE if the whole image
+ * is output. */
+static gboolean
+gst_jpeg_dec_get_region (GstJpegDec * dec, gint width, gint height,
+    guint scale_denom, GstJpegDecRegion * region)
+{
+  gint left, right, top, bottom;
+
+  GST_OBJECT_LOCK (dec);
+  left = dec->crop_left / scale_denom;
+  right = dec->crop_right / scale_denom;
+  top = dec->crop_top / scale_denom;
+  bottom = dec->crop_bottom / scale_denom;
+  GST_OBJECT_UNLOCK (dec);
+
+  region->x = 0;
+  region->y = 0;
+  region->width = width;
+  region->height = height;
+
+  if (left == 0 && right == 0 && top == 0 && bottom == 0)
+    return FALSE;
+
+  if (G_UNLIKELY (left > width - MIN_WIDTH - right ||
+          top > height - MIN_HEIGHT - bottom)) {
+    GST_WARNING_OBJECT (dec, "crop %d,%d,%d,%d too large for %dx%d, "
+        "ignoring", left, right, top, bottom, width, height);
+    return FALSE;
+  }
+
+  region->x = left;
+  region->y = top;
+  region->width = width - left - right;
+  region->height = height - top - bottom;
+
+  return TRUE;
+}
+
+static gboolean
+gst_jpeg_dec_caps_accept_size (GstCaps * caps, gint width, gint height)
+{
+  GstCaps *size_caps;
+  gboolean ret;
+
+  size_caps = gst_caps_new_simple ("video/x-raw", "width", G_TYPE_INT, width,
+      "height", G_TYPE_INT, height, NULL);
+  ret = gst_caps_can_intersect (caps, size_caps);
+  gst_caps_unref (size_caps);
+
+  return ret;
+}
+
+/* Returns the scale denominator to decode the current image with. We only
+ * scale if downstream can't handle the full size (cropped) image, and then
+ * pick the least amount of downscaling that gives a size downstream accepts.
+ * The result is cached until the image size or crop changes or downstream
+ * asks us to reconfigure. */
+static guint
+gst_jpeg_dec_get_scale_denom (GstJpegDec * dec)
+{
+  GstPad *srcpad = GST_VIDEO_DECODER_SRC_PAD (dec);
+  GstJpegDecRegion region;
+  GstCaps *peercaps;
+  gint width, height;
+  guint denom, res = 1;
+  gboolean crop_changed;
+
+  width = dec->ctx.cinfo.image_width;
+  height = dec->ctx.cinfo.image_height;
+
+  GST_OBJECT_LOCK (dec);
+  crop_changed = dec->crop_changed;
+  dec->crop_changed = FALSE;
+  GST_OBJECT_UNLOCK (dec);
+
+  if (G_LIKELY (width == dec->scale_image_width
+          && height == dec->scale_image_height && !crop_changed
+          && !gst_pad_needs_reconfigure (srcpad)))
+    return dec->scale_denom;
+
+  peercaps = gst_pad_peer_query_caps (srcpad, NULL);
+  if (peercaps == NULL)
+    goto done;
+
+  GST_LOG_OBJECT (dec, "peer caps %" GST_PTR_FORMAT, peercaps);
+
+  if (gst_caps_is_any (peercaps) || gst_caps_is_empty (peercaps))
+    goto done;
+
+  gst_jpeg_dec_get_region (dec, width, height, 1, &region);
+  if (gst_jpeg_dec_caps_accept_size (peercaps, region.width, region.height))
+    goto done;
+
+  for (denom = 2; denom <= DCTSIZE; denom *= 2) {
+    dec->ctx.cinfo.scale_num = 1;
+    dec->ctx.cinfo.scale_denom = denom;
+    jpeg_calc_output_dimensions (&dec->ctx.cinfo);
+
+    gst_jpeg_dec_get_region (dec, dec->ctx.cinfo.output_width,
+        dec->ctx.cinfo.output_height, denom, &region);
+    if (gst_jpeg_dec_caps_accept_size (peercaps, region.width,
+            region.height)) {
+      res = denom;
+      break;
+    }
+  }
+  dec->ctx.cinfo.scale_denom = 1;
+
+done:
+  if (peercaps)
+    gst_caps_unref (peercaps);
+
+  if (res != dec->scale_denom)
+    GST_DEBUG_OBJECT (dec, "decoding %dx%d image at 1/%u scale", width,
+        height, res);
+
+  dec->scale_denom = res;
+  dec->scale_image_width = width;
+  dec->scale_image_height = height;
+
+  return res;
+}
+
+static void
+gst_jpeg_dec_prepare_decompress (GstJpegDec * dec, j_decompress_ptr cinfo,
+    guint scale_denom, gboolean cropped)
+{
+  /* prepare for raw output, or for scanline output if we scale or crop */
+  cinfo->do_fancy_upsampling = FALSE;
+  cinfo->do_block_smoothing = FALSE;
+  cinfo->out_color_space = cinfo->jpeg_color_space;
+  cinfo->dct_method = dec->idct_method;
+  cinfo->scale_num = 1;
+  cinfo->scale_denom = scale_denom;
+  cinfo->raw_data_out = (scale_denom == 1 && !cropped);
+
+  guarantee_huff_tables (cinfo);
+}
+
+/* Decodes the image, or only @region of it if not %NULL, after
+ * jpeg_start_decompress() into @frame. The caller has to set up the error
+ * handler jump. */
+static GstFlowReturn
+gst_jpeg_dec_decode_image (GstJpegDec * dec, GstJpegDecContext * ctx,
+    GstVideoFrame * frame, const GstJpegDecRegion * region)
+{
+  j_decompress_ptr cinfo = &ctx->cinfo;
+  gint width, r_h, r_v;
+
+  width = GST_VIDEO_FRAME_WIDTH (frame);
+  r_h = cinfo->comp_info[0].h_samp_factor;
+  r_v = cinfo->comp_info[0].v_samp_factor;
+
+  if (cinfo->scale_denom > 1 || region) {
+    gst_jpeg_dec_decode_scanlines (dec, ctx, frame, region);
+  } else if (cinfo->jpeg_color_space == JCS_RGB) {
+    gst_jpeg_dec_decode_rgb (dec, ctx, frame);
+  } else if (cinfo->jpeg_color_space == JCS_GRAYSCALE) {
+    gst_jpeg_dec_decode_grayscale (dec, ctx, frame);
+  } else {
+    GST_LOG_OBJECT (dec, "decompressing (reqired scanline buffer height = %u)",
+        cinfo->rec_outbuf_height);
+
+    /* For some widths jpeglib requires more horizontal padding than I420 
+     * provides. In those cases we need to decode into separate buffers and then
+     * copy over the data into our final picture buffer, otherwise jpeglib might
+     * write over the end of a line into the beginning of the next line,
+     * resulting in blocky artifacts on the left side of the picture. */
+    if (G_UNLIKELY (width % (cinfo->max_h_samp_factor * DCTSIZE) != 0
+            || cinfo->comp_info[0].h_samp_factor != 2
+            || cinfo->comp_info[1].h_samp_factor != 1
+            || cinfo->comp_info[2].h_samp_factor != 1)) {
+      GST_CAT_LOG_OBJECT (GST_CAT_PERFORMANCE, dec,
+          "indirect decoding using extra buffer copy");
+      gst_jpeg_dec_decode_indirect (dec, ctx, frame, r_v, r_h,
+          cinfo->num_components);
+    } else {
+      return gst_jpeg_dec_decode_direct (dec, ctx, frame);
+    }
+  }
+
+  return GST_FLOW_OK;
+}
+
+/* A frame handed to the worker threads. The output frame is allocated and
+ * mapped by the streaming thread, which also finishes the frames in the order
+ * they were queued. */
+typedef struct
+{
+  GstVideoCodecFrame *frame;
+  GstMapInfo map;
+  GstVideoFrame vframe;
+  guint scale_denom;
+  gboolean cropped;
+  GstJpegDecRegion region;
+
+  /* result, valid once done is set */
+  GstFlowReturn ret;
+  guint code;
+  gchar err_msg[JMSG_LENGTH_MAX];
+  gboolean done;
+} GstJpegDecJob;
+
+static void
+gst_jpeg_dec_decode_job (GstJpegDec * dec, GstJpegDecContext * ctx,
+    GstJpegDecJob * job)
+{
+  ctx->cinfo.src->next_input_byte = job->map.data;
+  ctx->cinfo.src->bytes_in_buffer = job->map.size;
+
+  if (setjmp (ctx->jerr.setjmp_buffer)) {
+    job->code = ctx->jerr.pub.msg_code;
+    ctx->jerr.pub.format_message ((j_common_ptr) (&ctx->cinfo), job->err_msg);
+    jpeg_abort_decompress (&ctx->cinfo);
+    job->ret = GST_FLOW_ERROR;
+    return;
+  }
+
+  /* the streaming thread already checked the header, so this can't fail
+   * other than by the error handler jumping back */
+  jpeg_read_header (&ctx->cinfo, TRUE);
+  gst_jpeg_dec_prepare_decompress (dec, &ctx->cinfo, job->scale_denom,
+      job->cropped);
+  jpeg_start_decompress (&ctx->cinfo);
+
+  job->ret = gst_jpeg_dec_decode_image (dec, ctx, &job->vframe,
+      job->cropped ? &job->region : NULL);
+  if (G_LIKELY (job->ret == GST_FLOW_OK))
+    jpeg_finish_decompress (&ctx->cinfo);
+  else
+    jpeg_abort_decompress (&ctx->cinfo);
+}
+
+static void
+gst_jpeg_dec_worker_func (gpointer data, gpointer user_data)
+{
+  GstJpegDec *dec = user_data;
+  GstJpegDecJob *job = data;
+  GstJpegDecContext *ctx;
+
+  ctx = g_async_queue_pop (dec->free_contexts);
+  gst_jpeg_dec_decode_job (dec, ctx, job);
+  g_async_queue_push (dec->free_contexts, ctx);
+
+  g_mutex_lock (&dec->jobs_lock);
+  job->done = TRUE;
+  g_cond_broadcast (&dec->jobs_cond);
+  g_mutex_unlock (&dec->jobs_lock);
+}
+
+static void
+gst_jpeg_dec_start_pool (GstJpegDec * dec)
+{
+  GError *err = NULL;
+  guint i, n;
+
+  n = dec->max_threads > 0 ? dec->max_threads : g_get_num_processors ();
+  if (n < 2)
+    return;
+
+  dec->pool = g_thread_pool_new (gst_jpeg_dec_worker_func, dec, n, FALSE,
+      &err);
+  if (!dec->pool) {
+    GST_WARNING_OBJECT (dec, "failed to create thread pool, decoding in the "
+        "streaming thread: %s", err->message);
+    g_error_free (err);
+    return;
+  }
+
+  dec->contexts = g_new0 (GstJpegDecContext, n);
+  dec->n_contexts = n;
+  dec->free_contexts = g_async_queue_new ();
+  for (i = 0; i < n; i++) {
+    gst_jpeg_dec_context_init (dec, &dec->contexts[i]);
+    g_async_queue_push (dec->free_contexts, &dec->contexts[i]);
+  }
+
+  GST_DEBUG_OBJECT (dec, "decoding up to %u frames in parallel", n);
+}
+
+/* Takes ownership of @frame, @vframe stays mapped until the job is finished
+ * or discarded */
+static void
+gst_jpeg_dec_queue_job (GstJpegDec * dec, GstVideoCodecFrame * frame,
+    GstVideoFrame * vframe, guint scale_denom,
+    const GstJpegDecRegion * region)
+{
+  GstJpegDecJob *job;
+
+  job = g_slice_new0 (GstJpegDecJob);
+  job->frame = frame;
+  job->vframe = *vframe;
+  job->scale_denom = scale_denom;
+  if (region) {
+    job->cropped = TRUE;
+    job->region = *region;
+  }
+  gst_buffer_map (frame->input_buffer, &job->map, GST_MAP_READ);
+
+  g_mutex_lock (&dec->jobs_lock);
+  g_queue_push_tail (&dec->jobs, job);
+  g_mutex_unlock (&dec->jobs_lock);
+
+  g_thread_pool_push (dec->pool, job, NULL);
+}
+
+static GstFlowReturn
+gst_jpeg_dec_finish_job (GstJpegDec * dec, GstJpegDecJob * job)
+{
+  GstVideoDecoder *bdec = GST_VIDEO_DECODER (dec);
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  gst_video_frame_unmap (&job->vframe);
+  gst_buffer_unmap (job->frame->input_buffer, &job->map);
+
+  if (G_LIKELY (job->ret == GST_FLOW_OK)) {
+    ret = gst_video_decoder_finish_frame (bdec, job->frame);
+  } else {
+    if (job->ret == GST_FLOW_NOT_SUPPORTED) {
+      GST_VIDEO_DECODER_ERROR (dec, 1, STREAM, DECODE,
+          (_("Failed to decode JPEG image")),
+          ("Unsupported subsampling schema"), ret);
+    } else {
+      GST_VIDEO_DECODER_ERROR (dec, 1, STREAM, DECODE,
+          (_("Failed to decode JPEG image")), ("Decode error #%u: %s",
+              job->code, job->err_msg), ret);
+    }
+    gst_video_decoder_drop_frame (bdec, job->frame);
+  }
+
+  g_slice_free (GstJpegDecJob, job);
+
+  return ret;
+}
+
+/* Finishes decoded frames in order, waiting for the oldest ones until no
+ * more than @max_pending are left */
+static GstFlowReturn
+gst_jpeg_dec_finish_jobs (GstJpegDec * dec, guint max_pending)
+{
+  GstFlowReturn ret = GST_FLOW_OK, res;
+  GstJpegDecJob *job;
+
+  g_mutex_lock (&dec->jobs_lock);
+  while ((job = g_queue_peek_head (&dec->jobs))) {
+    if (!job->done) {
+      if (g_queue_get_length (&dec->jobs) <= max_pending)
+        break;
+      g_cond_wait (&dec->jobs_cond, &dec->jobs_lock);
+      continue;
+    }
+
+    g_queue_pop_head (&dec->jobs);
+    g_mutex_unlock (&dec->jobs_lock);
+    res = gst_jpeg_dec_finish_job (dec, job);
+    if (ret == GST_FLOW_OK)
+      ret = res;
+    g_mutex_lock (&dec->jobs_lock);
+  }
+  g_mutex_unlock (&dec->jobs_lock);
+
+  return ret;
+}
+
+/* Waits for all pending jobs and releases their frames without output */
+static void
+gst_jpeg_dec_discard_jobs (GstJpegDec * dec)
+{
+  GstJpegDecJob *job;
+
+  g_mutex_lock (&dec->jobs_lock);
+  while ((job = g_queue_pop_head (&dec->jobs))) {
+    while (!job->done)
+      g_cond_wait (&dec->jobs_cond, &dec->jobs_lock);
+
+    gst_video_frame_unmap (&job->vframe);
+    gst_buffer_unmap (job->frame->input_buffer, &job->map);
+    gst_video_decoder_release_frame (GST_VIDEO_DECODER (dec), job->frame);
+    g_slice_free (GstJpegDecJob, job);
+  }
+  g_mutex_unlock (&dec->jobs_lock);
+}
+
+static void
+gst_jpeg_dec_stop_pool (GstJpegDec * dec)
+{
+  guint i;
 
-    return ret;
+  if (!dec->pool)
+    return;
+
+  gst_jpeg_dec_discard_jobs (dec);
+
+  g_thread_pool_free (dec->pool, FALSE, TRUE);
+  dec->pool = NULL;
+
+  for (i = 0; i < dec->n_contexts; i++) {
+    jpeg_destroy_decompress (&dec->contexts[i].cinfo);
+    gst_jpeg_dec_free_buffers (&dec->contexts[i]);
   }
+  g_free (dec->contexts);
+  dec->contexts = NULL;
+  dec->n_contexts = 0;
+
+  g_async_queue_unref (dec->free_contexts);
+  dec->free_contexts = NULL;
+}
+
+/* Frames wait for up to one frame per worker before they are pushed */
+static void
+gst_jpeg_dec_update_latency (GstJpegDec * dec)
+{
+  GstClockTime latency = 0;
+  gint fps_n, fps_d;
+
+  if (!dec->pool || !dec->input_state)
+    return;
+
+  fps_n = GST_VIDEO_INFO_FPS_N (&dec->input_state->info);
+  fps_d = GST_VIDEO_INFO_FPS_D (&dec->input_state->info);
+  if (fps_n > 0 && fps_d > 0)
+    latency = gst_util_uint64_scale (dec->n_contexts * GST_SECOND, fps_d,
+        fps_n);
+
+  GST_DEBUG_OBJECT (dec, "latency %" GST_TIME_FORMAT,
+      GST_TIME_ARGS (latency));
+  gst_video_decoder_set_latency (GST_VIDEO_DECODER (dec), latency, latency);
 }
 
 static void
@@ -953,6 +1622,10 @@ gst_jpeg_dec_negotiate (GstJpegDec * dec, gint width, gint height, gint clrspc)
     gst_video_codec_state_unref (outstate);
   }
 
+  /* frames still being decoded have buffers for the old format */
+  if (dec->pool)
+    gst_jpeg_dec_finish_jobs (dec, 0);
+
   outstate =
       gst_video_decoder_set_output_state (GST_VIDEO_DECODER (dec), format,
       width, height, dec->input_state);
@@ -973,8 +1646,10 @@ gst_jpeg_dec_negotiate (GstJpegDec * dec, gint width, gint height, gint clrspc)
 
   gst_video_decoder_negotiate (GST_VIDEO_DECODER (dec));
 
-  GST_DEBUG_OBJECT (dec, "max_v_samp_factor=%d", dec->cinfo.max_v_samp_factor);
-  GST_DEBUG_OBJECT (dec, "max_h_samp_factor=%d", dec->cinfo.max_h_samp_factor);
+  GST_DEBUG_OBJECT (dec, "max_v_samp_factor=%d",
+      dec->ctx.cinfo.max_v_samp_factor);
+  GST_DEBUG_OBJECT (dec, "max_h_samp_factor=%d",
+      dec->ctx.cinfo.max_h_samp_factor);
 }
 
 static GstFlowReturn
@@ -983,9 +1658,11 @@ gst_jpeg_dec_handle_frame (GstVideoDecoder * bdec, GstVideoCodecFrame * frame)
   GstFlowReturn ret = GST_FLOW_OK;
   GstJpegDec *dec = (GstJpegDec *) bdec;
   GstVideoFrame vframe;
+  GstJpegDecRegion region;
   gint width, height;
   gint r_h, r_v;
-  guint code, hdr_ok;
+  guint code, hdr_ok, scale_denom;
+  gboolean cropped;
   gboolean need_unmap = TRUE;
   GstVideoCodecState *state = NULL;
   gboolean release_frame = TRUE;
@@ -993,11 +1670,11 @@ gst_jpeg_dec_handle_frame (GstVideoDecoder * bdec, GstVideoCodecFrame * frame)
   dec->current_frame = frame;
   gst_buffer_map (frame->input_buffer, &dec->current_frame_map, GST_MAP_READ);
 
-  dec->cinfo.src->next_input_byte = dec->current_frame_map.data;
-  dec->cinfo.src->bytes_in_buffer = dec->current_frame_map.size;
+  dec->ctx.cinfo.src->next_input_byte = dec->current_frame_map.data;
+  dec->ctx.cinfo.src->bytes_in_buffer = dec->current_frame_map.size;
 
-  if (setjmp (dec->jerr.setjmp_buffer)) {
-    code = dec->jerr.pub.msg_code;
+  if (setjmp (dec->ctx.jerr.setjmp_buffer)) {
+    code = dec->ctx.jerr.pub.msg_code;
 
     if (code == JERR_INPUT_EOF) {
       GST_DEBUG ("jpeg input EOF error, we probably need more data");
@@ -1007,74 +1684,83 @@ gst_jpeg_dec_handle_frame (GstVideoDecoder * bdec, GstVideoCodecFrame * frame)
   }
 
   /* read header */
-  hdr_ok = jpeg_read_header (&dec->cinfo, TRUE);
+  hdr_ok = jpeg_read_header (&dec->ctx.cinfo, TRUE);
   if (G_UNLIKELY (hdr_ok != JPEG_HEADER_OK)) {
     GST_WARNING_OBJECT (dec, "reading the header failed, %d", hdr_ok);
   }
 
-  GST_LOG_OBJECT (dec, "num_components=%d", dec->cinfo.num_components);
-  GST_LOG_OBJECT (dec, "jpeg_color_space=%d", dec->cinfo.jpeg_color_space);
+  GST_LOG_OBJECT (dec, "num_components=%d", dec->ctx.cinfo.num_components);
+  GST_LOG_OBJECT (dec, "jpeg_color_space=%d", dec->ctx.cinfo.jpeg_color_space);
 
-  if (!dec->cinfo.num_components || !dec->cinfo.comp_info)
+  if (!dec->ctx.cinfo.num_components || !dec->ctx.cinfo.comp_info)
     goto components_not_supported;
 
-  r_h = dec->cinfo.comp_info[0].h_samp_factor;
-  r_v = dec->cinfo.comp_info[0].v_samp_factor;
+  r_h = dec->ctx.cinfo.comp_info[0].h_samp_factor;
+  r_v = dec->ctx.cinfo.comp_info[0].v_samp_factor;
 
   GST_LOG_OBJECT (dec, "r_h = %d, r_v = %d", r_h, r_v);
 
-  if (dec->cinfo.num_components > 3)
+  if (dec->ctx.cinfo.num_components > 3)
     goto components_not_supported;
 
   /* verify color space expectation to avoid going *boom* or bogus output */
-  if (dec->cinfo.jpeg_color_space != JCS_YCbCr &&
-      dec->cinfo.jpeg_color_space != JCS_GRAYSCALE &&
-      dec->cinfo.jpeg_color_space != JCS_RGB)
+  if (dec->ctx.cinfo.jpeg_color_space != JCS_YCbCr &&
+      dec->ctx.cinfo.jpeg_color_space != JCS_GRAYSCALE &&
+      dec->ctx.cinfo.jpeg_color_space != JCS_RGB)
     goto unsupported_colorspace;
 
 #ifndef GST_DISABLE_GST_DEBUG
   {
     gint i;
 
-    for (i = 0; i < dec->cinfo.num_components; ++i) {
+    for (i = 0; i < dec->ctx.cinfo.num_components; ++i) {
       GST_LOG_OBJECT (dec, "[%d] h_samp_factor=%d, v_samp_factor=%d, cid=%d",
-          i, dec->cinfo.comp_info[i].h_samp_factor,
-          dec->cinfo.comp_info[i].v_samp_factor,
-          dec->cinfo.comp_info[i].component_id);
+          i, dec->ctx.cinfo.comp_info[i].h_samp_factor,
+          dec->ctx.cinfo.comp_info[i].v_samp_factor,
+          dec->ctx.cinfo.comp_info[i].component_id);
     }
   }
 #endif
 
-  /* prepare for raw output */
-  dec->cinfo.do_fancy_upsampling = FALSE;
-  dec->cinfo.do_block_smoothing = FALSE;
-  dec->cinfo.out_color_space = dec->cinfo.jpeg_color_space;
-  dec->cinfo.dct_method = dec->idct_method;
-  dec->cinfo.raw_data_out = TRUE;
-
-  GST_LOG_OBJECT (dec, "starting decompress");
-  guarantee_huff_tables (&dec->cinfo);
-  if (!jpeg_start_decompress (&dec->cinfo)) {
-    GST_WARNING_OBJECT (dec, "failed to start decompression cycle");
+  /* the region of interest depends on the output size at the chosen scale,
+   * which jpeglib rounds up */
+  scale_denom = gst_jpeg_dec_get_scale_denom (dec);
+  cropped = gst_jpeg_dec_get_region (dec,
+      (dec->ctx.cinfo.image_width + scale_denom - 1) / scale_denom,
+      (dec->ctx.cinfo.image_height + scale_denom - 1) / scale_denom,
+      scale_denom, &region);
+
+  gst_jpeg_dec_prepare_decompress (dec, &dec->ctx.cinfo, scale_denom,
+      cropped);
+
+  if (dec->pool) {
+    /* a worker does the actual decoding, we only need the output size */
+    jpeg_calc_output_dimensions (&dec->ctx.cinfo);
+  } else {
+    GST_LOG_OBJECT (dec, "starting decompress");
+    if (!jpeg_start_decompress (&dec->ctx.cinfo)) {
+      GST_WARNING_OBJECT (dec, "failed to start decompression cycle");
+    }
   }
 
   /* sanity checks to get safe and reasonable output */
-  switch (dec->cinfo.jpeg_color_space) {
+  switch (dec->ctx.cinfo.jpeg_color_space) {
     case JCS_GRAYSCALE:
-      if (dec->cinfo.num_components != 1)
+      if (dec->ctx.cinfo.num_components != 1)
         goto invalid_yuvrgbgrayscale;
       break;
     case JCS_RGB:
-      if (dec->cinfo.num_components != 3 || dec->cinfo.max_v_samp_factor > 1 ||
-          dec->cinfo.max_h_samp_factor > 1)
+      if (dec->ctx.cinfo.num_components != 3 ||
+          dec->ctx.cinfo.max_v_samp_factor > 1 ||
+          dec->ctx.cinfo.max_h_samp_factor > 1)
         goto invalid_yuvrgbgrayscale;
       break;
     case JCS_YCbCr:
-      if (dec->cinfo.num_components != 3 ||
-          r_v > 2 || r_v < dec->cinfo.comp_info[0].v_samp_factor ||
-          r_v < dec->cinfo.comp_info[1].v_samp_factor ||
-          r_h < dec->cinfo.comp_info[0].h_samp_factor ||
-          r_h < dec->cinfo.comp_info[1].h_samp_factor)
+      if (dec->ctx.cinfo.num_components != 3 ||
+          r_v > 2 || r_v < dec->ctx.cinfo.comp_info[0].v_samp_factor ||
+          r_v < dec->ctx.cinfo.comp_info[1].v_samp_factor ||
+          r_h < dec->ctx.cinfo.comp_info[0].h_samp_factor ||
+          r_h < dec->ctx.cinfo.comp_info[1].h_samp_factor)
         goto invalid_yuvrgbgrayscale;
       break;
     default:
@@ -1082,14 +1768,14 @@ gst_jpeg_dec_handle_frame (GstVideoDecoder * bdec, GstVideoCodecFrame * frame)
       break;
   }
 
-  width = dec->cinfo.output_width;
-  height = dec->cinfo.output_height;
+  width = region.width;
+  height = region.height;
 
   if (G_UNLIKELY (width < MIN_WIDTH || width > MAX_WIDTH ||
           height < MIN_HEIGHT || height > MAX_HEIGHT))
     goto wrong_size;
 
-  gst_jpeg_dec_negotiate (dec, width, height, dec->cinfo.jpeg_color_space);
+  gst_jpeg_dec_negotiate (dec, width, height, dec->ctx.cinfo.jpeg_color_space);
 
   state = gst_video_decoder_get_output_state (bdec);
   ret = gst_video_decoder_allocate_output_frame (bdec, frame);
@@ -1100,52 +1786,41 @@ gst_jpeg_dec_handle_frame (GstVideoDecoder * bdec, GstVideoCodecFrame * frame)
           GST_MAP_READWRITE))
     goto alloc_failed;
 
-  if (setjmp (dec->jerr.setjmp_buffer)) {
-    code = dec->jerr.pub.msg_code;
-    gst_video_frame_unmap (&vframe);
-    goto decode_error;
-  }
-
   GST_LOG_OBJECT (dec, "width %d, height %d", width, height);
 
-  if (dec->cinfo.jpeg_color_space == JCS_RGB) {
-    gst_jpeg_dec_decode_rgb (dec, &vframe);
-  } else if (dec->cinfo.jpeg_color_space == JCS_GRAYSCALE) {
-    gst_jpeg_dec_decode_grayscale (dec, &vframe);
-  } else {
-    GST_LOG_OBJECT (dec, "decompressing (reqired scanline buffer height = %u)",
-        dec->cinfo.rec_outbuf_height);
+  if (dec->pool) {
+    gst_jpeg_dec_queue_job (dec, frame, &vframe, scale_denom,
+        cropped ? &region : NULL);
+    jpeg_abort_decompress (&dec->ctx.cinfo);
+    release_frame = FALSE;
 
-    /* For some widths jpeglib requires more horizontal padding than I420 
-     * provides. In those cases we need to decode into separate buffers and then
-     * copy over the data into our final picture buffer, otherwise jpeglib might
-     * write over the end of a line into the beginning of the next line,
-     * resulting in blocky artifacts on the left side of the picture. */
-    if (G_UNLIKELY (width % (dec->cinfo.max_h_samp_factor * DCTSIZE) != 0
-            || dec->cinfo.comp_info[0].h_samp_factor != 2
-            || dec->cinfo.comp_info[1].h_samp_factor != 1
-            || dec->cinfo.comp_info[2].h_samp_factor != 1)) {
-      GST_CAT_LOG_OBJECT (GST_CAT_PERFORMANCE, dec,
-          "indirect decoding using extra buffer copy");
-      gst_jpeg_dec_decode_indirect (dec, &vframe, r_v, r_h,
-          dec->cinfo.num_components);
-    } else {
-      ret = gst_jpeg_dec_decode_direct (dec, &vframe);
+    /* push out whatever is done, and wait if too many frames are pending */
+    ret = gst_jpeg_dec_finish_jobs (dec, dec->n_contexts);
+    goto exit;
+  }
 
-      if (G_UNLIKELY (ret != GST_FLOW_OK))
-        goto decode_direct_failed;
-    }
+  if (setjmp (dec->ctx.jerr.setjmp_buffer)) {
+    code = dec->ctx.jerr.pub.msg_code;
+    gst_video_frame_unmap (&vframe);
+    goto decode_error;
+  }
+
+  ret = gst_jpeg_dec_decode_image (dec, &dec->ctx, &vframe,
+      cropped ? &region : NULL);
+  if (G_UNLIKELY (ret != GST_FLOW_OK)) {
+    gst_video_frame_unmap (&vframe);
+    goto decode_direct_failed;
   }
 
   gst_video_frame_unmap (&vframe);
 
-  if (setjmp (dec->jerr.setjmp_buffer)) {
-    code = dec->jerr.pub.msg_code;
+  if (setjmp (dec->ctx.jerr.setjmp_buffer)) {
+    code = dec->ctx.jerr.pub.msg_code;
     goto decode_error;
   }
 
   GST_LOG_OBJECT (dec, "decompressing finished");
-  jpeg_finish_decompress (&dec->cinfo);
+  jpeg_finish_decompress (&dec->ctx.cinfo);
 
   gst_buffer_unmap (frame->input_buffer, &dec->current_frame_map);
   ret = gst_video_decoder_finish_frame (bdec, frame);
@@ -1187,7 +1862,8 @@ decode_error:
   {
     gchar err_msg[JMSG_LENGTH_MAX];
 
-    dec->jerr.pub.format_message ((j_common_ptr) (&dec->cinfo), err_msg);
+    dec->ctx.jerr.pub.format_message ((j_common_ptr) (&dec->ctx.cinfo),
+        err_msg);
 
     GST_VIDEO_DECODER_ERROR (dec, 1, STREAM, DECODE,
         (_("Failed to decode JPEG image")), ("Decode error #%u: %s", code,
@@ -1197,14 +1873,20 @@ decode_error:
     gst_video_decoder_drop_frame (bdec, frame);
     release_frame = FALSE;
     need_unmap = FALSE;
-    jpeg_abort_decompress (&dec->cinfo);
+    jpeg_abort_decompress (&dec->ctx.cinfo);
 
     goto done;
   }
 decode_direct_failed:
   {
-    /* already posted an error message */
-    jpeg_abort_decompress (&dec->cinfo);
+    ret = GST_FLOW_OK;
+    GST_VIDEO_DECODER_ERROR (dec, 1, STREAM, DECODE,
+        (_("Failed to decode JPEG image")),
+        ("Unsupported subsampling schema: v_samp factors: %u %u %u",
+            dec->ctx.cinfo.comp_info[0].v_samp_factor,
+            dec->ctx.cinfo.comp_info[1].v_samp_factor,
+            dec->ctx.cinfo.comp_info[2].v_samp_factor), ret);
+    jpeg_abort_decompress (&dec->ctx.cinfo);
     goto done;
   }
 alloc_failed:
@@ -1215,13 +1897,13 @@ alloc_failed:
 
     GST_DEBUG_OBJECT (dec, "failed to alloc buffer, reason %s", reason);
     /* Reset for next time */
-    jpeg_abort_decompress (&dec->cinfo);
+    jpeg_abort_decompress (&dec->ctx.cinfo);
     if (ret != GST_FLOW_EOS && ret != GST_FLOW_FLUSHING &&
         ret != GST_FLOW_NOT_LINKED) {
       GST_VIDEO_DECODER_ERROR (dec, 1, STREAM, DECODE,
           (_("Failed to decode JPEG image")),
           ("Buffer allocation failed, reason: %s", reason), ret);
-      jpeg_abort_decompress (&dec->cinfo);
+      jpeg_abort_decompress (&dec->ctx.cinfo);
     }
     goto exit;
   }
@@ -1230,8 +1912,8 @@ components_not_supported:
     GST_VIDEO_DECODER_ERROR (dec, 1, STREAM, DECODE,
         (_("Failed to decode JPEG image")),
         ("number of components not supported: %d (max 3)",
-            dec->cinfo.num_components), ret);
-    jpeg_abort_decompress (&dec->cinfo);
+            dec->ctx.cinfo.num_components), ret);
+    jpeg_abort_decompress (&dec->ctx.cinfo);
     goto done;
   }
 unsupported_colorspace:
@@ -1239,7 +1921,7 @@ unsupported_colorspace:
     GST_VIDEO_DECODER_ERROR (dec, 1, STREAM, DECODE,
         (_("Failed to decode JPEG image")),
         ("Picture has unknown or unsupported colourspace"), ret);
-    jpeg_abort_decompress (&dec->cinfo);
+    jpeg_abort_decompress (&dec->ctx.cinfo);
     goto done;
   }
 invalid_yuvrgbgrayscale:
@@ -1247,7 +1929,7 @@ invalid_yuvrgbgrayscale:
     GST_VIDEO_DECODER_ERROR (dec, 1, STREAM, DECODE,
         (_("Failed to decode JPEG image")),
         ("Picture is corrupt or unhandled YUV/RGB/grayscale layout"), ret);
-    jpeg_abort_decompress (&dec->cinfo);
+    jpeg_abort_decompress (&dec->ctx.cinfo);
     goto done;
   }
 }
@@ -1306,8 +1988,14 @@ gst_jpeg_dec_start (GstVideoDecoder * bdec)
   dec->parse_entropy_len = 0;
   dec->parse_resync = FALSE;
 
+  dec->scale_denom = 1;
+  dec->scale_image_width = 0;
+  dec->scale_image_height = 0;
+
   gst_video_decoder_set_packetized (bdec, FALSE);
 
+  gst_jpeg_dec_start_pool (dec);
+
   return TRUE;
 }
 
@@ -1316,7 +2004,10 @@ gst_jpeg_dec_flush (GstVideoDecoder * bdec)
 {
   GstJpegDec *dec = (GstJpegDec *) bdec;
 
-  jpeg_abort_decompress (&dec->cinfo);
+  if (dec->pool)
+    gst_jpeg_dec_discard_jobs (dec);
+
+  jpeg_abort_decompress (&dec->ctx.cinfo);
   dec->parse_entropy_len = 0;
   dec->parse_resync = FALSE;
   dec->saw_header = FALSE;
@@ -1341,6 +2032,26 @@ gst_jpeg_dec_set_property (GObject * object, guint prop_id,
       g_atomic_int_set (&dec->max_errors, g_value_get_int (value));
       break;
 #endif
+    case PROP_MAX_THREADS:
+      dec->max_threads = g_value_get_int (value);
+      break;
+    case PROP_CROP_LEFT:
+    case PROP_CROP_RIGHT:
+    case PROP_CROP_TOP:
+    case PROP_CROP_BOTTOM:
+      GST_OBJECT_LOCK (dec);
+      if (prop_id == PROP_CROP_LEFT)
+        dec->crop_left = g_value_get_int (value);
+      else if (prop_id == PROP_CROP_RIGHT)
+        dec->crop_right = g_value_get_int (value);
+      else if (prop_id == PROP_CROP_TOP)
+        dec->crop_top = g_value_get_int (value);
+      else
+        dec->crop_bottom = g_value_get_int (value);
+      /* the output size changes, so pick the scale again */
+      dec->crop_changed = TRUE;
+      GST_OBJECT_UNLOCK (dec);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1364,6 +2075,29 @@ gst_jpeg_dec_get_property (GObject * object, guint prop_id, GValue * value,
       g_value_set_int (value, g_atomic_int_get (&dec->max_errors));
       break;
 #endif
+    case PROP_MAX_THREADS:
+      g_value_set_int (value, dec->max_threads);
+      break;
+    case PROP_CROP_LEFT:
+      GST_OBJECT_LOCK (dec);
+      g_value_set_int (value, dec->crop_left);
+      GST_OBJECT_UNLOCK (dec);
+      break;
+    case PROP_CROP_RIGHT:
+      GST_OBJECT_LOCK (dec);
+      g_value_set_int (value, dec->crop_right);
+      GST_OBJECT_UNLOCK (dec);
+      break;
+    case PROP_CROP_TOP:
+      GST_OBJECT_LOCK (dec);
+      g_value_set_int (value, dec->crop_top);
+      GST_OBJECT_UNLOCK (dec);
+      break;
+    case PROP_CROP_BOTTOM:
+      GST_OBJECT_LOCK (dec);
+      g_value_set_int (value, dec->crop_bottom);
+      GST_OBJECT_UNLOCK (dec);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1375,7 +2109,19 @@ gst_jpeg_dec_stop (GstVideoDecoder * bdec)
 {
   GstJpegDec *dec = (GstJpegDec *) bdec;
 
-  gst_jpeg_dec_free_buffers (dec);
+  gst_jpeg_dec_stop_pool (dec);
+  gst_jpeg_dec_free_buffers (&dec->ctx);
 
   return TRUE;
 }
+
+static GstFlowReturn
+gst_jpeg_dec_finish (GstVideoDecoder * bdec)
+{
+  GstJpegDec *dec = (GstJpegDec *) bdec;
+
+  if (!dec->pool)
+    return GST_FLOW_OK;
+
+  return gst_jpeg_dec_finish_jobs (dec, 0);
+}
@@ -63,6 +63,25 @@ struct GstJpegDecSourceMgr {
   GstJpegDec              *dec;
 };
 
+/* libjpeg state and scratch memory needed to decode one image. The element
+ * has one for the streaming thread and one per worker thread when decoding
+ * frames in parallel */
+typedef struct {
+  struct jpeg_decompress_struct cinfo;
+  struct GstJpegDecErrorMgr     jerr;
+  struct GstJpegDecSourceMgr    jsrc;
+
+  /* arrays for indirect decoding */
+  gboolean idr_width_allocated;
+  guchar *idr_y[16],*idr_u[16],*idr_v[16];
+} GstJpegDecContext;
+
+/* part of the decoded image that is output, in output (scaled) pixels */
+typedef struct {
+  gint x, y;
+  gint width, height;
+} GstJpegDecRegion;
+
 /* Can't use GstBaseTransform, because GstBaseTransform
  * doesn't handle the N buffers in, 1 buffer out case,
  * but only the 1-in 1-out case */
@@ -83,13 +102,33 @@ struct _GstJpegDec {
   gint     idct_method;
   gint     max_errors;  /* ATOMIC */
 
-  struct jpeg_decompress_struct cinfo;
-  struct GstJpegDecErrorMgr     jerr;
-  struct GstJpegDecSourceMgr    jsrc;
+  gint     max_threads;
+
+  /* region of interest, in image pixels (protected by OBJECT_LOCK) */
+  gint     crop_left;
+  gint     crop_right;
+  gint     crop_top;
+  gint     crop_bottom;
+  gboolean crop_changed;
+
+  GstJpegDecContext ctx;
+
+  /* DCT domain downscaling, chosen from the downstream caps and cached for
+   * the image size it was chosen for */
+  guint    scale_denom;
+  gint     scale_image_width;
+  gint     scale_image_height;
+
+  /* frame parallel decoding: jobs in decoding order, waiting to be finished,
+   * and the contexts the workers pick from */
+  GThreadPool *pool;
+  GAsyncQueue *free_contexts;
+  GstJpegDecContext *contexts;
+  guint        n_contexts;
+  GQueue       jobs;
+  GMutex       jobs_lock;
+  GCond        jobs_cond;
 
-  /* arrays for indirect decoding */
-  gboolean idr_width_allocated;
-  guchar *idr_y[16],*idr_u[16],*idr_v[16];
   /* current (parsed) image size */
   guint    rem_img_len;
 };
@@ -0,0 +1,461 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * The blocks of a resource that souphttpsrc fetched with range requests. The
+ * most recently used blocks are kept in memory, when a cache file is used all
+ * blocks are also written to it so that they can be read back after they were
+ * dropped from memory. The blocks that are about to be read are pinned so that
+ * fetching further ahead never drops them.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <errno.h>
+#include <gio/gio.h>
+#include <glib/gstdio.h>
+
+#include "gstsoupblockcache.h"
+
+GST_DEBUG_CATEGORY_STATIC (soupblockcache_debug);
+#define GST_CAT_DEFAULT (soupblockcache_debug)
+
+typedef enum
+{
+  BLOCK_EMPTY,
+  BLOCK_PENDING,
+  BLOCK_DONE
+} GstSoupBlockState;
+
+typedef struct
+{
+  GstSoupBlockState state;
+  /* the data when it is in memory */
+  GstBuffer *buffer;
+  gboolean on_disk;
+  /* in the LRU list while in memory */
+  GList link;
+} GstSoupBlock;
+
+struct _GstSoupBlockCache
+{
+  GMutex lock;
+  guint64 size;
+  guint block_size;
+  guint n_blocks;
+  GstSoupBlock *blocks;
+
+  /* blocks in memory, most recently used first */
+  GQueue lru;
+  guint64 memory;
+  guint64 max_memory;
+  /* blocks that are never dropped from memory */
+  guint pin_first;
+  guint pin_last;
+
+  GMutex io_lock;
+  GFile *file;
+  GFileIOStream *stream;
+};
+
+/**
+ * gst_soup_block_cache_new:
+ * @size: the size of the resource
+ * @block_size: the size of the blocks
+ * @max_memory: the number of bytes to keep in memory
+ * @location: (allow-none): a directory for the cache file
+ * @error: return location for a #GError
+ *
+ * Create a cache for a resource of @size bytes. When @location is set, all
+ * blocks are also stored in a temporary file in that directory.
+ *
+ * Returns: the new cache, or %NULL when the cache file could not be created.
+ */
+GstSoupBlockCache *
+gst_soup_block_cache_new (guint64 size, guint block_size, guint64 max_memory,
+    const gchar * location, GError ** error)
+{
+  static gsize init = 0;
+  GstSoupBlockCache *cache;
+  guint i;
+
+  g_return_val_if_fail (size > 0, NULL);
+  g_return_val_if_fail (block_size > 0, NULL);
+
+  if (g_once_init_enter (&init)) {
+    GST_DEBUG_CATEGORY_INIT (soupblockcache_debug, "soupblockcache", 0,
+        "SOUP HTTP block cache");
+    g_once_init_leave (&init, 1);
+  }
+
+  cache = g_slice_new0 (GstSoupBlockCache);
+  g_mutex_init (&cache->lock);
+  g_mutex_init (&cache->io_lock);
+  cache->size = size;
+  cache->block_size = block_size;
+  cache->n_blocks = (size + block_size - 1) / block_size;
+  cache->max_memory = max_memory;
+  cache->pin_first = 1;
+  cache->pin_last = 0;
+  cache->blocks = g_new0 (GstSoupBlock, cache->n_blocks);
+  for (i = 0; i < cache->n_blocks; i++)
+    cache->blocks[i].link.data = &cache->blocks[i];
+  g_queue_init (&cache->lru);
+
+  if (location) {
+    gchar *filename;
+    gint fd;
+
+    filename = g_build_filename (location, "souphttpsrc-XXXXXX", NULL);
+    fd = g_mkstemp (filename);
+    if (fd < 0) {
+      gint errsv = errno;
+
+      g_set_error (error, G_IO_ERROR, g_io_error_from_errno (errsv),
+          "Could not create cache file in %s: %s", location,
+          g_strerror (errsv));
+      g_free (filename);
+      gst_soup_block_cache_free (cache);
+      return NULL;
+    }
+    g_close (fd, NULL);
+
+    cache->file = g_file_new_for_path (filename);
+    g_free (filename);
+    cache->stream = g_file_open_readwrite (cache->file, NULL, error);
+    if (!cache->stream) {
+      gst_soup_block_cache_free (cache);
+      return NULL;
+    }
+  }
+
+  GST_DEBUG ("cache for %" G_GUINT64_FORMAT " bytes in %u blocks, file %p",
+      size, cache->n_blocks, cache->file);
+
+  return cache;
+}
+
+/**
+ * gst_soup_block_cache_free:
+ * @cache: a #GstSoupBlockCache
+ *
+ * Free @cache and remove its cache file.
+ */
+void
+gst_soup_block_cache_free (GstSoupBlockCache * cache)
+{
+  guint i;
+
+  for (i = 0; i < cache->n_blocks; i++) {
+    if (cache->blocks[i].buffer)
+      gst_buffer_unref (cache->blocks[i].buffer);
+  }
+  g_free (cache->blocks);
+
+  if (cache->stream) {
+    g_io_stream_close (G_IO_STREAM (cache->stream), NULL, NULL);
+    g_object_unref (cache->stream);
+  }
+  if (cache->file) {
+    g_file_delete (cache->file, NULL, NULL);
+    g_object_unref (cache->file);
+  }
+
+  g_mutex_clear (&cache->lock);
+  g_mutex_clear (&cache->io_lock);
+  g_slice_free (GstSoupBlockCache, cache);
+}
+
+guint
+gst_soup_block_cache_get_n_blocks (GstSoupBlockCache * cache)
+{
+  return cache->n_blocks;
+}
+
+guint
+gst_soup_block_cache_get_block_size (GstSoupBlockCache * cache)
+{
+  return cache->block_size;
+}
+
+/**
+ * gst_soup_block_cache_get_range:
+ * @cache: a #GstSoupBlockCache
+ * @index: a block index
+ * @start: (out): the offset of the first byte of the block
+ * @stop: (out): the offset after the last byte of the block
+ *
+ * Get the byte range of the block @index.
+ */
+void
+gst_soup_block_cache_get_range (GstSoupBlockCache * cache, guint index,
+    guint64 * start, guint64 * stop)
+{
+  *start = (guint64) index * cache->block_size;
+  *stop = MIN (*start + cache->block_size, cache->size);
+}
+
+/* drop @block from memory, called with the lock */
+static void
+gst_soup_block_cache_drop (GstSoupBlockCache * cache, GstSoupBlock * block)
+{
+  g_queue_unlink (&cache->lru, &block->link);
+  cache->memory -= gst_buffer_get_size (block->buffer);
+  gst_buffer_unref (block->buffer);
+  block->buffer = NULL;
+
+  /* fetch it again when it is needed */
+  if (!block->on_disk)
+    block->state = BLOCK_EMPTY;
+
+  GST_LOG ("dropped block %u, on disk %d", (guint) (block - cache->blocks),
+      block->on_disk);
+}
+
+/* keep @buffer of @block in memory, dropping the least recently used blocks
+ * that are not pinned when over the limit. Called with the lock. */
+static void
+gst_soup_block_cache_store (GstSoupBlockCache * cache, GstSoupBlock * block,
+    GstBuffer * buffer)
+{
+  GList *l;
+
+  block->buffer = buffer;
+  g_queue_push_head_link (&cache->lru, &block->link);
+  cache->memory += gst_buffer_get_size (buffer);
+
+  l = cache->lru.tail;
+  while (cache->memory > cache->max_memory && l) {
+    GstSoupBlock *victim = l->data;
+    guint index = victim - cache->blocks;
+
+    l = l->prev;
+    if (victim == block || (index >= cache->pin_first
+            && index <= cache->pin_last))
+      continue;
+    gst_soup_block_cache_drop (cache, victim);
+  }
+}
+
+/**
+ * gst_soup_block_cache_pin:
+ * @cache: a #GstSoupBlockCache
+ * @first: the first block to pin
+ * @last: the last block to pin
+ *
+ * Keep the blocks between @first and @last in memory once they are stored,
+ * even when that takes more memory than the limit. This replaces the blocks
+ * pinned before, they can be dropped again.
+ */
+void
+gst_soup_block_cache_pin (GstSoupBlockCache * cache, guint first, guint last)
+{
+  g_mutex_lock (&cache->lock);
+  cache->pin_first = first;
+  cache->pin_last = last;
+  g_mutex_unlock (&cache->lock);
+}
+
+/**
+ * gst_soup_block_cache_claim:
+ * @cache: a #GstSoupBlockCache
+ * @first: the first block to consider
+ * @last: the last block to consider
+ * @index: (out): the claimed block
+ *
+ * Find the first block between @first and @last that is not cached or being
+ * fetched, and mark it as being fetched. It must be completed with
+ * gst_soup_block_cache_put() or gst_soup_block_cache_abandon().
+ *
+ * Returns: %TRUE when a block was claimed.
+ */
+gboolean
+gst_soup_block_cache_claim (GstSoupBlockCache * cache, guint first,
+    guint last, guint * index)
+{
+  gboolean res = FALSE;
+  guint i;
+
+  last = MIN (last, cache->n_blocks - 1);
+
+  g_mutex_lock (&cache->lock);
+  for (i = first; i <= last; i++) {
+    if (cache->blocks[i].state == BLOCK_EMPTY) {
+      cache->blocks[i].state = BLOCK_PENDING;
+      *index = i;
+      res = TRUE;
+      break;
+    }
+  }
+  g_mutex_unlock (&cache->lock);
+
+  return res;
+}
+
+/**
+ * gst_soup_block_cache_abandon:
+ * @cache: a #GstSoupBlockCache
+ * @index: a claimed block
+ *
+ * Give up fetching block @index, it can be claimed again.
+ */
+void
+gst_soup_block_cache_abandon (GstSoupBlockCache * cache, guint index)
+{
+  g_mutex_lock (&cache->lock);
+  if (cache->blocks[index].state == BLOCK_PENDING)
+    cache->blocks[index].state = BLOCK_EMPTY;
+  g_mutex_unlock (&cache->lock);
+}
+
+/**
+ * gst_soup_block_cache_put:
+ * @cache: a #GstSoupBlockCache
+ * @index: a claimed block
+ * @buffer: (transfer full): the data of the block
+ *
+ * Store the data of block @index.
+ */
+void
+gst_soup_block_cache_put (GstSoupBlockCache * cache, guint index,
+    GstBuffer * buffer)
+{
+  GstSoupBlock *block = &cache->blocks[index];
+  gboolean on_disk = FALSE;
+
+  if (cache->stream) {
+    GOutputStream *out;
+    GstMapInfo map;
+    GError *err = NULL;
+
+    out = g_io_stream_get_output_stream (G_IO_STREAM (cache->stream));
+
+    gst_buffer_map (buffer, &map, GST_MAP_READ);
+    g_mutex_lock (&cache->io_lock);
+    on_disk = g_seekable_seek (G_SEEKABLE (cache->stream),
+        (goffset) index * cache->block_size, G_SEEK_SET, NULL, &err) &&
+        g_output_stream_write_all (out, map.data, map.size, NULL, NULL, &err);
+    g_mutex_unlock (&cache->io_lock);
+    gst_buffer_unmap (buffer, &map);
+
+    if (!on_disk) {
+      GST_WARNING ("failed to write block %u: %s", index, err->message);
+      g_clear_error (&err);
+    }
+  }
+
+  g_mutex_lock (&cache->lock);
+  g_warn_if_fail (block->state == BLOCK_PENDING);
+  block->state = BLOCK_DONE;
+  block->on_disk = on_disk;
+  gst_soup_block_cache_store (cache, block, buffer);
+  GST_LOG ("stored block %u, %" G_GUINT64_FORMAT " bytes in memory", index,
+      cache->memory);
+  g_mutex_unlock (&cache->lock);
+}
+
+static GstBuffer *
+gst_soup_block_cache_read (GstSoupBlockCache * cache, guint index)
+{
+  GInputStream *in;
+  GstBuffer *buffer;
+  GstMapInfo map;
+  guint64 start, stop;
+  gsize n_read = 0;
+  GError *err = NULL;
+  gboolean res;
+
+  in = g_io_stream_get_input_stream (G_IO_STREAM (cache->stream));
+  gst_soup_block_cache_get_range (cache, index, &start, &stop);
+
+  buffer = gst_buffer_new_allocate (NULL, stop - start, NULL);
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  g_mutex_lock (&cache->io_lock);
+  res = g_seekable_seek (G_SEEKABLE (cache->stream), start, G_SEEK_SET, NULL,
+      &err) && g_input_stream_read_all (in, map.data, map.size, &n_read, NULL,
+      &err);
+  g_mutex_unlock (&cache->io_lock);
+  gst_buffer_unmap (buffer, &map);
+
+  if (!res || n_read != stop - start) {
+    GST_WARNING ("failed to read block %u: %s", index,
+        err ? err->message : "short read");
+    g_clear_error (&err);
+    gst_buffer_unref (buffer);
+    return NULL;
+  }
+
+  return buffer;
+}
+
+/**
+ * gst_soup_block_cache_lookup:
+ * @cache: a #GstSoupBlockCache
+ * @index: a block index
+ * @refetch: (out) (allow-none): set to %TRUE when the block could not be read
+ *     back from the cache file and has to be fetched again
+ *
+ * Get the data of block @index, reading it back from the cache file when it
+ * is not in memory.
+ *
+ * Returns: (transfer full): the data of the block, or %NULL when it is not
+ * cached.
+ */
+GstBuffer *
+gst_soup_block_cache_lookup (GstSoupBlockCache * cache, guint index,
+    gboolean * refetch)
+{
+  GstSoupBlock *block = &cache->blocks[index];
+  GstBuffer *buffer = NULL;
+
+  if (refetch)
+    *refetch = FALSE;
+
+  g_mutex_lock (&cache->lock);
+  if (block->state != BLOCK_DONE)
+    goto done;
+
+  if (block->buffer) {
+    g_queue_unlink (&cache->lru, &block->link);
+    g_queue_push_head_link (&cache->lru, &block->link);
+    buffer = gst_buffer_ref (block->buffer);
+    goto done;
+  }
+  g_mutex_unlock (&cache->lock);
+
+  buffer = gst_soup_block_cache_read (cache, index);
+
+  g_mutex_lock (&cache->lock);
+  if (!buffer) {
+    /* fetch it again */
+    block->on_disk = FALSE;
+    block->state = BLOCK_EMPTY;
+    if (refetch)
+      *refetch = TRUE;
+  } else if (!block->buffer) {
+    GST_LOG ("read back block %u", index);
+    gst_soup_block_cache_store (cache, block, gst_buffer_ref (buffer));
+  }
+
+done:
+  g_mutex_unlock (&cache->lock);
+
+  return buffer;
+}
@@ -0,0 +1,61 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_SOUP_BLOCK_CACHE_H__
+#define __GST_SOUP_BLOCK_CACHE_H__
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstSoupBlockCache GstSoupBlockCache;
+
+GstSoupBlockCache *  gst_soup_block_cache_new        (guint64 size,
+                                                      guint block_size,
+                                                      guint64 max_memory,
+                                                      const gchar *location,
+                                                      GError **error);
+void                 gst_soup_block_cache_free       (GstSoupBlockCache *cache);
+
+guint                gst_soup_block_cache_get_n_blocks (GstSoupBlockCache *cache);
+guint                gst_soup_block_cache_get_block_size (GstSoupBlockCache *cache);
+void                 gst_soup_block_cache_get_range  (GstSoupBlockCache *cache,
+                                                      guint index,
+                                                      guint64 *start,
+                                                      guint64 *stop);
+
+void                 gst_soup_block_cache_pin        (GstSoupBlockCache *cache,
+                                                      guint first,
+                                                      guint last);
+
+gboolean             gst_soup_block_cache_claim      (GstSoupBlockCache *cache,
+                                                      guint first,
+                                                      guint last,
+                                                      guint *index);
+void                 gst_soup_block_cache_abandon    (GstSoupBlockCache *cache,
+                                                      guint index);
+void                 gst_soup_block_cache_put        (GstSoupBlockCache *cache,
+                                                      guint index,
+                                                      GstBuffer *buffer);
+GstBuffer *          gst_soup_block_cache_lookup     (GstSoupBlockCache *cache,
+                                                      guint index,
+                                                      gboolean *refetch);
+
+G_END_DECLS
+
+#endif /* __GST_SOUP_BLOCK_CACHE_H__ */
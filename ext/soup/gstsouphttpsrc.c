@@ -33,6 +33,13 @@
  * need to use the #ICYDemux element as follow-up element to extract the Icecast
  * metadata and to determine the underlying media type.
  *
+ * When #GstSoupHTTPSrc:parallel-connections is set and the server reports the
+ * size of the resource and accepts range requests, the resource is fetched in
+ * blocks of #GstSoupHTTPSrc:fetch-block-size bytes over several connections,
+ * ahead of the read position. The blocks are kept in a cache, in memory or in
+ * the file set with #GstSoupHTTPSrc:cache-location, so that seeking back into
+ * data that was already downloaded does not need another request.
+ *
  * <refsect2>
  * <title>Example launch line</title>
  * |[
@@ -80,6 +87,7 @@
 #include <libsoup/soup.h>
 #include "gstsouphttpsrc.h"
 #include "gstsouputils.h"
+#include "gstsoupblockcache.h"
 
 #include <gst/tag/tag.h>
 
@@ -119,6 +127,11 @@ enum
   PROP_RETRIES,
   PROP_METHOD,
   PROP_TLS_INTERACTION,
+  PROP_PARALLEL_CONNECTIONS,
+  PROP_FETCH_BLOCK_SIZE,
+  PROP_READ_AHEAD,
+  PROP_CACHE_SIZE,
+  PROP_CACHE_LOCATION,
 };
 
 #define DEFAULT_USER_AGENT           "GStreamer souphttpsrc " PACKAGE_VERSION " "
@@ -134,6 +147,11 @@ enum
 #define DEFAULT_TIMEOUT              15
 #define DEFAULT_RETRIES              3
 #define DEFAULT_SOUP_METHOD          NULL
+#define DEFAULT_PARALLEL_CONNECTIONS 0
+#define DEFAULT_FETCH_BLOCK_SIZE     (1024 * 1024)
+#define DEFAULT_READ_AHEAD           8
+#define DEFAULT_CACHE_SIZE           (64 * 1024 * 1024)
+#define DEFAULT_CACHE_LOCATION       NULL
 
 #define GROW_BLOCKSIZE_LIMIT 1
 #define GROW_BLOCKSIZE_COUNT 1
@@ -183,6 +201,7 @@ static GstFlowReturn gst_soup_http_src_parse_status (SoupMessage * msg,
     GstSoupHTTPSrc * src);
 static GstFlowReturn gst_soup_http_src_got_headers (GstSoupHTTPSrc * src,
     SoupMessage * msg);
+static void gst_soup_http_src_stop_fetcher (GstSoupHTTPSrc * src);
 static void gst_soup_http_src_authenticate_cb (SoupSession * session,
     SoupMessage * msg, SoupAuth * auth, gboolean retrying,
     GstSoupHTTPSrc * src);
@@ -409,6 +428,80 @@ gst_soup_http_src_class_init (GstSoupHTTPSrcClass * klass)
           "The HTTP method to use (GET, HEAD, OPTIONS, etc)",
           DEFAULT_SOUP_METHOD, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstSoupHTTPSrc::parallel-connections:
+   *
+   * When the server reports the size of the resource and supports range
+   * requests, fetch it in blocks of #GstSoupHTTPSrc::fetch-block-size bytes
+   * over this many connections in parallel. The fetched blocks are cached,
+   * seeking back into them does not make a new request. With 0, or when the
+   * server answers the first range requests without a range, the resource is
+   * downloaded sequentially over one connection.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_PARALLEL_CONNECTIONS,
+      g_param_spec_uint ("parallel-connections", "Parallel connections",
+          "Number of connections to fetch blocks of the resource with "
+          "(0 = download sequentially)", 0, 8, DEFAULT_PARALLEL_CONNECTIONS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSoupHTTPSrc::fetch-block-size:
+   *
+   * The size of the blocks fetched with #GstSoupHTTPSrc::parallel-connections.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_FETCH_BLOCK_SIZE,
+      g_param_spec_uint ("fetch-block-size", "Fetch block size",
+          "Size in bytes of the blocks fetched with parallel connections",
+          16 * 1024, G_MAXINT, DEFAULT_FETCH_BLOCK_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSoupHTTPSrc::read-ahead:
+   *
+   * The number of blocks from the read position on that are fetched with
+   * #GstSoupHTTPSrc::parallel-connections.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_READ_AHEAD,
+      g_param_spec_uint ("read-ahead", "Read ahead",
+          "Number of blocks to fetch from the read position on", 1, 1024,
+          DEFAULT_READ_AHEAD, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSoupHTTPSrc::cache-size:
+   *
+   * The maximum number of bytes of fetched blocks to keep in memory. It is
+   * raised to hold at least the blocks that are read ahead.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_CACHE_SIZE,
+      g_param_spec_uint64 ("cache-size", "Cache size",
+          "Maximum size in bytes of the fetched blocks to keep in memory",
+          0, G_MAXUINT64, DEFAULT_CACHE_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSoupHTTPSrc::cache-location:
+   *
+   * A directory for a temporary file in which all blocks fetched with
+   * #GstSoupHTTPSrc::parallel-connections are stored, so that they don't have
+   * to be fetched again when they were dropped from memory. The file is
+   * removed when the element stops.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_CACHE_LOCATION,
+      g_param_spec_string ("cache-location", "Cache location",
+          "Directory for the file to cache fetched blocks in "
+          "(NULL = only cache in memory)", DEFAULT_CACHE_LOCATION,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class, &srctemplate);
 
   gst_element_class_set_static_metadata (gstelement_class, "HTTP client source",
@@ -449,6 +542,7 @@ gst_soup_http_src_reset (GstSoupHTTPSrc * src)
   src->stop_position = -1;
   src->content_size = 0;
   src->have_body = FALSE;
+  src->fetcher_probed = FALSE;
 
   src->reduce_blocksize_count = 0;
   src->increase_blocksize_count = 0;
@@ -500,6 +594,11 @@ gst_soup_http_src_init (GstSoupHTTPSrc * src)
   src->tls_interaction = DEFAULT_TLS_INTERACTION;
   src->max_retries = DEFAULT_RETRIES;
   src->method = DEFAULT_SOUP_METHOD;
+  src->parallel_connections = DEFAULT_PARALLEL_CONNECTIONS;
+  src->fetch_block_size = DEFAULT_FETCH_BLOCK_SIZE;
+  src->read_ahead = DEFAULT_READ_AHEAD;
+  src->cache_size = DEFAULT_CACHE_SIZE;
+  src->cache_location = g_strdup (DEFAULT_CACHE_LOCATION);
   src->minimum_blocksize = gst_base_src_get_blocksize (GST_BASE_SRC_CAST (src));
   proxy = g_getenv ("http_proxy");
   if (!gst_soup_http_src_set_proxy (src, proxy)) {
@@ -566,6 +665,8 @@ gst_soup_http_src_finalize (GObject * gobject)
   if (src->tls_interaction)
     g_object_unref (src->tls_interaction);
 
+  g_free (src->cache_location);
+
   G_OBJECT_CLASS (parent_class)->finalize (gobject);
 }
 
@@ -682,6 +783,22 @@ gst_soup_http_src_set_property (GObject * object, guint prop_id,
       g_free (src->method);
       src->method = g_value_dup_string (value);
       break;
+    case PROP_PARALLEL_CONNECTIONS:
+      src->parallel_connections = g_value_get_uint (value);
+      break;
+    case PROP_FETCH_BLOCK_SIZE:
+      src->fetch_block_size = g_value_get_uint (value);
+      break;
+    case PROP_READ_AHEAD:
+      src->read_ahead = g_value_get_uint (value);
+      break;
+    case PROP_CACHE_SIZE:
+      src->cache_size = g_value_get_uint64 (value);
+      break;
+    case PROP_CACHE_LOCATION:
+      g_free (src->cache_location);
+      src->cache_location = g_value_dup_string (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -773,6 +890,21 @@ gst_soup_http_src_get_property (GObject * object, guint prop_id,
     case PROP_METHOD:
       g_value_set_string (value, src->method);
       break;
+    case PROP_PARALLEL_CONNECTIONS:
+      g_value_set_uint (value, src->parallel_connections);
+      break;
+    case PROP_FETCH_BLOCK_SIZE:
+      g_value_set_uint (value, src->fetch_block_size);
+      break;
+    case PROP_READ_AHEAD:
+      g_value_set_uint (value, src->read_ahead);
+      break;
+    case PROP_CACHE_SIZE:
+      g_value_set_uint64 (value, src->cache_size);
+      break;
+    case PROP_CACHE_LOCATION:
+      g_value_set_string (value, src->cache_location);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -823,10 +955,17 @@ gst_soup_http_src_add_range_header (GstSoupHTTPSrc * src, guint64 offset,
   return TRUE;
 }
 
+typedef struct
+{
+  GstSoupHTTPSrc *src;
+  SoupMessage *msg;
+} ExtraHeadersData;
+
 static gboolean
 _append_extra_header (GQuark field_id, const GValue * value, gpointer user_data)
 {
-  GstSoupHTTPSrc *src = GST_SOUP_HTTP_SRC (user_data);
+  ExtraHeadersData *data = user_data;
+  GstSoupHTTPSrc *src = data->src;
   const gchar *field_name = g_quark_to_string (field_id);
   gchar *field_content = NULL;
 
@@ -849,7 +988,7 @@ _append_extra_header (GQuark field_id, const GValue * value, gpointer user_data)
 
   GST_DEBUG_OBJECT (src, "Appending extra header: \"%s: %s\"", field_name,
       field_content);
-  soup_message_headers_append (src->msg->request_headers, field_name,
+  soup_message_headers_append (data->msg->request_headers, field_name,
       field_content);
 
   g_free (field_content);
@@ -890,12 +1029,17 @@ _append_extra_headers (GQuark field_id, const GValue * value,
 
 
 static gboolean
-gst_soup_http_src_add_extra_headers (GstSoupHTTPSrc * src)
+gst_soup_http_src_add_extra_headers (GstSoupHTTPSrc * src, SoupMessage * msg)
 {
+  ExtraHeadersData data;
+
   if (!src->extra_headers)
     return TRUE;
 
-  return gst_structure_foreach (src->extra_headers, _append_extra_headers, src);
+  data.src = src;
+  data.msg = msg;
+  return gst_structure_foreach (src->extra_headers, _append_extra_headers,
+      &data);
 }
 
 static gboolean
@@ -919,7 +1063,8 @@ gst_soup_http_src_session_open (GstSoupHTTPSrc * src)
         && (src->tls_interaction == NULL) && (src->proxy == NULL)
         && (src->tls_database == DEFAULT_TLS_DATABASE)
         && (src->ssl_ca_file == DEFAULT_SSL_CA_FILE)
-        && (src->ssl_use_system_ca_file == DEFAULT_SSL_USE_SYSTEM_CA_FILE);
+        && (src->ssl_use_system_ca_file == DEFAULT_SSL_USE_SYSTEM_CA_FILE)
+        && (src->parallel_connections == DEFAULT_PARALLEL_CONNECTIONS);
 
     query = gst_query_new_context (GST_SOUP_SESSION_CONTEXT);
     if (gst_pad_peer_query (GST_BASE_SRC_PAD (src), query)) {
@@ -1009,6 +1154,11 @@ gst_soup_http_src_session_open (GstSoupHTTPSrc * src)
         G_CALLBACK (gst_soup_http_src_authenticate_cb), src);
 
     if (!src->session_is_shared) {
+      /* one more for the request that is made before fetching blocks */
+      if (src->parallel_connections > 0)
+        g_object_set (src->session, SOUP_SESSION_MAX_CONNS_PER_HOST,
+            src->parallel_connections + 1, NULL);
+
       if (src->tls_database)
         g_object_set (src->session, "tls-database", src->tls_database, NULL);
       else if (src->ssl_ca_file)
@@ -1030,6 +1180,8 @@ gst_soup_http_src_session_close (GstSoupHTTPSrc * src)
 {
   GST_DEBUG_OBJECT (src, "Closing session");
 
+  gst_soup_http_src_stop_fetcher (src);
+
   g_mutex_lock (&src->mutex);
   if (src->msg) {
     soup_session_cancel_message (src->session, src->msg, SOUP_STATUS_CANCELLED);
@@ -1054,7 +1206,8 @@ gst_soup_http_src_authenticate_cb (SoupSession * session, SoupMessage * msg,
     SoupAuth * auth, gboolean retrying, GstSoupHTTPSrc * src)
 {
   /* Might be from another user of the shared session */
-  if (!GST_IS_SOUP_HTTP_SRC (src) || msg != src->msg)
+  if (!GST_IS_SOUP_HTTP_SRC (src) || (msg != src->msg &&
+          g_object_get_data (G_OBJECT (msg), "souphttpsrc-block") != src))
     return;
 
   if (!retrying) {
@@ -1439,17 +1592,16 @@ gst_soup_http_src_restarted_cb (SoupMessage * msg, GstSoupHTTPSrc * src)
   }
 }
 
-static gboolean
-gst_soup_http_src_build_message (GstSoupHTTPSrc * src, const gchar * method)
+/* create a message for @uri with the headers configured on @src */
+static SoupMessage *
+gst_soup_http_src_new_message (GstSoupHTTPSrc * src, const gchar * method,
+    const gchar * uri)
 {
-  g_return_val_if_fail (src->msg == NULL, FALSE);
+  SoupMessage *msg;
 
-  src->msg = soup_message_new (method, src->location);
-  if (!src->msg) {
-    GST_ELEMENT_ERROR (src, RESOURCE, OPEN_READ,
-        ("Error parsing URL."), ("URL: %s", src->location));
-    return FALSE;
-  }
+  msg = soup_message_new (method, uri);
+  if (!msg)
+    return NULL;
 
   /* Duplicating the defaults of libsoup here. We don't want to set a
    * User-Agent in the session as each source might have its own User-Agent
@@ -1458,44 +1610,58 @@ gst_soup_http_src_build_message (GstSoupHTTPSrc * src, const gchar * method)
     gchar *user_agent =
         g_strdup_printf ("libsoup/%u.%u.%u", soup_get_major_version (),
         soup_get_minor_version (), soup_get_micro_version ());
-    soup_message_headers_append (src->msg->request_headers, "User-Agent",
+    soup_message_headers_append (msg->request_headers, "User-Agent",
         user_agent);
     g_free (user_agent);
   } else if (g_str_has_suffix (src->user_agent, " ")) {
     gchar *user_agent = g_strdup_printf ("%slibsoup/%u.%u.%u", src->user_agent,
         soup_get_major_version (),
         soup_get_minor_version (), soup_get_micro_version ());
-    soup_message_headers_append (src->msg->request_headers, "User-Agent",
+    soup_message_headers_append (msg->request_headers, "User-Agent",
         user_agent);
     g_free (user_agent);
   } else {
-    soup_message_headers_append (src->msg->request_headers, "User-Agent",
+    soup_message_headers_append (msg->request_headers, "User-Agent",
         src->user_agent);
   }
 
   if (!src->keep_alive) {
-    soup_message_headers_append (src->msg->request_headers, "Connection",
-        "close");
+    soup_message_headers_append (msg->request_headers, "Connection", "close");
   }
   if (src->iradio_mode) {
-    soup_message_headers_append (src->msg->request_headers, "icy-metadata",
-        "1");
+    soup_message_headers_append (msg->request_headers, "icy-metadata", "1");
   }
   if (src->cookies) {
     gchar **cookie;
 
     for (cookie = src->cookies; *cookie != NULL; cookie++) {
-      soup_message_headers_append (src->msg->request_headers, "Cookie",
-          *cookie);
+      soup_message_headers_append (msg->request_headers, "Cookie", *cookie);
     }
   }
 
   if (!src->compress)
-    soup_message_disable_feature (src->msg, SOUP_TYPE_CONTENT_DECODER);
+    soup_message_disable_feature (msg, SOUP_TYPE_CONTENT_DECODER);
 
-  soup_message_set_flags (src->msg, SOUP_MESSAGE_OVERWRITE_CHUNKS |
+  soup_message_set_flags (msg, SOUP_MESSAGE_OVERWRITE_CHUNKS |
       (src->automatic_redirect ? 0 : SOUP_MESSAGE_NO_REDIRECT));
 
+  gst_soup_http_src_add_extra_headers (src, msg);
+
+  return msg;
+}
+
+static gboolean
+gst_soup_http_src_build_message (GstSoupHTTPSrc * src, const gchar * method)
+{
+  g_return_val_if_fail (src->msg == NULL, FALSE);
+
+  src->msg = gst_soup_http_src_new_message (src, method, src->location);
+  if (!src->msg) {
+    GST_ELEMENT_ERROR (src, RESOURCE, OPEN_READ,
+        ("Error parsing URL."), ("URL: %s", src->location));
+    return FALSE;
+  }
+
   if (src->automatic_redirect) {
     g_signal_connect (src->msg, "restarted",
         G_CALLBACK (gst_soup_http_src_restarted_cb), src);
@@ -1504,8 +1670,6 @@ gst_soup_http_src_build_message (GstSoupHTTPSrc * src, const gchar * method)
   gst_soup_http_src_add_range_header (src, src->request_position,
       src->stop_position);
 
-  gst_soup_http_src_add_extra_headers (src);
-
   return TRUE;
 }
 
@@ -1753,6 +1917,408 @@ gst_soup_http_src_read_buffer (GstSoupHTTPSrc * src, GstBuffer ** outbuf)
   return ret;
 }
 
+struct _GstSoupHTTPFetcher
+{
+  GstSoupHTTPSrc *src;
+  SoupSession *session;
+  gchar *uri;
+  GstSoupBlockCache *cache;
+  GCancellable *cancellable;
+  GThread **threads;
+  guint n_threads;
+
+  GMutex lock;
+  GCond cond;
+  /* the block at the read position, blocks are fetched from here on */
+  guint position;
+  guint read_ahead;
+  gint failures;
+  gchar *error;
+  /* a block was fetched, the server does range requests */
+  gboolean fetched;
+  /* the server answered the first range requests without a range */
+  gboolean no_ranges;
+  gboolean stopping;
+};
+
+/* fetch block @index of the resource with a range request */
+static GstBuffer *
+gst_soup_http_fetcher_fetch (GstSoupHTTPFetcher * fetcher, guint index,
+    GError ** error)
+{
+  GstSoupHTTPSrc *src = fetcher->src;
+  SoupMessage *msg;
+  GInputStream *stream;
+  GstBuffer *buffer = NULL;
+  GstMapInfo map;
+  guint64 start, stop;
+  gsize n_read = 0;
+  gboolean res;
+
+  gst_soup_block_cache_get_range (fetcher->cache, index, &start, &stop);
+
+  msg = gst_soup_http_src_new_message (src, SOUP_METHOD_GET, fetcher->uri);
+  if (!msg) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_ARGUMENT,
+        "Error parsing URL");
+    return NULL;
+  }
+  soup_message_headers_set_range (msg->request_headers, start, stop - 1);
+  /* to let the authenticate callback know it's ours */
+  g_object_set_data (G_OBJECT (msg), "souphttpsrc-block", src);
+
+  GST_LOG_OBJECT (src, "fetching block %u (%" G_GUINT64_FORMAT "-%"
+      G_GUINT64_FORMAT ")", index, start, stop);
+
+  stream = soup_session_send (fetcher->session, msg, fetcher->cancellable,
+      error);
+  if (!stream)
+    goto done;
+
+  if (msg->status_code != SOUP_STATUS_PARTIAL_CONTENT) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED,
+        "Range request failed: %u %s", msg->status_code,
+        GST_STR_NULL (msg->reason_phrase));
+    goto done;
+  }
+
+  buffer = gst_buffer_new_allocate (NULL, stop - start, NULL);
+  gst_buffer_map (buffer, &map, GST_MAP_WRITE);
+  res = g_input_stream_read_all (stream, map.data, map.size, &n_read,
+      fetcher->cancellable, error);
+  gst_buffer_unmap (buffer, &map);
+
+  if (res && n_read != stop - start) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_PARTIAL_INPUT,
+        "Got %" G_GSIZE_FORMAT " of %" G_GUINT64_FORMAT " bytes", n_read,
+        stop - start);
+    res = FALSE;
+  }
+
+  if (res) {
+    guint8 tmp[128];
+
+    /* read the end of the body, so that libsoup can reuse the connection */
+    if (g_input_stream_read (stream, tmp, sizeof (tmp), fetcher->cancellable,
+            NULL) > 0)
+      GST_WARNING_OBJECT (src, "Read bytes after end of range");
+  } else {
+    gst_buffer_unref (buffer);
+    buffer = NULL;
+  }
+
+done:
+  if (stream) {
+    g_input_stream_close (stream, NULL, NULL);
+    g_object_unref (stream);
+  }
+  g_object_unref (msg);
+
+  return buffer;
+}
+
+static gpointer
+gst_soup_http_fetcher_run (GstSoupHTTPFetcher * fetcher)
+{
+  GstSoupHTTPSrc *src = fetcher->src;
+  guint n_blocks = gst_soup_block_cache_get_n_blocks (fetcher->cache);
+
+  g_mutex_lock (&fetcher->lock);
+  while (!fetcher->stopping) {
+    GstBuffer *buffer;
+    GError *err = NULL;
+    guint last, index;
+
+    last = fetcher->position + MIN (fetcher->read_ahead, n_blocks) - 1;
+    if (fetcher->error || fetcher->no_ranges ||
+        !gst_soup_block_cache_claim (fetcher->cache,
+            fetcher->position, last, &index)) {
+      g_cond_wait (&fetcher->cond, &fetcher->lock);
+      continue;
+    }
+    g_mutex_unlock (&fetcher->lock);
+
+    buffer = gst_soup_http_fetcher_fetch (fetcher, index, &err);
+    if (buffer)
+      gst_soup_block_cache_put (fetcher->cache, index, buffer);
+    else
+      gst_soup_block_cache_abandon (fetcher->cache, index);
+
+    g_mutex_lock (&fetcher->lock);
+    if (buffer) {
+      fetcher->failures = 0;
+      fetcher->fetched = TRUE;
+    } else if (!fetcher->stopping && !fetcher->fetched &&
+        g_error_matches (err, G_IO_ERROR, G_IO_ERROR_NOT_SUPPORTED)) {
+      /* Accept-Ranges was not "none" but the range is ignored, download the
+       * resource sequentially instead of failing every block */
+      GST_INFO_OBJECT (src, "Range request for block %u refused, not "
+          "fetching in blocks: %s", index, err->message);
+      fetcher->no_ranges = TRUE;
+    } else if (!fetcher->stopping) {
+      GST_WARNING_OBJECT (src, "Failed to fetch block %u: %s", index,
+          err->message);
+      /* the same retry limit as for the sequential download */
+      fetcher->failures++;
+      if (src->max_retries != -1 && fetcher->failures > src->max_retries)
+        fetcher->error = g_strdup (err->message);
+    }
+    g_clear_error (&err);
+    g_cond_broadcast (&fetcher->cond);
+  }
+  g_mutex_unlock (&fetcher->lock);
+
+  return NULL;
+}
+
+static GstSoupHTTPFetcher *
+gst_soup_http_fetcher_new (GstSoupHTTPSrc * src, GError ** error)
+{
+  GstSoupHTTPFetcher *fetcher;
+  GstSoupBlockCache *cache;
+  guint64 max_memory;
+  guint i;
+
+  /* keep at least the blocks in flight and the ones read ahead in memory */
+  max_memory = MAX (src->cache_size, (guint64) src->fetch_block_size *
+      (src->read_ahead + src->parallel_connections + 1));
+  cache = gst_soup_block_cache_new (src->content_size, src->fetch_block_size,
+      max_memory, src->cache_location, error);
+  if (!cache)
+    return NULL;
+
+  fetcher = g_slice_new0 (GstSoupHTTPFetcher);
+  fetcher->src = src;
+  fetcher->session = g_object_ref (src->session);
+  fetcher->uri = g_strdup (src->redirection_uri ? src->redirection_uri :
+      src->location);
+  fetcher->cache = cache;
+  fetcher->cancellable = g_cancellable_new ();
+  fetcher->read_ahead = src->read_ahead;
+  gst_soup_block_cache_pin (cache, 0, fetcher->read_ahead - 1);
+  g_mutex_init (&fetcher->lock);
+  g_cond_init (&fetcher->cond);
+
+  fetcher->n_threads = src->parallel_connections;
+  fetcher->threads = g_new (GThread *, fetcher->n_threads);
+  for (i = 0; i < fetcher->n_threads; i++)
+    fetcher->threads[i] = g_thread_new ("souphttpsrc-fetch",
+        (GThreadFunc) gst_soup_http_fetcher_run, fetcher);
+
+  GST_INFO_OBJECT (src, "fetching %" G_GUINT64_FORMAT " bytes in blocks of "
+      "%u over %u connections", src->content_size, src->fetch_block_size,
+      fetcher->n_threads);
+
+  return fetcher;
+}
+
+static void
+gst_soup_http_fetcher_free (GstSoupHTTPFetcher * fetcher)
+{
+  guint i;
+
+  g_mutex_lock (&fetcher->lock);
+  fetcher->stopping = TRUE;
+  g_cond_broadcast (&fetcher->cond);
+  g_mutex_unlock (&fetcher->lock);
+  g_cancellable_cancel (fetcher->cancellable);
+
+  for (i = 0; i < fetcher->n_threads; i++)
+    g_thread_join (fetcher->threads[i]);
+  g_free (fetcher->threads);
+
+  gst_soup_block_cache_free (fetcher->cache);
+  g_object_unref (fetcher->cancellable);
+  g_object_unref (fetcher->session);
+  g_free (fetcher->uri);
+  g_free (fetcher->error);
+  g_mutex_clear (&fetcher->lock);
+  g_cond_clear (&fetcher->cond);
+  g_slice_free (GstSoupHTTPFetcher, fetcher);
+}
+
+/* wake up a create() that is waiting for a block, called with the mutex */
+static void
+gst_soup_http_fetcher_wakeup (GstSoupHTTPFetcher * fetcher)
+{
+  g_mutex_lock (&fetcher->lock);
+  g_cond_broadcast (&fetcher->cond);
+  g_mutex_unlock (&fetcher->lock);
+}
+
+static void
+gst_soup_http_src_stop_fetcher (GstSoupHTTPSrc * src)
+{
+  GstSoupHTTPFetcher *fetcher;
+
+  g_mutex_lock (&src->mutex);
+  fetcher = src->fetcher;
+  src->fetcher = NULL;
+  g_mutex_unlock (&src->mutex);
+
+  if (fetcher)
+    gst_soup_http_fetcher_free (fetcher);
+}
+
+/* Find out with a HEAD request if the resource can be fetched in blocks and
+ * start fetching it. Called with the mutex. */
+static void
+gst_soup_http_src_probe_fetcher (GstSoupHTTPSrc * src)
+{
+  GError *err = NULL;
+
+  if (src->method && g_ascii_strcasecmp (src->method, SOUP_METHOD_GET) != 0) {
+    src->fetcher_probed = TRUE;
+    return;
+  }
+
+  /* the length of the encoded content can't be used for ranges */
+  if (src->compress) {
+    src->fetcher_probed = TRUE;
+    return;
+  }
+
+  if (!src->got_headers) {
+    guint64 request_position = src->request_position;
+    guint64 stop_position = src->stop_position;
+    GstFlowReturn ret;
+
+    src->request_position = 0;
+    src->stop_position = -1;
+    ret = gst_soup_http_src_do_request (src, SOUP_METHOD_HEAD);
+    src->request_position = request_position;
+    src->stop_position = stop_position;
+    src->retry_count = 0;
+
+    if (src->input_stream) {
+      g_input_stream_close (src->input_stream, NULL, NULL);
+      g_object_unref (src->input_stream);
+      src->input_stream = NULL;
+    }
+    if (src->msg) {
+      g_object_unref (src->msg);
+      src->msg = NULL;
+    }
+
+    /* try again after the flush */
+    if (ret == GST_FLOW_FLUSHING)
+      return;
+
+    if (ret != GST_FLOW_OK) {
+      /* let the normal request report the error */
+      GST_DEBUG_OBJECT (src, "HEAD request failed, not fetching in blocks");
+      src->got_headers = FALSE;
+      src->have_size = FALSE;
+      src->seekable = FALSE;
+      src->fetcher_probed = TRUE;
+      return;
+    }
+  }
+  src->fetcher_probed = TRUE;
+
+  if (!src->have_size || !src->seekable || src->content_size == 0) {
+    GST_DEBUG_OBJECT (src, "no size or no range requests, not fetching in "
+        "blocks");
+    return;
+  }
+
+  /* a leftover of the seekability check */
+  if (src->input_stream) {
+    g_input_stream_close (src->input_stream, NULL, NULL);
+    g_object_unref (src->input_stream);
+    src->input_stream = NULL;
+  }
+  if (src->msg) {
+    g_object_unref (src->msg);
+    src->msg = NULL;
+  }
+
+  src->fetcher = gst_soup_http_fetcher_new (src, &err);
+  if (!src->fetcher) {
+    GST_ELEMENT_WARNING (src, RESOURCE, OPEN_WRITE, (NULL),
+        ("Not fetching in blocks: %s", err->message));
+    g_clear_error (&err);
+  }
+}
+
+static GstFlowReturn
+gst_soup_http_src_read_block (GstSoupHTTPSrc * src, GstBuffer ** outbuf)
+{
+  GstSoupHTTPFetcher *fetcher = src->fetcher;
+  GstBaseSrc *bsrc = GST_BASE_SRC_CAST (src);
+  GstBuffer *block;
+  guint64 position, end, start, stop;
+  guint block_size, index;
+  gboolean refetch;
+
+  g_mutex_lock (&src->mutex);
+  position = src->request_position;
+  end = src->content_size;
+  if (src->stop_position != -1)
+    end = MIN (end, src->stop_position);
+  g_mutex_unlock (&src->mutex);
+
+  if (position >= end) {
+    GST_DEBUG_OBJECT (src, "EOS at %" G_GUINT64_FORMAT, position);
+    src->have_body = TRUE;
+    return GST_FLOW_EOS;
+  }
+
+  block_size = gst_soup_block_cache_get_block_size (fetcher->cache);
+  index = position / block_size;
+
+  g_mutex_lock (&fetcher->lock);
+  if (fetcher->position != index) {
+    GST_DEBUG_OBJECT (src, "reading block %u", index);
+    fetcher->position = index;
+    gst_soup_block_cache_pin (fetcher->cache, index,
+        index + fetcher->read_ahead - 1);
+    g_cond_broadcast (&fetcher->cond);
+  }
+  while (!(block = gst_soup_block_cache_lookup (fetcher->cache, index,
+              &refetch))) {
+    if (g_cancellable_is_cancelled (src->cancellable)) {
+      g_mutex_unlock (&fetcher->lock);
+      return GST_FLOW_FLUSHING;
+    }
+    if (fetcher->no_ranges) {
+      g_mutex_unlock (&fetcher->lock);
+      return GST_FLOW_CUSTOM_SUCCESS;
+    }
+    if (fetcher->error) {
+      GST_ELEMENT_ERROR (src, RESOURCE, READ,
+          (_("A network error occurred, or the server closed the connection "
+                  "unexpectedly.")), ("%s, URL: %s", fetcher->error,
+              fetcher->uri));
+      g_mutex_unlock (&fetcher->lock);
+      return GST_FLOW_ERROR;
+    }
+    /* it could not be read back from the cache file, let a fetcher thread
+     * claim it again */
+    if (refetch)
+      g_cond_broadcast (&fetcher->cond);
+    GST_LOG_OBJECT (src, "waiting for block %u", index);
+    g_cond_wait (&fetcher->cond, &fetcher->lock);
+  }
+  g_mutex_unlock (&fetcher->lock);
+
+  /* the rest of the block, shared with the cache */
+  gst_soup_block_cache_get_range (fetcher->cache, index, &start, &stop);
+  stop = MIN (stop, end);
+  *outbuf = gst_buffer_copy_region (block, GST_BUFFER_COPY_ALL,
+      position - start, stop - position);
+  gst_buffer_unref (block);
+  GST_BUFFER_OFFSET (*outbuf) = bsrc->segment.position;
+
+  g_mutex_lock (&src->mutex);
+  src->read_position = position;
+  gst_soup_http_src_update_position (src, stop - position);
+  src->retry_count = 0;
+  g_mutex_unlock (&src->mutex);
+
+  return GST_FLOW_OK;
+}
+
 static GstFlowReturn
 gst_soup_http_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
 {
@@ -1765,6 +2331,29 @@ gst_soup_http_src_create (GstPushSrc * psrc, GstBuffer ** outbuf)
 retry:
   g_mutex_lock (&src->mutex);
 
+  if (src->parallel_connections > 0 && !src->fetcher_probed)
+    gst_soup_http_src_probe_fetcher (src);
+
+  if (src->fetcher) {
+    http_headers_event = src->http_headers_event;
+    src->http_headers_event = NULL;
+    g_mutex_unlock (&src->mutex);
+
+    if (http_headers_event) {
+      gst_pad_push_event (GST_BASE_SRC_PAD (src), http_headers_event);
+      http_headers_event = NULL;
+    }
+
+    ret = gst_soup_http_src_read_block (src, outbuf);
+    if (ret == GST_FLOW_CUSTOM_SUCCESS) {
+      /* the server doesn't do range requests after all */
+      gst_soup_http_src_stop_fetcher (src);
+      ret = GST_FLOW_OK;
+      goto retry;
+    }
+    goto done;
+  }
+
   /* Check for pending position change */
   if (src->request_position != src->read_position) {
     if (src->input_stream) {
@@ -1838,6 +2427,7 @@ gst_soup_http_src_stop (GstBaseSrc * bsrc)
 
   src = GST_SOUP_HTTP_SRC (bsrc);
   GST_DEBUG_OBJECT (src, "stop()");
+  gst_soup_http_src_stop_fetcher (src);
   if (src->keep_alive && !src->msg && !src->session_is_shared)
     gst_soup_http_src_cancel_message (src);
   else
@@ -1905,6 +2495,12 @@ gst_soup_http_src_unlock (GstBaseSrc * bsrc)
   GST_DEBUG_OBJECT (src, "unlock()");
 
   gst_soup_http_src_cancel_message (src);
+
+  g_mutex_lock (&src->mutex);
+  if (src->fetcher)
+    gst_soup_http_fetcher_wakeup (src->fetcher);
+  g_mutex_unlock (&src->mutex);
+
   return TRUE;
 }
 
@@ -37,6 +37,7 @@ G_BEGIN_DECLS
 
 typedef struct _GstSoupHTTPSrc GstSoupHTTPSrc;
 typedef struct _GstSoupHTTPSrcClass GstSoupHTTPSrcClass;
+typedef struct _GstSoupHTTPFetcher GstSoupHTTPFetcher;
 
 typedef enum {
   GST_SOUP_HTTP_SRC_SESSION_IO_STATUS_IDLE,
@@ -115,6 +116,16 @@ struct _GstSoupHTTPSrc {
   GCond have_headers_cond;
 
   GstEvent *http_headers_event;
+
+  /* Fetching in blocks over parallel connections */
+  guint parallel_connections;
+  guint fetch_block_size;
+  guint read_ahead;
+  guint64 cache_size;
+  gchar *cache_location;
+  gboolean fetcher_probed;     /* Checked if the resource can be fetched in
+                                  blocks */
+  GstSoupHTTPFetcher *fetcher;
 };
 
 struct _GstSoupHTTPSrcClass {
@@ -308,6 +308,7 @@ gst_alpha_finalize (GObject * object)
 {
   GstAlpha *alpha = GST_ALPHA (object);
 
+  g_free (alpha->key_lut);
   g_mutex_clear (&alpha->lock);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -540,27 +541,26 @@ no_process:
 }
 
 /* based on http://www.cs.utah.edu/~michael/chroma/
+ *
+ * Everything except the luma range check and the final alpha scaling only
+ * depends on the chroma values, so the result is stored in a
+ * GstAlphaKeyEntry which can be precalculated for all (Cb, Cr) pairs.
  */
-static inline gint
-chroma_keying_yuv (gint a, gint * y, gint * u,
-    gint * v, gint cr, gint cb, gint smin, gint smax, guint8 accept_angle_tg,
-    guint8 accept_angle_ctg, guint8 one_over_kc, guint8 kfgy_scale, gint8 kg,
-    guint noise_level2)
+static void
+chroma_keying_uv (gint u, gint v, const GstAlpha * alpha,
+    GstAlphaKeyEntry * entry)
 {
+  gint cb = alpha->cb, cr = alpha->cr;
   gint tmp, tmp1;
   gint x1, y1;
   gint x, z;
   gint b_alpha;
 
-  /* too dark or too bright, keep alpha */
-  if (*y < smin || *y > smax)
-    return a;
-
   /* Convert foreground to XZ coords where X direction is defined by
      the key color */
-  tmp = ((*u) * cb + (*v) * cr) >> 7;
+  tmp = (u * cb + v * cr) >> 7;
   x = CLAMP (tmp, -128, 127);
-  tmp = ((*v) * cb - (*u) * cr) >> 7;
+  tmp = (v * cb - u * cr) >> 7;
   z = CLAMP (tmp, -128, 127);
 
   /* WARNING: accept angle should never be set greater than "somewhat less
@@ -571,49 +571,84 @@ chroma_keying_yuv (gint a, gint * y, gint * u,
      either to avoid infinite ctg (used to suppress foreground without use of
      division) */
 
-  tmp = (x * accept_angle_tg) >> 4;
+  tmp = (x * alpha->accept_angle_tg) >> 4;
   tmp = MIN (tmp, 127);
 
   if (abs (z) > tmp) {
     /* keep foreground Kfg = 0 */
-    return a;
+    entry->keep = TRUE;
+    entry->alpha = 255;
+    entry->y_sub = 0;
+    entry->u = u;
+    entry->v = v;
+    return;
   }
+  entry->keep = FALSE;
+
   /* Compute Kfg (implicitly) and Kbg, suppress foreground in XZ coord
      according to Kfg */
-  tmp = (z * accept_angle_ctg) >> 4;
+  tmp = (z * alpha->accept_angle_ctg) >> 4;
   tmp = CLAMP (tmp, -128, 127);
   x1 = abs (tmp);
   y1 = z;
 
   tmp1 = x - x1;
   tmp1 = MAX (tmp1, 0);
-  b_alpha = (tmp1 * one_over_kc) / 2;
+  b_alpha = (tmp1 * alpha->one_over_kc) / 2;
   b_alpha = 255 - CLAMP (b_alpha, 0, 255);
-  b_alpha = (a * b_alpha) >> 8;
 
-  tmp = (tmp1 * kfgy_scale) >> 4;
-  tmp1 = MIN (tmp, 255);
-
-  *y = (*y < tmp1) ? 0 : *y - tmp1;
+  tmp = (tmp1 * alpha->kfgy_scale) >> 4;
+  entry->y_sub = MIN (tmp, 255);
 
   /* Convert suppressed foreground back to CbCr */
   tmp = (x1 * cb - y1 * cr) >> 7;
-  *u = CLAMP (tmp, -128, 127);
+  entry->u = CLAMP (tmp, -128, 127);
 
   tmp = (x1 * cr + y1 * cb) >> 7;
-  *v = CLAMP (tmp, -128, 127);
+  entry->v = CLAMP (tmp, -128, 127);
 
   /* Deal with noise. For now, a circle around the key color with
      radius of noise_level treated as exact key color. Introduces
      sharp transitions.
    */
-  tmp = z * z + (x - kg) * (x - kg);
+  tmp = z * z + (x - alpha->kg) * (x - alpha->kg);
   tmp = MIN (tmp, 0xffff);
 
-  if (tmp < noise_level2)
+  if (tmp < alpha->noise_level2)
     b_alpha = 0;
 
-  return b_alpha;
+  entry->alpha = b_alpha;
+}
+
+static inline gint
+chroma_keying_yuv (gint a, gint * y, gint * u, gint * v, gint smin, gint smax,
+    const GstAlphaKeyEntry * key_lut, const GstAlpha * alpha)
+{
+  GstAlphaKeyEntry tmp;
+  const GstAlphaKeyEntry *entry;
+
+  /* too dark or too bright, keep alpha */
+  if (*y < smin || *y > smax)
+    return a;
+
+  /* Chroma values outside the table can only happen after a colorimetry
+   * conversion matrix, calculate those directly */
+  if (G_LIKELY (key_lut != NULL && (guint) (*u + 128) < 256
+          && (guint) (*v + 128) < 256)) {
+    entry = &key_lut[((*u + 128) << 8) | (*v + 128)];
+  } else {
+    chroma_keying_uv (*u, *v, alpha, &tmp);
+    entry = &tmp;
+  }
+
+  if (entry->keep)
+    return a;
+
+  *y = (*y < entry->y_sub) ? 0 : *y - entry->y_sub;
+  *u = entry->u;
+  *v = entry->v;
+
+  return (a * entry->alpha) >> 8;
 }
 
 #define APPLY_MATRIX(m,o,v1,v2,v3) ((m[o*4] * v1 + m[o*4+1] * v2 + m[o*4+2] * v3 + m[o*4+3]) >> 8)
@@ -676,13 +711,7 @@ gst_alpha_chroma_key_argb_ayuv (const GstVideoFrame * in_frame,
   gint r, g, b;
   gint smin, smax;
   gint pa = CLAMP ((gint) (alpha->alpha * 256), 0, 256);
-  gint8 cb = alpha->cb, cr = alpha->cr;
-  gint8 kg = alpha->kg;
-  guint8 accept_angle_tg = alpha->accept_angle_tg;
-  guint8 accept_angle_ctg = alpha->accept_angle_ctg;
-  guint8 one_over_kc = alpha->one_over_kc;
-  guint8 kfgy_scale = alpha->kfgy_scale;
-  guint noise_level2 = alpha->noise_level2;
+  const GstAlphaKeyEntry *key_lut = alpha->key_lut;
   gint matrix[12];
   gint o[4];
 
@@ -715,9 +744,7 @@ gst_alpha_chroma_key_argb_ayuv (const GstVideoFrame * in_frame,
       u = APPLY_MATRIX (matrix, 1, r, g, b) - 128;
       v = APPLY_MATRIX (matrix, 2, r, g, b) - 128;
 
-      a = chroma_keying_yuv (a, &y, &u, &v, cr, cb,
-          smin, smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv (a, &y, &u, &v, smin, smax, key_lut, alpha);
 
       u += 128;
       v += 128;
@@ -786,13 +813,7 @@ gst_alpha_chroma_key_argb_argb (const GstVideoFrame * in_frame,
   gint r, g, b;
   gint smin, smax;
   gint pa = CLAMP ((gint) (alpha->alpha * 256), 0, 256);
-  gint8 cb = alpha->cb, cr = alpha->cr;
-  gint8 kg = alpha->kg;
-  guint8 accept_angle_tg = alpha->accept_angle_tg;
-  guint8 accept_angle_ctg = alpha->accept_angle_ctg;
-  guint8 one_over_kc = alpha->one_over_kc;
-  guint8 kfgy_scale = alpha->kfgy_scale;
-  guint noise_level2 = alpha->noise_level2;
+  const GstAlphaKeyEntry *key_lut = alpha->key_lut;
   gint matrix[12], matrix2[12];
   gint p[4], o[4];
 
@@ -829,9 +850,7 @@ gst_alpha_chroma_key_argb_argb (const GstVideoFrame * in_frame,
       u = APPLY_MATRIX (matrix, 1, r, g, b) - 128;
       v = APPLY_MATRIX (matrix, 2, r, g, b) - 128;
 
-      a = chroma_keying_yuv (a, &y, &u, &v, cr, cb,
-          smin, smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv (a, &y, &u, &v, smin, smax, key_lut, alpha);
 
       u += 128;
       v += 128;
@@ -909,13 +928,7 @@ gst_alpha_chroma_key_ayuv_argb (const GstVideoFrame * in_frame,
   gint r, g, b;
   gint smin, smax;
   gint pa = CLAMP ((gint) (alpha->alpha * 256), 0, 256);
-  gint8 cb = alpha->cb, cr = alpha->cr;
-  gint8 kg = alpha->kg;
-  guint8 accept_angle_tg = alpha->accept_angle_tg;
-  guint8 accept_angle_ctg = alpha->accept_angle_ctg;
-  guint8 one_over_kc = alpha->one_over_kc;
-  guint8 kfgy_scale = alpha->kfgy_scale;
-  guint noise_level2 = alpha->noise_level2;
+  const GstAlphaKeyEntry *key_lut = alpha->key_lut;
   gint matrix[12];
   gint p[4];
 
@@ -944,9 +957,7 @@ gst_alpha_chroma_key_ayuv_argb (const GstVideoFrame * in_frame,
       u = src[2] - 128;
       v = src[3] - 128;
 
-      a = chroma_keying_yuv (a, &y, &u, &v, cr, cb,
-          smin, smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv (a, &y, &u, &v, smin, smax, key_lut, alpha);
 
       u += 128;
       v += 128;
@@ -1026,13 +1037,7 @@ gst_alpha_chroma_key_ayuv_ayuv (const GstVideoFrame * in_frame,
   gint a, y, u, v;
   gint smin, smax;
   gint pa = CLAMP ((gint) (alpha->alpha * 256), 0, 256);
-  gint8 cb = alpha->cb, cr = alpha->cr;
-  gint8 kg = alpha->kg;
-  guint8 accept_angle_tg = alpha->accept_angle_tg;
-  guint8 accept_angle_ctg = alpha->accept_angle_ctg;
-  guint8 one_over_kc = alpha->one_over_kc;
-  guint8 kfgy_scale = alpha->kfgy_scale;
-  guint noise_level2 = alpha->noise_level2;
+  const GstAlphaKeyEntry *key_lut = alpha->key_lut;
 
   src = GST_VIDEO_FRAME_PLANE_DATA (in_frame, 0);
   dest = GST_VIDEO_FRAME_PLANE_DATA (out_frame, 0);
@@ -1051,9 +1056,7 @@ gst_alpha_chroma_key_ayuv_ayuv (const GstVideoFrame * in_frame,
         u = src[2] - 128;
         v = src[3] - 128;
 
-        a = chroma_keying_yuv (a, &y, &u, &v, cr, cb,
-            smin, smax, accept_angle_tg, accept_angle_ctg,
-            one_over_kc, kfgy_scale, kg, noise_level2);
+        a = chroma_keying_yuv (a, &y, &u, &v, smin, smax, key_lut, alpha);
 
         u += 128;
         v += 128;
@@ -1081,9 +1084,7 @@ gst_alpha_chroma_key_ayuv_ayuv (const GstVideoFrame * in_frame,
         u = APPLY_MATRIX (matrix, 1, src[1], src[2], src[3]) - 128;
         v = APPLY_MATRIX (matrix, 2, src[1], src[2], src[3]) - 128;
 
-        a = chroma_keying_yuv (a, &y, &u, &v, cr, cb,
-            smin, smax, accept_angle_tg, accept_angle_ctg,
-            one_over_kc, kfgy_scale, kg, noise_level2);
+        a = chroma_keying_yuv (a, &y, &u, &v, smin, smax, key_lut, alpha);
 
         u += 128;
         v += 128;
@@ -1159,13 +1160,7 @@ gst_alpha_chroma_key_rgb_ayuv (const GstVideoFrame * in_frame,
   gint r, g, b;
   gint smin, smax;
   gint pa = CLAMP ((gint) (alpha->alpha * 255), 0, 255);
-  gint8 cb = alpha->cb, cr = alpha->cr;
-  gint8 kg = alpha->kg;
-  guint8 accept_angle_tg = alpha->accept_angle_tg;
-  guint8 accept_angle_ctg = alpha->accept_angle_ctg;
-  guint8 one_over_kc = alpha->one_over_kc;
-  guint8 kfgy_scale = alpha->kfgy_scale;
-  guint noise_level2 = alpha->noise_level2;
+  const GstAlphaKeyEntry *key_lut = alpha->key_lut;
   gint matrix[12];
   gint o[3];
   gint bpp;
@@ -1200,9 +1195,7 @@ gst_alpha_chroma_key_rgb_ayuv (const GstVideoFrame * in_frame,
       u = APPLY_MATRIX (matrix, 1, r, g, b) - 128;
       v = APPLY_MATRIX (matrix, 2, r, g, b) - 128;
 
-      a = chroma_keying_yuv (a, &y, &u, &v, cr, cb,
-          smin, smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv (a, &y, &u, &v, smin, smax, key_lut, alpha);
 
       u += 128;
       v += 128;
@@ -1273,13 +1266,7 @@ gst_alpha_chroma_key_rgb_argb (const GstVideoFrame * in_frame,
   gint r, g, b;
   gint smin, smax;
   gint pa = CLAMP ((gint) (alpha->alpha * 255), 0, 255);
-  gint8 cb = alpha->cb, cr = alpha->cr;
-  gint8 kg = alpha->kg;
-  guint8 accept_angle_tg = alpha->accept_angle_tg;
-  guint8 accept_angle_ctg = alpha->accept_angle_ctg;
-  guint8 one_over_kc = alpha->one_over_kc;
-  guint8 kfgy_scale = alpha->kfgy_scale;
-  guint noise_level2 = alpha->noise_level2;
+  const GstAlphaKeyEntry *key_lut = alpha->key_lut;
   gint matrix[12], matrix2[12];
   gint p[4], o[3];
   gint bpp;
@@ -1318,9 +1305,7 @@ gst_alpha_chroma_key_rgb_argb (const GstVideoFrame * in_frame,
       u = APPLY_MATRIX (matrix, 1, r, g, b) - 128;
       v = APPLY_MATRIX (matrix, 2, r, g, b) - 128;
 
-      a = chroma_keying_yuv (a, &y, &u, &v, cr, cb,
-          smin, smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv (a, &y, &u, &v, smin, smax, key_lut, alpha);
 
       u += 128;
       v += 128;
@@ -1468,13 +1453,7 @@ gst_alpha_chroma_key_planar_yuv_ayuv (const GstVideoFrame * in_frame,
   gint v_subs, h_subs;
   gint smin = 128 - alpha->black_sensitivity;
   gint smax = 128 + alpha->white_sensitivity;
-  gint8 cb = alpha->cb, cr = alpha->cr;
-  gint8 kg = alpha->kg;
-  guint8 accept_angle_tg = alpha->accept_angle_tg;
-  guint8 accept_angle_ctg = alpha->accept_angle_ctg;
-  guint8 one_over_kc = alpha->one_over_kc;
-  guint8 kfgy_scale = alpha->kfgy_scale;
-  guint noise_level2 = alpha->noise_level2;
+  const GstAlphaKeyEntry *key_lut = alpha->key_lut;
 
   dest = GST_VIDEO_FRAME_PLANE_DATA (out_frame, 0);
 
@@ -1517,9 +1496,7 @@ gst_alpha_chroma_key_planar_yuv_ayuv (const GstVideoFrame * in_frame,
         u = srcU[0] - 128;
         v = srcV[0] - 128;
 
-        a = chroma_keying_yuv (a, &y, &u, &v, cr, cb, smin,
-            smax, accept_angle_tg, accept_angle_ctg,
-            one_over_kc, kfgy_scale, kg, noise_level2);
+        a = chroma_keying_yuv (a, &y, &u, &v, smin, smax, key_lut, alpha);
 
         u += 128;
         v += 128;
@@ -1560,9 +1537,7 @@ gst_alpha_chroma_key_planar_yuv_ayuv (const GstVideoFrame * in_frame,
         u = APPLY_MATRIX (matrix, 1, srcY[0], srcU[0], srcV[0]) - 128;
         v = APPLY_MATRIX (matrix, 2, srcY[0], srcU[0], srcV[0]) - 128;
 
-        a = chroma_keying_yuv (a, &y, &u, &v, cr, cb, smin,
-            smax, accept_angle_tg, accept_angle_ctg,
-            one_over_kc, kfgy_scale, kg, noise_level2);
+        a = chroma_keying_yuv (a, &y, &u, &v, smin, smax, key_lut, alpha);
 
         dest[0] = a;
         dest[1] = y;
@@ -1700,13 +1675,7 @@ gst_alpha_chroma_key_planar_yuv_argb (const GstVideoFrame * in_frame,
   gint v_subs, h_subs;
   gint smin = 128 - alpha->black_sensitivity;
   gint smax = 128 + alpha->white_sensitivity;
-  gint8 cb = alpha->cb, cr = alpha->cr;
-  gint8 kg = alpha->kg;
-  guint8 accept_angle_tg = alpha->accept_angle_tg;
-  guint8 accept_angle_ctg = alpha->accept_angle_ctg;
-  guint8 one_over_kc = alpha->one_over_kc;
-  guint8 kfgy_scale = alpha->kfgy_scale;
-  guint noise_level2 = alpha->noise_level2;
+  const GstAlphaKeyEntry *key_lut = alpha->key_lut;
   gint matrix[12];
   gint p[4];
 
@@ -1759,9 +1728,7 @@ gst_alpha_chroma_key_planar_yuv_argb (const GstVideoFrame * in_frame,
       u = srcU[0] - 128;
       v = srcV[0] - 128;
 
-      a = chroma_keying_yuv (a, &y, &u, &v, cr, cb, smin,
-          smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv (a, &y, &u, &v, smin, smax, key_lut, alpha);
 
       u += 128;
       v += 128;
@@ -1926,13 +1893,7 @@ gst_alpha_chroma_key_packed_422_ayuv (const GstVideoFrame * in_frame,
   gint a, y, u, v;
   gint smin, smax;
   gint pa = CLAMP ((gint) (alpha->alpha * 255), 0, 255);
-  gint8 cb = alpha->cb, cr = alpha->cr;
-  gint8 kg = alpha->kg;
-  guint8 accept_angle_tg = alpha->accept_angle_tg;
-  guint8 accept_angle_ctg = alpha->accept_angle_ctg;
-  guint8 one_over_kc = alpha->one_over_kc;
-  guint8 kfgy_scale = alpha->kfgy_scale;
-  guint noise_level2 = alpha->noise_level2;
+  const GstAlphaKeyEntry *key_lut = alpha->key_lut;
   gint p[4];                    /* Y U Y V */
   gint src_stride;
   const guint8 *src_tmp;
@@ -1968,9 +1929,7 @@ gst_alpha_chroma_key_packed_422_ayuv (const GstVideoFrame * in_frame,
         u = APPLY_MATRIX (matrix, 1, src[p[0]], src[p[1]], src[p[3]]) - 128;
         v = APPLY_MATRIX (matrix, 2, src[p[0]], src[p[1]], src[p[3]]) - 128;
 
-        a = chroma_keying_yuv (pa, &y, &u, &v, cr, cb,
-            smin, smax, accept_angle_tg, accept_angle_ctg,
-            one_over_kc, kfgy_scale, kg, noise_level2);
+        a = chroma_keying_yuv (pa, &y, &u, &v, smin, smax, key_lut, alpha);
 
         dest[0] = a;
         dest[1] = y;
@@ -1981,9 +1940,7 @@ gst_alpha_chroma_key_packed_422_ayuv (const GstVideoFrame * in_frame,
         u = APPLY_MATRIX (matrix, 1, src[p[2]], src[p[1]], src[p[3]]) - 128;
         v = APPLY_MATRIX (matrix, 2, src[p[2]], src[p[1]], src[p[3]]) - 128;
 
-        a = chroma_keying_yuv (pa, &y, &u, &v, cr, cb,
-            smin, smax, accept_angle_tg, accept_angle_ctg,
-            one_over_kc, kfgy_scale, kg, noise_level2);
+        a = chroma_keying_yuv (pa, &y, &u, &v, smin, smax, key_lut, alpha);
 
         dest[4] = a;
         dest[5] = y;
@@ -1999,9 +1956,7 @@ gst_alpha_chroma_key_packed_422_ayuv (const GstVideoFrame * in_frame,
         u = APPLY_MATRIX (matrix, 1, src[p[0]], src[p[1]], src[p[3]]) - 128;
         v = APPLY_MATRIX (matrix, 2, src[p[0]], src[p[1]], src[p[3]]) - 128;
 
-        a = chroma_keying_yuv (pa, &y, &u, &v, cr, cb,
-            smin, smax, accept_angle_tg, accept_angle_ctg,
-            one_over_kc, kfgy_scale, kg, noise_level2);
+        a = chroma_keying_yuv (pa, &y, &u, &v, smin, smax, key_lut, alpha);
 
         dest[0] = a;
         dest[1] = y;
@@ -2022,9 +1977,7 @@ gst_alpha_chroma_key_packed_422_ayuv (const GstVideoFrame * in_frame,
         u = src[p[1]] - 128;
         v = src[p[3]] - 128;
 
-        a = chroma_keying_yuv (pa, &y, &u, &v, cr, cb,
-            smin, smax, accept_angle_tg, accept_angle_ctg,
-            one_over_kc, kfgy_scale, kg, noise_level2);
+        a = chroma_keying_yuv (pa, &y, &u, &v, smin, smax, key_lut, alpha);
 
         dest[0] = a;
         dest[1] = y;
@@ -2035,9 +1988,7 @@ gst_alpha_chroma_key_packed_422_ayuv (const GstVideoFrame * in_frame,
         u = src[p[1]] - 128;
         v = src[p[3]] - 128;
 
-        a = chroma_keying_yuv (pa, &y, &u, &v, cr, cb,
-            smin, smax, accept_angle_tg, accept_angle_ctg,
-            one_over_kc, kfgy_scale, kg, noise_level2);
+        a = chroma_keying_yuv (pa, &y, &u, &v, smin, smax, key_lut, alpha);
 
         dest[4] = a;
         dest[5] = y;
@@ -2053,9 +2004,7 @@ gst_alpha_chroma_key_packed_422_ayuv (const GstVideoFrame * in_frame,
         u = src[p[1]] - 128;
         v = src[p[3]] - 128;
 
-        a = chroma_keying_yuv (pa, &y, &u, &v, cr, cb,
-            smin, smax, accept_angle_tg, accept_angle_ctg,
-            one_over_kc, kfgy_scale, kg, noise_level2);
+        a = chroma_keying_yuv (pa, &y, &u, &v, smin, smax, key_lut, alpha);
 
         dest[0] = a;
         dest[1] = y;
@@ -2162,13 +2111,7 @@ gst_alpha_chroma_key_packed_422_argb (const GstVideoFrame * in_frame,
   gint r, g, b;
   gint smin, smax;
   gint pa = CLAMP ((gint) (alpha->alpha * 255), 0, 255);
-  gint8 cb = alpha->cb, cr = alpha->cr;
-  gint8 kg = alpha->kg;
-  guint8 accept_angle_tg = alpha->accept_angle_tg;
-  guint8 accept_angle_ctg = alpha->accept_angle_ctg;
-  guint8 one_over_kc = alpha->one_over_kc;
-  guint8 kfgy_scale = alpha->kfgy_scale;
-  guint noise_level2 = alpha->noise_level2;
+  const GstAlphaKeyEntry *key_lut = alpha->key_lut;
   gint p[4], o[4];
   gint src_stride;
   const guint8 *src_tmp;
@@ -2207,9 +2150,7 @@ gst_alpha_chroma_key_packed_422_argb (const GstVideoFrame * in_frame,
       u = src[o[1]] - 128;
       v = src[o[3]] - 128;
 
-      a = chroma_keying_yuv (pa, &y, &u, &v, cr, cb,
-          smin, smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv (pa, &y, &u, &v, smin, smax, key_lut, alpha);
       u += 128;
       v += 128;
 
@@ -2226,9 +2167,7 @@ gst_alpha_chroma_key_packed_422_argb (const GstVideoFrame * in_frame,
       u = src[o[1]] - 128;
       v = src[o[3]] - 128;
 
-      a = chroma_keying_yuv (pa, &y, &u, &v, cr, cb,
-          smin, smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv (pa, &y, &u, &v, smin, smax, key_lut, alpha);
       u += 128;
       v += 128;
 
@@ -2250,9 +2189,7 @@ gst_alpha_chroma_key_packed_422_argb (const GstVideoFrame * in_frame,
       u = src[o[1]] - 128;
       v = src[o[3]] - 128;
 
-      a = chroma_keying_yuv (pa, &y, &u, &v, cr, cb,
-          smin, smax, accept_angle_tg, accept_angle_ctg,
-          one_over_kc, kfgy_scale, kg, noise_level2);
+      a = chroma_keying_yuv (pa, &y, &u, &v, smin, smax, key_lut, alpha);
       u += 128;
       v += 128;
 
@@ -2272,6 +2209,52 @@ gst_alpha_chroma_key_packed_422_argb (const GstVideoFrame * in_frame,
   }
 }
 
+static void
+gst_alpha_get_key_params (const GstAlpha * alpha, GstAlphaKeyParams * params)
+{
+  params->cb = alpha->cb;
+  params->cr = alpha->cr;
+  params->kg = alpha->kg;
+  params->accept_angle_tg = alpha->accept_angle_tg;
+  params->accept_angle_ctg = alpha->accept_angle_ctg;
+  params->one_over_kc = alpha->one_over_kc;
+  params->kfgy_scale = alpha->kfgy_scale;
+  params->noise_level2 = alpha->noise_level2;
+}
+
+static gboolean
+gst_alpha_key_params_equal (const GstAlphaKeyParams * a,
+    const GstAlphaKeyParams * b)
+{
+  return a->cb == b->cb && a->cr == b->cr && a->kg == b->kg
+      && a->accept_angle_tg == b->accept_angle_tg
+      && a->accept_angle_ctg == b->accept_angle_ctg
+      && a->one_over_kc == b->one_over_kc
+      && a->kfgy_scale == b->kfgy_scale
+      && a->noise_level2 == b->noise_level2;
+}
+
+/* Protected with the alpha lock */
+static void
+gst_alpha_init_key_lut (GstAlpha * alpha)
+{
+  gint u, v;
+
+  GST_DEBUG_OBJECT (alpha, "Calculating chroma keying table");
+
+  gst_alpha_get_key_params (alpha, &alpha->key_lut_params);
+
+  if (alpha->key_lut == NULL)
+    alpha->key_lut = g_new (GstAlphaKeyEntry, 256 * 256);
+
+  for (u = -128; u < 128; u++) {
+    for (v = -128; v < 128; v++) {
+      chroma_keying_uv (u, v, alpha,
+          &alpha->key_lut[((u + 128) << 8) | (v + 128)]);
+    }
+  }
+}
+
 /* Protected with the alpha lock */
 static void
 gst_alpha_init_params_full (GstAlpha * alpha,
@@ -2285,6 +2268,7 @@ gst_alpha_init_params_full (GstAlpha * alpha,
   guint target_g = alpha->target_g;
   guint target_b = alpha->target_b;
   const gint *matrix;
+  GstAlphaKeyParams params;
 
   switch (alpha->method) {
     case ALPHA_METHOD_GREEN:
@@ -2355,6 +2339,13 @@ gst_alpha_init_params_full (GstAlpha * alpha,
   alpha->kg = MIN (kgl, 127);
 
   alpha->noise_level2 = alpha->noise_level * alpha->noise_level;
+
+  /* Controlled properties are set again for every buffer, only
+   * recalculate the table if it was made for other keying parameters */
+  gst_alpha_get_key_params (alpha, &params);
+  if (alpha->method != ALPHA_METHOD_SET && (alpha->key_lut == NULL
+          || !gst_alpha_key_params_equal (&params, &alpha->key_lut_params)))
+    gst_alpha_init_key_lut (alpha);
 }
 
 static void
@@ -59,6 +59,28 @@ typedef enum
 }
 GstAlphaMethod;
 
+/* Precalculated chroma keying result for one (Cb, Cr) pair, see
+ * gst_alpha_init_key_lut() */
+typedef struct
+{
+  guint8 keep;                  /* keep foreground, alpha unchanged */
+  guint8 alpha;                 /* background alpha scale, 0-255 */
+  guint8 y_sub;                 /* luma suppression */
+  gint8 u, v;                   /* suppressed chroma */
+} GstAlphaKeyEntry;
+
+/* The keying parameters a #GstAlphaKeyEntry table was calculated for */
+typedef struct
+{
+  gint8 cb, cr;
+  gint8 kg;
+  guint8 accept_angle_tg;
+  guint8 accept_angle_ctg;
+  guint8 one_over_kc;
+  guint8 kfgy_scale;
+  guint noise_level2;
+} GstAlphaKeyParams;
+
 GST_DEBUG_CATEGORY_STATIC (gst_alpha_debug);
 #define GST_CAT_DEFAULT gst_alpha_debug
 
@@ -100,6 +122,11 @@ struct _GstAlpha
   guint8 one_over_kc;
   guint8 kfgy_scale;
   guint noise_level2;
+
+  /* chroma keying results for all 256x256 (Cb, Cr) pairs, NULL
+   * if not chroma keying */
+  GstAlphaKeyEntry *key_lut;
+  GstAlphaKeyParams key_lut_params;
 };
 
 struct _GstAlphaClass
@@ -50,11 +50,13 @@ enum
 {
   PROP_0 = 0,
   PROP_LOW_LATENCY,
-  PROP_DRAIN_ON_CHANGES
+  PROP_DRAIN_ON_CHANGES,
+  PROP_MAX_FFT_LATENCY
 };
 
 #define DEFAULT_LOW_LATENCY FALSE
 #define DEFAULT_DRAIN_ON_CHANGES TRUE
+#define DEFAULT_MAX_FFT_LATENCY 0
 
 #define gst_audio_fx_base_fir_filter_parent_class parent_class
 G_DEFINE_TYPE (GstAudioFXBaseFIRFilter, gst_audio_fx_base_fir_filter,
@@ -362,7 +364,230 @@ DEFINE_FFT_PROCESS_FUNC_FIXED_CHANNELS (64, 2, double);
 #undef DEFINE_FFT_PROCESS_FUNC
 #undef DEFINE_FFT_PROCESS_FUNC_FIXED_CHANNELS
 
+/* This implements uniformly partitioned FFT convolution, again using the
+ * overlap-save algorithm from above.
+ *
+ * With a single FFT block the block length has to be a multiple of the
+ * kernel length, which for kernels of many thousand samples (e.g. room
+ * impulse responses) means a latency of a multiple of the kernel length
+ * and very expensive passes every now and then. Instead the kernel is
+ * split into P partitions h_0 ... h_{P-1} of length L each:
+ *
+ * y[t] = \sum_{p=0}^{P-1} \sum_{u=0}^{L-1} x[t - pL - u] * h_p[u]
+ *
+ * Every partition is convolved with the input delayed by p blocks of
+ * length L. The FFT of every input block of length 2L (the last and the
+ * current L input samples) is only calculated once and then kept in a
+ * frequency-domain delay line, so that every pass calculates
+ *
+ * y = IFFT (\sum_{p=0}^{P-1} FFT(x_{-p}) * FFT(h_p))
+ *
+ * of which the last L samples are the output for the current block.
+ * This gives a latency of L samples independent of the kernel length and
+ * per block one FFT and one inverse FFT of length 2L per channel plus P
+ * complex multiply-adds per frequency bin.
+ *
+ * All channels are processed in the same pass so that the spectrum of
+ * every partition only has to be read once per block.
+ */
+#define DEFINE_PARTITIONED_PROCESS_FUNC(width,ctype) \
+static guint \
+process_partitioned_##width (GstAudioFXBaseFIRFilter * self, \
+    const g##ctype * src, g##ctype * dst, guint input_samples) \
+{ \
+  gint channels = GST_AUDIO_FILTER_CHANNELS (self); \
+  PARTITIONED_CONVOLUTION_BODY (channels); \
+}
+
+#define DEFINE_PARTITIONED_PROCESS_FUNC_FIXED_CHANNELS(width,channels,ctype) \
+static guint \
+process_partitioned_##channels##_##width (GstAudioFXBaseFIRFilter * self, \
+    const g##ctype * src, g##ctype * dst, guint input_samples) \
+{ \
+  PARTITIONED_CONVOLUTION_BODY (channels); \
+}
+
+#define PARTITIONED_CONVOLUTION_BODY(channels) G_STMT_START { \
+  gint i, j; \
+  guint p, pass; \
+  guint partition_length = self->partition_length; \
+  guint partitions = self->partitions; \
+  guint block_length = self->block_length; \
+  guint buffer_fill = self->buffer_fill; \
+  guint fdl_pos = self->fdl_pos; \
+  GstFFTF64 *fft = self->fft; \
+  GstFFTF64 *ifft = self->ifft; \
+  GstFFTF64Complex *frequency_response = self->frequency_response; \
+  guint frequency_response_length = self->frequency_response_length; \
+  GstFFTF64Complex *fft_buffer = self->fft_buffer; \
+  GstFFTF64Complex *fdl = self->fdl; \
+  gdouble *buffer = self->buffer; \
+  guint generated = 0; \
+  gdouble re, im; \
+  \
+  /* Buffer contains for every channel the input samples of the last \
+   * and the current block, followed by the same amount of space for \
+   * the inverse FFT below. The FFT buffer contains the output spectrum \
+   * of every channel and the delay line the input spectra, both depend \
+   * on the number of channels and are reallocated with the buffer. A new \
+   * kernel frees the FFT buffer but can keep the buffer and delay line. \
+   */ \
+  if (!buffer) { \
+    self->buffer_length = block_length; \
+    self->buffer = buffer = g_new0 (gdouble, 2 * block_length * channels); \
+    \
+    /* The last block is all zeroes at the beginning */ \
+    self->buffer_fill = buffer_fill = partition_length; \
+    \
+    g_free (self->fft_buffer); \
+    self->fft_buffer = fft_buffer = NULL; \
+    g_free (self->fdl); \
+    self->fdl = fdl = NULL; \
+  } \
+  \
+  if (!fft_buffer) \
+    self->fft_buffer = fft_buffer = \
+        g_new (GstFFTF64Complex, frequency_response_length * channels); \
+  \
+  if (!fdl) { \
+    self->fdl = fdl = g_new0 (GstFFTF64Complex, \
+        frequency_response_length * channels * partitions); \
+    self->fdl_pos = fdl_pos = 0; \
+  } \
+  \
+  g_assert (self->buffer_length == block_length); \
+  \
+  while (input_samples) { \
+    pass = MIN (block_length - buffer_fill, input_samples); \
+    \
+    /* Deinterleave channels */ \
+    for (i = 0; i < pass; i++) { \
+      for (j = 0; j < channels; j++) { \
+        buffer[2 * block_length * j + buffer_fill + i] = \
+            src[i * channels + j]; \
+      } \
+    } \
+    buffer_fill += pass; \
+    src += channels * pass; \
+    input_samples -= pass; \
+    \
+    /* If we don't have a complete block go out */ \
+    if (buffer_fill < block_length) \
+      break; \
+    \
+    /* The oldest spectra in the delay line are replaced by the new ones */ \
+    fdl_pos = (fdl_pos + partitions - 1) % partitions; \
+    for (j = 0; j < channels; j++) { \
+      gst_fft_f64_fft (fft, buffer + 2 * block_length * j, \
+          fdl + (fdl_pos * channels + j) * frequency_response_length); \
+      \
+      /* The current block is the last block for the next pass */ \
+      memcpy (buffer + 2 * block_length * j, \
+          buffer + 2 * block_length * j + partition_length, \
+          partition_length * sizeof (gdouble)); \
+    } \
+    \
+    /* Complex multiplication of every partition's spectrum with the \
+     * spectrum of the input block delayed by as many blocks, summed up \
+     * for all partitions */ \
+    memset (fft_buffer, 0, \
+        frequency_response_length * channels * sizeof (GstFFTF64Complex)); \
+    for (p = 0; p < partitions; p++) { \
+      GstFFTF64Complex *h = frequency_response + \
+          p * frequency_response_length; \
+      GstFFTF64Complex *x = fdl + ((fdl_pos + p) % partitions) * channels * \
+          frequency_response_length; \
+      \
+      for (j = 0; j < channels; j++) { \
+        GstFFTF64Complex *y = fft_buffer + j * frequency_response_length; \
+        \
+        for (i = 0; i < frequency_response_length; i++) { \
+          re = x[i].r; \
+          im = x[i].i; \
+          \
+          y[i].r += re * h[i].r - im * h[i].i; \
+          y[i].i += re * h[i].i + im * h[i].r; \
+        } \
+        x += frequency_response_length; \
+      } \
+    } \
+    \
+    for (j = 0; j < channels; j++) { \
+      gdouble *out = buffer + 2 * block_length * j + block_length; \
+      \
+      /* Calculate inverse FFT of the result */ \
+      gst_fft_f64_inverse_fft (ifft, \
+          fft_buffer + j * frequency_response_length, out); \
+      \
+      /* Only the last partition_length samples are valid output */ \
+      for (i = 0; i < partition_length; i++) \
+        dst[i * channels + j] = out[partition_length + i]; \
+    } \
+    \
+    generated += partition_length; \
+    dst += channels * partition_length; \
+    \
+    buffer_fill = partition_length; \
+  } \
+  \
+  /* Write back cached values */ \
+  self->buffer_fill = buffer_fill; \
+  self->fdl_pos = fdl_pos; \
+  \
+  return generated; \
+} G_STMT_END
+
+DEFINE_PARTITIONED_PROCESS_FUNC (32, float);
+DEFINE_PARTITIONED_PROCESS_FUNC (64, double);
+
+DEFINE_PARTITIONED_PROCESS_FUNC_FIXED_CHANNELS (32, 1, float);
+DEFINE_PARTITIONED_PROCESS_FUNC_FIXED_CHANNELS (64, 1, double);
+
+DEFINE_PARTITIONED_PROCESS_FUNC_FIXED_CHANNELS (32, 2, float);
+DEFINE_PARTITIONED_PROCESS_FUNC_FIXED_CHANNELS (64, 2, double);
+
+#undef PARTITIONED_CONVOLUTION_BODY
+#undef DEFINE_PARTITIONED_PROCESS_FUNC
+#undef DEFINE_PARTITIONED_PROCESS_FUNC_FIXED_CHANNELS
+
 /* Element class */
+
+/* Returns the partition length for partitioned FFT convolution of a kernel
+ * of the given length, or 0 if it is not partitioned */
+static guint
+gst_audio_fx_base_fir_filter_get_partition_length (GstAudioFXBaseFIRFilter *
+    self, guint kernel_length)
+{
+  guint block_length, partition_length;
+
+  if (self->low_latency || kernel_length < FFT_THRESHOLD
+      || self->max_fft_latency == 0)
+    return 0;
+
+  /* A single block is fine if it stays within the latency budget */
+  block_length = gst_fft_next_fast_length (4 * kernel_length);
+  if (block_length - kernel_length + 1 <= self->max_fft_latency)
+    return 0;
+
+  /* Otherwise use the largest power of two that still fits */
+  partition_length = FFT_THRESHOLD;
+  while (2 * partition_length <= self->max_fft_latency)
+    partition_length *= 2;
+
+  return partition_length;
+}
+
+/* Number of samples consumed and generated per pass in FFT mode */
+static guint
+gst_audio_fx_base_fir_filter_get_fft_hop_length (GstAudioFXBaseFIRFilter *
+    self)
+{
+  if (self->partition_length)
+    return self->partition_length;
+
+  return self->block_length - self->kernel_length + 1;
+}
+
 static void
     gst_audio_fx_base_fir_filter_calculate_frequency_response
     (GstAudioFXBaseFIRFilter * self)
@@ -375,8 +600,55 @@ static void
   self->frequency_response_length = 0;
   g_free (self->fft_buffer);
   self->fft_buffer = NULL;
+  self->partition_length = 0;
+  self->partitions = 0;
+
+  if (self->kernel)
+    self->partition_length =
+        gst_audio_fx_base_fir_filter_get_partition_length (self,
+        self->kernel_length);
 
-  if (self->kernel && self->kernel_length >= FFT_THRESHOLD
+  if (self->partition_length) {
+    guint block_length, partition_length = self->partition_length;
+    guint i, p;
+    gdouble *kernel_tmp;
+
+    /* Blocks contain the last and the current input samples */
+    block_length = 2 * partition_length;
+    self->block_length = block_length;
+    self->partitions =
+        (self->kernel_length + partition_length - 1) / partition_length;
+
+    GST_DEBUG_OBJECT (self, "Using %u partitions of length %u",
+        self->partitions, partition_length);
+
+    self->fft = gst_fft_f64_new (block_length, FALSE);
+    self->ifft = gst_fft_f64_new (block_length, TRUE);
+    self->frequency_response_length = block_length / 2 + 1;
+    self->frequency_response =
+        g_new (GstFFTF64Complex,
+        self->frequency_response_length * self->partitions);
+
+    kernel_tmp = g_new0 (gdouble, block_length);
+    for (p = 0; p < self->partitions; p++) {
+      GstFFTF64Complex *response =
+          self->frequency_response + p * self->frequency_response_length;
+
+      /* The second half stays zero, the last partition might be shorter */
+      memset (kernel_tmp, 0, partition_length * sizeof (gdouble));
+      memcpy (kernel_tmp, self->kernel + p * partition_length,
+          MIN (partition_length,
+              self->kernel_length - p * partition_length) * sizeof (gdouble));
+      gst_fft_f64_fft (self->fft, kernel_tmp, response);
+
+      /* Normalize to make sure IFFT(FFT(x)) == x */
+      for (i = 0; i < self->frequency_response_length; i++) {
+        response[i].r /= block_length;
+        response[i].i /= block_length;
+      }
+    }
+    g_free (kernel_tmp);
+  } else if (self->kernel && self->kernel_length >= FFT_THRESHOLD
       && !self->low_latency) {
     guint block_length, i;
     gdouble *kernel_tmp, *kernel = self->kernel;
@@ -412,7 +684,17 @@ gst_audio_fx_base_fir_filter_select_process_function (GstAudioFXBaseFIRFilter *
 {
   switch (format) {
     case GST_AUDIO_FORMAT_F32:
-      if (self->fft && !self->low_latency) {
+      if (self->fft && self->partition_length) {
+        if (channels == 1)
+          self->process = (GstAudioFXBaseFIRFilterProcessFunc)
+              process_partitioned_1_32;
+        else if (channels == 2)
+          self->process = (GstAudioFXBaseFIRFilterProcessFunc)
+              process_partitioned_2_32;
+        else
+          self->process = (GstAudioFXBaseFIRFilterProcessFunc)
+              process_partitioned_32;
+      } else if (self->fft && !self->low_latency) {
         if (channels == 1)
           self->process = (GstAudioFXBaseFIRFilterProcessFunc) process_fft_1_32;
         else if (channels == 2)
@@ -429,7 +711,17 @@ gst_audio_fx_base_fir_filter_select_process_function (GstAudioFXBaseFIRFilter *
       }
       break;
     case GST_AUDIO_FORMAT_F64:
-      if (self->fft && !self->low_latency) {
+      if (self->fft && self->partition_length) {
+        if (channels == 1)
+          self->process = (GstAudioFXBaseFIRFilterProcessFunc)
+              process_partitioned_1_64;
+        else if (channels == 2)
+          self->process = (GstAudioFXBaseFIRFilterProcessFunc)
+              process_partitioned_2_64;
+        else
+          self->process = (GstAudioFXBaseFIRFilterProcessFunc)
+              process_partitioned_64;
+      } else if (self->fft && !self->low_latency) {
         if (channels == 1)
           self->process = (GstAudioFXBaseFIRFilterProcessFunc) process_fft_1_64;
         else if (channels == 2)
@@ -462,6 +754,7 @@ gst_audio_fx_base_fir_filter_finalize (GObject * object)
   gst_fft_f64_free (self->ifft);
   g_free (self->frequency_response);
   g_free (self->fft_buffer);
+  g_free (self->fdl);
   g_mutex_clear (&self->lock);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -502,6 +795,27 @@ gst_audio_fx_base_fir_filter_set_property (GObject * object, guint prop_id,
       g_mutex_unlock (&self->lock);
       break;
     }
+    case PROP_MAX_FFT_LATENCY:{
+      guint max_fft_latency;
+
+      if (GST_STATE (self) >= GST_STATE_PAUSED) {
+        g_warning ("Changing the \"max-fft-latency\" property "
+            "is only allowed in states < PAUSED");
+        return;
+      }
+
+      g_mutex_lock (&self->lock);
+      max_fft_latency = g_value_get_uint (value);
+
+      if (self->max_fft_latency != max_fft_latency) {
+        self->max_fft_latency = max_fft_latency;
+        gst_audio_fx_base_fir_filter_calculate_frequency_response (self);
+        gst_audio_fx_base_fir_filter_select_process_function (self,
+            GST_AUDIO_FILTER_FORMAT (self), GST_AUDIO_FILTER_CHANNELS (self));
+      }
+      g_mutex_unlock (&self->lock);
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -521,6 +835,9 @@ gst_audio_fx_base_fir_filter_get_property (GObject * object, guint prop_id,
     case PROP_DRAIN_ON_CHANGES:
       g_value_set_boolean (value, self->drain_on_changes);
       break;
+    case PROP_MAX_FFT_LATENCY:
+      g_value_set_uint (value, self->max_fft_latency);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -569,6 +886,23 @@ gst_audio_fx_base_fir_filter_class_init (GstAudioFXBaseFIRFilterClass * klass)
           DEFAULT_DRAIN_ON_CHANGES,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstAudioFXBaseFIRFilter:max-fft-latency:
+   *
+   * Maximum latency in samples added by FFT convolution. Long filter kernels
+   * are split into partitions to stay below it, 0 processes the whole kernel
+   * at once which gives a latency of about three times the kernel length.
+   * Partitions are at least 32 samples long.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_FFT_LATENCY,
+      g_param_spec_uint ("max-fft-latency", "Maximum FFT latency",
+          "Maximum latency in samples added by FFT convolution, long "
+          "kernels are partitioned to stay below it (0 = unlimited). "
+          "Can only be changed in states < PAUSED!", 0, G_MAXUINT,
+          DEFAULT_MAX_FFT_LATENCY, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   caps = gst_caps_from_string (ALLOWED_CAPS);
   gst_audio_filter_class_add_pad_templates (GST_AUDIO_FILTER_CLASS (klass),
       caps);
@@ -600,6 +934,7 @@ gst_audio_fx_base_fir_filter_init (GstAudioFXBaseFIRFilter * self)
 
   self->low_latency = DEFAULT_LOW_LATENCY;
   self->drain_on_changes = DEFAULT_DRAIN_ON_CHANGES;
+  self->max_fft_latency = DEFAULT_MAX_FFT_LATENCY;
 
   g_mutex_init (&self->lock);
 }
@@ -675,8 +1010,8 @@ gst_audio_fx_base_fir_filter_push_residue (GstAudioFXBaseFIRFilter * self)
       step_gensamples = self->process (self, zeroes, out, step_insamples);
       g_free (zeroes);
 
-      memcpy (map.data + gensamples * bps, out, MIN (step_gensamples,
-              outsamples - gensamples) * bps);
+      memcpy (map.data + gensamples * channels * bps, out,
+          MIN (step_gensamples, outsamples - gensamples) * channels * bps);
       gensamples += MIN (step_gensamples, outsamples - gensamples);
 
       g_free (out);
@@ -775,7 +1110,7 @@ gst_audio_fx_base_fir_filter_transform_size (GstBaseTransform * base,
   bpf = GST_AUDIO_INFO_BPF (&info);
 
   size /= bpf;
-  blocklen = self->block_length - self->kernel_length + 1;
+  blocklen = gst_audio_fx_base_fir_filter_get_fft_hop_length (self);
   *othersize = ((size + blocklen - 1) / blocklen) * blocklen;
   *othersize *= bpf;
 
@@ -971,7 +1306,7 @@ gst_audio_fx_base_fir_filter_query (GstBaseTransform * trans,
             GST_TIME_ARGS (min), GST_TIME_ARGS (max));
 
         if (self->fft && !self->low_latency)
-          latency = self->block_length - self->kernel_length + 1;
+          latency = gst_audio_fx_base_fir_filter_get_fft_hop_length (self);
         else
           latency = self->latency;
 
@@ -1028,7 +1363,8 @@ gst_audio_fx_base_fir_filter_set_kernel (GstAudioFXBaseFIRFilter * self,
     gdouble * kernel, guint kernel_length, guint64 latency,
     const GstAudioInfo * info)
 {
-  gboolean latency_changed;
+  gboolean latency_changed, buffer_changed;
+  guint old_partition_length, partition_length;
   GstAudioFormat format;
   gint channels;
 
@@ -1037,15 +1373,27 @@ gst_audio_fx_base_fir_filter_set_kernel (GstAudioFXBaseFIRFilter * self,
 
   g_mutex_lock (&self->lock);
 
+  old_partition_length =
+      gst_audio_fx_base_fir_filter_get_partition_length (self,
+      self->kernel_length);
+  partition_length =
+      gst_audio_fx_base_fir_filter_get_partition_length (self, kernel_length);
+
   latency_changed = (self->latency != latency
       || (!self->low_latency && self->kernel_length < FFT_THRESHOLD
           && kernel_length >= FFT_THRESHOLD)
       || (!self->low_latency && self->kernel_length >= FFT_THRESHOLD
-          && kernel_length < FFT_THRESHOLD));
+          && kernel_length < FFT_THRESHOLD)
+      || old_partition_length != partition_length);
+
+  /* The frequency-domain delay line has one entry per partition */
+  buffer_changed = latency_changed || (partition_length
+      && (self->kernel_length + partition_length - 1) / partition_length !=
+      (kernel_length + partition_length - 1) / partition_length);
 
   /* FIXME: If the latency changes, the buffer size changes too and we
    * have to drain in any case until this is fixed in the future */
-  if (self->buffer && (!self->drain_on_changes || latency_changed)) {
+  if (self->buffer && (!self->drain_on_changes || buffer_changed)) {
     gst_audio_fx_base_fir_filter_push_residue (self);
     self->start_ts = GST_CLOCK_TIME_NONE;
     self->start_off = GST_BUFFER_OFFSET_NONE;
@@ -1055,7 +1403,7 @@ gst_audio_fx_base_fir_filter_set_kernel (GstAudioFXBaseFIRFilter * self,
   }
 
   g_free (self->kernel);
-  if (!self->drain_on_changes || latency_changed) {
+  if (!self->drain_on_changes || buffer_changed) {
     g_free (self->buffer);
     self->buffer = NULL;
     self->buffer_fill = 0;
@@ -61,6 +61,7 @@ struct _GstAudioFXBaseFIRFilter {
 
   guint64 latency;              /* pre-latency of the filter kernel */
   gboolean low_latency;         /* work in slower low latency mode */
+  guint max_fft_latency;        /* maximum latency of FFT convolution, 0 = unlimited */
 
   gboolean drain_on_changes;    /* If the filter should be drained when
                                  * coeficients change */
@@ -80,6 +81,14 @@ struct _GstAudioFXBaseFIRFilter {
   GstFFTF64Complex *fft_buffer;          /* FFT buffer, has the length of the frequency response */
   guint block_length;                    /* Length of the processing blocks -- time domain */
 
+  /* Partitioned FFT convolution specific data */
+  guint partition_length;                /* Length of the kernel partitions and of the
+                                          * input blocks, 0 if not partitioned */
+  guint partitions;                      /* Number of kernel partitions */
+  GstFFTF64Complex *fdl;                 /* Frequency-domain delay line: spectra of the last
+                                          * input blocks for all channels */
+  guint fdl_pos;                         /* Position of the newest spectrum in the delay line */
+
   GstClockTime start_ts;        /* start timestamp after a discont */
   guint64 start_off;            /* start offset after a discont */
   guint64 nsamples_out;         /* number of output samples since last discont */
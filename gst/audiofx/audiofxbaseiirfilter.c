@@ -43,6 +43,11 @@ GST_DEBUG_CATEGORY_STATIC (GST_CAT_DEFAULT);
     " channels = (int) [ 1, MAX ],"                               \
     " layout=(string) interleaved"
 
+/* number of frames filtered at once */
+#define BLOCK_FRAMES 256
+/* number of channels filtered side by side */
+#define CHANNEL_CHUNK 8
+
 #define gst_audio_fx_base_iir_filter_parent_class parent_class
 G_DEFINE_TYPE (GstAudioFXBaseIIRFilter,
     gst_audio_fx_base_iir_filter, GST_TYPE_AUDIO_FILTER);
@@ -76,19 +81,11 @@ gst_audio_fx_base_iir_filter_finalize (GObject * object)
     filter->b = NULL;
   }
 
-  if (filter->channels) {
-    GstAudioFXBaseIIRFilterChannelCtx *ctx;
-    guint i;
-
-    for (i = 0; i < filter->nchannels; i++) {
-      ctx = &filter->channels[i];
-      g_free (ctx->x);
-      g_free (ctx->y);
-    }
+  g_free (filter->x);
+  filter->x = NULL;
+  g_free (filter->y);
+  filter->y = NULL;
 
-    g_free (filter->channels);
-    filter->channels = NULL;
-  }
   g_mutex_clear (&filter->lock);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -129,8 +126,9 @@ gst_audio_fx_base_iir_filter_init (GstAudioFXBaseIIRFilter * filter)
   filter->na = 0;
   filter->b = NULL;
   filter->nb = 0;
-  filter->channels = NULL;
   filter->nchannels = 0;
+  filter->x = NULL;
+  filter->y = NULL;
 
   g_mutex_init (&filter->lock);
 }
@@ -178,12 +176,28 @@ gst_audio_fx_base_iir_filter_calculate_gain (gdouble * a, guint na, gdouble * b,
   return (sqrt (gain_r * gain_r + gain_i * gain_i));
 }
 
+/* (Re)allocates the history for the current coefficients and channels,
+ * which also resets it. Must be called with the lock */
+static void
+gst_audio_fx_base_iir_filter_reset_history (GstAudioFXBaseIIRFilter * filter)
+{
+  g_free (filter->x);
+  g_free (filter->y);
+  filter->x = filter->y = NULL;
+
+  if (filter->nchannels == 0 || filter->na == 0 || filter->nb == 0)
+    return;
+
+  filter->x = g_new0 (gdouble, (filter->nb - 1 + BLOCK_FRAMES) *
+      filter->nchannels);
+  filter->y = g_new0 (gdouble, (filter->na - 1 + BLOCK_FRAMES) *
+      filter->nchannels);
+}
+
 void
 gst_audio_fx_base_iir_filter_set_coefficients (GstAudioFXBaseIIRFilter * filter,
     gdouble * a, guint na, gdouble * b, guint nb)
 {
-  guint i;
-
   g_return_if_fail (GST_IS_AUDIO_FX_BASE_IIR_FILTER (filter));
 
   g_mutex_lock (&filter->lock);
@@ -191,48 +205,13 @@ gst_audio_fx_base_iir_filter_set_coefficients (GstAudioFXBaseIIRFilter * filter,
   g_free (filter->a);
   g_free (filter->b);
 
-  filter->a = filter->b = NULL;
-
-  if (filter->channels) {
-    GstAudioFXBaseIIRFilterChannelCtx *ctx;
-    gboolean free = (na != filter->na || nb != filter->nb);
-
-    for (i = 0; i < filter->nchannels; i++) {
-      ctx = &filter->channels[i];
-
-      if (free)
-        g_free (ctx->x);
-      else
-        memset (ctx->x, 0, filter->nb * sizeof (gdouble));
-
-      if (free)
-        g_free (ctx->y);
-      else
-        memset (ctx->y, 0, filter->na * sizeof (gdouble));
-    }
-
-    g_free (filter->channels);
-    filter->channels = NULL;
-  }
-
   filter->na = na;
   filter->nb = nb;
 
   filter->a = a;
   filter->b = b;
 
-  if (filter->nchannels && !filter->channels) {
-    GstAudioFXBaseIIRFilterChannelCtx *ctx;
-
-    filter->channels =
-        g_new0 (GstAudioFXBaseIIRFilterChannelCtx, filter->nchannels);
-    for (i = 0; i < filter->nchannels; i++) {
-      ctx = &filter->channels[i];
-
-      ctx->x = g_new0 (gdouble, filter->nb);
-      ctx->y = g_new0 (gdouble, filter->na);
-    }
-  }
+  gst_audio_fx_base_iir_filter_reset_history (filter);
 
   g_mutex_unlock (&filter->lock);
 }
@@ -265,70 +244,77 @@ gst_audio_fx_base_iir_filter_setup (GstAudioFilter * base,
   channels = GST_AUDIO_INFO_CHANNELS (info);
 
   if (channels != filter->nchannels) {
-    guint i;
-    GstAudioFXBaseIIRFilterChannelCtx *ctx;
-
-    if (filter->channels) {
-      for (i = 0; i < filter->nchannels; i++) {
-        ctx = &filter->channels[i];
-
-        g_free (ctx->x);
-        g_free (ctx->y);
-      }
-      g_free (filter->channels);
-    }
-
-    filter->channels = g_new0 (GstAudioFXBaseIIRFilterChannelCtx, channels);
-    for (i = 0; i < channels; i++) {
-      ctx = &filter->channels[i];
-
-      ctx->x = g_new0 (gdouble, filter->nb);
-      ctx->y = g_new0 (gdouble, filter->na);
-    }
     filter->nchannels = channels;
+    gst_audio_fx_base_iir_filter_reset_history (filter);
   }
   g_mutex_unlock (&filter->lock);
 
   return ret;
 }
 
-static inline gdouble
-process (GstAudioFXBaseIIRFilter * filter,
-    GstAudioFXBaseIIRFilterChannelCtx * ctx, gdouble x0)
+/* Filters the block of frames after the history in filter->x into the
+ * block after the history in filter->y. Each sample is calculated with the
+ * same operations in the same order as the direct form difference equation
+ *
+ *   y[n] = (b[0] x[n] + ... + b[nb-1] x[n-nb+1]
+ *           - a[1] y[n-1] - ... - a[na-1] y[n-na+1]) / a[0]
+ *
+ * so the output doesn't depend on the block size, but CHANNEL_CHUNK channels
+ * are filtered side by side with their sums kept in registers, which the
+ * compiler can vectorize. */
+static void
+process_block (GstAudioFXBaseIIRFilter * filter, guint num_frames)
 {
-  gdouble val = filter->b[0] * x0;
-  gint i, j;
-
-  for (i = 1, j = ctx->x_pos; i < filter->nb; i++) {
-    val += filter->b[i] * ctx->x[j];
-    j--;
-    if (j < 0)
-      j = filter->nb - 1;
-  }
+  const gdouble *a = filter->a, *b = filter->b;
+  guint na = filter->na, nb = filter->nb;
+  guint channels = filter->nchannels;
+  const gdouble *x, *xi, *yi;
+  gdouble *y;
+  guint n, i, c, k;
 
-  for (i = 1, j = ctx->y_pos; i < filter->na; i++) {
-    val -= filter->a[i] * ctx->y[j];
-    j--;
-    if (j < 0)
-      j = filter->na - 1;
-  }
-  val /= filter->a[0];
+  x = filter->x + (nb - 1) * channels;
+  y = filter->y + (na - 1) * channels;
 
-  if (ctx->x) {
-    ctx->x_pos++;
-    if (ctx->x_pos >= filter->nb)
-      ctx->x_pos = 0;
-    ctx->x[ctx->x_pos] = x0;
-  }
-  if (ctx->y) {
-    ctx->y_pos++;
-    if (ctx->y_pos >= filter->na)
-      ctx->y_pos = 0;
+  for (n = 0; n < num_frames; n++) {
+    for (c = 0; c + CHANNEL_CHUNK <= channels; c += CHANNEL_CHUNK) {
+      gdouble val[CHANNEL_CHUNK];
+
+      for (k = 0; k < CHANNEL_CHUNK; k++)
+        val[k] = b[0] * x[c + k];
 
-    ctx->y[ctx->y_pos] = val;
+      for (i = 1, xi = x + c - channels; i < nb; i++, xi -= channels)
+        for (k = 0; k < CHANNEL_CHUNK; k++)
+          val[k] += b[i] * xi[k];
+
+      for (i = 1, yi = y + c - channels; i < na; i++, yi -= channels)
+        for (k = 0; k < CHANNEL_CHUNK; k++)
+          val[k] -= a[i] * yi[k];
+
+      for (k = 0; k < CHANNEL_CHUNK; k++)
+        y[c + k] = val[k] / a[0];
+    }
+
+    for (; c < channels; c++) {
+      gdouble val = b[0] * x[c];
+
+      for (i = 1, xi = x + c - channels; i < nb; i++, xi -= channels)
+        val += b[i] * *xi;
+
+      for (i = 1, yi = y + c - channels; i < na; i++, yi -= channels)
+        val -= a[i] * *yi;
+
+      y[c] = val / a[0];
+    }
+
+    x += channels;
+    y += channels;
   }
 
-  return val;
+  /* keep the last frames as history for the next block */
+  memmove (filter->x, filter->x + num_frames * channels,
+      (nb - 1) * channels * sizeof (gdouble));
+  memmove (filter->y, filter->y + num_frames * channels,
+      (na - 1) * channels * sizeof (gdouble));
 }
 
 #define DEFINE_PROCESS_FUNC(width,ctype) \
@@ -336,14 +322,23 @@ static void \
 process_##width (GstAudioFXBaseIIRFilter * filter, \
     g##ctype * data, guint num_samples) \
 { \
-  gint i, j, channels = filter->nchannels; \
-  gdouble val; \
+  guint channels = filter->nchannels; \
+  guint num_frames = num_samples / channels; \
+  gdouble *x = filter->x + (filter->nb - 1) * channels; \
+  gdouble *y = filter->y + (filter->na - 1) * channels; \
+  guint i, n; \
   \
-  for (i = 0; i < num_samples / channels; i++) { \
-    for (j = 0; j < channels; j++) { \
-      val = process (filter, &filter->channels[j], *data); \
-      *data++ = val; \
-    } \
+  while (num_frames > 0) { \
+    n = MIN (num_frames, BLOCK_FRAMES); \
+    \
+    for (i = 0; i < n * channels; i++) \
+      x[i] = data[i]; \
+    process_block (filter, n); \
+    for (i = 0; i < n * channels; i++) \
+      data[i] = y[i]; \
+    \
+    data += n * channels; \
+    num_frames -= n; \
   } \
 }
 
@@ -395,21 +390,12 @@ static gboolean
 gst_audio_fx_base_iir_filter_stop (GstBaseTransform * base)
 {
   GstAudioFXBaseIIRFilter *filter = GST_AUDIO_FX_BASE_IIR_FILTER (base);
-  guint channels = filter->nchannels;
-  GstAudioFXBaseIIRFilterChannelCtx *ctx;
-  guint i;
 
   /* Reset the history of input and output values if
    * already existing */
-  if (channels && filter->channels) {
-    for (i = 0; i < channels; i++) {
-      ctx = &filter->channels[i];
-      g_free (ctx->x);
-      g_free (ctx->y);
-    }
-    g_free (filter->channels);
-  }
-  filter->channels = NULL;
+  g_free (filter->x);
+  g_free (filter->y);
+  filter->x = filter->y = NULL;
   filter->nchannels = 0;
 
   return TRUE;
@@ -39,14 +39,6 @@ typedef struct _GstAudioFXBaseIIRFilterClass GstAudioFXBaseIIRFilterClass;
 
 typedef void (*GstAudioFXBaseIIRFilterProcessFunc) (GstAudioFXBaseIIRFilter *, guint8 *, guint);
 
-typedef struct
-{
-  gdouble *x;
-  gint x_pos;
-  gdouble *y;
-  gint y_pos;
-} GstAudioFXBaseIIRFilterChannelCtx;
-
 struct _GstAudioFXBaseIIRFilter
 {
   GstAudioFilter audiofilter;
@@ -58,9 +50,13 @@ struct _GstAudioFXBaseIIRFilter
   guint na;
   gdouble *b;
   guint nb;
-  GstAudioFXBaseIIRFilterChannelCtx *channels;
   guint nchannels;
 
+  /* history of all channels, interleaved: the last nb - 1 input frames and
+   * the last na - 1 output frames, each followed by room for one block */
+  gdouble *x;
+  gdouble *y;
+
   GMutex lock;
 };
 
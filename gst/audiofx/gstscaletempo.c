@@ -53,7 +53,9 @@
  * for the best overlap position.  Scaletempo uses a statistical cross
  * correlation (roughly a dot-product).  Scaletempo consumes most of its CPU
  * cycles here. One can use the #GstScaletempo:search propery to tune how far
- * the algoritm looks.
+ * the algoritm looks, #GstScaletempo:search-mode to trade some accuracy of the
+ * search for speed and #GstScaletempo:max-threads to spread it over several
+ * cores.
  * </para>
  * </refsect2>
  */
@@ -89,8 +91,42 @@ enum
   PROP_STRIDE,
   PROP_OVERLAP,
   PROP_SEARCH,
+  PROP_SEARCH_MODE,
+  PROP_MAX_THREADS
 };
 
+enum
+{
+  SEARCH_MODE_EXHAUSTIVE = 0,
+  SEARCH_MODE_COARSE_TO_FINE
+};
+
+#define DEFAULT_SEARCH_MODE SEARCH_MODE_EXHAUSTIVE
+#define DEFAULT_MAX_THREADS 1
+
+/* the coarse search grid has a step of one frame per 11025 Hz of rate */
+#define COARSE_STEP_RATE 11025
+
+#define GST_TYPE_SCALETEMPO_SEARCH_MODE (gst_scaletempo_search_mode_get_type ())
+static GType
+gst_scaletempo_search_mode_get_type (void)
+{
+  static GType gtype = 0;
+
+  if (gtype == 0) {
+    static const GEnumValue values[] = {
+      {SEARCH_MODE_EXHAUSTIVE, "Correlate at every offset (default)",
+          "exhaustive"},
+      {SEARCH_MODE_COARSE_TO_FINE, "Coarse search on a decimated grid, "
+            "refined at full resolution", "coarse-to-fine"},
+      {0, NULL, NULL}
+    };
+
+    gtype = g_enum_register_static ("GstScaletempoSearchMode", values);
+  }
+  return gtype;
+}
+
 #define SUPPORTED_CAPS \
 GST_STATIC_CAPS ( \
     GST_AUDIO_CAPS_MAKE (GST_AUDIO_NE (F32)) "; " \
@@ -114,14 +150,154 @@ static GstStaticPadTemplate src_template = GST_STATIC_PAD_TEMPLATE ("src",
 G_DEFINE_TYPE_WITH_CODE (GstScaletempo, gst_scaletempo,
     GST_TYPE_BASE_TRANSFORM, DEBUG_INIT (0));
 
-#define CREATE_BEST_OVERLAP_OFFSET_FLOAT_FUNC(type) \
-static guint \
-best_overlap_offset_##type (GstScaletempo * st) \
+/* Scaletempo spends most of its cycles in the cross correlation below, so
+ * it is written for the compiler to vectorize: each offset is a plain dot
+ * product over contiguous interleaved samples (all channels at once) and
+ * the floating point sums are split over 8 independent accumulators, as
+ * the compiler may not reorder float additions on its own. The offsets of
+ * one search can be split over several threads. */
+struct _GstScaletempoSearchJob
+{
+  GstScaletempo *st;
+  gconstpointer pre_corr;
+  gconstpointer search;
+  guint n_samples;
+  guint first, last;
+
+  /* result */
+  guint best_off;
+  gdouble best_corr;
+  gint64 best_corr_s16;
+};
+
+/* don't bother other threads with less offsets than that */
+#define MIN_OFFSETS_PER_JOB 16
+
+#define CREATE_DOT_PRODUCT_FLOAT_FUNC(type) \
+static inline g##type \
+dot_product_##type (const g##type * a, const g##type * b, guint n) \
+{ \
+  g##type sum[8] = { 0, }; \
+  guint i, j; \
+  \
+  for (i = 0; i + 8 <= n; i += 8) { \
+    for (j = 0; j < 8; j++) \
+      sum[j] += a[j] * b[j]; \
+    a += 8; \
+    b += 8; \
+  } \
+  for (; i < n; i++) \
+    sum[0] += *a++ * *b++; \
+  \
+  return ((sum[0] + sum[4]) + (sum[1] + sum[5])) + \
+      ((sum[2] + sum[6]) + (sum[3] + sum[7])); \
+}
+
+CREATE_DOT_PRODUCT_FLOAT_FUNC (float);
+CREATE_DOT_PRODUCT_FLOAT_FUNC (double);
+
+/* 64 bit integer products don't vectorize well without SSE4.1, but an
+ * unrolled scalar loop keeps up */
+static inline gint64
+dot_product_s16 (const gint32 * a, const gint16 * b, guint n)
+{
+  gint64 corr = 0;
+  guint i;
+
+  for (i = 0; i + 4 <= n; i += 4) {
+    corr += a[0] * b[0];
+    corr += a[1] * b[1];
+    corr += a[2] * b[2];
+    corr += a[3] * b[3];
+    a += 4;
+    b += 4;
+  }
+  for (; i < n; i++)
+    corr += *a++ * *b++;
+
+  return corr;
+}
+
+#define CREATE_CORRELATE_FLOAT_FUNC(type) \
+static void \
+correlate_##type (GstScaletempoSearchJob * job) \
+{ \
+  const g##type *ppc = job->pre_corr; \
+  const g##type *ps = job->search; \
+  guint spf = job->st->samples_per_frame; \
+  g##type best_corr = 0; \
+  guint off; \
+  \
+  ps += job->first * spf; \
+  job->best_off = job->first; \
+  for (off = job->first; off < job->last; off++) { \
+    g##type corr = dot_product_##type (ppc, ps, job->n_samples); \
+    if (off == job->first || corr > best_corr) { \
+      best_corr = corr; \
+      job->best_off = off; \
+    } \
+    ps += spf; \
+  } \
+  job->best_corr = best_corr; \
+}
+
+CREATE_CORRELATE_FLOAT_FUNC (float);
+CREATE_CORRELATE_FLOAT_FUNC (double);
+
+static void
+correlate_s16 (GstScaletempoSearchJob * job)
+{
+  const gint32 *ppc = job->pre_corr;
+  const gint16 *ps = job->search;
+  guint spf = job->st->samples_per_frame;
+  gint64 best_corr = 0;
+  guint off;
+
+  ps += job->first * spf;
+  job->best_off = job->first;
+  for (off = job->first; off < job->last; off++) {
+    gint64 corr = dot_product_s16 (ppc, ps, job->n_samples);
+    if (off == job->first || corr > best_corr) {
+      best_corr = corr;
+      job->best_off = off;
+    }
+    ps += spf;
+  }
+  job->best_corr_s16 = best_corr;
+}
+
+/* The coarse search works on averages of step frames, which keeps high
+ * frequencies from aliasing into the coarse correlation */
+#define CREATE_DECIMATE_FUNC(name, type, sum_type) \
+static void \
+decimate_##name (type * dst, const type * src, guint n_frames, guint step, \
+    guint spf) \
+{ \
+  guint i, j, k; \
+  \
+  for (i = 0; i < n_frames; i++) { \
+    for (j = 0; j < spf; j++) { \
+      sum_type sum = 0; \
+      for (k = 0; k < step; k++) \
+        sum += src[k * spf + j]; \
+      dst[j] = sum / (sum_type) step; \
+    } \
+    dst += spf; \
+    src += step * spf; \
+  } \
+}
+
+CREATE_DECIMATE_FUNC (float, gfloat, gfloat);
+CREATE_DECIMATE_FUNC (double, gdouble, gdouble);
+CREATE_DECIMATE_FUNC (s32, gint32, gint32);
+CREATE_DECIMATE_FUNC (s16, gint16, gint32);
+
+#define CREATE_PREPARE_SEARCH_FLOAT_FUNC(type) \
+static void \
+prepare_search_##type (GstScaletempo * st) \
 { \
-  g##type *pw, *po, *ppc, *search_start; \
-  g##type best_corr = G_MININT; \
-  guint best_off = 0; \
-  gint i, off; \
+  g##type *pw, *po, *ppc; \
+  gint i; \
   \
   pw = st->table_window; \
   po = st->buf_overlap; \
@@ -131,37 +307,23 @@ best_overlap_offset_##type (GstScaletempo * st) \
     *ppc++ = *pw++ * *po++; \
   } \
   \
-  search_start = (g##type *) st->buf_queue + st->samples_per_frame; \
-  for (off = 0; off < st->frames_search; off++) { \
-    g##type corr = 0; \
-    g##type *ps = search_start; \
-    ppc = st->buf_pre_corr; \
-    for (i = st->samples_per_frame; i < st->samples_overlap; i++) { \
-      corr += *ppc++ * *ps++; \
-    } \
-    if (corr > best_corr) { \
-      best_corr = corr; \
-      best_off = off; \
-    } \
-    search_start += st->samples_per_frame; \
+  if (st->coarse_step > 1) { \
+    decimate_##type (st->buf_pre_corr_coarse, st->buf_pre_corr, \
+        st->frames_pre_corr_coarse, st->coarse_step, st->samples_per_frame); \
+    decimate_##type (st->buf_queue_coarse, \
+        (g##type *) st->buf_queue + st->samples_per_frame, \
+        st->frames_queue_coarse, st->coarse_step, st->samples_per_frame); \
   } \
-  \
-  return best_off * st->bytes_per_frame; \
 }
 
-CREATE_BEST_OVERLAP_OFFSET_FLOAT_FUNC (float);
-CREATE_BEST_OVERLAP_OFFSET_FLOAT_FUNC (double);
+CREATE_PREPARE_SEARCH_FLOAT_FUNC (float);
+CREATE_PREPARE_SEARCH_FLOAT_FUNC (double);
 
-/* buffer padding for loop optimization: sizeof(gint32) * (loop_size - 1) */
-#define UNROLL_PADDING (4*3)
-static guint
-best_overlap_offset_s16 (GstScaletempo * st)
+static void
+prepare_search_s16 (GstScaletempo * st)
 {
   gint32 *pw, *ppc;
-  gint16 *po, *search_start;
-  gint64 best_corr = G_MININT64;
-  guint best_off = 0;
-  guint off;
+  gint16 *po;
   glong i;
 
   pw = st->table_window;
@@ -172,29 +334,107 @@ best_overlap_offset_s16 (GstScaletempo * st)
     *ppc++ = (*pw++ * *po++) >> 15;
   }
 
-  search_start = (gint16 *) st->buf_queue + st->samples_per_frame;
-  for (off = 0; off < st->frames_search; off++) {
-    gint64 corr = 0;
-    gint16 *ps = search_start;
-    ppc = st->buf_pre_corr;
-    ppc += st->samples_overlap - st->samples_per_frame;
-    ps += st->samples_overlap - st->samples_per_frame;
-    i = -((glong) st->samples_overlap - (glong) st->samples_per_frame);
-    do {
-      corr += ppc[i + 0] * ps[i + 0];
-      corr += ppc[i + 1] * ps[i + 1];
-      corr += ppc[i + 2] * ps[i + 2];
-      corr += ppc[i + 3] * ps[i + 3];
-      i += 4;
-    } while (i < 0);
-    if (corr > best_corr) {
-      best_corr = corr;
-      best_off = off;
-    }
-    search_start += st->samples_per_frame;
+  if (st->coarse_step > 1) {
+    decimate_s32 (st->buf_pre_corr_coarse, st->buf_pre_corr,
+        st->frames_pre_corr_coarse, st->coarse_step, st->samples_per_frame);
+    decimate_s16 (st->buf_queue_coarse,
+        (gint16 *) st->buf_queue + st->samples_per_frame,
+        st->frames_queue_coarse, st->coarse_step, st->samples_per_frame);
+  }
+}
+
+static void
+search_worker (gpointer data, gpointer user_data)
+{
+  GstScaletempoSearchJob *job = data;
+  GstScaletempo *st = user_data;
+
+  st->correlate (job);
+
+  g_mutex_lock (&st->search_lock);
+  if (--st->search_pending == 0)
+    g_cond_signal (&st->search_cond);
+  g_mutex_unlock (&st->search_lock);
+}
+
+/* Correlates pre_corr with search at the frame offsets [first, last) and
+ * stores the best one in result. Ties go to the lowest offset, whatever
+ * the number of threads. */
+static void
+search_range (GstScaletempo * st, gconstpointer pre_corr, gconstpointer search,
+    guint n_samples, guint first, guint last, GstScaletempoSearchJob * result)
+{
+  guint n_jobs = 1, i;
+
+  if (st->pool)
+    n_jobs = CLAMP ((last - first) / MIN_OFFSETS_PER_JOB, 1, st->n_jobs);
+
+  for (i = 0; i < n_jobs; i++) {
+    GstScaletempoSearchJob *job = &st->jobs[i];
+
+    job->st = st;
+    job->pre_corr = pre_corr;
+    job->search = search;
+    job->n_samples = n_samples;
+    job->first = first + (last - first) * i / n_jobs;
+    job->last = first + (last - first) * (i + 1) / n_jobs;
+  }
+
+  if (n_jobs > 1) {
+    st->search_pending = n_jobs - 1;
+    for (i = 1; i < n_jobs; i++)
+      g_thread_pool_push (st->pool, &st->jobs[i], NULL);
+  }
+
+  /* the first part is done in the streaming thread */
+  st->correlate (&st->jobs[0]);
+
+  if (n_jobs > 1) {
+    g_mutex_lock (&st->search_lock);
+    while (st->search_pending > 0)
+      g_cond_wait (&st->search_cond, &st->search_lock);
+    g_mutex_unlock (&st->search_lock);
+  }
+
+  *result = st->jobs[0];
+  for (i = 1; i < n_jobs; i++) {
+    GstScaletempoSearchJob *job = &st->jobs[i];
+
+    if (st->format == GST_AUDIO_FORMAT_S16 ?
+        job->best_corr_s16 > result->best_corr_s16 :
+        job->best_corr > result->best_corr)
+      *result = *job;
+  }
+}
+
+static guint
+best_overlap_offset (GstScaletempo * st)
+{
+  GstScaletempoSearchJob best;
+  gint8 *search_start = st->buf_queue + st->bytes_per_frame;
+  guint first = 0, last = st->frames_search;
+
+  st->prepare_search (st);
+
+  if (st->coarse_step > 1) {
+    guint step = st->coarse_step;
+    guint coarse_off;
+
+    /* correlate the decimated signals at every step-th offset first... */
+    search_range (st, st->buf_pre_corr_coarse, st->buf_queue_coarse,
+        st->frames_pre_corr_coarse * st->samples_per_frame, 0,
+        (st->frames_search - 1) / step + 1, &best);
+
+    /* ...then refine around the best one at full resolution */
+    coarse_off = best.best_off * step;
+    first = coarse_off >= step ? coarse_off - step + 1 : 0;
+    last = MIN (coarse_off + step, st->frames_search);
   }
 
-  return best_off * st->bytes_per_frame;
+  search_range (st, st->buf_pre_corr, search_start,
+      st->samples_overlap - st->samples_per_frame, first, last, &best);
+
+  return best.best_off * st->bytes_per_frame;
 }
 
 #define CREATE_OUTPUT_OVERLAP_FLOAT_FUNC(type) \
@@ -273,6 +513,7 @@ reinit_buffers (GstScaletempo * st)
   gint i, j;
   guint frames_overlap;
   guint new_size;
+  guint n_threads;
   GstClockTime latency;
 
   guint frames_stride = st->ms_stride * st->sample_rate / 1000.0;
@@ -345,15 +586,13 @@ reinit_buffers (GstScaletempo * st)
     guint bytes_pre_corr =
         (st->samples_overlap - st->samples_per_frame) * (st->format ==
         GST_AUDIO_FORMAT_S16 ? 4 : st->bytes_per_sample);
-    st->buf_pre_corr =
-        g_realloc (st->buf_pre_corr, bytes_pre_corr + UNROLL_PADDING);
+    st->buf_pre_corr = g_realloc (st->buf_pre_corr, bytes_pre_corr);
     st->table_window = g_realloc (st->table_window, bytes_pre_corr);
     if (st->format == GST_AUDIO_FORMAT_S16) {
       gint64 t = frames_overlap;
       gint32 n = 8589934588LL / (t * t);        /* 4 * (2^31 - 1) / t^2 */
       gint32 *pw;
 
-      memset ((guint8 *) st->buf_pre_corr + bytes_pre_corr, 0, UNROLL_PADDING);
       pw = st->table_window;
       for (i = 1; i < frames_overlap; i++) {
         gint32 v = (i * (t - i) * n) >> 15;
@@ -361,7 +600,8 @@ reinit_buffers (GstScaletempo * st)
           *pw++ = v;
         }
       }
-      st->best_overlap_offset = best_overlap_offset_s16;
+      st->prepare_search = prepare_search_s16;
+      st->correlate = correlate_s16;
     } else if (st->format == GST_AUDIO_FORMAT_F32) {
       gfloat *pw = st->table_window;
       for (i = 1; i < frames_overlap; i++) {
@@ -370,7 +610,8 @@ reinit_buffers (GstScaletempo * st)
           *pw++ = v;
         }
       }
-      st->best_overlap_offset = best_overlap_offset_float;
+      st->prepare_search = prepare_search_float;
+      st->correlate = correlate_float;
     } else {
       gdouble *pw = st->table_window;
       for (i = 1; i < frames_overlap; i++) {
@@ -379,8 +620,41 @@ reinit_buffers (GstScaletempo * st)
           *pw++ = v;
         }
       }
-      st->best_overlap_offset = best_overlap_offset_double;
+      st->prepare_search = prepare_search_double;
+      st->correlate = correlate_double;
+    }
+    st->best_overlap_offset = best_overlap_offset;
+
+    /* fall back to the exhaustive search if there is nothing to decimate */
+    st->coarse_step = 1;
+    if (st->search_mode == SEARCH_MODE_COARSE_TO_FINE
+        && frames_overlap > st->sample_rate / COARSE_STEP_RATE)
+      st->coarse_step = st->sample_rate / COARSE_STEP_RATE;
+    if (st->coarse_step > 1) {
+      guint step = st->coarse_step;
+      guint bytes_pre_corr_frame = bytes_pre_corr / (frames_overlap - 1);
+
+      st->frames_pre_corr_coarse = (frames_overlap - 1) / step;
+      st->frames_queue_coarse =
+          (st->frames_search - 1) / step + st->frames_pre_corr_coarse;
+      st->buf_pre_corr_coarse =
+          g_realloc (st->buf_pre_corr_coarse,
+          st->frames_pre_corr_coarse * bytes_pre_corr_frame);
+      st->buf_queue_coarse =
+          g_realloc (st->buf_queue_coarse,
+          st->frames_queue_coarse * st->bytes_per_frame);
+    }
+
+    n_threads = st->max_threads > 0 ? st->max_threads : g_get_num_processors ();
+    if (st->pool && st->n_jobs != n_threads) {
+      g_thread_pool_free (st->pool, FALSE, TRUE);
+      st->pool = NULL;
     }
+    st->n_jobs = n_threads;
+    st->jobs = g_renew (GstScaletempoSearchJob, st->jobs, st->n_jobs);
+    if (!st->pool && st->n_jobs > 1)
+      st->pool = g_thread_pool_new (search_worker, st, st->n_jobs - 1, FALSE,
+          NULL);
   }
 
   new_size =
@@ -415,11 +689,12 @@ reinit_buffers (GstScaletempo * st)
   st->frames_stride_scaled = st->bytes_stride_scaled / st->bytes_per_frame;
 
   GST_DEBUG
-      ("%.3f scale, %.3f stride_in, %i stride_out, %i standing, %i overlap, %i search, %i queue, %s mode",
+      ("%.3f scale, %.3f stride_in, %i stride_out, %i standing, %i overlap, %i search, %i coarse step, %i queue, %s mode",
       st->scale, st->frames_stride_scaled,
       (gint) (st->bytes_stride / st->bytes_per_frame),
       (gint) (st->bytes_standing / st->bytes_per_frame),
       (gint) (st->bytes_overlap / st->bytes_per_frame), st->frames_search,
+      st->frames_search ? st->coarse_step : 0,
       (gint) (st->bytes_queue_max / st->bytes_per_frame),
       gst_audio_format_to_string (st->format));
 
@@ -735,6 +1010,17 @@ gst_scaletempo_stop (GstBaseTransform * trans)
   scaletempo->buf_pre_corr = NULL;
   g_free (scaletempo->table_window);
   scaletempo->table_window = NULL;
+  g_free (scaletempo->buf_pre_corr_coarse);
+  scaletempo->buf_pre_corr_coarse = NULL;
+  g_free (scaletempo->buf_queue_coarse);
+  scaletempo->buf_queue_coarse = NULL;
+  if (scaletempo->pool) {
+    g_thread_pool_free (scaletempo->pool, FALSE, TRUE);
+    scaletempo->pool = NULL;
+  }
+  g_free (scaletempo->jobs);
+  scaletempo->jobs = NULL;
+  scaletempo->n_jobs = 0;
   scaletempo->reinit_buffers = TRUE;
 
   return TRUE;
@@ -791,6 +1077,17 @@ gst_scaletempo_query (GstBaseTransform * trans, GstPadDirection direction,
 }
 
 /* GObject vmethod implementations */
+static void
+gst_scaletempo_finalize (GObject * object)
+{
+  GstScaletempo *scaletempo = GST_SCALETEMPO (object);
+
+  g_mutex_clear (&scaletempo->search_lock);
+  g_cond_clear (&scaletempo->search_cond);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
 static void
 gst_scaletempo_get_property (GObject * object,
     guint prop_id, GValue * value, GParamSpec * pspec)
@@ -810,6 +1107,12 @@ gst_scaletempo_get_property (GObject * object,
     case PROP_SEARCH:
       g_value_set_uint (value, scaletempo->ms_search);
       break;
+    case PROP_SEARCH_MODE:
+      g_value_set_enum (value, scaletempo->search_mode);
+      break;
+    case PROP_MAX_THREADS:
+      g_value_set_int (value, scaletempo->max_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -847,6 +1150,22 @@ gst_scaletempo_set_property (GObject * object,
       }
       break;
     }
+    case PROP_SEARCH_MODE:{
+      gint new_value = g_value_get_enum (value);
+      if (scaletempo->search_mode != new_value) {
+        scaletempo->search_mode = new_value;
+        scaletempo->reinit_buffers = TRUE;
+      }
+      break;
+    }
+    case PROP_MAX_THREADS:{
+      gint new_value = g_value_get_int (value);
+      if (scaletempo->max_threads != new_value) {
+        scaletempo->max_threads = new_value;
+        scaletempo->reinit_buffers = TRUE;
+      }
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -862,6 +1181,7 @@ gst_scaletempo_class_init (GstScaletempoClass * klass)
 
   gobject_class->get_property = GST_DEBUG_FUNCPTR (gst_scaletempo_get_property);
   gobject_class->set_property = GST_DEBUG_FUNCPTR (gst_scaletempo_set_property);
+  gobject_class->finalize = GST_DEBUG_FUNCPTR (gst_scaletempo_finalize);
 
   g_object_class_install_property (gobject_class, PROP_RATE,
       g_param_spec_double ("rate", "Playback Rate", "Current playback rate",
@@ -882,6 +1202,41 @@ gst_scaletempo_class_init (GstScaletempoClass * klass)
           "Length in milliseconds to search for best overlap position", 0, 500,
           14, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstScaletempo:search-mode:
+   *
+   * How to search for the best overlap position. The coarse-to-fine search
+   * first correlates only every few frames at every few offsets (4 at
+   * 44.1 and 48 kHz) and then correlates at full resolution around the best
+   * of those, which needs roughly a tenth of the work of the exhaustive
+   * search. It can miss the best position for content with a lot of high
+   * frequencies, and falls back to the exhaustive search at low sample
+   * rates.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_SEARCH_MODE,
+      g_param_spec_enum ("search-mode", "Search Mode",
+          "How to search for the best overlap position",
+          GST_TYPE_SCALETEMPO_SEARCH_MODE, DEFAULT_SEARCH_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstScaletempo:max-threads:
+   *
+   * Number of threads to split the overlap search over. The result doesn't
+   * depend on the number of threads.
+   * (0 = number of processors, 1 = search in the streaming thread)
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_MAX_THREADS,
+      g_param_spec_int ("max-threads", "Maximum Search Threads",
+          "Maximum number of threads to search for the best overlap position "
+          "(0 = automatic, 1 = search in the streaming thread)",
+          0, G_MAXINT, DEFAULT_MAX_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class, &src_template);
   gst_element_class_add_static_pad_template (gstelement_class, &sink_template);
   gst_element_class_set_static_metadata (gstelement_class, "Scaletempo",
@@ -909,6 +1264,8 @@ gst_scaletempo_init (GstScaletempo * scaletempo)
   scaletempo->ms_stride = 30;
   scaletempo->percent_overlap = .2;
   scaletempo->ms_search = 14;
+  scaletempo->search_mode = DEFAULT_SEARCH_MODE;
+  scaletempo->max_threads = DEFAULT_MAX_THREADS;
 
   /* uninitialized */
   scaletempo->scale = 0;
@@ -919,4 +1276,6 @@ gst_scaletempo_init (GstScaletempo * scaletempo)
   scaletempo->bytes_to_slide = 0;
   gst_segment_init (&scaletempo->in_segment, GST_FORMAT_UNDEFINED);
   gst_segment_init (&scaletempo->out_segment, GST_FORMAT_UNDEFINED);
+  g_mutex_init (&scaletempo->search_lock);
+  g_cond_init (&scaletempo->search_cond);
 }
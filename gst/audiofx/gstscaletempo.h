@@ -35,6 +35,7 @@ G_BEGIN_DECLS
 typedef struct _GstScaletempo GstScaletempo;
 typedef struct _GstScaletempoClass GstScaletempoClass;
 typedef struct _GstScaletempoPrivate GstScaletempoPrivate;
+typedef struct _GstScaletempoSearchJob GstScaletempoSearchJob;
 
 struct _GstScaletempo
 {
@@ -47,6 +48,8 @@ struct _GstScaletempo
   guint ms_stride;
   gdouble percent_overlap;
   guint ms_search;
+  gint search_mode;
+  gint max_threads;
 
   /* caps */
   GstAudioFormat format;
@@ -79,6 +82,13 @@ struct _GstScaletempo
   gpointer buf_pre_corr;
   gpointer table_window;
   guint (*best_overlap_offset) (GstScaletempo * scaletempo);
+  void (*prepare_search) (GstScaletempo * scaletempo);
+  void (*correlate) (GstScaletempoSearchJob * job);
+  guint coarse_step;
+  guint frames_pre_corr_coarse;
+  guint frames_queue_coarse;
+  gpointer buf_pre_corr_coarse;
+  gpointer buf_queue_coarse;
 
   /* gstreamer */
   GstSegment in_segment, out_segment;
@@ -86,6 +96,12 @@ struct _GstScaletempo
 
   /* threads */
   gboolean reinit_buffers;
+  GThreadPool *pool;
+  GstScaletempoSearchJob *jobs;
+  guint n_jobs;
+  GMutex search_lock;
+  GCond search_cond;
+  guint search_pending;
 };
 
 struct _GstScaletempoClass
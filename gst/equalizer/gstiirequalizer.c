@@ -133,6 +133,9 @@ struct _GstIirEqualizerBand
   /* second order iir filter */
   gdouble b1, b2;               /* IIR coefficients for outputs */
   gdouble a0, a1, a2;           /* IIR coefficients for inputs */
+
+  /* settings changed since the coefficients were computed */
+  gboolean need_new_coefficients;
 };
 
 struct _GstIirEqualizerBandClass
@@ -159,6 +162,7 @@ gst_iir_equalizer_band_set_property (GObject * object, guint prop_id,
       if (gain != band->gain) {
         BANDS_LOCK (equ);
         equ->need_new_coefficients = TRUE;
+        band->need_new_coefficients = TRUE;
         band->gain = gain;
         set_passthrough (equ);
         BANDS_UNLOCK (equ);
@@ -174,6 +178,7 @@ gst_iir_equalizer_band_set_property (GObject * object, guint prop_id,
       if (freq != band->freq) {
         BANDS_LOCK (equ);
         equ->need_new_coefficients = TRUE;
+        band->need_new_coefficients = TRUE;
         band->freq = freq;
         BANDS_UNLOCK (equ);
         GST_DEBUG_OBJECT (band, "changed freq = %lf ", band->freq);
@@ -188,6 +193,7 @@ gst_iir_equalizer_band_set_property (GObject * object, guint prop_id,
       if (width != band->width) {
         BANDS_LOCK (equ);
         equ->need_new_coefficients = TRUE;
+        band->need_new_coefficients = TRUE;
         band->width = width;
         BANDS_UNLOCK (equ);
         GST_DEBUG_OBJECT (band, "changed width = %lf ", band->width);
@@ -202,6 +208,7 @@ gst_iir_equalizer_band_set_property (GObject * object, guint prop_id,
       if (type != band->type) {
         BANDS_LOCK (equ);
         equ->need_new_coefficients = TRUE;
+        band->need_new_coefficients = TRUE;
         band->type = type;
         BANDS_UNLOCK (equ);
         GST_DEBUG_OBJECT (band, "changed type = %d ", band->type);
@@ -394,6 +401,8 @@ gst_iir_equalizer_finalize (GObject * object)
 
   g_free (equ->bands);
   g_free (equ->history);
+  g_free (equ->block);
+  g_free (equ->coeffs);
 
   g_mutex_clear (&equ->bands_lock);
 
@@ -596,24 +605,90 @@ set_passthrough (GstIirEqualizer * equ)
   GST_DEBUG ("Passthrough mode: %d\n", passthrough);
 }
 
+/* Number of blocks over which the coefficients in use are moved to newly
+ * computed ones. Changing the coefficients of a recursive filter from one
+ * sample to the next causes audible clicks, especially when the gains are
+ * automated with a control source and change with every buffer. */
+#define RAMP_BLOCKS 8
+
 /* Must be called with bands_lock and transform lock! */
 static void
 update_coefficients (GstIirEqualizer * equ)
 {
   gint i, n = equ->freq_band_count;
+  gdouble *cur = equ->coeffs, *target = cur + 5 * n, *step = target + 5 * n;
 
   for (i = 0; i < n; i++) {
-    if (equ->bands[i]->type == BAND_TYPE_PEAK)
-      setup_peak_filter (equ, equ->bands[i]);
-    else if (equ->bands[i]->type == BAND_TYPE_LOW_SHELF)
-      setup_low_shelf_filter (equ, equ->bands[i]);
+    GstIirEqualizerBand *band = equ->bands[i];
+
+    /* only recompute the bands whose settings changed */
+    if (!band->need_new_coefficients)
+      continue;
+
+    if (band->type == BAND_TYPE_PEAK)
+      setup_peak_filter (equ, band);
+    else if (band->type == BAND_TYPE_LOW_SHELF)
+      setup_low_shelf_filter (equ, band);
     else
-      setup_high_shelf_filter (equ, equ->bands[i]);
+      setup_high_shelf_filter (equ, band);
+
+    target[5 * i + 0] = band->a0;
+    target[5 * i + 1] = band->a1;
+    target[5 * i + 2] = band->a2;
+    target[5 * i + 3] = band->b1;
+    target[5 * i + 4] = band->b2;
+    band->need_new_coefficients = FALSE;
+  }
+
+  if (equ->coeffs_valid) {
+    /* start from wherever a running ramp currently is */
+    for (i = 0; i < 5 * n; i++)
+      step[i] = (target[i] - cur[i]) / RAMP_BLOCKS;
+    equ->ramp_blocks = RAMP_BLOCKS;
+  } else {
+    /* nothing was filtered with the old ones, no need to ramp */
+    memcpy (cur, target, 5 * n * sizeof (gdouble));
+    equ->coeffs_valid = TRUE;
+    equ->ramp_blocks = 0;
   }
 
   equ->need_new_coefficients = FALSE;
 }
 
+/* Must be called with bands_lock! */
+static void
+invalidate_coefficients (GstIirEqualizer * equ)
+{
+  gint i;
+
+  for (i = 0; i < equ->freq_band_count; i++)
+    equ->bands[i]->need_new_coefficients = TRUE;
+
+  equ->coeffs_valid = FALSE;
+  equ->ramp_blocks = 0;
+  equ->need_new_coefficients = TRUE;
+}
+
+/* Moves the coefficients in use one step closer to the ones for the current
+ * band settings, called from the streaming thread once per block */
+static inline const gdouble *
+ramp_coefficients (GstIirEqualizer * equ)
+{
+  if (G_UNLIKELY (equ->ramp_blocks > 0)) {
+    guint i, n = 5 * equ->freq_band_count;
+    gdouble *cur = equ->coeffs, *target = cur + n, *step = target + n;
+
+    if (--equ->ramp_blocks == 0) {
+      memcpy (cur, target, n * sizeof (gdouble));
+    } else {
+      for (i = 0; i < n; i++)
+        cur[i] += step[i];
+    }
+  }
+
+  return equ->coeffs;
+}
+
 /* Must be called with transform lock! */
 static void
 alloc_history (GstIirEqualizer * equ, const GstAudioInfo * info)
@@ -673,6 +748,9 @@ gst_iir_equalizer_compute_frequencies (GstIirEqualizer * equ, guint new_count)
 
   alloc_history (equ, GST_AUDIO_FILTER_INFO (equ));
 
+  g_free (equ->coeffs);
+  equ->coeffs = g_new0 (gdouble, 3 * 5 * new_count);
+
   /* set center frequencies and name band objects
    * FIXME: arg! we can't change the name of parented objects :(
    *   application should read band->freq to get the name
@@ -709,111 +787,113 @@ gst_iir_equalizer_compute_frequencies (GstIirEqualizer * equ, guint new_count)
     freq0 = freq1;
   }
 
-  equ->need_new_coefficients = TRUE;
+  invalidate_coefficients (equ);
   BANDS_UNLOCK (equ);
 }
 
 /* start of code that is type specific */
 
-#define CREATE_OPTIMIZED_FUNCTIONS_INT(TYPE,BIG_TYPE,MIN_VAL,MAX_VAL)   \
-typedef struct {                                                        \
-  BIG_TYPE x1, x2;          /* history of input values for a filter */  \
-  BIG_TYPE y1, y2;          /* history of output values for a filter */ \
-} SecondOrderHistory ## TYPE;                                           \
+/* Frames filtered through all bands before moving on, small enough for the
+ * block to stay in the L1 cache while it passes the whole cascade */
+#define BLOCK_FRAMES 64
+
+/* All bands are applied to a block one after another. A band only depends on
+ * the output of the previous band so this gives the same result as running
+ * every sample through the whole cascade, but the inner loop runs over the
+ * channels of one frame with independent histories and the compiler can
+ * vectorize it. The history of a band is stored as x1, x2, y1 and y2 of all
+ * channels. */
+#define CREATE_FILTER_BLOCK(TYPE)                                       \
+static const guint                                                      \
+history_size_ ## TYPE = 4 * sizeof (TYPE);                              \
                                                                         \
-static inline BIG_TYPE                                                  \
-one_step_ ## TYPE (GstIirEqualizerBand *filter,                         \
-    SecondOrderHistory ## TYPE *history, BIG_TYPE input)                \
+static inline void                                                      \
+filter_block_ ## TYPE (const gdouble * coeffs, TYPE * history,          \
+    TYPE * samples, guint frames, guint channels)                       \
 {                                                                       \
-  /* calculate output */                                                \
-  BIG_TYPE output = filter->a0 * input +                                \
-      filter->a1 * history->x1 + filter->a2 * history->x2 +             \
-      filter->b1 * history->y1 + filter->b2 * history->y2;              \
-  /* update history */                                                  \
-  history->y2 = history->y1;                                            \
-  history->y1 = output;                                                 \
-  history->x2 = history->x1;                                            \
-  history->x1 = input;                                                  \
-                                                                        \
-  return output;                                                        \
-}                                                                       \
+  const gdouble a0 = coeffs[0], a1 = coeffs[1], a2 = coeffs[2];         \
+  const gdouble b1 = coeffs[3], b2 = coeffs[4];                         \
+  TYPE *x1 = history, *x2 = x1 + channels;                              \
+  TYPE *y1 = x2 + channels, *y2 = y1 + channels;                        \
+  guint i, c;                                                           \
                                                                         \
+  for (i = 0; i < frames; i++) {                                        \
+    for (c = 0; c < channels; c++) {                                    \
+      TYPE input = samples[c];                                          \
+      /* calculate output */                                            \
+      TYPE output = a0 * input + a1 * x1[c] + a2 * x2[c] +              \
+          b1 * y1[c] + b2 * y2[c];                                      \
+      /* update history */                                              \
+      y2[c] = y1[c];                                                    \
+      y1[c] = output;                                                   \
+      x2[c] = x1[c];                                                    \
+      x1[c] = input;                                                    \
+      samples[c] = output;                                              \
+    }                                                                   \
+    samples += channels;                                                \
+  }                                                                     \
+}
+
+#define CREATE_OPTIMIZED_FUNCTIONS_INT(TYPE,BIG_TYPE,MIN_VAL,MAX_VAL)   \
 static const guint                                                      \
-history_size_ ## TYPE = sizeof (SecondOrderHistory ## TYPE);            \
+history_size_ ## TYPE = 4 * sizeof (BIG_TYPE);                          \
                                                                         \
 static void                                                             \
 gst_iir_equ_process_ ## TYPE (GstIirEqualizer *equ, guint8 *data,       \
 guint size, guint channels)                                             \
 {                                                                       \
   guint frames = size / channels / sizeof (TYPE);                       \
-  guint i, c, f, nf = equ->freq_band_count;                             \
+  guint i, f, nf = equ->freq_band_count;                                \
+  TYPE *samples = (TYPE *) data;                                        \
+  BIG_TYPE *block = equ->block;                                         \
+  BIG_TYPE *history = equ->history;                                     \
   BIG_TYPE cur;                                                         \
-  GstIirEqualizerBand **filters = equ->bands;                           \
                                                                         \
-  for (i = 0; i < frames; i++) {                                        \
-    SecondOrderHistory ## TYPE *history = equ->history;                 \
-    for (c = 0; c < channels; c++) {                                    \
-      cur = *((TYPE *) data);                                           \
-      for (f = 0; f < nf; f++) {                                        \
-        cur = one_step_ ## TYPE (filters[f], history, cur);             \
-        history++;                                                      \
-      }                                                                 \
-      cur = CLAMP (cur, MIN_VAL, MAX_VAL);                              \
-      *((TYPE *) data) = (TYPE) floor (cur);                            \
-      data += sizeof (TYPE);                                            \
+  while (frames > 0) {                                                  \
+    guint n = MIN (frames, BLOCK_FRAMES);                               \
+    const gdouble *coeffs = ramp_coefficients (equ);                    \
+                                                                        \
+    for (i = 0; i < n * channels; i++)                                  \
+      block[i] = samples[i];                                            \
+    for (f = 0; f < nf; f++)                                            \
+      filter_block_ ## BIG_TYPE (coeffs + 5 * f,                        \
+          history + 4 * channels * f, block, n, channels);              \
+    for (i = 0; i < n * channels; i++) {                                \
+      cur = CLAMP (block[i], MIN_VAL, MAX_VAL);                         \
+      samples[i] = (TYPE) floor (cur);                                  \
     }                                                                   \
+                                                                        \
+    samples += n * channels;                                            \
+    frames -= n;                                                        \
   }                                                                     \
 }
 
 #define CREATE_OPTIMIZED_FUNCTIONS(TYPE)                                \
-typedef struct {                                                        \
-  TYPE x1, x2;          /* history of input values for a filter */  \
-  TYPE y1, y2;          /* history of output values for a filter */ \
-} SecondOrderHistory ## TYPE;                                           \
-                                                                        \
-static inline TYPE                                                      \
-one_step_ ## TYPE (GstIirEqualizerBand *filter,                         \
-    SecondOrderHistory ## TYPE *history, TYPE input)                    \
-{                                                                       \
-  /* calculate output */                                                \
-  TYPE output = filter->a0 * input + filter->a1 * history->x1 +         \
-      filter->a2 * history->x2 + filter->b1 * history->y1 +             \
-      filter->b2 * history->y2;                                         \
-  /* update history */                                                  \
-  history->y2 = history->y1;                                            \
-  history->y1 = output;                                                 \
-  history->x2 = history->x1;                                            \
-  history->x1 = input;                                                  \
-                                                                        \
-  return output;                                                        \
-}                                                                       \
-                                                                        \
-static const guint                                                      \
-history_size_ ## TYPE = sizeof (SecondOrderHistory ## TYPE);            \
-                                                                        \
 static void                                                             \
 gst_iir_equ_process_ ## TYPE (GstIirEqualizer *equ, guint8 *data,       \
 guint size, guint channels)                                             \
 {                                                                       \
   guint frames = size / channels / sizeof (TYPE);                       \
-  guint i, c, f, nf = equ->freq_band_count;                             \
-  TYPE cur;                                                             \
-  GstIirEqualizerBand **filters = equ->bands;                           \
+  guint f, nf = equ->freq_band_count;                                   \
+  TYPE *samples = (TYPE *) data;                                        \
+  TYPE *history = equ->history;                                         \
                                                                         \
-  for (i = 0; i < frames; i++) {                                        \
-    SecondOrderHistory ## TYPE *history = equ->history;                 \
-    for (c = 0; c < channels; c++) {                                    \
-      cur = *((TYPE *) data);                                           \
-      for (f = 0; f < nf; f++) {                                        \
-        cur = one_step_ ## TYPE (filters[f], history, cur);             \
-        history++;                                                      \
-      }                                                                 \
-      *((TYPE *) data) = (TYPE) cur;                                    \
-      data += sizeof (TYPE);                                            \
-    }                                                                   \
+  while (frames > 0) {                                                  \
+    guint n = MIN (frames, BLOCK_FRAMES);                               \
+    const gdouble *coeffs = ramp_coefficients (equ);                    \
+                                                                        \
+    for (f = 0; f < nf; f++)                                            \
+      filter_block_ ## TYPE (coeffs + 5 * f,                            \
+          history + 4 * channels * f, samples, n, channels);            \
+                                                                        \
+    samples += n * channels;                                            \
+    frames -= n;                                                        \
   }                                                                     \
 }
 
+CREATE_FILTER_BLOCK (gfloat);
+CREATE_FILTER_BLOCK (gdouble);
+
 CREATE_OPTIMIZED_FUNCTIONS_INT (gint16, gfloat, -32768.0, 32767.0);
 CREATE_OPTIMIZED_FUNCTIONS (gfloat);
 CREATE_OPTIMIZED_FUNCTIONS (gdouble);
@@ -826,15 +906,10 @@ gst_iir_equalizer_transform_ip (GstBaseTransform * btrans, GstBuffer * buf)
   GstClockTime timestamp;
   GstMapInfo map;
   gint channels = GST_AUDIO_FILTER_CHANNELS (filter);
-  gboolean need_new_coefficients;
 
   if (G_UNLIKELY (channels < 1 || equ->process == NULL))
     return GST_FLOW_NOT_NEGOTIATED;
 
-  BANDS_LOCK (equ);
-  need_new_coefficients = equ->need_new_coefficients;
-  BANDS_UNLOCK (equ);
-
   timestamp = GST_BUFFER_TIMESTAMP (buf);
   timestamp =
       gst_segment_to_stream_time (&btrans->segment, GST_FORMAT_TIME, timestamp);
@@ -852,8 +927,9 @@ gst_iir_equalizer_transform_ip (GstBaseTransform * btrans, GstBuffer * buf)
     }
   }
 
+  /* after syncing so that controlled values are used for this buffer */
   BANDS_LOCK (equ);
-  if (need_new_coefficients) {
+  if (equ->need_new_coefficients) {
     update_coefficients (equ);
   }
   BANDS_UNLOCK (equ);
@@ -887,7 +963,18 @@ gst_iir_equalizer_setup (GstAudioFilter * audio, const GstAudioInfo * info)
       return FALSE;
   }
 
+  g_free (equ->block);
+  equ->block = NULL;
+  if (GST_AUDIO_INFO_FORMAT (info) == GST_AUDIO_FORMAT_S16)
+    equ->block = g_new (gfloat, BLOCK_FRAMES * GST_AUDIO_INFO_CHANNELS (info));
+
   alloc_history (equ, info);
+
+  /* the coefficients depend on the sample rate */
+  BANDS_LOCK (equ);
+  invalidate_coefficients (equ);
+  BANDS_UNLOCK (equ);
+
   return TRUE;
 }
 
@@ -55,12 +55,20 @@ struct _GstIirEqualizer
 
   /* properties */
   guint freq_band_count;
-  /* for each band and channel */
+  /* for each band: x1, x2, y1, y2 of all channels */
   gpointer history;
   guint history_size;
+  /* S16 samples of one block converted for filtering */
+  gpointer block;
 
   gboolean need_new_coefficients;
 
+  /* for each band: a0, a1, a2, b1, b2 currently in use, followed by the
+   * same for the band settings and the per block ramp step */
+  gdouble *coeffs;
+  gboolean coeffs_valid;
+  guint ramp_blocks;
+
   ProcessFunc process;
 };
 
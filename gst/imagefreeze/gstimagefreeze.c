@@ -25,6 +25,11 @@
  * the input. It duplicates the first frame with the framerate requested
  * by downstream, allows seeking and answers queries.
  *
+ * All output buffers share the memory of the input frame, only their
+ * timestamps and offsets differ. If the #GstImageFreeze:qos property is
+ * enabled, frames that would arrive too late downstream are not pushed at
+ * all.
+ *
  * <refsect2>
  * <title>Example launch line</title>
  * |[
@@ -45,7 +50,19 @@
 
 #include "gstimagefreeze.h"
 
+#define DEFAULT_QOS FALSE
+
+enum
+{
+  PROP_0,
+  PROP_QOS
+};
+
 static void gst_image_freeze_finalize (GObject * object);
+static void gst_image_freeze_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_image_freeze_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
 
 static void gst_image_freeze_reset (GstImageFreeze * self);
 
@@ -91,6 +108,21 @@ gst_image_freeze_class_init (GstImageFreezeClass * klass)
   GstElementClass *gstelement_class = GST_ELEMENT_CLASS (klass);
 
   gobject_class->finalize = gst_image_freeze_finalize;
+  gobject_class->set_property = gst_image_freeze_set_property;
+  gobject_class->get_property = gst_image_freeze_get_property;
+
+  /**
+   * GstImageFreeze:qos:
+   *
+   * Handle Quality-of-Service events from downstream and don't push frames
+   * that would be too late anyway.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_QOS,
+      g_param_spec_boolean ("qos", "QoS",
+          "Handle Quality-of-Service events and drop late frames",
+          DEFAULT_QOS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   gstelement_class->change_state =
       GST_DEBUG_FUNCPTR (gst_image_freeze_change_state);
@@ -130,6 +162,8 @@ gst_image_freeze_init (GstImageFreeze * self)
 
   g_mutex_init (&self->lock);
 
+  self->qos = DEFAULT_QOS;
+
   gst_image_freeze_reset (self);
 }
 
@@ -145,6 +179,42 @@ gst_image_freeze_finalize (GObject * object)
   G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
+static void
+gst_image_freeze_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstImageFreeze *self = GST_IMAGE_FREEZE (object);
+
+  switch (prop_id) {
+    case PROP_QOS:
+      g_mutex_lock (&self->lock);
+      self->qos = g_value_get_boolean (value);
+      g_mutex_unlock (&self->lock);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_image_freeze_get_property (GObject * object, guint prop_id, GValue * value,
+    GParamSpec * pspec)
+{
+  GstImageFreeze *self = GST_IMAGE_FREEZE (object);
+
+  switch (prop_id) {
+    case PROP_QOS:
+      g_mutex_lock (&self->lock);
+      g_value_set_boolean (value, self->qos);
+      g_mutex_unlock (&self->lock);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static void
 gst_image_freeze_reset (GstImageFreeze * self)
 {
@@ -159,6 +229,8 @@ gst_image_freeze_reset (GstImageFreeze * self)
   self->fps_n = self->fps_d = 0;
   self->offset = 0;
   self->seqnum = 0;
+  self->earliest_time = GST_CLOCK_TIME_NONE;
+  self->processed = self->dropped = 0;
   g_mutex_unlock (&self->lock);
 
   g_atomic_int_set (&self->seeking, 0);
@@ -554,8 +626,28 @@ gst_image_freeze_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
   GST_LOG_OBJECT (pad, "Got %s event", GST_EVENT_TYPE_NAME (event));
 
   switch (GST_EVENT_TYPE (event)) {
+    case GST_EVENT_QOS:{
+      GstClockTimeDiff diff;
+      GstClockTime timestamp;
+
+      gst_event_parse_qos (event, NULL, NULL, &diff, &timestamp);
+      gst_event_unref (event);
+
+      g_mutex_lock (&self->lock);
+      if (self->qos && GST_CLOCK_TIME_IS_VALID (timestamp)) {
+        /* when late, skip ahead a bit more to catch up */
+        if (diff > 0)
+          self->earliest_time = timestamp + 2 * diff;
+        else
+          self->earliest_time = timestamp + diff;
+        GST_LOG_OBJECT (pad, "earliest time now %" GST_TIME_FORMAT,
+            GST_TIME_ARGS (self->earliest_time));
+      }
+      g_mutex_unlock (&self->lock);
+      ret = TRUE;
+      break;
+    }
     case GST_EVENT_NAVIGATION:
-    case GST_EVENT_QOS:
     case GST_EVENT_LATENCY:
     case GST_EVENT_STEP:
       GST_DEBUG_OBJECT (pad, "Dropping event");
@@ -619,6 +711,7 @@ gst_image_freeze_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
       gst_segment_do_seek (&self->segment, rate, format, flags, start_type,
           start, stop_type, stop, NULL);
       self->need_segment = TRUE;
+      self->earliest_time = GST_CLOCK_TIME_NONE;
       last_stop = self->segment.position;
 
       start_task = self->buffer != NULL;
@@ -670,6 +763,20 @@ gst_image_freeze_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
   return ret;
 }
 
+static gboolean
+gst_image_freeze_buffer_has_no_share_memory (GstBuffer * buffer)
+{
+  guint i, n;
+
+  n = gst_buffer_n_memory (buffer);
+  for (i = 0; i < n; i++) {
+    if (GST_MEMORY_IS_NO_SHARE (gst_buffer_peek_memory (buffer, i)))
+      return TRUE;
+  }
+
+  return FALSE;
+}
+
 static GstFlowReturn
 gst_image_freeze_sink_chain (GstPad * pad, GstObject * parent,
     GstBuffer * buffer)
@@ -684,6 +791,18 @@ gst_image_freeze_sink_chain (GstPad * pad, GstObject * parent,
     return GST_FLOW_EOS;
   }
 
+  /* Output buffers are shallow copies of this one. Memory that can't be
+   * shared would be copied again for every single output frame, so do
+   * that once here. */
+  if (gst_image_freeze_buffer_has_no_share_memory (buffer)) {
+    GstBuffer *copy;
+
+    GST_DEBUG_OBJECT (pad, "Copying buffer with non-shareable memory");
+    copy = gst_buffer_copy (buffer);
+    gst_buffer_unref (buffer);
+    buffer = copy;
+  }
+
   self->buffer = buffer;
 
   gst_pad_start_task (self->srcpad, (GstTaskFunction) gst_image_freeze_src_loop,
@@ -702,6 +821,7 @@ gst_image_freeze_src_loop (GstPad * pad)
   guint64 cstart, cstop;
   gboolean in_seg, eos;
   GstFlowReturn flow_ret = GST_FLOW_OK;
+  GstMessage *qos_msg = NULL;
 
   g_mutex_lock (&self->lock);
   if (!gst_pad_has_current_caps (self->srcpad)) {
@@ -779,6 +899,27 @@ gst_image_freeze_src_loop (GstPad * pad)
     self->segment.position = cstart;
     if (self->segment.rate >= 0)
       self->segment.position = cstop;
+
+    if (self->qos && GST_CLOCK_TIME_IS_VALID (self->earliest_time)) {
+      GstClockTime running_time;
+
+      running_time = gst_segment_to_running_time (&self->segment,
+          GST_FORMAT_TIME, self->segment.rate >= 0 ? cstop : cstart);
+      if (GST_CLOCK_TIME_IS_VALID (running_time)
+          && running_time <= self->earliest_time) {
+        GST_DEBUG_OBJECT (pad, "Dropping late frame, running time %"
+            GST_TIME_FORMAT " <= earliest time %" GST_TIME_FORMAT,
+            GST_TIME_ARGS (running_time), GST_TIME_ARGS (self->earliest_time));
+        qos_msg = gst_message_new_qos (GST_OBJECT_CAST (self), FALSE,
+            running_time, gst_segment_to_stream_time (&self->segment,
+                GST_FORMAT_TIME, cstart), cstart, cstop - cstart);
+        gst_message_set_qos_stats (qos_msg, GST_FORMAT_BUFFERS,
+            self->processed, ++self->dropped);
+        in_seg = FALSE;
+      }
+    }
+    if (in_seg)
+      self->processed++;
   }
 
   if (self->segment.rate >= 0)
@@ -790,6 +931,9 @@ gst_image_freeze_src_loop (GstPad * pad)
   GST_DEBUG_OBJECT (pad, "Handling buffer with timestamp %" GST_TIME_FORMAT,
       GST_TIME_ARGS (timestamp));
 
+  if (qos_msg)
+    gst_element_post_message (GST_ELEMENT_CAST (self), qos_msg);
+
   if (in_seg) {
     GST_BUFFER_DTS (buffer) = GST_CLOCK_TIME_NONE;
     GST_BUFFER_PTS (buffer) = cstart;
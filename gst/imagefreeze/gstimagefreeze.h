@@ -57,6 +57,11 @@ struct _GstImageFreeze
 
   guint64 offset;
 
+  /* QoS, protected by lock */
+  gboolean qos;
+  GstClockTime earliest_time;
+  guint64 processed, dropped;
+
   /* TRUE if currently doing a flushing seek, protected
    * by srcpad's stream lock */
   gint seeking;
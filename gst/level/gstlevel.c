@@ -91,6 +91,31 @@
  * </listitem>
  * </itemizedlist>
  *
+ * If the #GstLevel:packed-messages property is %TRUE, the
+ * <classname>&quot;rms&quot;</classname>,
+ * <classname>&quot;peak&quot;</classname> and
+ * <classname>&quot;decay&quot;</classname> fields are #GBytes containing one
+ * native endian #gdouble per channel instead, which is a lot cheaper for
+ * streams with many channels and short intervals.
+ *
+ * If the #GstLevel:meter-file property is set, the levels of every interval
+ * are also written to a block of memory that is shared with other processes
+ * by mapping the given file, e.g. a file in /dev/shm. Together with
+ * #GstLevel:post-messages set to %FALSE this avoids the bus completely. The
+ * block contains, all in native endianness:
+ * <itemizedlist>
+ * <listitem><para>#guint32 magic, 0x4c564c47</para></listitem>
+ * <listitem><para>#guint32 version, 1</para></listitem>
+ * <listitem><para>#guint32 number of channels</para></listitem>
+ * <listitem><para>#guint32 sequence number</para></listitem>
+ * <listitem><para>#guint64 timestamp, running time and duration
+ * </para></listitem>
+ * <listitem><para>#gdouble RMS, peak and decay in dB for each channel, in
+ * three arrays of one value per channel</para></listitem>
+ * </itemizedlist>
+ * The sequence number is odd while the block is being updated. Readers copy
+ * the values when it is even and have to retry if it changed meanwhile.
+ *
  * <refsect2>
  * <title>Example application</title>
  * <informalexample><programlisting language="C">
@@ -111,6 +136,14 @@
 #include <math.h>
 #include <gst/gst.h>
 #include <gst/audio/audio.h>
+#include <glib/gstdio.h>
+
+#ifdef HAVE_MMAP
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
 
 #include "gstlevel.h"
 
@@ -119,6 +152,22 @@ GST_DEBUG_CATEGORY_STATIC (level_debug);
 
 #define EPSILON 1e-35f
 
+#define METER_BLOCK_MAGIC 0x4c564c47    /* "GLVL" */
+#define METER_BLOCK_VERSION 1
+
+/* header of the shared memory meter block, followed by RMS, peak and decay
+ * of all channels */
+typedef struct
+{
+  guint32 magic;
+  guint32 version;
+  guint32 channels;
+  volatile gint sequence;
+  guint64 timestamp;
+  guint64 running_time;
+  guint64 duration;
+} GstLevelMeterBlock;
+
 static GstStaticPadTemplate sink_template_factory =
 GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -148,7 +197,9 @@ enum
   PROP_MESSAGE,
   PROP_INTERVAL,
   PROP_PEAK_TTL,
-  PROP_PEAK_FALLOFF
+  PROP_PEAK_FALLOFF,
+  PROP_PACKED_MESSAGES,
+  PROP_METER_FILE
 };
 
 #define gst_level_parent_class parent_class
@@ -163,6 +214,7 @@ static void gst_level_finalize (GObject * obj);
 static gboolean gst_level_set_caps (GstBaseTransform * trans, GstCaps * in,
     GstCaps * out);
 static gboolean gst_level_start (GstBaseTransform * trans);
+static gboolean gst_level_stop (GstBaseTransform * trans);
 static GstFlowReturn gst_level_transform_ip (GstBaseTransform * trans,
     GstBuffer * in);
 static void gst_level_post_message (GstLevel * filter);
@@ -221,6 +273,33 @@ gst_level_class_init (GstLevelClass * klass)
       g_param_spec_double ("peak-falloff", "Peak Falloff",
           "Decay rate of decay peak after TTL (in dB/sec)",
           0.0, G_MAXDOUBLE, 10.0, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstLevel:packed-messages
+   *
+   * Put the levels into the message as #GBytes with one #gdouble per channel
+   * instead of #GValueArray.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_PACKED_MESSAGES,
+      g_param_spec_boolean ("packed-messages", "Packed Messages",
+          "Post the levels of all channels as packed arrays of doubles "
+          "instead of value arrays", FALSE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstLevel:meter-file
+   *
+   * File to map as shared memory meter block and to write the levels of
+   * every interval to. See the element documentation for the layout.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_METER_FILE,
+      g_param_spec_string ("meter-file", "Meter File",
+          "File to map as shared memory meter block for publishing levels "
+          "(NULL = none)", NULL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS |
+          GST_PARAM_MUTABLE_READY));
 
   GST_DEBUG_CATEGORY_INIT (level_debug, "level", 0, "Level calculation");
 
@@ -235,6 +314,7 @@ gst_level_class_init (GstLevelClass * klass)
 
   trans_class->set_caps = GST_DEBUG_FUNCPTR (gst_level_set_caps);
   trans_class->start = GST_DEBUG_FUNCPTR (gst_level_start);
+  trans_class->stop = GST_DEBUG_FUNCPTR (gst_level_stop);
   trans_class->transform_ip = GST_DEBUG_FUNCPTR (gst_level_transform_ip);
   trans_class->sink_event = GST_DEBUG_FUNCPTR (gst_level_sink_event);
   trans_class->passthrough_on_same_caps = TRUE;
@@ -249,6 +329,8 @@ gst_level_init (GstLevel * filter)
   filter->decay_peak = NULL;
   filter->decay_peak_base = NULL;
   filter->decay_peak_age = NULL;
+  filter->block_CS = NULL;
+  filter->levels = NULL;
 
   gst_audio_info_init (&filter->info);
 
@@ -274,6 +356,9 @@ gst_level_finalize (GObject * obj)
   g_free (filter->decay_peak);
   g_free (filter->decay_peak_base);
   g_free (filter->decay_peak_age);
+  g_free (filter->block_CS);
+  g_free (filter->levels);
+  g_free (filter->meter_file);
 
   filter->CS = NULL;
   filter->peak = NULL;
@@ -281,6 +366,9 @@ gst_level_finalize (GObject * obj)
   filter->decay_peak = NULL;
   filter->decay_peak_base = NULL;
   filter->decay_peak_age = NULL;
+  filter->block_CS = NULL;
+  filter->levels = NULL;
+  filter->meter_file = NULL;
 
   G_OBJECT_CLASS (parent_class)->finalize (obj);
 }
@@ -312,6 +400,13 @@ gst_level_set_property (GObject * object, guint prop_id,
     case PROP_PEAK_FALLOFF:
       filter->decay_peak_falloff = g_value_get_double (value);
       break;
+    case PROP_PACKED_MESSAGES:
+      filter->packed_messages = g_value_get_boolean (value);
+      break;
+    case PROP_METER_FILE:
+      g_free (filter->meter_file);
+      filter->meter_file = g_value_dup_string (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -339,6 +434,12 @@ gst_level_get_property (GObject * object, guint prop_id,
     case PROP_PEAK_FALLOFF:
       g_value_set_double (value, filter->decay_peak_falloff);
       break;
+    case PROP_PACKED_MESSAGES:
+      g_value_set_boolean (value, filter->packed_messages);
+      break;
+    case PROP_METER_FILE:
+      g_value_set_string (value, filter->meter_file);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -346,18 +447,22 @@ gst_level_get_property (GObject * object, guint prop_id,
 }
 
 
-/* process one (interleaved) channel of incoming samples
- * calculate square sum of samples
+/* process all channels of incoming (interleaved) samples
+ * calculate square sum of samples for each channel
  * normalize and average over number of samples
- * returns a normalized cumulative square value, which can be averaged
+ * returns normalized cumulative square values, which can be averaged
  * to return the average power as a double between 0 and 1
- * also returns the normalized peak power (square of the highest amplitude)
+ * also returns the normalized peak powers (square of the highest amplitude)
  *
  * caller must assure num is a multiple of channels
- * samples for multiple channels are interleaved
+ * NCS and NPS have one value per channel
  * input sample data enters in *in_data and is not modified
  * this filter only accepts signed audio data, so mid level is always 0
  *
+ * all channels of a frame are handled in the inner loop, which has no
+ * dependencies between iterations and can be vectorized by the compiler.
+ * Every channel still sums up its squares in the same order as before.
+ *
  * for integers, this code considers the non-existant positive max value to be
  * full-scale; so max-1 will not map to 1.0
  */
@@ -368,69 +473,60 @@ gst_level_calculate_##TYPE (gpointer data, guint num, guint channels,         \
                             gdouble *NCS, gdouble *NPS)                       \
 {                                                                             \
   TYPE * in = (TYPE *)data;                                                   \
-  register guint j;                                                           \
-  gdouble squaresum = 0.0;           /* square sum of the input samples */    \
-  register gdouble square = 0.0;     /* Square */                             \
-  register gdouble peaksquare = 0.0; /* Peak Square Sample */                 \
+  guint i, j;                                                                 \
+  gdouble square;                    /* Square */                             \
   gdouble normalizer;                /* divisor to get a [-1.0, 1.0] range */ \
                                                                               \
-  /* *NCS = 0.0; Normalized Cumulative Square */                              \
-  /* *NPS = 0.0; Normalized Peak Square */                                    \
+  for (i = 0; i < channels; i++) {                                            \
+    NCS[i] = 0.0;                    /* Normalized Cumulative Square */       \
+    NPS[i] = 0.0;                    /* Normalized Peak Square */             \
+  }                                                                           \
                                                                               \
   for (j = 0; j < num; j += channels) {                                       \
-    square = ((gdouble) in[j]) * in[j];                                       \
-    if (square > peaksquare) peaksquare = square;                             \
-    squaresum += square;                                                      \
+    for (i = 0; i < channels; i++) {                                          \
+      square = ((gdouble) in[j + i]) * in[j + i];                             \
+      NPS[i] = (square > NPS[i]) ? square : NPS[i];                           \
+      NCS[i] += square;                                                       \
+    }                                                                         \
   }                                                                           \
                                                                               \
   normalizer = (gdouble) (G_GINT64_CONSTANT(1) << (RESOLUTION * 2));          \
-  *NCS = squaresum / normalizer;                                              \
-  *NPS = peaksquare / normalizer;                                             \
+  for (i = 0; i < channels; i++) {                                            \
+    NCS[i] /= normalizer;                                                     \
+    NPS[i] /= normalizer;                                                     \
+  }                                                                           \
 }
 
 DEFINE_INT_LEVEL_CALCULATOR (gint32, 31);
 DEFINE_INT_LEVEL_CALCULATOR (gint16, 15);
 DEFINE_INT_LEVEL_CALCULATOR (gint8, 7);
 
-/* FIXME: use orc to calculate squaresums? */
 #define DEFINE_FLOAT_LEVEL_CALCULATOR(TYPE)                                   \
 static void inline                                                            \
 gst_level_calculate_##TYPE (gpointer data, guint num, guint channels,         \
                             gdouble *NCS, gdouble *NPS)                       \
 {                                                                             \
   TYPE * in = (TYPE *)data;                                                   \
-  register guint j;                                                           \
-  gdouble squaresum = 0.0;           /* square sum of the input samples */    \
-  register gdouble square = 0.0;     /* Square */                             \
-  register gdouble peaksquare = 0.0; /* Peak Square Sample */                 \
+  guint i, j;                                                                 \
+  gdouble square;                    /* Square */                             \
                                                                               \
-  /* *NCS = 0.0; Normalized Cumulative Square */                              \
-  /* *NPS = 0.0; Normalized Peak Square */                                    \
+  for (i = 0; i < channels; i++) {                                            \
+    NCS[i] = 0.0;                    /* Normalized Cumulative Square */       \
+    NPS[i] = 0.0;                    /* Normalized Peak Square */             \
+  }                                                                           \
                                                                               \
-  /* orc_level_squaresum_f64(&squaresum,in,num); */                           \
   for (j = 0; j < num; j += channels) {                                       \
-    square = ((gdouble) in[j]) * in[j];                                       \
-    if (square > peaksquare) peaksquare = square;                             \
-    squaresum += square;                                                      \
+    for (i = 0; i < channels; i++) {                                          \
+      square = ((gdouble) in[j + i]) * in[j + i];                             \
+      NPS[i] = (square > NPS[i]) ? square : NPS[i];                           \
+      NCS[i] += square;                                                       \
+    }                                                                         \
   }                                                                           \
-                                                                              \
-  *NCS = squaresum;                                                           \
-  *NPS = peaksquare;                                                          \
 }
 
 DEFINE_FLOAT_LEVEL_CALCULATOR (gfloat);
 DEFINE_FLOAT_LEVEL_CALCULATOR (gdouble);
 
-/* we would need stride to deinterleave also
-static void inline
-gst_level_calculate_gdouble (gpointer data, guint num, guint channels,
-                            gdouble *NCS, gdouble *NPS)
-{
-  orc_level_squaresum_f64(NCS,(gdouble *)data,num);
-  *NPS = 0.0;
-}
-*/
-
 static void
 gst_level_recalc_interval_frames (GstLevel * level)
 {
@@ -455,6 +551,84 @@ gst_level_recalc_interval_frames (GstLevel * level)
       GST_TIME_ARGS (interval), sample_rate);
 }
 
+static void
+gst_level_close_meter_block (GstLevel * filter)
+{
+#ifdef HAVE_MMAP
+  if (filter->meter_block)
+    munmap (filter->meter_block, filter->meter_block_size);
+#endif
+  filter->meter_block = NULL;
+  filter->meter_block_size = 0;
+}
+
+static gboolean
+gst_level_open_meter_block (GstLevel * filter, gint channels)
+{
+#ifdef HAVE_MMAP
+  GstLevelMeterBlock *block;
+  gsize size;
+  gint fd;
+
+  gst_level_close_meter_block (filter);
+
+  if (filter->meter_file == NULL)
+    return TRUE;
+
+  size = sizeof (GstLevelMeterBlock) + 3 * channels * sizeof (gdouble);
+
+  fd = g_open (filter->meter_file, O_RDWR | O_CREAT, 0644);
+  if (fd < 0)
+    goto open_failed;
+
+  if (ftruncate (fd, size) < 0)
+    goto map_failed;
+
+  block = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (block == MAP_FAILED)
+    goto map_failed;
+
+  /* the mapping stays valid without the file descriptor */
+  close (fd);
+
+  memset (block, 0, size);
+  block->magic = METER_BLOCK_MAGIC;
+  block->version = METER_BLOCK_VERSION;
+  block->channels = channels;
+
+  filter->meter_block = block;
+  filter->meter_block_size = size;
+
+  GST_INFO_OBJECT (filter, "mapped meter block of %" G_GSIZE_FORMAT
+      " bytes from %s", size, filter->meter_file);
+
+  return TRUE;
+
+open_failed:
+  {
+    GST_ELEMENT_ERROR (filter, RESOURCE, OPEN_READ_WRITE, (NULL),
+        ("Could not open meter file \"%s\": %s", filter->meter_file,
+            g_strerror (errno)));
+    return FALSE;
+  }
+map_failed:
+  {
+    GST_ELEMENT_ERROR (filter, RESOURCE, OPEN_READ_WRITE, (NULL),
+        ("Could not map meter file \"%s\": %s", filter->meter_file,
+            g_strerror (errno)));
+    close (fd);
+    return FALSE;
+  }
+#else
+  if (filter->meter_file == NULL)
+    return TRUE;
+
+  GST_ELEMENT_ERROR (filter, RESOURCE, OPEN_READ_WRITE, (NULL),
+      ("Meter blocks are not supported on this platform"));
+  return FALSE;
+#endif
+}
+
 static gboolean
 gst_level_set_caps (GstBaseTransform * trans, GstCaps * in, GstCaps * out)
 {
@@ -497,6 +671,8 @@ gst_level_set_caps (GstBaseTransform * trans, GstCaps * in, GstCaps * out)
   g_free (filter->decay_peak);
   g_free (filter->decay_peak_base);
   g_free (filter->decay_peak_age);
+  g_free (filter->block_CS);
+  g_free (filter->levels);
   filter->CS = g_new (gdouble, channels);
   filter->peak = g_new (gdouble, channels);
   filter->last_peak = g_new (gdouble, channels);
@@ -504,6 +680,8 @@ gst_level_set_caps (GstBaseTransform * trans, GstCaps * in, GstCaps * out)
   filter->decay_peak_base = g_new (gdouble, channels);
 
   filter->decay_peak_age = g_new (GstClockTime, channels);
+  filter->block_CS = g_new (gdouble, channels);
+  filter->levels = g_new (gdouble, 3 * channels);
 
   for (i = 0; i < channels; ++i) {
     filter->CS[i] = filter->peak[i] = filter->last_peak[i] =
@@ -513,7 +691,7 @@ gst_level_set_caps (GstBaseTransform * trans, GstCaps * in, GstCaps * out)
 
   gst_level_recalc_interval_frames (filter);
 
-  return TRUE;
+  return gst_level_open_meter_block (filter, channels);
 }
 
 static gboolean
@@ -527,6 +705,16 @@ gst_level_start (GstBaseTransform * trans)
   return TRUE;
 }
 
+static gboolean
+gst_level_stop (GstBaseTransform * trans)
+{
+  GstLevel *filter = GST_LEVEL (trans);
+
+  gst_level_close_meter_block (filter);
+
+  return TRUE;
+}
+
 static GstMessage *
 gst_level_message_new (GstLevel * level, GstClockTime timestamp,
     GstClockTime duration)
@@ -535,6 +723,9 @@ gst_level_message_new (GstLevel * level, GstClockTime timestamp,
   GstStructure *s;
   GValue v = { 0, };
   GstClockTime endtime, running_time, stream_time;
+  gint channels = GST_AUDIO_INFO_CHANNELS (&level->info);
+  const gchar *fields[3] = { "rms", "peak", "decay" };
+  gint i, j;
 
   running_time = gst_segment_to_running_time (&trans->segment, GST_FORMAT_TIME,
       timestamp);
@@ -550,50 +741,53 @@ gst_level_message_new (GstLevel * level, GstClockTime timestamp,
       "running-time", G_TYPE_UINT64, running_time,
       "duration", G_TYPE_UINT64, duration, NULL);
 
-  g_value_init (&v, G_TYPE_VALUE_ARRAY);
-  g_value_take_boxed (&v, g_value_array_new (0));
-  gst_structure_take_value (s, "rms", &v);
-
-  g_value_init (&v, G_TYPE_VALUE_ARRAY);
-  g_value_take_boxed (&v, g_value_array_new (0));
-  gst_structure_take_value (s, "peak", &v);
+  /* levels contains the rms, peak and decay values of all channels */
+  for (i = 0; i < 3; i++) {
+    const gdouble *values = level->levels + i * channels;
+
+    if (level->packed_messages) {
+      g_value_init (&v, G_TYPE_BYTES);
+      g_value_take_boxed (&v,
+          g_bytes_new (values, channels * sizeof (gdouble)));
+    } else {
+      GValueArray *arr = g_value_array_new (channels);
+      GValue d = { 0, };
+
+      g_value_init (&d, G_TYPE_DOUBLE);
+      for (j = 0; j < channels; j++) {
+        g_value_set_double (&d, values[j]);
+        g_value_array_append (arr, &d); /* copies by value */
+      }
+      g_value_unset (&d);
 
-  g_value_init (&v, G_TYPE_VALUE_ARRAY);
-  g_value_take_boxed (&v, g_value_array_new (0));
-  gst_structure_take_value (s, "decay", &v);
+      g_value_init (&v, G_TYPE_VALUE_ARRAY);
+      g_value_take_boxed (&v, arr);
+    }
+    gst_structure_take_value (s, fields[i], &v);
+  }
 
   return gst_message_new_element (GST_OBJECT (level), s);
 }
 
 static void
-gst_level_message_append_channel (GstMessage * m, gdouble rms, gdouble peak,
-    gdouble decay)
+gst_level_publish_meter_block (GstLevel * level, GstClockTime timestamp,
+    GstClockTime duration)
 {
-  const GValue *array_val;
-  GstStructure *s;
-  GValueArray *arr;
-  GValue v = { 0, };
-
-  g_value_init (&v, G_TYPE_DOUBLE);
-
-  s = (GstStructure *) gst_message_get_structure (m);
-
-  array_val = gst_structure_get_value (s, "rms");
-  arr = (GValueArray *) g_value_get_boxed (array_val);
-  g_value_set_double (&v, rms);
-  g_value_array_append (arr, &v);       /* copies by value */
+  GstBaseTransform *trans = GST_BASE_TRANSFORM_CAST (level);
+  GstLevelMeterBlock *block = level->meter_block;
+  gint channels = GST_AUDIO_INFO_CHANNELS (&level->info);
 
-  array_val = gst_structure_get_value (s, "peak");
-  arr = (GValueArray *) g_value_get_boxed (array_val);
-  g_value_set_double (&v, peak);
-  g_value_array_append (arr, &v);       /* copies by value */
+  /* odd sequence number while updating, the atomic operations are full
+   * memory barriers */
+  g_atomic_int_inc (&block->sequence);
 
-  array_val = gst_structure_get_value (s, "decay");
-  arr = (GValueArray *) g_value_get_boxed (array_val);
-  g_value_set_double (&v, decay);
-  g_value_array_append (arr, &v);       /* copies by value */
+  block->timestamp = timestamp;
+  block->running_time = gst_segment_to_running_time (&trans->segment,
+      GST_FORMAT_TIME, timestamp);
+  block->duration = duration;
+  memcpy (block + 1, level->levels, 3 * channels * sizeof (gdouble));
 
-  g_value_unset (&v);
+  g_atomic_int_inc (&block->sequence);
 }
 
 static GstFlowReturn
@@ -603,7 +797,6 @@ gst_level_transform_ip (GstBaseTransform * trans, GstBuffer * in)
   GstMapInfo map;
   guint8 *in_data;
   gsize in_size;
-  gdouble CS;
   guint i;
   guint num_frames;
   guint num_int_samples = 0;    /* number of interleaved samples
@@ -644,14 +837,17 @@ gst_level_transform_ip (GstBaseTransform * trans, GstBuffer * in)
     block_size = MIN (block_size, num_frames);
     block_int_size = block_size * channels;
 
+    if (!GST_BUFFER_FLAG_IS_SET (in, GST_BUFFER_FLAG_GAP)) {
+      filter->process (in_data, block_int_size, channels, filter->block_CS,
+          filter->peak);
+    }
+
     for (i = 0; i < channels; ++i) {
       if (!GST_BUFFER_FLAG_IS_SET (in, GST_BUFFER_FLAG_GAP)) {
-        filter->process (in_data + (bps * i), block_int_size, channels, &CS,
-            &filter->peak[i]);
         GST_LOG_OBJECT (filter,
             "[%d]: cumulative squares %lf, over %d samples/%d channels",
-            i, CS, block_int_size, channels);
-        filter->CS[i] += CS;
+            i, filter->block_CS[i], block_int_size, channels);
+        filter->CS[i] += filter->block_CS[i];
       } else {
         filter->peak[i] = 0.0;
       }
@@ -728,9 +924,10 @@ gst_level_post_message (GstLevel * filter)
   rate = GST_AUDIO_INFO_RATE (&filter->info);
   duration = GST_FRAMES_TO_CLOCK_TIME (frames, rate);
 
-  if (filter->post_messages) {
-    GstMessage *m =
-        gst_level_message_new (filter, filter->message_ts, duration);
+  if (filter->post_messages || filter->meter_block) {
+    gdouble *RMSdB = filter->levels;
+    gdouble *peakdB = RMSdB + channels;
+    gdouble *decaydB = peakdB + channels;
 
     GST_LOG_OBJECT (filter,
         "message: ts %" GST_TIME_FORMAT ", duration %" GST_TIME_FORMAT
@@ -739,7 +936,6 @@ gst_level_post_message (GstLevel * filter)
 
     for (i = 0; i < channels; ++i) {
       gdouble RMS;
-      gdouble RMSdB, peakdB, decaydB;
 
       RMS = sqrt (filter->CS[i] / frames);
       GST_LOG_OBJECT (filter,
@@ -748,32 +944,34 @@ gst_level_post_message (GstLevel * filter)
           "message: last_peak: %f, decay_peak: %f",
           filter->last_peak[i], filter->decay_peak[i]);
       /* RMS values are calculated in amplitude, so 20 * log 10 */
-      RMSdB = 20 * log10 (RMS + EPSILON);
+      RMSdB[i] = 20 * log10 (RMS + EPSILON);
       /* peak values are square sums, ie. power, so 10 * log 10 */
-      peakdB = 10 * log10 (filter->last_peak[i] + EPSILON);
-      decaydB = 10 * log10 (filter->decay_peak[i] + EPSILON);
+      peakdB[i] = 10 * log10 (filter->last_peak[i] + EPSILON);
+      decaydB[i] = 10 * log10 (filter->decay_peak[i] + EPSILON);
 
       if (filter->decay_peak[i] < filter->last_peak[i]) {
         /* this can happen in certain cases, for example when
          * the last peak is between decay_peak and decay_peak_base */
         GST_DEBUG_OBJECT (filter,
             "message: decay peak dB %f smaller than last peak dB %f, copying",
-            decaydB, peakdB);
+            decaydB[i], peakdB[i]);
         filter->decay_peak[i] = filter->last_peak[i];
       }
       GST_LOG_OBJECT (filter,
           "message: RMS %f dB, peak %f dB, decay %f dB",
-          RMSdB, peakdB, decaydB);
-
-      gst_level_message_append_channel (m, RMSdB, peakdB, decaydB);
+          RMSdB[i], peakdB[i], decaydB[i]);
 
       /* reset cumulative and normal peak */
       filter->CS[i] = 0.0;
       filter->last_peak[i] = 0.0;
     }
 
-    gst_element_post_message (GST_ELEMENT (filter), m);
+    if (filter->meter_block)
+      gst_level_publish_meter_block (filter, filter->message_ts, duration);
 
+    if (filter->post_messages)
+      gst_element_post_message (GST_ELEMENT (filter),
+          gst_level_message_new (filter, filter->message_ts, duration));
   }
   filter->num_frames -= frames;
   filter->message_ts += duration;
@@ -61,6 +61,8 @@ struct _GstLevel {
   guint64 interval;             /* how many nanoseconds between emits */
   gdouble decay_peak_ttl;       /* time to live for peak in nanoseconds */
   gdouble decay_peak_falloff;   /* falloff in dB/sec */
+  gboolean packed_messages;     /* post levels as packed arrays */
+  gchar *meter_file;            /* file to map the meter block from */
 
   GstAudioInfo info;
   gint num_frames;              /* frame count (1 sample per channel)
@@ -75,6 +77,12 @@ struct _GstLevel {
   gdouble *decay_peak;          /* running decaying normalized Peak */
   gdouble *decay_peak_base;     /* value of last peak we are decaying from */
   GstClockTime *decay_peak_age; /* age of last peak */
+  gdouble *block_CS;            /* normalized Cumulative Square over block */
+  gdouble *levels;              /* RMS, peak and decay in dB for all channels */
+
+  /* shared memory meter block */
+  gpointer meter_block;
+  gsize meter_block_size;
 
   void (*process)(gpointer, guint, guint, gdouble*, gdouble*);
 };
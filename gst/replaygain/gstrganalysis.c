@@ -42,6 +42,9 @@
  * needed for album processing (see #GstRgAnalysis:num-tracks property) since
  * the album gain and peak values need to be associated with all tracks of an
  * album, not just the last one.
+ *
+ * The tracks of one album can also be analyzed in parallel by several
+ * elements, see the #GstRgAnalysis:album-state property.
  * 
  * <refsect2>
  * <title>Example launch lines</title>
@@ -97,7 +100,8 @@ enum
   PROP_NUM_TRACKS,
   PROP_FORCED,
   PROP_REFERENCE_LEVEL,
-  PROP_MESSAGE
+  PROP_MESSAGE,
+  PROP_ALBUM_STATE
 };
 
 /* The ReplayGain algorithm is intended for use with mono and stereo
@@ -259,6 +263,31 @@ gst_rg_analysis_class_init (GstRgAnalysisClass * klass)
           DEFAULT_MESSAGE,
           G_PARAM_READWRITE | G_PARAM_CONSTRUCT | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstRgAnalysis:album-state:
+   *
+   * Intermediate results of the album processing.
+   *
+   * Reading this property returns the combined analysis data of all tracks of
+   * the current album that finished so far as opaque #GBytes.  Setting it adds
+   * the given data of another element to the album, the album gain and peak
+   * are then exactly the same as if all tracks had been analyzed by this
+   * element.  Both is only possible while the element is in the PAUSED or
+   * PLAYING state.
+   *
+   * This allows to analyze the tracks of one album in parallel: Analyze a
+   * subset of the tracks in each of several pipelines with
+   * #GstRgAnalysis:num-tracks kept above 1, read the album state of all but
+   * one of them after their last track and set it on the remaining element
+   * before setting #GstRgAnalysis:num-tracks to 1 for its last track.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_ALBUM_STATE,
+      g_param_spec_boxed ("album-state", "Album state",
+          "Analysis data of the finished tracks of the current album",
+          G_TYPE_BYTES, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   trans_class = (GstBaseTransformClass *) klass;
   trans_class->start = GST_DEBUG_FUNCPTR (gst_rg_analysis_start);
   trans_class->set_caps = GST_DEBUG_FUNCPTR (gst_rg_analysis_set_caps);
@@ -314,6 +343,18 @@ gst_rg_analysis_set_property (GObject * object, guint prop_id,
     case PROP_MESSAGE:
       filter->message = g_value_get_boolean (value);
       break;
+    case PROP_ALBUM_STATE:{
+      GBytes *state = g_value_get_boxed (value);
+
+      if (state == NULL)
+        break;
+      if (filter->ctx == NULL) {
+        GST_WARNING_OBJECT (filter, "can't merge album state when stopped");
+      } else if (!rg_analysis_merge_album_state (filter->ctx, state)) {
+        GST_WARNING_OBJECT (filter, "invalid album state");
+      }
+      break;
+    }
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -341,6 +382,12 @@ gst_rg_analysis_get_property (GObject * object, guint prop_id,
     case PROP_MESSAGE:
       g_value_set_boolean (value, filter->message);
       break;
+    case PROP_ALBUM_STATE:
+      if (filter->ctx)
+        g_value_take_boxed (value, rg_analysis_get_album_state (filter->ctx));
+      else
+        g_value_set_boxed (value, NULL);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -379,8 +426,8 @@ gst_rg_analysis_start (GstBaseTransform * base)
   filter->has_album_gain = FALSE;
   filter->has_album_peak = FALSE;
 
-  filter->ctx = rg_analysis_new ();
   GST_OBJECT_LOCK (filter);
+  filter->ctx = rg_analysis_new ();
   rg_analysis_init_silence_detection (filter->ctx, gst_rg_analysis_post_message,
       filter);
   GST_OBJECT_UNLOCK (filter);
@@ -522,8 +569,10 @@ gst_rg_analysis_stop (GstBaseTransform * base)
 
   g_return_val_if_fail (filter->ctx != NULL, FALSE);
 
+  GST_OBJECT_LOCK (filter);
   rg_analysis_destroy (filter->ctx);
   filter->ctx = NULL;
+  GST_OBJECT_UNLOCK (filter);
 
   GST_LOG_OBJECT (filter, "stopped");
 
@@ -578,7 +627,9 @@ gst_rg_analysis_handle_tags (GstRgAnalysis * filter,
   }
 
   filter->skip = TRUE;
+  GST_OBJECT_LOCK (filter);
   rg_analysis_reset (filter->ctx);
+  GST_OBJECT_UNLOCK (filter);
 
   if (!album_processing) {
     GST_DEBUG_OBJECT (filter,
@@ -624,8 +675,11 @@ gst_rg_analysis_handle_eos (GstRgAnalysis * filter)
 
     if (album_finished)
       album_success = gst_rg_analysis_album_result (filter, &tag_list);
-    else if (!album_processing)
+    else if (!album_processing) {
+      GST_OBJECT_LOCK (filter);
       rg_analysis_reset_album (filter->ctx);
+      GST_OBJECT_UNLOCK (filter);
+    }
 
     if (track_success || album_success) {
       GST_LOG_OBJECT (filter, "posting tag list with results");
@@ -660,8 +714,11 @@ gst_rg_analysis_track_result (GstRgAnalysis * filter, GstTagList ** tag_list)
   gboolean track_success;
   gdouble track_gain, track_peak;
 
+  /* The album accumulator might be accessed by the album-state property */
+  GST_OBJECT_LOCK (filter);
   track_success = rg_analysis_track_result (filter->ctx, &track_gain,
       &track_peak);
+  GST_OBJECT_UNLOCK (filter);
 
   if (track_success) {
     track_gain += filter->reference_level - RG_REFERENCE_LEVEL;
@@ -687,8 +744,10 @@ gst_rg_analysis_album_result (GstRgAnalysis * filter, GstTagList ** tag_list)
   gboolean album_success;
   gdouble album_gain, album_peak;
 
+  GST_OBJECT_LOCK (filter);
   album_success = rg_analysis_album_result (filter->ctx, &album_gain,
       &album_peak);
+  GST_OBJECT_UNLOCK (filter);
 
   if (album_success) {
     album_gain += filter->reference_level - RG_REFERENCE_LEVEL;
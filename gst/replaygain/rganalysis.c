@@ -41,6 +41,11 @@
  * to the filter's order number of samples).  This explains the whole
  * lot of memcpy'ing done in rg_analysis_analyze and why the context
  * holds so many buffers.
+ *
+ * All buffers hold the two channels interleaved.  The recursion of the
+ * filters only allows parallelism between the channels, so both
+ * channels are filtered side by side with the very same operations,
+ * which the compiler turns into SIMD instructions.
  */
 
 #include <math.h>
@@ -79,24 +84,30 @@ struct _RgAnalysisAcc
 
 typedef struct _RgAnalysisAcc RgAnalysisAcc;
 
+/* Serialized album accumulator, see rg_analysis_get_album_state. */
+
+#define ALBUM_STATE_MAGIC 0x52474153    /* "RGAS" */
+
+struct _RgAnalysisAlbumState
+{
+  guint32 magic;
+  guint32 size;
+  RgAnalysisAcc acc;
+};
+
+typedef struct _RgAnalysisAlbumState RgAnalysisAlbumState;
+
 /* Analysis context. */
 
 struct _RgAnalysisCtx
 {
-  /* Filter buffers for left channel. */
-  gfloat inprebuf_l[MAX_ORDER * 2];
-  gfloat *inpre_l;
-  gfloat stepbuf_l[MAX_SAMPLE_WINDOW + MAX_ORDER];
-  gfloat *step_l;
-  gfloat outbuf_l[MAX_SAMPLE_WINDOW + MAX_ORDER];
-  gfloat *out_l;
-  /* Filter buffers for right channel. */
-  gfloat inprebuf_r[MAX_ORDER * 2];
-  gfloat *inpre_r;
-  gfloat stepbuf_r[MAX_SAMPLE_WINDOW + MAX_ORDER];
-  gfloat *step_r;
-  gfloat outbuf_r[MAX_SAMPLE_WINDOW + MAX_ORDER];
-  gfloat *out_r;
+  /* Filter buffers, both channels interleaved. */
+  gfloat inprebuf[MAX_ORDER * 2 * 2];
+  gfloat *inpre;
+  gfloat stepbuf[(MAX_SAMPLE_WINDOW + MAX_ORDER) * 2];
+  gfloat *step;
+  gfloat outbuf[(MAX_SAMPLE_WINDOW + MAX_ORDER) * 2];
+  gfloat *out;
 
   /* Number of samples to reach duration of the RMS window: */
   guint window_n_samples;
@@ -228,24 +239,35 @@ static const gfloat BButter[9][3] = {
 #endif
 
 /* Filter functions.  These access elements with negative indices of
- * the input and output arrays (up to the filter's order). */
+ * the input and output arrays (up to the filter's order).  Input and
+ * output hold the samples of both channels interleaved. */
 
-/* For much better performance, the function below has been
- * implemented by unrolling the inner loop for our two use cases. */
+/* The functions below are specialized versions of this generic one
+ * for our two use cases.  The inner loop runs over the two channels,
+ * so that the compiler can filter both of them at once with SIMD
+ * instructions.  The order of the operations is the same for every
+ * channel and the same as for the historical one channel at a time
+ * implementation, so the results are bit-exact. */
 
 /*
  * static inline void
  * apply_filter (const gfloat * input, gfloat * output, guint n_samples,
  *     const gfloat * a, const gfloat * b, guint order)
  * {
- *   gfloat y;
- *   gint i, k;
+ *   gfloat y[2];
+ *   gint c, i, k;
  * 
- *   for (i = 0; i < n_samples; i++) {
- *     y = input[i] * b[0];
- *     for (k = 1; k <= order; k++)
- *       y += input[i - k] * b[k] - output[i - k] * a[k];
- *     output[i] = y;
+ *   for (i = 0; i < 2 * n_samples; i += 2) {
+ *     for (c = 0; c < 2; c++)
+ *       y[c] = input[i + c] * b[0];
+ *     for (k = 1; k <= order; k++) {
+ *       for (c = 0; c < 2; c++) {
+ *         y[c] += input[i + c - 2 * k] * b[k];
+ *         y[c] -= output[i + c - 2 * k] * a[k];
+ *       }
+ *     }
+ *     for (c = 0; c < 2; c++)
+ *       output[i + c] = y[c];
  *   }
  * }
  */
@@ -254,29 +276,41 @@ static inline void
 yule_filter (const gfloat * input, gfloat * output,
     const gfloat * a, const gfloat * b)
 {
+  gdouble y[2];
+  gint c, k;
+
   /* 1e-10 is added below to avoid running into denormals when operating on
    * near silence. */
 
-  output[0] = 1e-10 + input[0] * b[0]
-      + input[-1] * b[1] - output[-1] * a[1]
-      + input[-2] * b[2] - output[-2] * a[2]
-      + input[-3] * b[3] - output[-3] * a[3]
-      + input[-4] * b[4] - output[-4] * a[4]
-      + input[-5] * b[5] - output[-5] * a[5]
-      + input[-6] * b[6] - output[-6] * a[6]
-      + input[-7] * b[7] - output[-7] * a[7]
-      + input[-8] * b[8] - output[-8] * a[8]
-      + input[-9] * b[9] - output[-9] * a[9]
-      + input[-10] * b[10] - output[-10] * a[10];
+  for (c = 0; c < 2; c++)
+    y[c] = 1e-10 + input[c] * b[0];
+  for (k = 1; k <= YULE_ORDER; k++) {
+    for (c = 0; c < 2; c++) {
+      y[c] += input[c - 2 * k] * b[k];
+      y[c] -= output[c - 2 * k] * a[k];
+    }
+  }
+  for (c = 0; c < 2; c++)
+    output[c] = y[c];
 }
 
 static inline void
 butter_filter (const gfloat * input, gfloat * output,
     const gfloat * a, const gfloat * b)
 {
-  output[0] = input[0] * b[0]
-      + input[-1] * b[1] - output[-1] * a[1]
-      + input[-2] * b[2] - output[-2] * a[2];
+  gfloat y[2];
+  gint c, k;
+
+  for (c = 0; c < 2; c++)
+    y[c] = input[c] * b[0];
+  for (k = 1; k <= BUTTER_ORDER; k++) {
+    for (c = 0; c < 2; c++) {
+      y[c] += input[c - 2 * k] * b[k];
+      y[c] -= output[c - 2 * k] * a[k];
+    }
+  }
+  for (c = 0; c < 2; c++)
+    output[c] = y[c];
 }
 
 /* Because butter_filter and yule_filter are inlined, this function is
@@ -284,22 +318,19 @@ butter_filter (const gfloat * input, gfloat * output,
  * performance penalty. */
 
 static inline void
-apply_filters (const RgAnalysisCtx * ctx, const gfloat * input_l,
-    const gfloat * input_r, guint n_samples)
+apply_filters (const RgAnalysisCtx * ctx, const gfloat * input,
+    guint n_samples)
 {
   const gfloat *ayule = AYule[ctx->sample_rate_index];
   const gfloat *byule = BYule[ctx->sample_rate_index];
   const gfloat *abutter = AButter[ctx->sample_rate_index];
   const gfloat *bbutter = BButter[ctx->sample_rate_index];
-  gint pos = ctx->window_n_samples_done;
+  gint pos = 2 * ctx->window_n_samples_done;
   gint i;
 
-  for (i = 0; i < n_samples; i++, pos++) {
-    yule_filter (input_l + i, ctx->step_l + pos, ayule, byule);
-    butter_filter (ctx->step_l + pos, ctx->out_l + pos, abutter, bbutter);
-
-    yule_filter (input_r + i, ctx->step_r + pos, ayule, byule);
-    butter_filter (ctx->step_r + pos, ctx->out_r + pos, abutter, bbutter);
+  for (i = 0; i < 2 * n_samples; i += 2, pos += 2) {
+    yule_filter (input + i, ctx->step + pos, ayule, byule);
+    butter_filter (ctx->step + pos, ctx->out + pos, abutter, bbutter);
   }
 }
 
@@ -310,15 +341,10 @@ reset_filters (RgAnalysisCtx * ctx)
 {
   gint i;
 
-  for (i = 0; i < MAX_ORDER; i++) {
-
-    ctx->inprebuf_l[i] = 0.;
-    ctx->stepbuf_l[i] = 0.;
-    ctx->outbuf_l[i] = 0.;
-
-    ctx->inprebuf_r[i] = 0.;
-    ctx->stepbuf_r[i] = 0.;
-    ctx->outbuf_r[i] = 0.;
+  for (i = 0; i < MAX_ORDER * 2; i++) {
+    ctx->inprebuf[i] = 0.;
+    ctx->stepbuf[i] = 0.;
+    ctx->outbuf[i] = 0.;
   }
 
   ctx->window_square_sum = 0.;
@@ -398,13 +424,9 @@ rg_analysis_new (void)
 
   ctx = g_new (RgAnalysisCtx, 1);
 
-  ctx->inpre_l = ctx->inprebuf_l + MAX_ORDER;
-  ctx->step_l = ctx->stepbuf_l + MAX_ORDER;
-  ctx->out_l = ctx->outbuf_l + MAX_ORDER;
-
-  ctx->inpre_r = ctx->inprebuf_r + MAX_ORDER;
-  ctx->step_r = ctx->stepbuf_r + MAX_ORDER;
-  ctx->out_r = ctx->outbuf_r + MAX_ORDER;
+  ctx->inpre = ctx->inprebuf + MAX_ORDER * 2;
+  ctx->step = ctx->stepbuf + MAX_ORDER * 2;
+  ctx->out = ctx->outbuf + MAX_ORDER * 2;
 
   ctx->sample_rate = 0;
 
@@ -521,16 +543,16 @@ rg_analysis_analyze_mono_float (RgAnalysisCtx * ctx, gconstpointer data,
   g_return_if_fail (size % sizeof (gfloat) == 0);
 
   while (n_samples) {
-    gint n = MIN (n_samples, G_N_ELEMENTS (conv_samples));
+    gint n = MIN (n_samples, G_N_ELEMENTS (conv_samples) / 2);
 
     n_samples -= n;
-    memcpy (conv_samples, samples, n * sizeof (gfloat));
     for (i = 0; i < n; i++) {
-      ctx->track.peak = MAX (ctx->track.peak, fabs (conv_samples[i]));
-      conv_samples[i] *= 32768.;
+      ctx->track.peak = MAX (ctx->track.peak, fabs (samples[i]));
+      conv_samples[2 * i] = samples[i] * 32768.;
+      conv_samples[2 * i + 1] = conv_samples[2 * i];
     }
     samples += n;
-    rg_analysis_analyze (ctx, conv_samples, NULL, n);
+    rg_analysis_analyze (ctx, conv_samples, n);
   }
 }
 
@@ -538,8 +560,7 @@ void
 rg_analysis_analyze_stereo_float (RgAnalysisCtx * ctx, gconstpointer data,
     gsize size, guint depth)
 {
-  gfloat conv_samples_l[256];
-  gfloat conv_samples_r[256];
+  gfloat conv_samples[512];
   const gfloat *samples = (gfloat *) data;
   guint n_frames = size / (sizeof (gfloat) * 2);
   gint i;
@@ -548,22 +569,15 @@ rg_analysis_analyze_stereo_float (RgAnalysisCtx * ctx, gconstpointer data,
   g_return_if_fail (size % (sizeof (gfloat) * 2) == 0);
 
   while (n_frames) {
-    gint n = MIN (n_frames, G_N_ELEMENTS (conv_samples_l));
+    gint n = MIN (n_frames, G_N_ELEMENTS (conv_samples) / 2);
 
     n_frames -= n;
-    for (i = 0; i < n; i++) {
-      gfloat old_sample;
-
-      old_sample = samples[2 * i];
-      ctx->track.peak = MAX (ctx->track.peak, fabs (old_sample));
-      conv_samples_l[i] = old_sample * 32768.;
-
-      old_sample = samples[2 * i + 1];
-      ctx->track.peak = MAX (ctx->track.peak, fabs (old_sample));
-      conv_samples_r[i] = old_sample * 32768.;
+    for (i = 0; i < 2 * n; i++) {
+      ctx->track.peak = MAX (ctx->track.peak, fabs (samples[i]));
+      conv_samples[i] = samples[i] * 32768.;
     }
     samples += 2 * n;
-    rg_analysis_analyze (ctx, conv_samples_l, conv_samples_r, n);
+    rg_analysis_analyze (ctx, conv_samples, n);
   }
 }
 
@@ -582,17 +596,18 @@ rg_analysis_analyze_mono_int16 (RgAnalysisCtx * ctx, gconstpointer data,
   g_return_if_fail (size % sizeof (gint16) == 0);
 
   while (n_samples) {
-    gint n = MIN (n_samples, G_N_ELEMENTS (conv_samples));
+    gint n = MIN (n_samples, G_N_ELEMENTS (conv_samples) / 2);
 
     n_samples -= n;
     for (i = 0; i < n; i++) {
       gint16 old_sample = samples[i] << shift;
 
       peak_sample = MAX (peak_sample, ABS ((gint32) old_sample));
-      conv_samples[i] = (gfloat) old_sample;
+      conv_samples[2 * i] = (gfloat) old_sample;
+      conv_samples[2 * i + 1] = (gfloat) old_sample;
     }
     samples += n;
-    rg_analysis_analyze (ctx, conv_samples, NULL, n);
+    rg_analysis_analyze (ctx, conv_samples, n);
   }
   ctx->track.peak = MAX (ctx->track.peak,
       (gdouble) peak_sample / ((gdouble) (1u << 15)));
@@ -602,8 +617,7 @@ void
 rg_analysis_analyze_stereo_int16 (RgAnalysisCtx * ctx, gconstpointer data,
     gsize size, guint depth)
 {
-  gfloat conv_samples_l[256];
-  gfloat conv_samples_r[256];
+  gfloat conv_samples[512];
   gint32 peak_sample = 0;
   const gint16 *samples = (gint16 *) data;
   guint n_frames = size / (sizeof (gint16) * 2);
@@ -614,22 +628,17 @@ rg_analysis_analyze_stereo_int16 (RgAnalysisCtx * ctx, gconstpointer data,
   g_return_if_fail (size % (sizeof (gint16) * 2) == 0);
 
   while (n_frames) {
-    gint n = MIN (n_frames, G_N_ELEMENTS (conv_samples_l));
+    gint n = MIN (n_frames, G_N_ELEMENTS (conv_samples) / 2);
 
     n_frames -= n;
-    for (i = 0; i < n; i++) {
-      gint16 old_sample;
-
-      old_sample = samples[2 * i] << shift;
-      peak_sample = MAX (peak_sample, ABS ((gint32) old_sample));
-      conv_samples_l[i] = (gfloat) old_sample;
+    for (i = 0; i < 2 * n; i++) {
+      gint16 old_sample = samples[i] << shift;
 
-      old_sample = samples[2 * i + 1] << shift;
       peak_sample = MAX (peak_sample, ABS ((gint32) old_sample));
-      conv_samples_r[i] = (gfloat) old_sample;
+      conv_samples[i] = (gfloat) old_sample;
     }
     samples += 2 * n;
-    rg_analysis_analyze (ctx, conv_samples_l, conv_samples_r, n);
+    rg_analysis_analyze (ctx, conv_samples, n);
   }
   ctx->track.peak = MAX (ctx->track.peak,
       (gdouble) peak_sample / ((gdouble) (1u << 15)));
@@ -639,38 +648,29 @@ rg_analysis_analyze_stereo_int16 (RgAnalysisCtx * ctx, gconstpointer data,
  * floating point format but should be scaled such that the values
  * +/-32768.0 correspond to the -0dBFS reference amplitude.
  *
- * samples_l: Buffer with sample data for the left channel or of the
- * mono channel.
- *
- * samples_r: Buffer with sample data for the right channel or NULL
- * for mono.
+ * samples: Buffer with interleaved sample data for the left and right
+ * channel.  Mono data has to be passed as two identical channels.
  *
- * n_samples: Number of samples passed in each buffer.
+ * n_samples: Number of samples per channel passed in the buffer.
  */
 
 void
-rg_analysis_analyze (RgAnalysisCtx * ctx, const gfloat * samples_l,
-    const gfloat * samples_r, guint n_samples)
+rg_analysis_analyze (RgAnalysisCtx * ctx, const gfloat * samples,
+    guint n_samples)
 {
-  const gfloat *input_l, *input_r;
+  const gfloat *input, *out;
   guint n_samples_done;
   gint i;
 
   g_return_if_fail (ctx != NULL);
-  g_return_if_fail (samples_l != NULL);
+  g_return_if_fail (samples != NULL);
   g_return_if_fail (ctx->sample_rate != 0);
 
   if (n_samples == 0)
     return;
 
-  if (samples_r == NULL)
-    /* Mono. */
-    samples_r = samples_l;
-
-  memcpy (ctx->inpre_l, samples_l,
-      MIN (n_samples, MAX_ORDER) * sizeof (gfloat));
-  memcpy (ctx->inpre_r, samples_r,
-      MIN (n_samples, MAX_ORDER) * sizeof (gfloat));
+  memcpy (ctx->inpre, samples,
+      MIN (n_samples, MAX_ORDER) * 2 * sizeof (gfloat));
 
   n_samples_done = 0;
   while (n_samples_done < n_samples) {
@@ -680,22 +680,18 @@ rg_analysis_analyze (RgAnalysisCtx * ctx, const gfloat * samples_l,
         ctx->window_n_samples - ctx->window_n_samples_done);
 
     if (n_samples_done < MAX_ORDER) {
-      input_l = ctx->inpre_l + n_samples_done;
-      input_r = ctx->inpre_r + n_samples_done;
+      input = ctx->inpre + 2 * n_samples_done;
       n_samples_current = MIN (n_samples_current, MAX_ORDER - n_samples_done);
     } else {
-      input_l = samples_l + n_samples_done;
-      input_r = samples_r + n_samples_done;
+      input = samples + 2 * n_samples_done;
     }
 
-    apply_filters (ctx, input_l, input_r, n_samples_current);
+    apply_filters (ctx, input, n_samples_current);
 
     /* Update the square sum. */
-    for (i = 0; i < n_samples_current; i++)
-      ctx->window_square_sum += ctx->out_l[ctx->window_n_samples_done + i]
-          * ctx->out_l[ctx->window_n_samples_done + i]
-          + ctx->out_r[ctx->window_n_samples_done + i]
-          * ctx->out_r[ctx->window_n_samples_done + i];
+    out = ctx->out + 2 * ctx->window_n_samples_done;
+    for (i = 0; i < 2 * n_samples_current; i += 2)
+      ctx->window_square_sum += out[i] * out[i] + out[i + 1] * out[i + 1];
 
     ctx->window_n_samples_done += n_samples_current;
     ctx->buffer_n_samples_done += n_samples_current;
@@ -728,15 +724,10 @@ rg_analysis_analyze (RgAnalysisCtx * ctx, const gfloat * samples_l,
        * the smallest sample rate, the number of samples needed for
        * the window is greater than MAX_ORDER. */
 
-      memcpy (ctx->stepbuf_l, ctx->stepbuf_l + ctx->window_n_samples,
-          MAX_ORDER * sizeof (gfloat));
-      memcpy (ctx->outbuf_l, ctx->outbuf_l + ctx->window_n_samples,
-          MAX_ORDER * sizeof (gfloat));
-
-      memcpy (ctx->stepbuf_r, ctx->stepbuf_r + ctx->window_n_samples,
-          MAX_ORDER * sizeof (gfloat));
-      memcpy (ctx->outbuf_r, ctx->outbuf_r + ctx->window_n_samples,
-          MAX_ORDER * sizeof (gfloat));
+      memcpy (ctx->stepbuf, ctx->stepbuf + 2 * ctx->window_n_samples,
+          MAX_ORDER * 2 * sizeof (gfloat));
+      memcpy (ctx->outbuf, ctx->outbuf + 2 * ctx->window_n_samples,
+          MAX_ORDER * 2 * sizeof (gfloat));
     }
 
     n_samples_done += n_samples_current;
@@ -744,23 +735,15 @@ rg_analysis_analyze (RgAnalysisCtx * ctx, const gfloat * samples_l,
 
   if (n_samples >= MAX_ORDER) {
 
-    memcpy (ctx->inprebuf_l, samples_l + n_samples - MAX_ORDER,
-        MAX_ORDER * sizeof (gfloat));
-
-    memcpy (ctx->inprebuf_r, samples_r + n_samples - MAX_ORDER,
-        MAX_ORDER * sizeof (gfloat));
+    memcpy (ctx->inprebuf, samples + 2 * (n_samples - MAX_ORDER),
+        MAX_ORDER * 2 * sizeof (gfloat));
 
   } else {
 
-    memmove (ctx->inprebuf_l, ctx->inprebuf_l + n_samples,
-        (MAX_ORDER - n_samples) * sizeof (gfloat));
-    memcpy (ctx->inprebuf_l + MAX_ORDER - n_samples, samples_l,
-        n_samples * sizeof (gfloat));
-
-    memmove (ctx->inprebuf_r, ctx->inprebuf_r + n_samples,
-        (MAX_ORDER - n_samples) * sizeof (gfloat));
-    memcpy (ctx->inprebuf_r + MAX_ORDER - n_samples, samples_r,
-        n_samples * sizeof (gfloat));
+    memmove (ctx->inprebuf, ctx->inprebuf + 2 * n_samples,
+        (MAX_ORDER - n_samples) * 2 * sizeof (gfloat));
+    memcpy (ctx->inprebuf + 2 * (MAX_ORDER - n_samples), samples,
+        n_samples * 2 * sizeof (gfloat));
 
   }
 }
@@ -809,6 +792,52 @@ rg_analysis_reset_album (RgAnalysisCtx * ctx)
   accumulator_clear (&ctx->album);
 }
 
+/* Obtain a copy of the album accumulator that can be passed to
+ * rg_analysis_merge_album_state of another context.  This allows to
+ * analyze the tracks of one album in separate contexts, e.g. in
+ * parallel threads or processes, and to combine the results
+ * afterwards.  As accumulators are added exactly, the album result is
+ * identical to analyzing all tracks with one context.  The data is in
+ * native endianness. */
+
+GBytes *
+rg_analysis_get_album_state (RgAnalysisCtx * ctx)
+{
+  RgAnalysisAlbumState *state;
+
+  g_return_val_if_fail (ctx != NULL, NULL);
+
+  state = g_new (RgAnalysisAlbumState, 1);
+  state->magic = ALBUM_STATE_MAGIC;
+  state->size = sizeof (RgAnalysisAlbumState);
+  state->acc = ctx->album;
+
+  return g_bytes_new_take (state, sizeof (RgAnalysisAlbumState));
+}
+
+/* Add album state obtained with rg_analysis_get_album_state to the
+ * album accumulator.  Returns FALSE if the data is not valid album
+ * state. */
+
+gboolean
+rg_analysis_merge_album_state (RgAnalysisCtx * ctx, GBytes * bytes)
+{
+  const RgAnalysisAlbumState *state;
+  gsize size;
+
+  g_return_val_if_fail (ctx != NULL, FALSE);
+  g_return_val_if_fail (bytes != NULL, FALSE);
+
+  state = g_bytes_get_data (bytes, &size);
+  if (size != sizeof (RgAnalysisAlbumState)
+      || state->magic != ALBUM_STATE_MAGIC || state->size != size)
+    return FALSE;
+
+  accumulator_add (&ctx->album, &state->acc);
+
+  return TRUE;
+}
+
 /* Reset internal buffers as well as track and album accumulators.
  * Configured sample rate is kept intact. */
 
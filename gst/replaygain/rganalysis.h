@@ -42,8 +42,8 @@ void rg_analysis_analyze_mono_int16 (RgAnalysisCtx * ctx, gconstpointer data,
     gsize size, guint depth);
 void rg_analysis_analyze_stereo_int16 (RgAnalysisCtx * ctx, gconstpointer data,
     gsize size, guint depth);
-void rg_analysis_analyze (RgAnalysisCtx * ctx, const gfloat * samples_l,
-    const gfloat * samples_r, guint n_samples);
+void rg_analysis_analyze (RgAnalysisCtx * ctx, const gfloat * samples,
+    guint n_samples);
 gboolean rg_analysis_track_result (RgAnalysisCtx * ctx, gdouble * gain,
     gdouble * peak);
 gboolean rg_analysis_album_result (RgAnalysisCtx * ctx, gdouble * gain,
@@ -55,6 +55,8 @@ void rg_analysis_init_silence_detection (
 void rg_analysis_start_buffer (RgAnalysisCtx * ctx,
                                GstClockTime buffer_timestamp);
 void rg_analysis_reset_album (RgAnalysisCtx * ctx);
+GBytes *rg_analysis_get_album_state (RgAnalysisCtx * ctx);
+gboolean rg_analysis_merge_album_state (RgAnalysisCtx * ctx, GBytes * bytes);
 void rg_analysis_reset (RgAnalysisCtx * ctx);
 void rg_analysis_destroy (RgAnalysisCtx * ctx);
 
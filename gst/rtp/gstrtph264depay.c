@@ -491,8 +491,12 @@ gst_rtp_h264_set_src_caps (GstRtpH264Depay * rtph264depay)
     rtph264depay->codec_data = codec_data;
   }
 
-  if (res)
+  if (res) {
     rtph264depay->new_codec_data = FALSE;
+    rtph264depay->non_contiguous =
+        gst_rtp_query_non_contiguous (GST_ELEMENT (rtph264depay),
+        GST_RTP_BASE_DEPAYLOAD_SRCPAD (rtph264depay));
+  }
 
   return res;
 }
@@ -733,6 +737,98 @@ incomplete_caps:
   }
 }
 
+/* Wrap @size bytes of the payload of @rtp, starting at @data, in a buffer
+ * that shares the memory of the packet */
+static GstBuffer *
+gst_rtp_h264_depay_share_payload (GstRTPBuffer * rtp, const guint8 * data,
+    guint size)
+{
+  GstBuffer *outbuf;
+  guint offset;
+
+  offset = gst_rtp_buffer_get_header_len (rtp) +
+      (data - (const guint8 *) gst_rtp_buffer_get_payload (rtp));
+
+  outbuf = gst_buffer_new ();
+  if (size > 0)
+    gst_buffer_copy_into (outbuf, rtp->buffer, GST_BUFFER_COPY_MEMORY, offset,
+        size);
+
+  return outbuf;
+}
+
+/* The start code or length in front of a NAL of @nal_size bytes. A start code
+ * is shared static data, a length needs a tiny memory of its own. When
+ * @nal_header >= 0 it is appended, this rebuilds the header of a fragmented
+ * NAL. */
+static GstMemory *
+gst_rtp_h264_depay_make_prefix (GstRtpH264Depay * rtph264depay,
+    guint nal_size, gint nal_header)
+{
+  GstMemory *mem;
+  GstMapInfo map;
+
+  if (rtph264depay->byte_stream && nal_header < 0)
+    return gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
+        (gpointer) sync_bytes, sizeof (sync_bytes), 0, sizeof (sync_bytes),
+        NULL, NULL);
+
+  mem = gst_allocator_alloc (NULL,
+      sizeof (sync_bytes) + (nal_header >= 0 ? 1 : 0), NULL);
+  gst_memory_map (mem, &map, GST_MAP_WRITE);
+  if (rtph264depay->byte_stream)
+    memcpy (map.data, sync_bytes, sizeof (sync_bytes));
+  else
+    GST_WRITE_UINT32_BE (map.data, nal_size);
+  if (nal_header >= 0)
+    map.data[sizeof (sync_bytes)] = nal_header;
+  gst_memory_unmap (mem, &map);
+
+  return mem;
+}
+
+/* A complete NAL of @nal_size bytes at @data, with its prefix. When
+ * downstream accepts it, the NAL is not copied but shared with the packet */
+static GstBuffer *
+gst_rtp_h264_depay_make_nal (GstRtpH264Depay * rtph264depay,
+    GstRTPBuffer * rtp, const guint8 * data, guint nal_size)
+{
+  GstBuffer *outbuf;
+  GstMapInfo map;
+
+  if (rtph264depay->non_contiguous) {
+    outbuf = gst_rtp_h264_depay_share_payload (rtp, data, nal_size);
+    gst_buffer_prepend_memory (outbuf,
+        gst_rtp_h264_depay_make_prefix (rtph264depay, nal_size, -1));
+  } else {
+    outbuf = gst_buffer_new_and_alloc (nal_size + sizeof (sync_bytes));
+
+    gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
+    if (rtph264depay->byte_stream)
+      memcpy (map.data, sync_bytes, sizeof (sync_bytes));
+    else
+      GST_WRITE_UINT32_BE (map.data, nal_size);
+    memcpy (map.data + sizeof (sync_bytes), data, nal_size);
+    gst_buffer_unmap (outbuf, &map);
+  }
+
+  gst_rtp_copy_video_meta (rtph264depay, outbuf, rtp->buffer);
+
+  return outbuf;
+}
+
+/* take from @adapter without merging the memories if downstream accepts
+ * that */
+static GstBuffer *
+gst_rtp_h264_depay_take (GstRtpH264Depay * rtph264depay, GstAdapter * adapter,
+    gsize size)
+{
+  if (rtph264depay->non_contiguous)
+    return gst_adapter_take_buffer_fast (adapter, size);
+
+  return gst_adapter_take_buffer (adapter, size);
+}
+
 static GstBuffer *
 gst_rtp_h264_complete_au (GstRtpH264Depay * rtph264depay,
     GstClockTime * out_timestamp, gboolean * out_keyframe)
@@ -743,7 +839,8 @@ gst_rtp_h264_complete_au (GstRtpH264Depay * rtph264depay,
   /* we had a picture in the adapter and we completed it */
   GST_DEBUG_OBJECT (rtph264depay, "taking completed AU");
   outsize = gst_adapter_available (rtph264depay->picture_adapter);
-  outbuf = gst_adapter_take_buffer (rtph264depay->picture_adapter, outsize);
+  outbuf = gst_rtp_h264_depay_take (rtph264depay,
+      rtph264depay->picture_adapter, outsize);
 
   *out_timestamp = rtph264depay->last_ts;
   *out_keyframe = rtph264depay->last_keyframe;
@@ -764,16 +861,16 @@ gst_rtp_h264_depay_handle_nal (GstRtpH264Depay * rtph264depay, GstBuffer * nal,
 {
   GstRTPBaseDepayload *depayload = GST_RTP_BASE_DEPAYLOAD (rtph264depay);
   gint nal_type;
-  GstMapInfo map;
+  guint8 header[6] = { 0, };
   GstBuffer *outbuf = NULL;
   GstClockTime out_timestamp;
   gboolean keyframe, out_keyframe;
 
-  gst_buffer_map (nal, &map, GST_MAP_READ);
-  if (G_UNLIKELY (map.size < 5))
+  /* only look at the start, mapping the whole NAL would merge its memories */
+  if (G_UNLIKELY (gst_buffer_extract (nal, 0, header, sizeof (header)) < 5))
     goto short_nal;
 
-  nal_type = map.data[4] & 0x1f;
+  nal_type = header[4] & 0x1f;
   GST_DEBUG_OBJECT (rtph264depay, "handle NAL type %d", nal_type);
 
   keyframe = NAL_TYPE_IS_KEY (nal_type);
@@ -786,7 +883,6 @@ gst_rtp_h264_depay_handle_nal (GstRtpH264Depay * rtph264depay, GstBuffer * nal,
       gst_rtp_h264_depay_add_sps_pps (rtph264depay,
           gst_buffer_copy_region (nal, GST_BUFFER_COPY_ALL,
               4, gst_buffer_get_size (nal) - 4));
-      gst_buffer_unmap (nal, &map);
       gst_buffer_unref (nal);
       return NULL;
     } else if (rtph264depay->sps->len == 0 || rtph264depay->pps->len == 0) {
@@ -797,7 +893,6 @@ gst_rtp_h264_depay_handle_nal (GstRtpH264Depay * rtph264depay, GstBuffer * nal,
           gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
               gst_structure_new ("GstForceKeyUnit",
                   "all-headers", G_TYPE_BOOLEAN, TRUE, NULL)));
-      gst_buffer_unmap (nal, &map);
       gst_buffer_unref (nal);
       return NULL;
     }
@@ -826,7 +921,7 @@ gst_rtp_h264_depay_handle_nal (GstRtpH264Depay * rtph264depay, GstBuffer * nal,
       if (nal_type == 1 || nal_type == 2 || nal_type == 5) {
         /* we have a picture start */
         start = TRUE;
-        if (map.data[5] & 0x80) {
+        if (header[5] & 0x80) {
           /* first_mb_in_slice == 0 completes a picture */
           complete = TRUE;
         }
@@ -841,8 +936,6 @@ gst_rtp_h264_depay_handle_nal (GstRtpH264Depay * rtph264depay, GstBuffer * nal,
             &out_keyframe);
     }
     /* add to adapter */
-    gst_buffer_unmap (nal, &map);
-
     GST_DEBUG_OBJECT (depayload, "adding NAL to picture adapter");
     gst_adapter_push (rtph264depay->picture_adapter, nal);
     rtph264depay->last_ts = in_timestamp;
@@ -856,7 +949,6 @@ gst_rtp_h264_depay_handle_nal (GstRtpH264Depay * rtph264depay, GstBuffer * nal,
     /* no merge, output is input nal */
     GST_DEBUG_OBJECT (depayload, "using NAL as output");
     outbuf = nal;
-    gst_buffer_unmap (nal, &map);
   }
 
   if (outbuf) {
@@ -886,7 +978,6 @@ gst_rtp_h264_depay_handle_nal (GstRtpH264Depay * rtph264depay, GstBuffer * nal,
 short_nal:
   {
     GST_WARNING_OBJECT (depayload, "dropping short NAL");
-    gst_buffer_unmap (nal, &map);
     gst_buffer_unref (nal);
     return NULL;
   }
@@ -901,21 +992,34 @@ gst_rtp_h264_push_fragmentation_unit (GstRtpH264Depay * rtph264depay,
   GstBuffer *outbuf;
 
   outsize = gst_adapter_available (rtph264depay->adapter);
-  outbuf = gst_adapter_take_buffer (rtph264depay->adapter, outsize);
 
-  gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-  GST_DEBUG_OBJECT (rtph264depay, "output %d bytes", outsize);
+  if (rtph264depay->fu_shared) {
+    /* the fragments are shared with the packets, only the prefix and the NAL
+     * header are new */
+    outbuf = gst_adapter_take_buffer_fast (rtph264depay->adapter, outsize);
+    outbuf = gst_buffer_make_writable (outbuf);
+    GST_DEBUG_OBJECT (rtph264depay, "output %d bytes", outsize + 5);
 
-  if (rtph264depay->byte_stream) {
-    memcpy (map.data, sync_bytes, sizeof (sync_bytes));
+    gst_buffer_prepend_memory (outbuf,
+        gst_rtp_h264_depay_make_prefix (rtph264depay, outsize + 1,
+            rtph264depay->fu_nal_header));
   } else {
-    outsize -= 4;
-    map.data[0] = (outsize >> 24);
-    map.data[1] = (outsize >> 16);
-    map.data[2] = (outsize >> 8);
-    map.data[3] = (outsize);
+    outbuf = gst_adapter_take_buffer (rtph264depay->adapter, outsize);
+
+    gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
+    GST_DEBUG_OBJECT (rtph264depay, "output %d bytes", outsize);
+
+    if (rtph264depay->byte_stream) {
+      memcpy (map.data, sync_bytes, sizeof (sync_bytes));
+    } else {
+      outsize -= 4;
+      map.data[0] = (outsize >> 24);
+      map.data[1] = (outsize >> 16);
+      map.data[2] = (outsize >> 8);
+      map.data[3] = (outsize);
+    }
+    gst_buffer_unmap (outbuf, &map);
   }
-  gst_buffer_unmap (outbuf, &map);
 
   rtph264depay->current_fu_type = 0;
 
@@ -1024,26 +1128,12 @@ gst_rtp_h264_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
           if (nalu_size > (payload_len - 2))
             nalu_size = payload_len - 2;
 
-          outsize = nalu_size + sizeof (sync_bytes);
-          outbuf = gst_buffer_new_and_alloc (outsize);
-
-          gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-          if (rtph264depay->byte_stream) {
-            memcpy (map.data, sync_bytes, sizeof (sync_bytes));
-          } else {
-            map.data[0] = map.data[1] = 0;
-            map.data[2] = payload[0];
-            map.data[3] = payload[1];
-          }
-
           /* strip NALU size */
           payload += 2;
           payload_len -= 2;
 
-          memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
-          gst_buffer_unmap (outbuf, &map);
-
-          gst_rtp_copy_video_meta (rtph264depay, outbuf, rtp->buffer);
+          outbuf = gst_rtp_h264_depay_make_nal (rtph264depay, rtp, payload,
+              nalu_size);
 
           outbuf =
               gst_rtp_h264_depay_handle_nal (rtph264depay, outbuf, timestamp,
@@ -1057,7 +1147,8 @@ gst_rtp_h264_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
 
         outsize = gst_adapter_available (rtph264depay->adapter);
         if (outsize > 0)
-          outbuf = gst_adapter_take_buffer (rtph264depay->adapter, outsize);
+          outbuf = gst_rtp_h264_depay_take (rtph264depay,
+              rtph264depay->adapter, outsize);
         break;
       }
       case 26:
@@ -1110,19 +1201,28 @@ gst_rtp_h264_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
           /* reconstruct NAL header */
           nal_header = (payload[0] & 0xe0) | (payload[1] & 0x1f);
 
-          /* strip type header, keep FU header, we'll reuse it to reconstruct
-           * the NAL header. */
-          payload += 1;
-          payload_len -= 1;
-
-          nalu_size = payload_len;
-          outsize = nalu_size + sizeof (sync_bytes);
-          outbuf = gst_buffer_new_and_alloc (outsize);
-
-          gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-          memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
-          map.data[sizeof (sync_bytes)] = nal_header;
-          gst_buffer_unmap (outbuf, &map);
+          rtph264depay->fu_shared = rtph264depay->non_contiguous;
+          if (rtph264depay->fu_shared) {
+            /* the prefix and NAL header are added when the NAL is complete */
+            rtph264depay->fu_nal_header = nal_header;
+            outsize = payload_len - 2;
+            outbuf = gst_rtp_h264_depay_share_payload (rtp, payload + 2,
+                outsize);
+          } else {
+            /* strip type header, keep FU header, we'll reuse it to
+             * reconstruct the NAL header. */
+            payload += 1;
+            payload_len -= 1;
+
+            nalu_size = payload_len;
+            outsize = nalu_size + sizeof (sync_bytes);
+            outbuf = gst_buffer_new_and_alloc (outsize);
+
+            gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
+            memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
+            map.data[sizeof (sync_bytes)] = nal_header;
+            gst_buffer_unmap (outbuf, &map);
+          }
 
           gst_rtp_copy_video_meta (rtph264depay, outbuf, rtp->buffer);
 
@@ -1136,8 +1236,12 @@ gst_rtp_h264_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
           payload_len -= 2;
 
           outsize = payload_len;
-          outbuf = gst_buffer_new_and_alloc (outsize);
-          gst_buffer_fill (outbuf, 0, payload, outsize);
+          if (rtph264depay->non_contiguous) {
+            outbuf = gst_rtp_h264_depay_share_payload (rtp, payload, outsize);
+          } else {
+            outbuf = gst_buffer_new_and_alloc (outsize);
+            gst_buffer_fill (outbuf, 0, payload, outsize);
+          }
 
           gst_rtp_copy_video_meta (rtph264depay, outbuf, rtp->buffer);
 
@@ -1162,21 +1266,8 @@ gst_rtp_h264_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
         /* 1-23   NAL unit  Single NAL unit packet per H.264   5.6 */
         /* the entire payload is the output buffer */
         nalu_size = payload_len;
-        outsize = nalu_size + sizeof (sync_bytes);
-        outbuf = gst_buffer_new_and_alloc (outsize);
-
-        gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-        if (rtph264depay->byte_stream) {
-          memcpy (map.data, sync_bytes, sizeof (sync_bytes));
-        } else {
-          map.data[0] = map.data[1] = 0;
-          map.data[2] = nalu_size >> 8;
-          map.data[3] = nalu_size & 0xff;
-        }
-        memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
-        gst_buffer_unmap (outbuf, &map);
-
-        gst_rtp_copy_video_meta (rtph264depay, outbuf, rtp->buffer);
+        outbuf = gst_rtp_h264_depay_make_nal (rtph264depay, rtp, payload,
+            nalu_size);
 
         outbuf = gst_rtp_h264_depay_handle_nal (rtph264depay, outbuf, timestamp,
             marker);
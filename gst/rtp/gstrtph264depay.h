@@ -45,6 +45,8 @@ struct _GstRtpH264Depay
   GstRTPBaseDepayload depayload;
 
   gboolean    byte_stream;
+  /* downstream accepts AUs made of memories shared with the packets */
+  gboolean    non_contiguous;
 
   GstBuffer  *codec_data;
   GstAdapter *adapter;
@@ -61,6 +63,8 @@ struct _GstRtpH264Depay
   guint8 current_fu_type;
   GstClockTime fu_timestamp;
   gboolean fu_marker;
+  gboolean fu_shared;
+  guint8 fu_nal_header;
 
   /* misc */
   GPtrArray *sps;
@@ -69,14 +69,35 @@ GST_STATIC_PAD_TEMPLATE ("src",
 
 #define DEFAULT_SPROP_PARAMETER_SETS    NULL
 #define DEFAULT_CONFIG_INTERVAL		      0
+#define DEFAULT_AGGREGATE_MODE          GST_RTP_H264_AGGREGATE_NONE
 
 enum
 {
   PROP_0,
   PROP_SPROP_PARAMETER_SETS,
-  PROP_CONFIG_INTERVAL
+  PROP_CONFIG_INTERVAL,
+  PROP_AGGREGATE_MODE
 };
 
+#define GST_TYPE_RTP_H264_AGGREGATE_MODE \
+  (gst_rtp_h264_aggregate_mode_get_type ())
+static GType
+gst_rtp_h264_aggregate_mode_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_RTP_H264_AGGREGATE_NONE, "Do not aggregate NAL units", "none"},
+    {GST_RTP_H264_AGGREGATE_ZERO_LATENCY,
+        "Aggregate the NAL units of each input buffer", "zero-latency"},
+    {0, NULL, NULL},
+  };
+
+  if (!type) {
+    type = g_enum_register_static ("GstRTPH264AggregateMode", values);
+  }
+  return type;
+}
+
 #define IS_ACCESS_UNIT(x) (((x) > 0x00) && ((x) < 0x06))
 
 static void gst_rtp_h264_pay_finalize (GObject * object);
@@ -133,6 +154,25 @@ gst_rtp_h264_pay_class_init (GstRtpH264PayClass * klass)
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)
       );
 
+  /**
+   * GstRtpH264Pay:aggregate-mode:
+   *
+   * Bundle the NAL units of an input buffer that fit in one packet, such as
+   * SPS, PPS and SEI, into STAP-A packets and push all packets of the input
+   * buffer as one buffer list. With au alignment, this is one list per
+   * access unit.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass),
+      PROP_AGGREGATE_MODE,
+      g_param_spec_enum ("aggregate-mode",
+          "Aggregate mode",
+          "Bundle suitable NAL units into STAP-A aggregate packets",
+          GST_TYPE_RTP_H264_AGGREGATE_MODE, DEFAULT_AGGREGATE_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)
+      );
+
   gobject_class->finalize = gst_rtp_h264_pay_finalize;
 
   gst_element_class_add_static_pad_template (gstelement_class,
@@ -170,10 +210,23 @@ gst_rtp_h264_pay_init (GstRtpH264Pay * rtph264pay)
   rtph264pay->spspps_interval = DEFAULT_CONFIG_INTERVAL;
   rtph264pay->delta_unit = FALSE;
   rtph264pay->discont = FALSE;
+  rtph264pay->aggregate_mode = DEFAULT_AGGREGATE_MODE;
+  rtph264pay->stap_nals = gst_buffer_list_new ();
 
   rtph264pay->adapter = gst_adapter_new ();
 }
 
+static void
+gst_rtp_h264_pay_reset_aggregate (GstRtpH264Pay * rtph264pay)
+{
+  gst_buffer_list_remove (rtph264pay->stap_nals, 0,
+      gst_buffer_list_length (rtph264pay->stap_nals));
+  if (rtph264pay->au_list) {
+    gst_buffer_list_unref (rtph264pay->au_list);
+    rtph264pay->au_list = NULL;
+  }
+}
+
 static void
 gst_rtp_h264_pay_clear_sps_pps (GstRtpH264Pay * rtph264pay)
 {
@@ -195,6 +248,9 @@ gst_rtp_h264_pay_finalize (GObject * object)
 
   g_free (rtph264pay->sprop_parameter_sets);
 
+  gst_rtp_h264_pay_reset_aggregate (rtph264pay);
+  gst_buffer_list_unref (rtph264pay->stap_nals);
+
   g_object_unref (rtph264pay->adapter);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -770,6 +826,228 @@ gst_rtp_h264_pay_send_sps_pps (GstRTPBasePayload * basepayload,
   return ret;
 }
 
+/* A packet with the RTP header in its own memory, followed by @paybuf */
+static GstBuffer *
+gst_rtp_h264_pay_single_nal (GstRtpH264Pay * rtph264pay, GstBuffer * paybuf,
+    GstClockTime dts, GstClockTime pts, gboolean marker, gboolean delta_unit,
+    gboolean discont)
+{
+  GstRTPBuffer rtp = { NULL };
+  GstBuffer *outbuf;
+
+  /* create buffer without payload containing only the RTP header
+   * (memory block at index 0) */
+  outbuf = gst_rtp_buffer_new_allocate (0, 0, 0);
+
+  gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
+
+  /* only set the marker bit on packets containing access units */
+  if (marker)
+    gst_rtp_buffer_set_marker (&rtp, 1);
+
+  /* timestamp the outbuffer */
+  GST_BUFFER_PTS (outbuf) = pts;
+  GST_BUFFER_DTS (outbuf) = dts;
+
+  if (delta_unit)
+    GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+  if (discont)
+    GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DISCONT);
+
+  gst_rtp_buffer_unmap (&rtp);
+
+  /* insert payload memory block */
+  gst_rtp_copy_video_meta (rtph264pay, outbuf, paybuf);
+  return gst_buffer_append (outbuf, paybuf);
+}
+
+/* Add FU-A packets for @paybuf to @list. Every packet is a small memory with
+ * the RTP and FU headers followed by a slice of the memory of @paybuf. */
+static void
+gst_rtp_h264_pay_fragment_nal (GstRtpH264Pay * rtph264pay,
+    GstBufferList * list, GstBuffer * paybuf, GstClockTime dts,
+    GstClockTime pts, gboolean end_of_au, gboolean delta_unit,
+    gboolean discont)
+{
+  GstRTPBuffer rtp = { NULL };
+  GstBuffer *outbuf;
+  guint8 *payload;
+  guint8 nalHeader;
+  guint8 nalType;
+  guint payload_len, mtu;
+  guint size = gst_buffer_get_size (paybuf);
+  guint limitedSize;
+  int ii = 0, start = 1, end = 0, pos = 0;
+
+  mtu = GST_RTP_BASE_PAYLOAD_MTU (rtph264pay);
+
+  gst_buffer_extract (paybuf, 0, &nalHeader, 1);
+  nalType = nalHeader & 0x1f;
+
+  pos++;
+  size--;
+
+  GST_DEBUG_OBJECT (rtph264pay, "Using FU-A fragmentation for data size=%d",
+      size);
+
+  /* We keep 2 bytes for FU indicator and FU Header */
+  payload_len = gst_rtp_buffer_calc_payload_len (mtu - 2, 0, 0);
+
+  while (end == 0) {
+    limitedSize = size < payload_len ? size : payload_len;
+    GST_DEBUG_OBJECT (rtph264pay,
+        "Inside  FU-A fragmentation limitedSize=%d iteration=%d", limitedSize,
+        ii);
+
+    /* use buffer lists
+     * create buffer without payload containing only the RTP header
+     * (memory block at index 0) */
+    outbuf = gst_rtp_buffer_new_allocate (2, 0, 0);
+
+    gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
+
+    GST_BUFFER_DTS (outbuf) = dts;
+    GST_BUFFER_PTS (outbuf) = pts;
+    payload = gst_rtp_buffer_get_payload (&rtp);
+
+    if (limitedSize == size) {
+      GST_DEBUG_OBJECT (rtph264pay, "end size=%d iteration=%d", size, ii);
+      end = 1;
+    }
+    if (IS_ACCESS_UNIT (nalType)) {
+      gst_rtp_buffer_set_marker (&rtp, end && end_of_au);
+    }
+
+    /* FU indicator */
+    payload[0] = (nalHeader & 0x60) | 28;
+
+    /* FU Header */
+    payload[1] = (start << 7) | (end << 6) | (nalHeader & 0x1f);
+
+    gst_rtp_buffer_unmap (&rtp);
+
+    /* insert payload memory block */
+    gst_rtp_copy_video_meta (rtph264pay, outbuf, paybuf);
+    gst_buffer_copy_into (outbuf, paybuf, GST_BUFFER_COPY_MEMORY, pos,
+        limitedSize);
+
+    if (!delta_unit)
+      /* Only the first packet sent should not have the flag */
+      delta_unit = TRUE;
+    else
+      GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DELTA_UNIT);
+
+    if (discont) {
+      GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DISCONT);
+      /* Only the first packet sent should have the flag */
+      discont = FALSE;
+    }
+
+    /* add the buffer to the buffer list */
+    gst_buffer_list_add (list, outbuf);
+
+    size -= limitedSize;
+    pos += limitedSize;
+    ii++;
+    start = 0;
+  }
+
+  gst_buffer_unref (paybuf);
+}
+
+/* Send the pending small NAL units, in a STAP-A when there is more than
+ * one */
+static void
+gst_rtp_h264_pay_stap_flush (GstRtpH264Pay * rtph264pay)
+{
+  GstBufferList *nals = rtph264pay->stap_nals;
+  guint n_nals = gst_buffer_list_length (nals);
+  GstBuffer *outbuf;
+
+  if (n_nals == 0)
+    return;
+
+  if (n_nals == 1) {
+    outbuf = gst_rtp_h264_pay_single_nal (rtph264pay,
+        gst_buffer_ref (gst_buffer_list_get (nals, 0)), rtph264pay->stap_dts,
+        rtph264pay->stap_pts, rtph264pay->stap_marker,
+        rtph264pay->stap_delta_unit, rtph264pay->stap_discont);
+  } else {
+    GstRTPBuffer rtp = { NULL };
+    guint8 *payload, nri = 0;
+    guint i, pos = 1;
+
+    GST_DEBUG_OBJECT (rtph264pay, "aggregating %u NAL units in a STAP-A",
+        n_nals);
+
+    /* the NAL units are small, copying them into the packet is cheaper than
+     * a memory for each of them and their size fields */
+    outbuf = gst_rtp_buffer_new_allocate (1 + rtph264pay->stap_size, 0, 0);
+
+    gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
+    payload = gst_rtp_buffer_get_payload (&rtp);
+    for (i = 0; i < n_nals; i++) {
+      GstBuffer *nal = gst_buffer_list_get (nals, i);
+      gsize size = gst_buffer_get_size (nal);
+
+      GST_WRITE_UINT16_BE (payload + pos, size);
+      gst_buffer_extract (nal, 0, payload + pos + 2, size);
+      nri = MAX (nri, payload[pos + 2] & 0x60);
+      pos += 2 + size;
+    }
+    /* STAP-A indicator with the highest NRI of the NAL units */
+    payload[0] = nri | 24;
+    gst_rtp_buffer_set_marker (&rtp, rtph264pay->stap_marker);
+    gst_rtp_buffer_unmap (&rtp);
+
+    GST_BUFFER_PTS (outbuf) = rtph264pay->stap_pts;
+    GST_BUFFER_DTS (outbuf) = rtph264pay->stap_dts;
+    if (rtph264pay->stap_delta_unit)
+      GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DELTA_UNIT);
+    if (rtph264pay->stap_discont)
+      GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DISCONT);
+    gst_rtp_copy_video_meta (rtph264pay, outbuf, gst_buffer_list_get (nals,
+            0));
+  }
+  gst_buffer_list_remove (nals, 0, n_nals);
+
+  if (rtph264pay->au_list == NULL)
+    rtph264pay->au_list = gst_buffer_list_new ();
+  gst_buffer_list_add (rtph264pay->au_list, outbuf);
+}
+
+/* Queue @paybuf, a NAL unit that fits in one packet, for aggregation */
+static void
+gst_rtp_h264_pay_stap_add (GstRtpH264Pay * rtph264pay, GstBuffer * paybuf,
+    GstClockTime dts, GstClockTime pts, gboolean marker, gboolean delta_unit,
+    gboolean discont)
+{
+  guint mtu = GST_RTP_BASE_PAYLOAD_MTU (rtph264pay);
+  guint size = gst_buffer_get_size (paybuf);
+
+  /* one byte STAP-A header and 16 bits size in front of each NAL unit */
+  if (gst_buffer_list_length (rtph264pay->stap_nals) > 0 &&
+      gst_rtp_buffer_calc_packet_len (1 + rtph264pay->stap_size + 2 + size,
+          0, 0) >= mtu)
+    gst_rtp_h264_pay_stap_flush (rtph264pay);
+
+  if (gst_buffer_list_length (rtph264pay->stap_nals) == 0) {
+    rtph264pay->stap_size = 0;
+    rtph264pay->stap_dts = dts;
+    rtph264pay->stap_pts = pts;
+    rtph264pay->stap_delta_unit = delta_unit;
+    rtph264pay->stap_discont = discont;
+  } else {
+    rtph264pay->stap_delta_unit &= delta_unit;
+    rtph264pay->stap_discont |= discont;
+  }
+  rtph264pay->stap_marker = marker;
+  rtph264pay->stap_size += 2 + size;
+
+  gst_buffer_list_add (rtph264pay->stap_nals, paybuf);
+}
+
 /* @delta_unit: if %FALSE the first packet sent won't have the
  * GST_BUFFER_FLAG_DELTA_UNIT flag.
  * @discont: if %TRUE the first packet sent will have the
@@ -784,12 +1062,10 @@ gst_rtp_h264_pay_payload_nal (GstRTPBasePayload * basepayload,
   GstFlowReturn ret;
   guint8 nalHeader;
   guint8 nalType;
-  guint packet_len, payload_len, mtu;
+  guint packet_len, mtu;
   GstBuffer *outbuf;
-  guint8 *payload;
   GstBufferList *list = NULL;
   gboolean send_spspps;
-  GstRTPBuffer rtp = { NULL };
   guint size = gst_buffer_get_size (paybuf);
 
   rtph264pay = GST_RTP_H264_PAY (basepayload);
@@ -856,131 +1132,60 @@ gst_rtp_h264_pay_payload_nal (GstRTPBasePayload * basepayload,
 
   packet_len = gst_rtp_buffer_calc_packet_len (size, 0, 0);
 
-  if (packet_len < mtu) {
+  if (rtph264pay->aggregate_mode != GST_RTP_H264_AGGREGATE_NONE) {
+    /* the packets are pushed at the end of the input buffer */
+    if (packet_len < mtu) {
+      gst_rtp_h264_pay_stap_add (rtph264pay, paybuf, dts, pts,
+          IS_ACCESS_UNIT (nalType) && end_of_au, delta_unit, discont);
+    } else {
+      gst_rtp_h264_pay_stap_flush (rtph264pay);
+      if (rtph264pay->au_list == NULL)
+        rtph264pay->au_list = gst_buffer_list_new ();
+      gst_rtp_h264_pay_fragment_nal (rtph264pay, rtph264pay->au_list, paybuf,
+          dts, pts, end_of_au, delta_unit, discont);
+    }
+    ret = GST_FLOW_OK;
+  } else if (packet_len < mtu) {
     /* will fit in one packet */
     GST_DEBUG_OBJECT (basepayload,
         "NAL Unit fit in one packet datasize=%d mtu=%d", size, mtu);
 
-    /* create buffer without payload containing only the RTP header
-     * (memory block at index 0) */
-    outbuf = gst_rtp_buffer_new_allocate (0, 0, 0);
-
-    gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
-
-    /* only set the marker bit on packets containing access units */
-    if (IS_ACCESS_UNIT (nalType) && end_of_au) {
-      gst_rtp_buffer_set_marker (&rtp, 1);
-    }
-
-    /* timestamp the outbuffer */
-    GST_BUFFER_PTS (outbuf) = pts;
-    GST_BUFFER_DTS (outbuf) = dts;
-
-    if (!delta_unit)
-      /* Only the first packet sent should not have the flag */
-      delta_unit = TRUE;
-    else
-      GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DELTA_UNIT);
-
-    if (discont) {
-      GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DISCONT);
-      /* Only the first packet sent should have the flag */
-      discont = FALSE;
-    }
-
-    gst_rtp_buffer_unmap (&rtp);
-
-    /* insert payload memory block */
-    gst_rtp_copy_video_meta (rtph264pay, outbuf, paybuf);
-    outbuf = gst_buffer_append (outbuf, paybuf);
+    outbuf = gst_rtp_h264_pay_single_nal (rtph264pay, paybuf, dts, pts,
+        IS_ACCESS_UNIT (nalType) && end_of_au, delta_unit, discont);
 
     /* push the buffer to the next element */
     ret = gst_rtp_base_payload_push (basepayload, outbuf);
   } else {
-    /* fragmentation Units FU-A */
-    guint limitedSize;
-    int ii = 0, start = 1, end = 0, pos = 0;
-
     GST_DEBUG_OBJECT (basepayload,
         "NAL Unit DOES NOT fit in one packet datasize=%d mtu=%d", size, mtu);
 
-    pos++;
-    size--;
-
-    ret = GST_FLOW_OK;
-
-    GST_DEBUG_OBJECT (basepayload, "Using FU-A fragmentation for data size=%d",
-        size);
-
-    /* We keep 2 bytes for FU indicator and FU Header */
-    payload_len = gst_rtp_buffer_calc_payload_len (mtu - 2, 0, 0);
-
-    list = gst_buffer_list_new_sized ((size / payload_len) + 1);
-
-    while (end == 0) {
-      limitedSize = size < payload_len ? size : payload_len;
-      GST_DEBUG_OBJECT (basepayload,
-          "Inside  FU-A fragmentation limitedSize=%d iteration=%d", limitedSize,
-          ii);
-
-      /* use buffer lists
-       * create buffer without payload containing only the RTP header
-       * (memory block at index 0) */
-      outbuf = gst_rtp_buffer_new_allocate (2, 0, 0);
-
-      gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
-
-      GST_BUFFER_DTS (outbuf) = dts;
-      GST_BUFFER_PTS (outbuf) = pts;
-      payload = gst_rtp_buffer_get_payload (&rtp);
-
-      if (limitedSize == size) {
-        GST_DEBUG_OBJECT (basepayload, "end size=%d iteration=%d", size, ii);
-        end = 1;
-      }
-      if (IS_ACCESS_UNIT (nalType)) {
-        gst_rtp_buffer_set_marker (&rtp, end && end_of_au);
-      }
-
-      /* FU indicator */
-      payload[0] = (nalHeader & 0x60) | 28;
-
-      /* FU Header */
-      payload[1] = (start << 7) | (end << 6) | (nalHeader & 0x1f);
-
-      gst_rtp_buffer_unmap (&rtp);
-
-      /* insert payload memory block */
-      gst_rtp_copy_video_meta (rtph264pay, outbuf, paybuf);
-      gst_buffer_copy_into (outbuf, paybuf, GST_BUFFER_COPY_MEMORY, pos,
-          limitedSize);
+    list = gst_buffer_list_new_sized ((size / mtu) + 1);
+    gst_rtp_h264_pay_fragment_nal (rtph264pay, list, paybuf, dts, pts,
+        end_of_au, delta_unit, discont);
 
-      if (!delta_unit)
-        /* Only the first packet sent should not have the flag */
-        delta_unit = TRUE;
-      else
-        GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DELTA_UNIT);
+    ret = gst_rtp_base_payload_push_list (basepayload, list);
+  }
+  return ret;
+}
 
-      if (discont) {
-        GST_BUFFER_FLAG_SET (outbuf, GST_BUFFER_FLAG_DISCONT);
-        /* Only the first packet sent should have the flag */
-        discont = FALSE;
-      }
+/* push the packets collected for the current input buffer */
+static GstFlowReturn
+gst_rtp_h264_pay_push_aggregate (GstRtpH264Pay * rtph264pay)
+{
+  GstBufferList *list;
 
-      /* add the buffer to the buffer list */
-      gst_buffer_list_add (list, outbuf);
+  gst_rtp_h264_pay_stap_flush (rtph264pay);
 
+  list = rtph264pay->au_list;
+  rtph264pay->au_list = NULL;
+  if (list == NULL)
+    return GST_FLOW_OK;
 
-      size -= limitedSize;
-      pos += limitedSize;
-      ii++;
-      start = 0;
-    }
+  GST_LOG_OBJECT (rtph264pay, "pushing %u packets",
+      gst_buffer_list_length (list));
 
-    ret = gst_rtp_base_payload_push_list (basepayload, list);
-    gst_buffer_unref (paybuf);
-  }
-  return ret;
+  return gst_rtp_base_payload_push_list (GST_RTP_BASE_PAYLOAD (rtph264pay),
+      list);
 }
 
 static GstFlowReturn
@@ -1286,12 +1491,19 @@ done:
     gst_adapter_unmap (rtph264pay->adapter);
   }
 
+  if (ret == GST_FLOW_OK)
+    ret = gst_rtp_h264_pay_push_aggregate (rtph264pay);
+  else
+    gst_rtp_h264_pay_reset_aggregate (rtph264pay);
+
   return ret;
 
 caps_rejected:
   {
     GST_WARNING_OBJECT (basepayload, "Could not set outcaps");
     g_array_set_size (nal_queue, 0);
+    /* don't push the packets collected so far with the next buffer */
+    gst_rtp_h264_pay_reset_aggregate (rtph264pay);
     ret = GST_FLOW_NOT_NEGOTIATED;
     goto done;
   }
@@ -1307,6 +1519,7 @@ gst_rtp_h264_pay_sink_event (GstRTPBasePayload * payload, GstEvent * event)
   switch (GST_EVENT_TYPE (event)) {
     case GST_EVENT_FLUSH_STOP:
       gst_adapter_clear (rtph264pay->adapter);
+      gst_rtp_h264_pay_reset_aggregate (rtph264pay);
       break;
     case GST_EVENT_CUSTOM_DOWNSTREAM:
       s = gst_event_get_structure (event);
@@ -1349,6 +1562,7 @@ gst_rtp_h264_pay_change_state (GstElement * element, GstStateChange transition)
     case GST_STATE_CHANGE_READY_TO_PAUSED:
       rtph264pay->send_spspps = FALSE;
       gst_adapter_clear (rtph264pay->adapter);
+      gst_rtp_h264_pay_reset_aggregate (rtph264pay);
       break;
     default:
       break;
@@ -1385,6 +1599,9 @@ gst_rtp_h264_pay_set_property (GObject * object, guint prop_id,
     case PROP_CONFIG_INTERVAL:
       rtph264pay->spspps_interval = g_value_get_int (value);
       break;
+    case PROP_AGGREGATE_MODE:
+      rtph264pay->aggregate_mode = g_value_get_enum (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1406,6 +1623,9 @@ gst_rtp_h264_pay_get_property (GObject * object, guint prop_id,
     case PROP_CONFIG_INTERVAL:
       g_value_set_int (value, rtph264pay->spspps_interval);
       break;
+    case PROP_AGGREGATE_MODE:
+      g_value_set_enum (value, rtph264pay->aggregate_mode);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
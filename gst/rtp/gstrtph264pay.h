@@ -54,6 +54,12 @@ typedef enum
   GST_H264_ALIGNMENT_AU
 } GstH264Alignment;
 
+typedef enum
+{
+  GST_RTP_H264_AGGREGATE_NONE,
+  GST_RTP_H264_AGGREGATE_ZERO_LATENCY
+} GstRTPH264AggregateMode;
+
 struct _GstRtpH264Pay
 {
   GstRTPBasePayload payload;
@@ -79,6 +85,17 @@ struct _GstRtpH264Pay
   gboolean delta_unit;
   /* TRUE if the next NALU processed should have the DISCONT flag */
   gboolean discont;
+
+  GstRTPH264AggregateMode aggregate_mode;
+  /* packets of the current input buffer when aggregating */
+  GstBufferList *au_list;
+  /* small NAL units waiting to be sent in a STAP-A */
+  GstBufferList *stap_nals;
+  guint stap_size;
+  GstClockTime stap_dts, stap_pts;
+  gboolean stap_marker;
+  gboolean stap_delta_unit;
+  gboolean stap_discont;
 };
 
 struct _GstRtpH264PayClass
@@ -599,8 +599,12 @@ gst_rtp_h265_set_src_caps (GstRtpH265Depay * rtph265depay)
     rtph265depay->codec_data = codec_data;
   }
 
-  if (res)
+  if (res) {
     rtph265depay->new_codec_data = FALSE;
+    rtph265depay->non_contiguous =
+        gst_rtp_query_non_contiguous (GST_ELEMENT (rtph265depay),
+        GST_RTP_BASE_DEPAYLOAD_SRCPAD (rtph265depay));
+  }
 
   return res;
 }
@@ -884,6 +888,87 @@ incomplete_caps:
   }
 }
 
+/* Wrap @size bytes of the payload of @rtp, starting at @data, in a buffer
+ * that shares the memory of the packet */
+static GstBuffer *
+gst_rtp_h265_depay_share_payload (GstRTPBuffer * rtp, const guint8 * data,
+    guint size)
+{
+  GstBuffer *outbuf;
+  guint offset;
+
+  offset = gst_rtp_buffer_get_header_len (rtp) +
+      (data - (const guint8 *) gst_rtp_buffer_get_payload (rtp));
+
+  outbuf = gst_buffer_new ();
+  if (size > 0)
+    gst_buffer_copy_into (outbuf, rtp->buffer, GST_BUFFER_COPY_MEMORY, offset,
+        size);
+
+  return outbuf;
+}
+
+/* The start code in front of a NAL, shared static data. When @nal_header
+ * >= 0 it is appended in a tiny memory of its own, this rebuilds the header of
+ * a fragmented NAL. */
+static GstMemory *
+gst_rtp_h265_depay_make_prefix (gint nal_header)
+{
+  GstMemory *mem;
+  GstMapInfo map;
+
+  if (nal_header < 0)
+    return gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
+        (gpointer) sync_bytes, sizeof (sync_bytes), 0, sizeof (sync_bytes),
+        NULL, NULL);
+
+  mem = gst_allocator_alloc (NULL, sizeof (sync_bytes) + 2, NULL);
+  gst_memory_map (mem, &map, GST_MAP_WRITE);
+  memcpy (map.data, sync_bytes, sizeof (sync_bytes));
+  GST_WRITE_UINT16_BE (map.data + sizeof (sync_bytes), nal_header);
+  gst_memory_unmap (mem, &map);
+
+  return mem;
+}
+
+/* A complete NAL of @nal_size bytes at @data, with a start code. When
+ * downstream accepts it, the NAL is not copied but shared with the packet */
+static GstBuffer *
+gst_rtp_h265_depay_make_nal (GstRtpH265Depay * rtph265depay,
+    GstRTPBuffer * rtp, const guint8 * data, guint nal_size)
+{
+  GstBuffer *outbuf;
+  GstMapInfo map;
+
+  if (rtph265depay->non_contiguous) {
+    outbuf = gst_rtp_h265_depay_share_payload (rtp, data, nal_size);
+    gst_buffer_prepend_memory (outbuf, gst_rtp_h265_depay_make_prefix (-1));
+  } else {
+    outbuf = gst_buffer_new_and_alloc (nal_size + sizeof (sync_bytes));
+
+    gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
+    memcpy (map.data, sync_bytes, sizeof (sync_bytes));
+    memcpy (map.data + sizeof (sync_bytes), data, nal_size);
+    gst_buffer_unmap (outbuf, &map);
+  }
+
+  gst_rtp_copy_video_meta (rtph265depay, outbuf, rtp->buffer);
+
+  return outbuf;
+}
+
+/* take from @adapter without merging the memories if downstream accepts
+ * that */
+static GstBuffer *
+gst_rtp_h265_depay_take (GstRtpH265Depay * rtph265depay, GstAdapter * adapter,
+    gsize size)
+{
+  if (rtph265depay->non_contiguous)
+    return gst_adapter_take_buffer_fast (adapter, size);
+
+  return gst_adapter_take_buffer (adapter, size);
+}
+
 static GstBuffer *
 gst_rtp_h265_complete_au (GstRtpH265Depay * rtph265depay,
     GstClockTime * out_timestamp, gboolean * out_keyframe)
@@ -894,7 +979,8 @@ gst_rtp_h265_complete_au (GstRtpH265Depay * rtph265depay,
   /* we had a picture in the adapter and we completed it */
   GST_DEBUG_OBJECT (rtph265depay, "taking completed AU");
   outsize = gst_adapter_available (rtph265depay->picture_adapter);
-  outbuf = gst_adapter_take_buffer (rtph265depay->picture_adapter, outsize);
+  outbuf = gst_rtp_h265_depay_take (rtph265depay,
+      rtph265depay->picture_adapter, outsize);
 
   *out_timestamp = rtph265depay->last_ts;
   *out_keyframe = rtph265depay->last_keyframe;
@@ -935,16 +1021,16 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
 {
   GstRTPBaseDepayload *depayload = GST_RTP_BASE_DEPAYLOAD (rtph265depay);
   gint nal_type;
-  GstMapInfo map;
+  guint8 header[7] = { 0, };
   GstBuffer *outbuf = NULL;
   GstClockTime out_timestamp;
   gboolean keyframe, out_keyframe;
 
-  gst_buffer_map (nal, &map, GST_MAP_READ);
-  if (G_UNLIKELY (map.size < 5))
+  /* only look at the start, mapping the whole NAL would merge its memories */
+  if (G_UNLIKELY (gst_buffer_extract (nal, 0, header, sizeof (header)) < 5))
     goto short_nal;
 
-  nal_type = (map.data[4] >> 1) & 0x3f;
+  nal_type = (header[4] >> 1) & 0x3f;
   GST_DEBUG_OBJECT (rtph265depay, "handle NAL type %d (RTP marker bit %d)",
       nal_type, marker);
 
@@ -958,7 +1044,6 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
       gst_rtp_h265_depay_add_vps_sps_pps (rtph265depay,
           gst_buffer_copy_region (nal, GST_BUFFER_COPY_ALL,
               4, gst_buffer_get_size (nal) - 4));
-      gst_buffer_unmap (nal, &map);
       gst_buffer_unref (nal);
       return NULL;
     } else if (rtph265depay->sps->len == 0 || rtph265depay->pps->len == 0) {
@@ -969,7 +1054,6 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
           gst_event_new_custom (GST_EVENT_CUSTOM_UPSTREAM,
               gst_structure_new ("GstForceKeyUnit",
                   "all-headers", G_TYPE_BOOLEAN, TRUE, NULL)));
-      gst_buffer_unmap (nal, &map);
       gst_buffer_unref (nal);
       return NULL;
     }
@@ -988,7 +1072,7 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
       if (NAL_TYPE_IS_CODED_SLICE_SEGMENT (nal_type)) {
         /* A NAL unit (X) ends an access unit if the next-occurring VCL NAL unit (Y) has the high-order bit of the first byte after its NAL unit header equal to 1 */
         start = TRUE;
-        if (((map.data[6] >> 7) & 0x01) == 1) {
+        if (((header[6] >> 7) & 0x01) == 1) {
           complete = TRUE;
         }
       } else if ((nal_type >= 32 && nal_type <= 35)
@@ -1004,8 +1088,6 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
             &out_keyframe);
     }
     /* add to adapter */
-    gst_buffer_unmap (nal, &map);
-
     GST_DEBUG_OBJECT (depayload, "adding NAL to picture adapter");
     gst_adapter_push (rtph265depay->picture_adapter, nal);
     rtph265depay->last_ts = in_timestamp;
@@ -1019,7 +1101,6 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
     /* no merge, output is input nal */
     GST_DEBUG_OBJECT (depayload, "using NAL as output");
     outbuf = nal;
-    gst_buffer_unmap (nal, &map);
   }
 
   if (outbuf) {
@@ -1049,7 +1130,6 @@ gst_rtp_h265_depay_handle_nal (GstRtpH265Depay * rtph265depay, GstBuffer * nal,
 short_nal:
   {
     GST_WARNING_OBJECT (depayload, "dropping short NAL");
-    gst_buffer_unmap (nal, &map);
     gst_buffer_unref (nal);
     return NULL;
   }
@@ -1064,17 +1144,29 @@ gst_rtp_h265_push_fragmentation_unit (GstRtpH265Depay * rtph265depay,
   GstBuffer *outbuf;
 
   outsize = gst_adapter_available (rtph265depay->adapter);
-  outbuf = gst_adapter_take_buffer (rtph265depay->adapter, outsize);
 
-  gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-  GST_DEBUG_OBJECT (rtph265depay, "output %d bytes", outsize);
+  if (rtph265depay->fu_shared) {
+    /* the fragments are shared with the packets, only the start code and the
+     * NAL header are new */
+    outbuf = gst_adapter_take_buffer_fast (rtph265depay->adapter, outsize);
+    outbuf = gst_buffer_make_writable (outbuf);
+    GST_DEBUG_OBJECT (rtph265depay, "output %d bytes", outsize + 6);
 
-  if (rtph265depay->byte_stream) {
-    memcpy (map.data, sync_bytes, sizeof (sync_bytes));
+    gst_buffer_prepend_memory (outbuf,
+        gst_rtp_h265_depay_make_prefix (rtph265depay->fu_nal_header));
   } else {
-    goto not_implemented;
+    outbuf = gst_adapter_take_buffer (rtph265depay->adapter, outsize);
+
+    gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
+    GST_DEBUG_OBJECT (rtph265depay, "output %d bytes", outsize);
+
+    if (rtph265depay->byte_stream) {
+      memcpy (map.data, sync_bytes, sizeof (sync_bytes));
+    } else {
+      goto not_implemented;
+    }
+    gst_buffer_unmap (outbuf, &map);
   }
-  gst_buffer_unmap (outbuf, &map);
 
   rtph265depay->current_fu_type = 0;
 
@@ -1221,24 +1313,15 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
           if (nalu_size > (payload_len - 2))
             nalu_size = payload_len - 2;
 
-          outsize = nalu_size + sizeof (sync_bytes);
-          outbuf = gst_buffer_new_and_alloc (outsize);
-
-          gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-          if (rtph265depay->byte_stream) {
-            memcpy (map.data, sync_bytes, sizeof (sync_bytes));
-          } else {
+          if (!rtph265depay->byte_stream)
             goto not_implemented;
-          }
 
           /* strip NALU size */
           payload += 2;
           payload_len -= 2;
 
-          memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
-          gst_buffer_unmap (outbuf, &map);
-
-          gst_rtp_copy_video_meta (rtph265depay, outbuf, rtp->buffer);
+          outbuf = gst_rtp_h265_depay_make_nal (rtph265depay, rtp, payload,
+              nalu_size);
 
           outbuf =
               gst_rtp_h265_depay_handle_nal (rtph265depay, outbuf, timestamp,
@@ -1252,7 +1335,8 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
 
         outsize = gst_adapter_available (rtph265depay->adapter);
         if (outsize > 0)
-          outbuf = gst_adapter_take_buffer (rtph265depay->adapter, outsize);
+          outbuf = gst_rtp_h265_depay_take (rtph265depay,
+              rtph265depay->adapter, outsize);
         break;
       }
       case 49:
@@ -1318,21 +1402,32 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
               ((payload[0] & 0x3f) << 9) | (nuh_layer_id << 3) |
               nuh_temporal_id_plus1;
 
-          /* go back one byte so we can copy the payload + two bytes more in the front which
-           * will be overwritten by the nal_header
-           */
-          payload -= 1;
-          payload_len += 1;
-
-          nalu_size = payload_len;
-          outsize = nalu_size + sizeof (sync_bytes);
-          outbuf = gst_buffer_new_and_alloc (outsize);
-
-          gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-          memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
-          map.data[sizeof (sync_bytes)] = nal_header >> 8;
-          map.data[sizeof (sync_bytes) + 1] = nal_header & 0xff;
-          gst_buffer_unmap (outbuf, &map);
+          rtph265depay->fu_shared = rtph265depay->non_contiguous &&
+              rtph265depay->byte_stream;
+          if (rtph265depay->fu_shared) {
+            /* the start code and NAL header are added when the NAL is
+             * complete */
+            rtph265depay->fu_nal_header = nal_header;
+            outsize = payload_len - 1;
+            outbuf = gst_rtp_h265_depay_share_payload (rtp, payload + 1,
+                outsize);
+          } else {
+            /* go back one byte so we can copy the payload + two bytes more
+             * in the front which will be overwritten by the nal_header
+             */
+            payload -= 1;
+            payload_len += 1;
+
+            nalu_size = payload_len;
+            outsize = nalu_size + sizeof (sync_bytes);
+            outbuf = gst_buffer_new_and_alloc (outsize);
+
+            gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
+            memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
+            map.data[sizeof (sync_bytes)] = nal_header >> 8;
+            map.data[sizeof (sync_bytes) + 1] = nal_header & 0xff;
+            gst_buffer_unmap (outbuf, &map);
+          }
 
           gst_rtp_copy_video_meta (rtph265depay, outbuf, rtp->buffer);
 
@@ -1350,8 +1445,12 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
           payload_len -= 1;
 
           outsize = payload_len;
-          outbuf = gst_buffer_new_and_alloc (outsize);
-          gst_buffer_fill (outbuf, 0, payload, outsize);
+          if (rtph265depay->non_contiguous) {
+            outbuf = gst_rtp_h265_depay_share_payload (rtp, payload, outsize);
+          } else {
+            outbuf = gst_buffer_new_and_alloc (outsize);
+            gst_buffer_fill (outbuf, 0, payload, outsize);
+          }
 
           gst_rtp_copy_video_meta (rtph265depay, outbuf, rtp->buffer);
 
@@ -1385,20 +1484,12 @@ gst_rtp_h265_depay_process (GstRTPBaseDepayload * depayload, GstRTPBuffer * rtp)
           goto not_implemented_donl_present;
 #endif
 
-        nalu_size = payload_len;
-        outsize = nalu_size + sizeof (sync_bytes);
-        outbuf = gst_buffer_new_and_alloc (outsize);
-
-        gst_buffer_map (outbuf, &map, GST_MAP_WRITE);
-        if (rtph265depay->byte_stream) {
-          memcpy (map.data, sync_bytes, sizeof (sync_bytes));
-        } else {
+        if (!rtph265depay->byte_stream)
           goto not_implemented;
-        }
-        memcpy (map.data + sizeof (sync_bytes), payload, nalu_size);
-        gst_buffer_unmap (outbuf, &map);
 
-        gst_rtp_copy_video_meta (rtph265depay, outbuf, rtp->buffer);
+        nalu_size = payload_len;
+        outbuf = gst_rtp_h265_depay_make_nal (rtph265depay, rtp, payload,
+            nalu_size);
 
         outbuf = gst_rtp_h265_depay_handle_nal (rtph265depay, outbuf, timestamp,
             marker);
@@ -58,6 +58,8 @@ struct _GstRtpH265Depay
 
   gchar *stream_format;
   gboolean byte_stream;
+  /* downstream accepts AUs made of memories shared with the packets */
+  gboolean non_contiguous;
 
   GstBuffer *codec_data;
   GstAdapter *adapter;
@@ -74,6 +76,8 @@ struct _GstRtpH265Depay
   guint8 current_fu_type;
   GstClockTime fu_timestamp;
   gboolean fu_marker;
+  gboolean fu_shared;
+  guint16 fu_nal_header;
 
   /* misc */
   GPtrArray *vps;
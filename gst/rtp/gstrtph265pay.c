@@ -102,13 +102,34 @@ GST_STATIC_PAD_TEMPLATE ("src",
     );
 
 #define DEFAULT_CONFIG_INTERVAL		      0
+#define DEFAULT_AGGREGATE_MODE          GST_RTP_H265_AGGREGATE_NONE
 
 enum
 {
   PROP_0,
-  PROP_CONFIG_INTERVAL
+  PROP_CONFIG_INTERVAL,
+  PROP_AGGREGATE_MODE
 };
 
+#define GST_TYPE_RTP_H265_AGGREGATE_MODE \
+  (gst_rtp_h265_aggregate_mode_get_type ())
+static GType
+gst_rtp_h265_aggregate_mode_get_type (void)
+{
+  static GType type = 0;
+  static const GEnumValue values[] = {
+    {GST_RTP_H265_AGGREGATE_NONE, "Do not aggregate NAL units", "none"},
+    {GST_RTP_H265_AGGREGATE_ZERO_LATENCY,
+        "Aggregate the NAL units of each input buffer", "zero-latency"},
+    {0, NULL, NULL},
+  };
+
+  if (!type) {
+    type = g_enum_register_static ("GstRTPH265AggregateMode", values);
+  }
+  return type;
+}
+
 #define IS_ACCESS_UNIT(x) (((x) >= 0x00) && ((x) < 0x20))
 
 static void gst_rtp_h265_pay_finalize (GObject * object);
@@ -157,6 +178,25 @@ gst_rtp_h265_pay_class_init (GstRtpH265PayClass * klass)
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)
       );
 
+  /**
+   * GstRtpH265Pay:aggregate-mode:
+   *
+   * Bundle the NAL units of an input buffer that fit in one packet, such as
+   * VPS, SPS, PPS and SEI, into aggregation packets and push all packets of
+   * the input buffer as one buffer list. With au alignment, this is one list
+   * per access unit.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass),
+      PROP_AGGREGATE_MODE,
+      g_param_spec_enum ("aggregate-mode",
+          "Aggregate mode",
+          "Bundle suitable NAL units into aggregation packets",
+          GST_TYPE_RTP_H265_AGGREGATE_MODE, DEFAULT_AGGREGATE_MODE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)
+      );
+
   gobject_class->finalize = gst_rtp_h265_pay_finalize;
 
   gst_element_class_add_static_pad_template (gstelement_class,
@@ -193,10 +233,23 @@ gst_rtp_h265_pay_init (GstRtpH265Pay * rtph265pay)
       (GDestroyNotify) gst_buffer_unref);
   rtph265pay->last_vps_sps_pps = -1;
   rtph265pay->vps_sps_pps_interval = DEFAULT_CONFIG_INTERVAL;
+  rtph265pay->aggregate_mode = DEFAULT_AGGREGATE_MODE;
+  rtph265pay->ap_nals = gst_buffer_list_new ();
 
   rtph265pay->adapter = gst_adapter_new ();
 }
 
+static void
+gst_rtp_h265_pay_reset_aggregate (GstRtpH265Pay * rtph265pay)
+{
+  gst_buffer_list_remove (rtph265pay->ap_nals, 0,
+      gst_buffer_list_length (rtph265pay->ap_nals));
+  if (rtph265pay->au_list) {
+    gst_buffer_list_unref (rtph265pay->au_list);
+    rtph265pay->au_list = NULL;
+  }
+}
+
 static void
 gst_rtp_h265_pay_clear_vps_sps_pps (GstRtpH265Pay * rtph265pay)
 {
@@ -218,6 +271,9 @@ gst_rtp_h265_pay_finalize (GObject * object)
   g_ptr_array_free (rtph265pay->pps, TRUE);
   g_ptr_array_free (rtph265pay->vps, TRUE);
 
+  gst_rtp_h265_pay_reset_aggregate (rtph265pay);
+  gst_buffer_list_unref (rtph265pay->ap_nals);
+
   g_object_unref (rtph265pay->adapter);
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -806,6 +862,119 @@ gst_rtp_h265_pay_decode_nal (GstRtpH265Pay * payloader,
   return updated;
 }
 
+/* Send the pending small NAL units, in an aggregation packet when there is
+ * more than one */
+static void
+gst_rtp_h265_pay_ap_flush (GstRtpH265Pay * rtph265pay)
+{
+  GstBufferList *nals = rtph265pay->ap_nals;
+  guint n_nals = gst_buffer_list_length (nals);
+  GstRTPBuffer rtp = { NULL };
+  GstBuffer *outbuf;
+
+  if (n_nals == 0)
+    return;
+
+  if (n_nals == 1) {
+    GstBuffer *paybuf = gst_buffer_list_get (nals, 0);
+
+    outbuf = gst_rtp_buffer_new_allocate (0, 0, 0);
+    gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
+    gst_rtp_buffer_set_marker (&rtp, rtph265pay->ap_marker);
+    gst_rtp_buffer_unmap (&rtp);
+
+    gst_rtp_copy_video_meta (rtph265pay, outbuf, paybuf);
+    outbuf = gst_buffer_append (outbuf, gst_buffer_ref (paybuf));
+  } else {
+    guint8 *payload, f = 0, layer_id = 0x3f, tid = 0x7;
+    guint i, pos = 2;
+
+    GST_DEBUG_OBJECT (rtph265pay, "aggregating %u NAL units in an AP",
+        n_nals);
+
+    /* the NAL units are small, copying them into the packet is cheaper than
+     * a memory for each of them and their size fields */
+    outbuf = gst_rtp_buffer_new_allocate (2 + rtph265pay->ap_size, 0, 0);
+
+    gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
+    payload = gst_rtp_buffer_get_payload (&rtp);
+    for (i = 0; i < n_nals; i++) {
+      GstBuffer *nal = gst_buffer_list_get (nals, i);
+      gsize size = gst_buffer_get_size (nal);
+      guint8 *hdr = payload + pos + 2;
+
+      GST_WRITE_UINT16_BE (payload + pos, size);
+      gst_buffer_extract (nal, 0, hdr, size);
+      f |= hdr[0] & 0x80;
+      layer_id = MIN (layer_id, ((hdr[0] & 0x01) << 5) | (hdr[1] >> 3));
+      tid = MIN (tid, hdr[1] & 0x07);
+      pos += 2 + size;
+    }
+    /* PayloadHdr (type = 48) with the lowest LayerId and TID of the NAL
+     * units */
+    payload[0] = f | (48 << 1) | (layer_id >> 5);
+    payload[1] = ((layer_id & 0x1f) << 3) | tid;
+    gst_rtp_buffer_set_marker (&rtp, rtph265pay->ap_marker);
+    gst_rtp_buffer_unmap (&rtp);
+
+    gst_rtp_copy_video_meta (rtph265pay, outbuf, gst_buffer_list_get (nals,
+            0));
+  }
+  GST_BUFFER_PTS (outbuf) = rtph265pay->ap_pts;
+  GST_BUFFER_DTS (outbuf) = rtph265pay->ap_dts;
+
+  gst_buffer_list_remove (nals, 0, n_nals);
+
+  if (rtph265pay->au_list == NULL)
+    rtph265pay->au_list = gst_buffer_list_new ();
+  gst_buffer_list_add (rtph265pay->au_list, outbuf);
+}
+
+/* Queue @paybuf, a NAL unit that fits in one packet, for aggregation */
+static void
+gst_rtp_h265_pay_ap_add (GstRtpH265Pay * rtph265pay, GstBuffer * paybuf,
+    GstClockTime dts, GstClockTime pts, gboolean marker)
+{
+  guint mtu = GST_RTP_BASE_PAYLOAD_MTU (rtph265pay);
+  guint size = gst_buffer_get_size (paybuf);
+
+  /* two bytes PayloadHdr and 16 bits size in front of each NAL unit */
+  if (gst_buffer_list_length (rtph265pay->ap_nals) > 0 &&
+      gst_rtp_buffer_calc_packet_len (2 + rtph265pay->ap_size + 2 + size,
+          0, 0) >= mtu)
+    gst_rtp_h265_pay_ap_flush (rtph265pay);
+
+  if (gst_buffer_list_length (rtph265pay->ap_nals) == 0) {
+    rtph265pay->ap_size = 0;
+    rtph265pay->ap_dts = dts;
+    rtph265pay->ap_pts = pts;
+  }
+  rtph265pay->ap_marker = marker;
+  rtph265pay->ap_size += 2 + size;
+
+  gst_buffer_list_add (rtph265pay->ap_nals, paybuf);
+}
+
+/* push the packets collected for the current input buffer */
+static GstFlowReturn
+gst_rtp_h265_pay_push_aggregate (GstRtpH265Pay * rtph265pay)
+{
+  GstBufferList *list;
+
+  gst_rtp_h265_pay_ap_flush (rtph265pay);
+
+  list = rtph265pay->au_list;
+  rtph265pay->au_list = NULL;
+  if (list == NULL)
+    return GST_FLOW_OK;
+
+  GST_LOG_OBJECT (rtph265pay, "pushing %u packets",
+      gst_buffer_list_length (list));
+
+  return gst_rtp_base_payload_push_list (GST_RTP_BASE_PAYLOAD (rtph265pay),
+      list);
+}
+
 static GstFlowReturn
 gst_rtp_h265_pay_payload_nal (GstRTPBasePayload * basepayload,
     GPtrArray * paybufs, GstClockTime dts, GstClockTime pts);
@@ -887,6 +1056,7 @@ gst_rtp_h265_pay_payload_nal (GstRTPBasePayload * basepayload,
     guint8 *payload;
     GstBufferList *outlist = NULL;
     gboolean send_ps;
+    gboolean marker;
     GstRTPBuffer rtp = { NULL };
     guint size;
 
@@ -977,7 +1147,16 @@ gst_rtp_h265_pay_payload_nal (GstRTPBasePayload * basepayload,
 
     packet_len = gst_rtp_buffer_calc_packet_len (size, 0, 0);
 
-    if (packet_len < mtu) {
+    /* only set the marker bit on packets containing access units */
+    marker = i == paybufs->len - 1
+        && rtph265pay->alignment == GST_H265_ALIGNMENT_AU
+        && IS_ACCESS_UNIT (nalType);
+
+    if (packet_len < mtu
+        && rtph265pay->aggregate_mode != GST_RTP_H265_AGGREGATE_NONE) {
+      /* pushed with the other packets at the end of the input buffer */
+      gst_rtp_h265_pay_ap_add (rtph265pay, paybuf, dts, pts, marker);
+    } else if (packet_len < mtu) {
       GST_DEBUG_OBJECT (rtph265pay,
           "NAL Unit fit in one packet datasize=%d mtu=%d", size, mtu);
       /* will fit in one packet */
@@ -989,12 +1168,8 @@ gst_rtp_h265_pay_payload_nal (GstRTPBasePayload * basepayload,
 
       gst_rtp_buffer_map (outbuf, GST_MAP_WRITE, &rtp);
 
-      /* only set the marker bit on packets containing access units */
-      if (i == paybufs->len - 1
-          && rtph265pay->alignment == GST_H265_ALIGNMENT_AU
-          && IS_ACCESS_UNIT (nalType)) {
+      if (marker)
         gst_rtp_buffer_set_marker (&rtp, 1);
-      }
 
       /* timestamp the outbuffer */
       GST_BUFFER_PTS (outbuf) = pts;
@@ -1030,7 +1205,15 @@ gst_rtp_h265_pay_payload_nal (GstRTPBasePayload * basepayload,
       /* We keep 3 bytes for PayloadHdr and FU Header */
       payload_len = gst_rtp_buffer_calc_payload_len (mtu - 3, 0, 0);
 
-      outlist = gst_buffer_list_new ();
+      if (rtph265pay->aggregate_mode != GST_RTP_H265_AGGREGATE_NONE) {
+        /* keep the packet order, the pending NAL units go first */
+        gst_rtp_h265_pay_ap_flush (rtph265pay);
+        if (rtph265pay->au_list == NULL)
+          rtph265pay->au_list = gst_buffer_list_new ();
+        outlist = rtph265pay->au_list;
+      } else {
+        outlist = gst_buffer_list_new ();
+      }
 
       while (end == 0) {
         limitedSize = size < payload_len ? size : payload_len;
@@ -1083,7 +1266,8 @@ gst_rtp_h265_pay_payload_nal (GstRTPBasePayload * basepayload,
         start = 0;
       }
 
-      ret = gst_rtp_base_payload_push_list (basepayload, outlist);
+      if (outlist != rtph265pay->au_list)
+        ret = gst_rtp_base_payload_push_list (basepayload, outlist);
       gst_buffer_unref (paybuf);
     }
   }
@@ -1307,12 +1491,19 @@ done:
     gst_adapter_unmap (rtph265pay->adapter);
   }
 
+  if (ret == GST_FLOW_OK)
+    ret = gst_rtp_h265_pay_push_aggregate (rtph265pay);
+  else
+    gst_rtp_h265_pay_reset_aggregate (rtph265pay);
+
   return ret;
 
 caps_rejected:
   {
     GST_WARNING_OBJECT (basepayload, "Could not set outcaps");
     g_array_set_size (nal_queue, 0);
+    /* don't push the packets collected so far with the next buffer */
+    gst_rtp_h265_pay_reset_aggregate (rtph265pay);
     ret = GST_FLOW_NOT_NEGOTIATED;
     goto done;
   }
@@ -1328,6 +1519,7 @@ gst_rtp_h265_pay_sink_event (GstRTPBasePayload * payload, GstEvent * event)
   switch (GST_EVENT_TYPE (event)) {
     case GST_EVENT_FLUSH_STOP:
       gst_adapter_clear (rtph265pay->adapter);
+      gst_rtp_h265_pay_reset_aggregate (rtph265pay);
       break;
     case GST_EVENT_CUSTOM_DOWNSTREAM:
       s = gst_event_get_structure (event);
@@ -1371,6 +1563,7 @@ gst_rtp_h265_pay_change_state (GstElement * element, GstStateChange transition)
     case GST_STATE_CHANGE_READY_TO_PAUSED:
       rtph265pay->send_vps_sps_pps = FALSE;
       gst_adapter_clear (rtph265pay->adapter);
+      gst_rtp_h265_pay_reset_aggregate (rtph265pay);
       break;
     default:
       break;
@@ -1402,6 +1595,9 @@ gst_rtp_h265_pay_set_property (GObject * object, guint prop_id,
     case PROP_CONFIG_INTERVAL:
       rtph265pay->vps_sps_pps_interval = g_value_get_int (value);
       break;
+    case PROP_AGGREGATE_MODE:
+      rtph265pay->aggregate_mode = g_value_get_enum (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1420,6 +1616,9 @@ gst_rtp_h265_pay_get_property (GObject * object, guint prop_id,
     case PROP_CONFIG_INTERVAL:
       g_value_set_int (value, rtph265pay->vps_sps_pps_interval);
       break;
+    case PROP_AGGREGATE_MODE:
+      g_value_set_enum (value, rtph265pay->aggregate_mode);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
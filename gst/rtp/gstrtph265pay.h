@@ -47,6 +47,12 @@ typedef enum
   GST_H265_ALIGNMENT_AU
 } GstH265Alignment;
 
+typedef enum
+{
+  GST_RTP_H265_AGGREGATE_NONE,
+  GST_RTP_H265_AGGREGATE_ZERO_LATENCY
+} GstRTPH265AggregateMode;
+
 struct _GstRtpH265Pay
 {
   GstRTPBasePayload payload;
@@ -63,6 +69,15 @@ struct _GstRtpH265Pay
   gint vps_sps_pps_interval;
   gboolean send_vps_sps_pps;
   GstClockTime last_vps_sps_pps;
+
+  GstRTPH265AggregateMode aggregate_mode;
+  /* packets of the current input buffer when aggregating */
+  GstBufferList *au_list;
+  /* small NAL units waiting to be sent in an aggregation packet */
+  GstBufferList *ap_nals;
+  guint ap_size;
+  GstClockTime ap_dts, ap_pts;
+  gboolean ap_marker;
 };
 
 struct _GstRtpH265PayClass
@@ -149,3 +149,46 @@ gst_rtp_read_golomb (GstBitReader * br, guint32 * value)
 
   return TRUE;
 }
+
+GType
+gst_rtp_non_contiguous_api_get_type (void)
+{
+  static volatile GType type = 0;
+  static const gchar *tags[] = { NULL };
+
+  if (g_once_init_enter (&type)) {
+    GType _type = gst_meta_api_type_register ("GstRTPNonContiguousAPI", tags);
+    g_once_init_leave (&type, _type);
+  }
+  return type;
+}
+
+/* Downstream elements that can handle buffers made of many small memories,
+ * without mapping them as a whole, opt in by adding the
+ * GstRTPNonContiguousAPI meta (looked up with g_type_from_name()) to their
+ * answer of the ALLOCATION query. Depayloaders can then output such buffers
+ * instead of copying everything into one memory. */
+gboolean
+gst_rtp_query_non_contiguous (GstElement * element, GstPad * srcpad)
+{
+  /* register the API before downstream looks it up */
+  GType api = GST_RTP_NON_CONTIGUOUS_API_TYPE;
+  GstQuery *query;
+  GstCaps *caps;
+  gboolean res = FALSE;
+
+  caps = gst_pad_get_current_caps (srcpad);
+  if (caps == NULL)
+    return FALSE;
+
+  query = gst_query_new_allocation (caps, FALSE);
+  if (gst_pad_peer_query (srcpad, query))
+    res = gst_query_find_allocation_meta (query, api, NULL);
+  gst_query_unref (query);
+  gst_caps_unref (caps);
+
+  GST_DEBUG_OBJECT (element, "downstream accepts non-contiguous buffers: %d",
+      res);
+
+  return res;
+}
@@ -46,6 +46,13 @@ void gst_rtp_drop_non_video_meta (gpointer element, GstBuffer * buf);
 G_GNUC_INTERNAL
 gboolean gst_rtp_read_golomb (GstBitReader * br, guint32 * value);
 
+G_GNUC_INTERNAL
+GType gst_rtp_non_contiguous_api_get_type (void);
+#define GST_RTP_NON_CONTIGUOUS_API_TYPE (gst_rtp_non_contiguous_api_get_type())
+
+G_GNUC_INTERNAL
+gboolean gst_rtp_query_non_contiguous (GstElement * element, GstPad * srcpad);
+
 G_GNUC_INTERNAL extern GQuark rtp_quark_meta_tag_video;
 G_GNUC_INTERNAL extern GQuark rtp_quark_meta_tag_audio;
 
@@ -32,6 +32,14 @@
 GST_DEBUG_CATEGORY_STATIC (rtpvrawdepay_debug);
 #define GST_CAT_DEFAULT (rtpvrawdepay_debug)
 
+enum
+{
+  PROP_0,
+  PROP_CONCEAL
+};
+
+#define DEFAULT_CONCEAL FALSE
+
 static GstStaticPadTemplate gst_rtp_vraw_depay_src_template =
 GST_STATIC_PAD_TEMPLATE ("src",
     GST_PAD_SRC,
@@ -72,15 +80,42 @@ static GstStateChangeReturn gst_rtp_vraw_depay_change_state (GstElement *
 static gboolean gst_rtp_vraw_depay_handle_event (GstRTPBaseDepayload * filter,
     GstEvent * event);
 
+static void gst_rtp_vraw_depay_finalize (GObject * object);
+static void gst_rtp_vraw_depay_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec);
+static void gst_rtp_vraw_depay_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec);
+
 static void
 gst_rtp_vraw_depay_class_init (GstRtpVRawDepayClass * klass)
 {
+  GObjectClass *gobject_class;
   GstElementClass *gstelement_class;
   GstRTPBaseDepayloadClass *gstrtpbasedepayload_class;
 
+  gobject_class = (GObjectClass *) klass;
   gstelement_class = (GstElementClass *) klass;
   gstrtpbasedepayload_class = (GstRTPBaseDepayloadClass *) klass;
 
+  gobject_class->finalize = gst_rtp_vraw_depay_finalize;
+  gobject_class->set_property = gst_rtp_vraw_depay_set_property;
+  gobject_class->get_property = gst_rtp_vraw_depay_get_property;
+
+  /**
+   * GstRtpVRawDepay:conceal:
+   *
+   * When a frame is pushed with lines for which no data was received, copy
+   * those lines from the previous frame instead of leaving whatever the
+   * buffer contained before. Lines that were only partially received are
+   * not touched. This keeps a reference to the last pushed frame.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_CONCEAL,
+      g_param_spec_boolean ("conceal", "Conceal",
+          "Copy lost lines from the previous frame", DEFAULT_CONCEAL,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstelement_class->change_state = gst_rtp_vraw_depay_change_state;
 
   gstrtpbasedepayload_class->set_caps = gst_rtp_vraw_depay_setcaps;
@@ -105,6 +140,18 @@ gst_rtp_vraw_depay_class_init (GstRtpVRawDepayClass * klass)
 static void
 gst_rtp_vraw_depay_init (GstRtpVRawDepay * rtpvrawdepay)
 {
+  rtpvrawdepay->conceal = DEFAULT_CONCEAL;
+}
+
+static void
+gst_rtp_vraw_depay_finalize (GObject * object)
+{
+  GstRtpVRawDepay *rtpvrawdepay = GST_RTP_VRAW_DEPAY (object);
+
+  g_free (rtpvrawdepay->line_fill);
+  g_free (rtpvrawdepay->received);
+
+  G_OBJECT_CLASS (parent_class)->finalize (object);
 }
 
 static void
@@ -115,7 +162,16 @@ gst_rtp_vraw_depay_reset (GstRtpVRawDepay * rtpvrawdepay)
     gst_buffer_unref (rtpvrawdepay->outbuf);
     rtpvrawdepay->outbuf = NULL;
   }
+  gst_buffer_replace (&rtpvrawdepay->prev_buffer, NULL);
   rtpvrawdepay->timestamp = -1;
+  rtpvrawdepay->have_pushed = FALSE;
+  if (rtpvrawdepay->line_fill) {
+    memset (rtpvrawdepay->line_fill, 0,
+        rtpvrawdepay->n_lines * sizeof (guint16));
+    memset (rtpvrawdepay->received, 0,
+        rtpvrawdepay->n_lines * rtpvrawdepay->received_stride);
+  }
+  rtpvrawdepay->lines_complete = 0;
   if (rtpvrawdepay->pool) {
     gst_buffer_pool_set_active (rtpvrawdepay->pool, FALSE);
     gst_object_unref (rtpvrawdepay->pool);
@@ -265,6 +321,19 @@ gst_rtp_vraw_depay_setcaps (GstRTPBaseDepayload * depayload, GstCaps * caps)
   rtpvrawdepay->xinc = xinc;
   rtpvrawdepay->yinc = yinc;
 
+  /* the previous frame is of no use for concealment anymore */
+  gst_buffer_replace (&rtpvrawdepay->prev_buffer, NULL);
+
+  g_free (rtpvrawdepay->line_fill);
+  g_free (rtpvrawdepay->received);
+  rtpvrawdepay->n_lines = (height + yinc - 1) / yinc;
+  rtpvrawdepay->line_pgroups = (width + xinc - 1) / xinc;
+  rtpvrawdepay->line_fill = g_new0 (guint16, rtpvrawdepay->n_lines);
+  rtpvrawdepay->received_stride = (rtpvrawdepay->line_pgroups + 7) / 8;
+  rtpvrawdepay->received = g_new0 (guint8,
+      rtpvrawdepay->n_lines * rtpvrawdepay->received_stride);
+  rtpvrawdepay->lines_complete = 0;
+
   srccaps = gst_video_info_to_caps (&rtpvrawdepay->vinfo);
   res = gst_pad_set_caps (GST_RTP_BASE_DEPAYLOAD_SRCPAD (depayload), srccaps);
   gst_caps_unref (srccaps);
@@ -319,6 +388,164 @@ no_bufferpool:
   }
 }
 
+/* pgroup unpacking for the formats that are not laid out as in RFC 4175.
+ * The loops only use indexed loads and stores without dependencies between
+ * the iterations so that the compiler can vectorize them. */
+static void
+gst_rtp_vraw_depay_unpack_ayuv (guint8 * out, const guint8 * in,
+    guint pgroups)
+{
+  guint i;
+
+  /* samples are packed in order Cb-Y-Cr for both interlaced and
+   * progressive frames */
+  for (i = 0; i < pgroups; i++) {
+    out[4 * i + 0] = 0;
+    out[4 * i + 1] = in[3 * i + 1];
+    out[4 * i + 2] = in[3 * i + 0];
+    out[4 * i + 3] = in[3 * i + 2];
+  }
+}
+
+static void
+gst_rtp_vraw_depay_unpack_i420 (guint8 * y1, guint8 * y2, guint8 * u,
+    guint8 * v, const guint8 * in, guint pgroups)
+{
+  guint i;
+
+  /* line 0/1: Y00-Y01-Y10-Y11-Cb00-Cr00 Y02-Y03-Y12-Y13-Cb01-Cr01 ...  */
+  for (i = 0; i < pgroups; i++) {
+    y1[2 * i + 0] = in[6 * i + 0];
+    y1[2 * i + 1] = in[6 * i + 1];
+    y2[2 * i + 0] = in[6 * i + 2];
+    y2[2 * i + 1] = in[6 * i + 3];
+    u[i] = in[6 * i + 4];
+    v[i] = in[6 * i + 5];
+  }
+}
+
+static void
+gst_rtp_vraw_depay_unpack_y41b (guint8 * y, guint8 * u, guint8 * v,
+    const guint8 * in, guint pgroups)
+{
+  guint i;
+
+  /* Samples are packed in order Cb0-Y0-Y1-Cr0-Y2-Y3 for both interlaced
+   * and progressive scan lines */
+  for (i = 0; i < pgroups; i++) {
+    u[i] = in[6 * i + 0];
+    y[4 * i + 0] = in[6 * i + 1];
+    y[4 * i + 1] = in[6 * i + 2];
+    v[i] = in[6 * i + 3];
+    y[4 * i + 2] = in[6 * i + 4];
+    y[4 * i + 3] = in[6 * i + 5];
+  }
+}
+
+/* copy the lines of the current frame for which we received nothing from the
+ * previous frame */
+static void
+gst_rtp_vraw_depay_conceal (GstRtpVRawDepay * rtpvrawdepay)
+{
+  GstVideoFrame prev, *frame = &rtpvrawdepay->frame;
+  guint i, plane, concealed = 0;
+  gint height, yinc;
+
+  if (rtpvrawdepay->prev_buffer == NULL)
+    return;
+
+  if (!gst_video_frame_map (&prev, &rtpvrawdepay->vinfo,
+          rtpvrawdepay->prev_buffer, GST_MAP_READ))
+    return;
+
+  height = GST_VIDEO_INFO_HEIGHT (&rtpvrawdepay->vinfo);
+  yinc = rtpvrawdepay->yinc;
+
+  for (i = 0; i < rtpvrawdepay->n_lines; i++) {
+    if (rtpvrawdepay->line_fill[i] != 0)
+      continue;
+
+    for (plane = 0; plane < GST_VIDEO_FRAME_N_PLANES (frame); plane++) {
+      guint8 *dest = GST_VIDEO_FRAME_PLANE_DATA (frame, plane);
+      const guint8 *src = GST_VIDEO_FRAME_PLANE_DATA (&prev, plane);
+      gint dstride = GST_VIDEO_FRAME_PLANE_STRIDE (frame, plane);
+      gint sstride = GST_VIDEO_FRAME_PLANE_STRIDE (&prev, plane);
+      gint plane_height = GST_VIDEO_FRAME_COMP_HEIGHT (frame, plane);
+      gint row, first, last;
+
+      /* the rows of this plane that belong to line i */
+      first = i * yinc * plane_height / height;
+      last = MIN ((i + 1) * yinc * plane_height / height, plane_height);
+
+      for (row = first; row < last; row++)
+        memcpy (dest + row * dstride, src + row * sstride,
+            MIN (dstride, sstride));
+    }
+    concealed++;
+  }
+
+  gst_video_frame_unmap (&prev);
+
+  GST_DEBUG_OBJECT (rtpvrawdepay, "concealed %u lines", concealed);
+}
+
+/* unmap and return the current output buffer, ready to be pushed */
+static GstBuffer *
+gst_rtp_vraw_depay_finish_frame (GstRtpVRawDepay * rtpvrawdepay)
+{
+  GstBuffer *outbuf = rtpvrawdepay->outbuf;
+
+  if (rtpvrawdepay->lines_complete < rtpvrawdepay->n_lines) {
+    GST_DEBUG_OBJECT (rtpvrawdepay, "incomplete frame, %u of %u lines",
+        rtpvrawdepay->lines_complete, rtpvrawdepay->n_lines);
+    if (rtpvrawdepay->conceal)
+      gst_rtp_vraw_depay_conceal (rtpvrawdepay);
+  }
+
+  gst_video_frame_unmap (&rtpvrawdepay->frame);
+  rtpvrawdepay->outbuf = NULL;
+
+  if (rtpvrawdepay->conceal)
+    gst_buffer_replace (&rtpvrawdepay->prev_buffer, outbuf);
+
+  memset (rtpvrawdepay->line_fill, 0,
+      rtpvrawdepay->n_lines * sizeof (guint16));
+  memset (rtpvrawdepay->received, 0,
+      rtpvrawdepay->n_lines * rtpvrawdepay->received_stride);
+  rtpvrawdepay->lines_complete = 0;
+
+  rtpvrawdepay->pushed_timestamp = rtpvrawdepay->timestamp;
+  rtpvrawdepay->have_pushed = TRUE;
+
+  return outbuf;
+}
+
+/* mark @n pixel groups of @line starting at pixel group @first as received.
+ * Pixel groups that arrive more than once, e.g. in duplicated packets, are
+ * only counted once. */
+static void
+gst_rtp_vraw_depay_mark_received (GstRtpVRawDepay * rtpvrawdepay, guint line,
+    guint first, guint n)
+{
+  guint8 *bits = rtpvrawdepay->received + line * rtpvrawdepay->received_stride;
+  guint16 *fill = &rtpvrawdepay->line_fill[line];
+  guint i, end;
+
+  if (*fill == rtpvrawdepay->line_pgroups)
+    return;
+
+  end = MIN (first + n, rtpvrawdepay->line_pgroups);
+  for (i = first; i < end; i++) {
+    if (!(bits[i / 8] & (1 << (i % 8)))) {
+      bits[i / 8] |= 1 << (i % 8);
+      (*fill)++;
+    }
+  }
+
+  if (*fill == rtpvrawdepay->line_pgroups)
+    rtpvrawdepay->lines_complete++;
+}
+
 static GstBuffer *
 gst_rtp_vraw_depay_process_packet (GstRTPBaseDepayload * depayload,
     GstRTPBuffer * rtp)
@@ -336,6 +563,14 @@ gst_rtp_vraw_depay_process_packet (GstRTPBaseDepayload * depayload,
 
   timestamp = gst_rtp_buffer_get_timestamp (rtp);
 
+  if (rtpvrawdepay->outbuf == NULL && rtpvrawdepay->have_pushed &&
+      timestamp == rtpvrawdepay->pushed_timestamp) {
+    /* reordered or duplicated packet of a frame we pushed already */
+    GST_LOG_OBJECT (depayload, "dropping late packet for timestamp %u",
+        timestamp);
+    return NULL;
+  }
+
   if (timestamp != rtpvrawdepay->timestamp || rtpvrawdepay->outbuf == NULL) {
     GstBuffer *new_buffer;
     GstFlowReturn ret;
@@ -343,9 +578,8 @@ gst_rtp_vraw_depay_process_packet (GstRTPBaseDepayload * depayload,
     GST_LOG_OBJECT (depayload, "new frame with timestamp %u", timestamp);
     /* new timestamp, flush old buffer and create new output buffer */
     if (rtpvrawdepay->outbuf) {
-      gst_video_frame_unmap (&rtpvrawdepay->frame);
-      gst_rtp_base_depayload_push (depayload, rtpvrawdepay->outbuf);
-      rtpvrawdepay->outbuf = NULL;
+      gst_rtp_base_depayload_push (depayload,
+          gst_rtp_vraw_depay_finish_frame (rtpvrawdepay));
     }
 
     if (gst_pad_check_reconfigure (GST_RTP_BASE_DEPAYLOAD_SRCPAD (depayload))) {
@@ -467,6 +701,9 @@ gst_rtp_vraw_depay_process_packet (GstRTPBaseDepayload * depayload,
         "writing length %u/%u, line %u, offset %u, remaining %u", plen, length,
         line, offs, payload_len);
 
+    gst_rtp_vraw_depay_mark_received (rtpvrawdepay, line / yinc, offs / xinc,
+        plen / pgroup);
+
     switch (GST_VIDEO_INFO_FORMAT (&rtpvrawdepay->vinfo)) {
       case GST_VIDEO_FORMAT_RGB:
       case GST_VIDEO_FORMAT_RGBA:
@@ -481,74 +718,29 @@ gst_rtp_vraw_depay_process_packet (GstRTPBaseDepayload * depayload,
         memcpy (datap, payload, plen);
         break;
       case GST_VIDEO_FORMAT_AYUV:
-      {
-        gint i;
-        guint8 *p;
-
         datap = p0 + (line * ystride) + (offs * 4);
-        p = payload;
-
-        /* samples are packed in order Cb-Y-Cr for both interlaced and
-         * progressive frames */
-        for (i = 0; i < plen; i += pgroup) {
-          *datap++ = 0;
-          *datap++ = p[1];
-          *datap++ = p[0];
-          *datap++ = p[2];
-          p += pgroup;
-        }
+        gst_rtp_vraw_depay_unpack_ayuv (datap, payload, plen / pgroup);
         break;
-      }
       case GST_VIDEO_FORMAT_I420:
       {
-        gint i;
         guint uvoff;
-        guint8 *yd1p, *yd2p, *udp, *vdp, *p;
 
-        yd1p = yp + (line * ystride) + (offs);
-        yd2p = yd1p + ystride;
+        datap = yp + (line * ystride) + (offs);
         uvoff = (line / yinc * uvstride) + (offs / xinc);
 
-        udp = up + uvoff;
-        vdp = vp + uvoff;
-        p = payload;
-
-        /* line 0/1: Y00-Y01-Y10-Y11-Cb00-Cr00 Y02-Y03-Y12-Y13-Cb01-Cr01 ...  */
-        for (i = 0; i < plen; i += pgroup) {
-          *yd1p++ = p[0];
-          *yd1p++ = p[1];
-          *yd2p++ = p[2];
-          *yd2p++ = p[3];
-          *udp++ = p[4];
-          *vdp++ = p[5];
-          p += pgroup;
-        }
+        gst_rtp_vraw_depay_unpack_i420 (datap, datap + ystride, up + uvoff,
+            vp + uvoff, payload, plen / pgroup);
         break;
       }
       case GST_VIDEO_FORMAT_Y41B:
       {
-        gint i;
         guint uvoff;
-        guint8 *ydp, *udp, *vdp, *p;
 
-        ydp = yp + (line * ystride) + (offs);
+        datap = yp + (line * ystride) + (offs);
         uvoff = (line / yinc * uvstride) + (offs / xinc);
 
-        udp = up + uvoff;
-        vdp = vp + uvoff;
-        p = payload;
-
-        /* Samples are packed in order Cb0-Y0-Y1-Cr0-Y2-Y3 for both interlaced
-         * and progressive scan lines */
-        for (i = 0; i < plen; i += pgroup) {
-          *udp++ = p[0];
-          *ydp++ = p[1];
-          *ydp++ = p[2];
-          *vdp++ = p[3];
-          *ydp++ = p[4];
-          *ydp++ = p[5];
-          p += pgroup;
-        }
+        gst_rtp_vraw_depay_unpack_y41b (datap, up + uvoff, vp + uvoff,
+            payload, plen / pgroup);
         break;
       }
       default:
@@ -565,11 +757,12 @@ gst_rtp_vraw_depay_process_packet (GstRTPBaseDepayload * depayload,
 
   marker = gst_rtp_buffer_get_marker (rtp);
 
-  if (marker) {
-    GST_LOG_OBJECT (depayload, "marker, flushing frame");
-    gst_video_frame_unmap (&rtpvrawdepay->frame);
-    outbuf = rtpvrawdepay->outbuf;
-    rtpvrawdepay->outbuf = NULL;
+  /* push as soon as all lines are there, the marker packet could have been
+   * reordered */
+  if (marker || rtpvrawdepay->lines_complete == rtpvrawdepay->n_lines) {
+    GST_LOG_OBJECT (depayload, "%s, flushing frame",
+        marker ? "marker" : "all lines received");
+    outbuf = gst_rtp_vraw_depay_finish_frame (rtpvrawdepay);
     rtpvrawdepay->timestamp = -1;
   }
   return outbuf;
@@ -625,6 +818,38 @@ gst_rtp_vraw_depay_handle_event (GstRTPBaseDepayload * filter, GstEvent * event)
   return ret;
 }
 
+static void
+gst_rtp_vraw_depay_set_property (GObject * object, guint prop_id,
+    const GValue * value, GParamSpec * pspec)
+{
+  GstRtpVRawDepay *rtpvrawdepay = GST_RTP_VRAW_DEPAY (object);
+
+  switch (prop_id) {
+    case PROP_CONCEAL:
+      rtpvrawdepay->conceal = g_value_get_boolean (value);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
+static void
+gst_rtp_vraw_depay_get_property (GObject * object, guint prop_id,
+    GValue * value, GParamSpec * pspec)
+{
+  GstRtpVRawDepay *rtpvrawdepay = GST_RTP_VRAW_DEPAY (object);
+
+  switch (prop_id) {
+    case PROP_CONCEAL:
+      g_value_set_boolean (value, rtpvrawdepay->conceal);
+      break;
+    default:
+      G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+      break;
+  }
+}
+
 static GstStateChangeReturn
 gst_rtp_vraw_depay_change_state (GstElement * element,
     GstStateChange transition)
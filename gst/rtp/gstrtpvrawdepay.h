@@ -55,6 +55,25 @@ struct _GstRtpVRawDepay
 
   gint pgroup;
   gint xinc, yinc;
+
+  /* pixel groups received per line (in units of yinc lines) of the current
+   * frame, and a bitmap of which ones, received_stride bytes per line */
+  guint16 *line_fill;
+  guint8 *received;
+  guint received_stride;
+  guint line_pgroups;
+  guint n_lines;
+  guint lines_complete;
+
+  /* RTP timestamp of the last pushed frame, late packets of it are dropped */
+  guint32 pushed_timestamp;
+  gboolean have_pushed;
+
+  /* last pushed frame, kept for concealment */
+  GstBuffer *prev_buffer;
+
+  /* properties */
+  gboolean conceal;
 };
 
 struct _GstRtpVRawDepayClass
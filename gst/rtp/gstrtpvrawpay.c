@@ -31,10 +31,12 @@
 
 enum
 {
-  PROP_CHUNKS_PER_FRAME = 1
+  PROP_CHUNKS_PER_FRAME = 1,
+  PROP_ZERO_COPY
 };
 
 #define DEFAULT_CHUNKS_PER_FRAME 10
+#define DEFAULT_ZERO_COPY FALSE
 
 GST_DEBUG_CATEGORY_STATIC (rtpvrawpay_debug);
 #define GST_CAT_DEFAULT (rtpvrawpay_debug)
@@ -107,6 +109,24 @@ G_DEFINE_TYPE (GstRtpVRawPay, gst_rtp_vraw_pay, GST_TYPE_RTP_BASE_PAYLOAD)
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS)
       );
 
+  /**
+   * GstRtpVRawPay:zero-copy:
+   *
+   * Make the packets reference the memory of the input frame instead of
+   * copying the pixels into them. Only the packet headers are allocated,
+   * each line segment is added as a sub-range of the frame memory, merging
+   * segments that are contiguous in memory. This is only possible for the
+   * samplings where the pixel groups are laid out like in the frame (RGB,
+   * RGBA, BGR, BGRA, UYVY and UYVP), the other formats are still packed.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_ZERO_COPY,
+      g_param_spec_boolean ("zero-copy", "Zero Copy",
+          "Reference the frame memory in the packets instead of copying "
+          "the pixels when possible", DEFAULT_ZERO_COPY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   gstrtpbasepayload_class->set_caps = gst_rtp_vraw_pay_setcaps;
   gstrtpbasepayload_class->handle_buffer = gst_rtp_vraw_pay_handle_buffer;
 
@@ -128,6 +148,7 @@ static void
 gst_rtp_vraw_pay_init (GstRtpVRawPay * rtpvrawpay)
 {
   rtpvrawpay->chunks_per_frame = DEFAULT_CHUNKS_PER_FRAME;
+  rtpvrawpay->zero_copy = DEFAULT_ZERO_COPY;
 }
 
 static gboolean
@@ -257,6 +278,81 @@ unknown_format:
   }
 }
 
+/* pgroup packing for the formats that are not laid out as in RFC 4175. The
+ * loops only use indexed loads and stores without dependencies between the
+ * iterations so that the compiler can vectorize them. */
+static void
+gst_rtp_vraw_pay_pack_ayuv (guint8 * out, const guint8 * in, guint pgroups)
+{
+  guint i;
+
+  for (i = 0; i < pgroups; i++) {
+    out[3 * i + 0] = in[4 * i + 2];
+    out[3 * i + 1] = in[4 * i + 1];
+    out[3 * i + 2] = in[4 * i + 3];
+  }
+}
+
+static void
+gst_rtp_vraw_pay_pack_i420 (guint8 * out, const guint8 * y1, const guint8 * y2,
+    const guint8 * u, const guint8 * v, guint pgroups)
+{
+  guint i;
+
+  for (i = 0; i < pgroups; i++) {
+    out[6 * i + 0] = y1[2 * i + 0];
+    out[6 * i + 1] = y1[2 * i + 1];
+    out[6 * i + 2] = y2[2 * i + 0];
+    out[6 * i + 3] = y2[2 * i + 1];
+    out[6 * i + 4] = u[i];
+    out[6 * i + 5] = v[i];
+  }
+}
+
+static void
+gst_rtp_vraw_pay_pack_y41b (guint8 * out, const guint8 * y, const guint8 * u,
+    const guint8 * v, guint pgroups)
+{
+  guint i;
+
+  for (i = 0; i < pgroups; i++) {
+    out[6 * i + 0] = u[i];
+    out[6 * i + 1] = y[4 * i + 0];
+    out[6 * i + 2] = y[4 * i + 1];
+    out[6 * i + 3] = v[i];
+    out[6 * i + 4] = y[4 * i + 2];
+    out[6 * i + 5] = y[4 * i + 3];
+  }
+}
+
+/* a range of the input buffer that is added to a packet in zero-copy mode */
+typedef struct
+{
+  gsize offset;
+  gsize size;
+} GstRtpVRawRange;
+
+static void
+gst_rtp_vraw_pay_add_range (GArray * ranges, gsize offset, gsize size)
+{
+  GstRtpVRawRange *last;
+
+  if (ranges->len > 0) {
+    last = &g_array_index (ranges, GstRtpVRawRange, ranges->len - 1);
+    /* the end of a line continues with the start of the next one when the
+     * lines are not padded, merge them */
+    if (last->offset + last->size == offset) {
+      last->size += size;
+      return;
+    }
+  }
+
+  g_array_set_size (ranges, ranges->len + 1);
+  last = &g_array_index (ranges, GstRtpVRawRange, ranges->len - 1);
+  last->offset = offset;
+  last->size = size;
+}
+
 static GstFlowReturn
 gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
 {
@@ -270,6 +366,7 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
   guint line, offset;
   guint8 *p0, *yp, *up, *vp;
   guint ystride, uvstride;
+  gsize p0_offset;
   guint xinc, yinc;
   guint pgroup;
   guint mtu;
@@ -279,6 +376,8 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
   GstVideoFrame frame;
   gint interlaced;
   gboolean use_buffer_lists;
+  gboolean zero_copy;
+  GArray *ranges = NULL;
   GstBufferList *list = NULL;
   GstRTPBuffer rtp = { NULL, };
 
@@ -301,6 +400,9 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
   ystride = GST_VIDEO_FRAME_COMP_STRIDE (&frame, 0);
   uvstride = GST_VIDEO_FRAME_COMP_STRIDE (&frame, 1);
 
+  /* offset of the first plane in the buffer, for referencing the memory */
+  p0_offset = GST_VIDEO_INFO_PLANE_OFFSET (&frame.info, 0);
+
   mtu = GST_RTP_BASE_PAYLOAD_MTU (payload);
 
   /* amount of bytes for one pixel */
@@ -312,6 +414,23 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
 
   format = GST_VIDEO_INFO_FORMAT (&rtpvrawpay->vinfo);
 
+  switch (format) {
+    case GST_VIDEO_FORMAT_RGB:
+    case GST_VIDEO_FORMAT_RGBA:
+    case GST_VIDEO_FORMAT_BGR:
+    case GST_VIDEO_FORMAT_BGRA:
+    case GST_VIDEO_FORMAT_UYVY:
+    case GST_VIDEO_FORMAT_UYVP:
+      zero_copy = rtpvrawpay->zero_copy;
+      break;
+    default:
+      zero_copy = FALSE;
+      break;
+  }
+
+  if (zero_copy)
+    ranges = g_array_new (FALSE, FALSE, sizeof (GstRtpVRawRange));
+
   yinc = rtpvrawpay->yinc;
   xinc = rtpvrawpay->xinc;
 
@@ -342,13 +461,21 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
     while (line < height) {
       guint left, pack_line;
       GstBuffer *out;
-      guint8 *outdata, *headers;
+      guint8 *outdata, *headers, *payload_data;
+      guint payload_len;
       gboolean next_line, complete = FALSE;
       guint length, cont, pixels;
 
       /* get the max allowed payload length size, we try to fill the complete MTU */
       left = gst_rtp_buffer_calc_payload_len (mtu, 0, 0);
-      out = gst_rtp_buffer_new_allocate (left, 0, 0);
+      if (zero_copy) {
+        /* only the headers go in the allocated memory, every header is
+         * followed by at least one pgroup */
+        out = gst_rtp_buffer_new_allocate (2 + 6 * (left / (6 + pgroup)), 0,
+            0);
+      } else {
+        out = gst_rtp_buffer_new_allocate (left, 0, 0);
+      }
 
       if (field == 0) {
         GST_BUFFER_PTS (out) = GST_BUFFER_PTS (buffer);
@@ -358,7 +485,8 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
       }
 
       gst_rtp_buffer_map (out, GST_MAP_WRITE, &rtp);
-      outdata = gst_rtp_buffer_get_payload (&rtp);
+      outdata = payload_data = gst_rtp_buffer_get_payload (&rtp);
+      payload_len = gst_rtp_buffer_get_payload_len (&rtp);
 
       GST_LOG_OBJECT (rtpvrawpay, "created buffer of size %u for MTU %u", left,
           mtu);
@@ -478,65 +606,41 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
           case GST_VIDEO_FORMAT_UYVY:
           case GST_VIDEO_FORMAT_UYVP:
             offs /= xinc;
-            memcpy (outdata, p0 + (lin * ystride) + (offs * pgroup), length);
-            outdata += length;
+            if (zero_copy) {
+              gst_rtp_vraw_pay_add_range (ranges,
+                  p0_offset + (lin * ystride) + (offs * pgroup), length);
+            } else {
+              memcpy (outdata, p0 + (lin * ystride) + (offs * pgroup), length);
+              outdata += length;
+            }
             break;
           case GST_VIDEO_FORMAT_AYUV:
-          {
-            gint i;
-            guint8 *datap;
-
-            datap = p0 + (lin * ystride) + (offs * 4);
-
-            for (i = 0; i < pixels; i++) {
-              *outdata++ = datap[2];
-              *outdata++ = datap[1];
-              *outdata++ = datap[3];
-              datap += 4;
-            }
+            gst_rtp_vraw_pay_pack_ayuv (outdata,
+                p0 + (lin * ystride) + (offs * 4), pixels);
+            outdata += length;
             break;
-          }
           case GST_VIDEO_FORMAT_I420:
           {
-            gint i;
             guint uvoff;
-            guint8 *yd1p, *yd2p, *udp, *vdp;
+            guint8 *yd1p;
 
             yd1p = yp + (lin * ystride) + (offs);
-            yd2p = yd1p + ystride;
             uvoff = (lin / yinc * uvstride) + (offs / xinc);
-            udp = up + uvoff;
-            vdp = vp + uvoff;
-
-            for (i = 0; i < pixels; i++) {
-              *outdata++ = *yd1p++;
-              *outdata++ = *yd1p++;
-              *outdata++ = *yd2p++;
-              *outdata++ = *yd2p++;
-              *outdata++ = *udp++;
-              *outdata++ = *vdp++;
-            }
+
+            gst_rtp_vraw_pay_pack_i420 (outdata, yd1p, yd1p + ystride,
+                up + uvoff, vp + uvoff, pixels);
+            outdata += length;
             break;
           }
           case GST_VIDEO_FORMAT_Y41B:
           {
-            gint i;
             guint uvoff;
-            guint8 *ydp, *udp, *vdp;
 
-            ydp = yp + (lin * ystride) + offs;
             uvoff = (lin / yinc * uvstride) + (offs / xinc);
-            udp = up + uvoff;
-            vdp = vp + uvoff;
-
-            for (i = 0; i < pixels; i++) {
-              *outdata++ = *udp++;
-              *outdata++ = *ydp++;
-              *outdata++ = *ydp++;
-              *outdata++ = *vdp++;
-              *outdata++ = *ydp++;
-              *outdata++ = *ydp++;
-            }
+
+            gst_rtp_vraw_pay_pack_y41b (outdata, yp + (lin * ystride) + offs,
+                up + uvoff, vp + uvoff, pixels);
+            outdata += length;
             break;
           }
           default:
@@ -555,11 +659,30 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
         complete = TRUE;
       }
       gst_rtp_buffer_unmap (&rtp);
+
+      /* trim what we did not write, in zero-copy mode that is the unused
+       * space for headers */
+      left = payload_len - (outdata - payload_data);
       if (left > 0) {
         GST_LOG_OBJECT (rtpvrawpay, "we have %u bytes left", left);
         gst_buffer_resize (out, 0, gst_buffer_get_size (out) - left);
       }
 
+      if (zero_copy) {
+        guint i;
+
+        for (i = 0; i < ranges->len; i++) {
+          GstRtpVRawRange *range;
+
+          range = &g_array_index (ranges, GstRtpVRawRange, i);
+          gst_buffer_copy_into (out, buffer, GST_BUFFER_COPY_MEMORY,
+              range->offset, range->size);
+        }
+        GST_LOG_OBJECT (rtpvrawpay, "referenced %u ranges of the frame",
+            ranges->len);
+        g_array_set_size (ranges, 0);
+      }
+
       gst_rtp_copy_video_meta (rtpvrawpay, out, buffer);
 
       /* Now either push out the buffer directly */
@@ -586,6 +709,8 @@ gst_rtp_vraw_pay_handle_buffer (GstRTPBasePayload * payload, GstBuffer * buffer)
 
   }
 
+  if (ranges)
+    g_array_free (ranges, TRUE);
   gst_video_frame_unmap (&frame);
   gst_buffer_unref (buffer);
 
@@ -596,6 +721,8 @@ unknown_sampling:
   {
     GST_ELEMENT_ERROR (payload, STREAM, FORMAT,
         (NULL), ("unimplemented sampling"));
+    if (ranges)
+      g_array_free (ranges, TRUE);
     gst_video_frame_unmap (&frame);
     gst_buffer_unref (buffer);
     return GST_FLOW_NOT_SUPPORTED;
@@ -604,6 +731,8 @@ too_small:
   {
     GST_ELEMENT_ERROR (payload, RESOURCE, NO_SPACE_LEFT,
         (NULL), ("not enough space to send at least one pixel"));
+    if (ranges)
+      g_array_free (ranges, TRUE);
     gst_video_frame_unmap (&frame);
     gst_buffer_unref (buffer);
     return GST_FLOW_NOT_SUPPORTED;
@@ -622,6 +751,9 @@ gst_rtp_vraw_pay_set_property (GObject * object, guint prop_id,
     case PROP_CHUNKS_PER_FRAME:
       rtpvrawpay->chunks_per_frame = g_value_get_int (value);
       break;
+    case PROP_ZERO_COPY:
+      rtpvrawpay->zero_copy = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -640,6 +772,9 @@ gst_rtp_vraw_pay_get_property (GObject * object, guint prop_id,
     case PROP_CHUNKS_PER_FRAME:
       g_value_set_int (value, rtpvrawpay->chunks_per_frame);
       break;
+    case PROP_ZERO_COPY:
+      g_value_set_boolean (value, rtpvrawpay->zero_copy);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
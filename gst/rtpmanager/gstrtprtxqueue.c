@@ -23,11 +23,15 @@
 /**
  * SECTION:element-rtprtxqueue
  *
- * rtprtxqueue maintains a queue of transmitted RTP packets, up to a
- * configurable limit (see #GstRTPRtxQueue::max-size-time,
+ * rtprtxqueue maintains a queue of transmitted RTP packets for each SSRC, up
+ * to a configurable limit (see #GstRTPRtxQueue::max-size-time,
  * #GstRTPRtxQueue::max-size-packets), and retransmits them upon request
  * from the downstream rtpsession (GstRTPRetransmissionRequest event).
  *
+ * The queue of an SSRC holds at most the packets of the last 32768 seqnums,
+ * even when it is unlimited. Larger values of
+ * #GstRTPRtxQueue::max-size-packets are clamped to that.
+ *
  * This element is similar to rtprtxsend, but it has differences:
  * - Retransmission from rtprtxqueue is not RFC 4588 compliant. The
  * retransmitted packets have the same ssrc and payload type as the original
@@ -71,6 +75,7 @@
 #include <string.h>
 
 #include "gstrtprtxqueue.h"
+#include "rtphistory.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_rtp_rtx_queue_debug);
 #define GST_CAT_DEFAULT gst_rtp_rtx_queue_debug
@@ -139,8 +144,8 @@ gst_rtp_rtx_queue_class_init (GstRTPRtxQueueClass * klass)
 
   g_object_class_install_property (gobject_class, PROP_MAX_SIZE_PACKETS,
       g_param_spec_uint ("max-size-packets", "Max Size Packets",
-          "Amount of packets to queue (0 = unlimited)", 0, G_MAXUINT,
-          DEFAULT_MAX_SIZE_PACKETS,
+          "Amount of packets to queue per SSRC (0 = unlimited, at most 32768)",
+          0, G_MAXUINT, DEFAULT_MAX_SIZE_PACKETS,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   g_object_class_install_property (gobject_class, PROP_REQUESTS,
@@ -169,8 +174,7 @@ static void
 gst_rtp_rtx_queue_reset (GstRTPRtxQueue * rtx, gboolean full)
 {
   g_mutex_lock (&rtx->lock);
-  g_queue_foreach (rtx->queue, (GFunc) gst_buffer_unref, NULL);
-  g_queue_clear (rtx->queue);
+  g_hash_table_remove_all (rtx->histories);
   g_list_foreach (rtx->pending, (GFunc) gst_buffer_unref, NULL);
   g_list_free (rtx->pending);
   rtx->pending = NULL;
@@ -185,12 +189,19 @@ gst_rtp_rtx_queue_finalize (GObject * object)
   GstRTPRtxQueue *rtx = GST_RTP_RTX_QUEUE (object);
 
   gst_rtp_rtx_queue_reset (rtx, TRUE);
-  g_queue_free (rtx->queue);
+  g_hash_table_destroy (rtx->histories);
   g_mutex_clear (&rtx->lock);
 
   G_OBJECT_CLASS (gst_rtp_rtx_queue_parent_class)->finalize (object);
 }
 
+static void
+history_free (RTPHistory * history)
+{
+  rtp_history_clear (history);
+  g_slice_free (RTPHistory, history);
+}
+
 static void
 gst_rtp_rtx_queue_init (GstRTPRtxQueue * rtx)
 {
@@ -218,42 +229,35 @@ gst_rtp_rtx_queue_init (GstRTPRtxQueue * rtx)
       GST_DEBUG_FUNCPTR (gst_rtp_rtx_queue_chain_list));
   gst_element_add_pad (GST_ELEMENT (rtx), rtx->sinkpad);
 
-  rtx->queue = g_queue_new ();
+  rtx->histories = g_hash_table_new_full (NULL, NULL, NULL,
+      (GDestroyNotify) history_free);
   g_mutex_init (&rtx->lock);
 
   rtx->max_size_time = DEFAULT_MAX_SIZE_TIME;
   rtx->max_size_packets = DEFAULT_MAX_SIZE_PACKETS;
 }
 
-typedef struct
-{
-  GstRTPRtxQueue *rtx;
-  guint seqnum;
-  gboolean found;
-} RTXData;
-
-static void
-push_seqnum (GstBuffer * buffer, RTXData * data)
+/* Must be called with rtx->lock */
+static GstBuffer *
+lookup_seqnum (GstRTPRtxQueue * rtx, guint ssrc, guint seqnum)
 {
-  GstRTPRtxQueue *rtx = data->rtx;
-  GstRTPBuffer rtpbuffer = GST_RTP_BUFFER_INIT;
-  guint16 seqnum;
+  RTPHistory *history;
+  GHashTableIter iter;
 
-  if (data->found)
-    return;
-
-  if (!GST_IS_BUFFER (buffer) ||
-      !gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtpbuffer))
-    return;
+  if (ssrc != -1) {
+    history = g_hash_table_lookup (rtx->histories, GUINT_TO_POINTER (ssrc));
+    return history ? rtp_history_lookup (history, seqnum) : NULL;
+  }
 
-  seqnum = gst_rtp_buffer_get_seq (&rtpbuffer);
-  gst_rtp_buffer_unmap (&rtpbuffer);
+  /* no ssrc in the request, try all streams */
+  g_hash_table_iter_init (&iter, rtx->histories);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) & history)) {
+    GstBuffer *buffer = rtp_history_lookup (history, seqnum);
 
-  if (seqnum == data->seqnum) {
-    data->found = TRUE;
-    GST_DEBUG_OBJECT (rtx, "found %d", seqnum);
-    rtx->pending = g_list_prepend (rtx->pending, gst_buffer_ref (buffer));
+    if (buffer)
+      return buffer;
   }
+  return NULL;
 }
 
 static gboolean
@@ -269,20 +273,23 @@ gst_rtp_rtx_queue_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
 
       s = gst_event_get_structure (event);
       if (gst_structure_has_name (s, "GstRTPRetransmissionRequest")) {
-        guint seqnum;
-        RTXData data;
+        guint seqnum, ssrc;
+        GstBuffer *buffer;
 
         if (!gst_structure_get_uint (s, "seqnum", &seqnum))
           seqnum = -1;
+        if (!gst_structure_get_uint (s, "ssrc", &ssrc))
+          ssrc = -1;
 
         GST_DEBUG_OBJECT (rtx, "request %d", seqnum);
 
         g_mutex_lock (&rtx->lock);
-        data.rtx = rtx;
-        data.seqnum = seqnum;
-        data.found = FALSE;
         rtx->n_requests += 1;
-        g_queue_foreach (rtx->queue, (GFunc) push_seqnum, &data);
+        if (seqnum <= G_MAXUINT16 &&
+            (buffer = lookup_seqnum (rtx, ssrc, seqnum))) {
+          GST_DEBUG_OBJECT (rtx, "found %d", seqnum);
+          rtx->pending = g_list_prepend (rtx->pending, gst_buffer_ref (buffer));
+        }
         g_mutex_unlock (&rtx->lock);
 
         gst_event_unref (event);
@@ -311,7 +318,6 @@ gst_rtp_rtx_queue_sink_event (GstPad * pad, GstObject * parent,
     {
       g_mutex_lock (&rtx->lock);
       gst_event_copy_segment (event, &rtx->head_segment);
-      g_queue_push_head (rtx->queue, gst_event_ref (event));
       g_mutex_unlock (&rtx->lock);
       /* fall through */
     }
@@ -322,40 +328,45 @@ gst_rtp_rtx_queue_sink_event (GstPad * pad, GstObject * parent,
   return res;
 }
 
+/* push the fulfilled requests in one go */
 static void
-do_push (GstBuffer * buffer, GstRTPRtxQueue * rtx)
+push_pending (GstRTPRtxQueue * rtx, GList * pending)
 {
-  rtx->n_fulfilled_requests += 1;
-  gst_pad_push (rtx->srcpad, buffer);
+  GstBufferList *list;
+  GList *walk;
+
+  if (pending == NULL)
+    return;
+
+  list = gst_buffer_list_new_sized (g_list_length (pending));
+  /* the requests were prepended, push them in the order they came in */
+  for (walk = g_list_last (pending); walk; walk = walk->prev)
+    gst_buffer_list_add (list, walk->data);
+  g_list_free (pending);
+
+  rtx->n_fulfilled_requests += gst_buffer_list_length (list);
+  gst_pad_push_list (rtx->srcpad, list);
 }
 
 static guint32
-get_ts_diff (GstRTPRtxQueue * rtx)
+get_ts_diff (RTPHistory * history)
 {
-  GstClockTime high_ts, low_ts;
+  RTPHistoryItem *high_buf, *low_buf;
   GstClockTimeDiff result;
-  GstBuffer *high_buf, *low_buf;
 
-  high_buf = g_queue_peek_head (rtx->queue);
-
-  while (GST_IS_EVENT ((low_buf = g_queue_peek_tail (rtx->queue)))) {
-    GstEvent *event = g_queue_pop_tail (rtx->queue);
-    gst_event_copy_segment (event, &rtx->tail_segment);
-    gst_event_unref (event);
-  }
+  high_buf = rtp_history_peek_newest (history);
+  low_buf = rtp_history_peek_oldest (history);
 
   if (!high_buf || !low_buf || high_buf == low_buf)
     return 0;
 
-  high_ts = GST_BUFFER_TIMESTAMP (high_buf);
-  low_ts = GST_BUFFER_TIMESTAMP (low_buf);
-
-  high_ts = gst_segment_to_running_time (&rtx->head_segment, GST_FORMAT_TIME,
-      high_ts);
-  low_ts = gst_segment_to_running_time (&rtx->tail_segment, GST_FORMAT_TIME,
-      low_ts);
+  if (!GST_CLOCK_TIME_IS_VALID (high_buf->time) ||
+      !GST_CLOCK_TIME_IS_VALID (low_buf->time))
+    return 0;
 
-  result = high_ts - low_ts;
+  result = high_buf->time - low_buf->time;
+  if (result < 0)
+    return 0;
 
   /* return value in ms instead of ns */
   return (guint32) gst_util_uint64_scale_int (result, 1, GST_MSECOND);
@@ -363,15 +374,40 @@ get_ts_diff (GstRTPRtxQueue * rtx)
 
 /* Must be called with rtx->lock */
 static void
-shrink_queue (GstRTPRtxQueue * rtx)
+store_buffer (GstRTPRtxQueue * rtx, GstBuffer * buffer)
 {
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstClockTime running_time = GST_CLOCK_TIME_NONE;
+  RTPHistory *history;
+  guint16 seqnum;
+  guint32 ssrc;
+
+  if (!gst_rtp_buffer_map (buffer, GST_MAP_READ, &rtp))
+    return;
+  seqnum = gst_rtp_buffer_get_seq (&rtp);
+  ssrc = gst_rtp_buffer_get_ssrc (&rtp);
+  gst_rtp_buffer_unmap (&rtp);
+
+  history = g_hash_table_lookup (rtx->histories, GUINT_TO_POINTER (ssrc));
+  if (history == NULL) {
+    history = g_slice_new (RTPHistory);
+    rtp_history_init (history);
+    g_hash_table_insert (rtx->histories, GUINT_TO_POINTER (ssrc), history);
+  }
+
+  if (rtx->head_segment.format == GST_FORMAT_TIME)
+    running_time = gst_segment_to_running_time (&rtx->head_segment,
+        GST_FORMAT_TIME, GST_BUFFER_TIMESTAMP (buffer));
+
+  rtp_history_insert (history, seqnum, running_time, buffer);
+
   if (rtx->max_size_packets) {
-    while (g_queue_get_length (rtx->queue) > rtx->max_size_packets)
-      gst_buffer_unref (g_queue_pop_tail (rtx->queue));
+    while (rtp_history_get_length (history) > rtx->max_size_packets)
+      rtp_history_pop_oldest (history);
   }
   if (rtx->max_size_time) {
-    while (get_ts_diff (rtx) > rtx->max_size_time)
-      gst_buffer_unref (g_queue_pop_tail (rtx->queue));
+    while (get_ts_diff (history) > rtx->max_size_time)
+      rtp_history_pop_oldest (history);
   }
 }
 
@@ -385,16 +421,13 @@ gst_rtp_rtx_queue_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
   rtx = GST_RTP_RTX_QUEUE (parent);
 
   g_mutex_lock (&rtx->lock);
-  g_queue_push_head (rtx->queue, gst_buffer_ref (buffer));
-  shrink_queue (rtx);
+  store_buffer (rtx, buffer);
 
   pending = rtx->pending;
   rtx->pending = NULL;
   g_mutex_unlock (&rtx->lock);
 
-  pending = g_list_reverse (pending);
-  g_list_foreach (pending, (GFunc) do_push, rtx);
-  g_list_free (pending);
+  push_pending (rtx, pending);
 
   ret = gst_pad_push (rtx->srcpad, buffer);
 
@@ -404,9 +437,7 @@ gst_rtp_rtx_queue_chain (GstPad * pad, GstObject * parent, GstBuffer * buffer)
 static gboolean
 push_to_queue (GstBuffer ** buffer, guint idx, gpointer user_data)
 {
-  GQueue *queue = user_data;
-
-  g_queue_push_head (queue, gst_buffer_ref (*buffer));
+  store_buffer (user_data, *buffer);
 
   return TRUE;
 }
@@ -422,16 +453,13 @@ gst_rtp_rtx_queue_chain_list (GstPad * pad, GstObject * parent,
   rtx = GST_RTP_RTX_QUEUE (parent);
 
   g_mutex_lock (&rtx->lock);
-  gst_buffer_list_foreach (list, push_to_queue, rtx->queue);
-  shrink_queue (rtx);
+  gst_buffer_list_foreach (list, push_to_queue, rtx);
 
   pending = rtx->pending;
   rtx->pending = NULL;
   g_mutex_unlock (&rtx->lock);
 
-  pending = g_list_reverse (pending);
-  g_list_foreach (pending, (GFunc) do_push, rtx);
-  g_list_free (pending);
+  push_pending (rtx, pending);
 
   ret = gst_pad_push_list (rtx->srcpad, list);
 
@@ -474,7 +502,9 @@ gst_rtp_rtx_queue_set_property (GObject * object,
       rtx->max_size_time = g_value_get_uint (value);
       break;
     case PROP_MAX_SIZE_PACKETS:
-      rtx->max_size_packets = g_value_get_uint (value);
+      /* the history can't hold more anyway */
+      rtx->max_size_packets =
+          MIN (g_value_get_uint (value), RTP_HISTORY_MAX_SPAN);
       break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
@@ -53,14 +53,14 @@ struct _GstRTPRtxQueue
   GstPad *srcpad;
 
   GMutex lock;
-  GQueue *queue;
+  /* ssrc -> RTPHistory, the time of the items is the running time */
+  GHashTable *histories;
   GList *pending;
 
   guint max_size_time;
   guint max_size_packets;
 
   GstSegment head_segment;
-  GstSegment tail_segment;
 
   /* Statistics */
   guint n_requests;
@@ -26,13 +26,16 @@
  *
  * See #GstRtpRtxReceive for examples
  * 
- * The purpose of the sender RTX object is to keep a history of RTP packets up
- * to a configurable limit (max-size-time or max-size-packets). It will listen
- * for upstream custom retransmission events (GstRTPRetransmissionRequest) that
- * comes from downstream (#GstRtpSession). When receiving a request it will
- * look up the requested seqnum in its list of stored packets. If the packet
- * is available, it will create a RTX packet according to RFC 4588 and send
- * this as an auxiliary stream. RTX is SSRC-multiplexed
+ * The purpose of the sender RTX object is to keep a history of RTP packets of
+ * each SSRC up to a configurable limit (max-size-time or max-size-packets),
+ * which applies to every SSRC separately. Even without a limit, the history
+ * of an SSRC holds at most the packets of the last 32768 seqnums. It will
+ * listen for upstream custom retransmission events
+ * (GstRTPRetransmissionRequest) that comes from downstream (#GstRtpSession).
+ * When receiving a request it will look up the requested seqnum in its list
+ * of stored packets. If the packet is available, it will create a RTX packet
+ * according to RFC 4588 and send this as an auxiliary stream. RTX is
+ * SSRC-multiplexed
  */
 
 #ifdef HAVE_CONFIG_H
@@ -45,6 +48,7 @@
 #include <stdlib.h>
 
 #include "gstrtprtxsend.h"
+#include "rtphistory.h"
 
 GST_DEBUG_CATEGORY_STATIC (gst_rtp_rtx_send_debug);
 #define GST_CAT_DEFAULT gst_rtp_rtx_send_debug
@@ -103,28 +107,14 @@ static void gst_rtp_rtx_send_finalize (GObject * object);
 
 G_DEFINE_TYPE (GstRtpRtxSend, gst_rtp_rtx_send, GST_TYPE_ELEMENT);
 
-typedef struct
-{
-  guint16 seqnum;
-  guint32 timestamp;
-  GstBuffer *buffer;
-} BufferQueueItem;
-
-static void
-buffer_queue_item_free (BufferQueueItem * item)
-{
-  gst_buffer_unref (item->buffer);
-  g_slice_free (BufferQueueItem, item);
-}
-
 typedef struct
 {
   guint32 rtx_ssrc;
   guint16 seqnum_base, next_seqnum;
   gint clock_rate;
 
-  /* history of rtp packets */
-  GSequence *queue;
+  /* history of rtp packets, the time of the items is the rtptime */
+  RTPHistory history;
 } SSRCRtxData;
 
 static SSRCRtxData *
@@ -134,7 +124,7 @@ ssrc_rtx_data_new (guint32 rtx_ssrc)
 
   data->rtx_ssrc = rtx_ssrc;
   data->next_seqnum = data->seqnum_base = g_random_int_range (0, G_MAXUINT16);
-  data->queue = g_sequence_new ((GDestroyNotify) buffer_queue_item_free);
+  rtp_history_init (&data->history);
 
   return data;
 }
@@ -142,7 +132,7 @@ ssrc_rtx_data_new (guint32 rtx_ssrc)
 static void
 ssrc_rtx_data_free (SSRCRtxData * data)
 {
-  g_sequence_free (data->queue);
+  rtp_history_clear (&data->history);
   g_slice_free (SSRCRtxData, data);
 }
 
@@ -177,8 +167,8 @@ gst_rtp_rtx_send_class_init (GstRtpRtxSendClass * klass)
 
   g_object_class_install_property (gobject_class, PROP_MAX_SIZE_PACKETS,
       g_param_spec_uint ("max-size-packets", "Max Size Packets",
-          "Amount of packets to queue (0 = unlimited)", 0, G_MAXINT16,
-          DEFAULT_MAX_SIZE_PACKETS,
+          "Amount of packets to queue per SSRC (0 = unlimited, at most 32768)",
+          0, G_MAXINT16, DEFAULT_MAX_SIZE_PACKETS,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   g_object_class_install_property (gobject_class, PROP_NUM_RTX_REQUESTS,
@@ -433,16 +423,6 @@ gst_rtp_rtx_buffer_new (GstRtpRtxSend * rtx, GstBuffer * buffer)
   return new_buffer;
 }
 
-static gint
-buffer_queue_items_cmp (BufferQueueItem * a, BufferQueueItem * b,
-    gpointer user_data)
-{
-  /* gst_rtp_buffer_compare_seqnum returns the opposite of what we want,
-   * it returns negative when seqnum1 > seqnum2 and we want negative
-   * when b > a, i.e. a is smaller, so it comes first in the sequence */
-  return gst_rtp_buffer_compare_seqnum (b->seqnum, a->seqnum);
-}
-
 static gboolean
 gst_rtp_rtx_send_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
 {
@@ -476,21 +456,18 @@ gst_rtp_rtx_send_src_event (GstPad * pad, GstObject * parent, GstEvent * event)
         /* check if request is for us */
         if (g_hash_table_contains (rtx->ssrc_data, GUINT_TO_POINTER (ssrc))) {
           SSRCRtxData *data;
-          GSequenceIter *iter;
-          BufferQueueItem search_item;
+          GstBuffer *buffer;
 
           /* update statistics */
           ++rtx->num_rtx_requests;
 
           data = gst_rtp_rtx_send_get_ssrc_data (rtx, ssrc);
 
-          search_item.seqnum = seqnum;
-          iter = g_sequence_lookup (data->queue, &search_item,
-              (GCompareDataFunc) buffer_queue_items_cmp, NULL);
-          if (iter) {
-            BufferQueueItem *item = g_sequence_get (iter);
-            GST_DEBUG_OBJECT (rtx, "found %" G_GUINT16_FORMAT, item->seqnum);
-            rtx_buf = gst_rtp_rtx_buffer_new (rtx, item->buffer);
+          buffer = rtp_history_lookup (&data->history, seqnum);
+          if (buffer) {
+            GST_DEBUG_OBJECT (rtx, "found %" G_GUINT16_FORMAT,
+                (guint16) seqnum);
+            rtx_buf = gst_rtp_rtx_buffer_new (rtx, buffer);
           }
         }
         GST_OBJECT_UNLOCK (rtx);
@@ -650,19 +627,17 @@ static guint32
 gst_rtp_rtx_send_get_ts_diff (SSRCRtxData * data)
 {
   guint64 high_ts, low_ts;
-  BufferQueueItem *high_buf, *low_buf;
+  RTPHistoryItem *high_buf, *low_buf;
   guint32 result;
 
-  high_buf =
-      g_sequence_get (g_sequence_iter_prev (g_sequence_get_end_iter
-          (data->queue)));
-  low_buf = g_sequence_get (g_sequence_get_begin_iter (data->queue));
+  high_buf = rtp_history_peek_newest (&data->history);
+  low_buf = rtp_history_peek_oldest (&data->history);
 
   if (!high_buf || !low_buf || high_buf == low_buf)
     return 0;
 
-  high_ts = high_buf->timestamp;
-  low_ts = low_buf->timestamp;
+  high_ts = high_buf->time;
+  low_ts = low_buf->time;
 
   /* it needs to work if ts wraps */
   if (high_ts >= low_ts) {
@@ -680,7 +655,6 @@ static void
 process_buffer (GstRtpRtxSend * rtx, GstBuffer * buffer)
 {
   GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
-  BufferQueueItem *item;
   SSRCRtxData *data;
   guint16 seqnum;
   guint8 payload_type;
@@ -703,20 +677,18 @@ process_buffer (GstRtpRtxSend * rtx, GstBuffer * buffer)
     data = gst_rtp_rtx_send_get_ssrc_data (rtx, ssrc);
 
     /* add current rtp buffer to queue history */
-    item = g_slice_new0 (BufferQueueItem);
-    item->seqnum = seqnum;
-    item->timestamp = rtptime;
-    item->buffer = gst_buffer_ref (buffer);
-    g_sequence_append (data->queue, item);
+    if (!rtp_history_insert (&data->history, seqnum, rtptime, buffer))
+      GST_DEBUG_OBJECT (rtx, "not storing old packet %" G_GUINT16_FORMAT,
+          seqnum);
 
     /* remove oldest packets from history if they are too many */
     if (rtx->max_size_packets) {
-      while (g_sequence_get_length (data->queue) > rtx->max_size_packets)
-        g_sequence_remove (g_sequence_get_begin_iter (data->queue));
+      while (rtp_history_get_length (&data->history) > rtx->max_size_packets)
+        rtp_history_pop_oldest (&data->history);
     }
     if (rtx->max_size_time) {
       while (gst_rtp_rtx_send_get_ts_diff (data) > rtx->max_size_time)
-        g_sequence_remove (g_sequence_get_begin_iter (data->queue));
+        rtp_history_pop_oldest (&data->history);
     }
   }
 }
@@ -758,6 +730,41 @@ gst_rtp_rtx_send_chain_list (GstPad * pad, GstObject * parent,
   return ret;
 }
 
+/* push the given retransmission together with all the others that are
+ * queued right behind it */
+static void
+gst_rtp_rtx_send_push_rtx_buffers (GstRtpRtxSend * rtx, GstBuffer * buffer)
+{
+  GstBufferList *list = NULL;
+  GstDataQueueItem *data;
+
+  while (!gst_data_queue_is_empty (rtx->queue) &&
+      gst_data_queue_peek (rtx->queue, &data) &&
+      GST_IS_BUFFER (data->object) && gst_data_queue_pop (rtx->queue, &data)) {
+    if (list == NULL) {
+      list = gst_buffer_list_new ();
+      gst_buffer_list_add (list, buffer);
+    }
+    gst_buffer_list_add (list, GST_BUFFER (data->object));
+
+    data->object = NULL;        /* we no longer own that object */
+    data->destroy (data);
+  }
+
+  GST_OBJECT_LOCK (rtx);
+  /* Update statistics just before pushing. */
+  rtx->num_rtx_packets += list ? gst_buffer_list_length (list) : 1;
+  GST_OBJECT_UNLOCK (rtx);
+
+  if (list) {
+    GST_LOG_OBJECT (rtx, "pushing list of %u rtx buffers",
+        gst_buffer_list_length (list));
+    gst_pad_push_list (rtx->srcpad, list);
+  } else {
+    gst_pad_push (rtx->srcpad, buffer);
+  }
+}
+
 static void
 gst_rtp_rtx_send_src_loop (GstRtpRtxSend * rtx)
 {
@@ -767,12 +774,13 @@ gst_rtp_rtx_send_src_loop (GstRtpRtxSend * rtx)
     GST_LOG_OBJECT (rtx, "pushing rtx buffer %p", data->object);
 
     if (G_LIKELY (GST_IS_BUFFER (data->object))) {
-      GST_OBJECT_LOCK (rtx);
-      /* Update statistics just before pushing. */
-      rtx->num_rtx_packets++;
-      GST_OBJECT_UNLOCK (rtx);
+      GstBuffer *buffer = GST_BUFFER (data->object);
+
+      data->object = NULL;      /* we no longer own that object */
+      data->destroy (data);
 
-      gst_pad_push (rtx->srcpad, GST_BUFFER (data->object));
+      gst_rtp_rtx_send_push_rtx_buffers (rtx, buffer);
+      return;
     } else if (GST_IS_EVENT (data->object)) {
       gst_pad_push_event (rtx->srcpad, GST_EVENT (data->object));
 
@@ -306,6 +306,8 @@ static GstClockTime gst_rtp_session_request_time (RTPSession * session,
 static void gst_rtp_session_notify_nack (RTPSession * sess,
     guint16 seqnum, guint16 blp, guint32 ssrc, gpointer user_data);
 static void gst_rtp_session_reconfigure (RTPSession * sess, gpointer user_data);
+static GstFlowReturn gst_rtp_session_send_rtcp_list (RTPSession * sess,
+    GstBufferList * list, gboolean eos, gpointer user_data);
 
 static RTPSessionCallbacks callbacks = {
   gst_rtp_session_process_rtp,
@@ -317,7 +319,8 @@ static RTPSessionCallbacks callbacks = {
   gst_rtp_session_request_key_unit,
   gst_rtp_session_request_time,
   gst_rtp_session_notify_nack,
-  gst_rtp_session_reconfigure
+  gst_rtp_session_reconfigure,
+  gst_rtp_session_send_rtcp_list
 };
 
 /* GObject vmethods */
@@ -1412,19 +1415,15 @@ do_rtcp_events (GstRtpSession * rtpsession, GstPad * srcpad)
   gst_pad_push_event (srcpad, event);
 }
 
-/* called when the session manager has an RTCP packet ready for further
- * sending. The eos flag is set when an EOS event should be sent downstream as
- * well. */
+/* push @buffer or @list on the RTCP source pad. The eos flag is set when an
+ * EOS event should be sent downstream as well. */
 static GstFlowReturn
-gst_rtp_session_send_rtcp (RTPSession * sess, RTPSource * src,
-    GstBuffer * buffer, gboolean eos, gpointer user_data)
+gst_rtp_session_push_rtcp (GstRtpSession * rtpsession, GstBuffer * buffer,
+    GstBufferList * list, gboolean eos)
 {
   GstFlowReturn result;
-  GstRtpSession *rtpsession;
   GstPad *rtcp_src;
 
-  rtpsession = GST_RTP_SESSION (user_data);
-
   GST_RTP_SESSION_LOCK (rtpsession);
   if (rtpsession->priv->stop_thread)
     goto stopping;
@@ -1437,8 +1436,14 @@ gst_rtp_session_send_rtcp (RTPSession * sess, RTPSource * src,
     if (!gst_pad_has_current_caps (rtcp_src))
       do_rtcp_events (rtpsession, rtcp_src);
 
-    GST_LOG_OBJECT (rtpsession, "sending RTCP");
-    result = gst_pad_push (rtcp_src, buffer);
+    if (list) {
+      GST_LOG_OBJECT (rtpsession, "sending %u RTCP packets",
+          gst_buffer_list_length (list));
+      result = gst_pad_push_list (rtcp_src, list);
+    } else {
+      GST_LOG_OBJECT (rtpsession, "sending RTCP");
+      result = gst_pad_push (rtcp_src, buffer);
+    }
 
     /* we have to send EOS after this packet */
     if (eos) {
@@ -1450,7 +1455,10 @@ gst_rtp_session_send_rtcp (RTPSession * sess, RTPSource * src,
     GST_RTP_SESSION_UNLOCK (rtpsession);
 
     GST_DEBUG_OBJECT (rtpsession, "not sending RTCP, no output pad");
-    gst_buffer_unref (buffer);
+    if (list)
+      gst_buffer_list_unref (list);
+    else
+      gst_buffer_unref (buffer);
     result = GST_FLOW_OK;
   }
   return result;
@@ -1459,12 +1467,35 @@ gst_rtp_session_send_rtcp (RTPSession * sess, RTPSource * src,
 stopping:
   {
     GST_DEBUG_OBJECT (rtpsession, "we are stopping");
-    gst_buffer_unref (buffer);
+    if (list)
+      gst_buffer_list_unref (list);
+    else
+      gst_buffer_unref (buffer);
     GST_RTP_SESSION_UNLOCK (rtpsession);
     return GST_FLOW_OK;
   }
 }
 
+/* called when the session manager has an RTCP packet ready for further
+ * sending. */
+static GstFlowReturn
+gst_rtp_session_send_rtcp (RTPSession * sess, RTPSource * src,
+    GstBuffer * buffer, gboolean eos, gpointer user_data)
+{
+  return gst_rtp_session_push_rtcp (GST_RTP_SESSION (user_data), buffer, NULL,
+      eos);
+}
+
+/* called when the session manager has the RTCP packets of all internal
+ * sources ready for further sending. */
+static GstFlowReturn
+gst_rtp_session_send_rtcp_list (RTPSession * sess, GstBufferList * list,
+    gboolean eos, gpointer user_data)
+{
+  return gst_rtp_session_push_rtcp (GST_RTP_SESSION (user_data), NULL, list,
+      eos);
+}
+
 /* called when the session manager has an SR RTCP packet ready for handling
  * inter stream synchronisation */
 static GstFlowReturn
@@ -0,0 +1,236 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <string.h>
+
+#include "rtphistory.h"
+
+#define MIN_SIZE 64
+#define MAX_SPAN RTP_HISTORY_MAX_SPAN
+
+#define SLOT(h,seqnum) (&(h)->items[(seqnum) & ((h)->size - 1)])
+
+/**
+ * rtp_history_init:
+ * @history: an #RTPHistory
+ *
+ * Initialize an empty @history. No memory is allocated until the first
+ * packet is inserted.
+ */
+void
+rtp_history_init (RTPHistory * history)
+{
+  memset (history, 0, sizeof (RTPHistory));
+}
+
+/**
+ * rtp_history_clear:
+ * @history: an #RTPHistory
+ *
+ * Remove all packets from @history and free its memory.
+ */
+void
+rtp_history_clear (RTPHistory * history)
+{
+  while (history->length > 0)
+    rtp_history_pop_oldest (history);
+
+  g_free (history->items);
+  rtp_history_init (history);
+}
+
+static void
+rtp_history_resize (RTPHistory * history, guint size)
+{
+  RTPHistoryItem *items;
+  guint i;
+
+  items = g_new0 (RTPHistoryItem, size);
+
+  for (i = 0; i < history->span; i++) {
+    guint16 seqnum = history->first + i;
+    RTPHistoryItem *item = SLOT (history, seqnum);
+
+    if (item->buffer)
+      items[seqnum & (size - 1)] = *item;
+  }
+
+  g_free (history->items);
+  history->items = items;
+  history->size = size;
+}
+
+/**
+ * rtp_history_insert:
+ * @history: an #RTPHistory
+ * @seqnum: the seqnum of @buffer
+ * @time: a timestamp for @buffer
+ * @buffer: a #GstBuffer
+ *
+ * Store a new reference to @buffer in @history. A packet with the same
+ * seqnum is replaced. Packets after the newest one in @history are always
+ * stored. To make room for them, the oldest packets are removed when the
+ * window would exceed #RTP_HISTORY_MAX_SPAN seqnums, or when the ring would
+ * become mostly empty.
+ *
+ * Returns: %FALSE when @buffer was not stored because it is older than the
+ * oldest packet in @history.
+ */
+gboolean
+rtp_history_insert (RTPHistory * history, guint16 seqnum, guint64 time,
+    GstBuffer * buffer)
+{
+  RTPHistoryItem *item;
+  guint offset;
+
+  if (history->length > 0) {
+    guint16 newest = history->first + history->span - 1;
+
+    /* new and old packets are told apart relative to the newest one, as the
+     * oldest one may be up to MAX_SPAN behind it */
+    if ((gint16) (seqnum - newest) <= 0) {
+      offset = (guint16) (seqnum - history->first);
+      if (offset >= history->span)
+        return FALSE;
+    } else {
+      offset = history->span - 1 + (guint16) (seqnum - newest);
+      while (history->length > 0 && offset >= MAX_SPAN) {
+        rtp_history_pop_oldest (history);
+        offset = (guint16) (seqnum - history->first);
+      }
+    }
+
+    if (history->length > 0 && offset >= history->span) {
+      /* grow while the ring would stay at least half full, drop the oldest
+       * packets otherwise */
+      while (offset >= history->size && history->size < MAX_SPAN &&
+          history->size < 2 * (history->length + 1))
+        rtp_history_resize (history, history->size * 2);
+
+      while (history->length > 0 && offset >= history->size) {
+        rtp_history_pop_oldest (history);
+        offset = (guint16) (seqnum - history->first);
+      }
+    }
+  }
+
+  if (history->length == 0) {
+    if (history->items == NULL)
+      rtp_history_resize (history, MIN_SIZE);
+    history->first = seqnum;
+    history->span = 0;
+    offset = 0;
+  }
+
+  if (offset >= history->span)
+    history->span = offset + 1;
+
+  item = SLOT (history, seqnum);
+  if (item->buffer)
+    gst_buffer_unref (item->buffer);
+  else
+    history->length++;
+
+  item->seqnum = seqnum;
+  item->time = time;
+  item->buffer = gst_buffer_ref (buffer);
+
+  return TRUE;
+}
+
+/**
+ * rtp_history_lookup:
+ * @history: an #RTPHistory
+ * @seqnum: a seqnum
+ *
+ * Find the packet with @seqnum in @history.
+ *
+ * Returns: (transfer none): the packet or %NULL when it is not in @history.
+ */
+GstBuffer *
+rtp_history_lookup (RTPHistory * history, guint16 seqnum)
+{
+  RTPHistoryItem *item;
+
+  if ((guint16) (seqnum - history->first) >= history->span)
+    return NULL;
+
+  item = SLOT (history, seqnum);
+  if (item->buffer == NULL || item->seqnum != seqnum)
+    return NULL;
+
+  return item->buffer;
+}
+
+/**
+ * rtp_history_peek_oldest:
+ * @history: an #RTPHistory
+ *
+ * Returns: (transfer none): the packet with the lowest seqnum or %NULL when
+ * @history is empty.
+ */
+RTPHistoryItem *
+rtp_history_peek_oldest (RTPHistory * history)
+{
+  if (history->length == 0)
+    return NULL;
+
+  return SLOT (history, history->first);
+}
+
+/**
+ * rtp_history_peek_newest:
+ * @history: an #RTPHistory
+ *
+ * Returns: (transfer none): the packet with the highest seqnum or %NULL when
+ * @history is empty.
+ */
+RTPHistoryItem *
+rtp_history_peek_newest (RTPHistory * history)
+{
+  if (history->length == 0)
+    return NULL;
+
+  return SLOT (history, (guint16) (history->first + history->span - 1));
+}
+
+/**
+ * rtp_history_pop_oldest:
+ * @history: an #RTPHistory
+ *
+ * Remove the packet with the lowest seqnum from @history.
+ */
+void
+rtp_history_pop_oldest (RTPHistory * history)
+{
+  RTPHistoryItem *item;
+
+  if (history->length == 0)
+    return;
+
+  item = SLOT (history, history->first);
+  gst_buffer_replace (&item->buffer, NULL);
+  history->length--;
+
+  /* skip over the seqnums we have no packet for, so that the oldest slot is
+   * always filled */
+  do {
+    history->first++;
+    history->span--;
+  } while (history->span > 0 && SLOT (history, history->first)->buffer == NULL);
+}
@@ -0,0 +1,79 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __RTP_HISTORY_H__
+#define __RTP_HISTORY_H__
+
+#include <gst/gst.h>
+
+/**
+ * RTP_HISTORY_MAX_SPAN:
+ *
+ * The most seqnums an #RTPHistory covers, and so the most packets it holds.
+ * Older packets are removed when a newer one would not fit anymore. The
+ * window has to stay within half the seqnum space to be able to tell old
+ * packets from new ones.
+ */
+#define RTP_HISTORY_MAX_SPAN 32768
+
+/**
+ * RTPHistoryItem:
+ * @seqnum: the RTP seqnum of @buffer
+ * @time: a timestamp of the packet, the meaning is up to the user
+ * @buffer: the packet, %NULL for an empty slot
+ *
+ * A packet in an #RTPHistory.
+ */
+typedef struct {
+  guint16 seqnum;
+  guint64 time;
+  GstBuffer *buffer;
+} RTPHistoryItem;
+
+/**
+ * RTPHistory:
+ *
+ * A history of the packets of one RTP stream, stored in a ring that is
+ * indexed by seqnum. Inserting, looking up and removing the oldest packet
+ * are O(1). The ring grows while the history grows, up to
+ * #RTP_HISTORY_MAX_SPAN packets, and then keeps its size.
+ */
+typedef struct {
+  RTPHistoryItem *items;
+  guint size;
+  /* seqnum of the oldest slot, the window goes up to first + span - 1 */
+  guint16 first;
+  guint span;
+  guint length;
+} RTPHistory;
+
+void              rtp_history_init         (RTPHistory *history);
+void              rtp_history_clear        (RTPHistory *history);
+
+gboolean          rtp_history_insert       (RTPHistory *history, guint16 seqnum,
+                                            guint64 time, GstBuffer *buffer);
+GstBuffer *       rtp_history_lookup       (RTPHistory *history,
+                                            guint16 seqnum);
+
+RTPHistoryItem *  rtp_history_peek_oldest  (RTPHistory *history);
+RTPHistoryItem *  rtp_history_peek_newest  (RTPHistory *history);
+void              rtp_history_pop_oldest   (RTPHistory *history);
+
+#define rtp_history_get_length(h) ((h)->length)
+
+#endif /* __RTP_HISTORY_H__ */
@@ -1115,6 +1115,10 @@ rtp_session_set_callbacks (RTPSession * sess, RTPSessionCallbacks * callbacks,
     sess->callbacks.reconfigure = callbacks->reconfigure;
     sess->reconfigure_user_data = user_data;
   }
+  if (callbacks->send_rtcp_list) {
+    sess->callbacks.send_rtcp_list = callbacks->send_rtcp_list;
+    sess->send_rtcp_user_data = user_data;
+  }
 }
 
 /**
@@ -3290,6 +3294,7 @@ typedef struct
   gboolean may_suppress;
   GQueue output;
   guint nacked_seqnums;
+  GPtrArray *report_sources;
 } ReportData;
 
 static void
@@ -3334,33 +3339,24 @@ session_start_rtcp (RTPSession * sess, ReportData * data)
   }
 }
 
-/* construct a Sender or Receiver Report */
-static void
-session_report_blocks (const gchar * key, RTPSource * source, ReportData * data)
+/* construct a Sender or Receiver Report. Returns %FALSE when no more report
+ * blocks fit in the packet */
+static gboolean
+session_report_blocks (RTPSource * source, ReportData * data)
 {
   RTPSession *sess = data->sess;
   GstRTCPPacket *packet = &data->packet;
-  guint8 fractionlost;
-  gint32 packetslost;
-  guint32 exthighestseq, jitter;
-  guint32 lsr, dlsr;
-
-  /* don't report for sources in future generations */
-  if (((gint16) (source->generation - sess->generation)) > 0) {
-    GST_DEBUG ("source %08x generation %u > %u", source->ssrc,
-        source->generation, sess->generation);
-    return;
-  }
+  RTPReceiverReport *rr = &source->last_rr;
 
   if (g_hash_table_contains (source->reported_in_sr_of,
           GUINT_TO_POINTER (data->source->ssrc))) {
     GST_DEBUG ("source %08x already reported in this generation", source->ssrc);
-    return;
+    return TRUE;
   }
 
   if (gst_rtcp_packet_get_rb_count (packet) == GST_RTCP_MAX_RB_COUNT) {
     GST_DEBUG ("max RB count reached");
-    return;
+    return FALSE;
   }
 
   /* only report about other sender */
@@ -3372,28 +3368,59 @@ session_report_blocks (const gchar * key, RTPSource * source, ReportData * data)
     goto reported;
   }
 
-  GST_DEBUG ("create RB for SSRC %08x", source->ssrc);
+  /* the stats are taken once per report round and shared by the reports of
+   * all internal sources, taking them again would reset the interval used
+   * for the fraction lost */
+  if (!rr->is_valid || source->last_rr_round != sess->report_round) {
+    guint8 fractionlost;
+    gint32 packetslost;
+    guint32 exthighestseq, jitter;
+    guint32 lsr, dlsr;
 
-  /* get new stats */
-  rtp_source_get_new_rb (source, data->current_time, &fractionlost,
-      &packetslost, &exthighestseq, &jitter, &lsr, &dlsr);
+    GST_DEBUG ("create RB for SSRC %08x", source->ssrc);
 
-  /* store last generated RR packet */
-  source->last_rr.is_valid = TRUE;
-  source->last_rr.fractionlost = fractionlost;
-  source->last_rr.packetslost = packetslost;
-  source->last_rr.exthighestseq = exthighestseq;
-  source->last_rr.jitter = jitter;
-  source->last_rr.lsr = lsr;
-  source->last_rr.dlsr = dlsr;
+    /* get new stats */
+    rtp_source_get_new_rb (source, data->current_time, &fractionlost,
+        &packetslost, &exthighestseq, &jitter, &lsr, &dlsr);
+
+    /* store last generated RR packet */
+    rr->is_valid = TRUE;
+    rr->fractionlost = fractionlost;
+    rr->packetslost = packetslost;
+    rr->exthighestseq = exthighestseq;
+    rr->jitter = jitter;
+    rr->lsr = lsr;
+    rr->dlsr = dlsr;
+    source->last_rr_round = sess->report_round;
+  }
 
   /* packet is not yet filled, add report block for this source. */
-  gst_rtcp_packet_add_rb (packet, source->ssrc, fractionlost, packetslost,
-      exthighestseq, jitter, lsr, dlsr);
+  gst_rtcp_packet_add_rb (packet, source->ssrc, rr->fractionlost,
+      rr->packetslost, rr->exthighestseq, rr->jitter, rr->lsr, rr->dlsr);
 
 reported:
   g_hash_table_add (source->reported_in_sr_of,
       GUINT_TO_POINTER (data->source->ssrc));
+
+  return TRUE;
+}
+
+/* collect the sources to report about in this round, in the order of the
+ * hash table */
+static void
+collect_report_sources (const gchar * key, RTPSource * source,
+    ReportData * data)
+{
+  RTPSession *sess = data->sess;
+
+  /* don't report for sources in future generations */
+  if (((gint16) (source->generation - sess->generation)) > 0) {
+    GST_DEBUG ("source %08x generation %u > %u", source->ssrc,
+        source->generation, sess->generation);
+    return;
+  }
+
+  g_ptr_array_add (data->report_sources, g_object_ref (source));
 }
 
 /* construct FIR */
@@ -3899,10 +3926,15 @@ generate_rtcp (const gchar * key, RTPSource * source, ReportData * data)
     make_source_bye (sess, source, data);
     is_bye = TRUE;
   } else if (!data->is_early) {
-    /* loop over all known sources and add report blocks. If we are early, we
-     * just make a minimal RTCP packet and skip this step */
-    g_hash_table_foreach (sess->ssrcs[sess->mask_idx],
-        (GHFunc) session_report_blocks, data);
+    guint i;
+
+    /* loop over the sources of this round and add report blocks. If we are
+     * early, we just make a minimal RTCP packet and skip this step */
+    for (i = 0; i < data->report_sources->len; i++) {
+      if (!session_report_blocks (g_ptr_array_index (data->report_sources, i),
+              data))
+        break;
+    }
   }
   if (!data->has_sdes && (!data->is_early || !sess->reduced_size_rtcp))
     session_sdes (sess, data);
@@ -3964,7 +3996,8 @@ update_generation (const gchar * key, RTPSource * source, ReportData * data)
  * packet or generate RTCP packets with current session stats.
  *
  * This function can call the #RTPSessionSendRTCP callback, possibly multiple
- * times, for each packet that should be processed.
+ * times, for each packet that should be processed, or the
+ * #RTPSessionSendRTCPList callback once with all the packets.
  *
  * Returns: a #GstFlowReturn.
  */
@@ -3977,6 +4010,9 @@ rtp_session_on_timeout (RTPSession * sess, GstClockTime current_time,
   GHashTable *table_copy;
   ReportOutput *output;
   gboolean all_empty = FALSE;
+  GstBufferList *list = NULL;
+  GQueue sent = G_QUEUE_INIT;
+  gboolean eos = FALSE;
 
   g_return_val_if_fail (RTP_IS_SESSION (sess), GST_FLOW_ERROR);
 
@@ -4047,10 +4083,21 @@ rtp_session_on_timeout (RTPSession * sess, GstClockTime current_time,
       ("doing RTCP generation %u for %u sources, early %d, may suppress %d",
       sess->generation, data.num_to_report, data.is_early, data.may_suppress);
 
+  /* the sources to report about are the same for all internal sources, take
+   * them from the hash table once */
+  sess->report_round++;
+  data.report_sources = g_ptr_array_new_with_free_func (g_object_unref);
+  if (!data.is_early)
+    g_hash_table_foreach (sess->ssrcs[sess->mask_idx],
+        (GHFunc) collect_report_sources, &data);
+
   /* generate RTCP for all internal sources */
   g_hash_table_foreach (sess->ssrcs[sess->mask_idx],
       (GHFunc) generate_rtcp, &data);
 
+  g_ptr_array_free (data.report_sources, TRUE);
+  data.report_sources = NULL;
+
   /* update the generation for all the sources that have been reported */
   g_hash_table_foreach (sess->ssrcs[sess->mask_idx],
       (GHFunc) update_generation, &data);
@@ -4081,6 +4128,10 @@ done:
   /* notify about updated statistics */
   g_object_notify (G_OBJECT (sess), "stats");
 
+  /* collect the packets of all internal sources and send them at once */
+  if (sess->callbacks.send_rtcp_list)
+    list = gst_buffer_list_new ();
+
   /* push out the RTCP packets */
   while ((output = g_queue_pop_head (&data.output))) {
     gboolean do_not_suppress, empty_buffer;
@@ -4096,7 +4147,7 @@ done:
     if (!empty_buffer)
       all_empty = FALSE;
 
-    if (sess->callbacks.send_rtcp &&
+    if ((sess->callbacks.send_rtcp || list) &&
         !empty_buffer && (do_not_suppress || !data.may_suppress)) {
       guint packet_size;
 
@@ -4105,14 +4156,22 @@ done:
       UPDATE_AVG (sess->stats.avg_rtcp_packet_size, packet_size);
       GST_DEBUG ("%p, sending RTCP packet, avg size %u, %u", &sess->stats,
           sess->stats.avg_rtcp_packet_size, packet_size);
-      result =
-          sess->callbacks.send_rtcp (sess, source, buffer, output->is_bye,
-          sess->send_rtcp_user_data);
 
-      RTP_SESSION_LOCK (sess);
-      sess->stats.nacks_sent += data.nacked_seqnums;
-      on_sender_ssrc_active (sess, source);
-      RTP_SESSION_UNLOCK (sess);
+      if (list) {
+        /* sent with the packets of the other sources below */
+        gst_buffer_list_add (list, buffer);
+        eos |= output->is_bye;
+        g_queue_push_tail (&sent, g_object_ref (source));
+      } else {
+        result =
+            sess->callbacks.send_rtcp (sess, source, buffer, output->is_bye,
+            sess->send_rtcp_user_data);
+
+        RTP_SESSION_LOCK (sess);
+        sess->stats.nacks_sent += data.nacked_seqnums;
+        on_sender_ssrc_active (sess, source);
+        RTP_SESSION_UNLOCK (sess);
+      }
     } else {
       GST_DEBUG ("freeing packet callback: %p"
           " empty_buffer: %d, "
@@ -4129,6 +4188,27 @@ done:
     g_slice_free (ReportOutput, output);
   }
 
+  if (list) {
+    if (gst_buffer_list_length (list) > 0) {
+      RTPSource *source;
+
+      GST_DEBUG ("sending %u RTCP packets", gst_buffer_list_length (list));
+      result =
+          sess->callbacks.send_rtcp_list (sess, list, eos,
+          sess->send_rtcp_user_data);
+
+      RTP_SESSION_LOCK (sess);
+      while ((source = g_queue_pop_head (&sent))) {
+        sess->stats.nacks_sent += data.nacked_seqnums;
+        on_sender_ssrc_active (sess, source);
+        g_object_unref (source);
+      }
+      RTP_SESSION_UNLOCK (sess);
+    } else {
+      gst_buffer_list_unref (list);
+    }
+  }
+
   if (all_empty)
     GST_ERROR ("generated empty RTCP messages for all the sources");
 
@@ -4308,7 +4388,7 @@ rtp_session_send_rtcp (RTPSession * sess, GstClockTime max_delay)
 {
   GstClockTime now;
 
-  if (!sess->callbacks.send_rtcp)
+  if (!sess->callbacks.send_rtcp && !sess->callbacks.send_rtcp_list)
     return FALSE;
 
   now = sess->callbacks.request_time (sess, sess->request_time_user_data);
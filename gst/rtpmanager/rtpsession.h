@@ -82,6 +82,22 @@ typedef GstFlowReturn (*RTPSessionSendRTP) (RTPSession *sess, RTPSource *src, gp
 typedef GstFlowReturn (*RTPSessionSendRTCP) (RTPSession *sess, RTPSource *src, GstBuffer *buffer,
     gboolean eos, gpointer user_data);
 
+/**
+ * RTPSessionSendRTCPList:
+ * @sess: an #RTPSession
+ * @list: the RTCP buffers ready for sending
+ * @eos: if an EOS event should be pushed
+ * @user_data: user data specified when registering
+ *
+ * This callback will be called when @sess has the RTCP buffers of all its
+ * internal sources ready for sending to all listening participants in this
+ * session. When set, it is used instead of #RTPSessionSendRTCP.
+ *
+ * Returns: a #GstFlowReturn.
+ */
+typedef GstFlowReturn (*RTPSessionSendRTCPList) (RTPSession *sess, GstBufferList *list,
+    gboolean eos, gpointer user_data);
+
 /**
  * RTPSessionSyncRTCP:
  * @sess: an #RTPSession
@@ -177,6 +193,7 @@ typedef void (*RTPSessionReconfigure) (RTPSession *sess, gpointer user_data);
  * @RTPSessionRequestTime: callback for requesting the current time
  * @RTPSessionNotifyNACK: callback for notifying NACK
  * @RTPSessionReconfigure: callback for requesting reconfiguration
+ * @RTPSessionSendRTCPList: callback for sending lists of RTCP packets
  *
  * These callbacks can be installed on the session manager to get notification
  * when RTP and RTCP packets are ready for further processing. These callbacks
@@ -193,6 +210,7 @@ typedef struct {
   RTPSessionRequestTime request_time;
   RTPSessionNotifyNACK  notify_nack;
   RTPSessionReconfigure reconfigure;
+  RTPSessionSendRTCPList send_rtcp_list;
 } RTPSessionCallbacks;
 
 /**
@@ -246,6 +264,7 @@ struct _RTPSession {
   guint         total_sources;
 
   guint16       generation;
+  guint         report_round;
   GstClockTime  next_rtcp_check_time; /* tn */
   GstClockTime  last_rtcp_check_time; /* tp */
   GstClockTime  last_rtcp_send_time;  /* t_rr_last */
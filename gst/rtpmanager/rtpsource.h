@@ -185,6 +185,7 @@ struct _RTPSource {
 
   RTPSourceStats stats;
   RTPReceiverReport last_rr;
+  guint             last_rr_round;
 
   GList         *conflicting_addresses;
 
@@ -0,0 +1,357 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * A process wide pool of threads that receive the packets of many UDP
+ * sockets. Each thread runs a main loop that polls all the sockets that were
+ * given to it, so that the number of threads does not grow with the number of
+ * streams like it does with one udpsrc per socket.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "gstrtspreceiver.h"
+
+GST_DEBUG_CATEGORY_STATIC (rtspreceiver_debug);
+#define GST_CAT_DEFAULT (rtspreceiver_debug)
+
+/* the first part of a packet is received in a buffer of this size, the rest
+ * in the overflow area of the thread */
+#define PACKET_SIZE 1500
+#define OVERFLOW_SIZE (65536 - PACKET_SIZE)
+/* packets read from a socket per wakeup, to handle bursts with fewer polls */
+#define MAX_PACKETS_PER_WAKEUP 32
+
+typedef struct
+{
+  guint id;
+  GThread *thread;
+  GMainContext *context;
+  GMainLoop *loop;
+  /* held while calling the callbacks, see gst_rtsp_receiver_remove() */
+  GRecMutex lock;
+  guint n_sources;
+  guint8 *overflow;
+} GstRTSPReceiverWorker;
+
+struct _GstRTSPReceiver
+{
+  gint refcount;
+  GPtrArray *workers;
+};
+
+struct _GstRTSPReceiverSource
+{
+  GSource *source;
+  GstRTSPReceiverWorker *worker;
+  GSocket *socket;
+  GstRTSPReceiverFunc func;
+  gpointer user_data;
+};
+
+static GMutex receiver_lock;
+static GstRTSPReceiver *default_receiver;
+
+static gpointer
+gst_rtsp_receiver_worker_run (GstRTSPReceiverWorker * worker)
+{
+  GST_DEBUG ("receiver thread %u running", worker->id);
+
+  g_main_context_push_thread_default (worker->context);
+  g_main_loop_run (worker->loop);
+  g_main_context_pop_thread_default (worker->context);
+
+  GST_DEBUG ("receiver thread %u stopped", worker->id);
+
+  return NULL;
+}
+
+static GstRTSPReceiverWorker *
+gst_rtsp_receiver_worker_new (guint id)
+{
+  GstRTSPReceiverWorker *worker;
+  gchar *name;
+
+  worker = g_slice_new0 (GstRTSPReceiverWorker);
+  worker->id = id;
+  worker->context = g_main_context_new ();
+  worker->loop = g_main_loop_new (worker->context, FALSE);
+  g_rec_mutex_init (&worker->lock);
+  worker->overflow = g_malloc (OVERFLOW_SIZE);
+
+  name = g_strdup_printf ("rtsp-recv-%u", id);
+  worker->thread = g_thread_new (name,
+      (GThreadFunc) gst_rtsp_receiver_worker_run, worker);
+  g_free (name);
+
+  return worker;
+}
+
+static gboolean
+gst_rtsp_receiver_worker_quit (GMainLoop * loop)
+{
+  g_main_loop_quit (loop);
+
+  return FALSE;
+}
+
+static void
+gst_rtsp_receiver_worker_free (GstRTSPReceiverWorker * worker)
+{
+  GSource *source;
+
+  g_warn_if_fail (worker->n_sources == 0);
+
+  /* quit from inside the loop, the thread might not be running it yet and
+   * g_main_loop_quit() would be lost then */
+  source = g_idle_source_new ();
+  g_source_set_callback (source, (GSourceFunc) gst_rtsp_receiver_worker_quit,
+      worker->loop, NULL);
+  g_source_attach (source, worker->context);
+  g_source_unref (source);
+
+  g_thread_join (worker->thread);
+
+  g_main_loop_unref (worker->loop);
+  g_main_context_unref (worker->context);
+  g_rec_mutex_clear (&worker->lock);
+  g_free (worker->overflow);
+  g_slice_free (GstRTSPReceiverWorker, worker);
+}
+
+/**
+ * gst_rtsp_receiver_get:
+ * @n_threads: the number of threads to use
+ *
+ * Get a reference to the receiver of the process. The receiver uses at least
+ * @n_threads threads, it grows to the largest number that was asked for.
+ *
+ * Returns: (transfer full): the receiver, unref with
+ * gst_rtsp_receiver_unref().
+ */
+GstRTSPReceiver *
+gst_rtsp_receiver_get (guint n_threads)
+{
+  GstRTSPReceiver *result;
+
+  g_return_val_if_fail (n_threads > 0, NULL);
+
+  g_mutex_lock (&receiver_lock);
+  if (default_receiver == NULL) {
+    if (!rtspreceiver_debug)
+      GST_DEBUG_CATEGORY_INIT (rtspreceiver_debug, "rtspreceiver", 0,
+          "RTSP shared receiver");
+
+    default_receiver = g_slice_new0 (GstRTSPReceiver);
+    default_receiver->workers = g_ptr_array_new ();
+  }
+  default_receiver->refcount++;
+
+  while (default_receiver->workers->len < n_threads)
+    g_ptr_array_add (default_receiver->workers,
+        gst_rtsp_receiver_worker_new (default_receiver->workers->len));
+  result = default_receiver;
+  g_mutex_unlock (&receiver_lock);
+
+  return result;
+}
+
+/**
+ * gst_rtsp_receiver_unref:
+ * @receiver: a #GstRTSPReceiver
+ *
+ * Release a reference to @receiver. The threads are stopped when the last
+ * reference is released, all sources must have been removed by then.
+ */
+void
+gst_rtsp_receiver_unref (GstRTSPReceiver * receiver)
+{
+  GPtrArray *workers = NULL;
+
+  g_mutex_lock (&receiver_lock);
+  if (--receiver->refcount == 0) {
+    workers = receiver->workers;
+    g_slice_free (GstRTSPReceiver, receiver);
+    default_receiver = NULL;
+  }
+  g_mutex_unlock (&receiver_lock);
+
+  if (workers) {
+    g_ptr_array_foreach (workers, (GFunc) gst_rtsp_receiver_worker_free, NULL);
+    g_ptr_array_free (workers, TRUE);
+  }
+}
+
+static GstBuffer *
+gst_rtsp_receiver_receive (GstRTSPReceiverWorker * worker, GSocket * socket)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  GInputVector vec[2];
+  GError *err = NULL;
+  gssize res;
+
+  buf = gst_buffer_new_allocate (NULL, PACKET_SIZE, NULL);
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  vec[0].buffer = map.data;
+  vec[0].size = map.size;
+  vec[1].buffer = worker->overflow;
+  vec[1].size = OVERFLOW_SIZE;
+  res = g_socket_receive_message (socket, NULL, vec, 2, NULL, NULL, NULL, NULL,
+      &err);
+  gst_buffer_unmap (buf, &map);
+
+  if (res < 0) {
+    /* for example an ICMP port unreachable for a packet we sent */
+    GST_DEBUG ("receive error on socket %p: %s", socket, err->message);
+    g_clear_error (&err);
+    gst_buffer_unref (buf);
+    return NULL;
+  }
+
+  if (res > PACKET_SIZE) {
+    gsize extra = res - PACKET_SIZE;
+
+    gst_buffer_append_memory (buf,
+        gst_memory_new_wrapped (0, g_memdup (worker->overflow, extra), extra,
+            0, extra, NULL, NULL));
+  } else {
+    gst_buffer_resize (buf, 0, res);
+  }
+
+  return buf;
+}
+
+static gboolean
+gst_rtsp_receiver_source_dispatch (GSocket * socket, GIOCondition condition,
+    GstRTSPReceiverSource * rs)
+{
+  GstRTSPReceiverWorker *worker = rs->worker;
+  GSource *source = g_main_current_source ();
+  guint i;
+
+  g_rec_mutex_lock (&worker->lock);
+  for (i = 0; i < MAX_PACKETS_PER_WAKEUP; i++) {
+    GstBuffer *buf;
+
+    /* removed while we were waiting for the lock or in the callback */
+    if (g_source_is_destroyed (source))
+      break;
+
+    /* the first read can't block, we were woken up for it */
+    if (i > 0 && !g_socket_condition_check (socket, G_IO_IN))
+      break;
+
+    if (!(buf = gst_rtsp_receiver_receive (worker, socket)))
+      break;
+
+    rs->func (buf, rs->user_data);
+  }
+  g_rec_mutex_unlock (&worker->lock);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+gst_rtsp_receiver_source_free (GstRTSPReceiverSource * rs)
+{
+  g_object_unref (rs->socket);
+  g_slice_free (GstRTSPReceiverSource, rs);
+}
+
+/**
+ * gst_rtsp_receiver_add:
+ * @receiver: a #GstRTSPReceiver
+ * @socket: a UDP #GSocket
+ * @func: the function to call with the packets
+ * @user_data: user data for @func
+ *
+ * Start receiving the packets of @socket on the thread of @receiver that
+ * has the fewest sockets. @func is called from that thread.
+ *
+ * Returns: the source, remove it with gst_rtsp_receiver_remove().
+ */
+GstRTSPReceiverSource *
+gst_rtsp_receiver_add (GstRTSPReceiver * receiver, GSocket * socket,
+    GstRTSPReceiverFunc func, gpointer user_data)
+{
+  GstRTSPReceiverSource *rs;
+  GstRTSPReceiverWorker *worker = NULL;
+  guint i;
+
+  g_mutex_lock (&receiver_lock);
+  for (i = 0; i < receiver->workers->len; i++) {
+    GstRTSPReceiverWorker *w = g_ptr_array_index (receiver->workers, i);
+
+    if (worker == NULL || w->n_sources < worker->n_sources)
+      worker = w;
+  }
+  worker->n_sources++;
+  g_mutex_unlock (&receiver_lock);
+
+  GST_DEBUG ("receiving socket %p on thread %u", socket, worker->id);
+
+  rs = g_slice_new0 (GstRTSPReceiverSource);
+  rs->worker = worker;
+  rs->socket = g_object_ref (socket);
+  rs->func = func;
+  rs->user_data = user_data;
+
+  /* the source is freed with its callback data, which is kept alive while
+   * the callback runs */
+  rs->source = g_socket_create_source (socket, G_IO_IN, NULL);
+  g_source_set_callback (rs->source,
+      (GSourceFunc) gst_rtsp_receiver_source_dispatch, rs,
+      (GDestroyNotify) gst_rtsp_receiver_source_free);
+  g_source_attach (rs->source, worker->context);
+
+  return rs;
+}
+
+/**
+ * gst_rtsp_receiver_remove:
+ * @receiver: a #GstRTSPReceiver
+ * @source: a #GstRTSPReceiverSource
+ *
+ * Stop receiving the packets of @source. When this function returns, the
+ * callback of @source is not running and will not be called again.
+ */
+void
+gst_rtsp_receiver_remove (GstRTSPReceiver * receiver,
+    GstRTSPReceiverSource * source)
+{
+  GstRTSPReceiverWorker *worker = source->worker;
+  GSource *gsource = source->source;
+
+  GST_DEBUG ("stop receiving socket %p", source->socket);
+
+  /* @source can be freed from here on */
+  g_source_destroy (gsource);
+  /* the callback could be running now, wait until it has seen that the
+   * source is destroyed */
+  g_rec_mutex_lock (&worker->lock);
+  g_rec_mutex_unlock (&worker->lock);
+  g_source_unref (gsource);
+
+  g_mutex_lock (&receiver_lock);
+  worker->n_sources--;
+  g_mutex_unlock (&receiver_lock);
+}
@@ -0,0 +1,52 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#ifndef __GST_RTSP_RECEIVER_H__
+#define __GST_RTSP_RECEIVER_H__
+
+#include <gst/gst.h>
+#include <gio/gio.h>
+
+G_BEGIN_DECLS
+
+typedef struct _GstRTSPReceiver GstRTSPReceiver;
+typedef struct _GstRTSPReceiverSource GstRTSPReceiverSource;
+
+/**
+ * GstRTSPReceiverFunc:
+ * @buffer: (transfer full): a received packet
+ * @user_data: user data passed to gst_rtsp_receiver_add()
+ *
+ * Called from one of the receiver threads for each packet received on a
+ * socket. It must not block for long, the thread services other sockets too.
+ */
+typedef void (*GstRTSPReceiverFunc) (GstBuffer *buffer, gpointer user_data);
+
+GstRTSPReceiver *        gst_rtsp_receiver_get     (guint n_threads);
+void                     gst_rtsp_receiver_unref   (GstRTSPReceiver *receiver);
+
+GstRTSPReceiverSource *  gst_rtsp_receiver_add     (GstRTSPReceiver *receiver,
+                                                    GSocket *socket,
+                                                    GstRTSPReceiverFunc func,
+                                                    gpointer user_data);
+void                     gst_rtsp_receiver_remove  (GstRTSPReceiver *receiver,
+                                                    GstRTSPReceiverSource *source);
+
+G_END_DECLS
+
+#endif /* __GST_RTSP_RECEIVER_H__ */
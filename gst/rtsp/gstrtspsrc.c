@@ -228,6 +228,7 @@ gst_rtsp_src_ntp_time_source_get_type (void)
 #define DEFAULT_USER_AGENT       "GStreamer/" PACKAGE_VERSION
 #define DEFAULT_MAX_RTCP_RTP_TIME_DIFF 1000
 #define DEFAULT_RFC7273_SYNC         FALSE
+#define DEFAULT_RECEIVE_THREADS      0
 
 enum
 {
@@ -267,7 +268,8 @@ enum
   PROP_NTP_TIME_SOURCE,
   PROP_USER_AGENT,
   PROP_MAX_RTCP_RTP_TIME_DIFF,
-  PROP_RFC7273_SYNC
+  PROP_RFC7273_SYNC,
+  PROP_RECEIVE_THREADS
 };
 
 #define GST_TYPE_RTSP_NAT_METHOD (gst_rtsp_nat_method_get_type())
@@ -340,6 +342,9 @@ static gboolean gst_rtspsrc_loop (GstRTSPSrc * src);
 static gboolean gst_rtspsrc_stream_push_event (GstRTSPSrc * src,
     GstRTSPStream * stream, GstEvent * event);
 static gboolean gst_rtspsrc_push_event (GstRTSPSrc * src, GstEvent * event);
+static void gst_rtspsrc_stream_set_receiving (GstRTSPSrc * src,
+    GstRTSPStream * stream, gboolean receiving);
+static void gst_rtspsrc_shared_need_events (GstRTSPSrc * src);
 static void gst_rtspsrc_connection_flush (GstRTSPSrc * src, gboolean flush);
 static GstRTSPResult gst_rtsp_conninfo_close (GstRTSPSrc * src,
     GstRTSPConnInfo * info, gboolean free);
@@ -748,6 +753,26 @@ gst_rtspsrc_class_init (GstRTSPSrcClass * klass)
           "(requires clock and offset to be provided)", DEFAULT_RFC7273_SYNC,
           G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstRTSPSrc::receive-threads:
+   *
+   * When not 0, the packets of UDP streams are received by a pool of threads
+   * that is shared by all rtspsrc elements of the process, instead of by two
+   * udpsrc threads for each stream. The pool has as many threads as the
+   * largest value used by any element.
+   *
+   * This is only used with a session manager. The UDP timeout, which is used
+   * to fall back to TCP when no packets arrive, is not available in this
+   * mode.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_RECEIVE_THREADS,
+      g_param_spec_uint ("receive-threads", "Receive Threads",
+          "Number of threads shared by all elements to receive UDP packets "
+          "(0 = a thread for each UDP port)", 0, 64, DEFAULT_RECEIVE_THREADS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstRTSPSrc::handle-request:
    * @rtspsrc: a #GstRTSPSrc
@@ -896,6 +921,7 @@ gst_rtspsrc_init (GstRTSPSrc * src)
   src->user_agent = g_strdup (DEFAULT_USER_AGENT);
   src->max_rtcp_rtp_time_diff = DEFAULT_MAX_RTCP_RTP_TIME_DIFF;
   src->rfc7273_sync = DEFAULT_RFC7273_SYNC;
+  src->receive_threads = DEFAULT_RECEIVE_THREADS;
 
   /* get a list of all extensions */
   src->extensions = gst_rtsp_ext_list_get ();
@@ -1180,6 +1206,9 @@ gst_rtspsrc_set_property (GObject * object, guint prop_id, const GValue * value,
     case PROP_RFC7273_SYNC:
       rtspsrc->rfc7273_sync = g_value_get_boolean (value);
       break;
+    case PROP_RECEIVE_THREADS:
+      rtspsrc->receive_threads = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1329,6 +1358,9 @@ gst_rtspsrc_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_RFC7273_SYNC:
       g_value_set_boolean (value, rtspsrc->rfc7273_sync);
       break;
+    case PROP_RECEIVE_THREADS:
+      g_value_set_uint (value, rtspsrc->receive_threads);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1735,14 +1767,20 @@ gst_rtspsrc_stream_free (GstRTSPSrc * src, GstRTSPStream * stream)
   g_free (stream->control_url);
   g_free (stream->conninfo.location);
 
+  /* before the udp sources close the sockets */
+  gst_rtspsrc_stream_set_receiving (src, stream, FALSE);
+
   for (i = 0; i < 2; i++) {
     if (stream->udpsrc[i]) {
       gst_element_set_state (stream->udpsrc[i], GST_STATE_NULL);
-      gst_bin_remove (GST_BIN_CAST (src), stream->udpsrc[i]);
+      if (!stream->shared_recv)
+        gst_bin_remove (GST_BIN_CAST (src), stream->udpsrc[i]);
       gst_object_unref (stream->udpsrc[i]);
     }
     if (stream->channelpad[i])
       gst_object_unref (stream->channelpad[i]);
+    if (stream->pending[i])
+      gst_buffer_list_unref (stream->pending[i]);
 
     if (stream->udpsink[i]) {
       gst_element_set_state (stream->udpsink[i], GST_STATE_NULL);
@@ -1791,6 +1829,15 @@ gst_rtspsrc_cleanup (GstRTSPSrc * src)
   }
   g_list_free (src->streams);
   src->streams = NULL;
+  if (src->receiver) {
+    gst_rtsp_receiver_unref (src->receiver);
+    src->receiver = NULL;
+  }
+  if (src->chunk) {
+    gst_memory_unref (src->chunk);
+    src->chunk = NULL;
+    src->chunk_data = NULL;
+  }
   if (src->manager) {
     if (src->manager_sig_id) {
       g_signal_handler_disconnect (src->manager, src->manager_sig_id);
@@ -2018,6 +2065,13 @@ gst_rtspsrc_set_state (GstRTSPSrc * src, GstState state)
     GstRTSPStream *stream = (GstRTSPStream *) walk->data;
     gint i;
 
+    /* shared sockets are only received from in PLAYING, like a udpsrc */
+    if (stream->shared_recv) {
+      gst_rtspsrc_stream_set_receiving (src, stream,
+          state == GST_STATE_PLAYING);
+      continue;
+    }
+
     for (i = 0; i < 2; i++) {
       if (stream->udpsrc[i])
         gst_element_set_state (stream->udpsrc[i], state);
@@ -2047,6 +2101,9 @@ gst_rtspsrc_flush (GstRTSPSrc * src, gboolean flush, gboolean playing)
       state = GST_STATE_PAUSED;
   }
   gst_rtspsrc_push_event (src, event);
+  /* the flush removed the segment of the shared receiver pads */
+  if (!flush)
+    gst_rtspsrc_shared_need_events (src);
   gst_rtspsrc_loop_send_cmd (src, cmd, CMD_LOOP);
   gst_rtspsrc_set_state (src, state);
 }
@@ -3243,6 +3300,8 @@ gst_rtspsrc_stream_free_udp (GstRTSPStream * stream)
 {
   gint i;
 
+  gst_rtspsrc_stream_set_receiving (stream->parent, stream, FALSE);
+
   for (i = 0; i < 2; i++) {
     if (stream->udpsrc[i]) {
       GST_DEBUG ("free UDP source %d for stream %p", i, stream);
@@ -3494,11 +3553,196 @@ no_ports:
   }
 }
 
+/* make the shared receiver threads push stream-start, caps and a new segment
+ * before the next packet, like udpsrc does after a flush */
+static void
+gst_rtspsrc_shared_need_events (GstRTSPSrc * src)
+{
+  GList *walk;
+  gint i;
+
+  for (walk = src->streams; walk; walk = g_list_next (walk)) {
+    GstRTSPStream *stream = (GstRTSPStream *) walk->data;
+
+    if (!stream->shared_recv)
+      continue;
+
+    for (i = 0; i < 2; i++)
+      g_atomic_int_set (&stream->recv_need_events[i], TRUE);
+  }
+}
+
+static void
+gst_rtspsrc_shared_push_start_events (GstRTSPSrc * src,
+    GstRTSPStream * stream, gint idx)
+{
+  GstPad *pad = stream->channelpad[idx];
+  GstSegment segment;
+  GstCaps *caps;
+  gchar *stream_id;
+
+  stream_id = gst_pad_create_stream_id_printf (pad, GST_ELEMENT_CAST (src),
+      "%u/%d", stream->id, idx);
+  gst_pad_push_event (pad, gst_event_new_stream_start (stream_id));
+  g_free (stream_id);
+
+  if (idx == 0) {
+    if ((caps = stream_get_caps_for_pt (stream, stream->default_pt)))
+      gst_pad_push_event (pad, gst_event_new_caps (caps));
+  } else {
+    if (stream->profile == GST_RTSP_PROFILE_SAVP ||
+        stream->profile == GST_RTSP_PROFILE_SAVPF)
+      caps = gst_caps_new_empty_simple ("application/x-srtcp");
+    else
+      caps = gst_caps_new_empty_simple ("application/x-rtcp");
+    gst_pad_push_event (pad, gst_event_new_caps (caps));
+    gst_caps_unref (caps);
+  }
+
+  /* live, the buffers are timestamped with the running time */
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (pad, gst_event_new_segment (&segment));
+}
+
+/* called from a thread of the shared receiver with a packet of the RTP
+ * (@idx 0) or RTCP (@idx 1) socket of @stream */
+static void
+gst_rtspsrc_shared_receive (GstRTSPStream * stream, gint idx,
+    GstBuffer * buffer)
+{
+  GstRTSPSrc *src = stream->parent;
+  GstClock *clock;
+  GstClockTime base_time = 0;
+  gboolean activate;
+  GstFlowReturn ret;
+
+  GST_OBJECT_LOCK (src);
+  if ((clock = GST_ELEMENT_CLOCK (src))) {
+    gst_object_ref (clock);
+    base_time = GST_ELEMENT_CAST (src)->base_time;
+  }
+  activate = src->need_activate;
+  src->need_activate = FALSE;
+  GST_OBJECT_UNLOCK (src);
+
+  /* timestamp with the running time, like udpsrc does */
+  if (clock) {
+    GstClockTime now = gst_clock_get_time (clock);
+
+    GST_BUFFER_DTS (buffer) = now > base_time ? now - base_time : 0;
+    gst_object_unref (clock);
+  }
+
+  /* the first packet, like pad_blocked() for the udp sources */
+  if (activate)
+    gst_rtspsrc_activate_streams (src);
+
+  if (g_atomic_int_compare_and_exchange (&stream->recv_need_events[idx],
+          TRUE, FALSE))
+    gst_rtspsrc_shared_push_start_events (src, stream, idx);
+
+  ret = gst_pad_push (stream->channelpad[idx], buffer);
+  if (ret != GST_FLOW_OK)
+    GST_LOG_OBJECT (src, "stream %p channel %d: %s", stream, idx,
+        gst_flow_get_name (ret));
+}
+
+static void
+gst_rtspsrc_shared_receive_rtp (GstBuffer * buffer, gpointer user_data)
+{
+  gst_rtspsrc_shared_receive (user_data, 0, buffer);
+}
+
+static void
+gst_rtspsrc_shared_receive_rtcp (GstBuffer * buffer, gpointer user_data)
+{
+  gst_rtspsrc_shared_receive (user_data, 1, buffer);
+}
+
+/* start or stop receiving the sockets of a stream with the shared receiver */
+static void
+gst_rtspsrc_stream_set_receiving (GstRTSPSrc * src, GstRTSPStream * stream,
+    gboolean receiving)
+{
+  gint i;
+
+  if (!stream->shared_recv)
+    return;
+
+  for (i = 0; i < 2; i++) {
+    if (receiving && !stream->recv_source[i] && stream->udpsrc[i]
+        && stream->channelpad[i]) {
+      GSocket *socket = NULL;
+
+      g_object_get (G_OBJECT (stream->udpsrc[i]), "used-socket", &socket,
+          NULL);
+      if (!socket)
+        continue;
+
+      if (!src->receiver)
+        src->receiver = gst_rtsp_receiver_get (src->receive_threads);
+
+      stream->recv_source[i] = gst_rtsp_receiver_add (src->receiver, socket,
+          i == 0 ? gst_rtspsrc_shared_receive_rtp :
+          gst_rtspsrc_shared_receive_rtcp, stream);
+      g_object_unref (socket);
+    } else if (!receiving && stream->recv_source[i]) {
+      gst_rtsp_receiver_remove (src->receiver, stream->recv_source[i]);
+      stream->recv_source[i] = NULL;
+    }
+  }
+}
+
+/* Receive the packets of the UDP sockets with the shared receiver and push
+ * them into the manager from internal pads, like for TCP. The UDP sources
+ * stay in READY, out of the bin, to keep the sockets open. */
+static gboolean
+gst_rtspsrc_stream_configure_shared_udp (GstRTSPSrc * src,
+    GstRTSPStream * stream)
+{
+  GstPadTemplate *template;
+  gint i;
+
+  GST_DEBUG_OBJECT (src, "receiving stream %p with %u shared threads", stream,
+      src->receive_threads);
+
+  template = gst_static_pad_template_get (&anysrctemplate);
+  for (i = 0; i < 2; i++) {
+    GstPad *pad;
+    gchar *name;
+
+    if (!stream->udpsrc[i] || !stream->channelpad[i])
+      continue;
+
+    name = g_strdup_printf ("internalsrc_%d", i);
+    pad = gst_pad_new_from_template (template, name);
+    g_free (name);
+
+    gst_pad_link_full (pad, stream->channelpad[i], GST_PAD_LINK_CHECK_NOTHING);
+    gst_object_unref (stream->channelpad[i]);
+    stream->channelpad[i] = pad;
+    gst_pad_set_event_function (pad, gst_rtspsrc_handle_internal_src_event);
+    gst_pad_set_query_function (pad, gst_rtspsrc_handle_internal_src_query);
+    gst_pad_set_element_private (pad, src);
+    gst_pad_set_active (pad, TRUE);
+
+    g_atomic_int_set (&stream->recv_need_events[i], TRUE);
+  }
+  gst_object_unref (template);
+
+  stream->shared_recv = TRUE;
+
+  return TRUE;
+}
+
 /* configure the remainder of the UDP ports */
 static gboolean
 gst_rtspsrc_stream_configure_udp (GstRTSPSrc * src, GstRTSPStream * stream,
     GstRTSPTransport * transport, GstPad ** outpad)
 {
+  if (src->receive_threads > 0 && src->manager && stream->udpsrc[0])
+    return gst_rtspsrc_stream_configure_shared_udp (src, stream);
+
   /* we manage the UDP elements now. For unicast, the UDP sources where
    * allocated in the stream when we suggested a transport. */
   if (stream->udpsrc[0]) {
@@ -4037,7 +4281,7 @@ gst_rtspsrc_stream_push_event (GstRTSPSrc * src, GstRTSPStream * stream,
   if (!stream->setup)
     goto done;
 
-  if (stream->udpsrc[0]) {
+  if (stream->udpsrc[0] && !stream->shared_recv) {
     gst_event_ref (event);
     res = gst_element_send_event (stream->udpsrc[0], event);
   } else if (stream->channelpad[0]) {
@@ -4048,7 +4292,7 @@ gst_rtspsrc_stream_push_event (GstRTSPSrc * src, GstRTSPStream * stream,
       res = gst_pad_send_event (stream->channelpad[0], event);
   }
 
-  if (stream->udpsrc[1]) {
+  if (stream->udpsrc[1] && !stream->shared_recv) {
     gst_event_ref (event);
     res &= gst_element_send_event (stream->udpsrc[1], event);
   } else if (stream->channelpad[1]) {
@@ -4377,66 +4621,39 @@ send_error:
   }
 }
 
-static GstFlowReturn
-gst_rtspsrc_handle_data (GstRTSPSrc * src, GstRTSPMessage * message)
+/* get the pad of @stream to push the data of @channel on, %NULL when we have
+ * no clue what it is */
+static GstPad *
+gst_rtspsrc_get_data_pad (GstRTSPStream * stream, gint channel,
+    const guint8 * data, gboolean * is_rtcp)
 {
-  GstFlowReturn ret = GST_FLOW_OK;
-  gint channel;
-  GstRTSPStream *stream;
   GstPad *outpad = NULL;
-  guint8 *data;
-  guint size;
-  GstBuffer *buf;
-  gboolean is_rtcp;
-
-  channel = message->type_data.data.channel;
-
-  stream = find_stream (src, &channel, (gpointer) find_stream_by_channel);
-  if (!stream)
-    goto unknown_stream;
 
   if (channel == stream->channel[0]) {
     outpad = stream->channelpad[0];
-    is_rtcp = FALSE;
+    *is_rtcp = FALSE;
   } else if (channel == stream->channel[1]) {
     outpad = stream->channelpad[1];
-    is_rtcp = TRUE;
+    *is_rtcp = TRUE;
   } else {
-    is_rtcp = FALSE;
+    *is_rtcp = FALSE;
   }
 
-  /* take a look at the body to figure out what we have */
-  gst_rtsp_message_get_body (message, &data, &size);
-  if (size < 2)
-    goto invalid_length;
-
   /* channels are not correct on some servers, do extra check */
   if (data[1] >= 200 && data[1] <= 204) {
     /* hmm RTCP message switch to the RTCP pad of the same stream. */
     outpad = stream->channelpad[1];
-    is_rtcp = TRUE;
+    *is_rtcp = TRUE;
   }
 
-  /* we have no clue what this is, just ignore then. */
-  if (outpad == NULL)
-    goto unknown_stream;
-
-  /* take the message body for further processing */
-  gst_rtsp_message_steal_body (message, &data, &size);
-
-  /* strip the trailing \0 */
-  size -= 1;
-
-  buf = gst_buffer_new ();
-  gst_buffer_append_memory (buf,
-      gst_memory_new_wrapped (0, data, size, 0, size, data, g_free));
-
-  /* don't need message anymore */
-  gst_rtsp_message_unset (message);
-
-  GST_DEBUG_OBJECT (src, "pushing data of size %d on channel %d", size,
-      channel);
+  return outpad;
+}
 
+/* send the events that need to go before @buf and timestamp it */
+static void
+gst_rtspsrc_prepare_data (GstRTSPSrc * src, GstRTSPStream * stream,
+    GstBuffer * buf, gboolean is_rtcp)
+{
   if (src->need_activate) {
     gchar *stream_id;
     GstEvent *event;
@@ -4573,6 +4790,54 @@ gst_rtspsrc_handle_data (GstRTSPSrc * src, GstRTSPMessage * message)
 
     GST_BUFFER_TIMESTAMP (buf) = src->base_time;
   }
+}
+
+static GstFlowReturn
+gst_rtspsrc_handle_data (GstRTSPSrc * src, GstRTSPMessage * message)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+  gint channel;
+  GstRTSPStream *stream;
+  GstPad *outpad = NULL;
+  guint8 *data;
+  guint size;
+  GstBuffer *buf;
+  gboolean is_rtcp;
+
+  channel = message->type_data.data.channel;
+
+  stream = find_stream (src, &channel, (gpointer) find_stream_by_channel);
+  if (!stream)
+    goto unknown_stream;
+
+  /* take a look at the body to figure out what we have */
+  gst_rtsp_message_get_body (message, &data, &size);
+  if (size < 2)
+    goto invalid_length;
+
+  outpad = gst_rtspsrc_get_data_pad (stream, channel, data, &is_rtcp);
+
+  /* we have no clue what this is, just ignore then. */
+  if (outpad == NULL)
+    goto unknown_stream;
+
+  /* take the message body for further processing */
+  gst_rtsp_message_steal_body (message, &data, &size);
+
+  /* strip the trailing \0 */
+  size -= 1;
+
+  buf = gst_buffer_new ();
+  gst_buffer_append_memory (buf,
+      gst_memory_new_wrapped (0, data, size, 0, size, data, g_free));
+
+  /* don't need message anymore */
+  gst_rtsp_message_unset (message);
+
+  GST_DEBUG_OBJECT (src, "pushing data of size %d on channel %d", size,
+      channel);
+
+  gst_rtspsrc_prepare_data (src, stream, buf, is_rtcp);
 
   /* chain to the peer pad */
   if (GST_PAD_IS_SINK (outpad))
@@ -4602,6 +4867,197 @@ invalid_length:
   }
 }
 
+/* interleaved data is read into chunks of this size and pushed as read-only
+ * memories pointing into them. A new chunk is started when the largest data
+ * frame might not fit anymore. */
+#define CHUNK_SIZE      (256 * 1024)
+#define CHUNK_MIN_SPACE (4 + G_MAXUINT16)
+
+/* push the lists of packets collected by gst_rtspsrc_read_data_chunk() */
+static GstFlowReturn
+gst_rtspsrc_push_pending (GstRTSPSrc * src)
+{
+  GstFlowReturn res = GST_FLOW_OK;
+  GList *walk;
+
+  for (walk = src->streams; walk; walk = g_list_next (walk)) {
+    GstRTSPStream *stream = (GstRTSPStream *) walk->data;
+    gint i;
+
+    for (i = 0; i < 2; i++) {
+      GstBufferList *list = stream->pending[i];
+      GstPad *outpad = stream->channelpad[i];
+      GstFlowReturn ret;
+
+      if (list == NULL)
+        continue;
+      stream->pending[i] = NULL;
+
+      GST_LOG_OBJECT (src, "pushing %u packets on channel %d",
+          gst_buffer_list_length (list), stream->channel[i]);
+
+      if (GST_PAD_IS_SINK (outpad))
+        ret = gst_pad_chain_list (outpad, list);
+      else
+        ret = gst_pad_push_list (outpad, list);
+
+      /* combine all stream flows for the data transport */
+      if (i == 0)
+        ret = gst_rtspsrc_combine_flows (src, stream, ret);
+
+      if (res == GST_FLOW_OK)
+        res = ret;
+    }
+  }
+  return res;
+}
+
+/* Read all the data frames that are queued on the connection with one read
+ * and push them as lists per channel. @got_data is set to FALSE when nothing was
+ * read and the next message has to be received with the connection, because
+ * it is not a data frame, it did not arrive completely or the connection
+ * transforms the data (TLS and HTTP tunnels). */
+static GstFlowReturn
+gst_rtspsrc_read_data_chunk (GstRTSPSrc * src, gboolean * got_data)
+{
+  GstRTSPConnection *conn = src->conninfo.connection;
+  GSocket *socket;
+  GInputVector vec;
+  gint flags = G_SOCKET_MSG_PEEK;
+  GError *err = NULL;
+  guint8 *data;
+  gsize start, avail, size, offset;
+  gssize res;
+
+  *got_data = FALSE;
+
+  /* when flushing, let the connection return the interrupt */
+  if (src->conninfo.flushing || gst_rtsp_connection_is_tunneled (conn) ||
+      (src->conninfo.url->transports & GST_RTSP_LOWER_TRANS_TLS))
+    return GST_FLOW_OK;
+
+  /* only read what is queued already, waiting is done by the connection */
+  socket = gst_rtsp_connection_get_read_socket (conn);
+  if (socket == NULL || !g_socket_condition_check (socket, G_IO_IN))
+    return GST_FLOW_OK;
+
+  if (src->chunk && CHUNK_SIZE - src->chunk_offset < CHUNK_MIN_SPACE) {
+    gst_memory_unref (src->chunk);
+    src->chunk = NULL;
+    src->chunk_data = NULL;
+  }
+  if (src->chunk == NULL) {
+    /* we keep writing into the part after the packets, which can't be done
+     * through a mapping once the chunk is shared. So the packets wrap the
+     * data themselves and hold a ref on this memory, which frees it. */
+    src->chunk_data = g_malloc (CHUNK_SIZE);
+    src->chunk = gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY,
+        src->chunk_data, CHUNK_SIZE, 0, CHUNK_SIZE, src->chunk_data, g_free);
+    src->chunk_offset = 0;
+  }
+
+  start = src->chunk_offset;
+  data = src->chunk_data + start;
+
+  /* look at what is queued without taking it. The connection does not read
+   * ahead, so everything after the last message is still on the socket. */
+  vec.buffer = data;
+  vec.size = CHUNK_SIZE - start;
+  res = g_socket_receive_message (socket, NULL, &vec, 1, NULL, NULL, &flags,
+      NULL, &err);
+  if (res <= 0) {
+    /* the connection reports errors and EOF */
+    g_clear_error (&err);
+    return GST_FLOW_OK;
+  }
+  avail = res;
+
+  /* the complete data frames at the start */
+  size = 0;
+  while (size + 4 <= avail && data[size] == '$') {
+    gsize len = GST_READ_UINT16_BE (data + size + 2);
+
+    if (size + 4 + len > avail)
+      break;
+    size += 4 + len;
+  }
+  if (size == 0)
+    return GST_FLOW_OK;
+
+  /* now take them, they are queued so this does not block */
+  for (offset = 0; offset < size; offset += res) {
+    res = g_socket_receive (socket, (gchar *) data + offset, size - offset,
+        NULL, &err);
+    if (res <= 0)
+      goto read_error;
+  }
+  src->chunk_offset += size;
+  *got_data = TRUE;
+
+  GST_LOG_OBJECT (src, "read %" G_GSIZE_FORMAT " bytes of data frames", size);
+
+  for (offset = 0; offset < size;) {
+    gint channel = data[offset + 1];
+    gsize len = GST_READ_UINT16_BE (data + offset + 2);
+    gsize payload = offset + 4;
+    GstRTSPStream *stream;
+    GstPad *outpad;
+    GstBuffer *buf;
+    gboolean is_rtcp;
+
+    offset = payload + len;
+
+    stream = find_stream (src, &channel, (gpointer) find_stream_by_channel);
+    if (!stream) {
+      GST_DEBUG_OBJECT (src, "unknown stream on channel %d, ignored", channel);
+      continue;
+    }
+    if (len < 2) {
+      GST_ELEMENT_WARNING (src, RESOURCE, READ, (NULL),
+          ("Short message received, ignoring."));
+      continue;
+    }
+    outpad = gst_rtspsrc_get_data_pad (stream, channel, data + payload,
+        &is_rtcp);
+    if (outpad == NULL) {
+      GST_DEBUG_OBJECT (src, "unknown stream on channel %d, ignored", channel);
+      continue;
+    }
+
+    buf = gst_buffer_new ();
+    gst_buffer_append_memory (buf,
+        gst_memory_new_wrapped (GST_MEMORY_FLAG_READONLY, src->chunk_data,
+            CHUNK_SIZE, start + payload, len, gst_memory_ref (src->chunk),
+            (GDestroyNotify) gst_memory_unref));
+
+    /* events go after the packets that were read before them */
+    if (src->need_activate || src->need_segment || stream->need_caps) {
+      GstFlowReturn ret = gst_rtspsrc_push_pending (src);
+
+      if (ret != GST_FLOW_OK) {
+        gst_buffer_unref (buf);
+        return ret;
+      }
+    }
+    gst_rtspsrc_prepare_data (src, stream, buf, is_rtcp);
+
+    if (stream->pending[is_rtcp] == NULL)
+      stream->pending[is_rtcp] = gst_buffer_list_new ();
+    gst_buffer_list_add (stream->pending[is_rtcp], buf);
+  }
+
+  return gst_rtspsrc_push_pending (src);
+
+  /* ERRORS */
+read_error:
+  {
+    GST_ELEMENT_ERROR (src, RESOURCE, READ, (NULL),
+        ("Could not receive data. (%s)", err ? err->message : "EOF"));
+    g_clear_error (&err);
+    return GST_FLOW_ERROR;
+  }
+}
+
 static GstFlowReturn
 gst_rtspsrc_loop_interleaved (GstRTSPSrc * src)
 {
@@ -4609,6 +5065,7 @@ gst_rtspsrc_loop_interleaved (GstRTSPSrc * src)
   GstRTSPResult res;
   GstFlowReturn ret = GST_FLOW_OK;
   GTimeVal tv_timeout;
+  gboolean got_data;
 
   while (TRUE) {
     /* get the next timeout interval */
@@ -4625,6 +5082,13 @@ gst_rtspsrc_loop_interleaved (GstRTSPSrc * src)
       gst_rtsp_connection_next_timeout (src->conninfo.connection, &tv_timeout);
     }
 
+    /* take the data that is queued in one go when we can */
+    ret = gst_rtspsrc_read_data_chunk (src, &got_data);
+    if (ret != GST_FLOW_OK)
+      goto handle_data_failed;
+    if (got_data)
+      continue;
+
     GST_DEBUG_OBJECT (src, "doing receive with timeout %ld seconds, %ld usec",
         tv_timeout.tv_sec, tv_timeout.tv_usec);
 
@@ -7227,6 +7691,7 @@ restart:
 
       /* store the newsegment event so it can be sent from the streaming thread. */
       src->need_segment = TRUE;
+      gst_rtspsrc_shared_need_events (src);
     }
 
     if (segment->rate != 1.0) {
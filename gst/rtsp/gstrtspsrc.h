@@ -52,6 +52,7 @@ G_BEGIN_DECLS
 #include <gio/gio.h>
 
 #include "gstrtspext.h"
+#include "gstrtspreceiver.h"
 
 #define GST_TYPE_RTSPSRC \
   (gst_rtspsrc_get_type())
@@ -108,6 +109,8 @@ struct _GstRTSPStream {
   /* for interleaved mode */
   guint8        channel[2];
   GstPad       *channelpad[2];
+  /* packets read in one chunk, pushed as a list per channel */
+  GstBufferList *pending[2];
 
   /* our udp sources */
   GstElement   *udpsrc[2];
@@ -115,6 +118,11 @@ struct _GstRTSPStream {
   gulong        blockid;
   gboolean      is_ipv6;
 
+  /* shared receiver, the udp sources only keep the sockets open */
+  gboolean      shared_recv;
+  GstRTSPReceiverSource *recv_source[2];
+  gint          recv_need_events[2];  /* ATOMIC */
+
   /* our udp sinks back to the server */
   GstElement   *udpsink[2];
   GstPad       *rtcppad;
@@ -188,6 +196,11 @@ struct _GstRTSPSrc {
   gint             free_channel;
   gboolean         need_segment;
   GstClockTime     base_time;
+  /* chunk that interleaved data is read into, chunk owns chunk_data and is
+   * kept alive by the packets that point into it */
+  GstMemory       *chunk;
+  guint8          *chunk_data;
+  gsize            chunk_offset;
 
   /* UDP mode loop */
   gint             pending_cmd;
@@ -244,6 +257,7 @@ struct _GstRTSPSrc {
   gchar            *user_agent;
   GstClockTime      max_rtcp_rtp_time_diff;
   gboolean          rfc7273_sync;
+  guint             receive_threads;
 
   /* state */
   GstRTSPState       state;
@@ -271,6 +285,9 @@ struct _GstRTSPSrc {
 
   GstRTSPConnInfo  conninfo;
 
+  /* shared UDP receiver threads, when receive_threads > 0 */
+  GstRTSPReceiver *receiver;
+
   /* a list of RTSP extensions as GstElement */
   GstRTSPExtensionList  *extensions;
 };
@@ -88,6 +88,23 @@
  * fields will be each a nested #GstValueArray. The first dimension are the
  * channels and the second dimension are the values.
  *
+ * By default the FFTs of one interval don't overlap. The #GstSpectrum:hop-size
+ * property allows to run an FFT every hop-size frames instead, which gives
+ * overlapping analysis frames if it is smaller than the FFT length of
+ * 2 * (bands - 1) frames.
+ *
+ * If #GstSpectrum:output-bands is smaller than #GstSpectrum:bands, adjacent
+ * frequency bands are averaged before posting the message, either in groups
+ * of the same size or, with #GstSpectrum:band-scale set to logarithmic, in
+ * groups whose width grows logarithmically with the frequency. Output band k
+ * then starts at FFT band pow (bands, k / output-bands) but each output band
+ * contains at least one FFT band.
+ *
+ * If #GstSpectrum:packed-messages is %TRUE, the magnitude and phase fields are
+ * #GBytes containing native endian #gfloat values instead, the bands of all
+ * channels one channel after another. This is a lot cheaper than the value
+ * lists for many bands, channels and short intervals.
+ *
  * <refsect2>
  * <title>Example application</title>
  * <informalexample><programlisting language="C">
@@ -126,6 +143,10 @@ GST_DEBUG_CATEGORY_STATIC (gst_spectrum_debug);
 #define DEFAULT_BANDS			128
 #define DEFAULT_THRESHOLD		-60
 #define DEFAULT_MULTI_CHANNEL		FALSE
+#define DEFAULT_HOP_SIZE		0
+#define DEFAULT_OUTPUT_BANDS		0
+#define DEFAULT_BAND_SCALE		BAND_SCALE_LINEAR
+#define DEFAULT_PACKED_MESSAGES		FALSE
 
 enum
 {
@@ -136,9 +157,39 @@ enum
   PROP_INTERVAL,
   PROP_BANDS,
   PROP_THRESHOLD,
-  PROP_MULTI_CHANNEL
+  PROP_MULTI_CHANNEL,
+  PROP_HOP_SIZE,
+  PROP_OUTPUT_BANDS,
+  PROP_BAND_SCALE,
+  PROP_PACKED_MESSAGES
+};
+
+enum
+{
+  BAND_SCALE_LINEAR,
+  BAND_SCALE_LOGARITHMIC
 };
 
+#define GST_TYPE_SPECTRUM_BAND_SCALE (gst_spectrum_band_scale_get_type ())
+static GType
+gst_spectrum_band_scale_get_type (void)
+{
+  static GType gtype = 0;
+
+  if (gtype == 0) {
+    static const GEnumValue values[] = {
+      {BAND_SCALE_LINEAR, "Linear (default)",
+          "linear"},
+      {BAND_SCALE_LOGARITHMIC, "Logarithmic",
+          "logarithmic"},
+      {0, NULL, NULL}
+    };
+
+    gtype = g_enum_register_static ("GstSpectrumBandScale", values);
+  }
+  return gtype;
+}
+
 #define gst_spectrum_parent_class parent_class
 G_DEFINE_TYPE (GstSpectrum, gst_spectrum, GST_TYPE_AUDIO_FILTER);
 
@@ -153,6 +204,8 @@ static GstFlowReturn gst_spectrum_transform_ip (GstBaseTransform * trans,
     GstBuffer * in);
 static gboolean gst_spectrum_setup (GstAudioFilter * base,
     const GstAudioInfo * info);
+static GstSpectrumInputData gst_spectrum_get_input_data (GstSpectrum *
+    spectrum);
 
 static void
 gst_spectrum_class_init (GstSpectrumClass * klass)
@@ -215,6 +268,61 @@ gst_spectrum_class_init (GstSpectrumClass * klass)
           "Send separate results for each channel",
           DEFAULT_MULTI_CHANNEL, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstSpectrum:hop-size
+   *
+   * Number of frames between the start of two FFTs. 0 runs the FFTs one
+   * after another without overlap.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_HOP_SIZE,
+      g_param_spec_uint ("hop-size", "Hop size",
+          "Number of frames between two FFTs (0 = FFT length, no overlap)",
+          0, G_MAXINT, DEFAULT_HOP_SIZE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSpectrum:output-bands
+   *
+   * Number of bands in the messages. If smaller than #GstSpectrum:bands,
+   * adjacent bands are averaged according to #GstSpectrum:band-scale.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_OUTPUT_BANDS,
+      g_param_spec_uint ("output-bands", "Output bands",
+          "Number of frequency bands in the messages (0 = all bands)",
+          0, ((guint) G_MAXINT + 2) / 2, DEFAULT_OUTPUT_BANDS,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSpectrum:band-scale
+   *
+   * How the bands are grouped if #GstSpectrum:output-bands is smaller than
+   * #GstSpectrum:bands.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_BAND_SCALE,
+      g_param_spec_enum ("band-scale", "Band scale",
+          "Frequency scale of the output bands", GST_TYPE_SPECTRUM_BAND_SCALE,
+          DEFAULT_BAND_SCALE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstSpectrum:packed-messages
+   *
+   * Put the magnitudes and phases into the message as #GBytes with one
+   * #gfloat per band and channel instead of value lists.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_PACKED_MESSAGES,
+      g_param_spec_boolean ("packed-messages", "Packed Messages",
+          "Post magnitudes and phases as packed arrays of floats "
+          "instead of value lists", DEFAULT_PACKED_MESSAGES,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   GST_DEBUG_CATEGORY_INIT (gst_spectrum_debug, "spectrum", 0,
       "audio spectrum analyser element");
 
@@ -239,10 +347,36 @@ gst_spectrum_init (GstSpectrum * spectrum)
   spectrum->interval = DEFAULT_INTERVAL;
   spectrum->bands = DEFAULT_BANDS;
   spectrum->threshold = DEFAULT_THRESHOLD;
+  spectrum->hop_size = DEFAULT_HOP_SIZE;
+  spectrum->output_bands = DEFAULT_OUTPUT_BANDS;
+  spectrum->band_scale = DEFAULT_BAND_SCALE;
+  spectrum->packed_messages = DEFAULT_PACKED_MESSAGES;
 
   g_mutex_init (&spectrum->lock);
 }
 
+static void
+gst_spectrum_compute_band_edges (GstSpectrum * spectrum)
+{
+  guint bands = spectrum->bands;
+  guint n = spectrum->num_output_bands;
+  guint *edges = spectrum->band_edges;
+  guint64 e;
+  guint i;
+
+  /* output band i contains the FFT bands edges[i] to edges[i + 1] - 1,
+   * every output band gets at least one of them */
+  edges[0] = 0;
+  for (i = 1; i < n; i++) {
+    if (spectrum->band_scale == BAND_SCALE_LOGARITHMIC)
+      e = (guint64) pow (bands, (gdouble) i / n);
+    else
+      e = (guint64) i * bands / n;
+    edges[i] = CLAMP (e, edges[i - 1] + 1, bands - (n - i));
+  }
+  edges[n] = bands;
+}
+
 static void
 gst_spectrum_alloc_channel_data (GstSpectrum * spectrum)
 {
@@ -255,19 +389,47 @@ gst_spectrum_alloc_channel_data (GstSpectrum * spectrum)
 
   spectrum->num_channels = (spectrum->multi_channel) ?
       GST_AUDIO_FILTER_CHANNELS (spectrum) : 1;
+  spectrum->input_data = gst_spectrum_get_input_data (spectrum);
 
   GST_DEBUG_OBJECT (spectrum, "allocating data for %d channels",
       spectrum->num_channels);
 
+  /* all channels go through the same FFT and share the scratch memory, the
+   * ringbuffers and accumulators are stored one channel after another */
+  spectrum->fft_ctx = gst_fft_f32_new (nfft, FALSE);
+  spectrum->window = g_new (gfloat, nfft);
+  for (i = 0; i < nfft; i++)
+    spectrum->window[i] = 1.0;
+  gst_fft_f32_window (spectrum->fft_ctx, spectrum->window,
+      GST_FFT_WINDOW_HAMMING);
+  spectrum->input = g_new0 (gfloat, spectrum->num_channels * nfft);
+  spectrum->input_tmp = g_new0 (gfloat, nfft);
+  spectrum->freqdata = g_new0 (GstFFTF32Complex, bands);
+  spectrum->spect_magnitude = g_new0 (gfloat, spectrum->num_channels * bands);
+  spectrum->spect_phase = g_new0 (gfloat, spectrum->num_channels * bands);
+
   spectrum->channel_data = g_new (GstSpectrumChannel, spectrum->num_channels);
   for (i = 0; i < spectrum->num_channels; i++) {
     cd = &spectrum->channel_data[i];
-    cd->fft_ctx = gst_fft_f32_new (nfft, FALSE);
-    cd->input = g_new0 (gfloat, nfft);
-    cd->input_tmp = g_new0 (gfloat, nfft);
-    cd->freqdata = g_new0 (GstFFTF32Complex, bands);
-    cd->spect_magnitude = g_new0 (gfloat, bands);
-    cd->spect_phase = g_new0 (gfloat, bands);
+    cd->input = spectrum->input + i * nfft;
+    cd->spect_magnitude = spectrum->spect_magnitude + i * bands;
+    cd->spect_phase = spectrum->spect_phase + i * bands;
+  }
+
+  spectrum->num_output_bands = spectrum->output_bands;
+  if (spectrum->num_output_bands == 0 || spectrum->num_output_bands > bands)
+    spectrum->num_output_bands = bands;
+
+  if (spectrum->num_output_bands < bands) {
+    guint size = spectrum->num_channels * spectrum->num_output_bands;
+
+    GST_DEBUG_OBJECT (spectrum, "aggregating %u bands into %u", bands,
+        spectrum->num_output_bands);
+
+    spectrum->band_edges = g_new (guint, spectrum->num_output_bands + 1);
+    gst_spectrum_compute_band_edges (spectrum);
+    spectrum->output_magnitude = g_new0 (gfloat, size);
+    spectrum->output_phase = g_new0 (gfloat, size);
   }
 }
 
@@ -275,22 +437,31 @@ static void
 gst_spectrum_free_channel_data (GstSpectrum * spectrum)
 {
   if (spectrum->channel_data) {
-    gint i;
-    GstSpectrumChannel *cd;
-
     GST_DEBUG_OBJECT (spectrum, "freeing data for %d channels",
         spectrum->num_channels);
 
-    for (i = 0; i < spectrum->num_channels; i++) {
-      cd = &spectrum->channel_data[i];
-      if (cd->fft_ctx)
-        gst_fft_f32_free (cd->fft_ctx);
-      g_free (cd->input);
-      g_free (cd->input_tmp);
-      g_free (cd->freqdata);
-      g_free (cd->spect_magnitude);
-      g_free (cd->spect_phase);
-    }
+    if (spectrum->fft_ctx)
+      gst_fft_f32_free (spectrum->fft_ctx);
+    spectrum->fft_ctx = NULL;
+    g_free (spectrum->window);
+    spectrum->window = NULL;
+    g_free (spectrum->input);
+    spectrum->input = NULL;
+    g_free (spectrum->input_tmp);
+    spectrum->input_tmp = NULL;
+    g_free (spectrum->freqdata);
+    spectrum->freqdata = NULL;
+    g_free (spectrum->spect_magnitude);
+    spectrum->spect_magnitude = NULL;
+    g_free (spectrum->spect_phase);
+    spectrum->spect_phase = NULL;
+    g_free (spectrum->band_edges);
+    spectrum->band_edges = NULL;
+    g_free (spectrum->output_magnitude);
+    spectrum->output_magnitude = NULL;
+    g_free (spectrum->output_phase);
+    spectrum->output_phase = NULL;
+
     g_free (spectrum->channel_data);
     spectrum->channel_data = NULL;
   }
@@ -374,6 +545,34 @@ gst_spectrum_set_property (GObject * object, guint prop_id,
       g_mutex_unlock (&filter->lock);
       break;
     }
+    case PROP_HOP_SIZE:
+      g_mutex_lock (&filter->lock);
+      filter->hop_size = g_value_get_uint (value);
+      g_mutex_unlock (&filter->lock);
+      break;
+    case PROP_OUTPUT_BANDS:{
+      guint output_bands = g_value_get_uint (value);
+      g_mutex_lock (&filter->lock);
+      if (filter->output_bands != output_bands) {
+        filter->output_bands = output_bands;
+        gst_spectrum_reset_state (filter);
+      }
+      g_mutex_unlock (&filter->lock);
+      break;
+    }
+    case PROP_BAND_SCALE:{
+      gint band_scale = g_value_get_enum (value);
+      g_mutex_lock (&filter->lock);
+      if (filter->band_scale != band_scale) {
+        filter->band_scale = band_scale;
+        gst_spectrum_reset_state (filter);
+      }
+      g_mutex_unlock (&filter->lock);
+      break;
+    }
+    case PROP_PACKED_MESSAGES:
+      filter->packed_messages = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -408,6 +607,18 @@ gst_spectrum_get_property (GObject * object, guint prop_id,
     case PROP_MULTI_CHANNEL:
       g_value_set_boolean (value, filter->multi_channel);
       break;
+    case PROP_HOP_SIZE:
+      g_value_set_uint (value, filter->hop_size);
+      break;
+    case PROP_OUTPUT_BANDS:
+      g_value_set_uint (value, filter->output_bands);
+      break;
+    case PROP_BAND_SCALE:
+      g_value_set_enum (value, filter->band_scale);
+      break;
+    case PROP_PACKED_MESSAGES:
+      g_value_set_boolean (value, filter->packed_messages);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -449,7 +660,8 @@ input_data_mixed_float (const guint8 * _in, gfloat * out, guint len,
     for (i = 1; i < channels; i++)
       v += in[ip++];
     out[op] = v / channels;
-    op = (op + 1) % nfft;
+    if (++op == nfft)
+      op = 0;
   }
 }
 
@@ -466,7 +678,8 @@ input_data_mixed_double (const guint8 * _in, gfloat * out, guint len,
     for (i = 1; i < channels; i++)
       v += in[ip++];
     out[op] = v / channels;
-    op = (op + 1) % nfft;
+    if (++op == nfft)
+      op = 0;
   }
 }
 
@@ -483,7 +696,8 @@ input_data_mixed_int32_max (const guint8 * _in, gfloat * out, guint len,
     for (i = 1; i < channels; i++)
       v += in[ip++] / max_value;
     out[op] = v / channels;
-    op = (op + 1) % nfft;
+    if (++op == nfft)
+      op = 0;
   }
 }
 
@@ -507,7 +721,8 @@ input_data_mixed_int24_max (const guint8 * _in, gfloat * out, guint len,
       _in += 3;
     }
     out[op] = v / channels;
-    op = (op + 1) % nfft;
+    if (++op == nfft)
+      op = 0;
   }
 }
 
@@ -524,22 +739,25 @@ input_data_mixed_int16_max (const guint8 * _in, gfloat * out, guint len,
     for (i = 1; i < channels; i++)
       v += in[ip++] / max_value;
     out[op] = v / channels;
-    op = (op + 1) % nfft;
+    if (++op == nfft)
+      op = 0;
   }
 }
 
-/* non mixing data readers */
+/* non mixing data readers, these deinterleave all channels in one pass */
 
 static void
 input_data_float (const guint8 * _in, gfloat * out, guint len, guint channels,
     gfloat max_value, guint op, guint nfft)
 {
-  guint j, ip;
+  guint i, j, ip = 0;
   gfloat *in = (gfloat *) _in;
 
-  for (j = 0, ip = 0; j < len; j++, ip += channels) {
-    out[op] = in[ip];
-    op = (op + 1) % nfft;
+  for (j = 0; j < len; j++) {
+    for (i = 0; i < channels; i++)
+      out[i * nfft + op] = in[ip++];
+    if (++op == nfft)
+      op = 0;
   }
 }
 
@@ -547,12 +765,14 @@ static void
 input_data_double (const guint8 * _in, gfloat * out, guint len, guint channels,
     gfloat max_value, guint op, guint nfft)
 {
-  guint j, ip;
+  guint i, j, ip = 0;
   gdouble *in = (gdouble *) _in;
 
-  for (j = 0, ip = 0; j < len; j++, ip += channels) {
-    out[op] = in[ip];
-    op = (op + 1) % nfft;
+  for (j = 0; j < len; j++) {
+    for (i = 0; i < channels; i++)
+      out[i * nfft + op] = in[ip++];
+    if (++op == nfft)
+      op = 0;
   }
 }
 
@@ -560,12 +780,14 @@ static void
 input_data_int32_max (const guint8 * _in, gfloat * out, guint len,
     guint channels, gfloat max_value, guint op, guint nfft)
 {
-  guint j, ip;
+  guint i, j, ip = 0;
   gint32 *in = (gint32 *) _in;
 
-  for (j = 0, ip = 0; j < len; j++, ip += channels) {
-    out[op] = in[ip] / max_value;
-    op = (op + 1) % nfft;
+  for (j = 0; j < len; j++) {
+    for (i = 0; i < channels; i++)
+      out[i * nfft + op] = in[ip++] / max_value;
+    if (++op == nfft)
+      op = 0;
   }
 }
 
@@ -573,19 +795,22 @@ static void
 input_data_int24_max (const guint8 * _in, gfloat * out, guint len,
     guint channels, gfloat max_value, guint op, guint nfft)
 {
-  guint j;
+  guint i, j;
 
   for (j = 0; j < len; j++) {
+    for (i = 0; i < channels; i++) {
 #if G_BYTE_ORDER == G_BIG_ENDIAN
-    gint32 v = GST_READ_UINT24_BE (_in);
+      gint32 v = GST_READ_UINT24_BE (_in);
 #else
-    gint32 v = GST_READ_UINT24_LE (_in);
+      gint32 v = GST_READ_UINT24_LE (_in);
 #endif
-    if (v & 0x00800000)
-      v |= 0xff000000;
-    _in += 3 * channels;
-    out[op] = v / max_value;
-    op = (op + 1) % nfft;
+      if (v & 0x00800000)
+        v |= 0xff000000;
+      _in += 3;
+      out[i * nfft + op] = v / max_value;
+    }
+    if (++op == nfft)
+      op = 0;
   }
 }
 
@@ -593,24 +818,24 @@ static void
 input_data_int16_max (const guint8 * _in, gfloat * out, guint len,
     guint channels, gfloat max_value, guint op, guint nfft)
 {
-  guint j, ip;
+  guint i, j, ip = 0;
   gint16 *in = (gint16 *) _in;
 
-  for (j = 0, ip = 0; j < len; j++, ip += channels) {
-    out[op] = in[ip] / max_value;
-    op = (op + 1) % nfft;
+  for (j = 0; j < len; j++) {
+    for (i = 0; i < channels; i++)
+      out[i * nfft + op] = in[ip++] / max_value;
+    if (++op == nfft)
+      op = 0;
   }
 }
 
-static gboolean
-gst_spectrum_setup (GstAudioFilter * base, const GstAudioInfo * info)
+static GstSpectrumInputData
+gst_spectrum_get_input_data (GstSpectrum * spectrum)
 {
-  GstSpectrum *spectrum = GST_SPECTRUM (base);
   gboolean multi_channel = spectrum->multi_channel;
   GstSpectrumInputData input_data = NULL;
 
-  g_mutex_lock (&spectrum->lock);
-  switch (GST_AUDIO_INFO_FORMAT (info)) {
+  switch (GST_AUDIO_FILTER_FORMAT (spectrum)) {
     case GST_AUDIO_FORMAT_S16:
       input_data =
           multi_channel ? input_data_int16_max : input_data_mixed_int16_max;
@@ -633,8 +858,16 @@ gst_spectrum_setup (GstAudioFilter * base, const GstAudioInfo * info)
       g_assert_not_reached ();
       break;
   }
-  spectrum->input_data = input_data;
 
+  return input_data;
+}
+
+static gboolean
+gst_spectrum_setup (GstAudioFilter * base, const GstAudioInfo * info)
+{
+  GstSpectrum *spectrum = GST_SPECTRUM (base);
+
+  g_mutex_lock (&spectrum->lock);
   gst_spectrum_reset_state (spectrum);
   g_mutex_unlock (&spectrum->lock);
 
@@ -688,17 +921,29 @@ gst_spectrum_message_add_array (GValue * cv, gfloat * data, guint num_values)
   g_value_unset (&a);
 }
 
+static void
+gst_spectrum_message_add_bytes (GstStructure * s, const gchar * name,
+    gfloat * data, guint num_values)
+{
+  GValue v = { 0, };
+
+  g_value_init (&v, G_TYPE_BYTES);
+  g_value_take_boxed (&v, g_bytes_new (data, num_values * sizeof (gfloat)));
+  gst_structure_take_value (s, name, &v);
+}
+
 static GstMessage *
 gst_spectrum_message_new (GstSpectrum * spectrum, GstClockTime timestamp,
     GstClockTime duration)
 {
   GstBaseTransform *trans = GST_BASE_TRANSFORM_CAST (spectrum);
-  GstSpectrumChannel *cd;
   GstStructure *s;
   GValue *mcv = NULL, *pcv = NULL;
   GstClockTime endtime, running_time, stream_time;
+  guint bands = spectrum->num_output_bands;
+  gfloat *magnitude, *phase;
 
-  GST_DEBUG_OBJECT (spectrum, "preparing message, bands =%d ", spectrum->bands);
+  GST_DEBUG_OBJECT (spectrum, "preparing message, bands =%d ", bands);
 
   running_time = gst_segment_to_running_time (&trans->segment, GST_FORMAT_TIME,
       timestamp);
@@ -714,22 +959,35 @@ gst_spectrum_message_new (GstSpectrum * spectrum, GstClockTime timestamp,
       "running-time", G_TYPE_UINT64, running_time,
       "duration", G_TYPE_UINT64, duration, NULL);
 
-  if (!spectrum->multi_channel) {
-    cd = &spectrum->channel_data[0];
+  /* the values of all channels, one channel after another */
+  if (spectrum->band_edges) {
+    magnitude = spectrum->output_magnitude;
+    phase = spectrum->output_phase;
+  } else {
+    magnitude = spectrum->spect_magnitude;
+    phase = spectrum->spect_phase;
+  }
 
+  if (spectrum->packed_messages) {
+    guint num_values = spectrum->num_channels * bands;
+
+    if (spectrum->message_magnitude)
+      gst_spectrum_message_add_bytes (s, "magnitude", magnitude, num_values);
+    if (spectrum->message_phase)
+      gst_spectrum_message_add_bytes (s, "phase", phase, num_values);
+  } else if (!spectrum->multi_channel) {
     if (spectrum->message_magnitude) {
       /* FIXME 0.11: this should be an array, not a list */
       mcv = gst_spectrum_message_add_container (s, GST_TYPE_LIST, "magnitude");
-      gst_spectrum_message_add_list (mcv, cd->spect_magnitude, spectrum->bands);
+      gst_spectrum_message_add_list (mcv, magnitude, bands);
     }
     if (spectrum->message_phase) {
       /* FIXME 0.11: this should be an array, not a list */
       pcv = gst_spectrum_message_add_container (s, GST_TYPE_LIST, "phase");
-      gst_spectrum_message_add_list (pcv, cd->spect_phase, spectrum->bands);
+      gst_spectrum_message_add_list (pcv, phase, bands);
     }
   } else {
     guint c;
-    guint channels = GST_AUDIO_FILTER_CHANNELS (spectrum);
 
     if (spectrum->message_magnitude) {
       mcv = gst_spectrum_message_add_container (s, GST_TYPE_ARRAY, "magnitude");
@@ -738,15 +996,12 @@ gst_spectrum_message_new (GstSpectrum * spectrum, GstClockTime timestamp,
       pcv = gst_spectrum_message_add_container (s, GST_TYPE_ARRAY, "phase");
     }
 
-    for (c = 0; c < channels; c++) {
-      cd = &spectrum->channel_data[c];
-
+    for (c = 0; c < spectrum->num_channels; c++) {
       if (spectrum->message_magnitude) {
-        gst_spectrum_message_add_array (mcv, cd->spect_magnitude,
-            spectrum->bands);
+        gst_spectrum_message_add_array (mcv, magnitude + c * bands, bands);
       }
       if (spectrum->message_phase) {
-        gst_spectrum_message_add_array (pcv, cd->spect_phase, spectrum->bands);
+        gst_spectrum_message_add_array (pcv, phase + c * bands, bands);
       }
     }
   }
@@ -754,80 +1009,110 @@ gst_spectrum_message_new (GstSpectrum * spectrum, GstClockTime timestamp,
 }
 
 static void
-gst_spectrum_run_fft (GstSpectrum * spectrum, GstSpectrumChannel * cd,
-    guint input_pos)
+gst_spectrum_run_fft (GstSpectrum * spectrum, guint input_pos)
 {
-  guint i;
+  guint c, i, n;
   guint bands = spectrum->bands;
   guint nfft = 2 * bands - 2;
   gint threshold = spectrum->threshold;
-  gfloat *input = cd->input;
-  gfloat *input_tmp = cd->input_tmp;
-  gfloat *spect_magnitude = cd->spect_magnitude;
-  gfloat *spect_phase = cd->spect_phase;
-  GstFFTF32Complex *freqdata = cd->freqdata;
-  GstFFTF32 *fft_ctx = cd->fft_ctx;
+  const gfloat *window = spectrum->window;
+  gfloat *input_tmp = spectrum->input_tmp;
+  GstFFTF32Complex *freqdata = spectrum->freqdata;
+  GstFFTF32 *fft_ctx = spectrum->fft_ctx;
+
+  for (c = 0; c < spectrum->num_channels; c++) {
+    GstSpectrumChannel *cd = &spectrum->channel_data[c];
+    const gfloat *input = cd->input;
+    gfloat *spect_magnitude = cd->spect_magnitude;
+    gfloat *spect_phase = cd->spect_phase;
 
-  for (i = 0; i < nfft; i++)
-    input_tmp[i] = input[(input_pos + i) % nfft];
+    /* unroll the ringbuffer and apply the window in one go */
+    n = nfft - input_pos;
+    for (i = 0; i < n; i++)
+      input_tmp[i] = input[input_pos + i] * window[i];
+    for (i = n; i < nfft; i++)
+      input_tmp[i] = input[i - n] * window[i];
 
-  gst_fft_f32_window (fft_ctx, input_tmp, GST_FFT_WINDOW_HAMMING);
+    gst_fft_f32_fft (fft_ctx, input_tmp, freqdata);
 
-  gst_fft_f32_fft (fft_ctx, input_tmp, freqdata);
+    if (spectrum->message_magnitude) {
+      gdouble val;
+      /* Calculate magnitude in db */
+      for (i = 0; i < bands; i++) {
+        val = freqdata[i].r * freqdata[i].r;
+        val += freqdata[i].i * freqdata[i].i;
+        val /= nfft * nfft;
+        val = 10.0 * log10 (val);
+        if (val < threshold)
+          val = threshold;
+        spect_magnitude[i] += val;
+      }
+    }
 
-  if (spectrum->message_magnitude) {
-    gdouble val;
-    /* Calculate magnitude in db */
-    for (i = 0; i < bands; i++) {
-      val = freqdata[i].r * freqdata[i].r;
-      val += freqdata[i].i * freqdata[i].i;
-      val /= nfft * nfft;
-      val = 10.0 * log10 (val);
-      if (val < threshold)
-        val = threshold;
-      spect_magnitude[i] += val;
+    if (spectrum->message_phase) {
+      /* Calculate phase */
+      for (i = 0; i < bands; i++)
+        spect_phase[i] += atan2 (freqdata[i].i, freqdata[i].r);
     }
   }
+}
 
-  if (spectrum->message_phase) {
-    /* Calculate phase */
-    for (i = 0; i < bands; i++)
-      spect_phase[i] += atan2 (freqdata[i].i, freqdata[i].r);
+static void
+gst_spectrum_aggregate_bands (GstSpectrum * spectrum, const gfloat * in,
+    gfloat * out)
+{
+  guint c, i, j;
+  guint bands = spectrum->bands;
+  guint n = spectrum->num_output_bands;
+  const guint *edges = spectrum->band_edges;
+  gfloat v;
+
+  for (c = 0; c < spectrum->num_channels; c++) {
+    for (i = 0; i < n; i++) {
+      v = 0.0;
+      for (j = edges[i]; j < edges[i + 1]; j++)
+        v += in[j];
+      out[i] = v / (edges[i + 1] - edges[i]);
+    }
+    in += bands;
+    out += n;
   }
 }
 
 static void
-gst_spectrum_prepare_message_data (GstSpectrum * spectrum,
-    GstSpectrumChannel * cd)
+gst_spectrum_prepare_message_data (GstSpectrum * spectrum)
 {
   guint i;
-  guint bands = spectrum->bands;
+  guint size = spectrum->num_channels * spectrum->bands;
   guint num_fft = spectrum->num_fft;
 
   /* Calculate average */
   if (spectrum->message_magnitude) {
-    gfloat *spect_magnitude = cd->spect_magnitude;
-    for (i = 0; i < bands; i++)
+    gfloat *spect_magnitude = spectrum->spect_magnitude;
+    for (i = 0; i < size; i++)
       spect_magnitude[i] /= num_fft;
+    if (spectrum->band_edges)
+      gst_spectrum_aggregate_bands (spectrum, spect_magnitude,
+          spectrum->output_magnitude);
   }
   if (spectrum->message_phase) {
-    gfloat *spect_phase = cd->spect_phase;
-    for (i = 0; i < bands; i++)
+    gfloat *spect_phase = spectrum->spect_phase;
+    for (i = 0; i < size; i++)
       spect_phase[i] /= num_fft;
+    if (spectrum->band_edges)
+      gst_spectrum_aggregate_bands (spectrum, spect_phase,
+          spectrum->output_phase);
   }
 }
 
 static void
-gst_spectrum_reset_message_data (GstSpectrum * spectrum,
-    GstSpectrumChannel * cd)
+gst_spectrum_reset_message_data (GstSpectrum * spectrum)
 {
-  guint bands = spectrum->bands;
-  gfloat *spect_magnitude = cd->spect_magnitude;
-  gfloat *spect_phase = cd->spect_phase;
+  guint size = spectrum->num_channels * spectrum->bands;
 
   /* reset spectrum accumulators */
-  memset (spect_magnitude, 0, bands * sizeof (gfloat));
-  memset (spect_phase, 0, bands * sizeof (gfloat));
+  memset (spectrum->spect_magnitude, 0, size * sizeof (gfloat));
+  memset (spectrum->spect_phase, 0, size * sizeof (gfloat));
 }
 
 static GstFlowReturn
@@ -838,19 +1123,16 @@ gst_spectrum_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
   guint channels = GST_AUDIO_FILTER_CHANNELS (spectrum);
   guint bps = GST_AUDIO_FILTER_BPS (spectrum);
   guint bpf = GST_AUDIO_FILTER_BPF (spectrum);
-  guint output_channels = spectrum->multi_channel ? channels : 1;
-  guint c;
   gfloat max_value = (1UL << ((bps << 3) - 1)) - 1;
   guint bands = spectrum->bands;
   guint nfft = 2 * bands - 2;
+  guint hop_size;
   guint input_pos;
-  gfloat *input;
   GstMapInfo map;
   const guint8 *data;
   gsize size;
   guint fft_todo, msg_todo, block_size;
-  gboolean have_full_interval;
-  GstSpectrumChannel *cd;
+  gboolean have_full_interval, have_fft;
   GstSpectrumInputData input_data;
 
   g_mutex_lock (&spectrum->lock);
@@ -899,10 +1181,11 @@ gst_spectrum_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
 
   input_pos = spectrum->input_pos;
   input_data = spectrum->input_data;
+  hop_size = spectrum->hop_size ? spectrum->hop_size : nfft;
 
   while (size >= bpf) {
     /* run input_data for a chunk of data */
-    fft_todo = nfft - (spectrum->num_frames % nfft);
+    fft_todo = hop_size - (spectrum->num_frames % hop_size);
     msg_todo = spectrum->frames_todo - spectrum->num_frames;
     GST_LOG_OBJECT (spectrum,
         "message frames todo: %u, fft frames todo: %u, input frames %"
@@ -913,32 +1196,25 @@ gst_spectrum_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
     if (block_size > fft_todo)
       block_size = fft_todo;
 
-    for (c = 0; c < output_channels; c++) {
-      cd = &spectrum->channel_data[c];
-      input = cd->input;
-      /* Move the current frames into our ringbuffers */
-      input_data (data + c * bps, input, block_size, channels, max_value,
-          input_pos, nfft);
-    }
+    /* Move the current frames into our ringbuffers */
+    input_data (data, spectrum->input, block_size, channels, max_value,
+        input_pos, nfft);
     data += block_size * bpf;
     size -= block_size * bpf;
     input_pos = (input_pos + block_size) % nfft;
     spectrum->num_frames += block_size;
 
     have_full_interval = (spectrum->num_frames == spectrum->frames_todo);
+    have_fft = (spectrum->num_frames % hop_size == 0);
 
     GST_LOG_OBJECT (spectrum,
         "size: %" G_GSIZE_FORMAT ", do-fft = %d, do-message = %d", size,
-        (spectrum->num_frames % nfft == 0), have_full_interval);
+        have_fft, have_full_interval);
 
     /* If we have enough frames for an FFT or we have all frames required for
      * the interval and we haven't run a FFT, then run an FFT */
-    if ((spectrum->num_frames % nfft == 0) ||
-        (have_full_interval && !spectrum->num_fft)) {
-      for (c = 0; c < output_channels; c++) {
-        cd = &spectrum->channel_data[c];
-        gst_spectrum_run_fft (spectrum, cd, input_pos);
-      }
+    if (have_fft || (have_full_interval && !spectrum->num_fft)) {
+      gst_spectrum_run_fft (spectrum, input_pos);
       spectrum->num_fft++;
     }
 
@@ -959,10 +1235,7 @@ gst_spectrum_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
       if (spectrum->post_messages) {
         GstMessage *m;
 
-        for (c = 0; c < output_channels; c++) {
-          cd = &spectrum->channel_data[c];
-          gst_spectrum_prepare_message_data (spectrum, cd);
-        }
+        gst_spectrum_prepare_message_data (spectrum);
 
         m = gst_spectrum_message_new (spectrum, spectrum->message_ts,
             spectrum->interval);
@@ -974,10 +1247,7 @@ gst_spectrum_transform_ip (GstBaseTransform * trans, GstBuffer * buffer)
         spectrum->message_ts +=
             gst_util_uint64_scale (spectrum->num_frames, GST_SECOND, rate);
 
-      for (c = 0; c < output_channels; c++) {
-        cd = &spectrum->channel_data[c];
-        gst_spectrum_reset_message_data (spectrum, cd);
-      }
+      gst_spectrum_reset_message_data (spectrum);
       spectrum->num_frames = 0;
       spectrum->num_fft = 0;
     }
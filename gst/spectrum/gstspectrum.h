@@ -42,12 +42,9 @@ typedef void (*GstSpectrumInputData)(const guint8 * in, gfloat * out,
 
 struct _GstSpectrumChannel
 {
-  gfloat *input;
-  gfloat *input_tmp;
-  GstFFTF32Complex *freqdata;
+  gfloat *input;                /* ringbuffer, points into GstSpectrum:input */
   gfloat *spect_magnitude;      /* accumulated mangitude and phase */
   gfloat *spect_phase;          /* will be scaled by num_fft before sending */
-  GstFFTF32 *fft_ctx;
 };
 
 struct _GstSpectrum
@@ -64,6 +61,10 @@ struct _GstSpectrum
   guint bands;                  /* number of spectrum bands */
   gint threshold;               /* energy level treshold */
   gboolean multi_channel;       /* send separate channel results */
+  guint hop_size;               /* frames between FFTs, 0 = no overlap */
+  guint output_bands;           /* number of bands in the messages */
+  gint band_scale;              /* how bands are aggregated */
+  gboolean packed_messages;     /* post GBytes instead of value lists */
 
   guint64 num_frames;           /* frame count (1 sample per channel)
                                  * since last emit */
@@ -74,6 +75,21 @@ struct _GstSpectrum
   GstSpectrumChannel *channel_data;
   guint num_channels;
 
+  /* shared by all channels, the per channel data points into these */
+  GstFFTF32 *fft_ctx;
+  gfloat *window;
+  gfloat *input;
+  gfloat *input_tmp;
+  GstFFTF32Complex *freqdata;
+  gfloat *spect_magnitude;
+  gfloat *spect_phase;
+
+  /* aggregated bands, only if num_output_bands < bands */
+  guint num_output_bands;
+  guint *band_edges;
+  gfloat *output_magnitude;
+  gfloat *output_phase;
+
   guint input_pos;
   guint64 error_per_interval;
   guint64 accumulated_error;
@@ -43,6 +43,11 @@
 #include <netinet/in.h>
 #endif
 
+#ifdef SO_TXTIME
+#include <time.h>
+#include <linux/net_tstamp.h>
+#endif
+
 #include "gst/glib-compat-private.h"
 
 GST_DEBUG_CATEGORY_STATIC (multiudpsink_debug);
@@ -90,6 +95,9 @@ enum
 #define DEFAULT_BUFFER_SIZE        0
 #define DEFAULT_BIND_ADDRESS       NULL
 #define DEFAULT_BIND_PORT          0
+#define DEFAULT_PACING             GST_MULTIUDPSINK_PACING_NONE
+#define DEFAULT_PACING_RATE        0
+#define DEFAULT_PACING_BURST       (10 * 1500)
 
 enum
 {
@@ -112,9 +120,111 @@ enum
   PROP_SEND_DUPLICATES,
   PROP_BUFFER_SIZE,
   PROP_BIND_ADDRESS,
-  PROP_BIND_PORT
+  PROP_BIND_PORT,
+  PROP_PACING,
+  PROP_PACING_RATE,
+  PROP_PACING_BURST,
+  PROP_PACING_STATS
 };
 
+#define GST_TYPE_MULTIUDPSINK_PACING (gst_multiudpsink_pacing_get_type())
+static GType
+gst_multiudpsink_pacing_get_type (void)
+{
+  static GType pacing_type = 0;
+  static const GEnumValue pacing_types[] = {
+    {GST_MULTIUDPSINK_PACING_NONE, "No pacing", "none"},
+    {GST_MULTIUDPSINK_PACING_TIMER, "Wait between bursts", "timer"},
+    {GST_MULTIUDPSINK_PACING_TXTIME, "Kernel send time (SO_TXTIME)",
+        "txtime"},
+    {0, NULL, NULL},
+  };
+
+  if (!pacing_type) {
+    pacing_type = g_enum_register_static ("GstMultiUDPSinkPacing",
+        pacing_types);
+  }
+  return pacing_type;
+}
+
+/* Control message with the time at which the kernel should send a packet */
+#ifdef SO_TXTIME
+static GType gst_txtime_message_get_type (void);
+
+#define GST_TYPE_TXTIME_MESSAGE         (gst_txtime_message_get_type ())
+#define GST_TXTIME_MESSAGE(o)           (G_TYPE_CHECK_INSTANCE_CAST ((o), GST_TYPE_TXTIME_MESSAGE, GstTxtimeMessage))
+
+typedef struct _GstTxtimeMessage GstTxtimeMessage;
+typedef struct _GstTxtimeMessageClass GstTxtimeMessageClass;
+
+struct _GstTxtimeMessageClass
+{
+  GSocketControlMessageClass parent_class;
+
+};
+
+struct _GstTxtimeMessage
+{
+  GSocketControlMessage parent;
+
+  /* in nanoseconds of CLOCK_MONOTONIC */
+  guint64 time;
+};
+
+G_DEFINE_TYPE (GstTxtimeMessage, gst_txtime_message,
+    G_TYPE_SOCKET_CONTROL_MESSAGE);
+
+static gsize
+gst_txtime_message_get_size (GSocketControlMessage * message)
+{
+  return sizeof (guint64);
+}
+
+static int
+gst_txtime_message_get_level (GSocketControlMessage * message)
+{
+  return SOL_SOCKET;
+}
+
+static int
+gst_txtime_message_get_msg_type (GSocketControlMessage * message)
+{
+  return SCM_TXTIME;
+}
+
+static void
+gst_txtime_message_serialize (GSocketControlMessage * message, gpointer data)
+{
+  memcpy (data, &GST_TXTIME_MESSAGE (message)->time, sizeof (guint64));
+}
+
+static GSocketControlMessage *
+gst_txtime_message_deserialize (gint level, gint type, gsize size,
+    gpointer data)
+{
+  /* only sent */
+  return NULL;
+}
+
+static void
+gst_txtime_message_init (GstTxtimeMessage * message)
+{
+}
+
+static void
+gst_txtime_message_class_init (GstTxtimeMessageClass * class)
+{
+  GSocketControlMessageClass *scm_class;
+
+  scm_class = G_SOCKET_CONTROL_MESSAGE_CLASS (class);
+  scm_class->get_size = gst_txtime_message_get_size;
+  scm_class->get_level = gst_txtime_message_get_level;
+  scm_class->get_type = gst_txtime_message_get_msg_type;
+  scm_class->serialize = gst_txtime_message_serialize;
+  scm_class->deserialize = gst_txtime_message_deserialize;
+}
+#endif
+
 static void gst_multiudpsink_finalize (GObject * object);
 
 static GstFlowReturn gst_multiudpsink_render (GstBaseSink * sink,
@@ -350,6 +460,68 @@ gst_multiudpsink_class_init (GstMultiUDPSinkClass * klass)
           "Port to bind the socket to", 0, G_MAXUINT16,
           DEFAULT_BIND_PORT, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
+  /**
+   * GstMultiUDPSink::pacing:
+   *
+   * Spread the packets over time with a token bucket instead of sending them
+   * in one burst. With the timer, the streaming thread waits between bursts
+   * of up to #GstMultiUDPSink:pacing-burst bytes. With txtime, all packets
+   * are handed to the kernel at once with the time they should go out, this
+   * needs a kernel with SO_TXTIME and the fq or etf queueing discipline on
+   * the interface.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_PACING,
+      g_param_spec_enum ("pacing", "Pacing",
+          "How to pace the packets", GST_TYPE_MULTIUDPSINK_PACING,
+          DEFAULT_PACING, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiUDPSink::pacing-rate:
+   *
+   * The rate in bits per second to pace the packets to, for all clients
+   * together. When 0, the packets of a frame, the buffers with the same
+   * timestamp, are spread over three quarters of the frame interval.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_PACING_RATE,
+      g_param_spec_uint64 ("pacing-rate", "Pacing Rate",
+          "Rate in bits per second to pace to (0 = from the frame interval)",
+          0, G_MAXUINT64, DEFAULT_PACING_RATE,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiUDPSink::pacing-burst:
+   *
+   * The size in bytes of the token bucket, the number of bytes that can be
+   * sent back to back.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_PACING_BURST,
+      g_param_spec_uint ("pacing-burst", "Pacing Burst",
+          "Maximum number of bytes to send back to back when pacing",
+          1, G_MAXUINT, DEFAULT_PACING_BURST,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
+  /**
+   * GstMultiUDPSink::pacing-stats:
+   *
+   * Statistics of the pacing: the achieved rate in bits per second over the
+   * last second ("rate"), the size in bytes of the last burst
+   * ("burst-bytes"), the largest burst in bytes and packets
+   * ("max-burst-bytes" and "max-burst-packets") and whether the kernel paces
+   * the packets ("txtime").
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_PACING_STATS,
+      g_param_spec_boxed ("pacing-stats", "Pacing Statistics",
+          "Statistics of the pacing", GST_TYPE_STRUCTURE,
+          G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+
   gst_element_class_add_static_pad_template (gstelement_class, &sink_template);
 
   gst_element_class_set_static_metadata (gstelement_class, "UDP packet sender",
@@ -418,6 +590,14 @@ gst_multiudpsink_init (GstMultiUDPSink * sink)
   sink->qos_dscp = DEFAULT_QOS_DSCP;
   sink->send_duplicates = DEFAULT_SEND_DUPLICATES;
   sink->multi_iface = g_strdup (DEFAULT_MULTICAST_IFACE);
+  sink->pacing = DEFAULT_PACING;
+  sink->pacing_rate = DEFAULT_PACING_RATE;
+  sink->pacing_burst = DEFAULT_PACING_BURST;
+  /* a monotonic clock of our own, the kernel uses CLOCK_MONOTONIC for the
+   * send times too */
+  sink->pacing_clock = g_object_new (GST_TYPE_SYSTEM_CLOCK, "clock-type",
+      GST_CLOCK_TYPE_MONOTONIC, NULL);
+  gst_object_ref_sink (sink->pacing_clock);
 
   gst_multiudpsink_create_cancellable (sink);
 
@@ -520,6 +700,7 @@ static void
 gst_multiudpsink_finalize (GObject * object)
 {
   GstMultiUDPSink *sink;
+  guint i;
 
   sink = GST_MULTIUDPSINK (object);
 
@@ -554,6 +735,15 @@ gst_multiudpsink_finalize (GObject * object)
   g_free (sink->messages);
   sink->messages = NULL;
 
+  for (i = 0; i < sink->n_txtimes; i++)
+    g_object_unref (sink->txtimes[i]);
+  g_free (sink->txtimes);
+  sink->txtimes = NULL;
+
+  if (sink->pacing_clock)
+    gst_object_unref (sink->pacing_clock);
+  sink->pacing_clock = NULL;
+
   g_free (sink->bind_address);
   sink->bind_address = NULL;
 
@@ -741,6 +931,185 @@ gst_multiudpsink_send_messages (GstMultiUDPSink * sink, GSocket * socket,
   return TRUE;
 }
 
+/* wait until @time on the pacing clock, returns FALSE when unlocked */
+static gboolean
+gst_multiudpsink_pacing_wait (GstMultiUDPSink * sink, GstClockTime time)
+{
+  GstClockID id;
+  GstClockReturn ret;
+
+  GST_OBJECT_LOCK (sink);
+  if (g_cancellable_is_cancelled (sink->cancellable)) {
+    GST_OBJECT_UNLOCK (sink);
+    return FALSE;
+  }
+  id = sink->pacing_id = gst_clock_new_single_shot_id (sink->pacing_clock,
+      time);
+  GST_OBJECT_UNLOCK (sink);
+
+  ret = gst_clock_id_wait (id, NULL);
+
+  GST_OBJECT_LOCK (sink);
+  sink->pacing_id = NULL;
+  GST_OBJECT_UNLOCK (sink);
+  gst_clock_id_unref (id);
+
+  return ret != GST_CLOCK_UNSCHEDULED;
+}
+
+static void
+gst_multiudpsink_pacing_update_stats (GstMultiUDPSink * sink,
+    GstClockTime time, gsize bytes, guint packets)
+{
+  GST_OBJECT_LOCK (sink);
+  sink->last_burst_bytes = bytes;
+  sink->max_burst_bytes = MAX (sink->max_burst_bytes, bytes);
+  sink->max_burst_packets = MAX (sink->max_burst_packets, packets);
+
+  if (!GST_CLOCK_TIME_IS_VALID (sink->stats_start))
+    sink->stats_start = time;
+  sink->stats_bytes += bytes;
+  if (time >= sink->stats_start + GST_SECOND) {
+    sink->achieved_rate = gst_util_uint64_scale (sink->stats_bytes, 8 *
+        GST_SECOND, time - sink->stats_start);
+    sink->stats_start = time;
+    sink->stats_bytes = 0;
+  }
+  GST_OBJECT_UNLOCK (sink);
+}
+
+static GstStructure *
+gst_multiudpsink_get_pacing_stats (GstMultiUDPSink * sink)
+{
+  GstStructure *result;
+
+  GST_OBJECT_LOCK (sink);
+  result = gst_structure_new ("multiudpsink-pacing-stats",
+      "rate", G_TYPE_UINT64, sink->achieved_rate,
+      "burst-bytes", G_TYPE_UINT, sink->last_burst_bytes,
+      "max-burst-bytes", G_TYPE_UINT, sink->max_burst_bytes,
+      "max-burst-packets", G_TYPE_UINT, sink->max_burst_packets,
+      "txtime", G_TYPE_BOOLEAN, sink->use_txtime, NULL);
+  GST_OBJECT_UNLOCK (sink);
+
+  return result;
+}
+
+/* update the rate to pace to for @buffer, @bytes are sent for it to all the
+ * clients */
+static void
+gst_multiudpsink_pacing_update_rate (GstMultiUDPSink * sink,
+    GstBuffer * buffer, guint64 bytes)
+{
+  GstClockTime pts;
+
+  if (sink->pacing_rate > 0) {
+    sink->pacing_byte_rate = sink->pacing_rate / 8;
+    return;
+  }
+
+  pts = GST_BUFFER_PTS (buffer);
+  if (!GST_CLOCK_TIME_IS_VALID (pts))
+    pts = GST_BUFFER_DTS (buffer);
+  if (!GST_CLOCK_TIME_IS_VALID (pts)) {
+    sink->pacing_byte_rate = 0;
+    return;
+  }
+
+  if (pts != sink->pacing_pts) {
+    /* a new frame, ignore gaps and jumps back */
+    if (GST_CLOCK_TIME_IS_VALID (sink->pacing_pts) && pts > sink->pacing_pts
+        && pts - sink->pacing_pts <= GST_SECOND)
+      sink->pacing_interval = pts - sink->pacing_pts;
+    sink->pacing_pts = pts;
+    sink->prev_frame_bytes = sink->frame_bytes;
+    sink->frame_bytes = 0;
+  }
+  sink->frame_bytes += bytes;
+
+  /* the rest of the frame can still come, assume that it is as large as the
+   * previous one. A quarter of the interval is left so that the delay does
+   * not build up when the frames are not evenly spaced. */
+  if (GST_CLOCK_TIME_IS_VALID (sink->pacing_interval))
+    sink->pacing_byte_rate = gst_util_uint64_scale (MAX (sink->frame_bytes,
+            sink->prev_frame_bytes), GST_SECOND, sink->pacing_interval * 3 / 4);
+  else
+    sink->pacing_byte_rate = 0;
+}
+
+/* Send @messages through the token bucket. It is implemented as a GCRA: a
+ * packet can go when its theoretical arrival time, the time at which it would
+ * go at the pacing rate, is at most the time to send a full bucket ahead.
+ * Returns FALSE if we got cancelled. */
+static gboolean
+gst_multiudpsink_send_messages_paced (GstMultiUDPSink * sink,
+    GSocket * socket, GstOutputMessage * messages, guint num_messages)
+{
+  guint64 rate = sink->pacing_byte_rate;
+  GstClockTime now, tau;
+  guint start, i;
+
+  if (sink->pacing == GST_MULTIUDPSINK_PACING_NONE || rate == 0)
+    return gst_multiudpsink_send_messages (sink, socket, messages,
+        num_messages);
+
+  tau = gst_util_uint64_scale (sink->pacing_burst, GST_SECOND, rate);
+  now = gst_clock_get_time (sink->pacing_clock);
+  /* idle, the bucket is full */
+  if (!GST_CLOCK_TIME_IS_VALID (sink->pacing_tat) || sink->pacing_tat < now)
+    sink->pacing_tat = now;
+
+  for (start = 0; start < num_messages; start = i) {
+    GstClockTime departure;
+    gsize bytes = 0;
+
+    departure = sink->pacing_tat > now + tau ? sink->pacing_tat - tau : now;
+
+    /* all the packets that can go at the same time form a burst */
+    for (i = start; i < num_messages; i++) {
+      gsize size;
+
+      if (i > start && sink->pacing_tat > departure + tau)
+        break;
+
+      size = gst_udp_calc_message_size (&messages[i]);
+      sink->pacing_tat += gst_util_uint64_scale (size, GST_SECOND, rate);
+      bytes += size;
+
+#ifdef SO_TXTIME
+      if (sink->use_txtime) {
+        GST_TXTIME_MESSAGE (sink->txtimes[i])->time = departure;
+        messages[i].control_messages = &sink->txtimes[i];
+        messages[i].num_control_messages = 1;
+      }
+#endif
+    }
+
+    GST_LOG_OBJECT (sink, "burst of %u packets, %" G_GSIZE_FORMAT " bytes at %"
+        GST_TIME_FORMAT, i - start, bytes, GST_TIME_ARGS (departure));
+    gst_multiudpsink_pacing_update_stats (sink, departure, bytes, i - start);
+
+    if (sink->use_txtime)
+      continue;
+
+    if (departure > now && !gst_multiudpsink_pacing_wait (sink, departure))
+      return FALSE;
+
+    if (!gst_multiudpsink_send_messages (sink, socket, messages + start,
+            i - start))
+      return FALSE;
+
+    now = gst_clock_get_time (sink->pacing_clock);
+  }
+
+  /* the kernel sends each packet at its time */
+  if (sink->use_txtime)
+    return gst_multiudpsink_send_messages (sink, socket, messages,
+        num_messages);
+
+  return TRUE;
+}
+
 static GstFlowReturn
 gst_multiudpsink_render_buffers (GstMultiUDPSink * sink, GstBuffer ** buffers,
     guint num_buffers, guint8 * mem_nums, guint total_mem_num)
@@ -827,6 +1196,20 @@ gst_multiudpsink_render_buffers (GstMultiUDPSink * sink, GstBuffer ** buffers,
   /* FIXME: how about some locking? (there wasn't any before either, but..) */
   sink->bytes_to_serve += size;
 
+  if (sink->pacing != GST_MULTIUDPSINK_PACING_NONE) {
+    gst_multiudpsink_pacing_update_rate (sink, buffers[0], size * num_addr);
+
+#ifdef SO_TXTIME
+    if (sink->use_txtime && sink->n_txtimes < num_msgs) {
+      sink->txtimes = g_renew (GSocketControlMessage *, sink->txtimes,
+          sink->n_messages);
+      for (i = sink->n_txtimes; i < sink->n_messages; i++)
+        sink->txtimes[i] = g_object_new (GST_TYPE_TXTIME_MESSAGE, NULL);
+      sink->n_txtimes = sink->n_messages;
+    }
+#endif
+  }
+
   /* now copy the pre-filled num_buffer messages over to the next num_buffer
    * messages for the next client, where we also change the target adddress */
   for (i = 1; i < num_addr; ++i) {
@@ -842,20 +1225,20 @@ gst_multiudpsink_render_buffers (GstMultiUDPSink * sink, GstBuffer ** buffers,
 
     /* no IPv4 socket? Send it all from the IPv6 socket then.. */
     if (sink->used_socket == NULL) {
-      ret = gst_multiudpsink_send_messages (sink, sink->used_socket_v6,
+      ret = gst_multiudpsink_send_messages_paced (sink, sink->used_socket_v6,
           msgs, num_msgs);
     } else {
       guint num_msgs_v4 = num_buffers * num_addr_v4;
       guint num_msgs_v6 = num_buffers * num_addr_v6;
 
       /* our client list is sorted with IPv4 clients first and IPv6 ones last */
-      ret = gst_multiudpsink_send_messages (sink, sink->used_socket,
+      ret = gst_multiudpsink_send_messages_paced (sink, sink->used_socket,
           msgs, num_msgs_v4);
 
       if (!ret)
         goto cancelled;
 
-      ret = gst_multiudpsink_send_messages (sink, sink->used_socket_v6,
+      ret = gst_multiudpsink_send_messages_paced (sink, sink->used_socket_v6,
           msgs + num_msgs_v4, num_msgs_v6);
     }
 
@@ -1060,6 +1443,57 @@ gst_multiudpsink_setup_qos_dscp (GstMultiUDPSink * sink, GSocket * socket)
 #endif
 }
 
+static gboolean
+gst_multiudpsink_setup_txtime (GstMultiUDPSink * sink, GSocket * socket)
+{
+#ifdef SO_TXTIME
+  struct sock_txtime config = { CLOCK_MONOTONIC, 0 };
+
+  if (socket == NULL)
+    return TRUE;
+
+  if (setsockopt (g_socket_get_fd (socket), SOL_SOCKET, SO_TXTIME, &config,
+          sizeof (config)) < 0) {
+    GST_WARNING_OBJECT (sink, "setsockopt SO_TXTIME failed: %s",
+        strerror (errno));
+    return FALSE;
+  }
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+static void
+gst_multiudpsink_setup_pacing (GstMultiUDPSink * sink)
+{
+  gboolean use_txtime = FALSE;
+
+  if (sink->pacing == GST_MULTIUDPSINK_PACING_TXTIME) {
+    use_txtime = gst_multiudpsink_setup_txtime (sink, sink->used_socket) &&
+        gst_multiudpsink_setup_txtime (sink, sink->used_socket_v6);
+    if (!use_txtime)
+      GST_WARNING_OBJECT (sink, "kernel pacing not supported, using a timer");
+  }
+
+  sink->pacing_byte_rate = 0;
+  sink->pacing_tat = GST_CLOCK_TIME_NONE;
+  sink->pacing_pts = GST_CLOCK_TIME_NONE;
+  sink->pacing_interval = GST_CLOCK_TIME_NONE;
+  sink->frame_bytes = 0;
+  sink->prev_frame_bytes = 0;
+
+  GST_OBJECT_LOCK (sink);
+  sink->use_txtime = use_txtime;
+  sink->stats_start = GST_CLOCK_TIME_NONE;
+  sink->stats_bytes = 0;
+  sink->achieved_rate = 0;
+  sink->last_burst_bytes = 0;
+  sink->max_burst_bytes = 0;
+  sink->max_burst_packets = 0;
+  GST_OBJECT_UNLOCK (sink);
+}
+
 static void
 gst_multiudpsink_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
@@ -1149,6 +1583,15 @@ gst_multiudpsink_set_property (GObject * object, guint prop_id,
     case PROP_BIND_PORT:
       udpsink->bind_port = g_value_get_int (value);
       break;
+    case PROP_PACING:
+      udpsink->pacing = g_value_get_enum (value);
+      break;
+    case PROP_PACING_RATE:
+      udpsink->pacing_rate = g_value_get_uint64 (value);
+      break;
+    case PROP_PACING_BURST:
+      udpsink->pacing_burst = g_value_get_uint (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1222,6 +1665,19 @@ gst_multiudpsink_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_BIND_PORT:
       g_value_set_int (value, udpsink->bind_port);
       break;
+    case PROP_PACING:
+      g_value_set_enum (value, udpsink->pacing);
+      break;
+    case PROP_PACING_RATE:
+      g_value_set_uint64 (value, udpsink->pacing_rate);
+      break;
+    case PROP_PACING_BURST:
+      g_value_set_uint (value, udpsink->pacing_burst);
+      break;
+    case PROP_PACING_STATS:
+      g_value_take_boxed (value,
+          gst_multiudpsink_get_pacing_stats (udpsink));
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -1487,6 +1943,8 @@ gst_multiudpsink_start (GstBaseSink * bsink)
   gst_multiudpsink_setup_qos_dscp (sink, sink->used_socket);
   gst_multiudpsink_setup_qos_dscp (sink, sink->used_socket_v6);
 
+  gst_multiudpsink_setup_pacing (sink);
+
   /* look for multicast clients and join multicast groups appropriately
      set also ttl and multicast loopback delivery appropriately  */
   for (clients = sink->clients; clients; clients = g_list_next (clients)) {
@@ -1854,6 +2312,11 @@ gst_multiudpsink_unlock (GstBaseSink * bsink)
 
   g_cancellable_cancel (sink->cancellable);
 
+  GST_OBJECT_LOCK (sink);
+  if (sink->pacing_id)
+    gst_clock_id_unschedule (sink->pacing_id);
+  GST_OBJECT_UNLOCK (sink);
+
   return TRUE;
 }
 
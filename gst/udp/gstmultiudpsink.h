@@ -60,6 +60,21 @@ typedef struct {
 typedef GOutputMessage GstOutputMessage;
 #endif /* HAVE_G_SOCKET_SEND_MESSAGES*/
 
+/**
+ * GstMultiUDPSinkPacing:
+ * @GST_MULTIUDPSINK_PACING_NONE: send packets as fast as possible
+ * @GST_MULTIUDPSINK_PACING_TIMER: wait between bursts of packets
+ * @GST_MULTIUDPSINK_PACING_TXTIME: give the kernel the send time of each
+ *   packet with SO_TXTIME, falls back to the timer when not supported
+ *
+ * How packets are paced.
+ */
+typedef enum {
+  GST_MULTIUDPSINK_PACING_NONE,
+  GST_MULTIUDPSINK_PACING_TIMER,
+  GST_MULTIUDPSINK_PACING_TXTIME
+} GstMultiUDPSinkPacing;
+
 typedef struct {
   gint ref_count;         /* for memory management */
   gint add_count;         /* how often this address has been added */
@@ -102,6 +117,27 @@ struct _GstMultiUDPSink {
   GstOutputMessage *messages;
   guint             n_messages;
 
+  /* pacing, a token bucket */
+  GstClock         *pacing_clock;
+  GstClockID        pacing_id;
+  gboolean          use_txtime;
+  GSocketControlMessage **txtimes;
+  guint             n_txtimes;
+  guint64           pacing_byte_rate;
+  GstClockTime      pacing_tat;
+  GstClockTime      pacing_pts;
+  GstClockTime      pacing_interval;
+  guint64           frame_bytes;
+  guint64           prev_frame_bytes;
+
+  /* pacing stats */
+  GstClockTime      stats_start;
+  guint64           stats_bytes;
+  guint64           achieved_rate;
+  guint             last_burst_bytes;
+  guint             max_burst_bytes;
+  guint             max_burst_packets;
+
   /* properties */
   guint64        bytes_to_serve;
   guint64        bytes_served;
@@ -122,6 +158,9 @@ struct _GstMultiUDPSink {
   gint           buffer_size;
   gchar         *bind_address;
   gint           bind_port;
+  GstMultiUDPSinkPacing pacing;
+  guint64        pacing_rate;
+  guint          pacing_burst;
 };
 
 struct _GstMultiUDPSinkClass {
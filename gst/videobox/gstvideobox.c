@@ -2371,6 +2371,7 @@ copy_yuy2_yuy2 (guint i_alpha, GstVideoFrame * dest_frame,
 #define DEFAULT_FILL_TYPE VIDEO_BOX_FILL_BLACK
 #define DEFAULT_ALPHA     1.0
 #define DEFAULT_BORDER_ALPHA 1.0
+#define DEFAULT_REUSE_BORDERS FALSE
 
 enum
 {
@@ -2382,7 +2383,8 @@ enum
   PROP_FILL_TYPE,
   PROP_ALPHA,
   PROP_BORDER_ALPHA,
-  PROP_AUTOCROP
+  PROP_AUTOCROP,
+  PROP_REUSE_BORDERS
       /* FILL ME */
 };
 
@@ -2426,6 +2428,14 @@ static gboolean gst_video_box_set_info (GstVideoFilter * vfilter, GstCaps * in,
     GstVideoInfo * in_info, GstCaps * out, GstVideoInfo * out_info);
 static GstFlowReturn gst_video_box_transform_frame (GstVideoFilter * vfilter,
     GstVideoFrame * in_frame, GstVideoFrame * out_frame);
+static gboolean gst_video_box_decide_allocation (GstBaseTransform * trans,
+    GstQuery * query);
+static GstFlowReturn gst_video_box_prepare_output_buffer (GstBaseTransform *
+    trans, GstBuffer * input, GstBuffer ** outbuf);
+static GstFlowReturn gst_video_box_transform (GstBaseTransform * trans,
+    GstBuffer * inbuf, GstBuffer * outbuf);
+
+static GQuark border_cookie_quark;
 
 #define GST_TYPE_VIDEO_BOX_FILL (gst_video_box_fill_get_type())
 static GType
@@ -2512,12 +2522,31 @@ gst_video_box_class_init (GstVideoBoxClass * klass)
   g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_AUTOCROP,
       g_param_spec_boolean ("autocrop", "Auto crop",
           "Auto crop", FALSE, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+  /**
+   * GstVideoBox:reuse-borders:
+   *
+   * If set to %TRUE videobox only paints the borders once into every output
+   * buffer of the pool and afterwards only rewrites the inner picture when
+   * the buffer is reused. Only enable this if no downstream element modifies
+   * the buffers in place.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (G_OBJECT_CLASS (klass), PROP_REUSE_BORDERS,
+      g_param_spec_boolean ("reuse-borders", "Reuse borders",
+          "Only paint the borders once into each pooled output buffer",
+          DEFAULT_REUSE_BORDERS, G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
 
   trans_class->before_transform =
       GST_DEBUG_FUNCPTR (gst_video_box_before_transform);
   trans_class->transform_caps =
       GST_DEBUG_FUNCPTR (gst_video_box_transform_caps);
   trans_class->src_event = GST_DEBUG_FUNCPTR (gst_video_box_src_event);
+  trans_class->decide_allocation =
+      GST_DEBUG_FUNCPTR (gst_video_box_decide_allocation);
+  trans_class->prepare_output_buffer =
+      GST_DEBUG_FUNCPTR (gst_video_box_prepare_output_buffer);
+  trans_class->transform = GST_DEBUG_FUNCPTR (gst_video_box_transform);
 
   vfilter_class->set_info = GST_DEBUG_FUNCPTR (gst_video_box_set_info);
   vfilter_class->transform_frame =
@@ -2532,6 +2561,8 @@ gst_video_box_class_init (GstVideoBoxClass * klass)
       &gst_video_box_sink_template);
   gst_element_class_add_static_pad_template (element_class,
       &gst_video_box_src_template);
+
+  border_cookie_quark = g_quark_from_static_string ("GstVideoBoxBorders");
 }
 
 static void
@@ -2549,6 +2580,8 @@ gst_video_box_init (GstVideoBox * video_box)
   video_box->alpha = DEFAULT_ALPHA;
   video_box->border_alpha = DEFAULT_BORDER_ALPHA;
   video_box->autocrop = FALSE;
+  video_box->reuse_borders = DEFAULT_REUSE_BORDERS;
+  video_box->border_cookie = gst_util_seqnum_next ();
 
   g_mutex_init (&video_box->mutex);
 }
@@ -2558,8 +2591,18 @@ gst_video_box_set_property (GObject * object, guint prop_id,
     const GValue * value, GParamSpec * pspec)
 {
   GstVideoBox *video_box = GST_VIDEO_BOX (object);
+  gint old_box_left, old_box_right, old_box_top, old_box_bottom;
+  GstVideoBoxFill old_fill_type;
+  gdouble old_border_alpha;
 
   g_mutex_lock (&video_box->mutex);
+  old_box_left = video_box->box_left;
+  old_box_right = video_box->box_right;
+  old_box_top = video_box->box_top;
+  old_box_bottom = video_box->box_bottom;
+  old_fill_type = video_box->fill_type;
+  old_border_alpha = video_box->border_alpha;
+
   switch (prop_id) {
     case PROP_LEFT:
       video_box->box_left = g_value_get_int (value);
@@ -2613,10 +2656,23 @@ gst_video_box_set_property (GObject * object, guint prop_id,
     case PROP_AUTOCROP:
       video_box->autocrop = g_value_get_boolean (value);
       break;
+    case PROP_REUSE_BORDERS:
+      video_box->reuse_borders = g_value_get_boolean (value);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
   }
+  if (prop_id != PROP_ALPHA && prop_id != PROP_REUSE_BORDERS &&
+      (video_box->box_left != old_box_left
+          || video_box->box_right != old_box_right
+          || video_box->box_top != old_box_top
+          || video_box->box_bottom != old_box_bottom
+          || video_box->fill_type != old_fill_type
+          || video_box->border_alpha != old_border_alpha
+          || prop_id == PROP_AUTOCROP))
+    video_box->border_cookie = gst_util_seqnum_next ();
+
   gst_video_box_recalc_transform (video_box);
 
   GST_DEBUG_OBJECT (video_box, "Calling reconfigure");
@@ -2711,6 +2767,9 @@ gst_video_box_get_property (GObject * object, guint prop_id, GValue * value,
     case PROP_AUTOCROP:
       g_value_set_boolean (value, video_box->autocrop);
       break;
+    case PROP_REUSE_BORDERS:
+      g_value_set_boolean (value, video_box->reuse_borders);
+      break;
     default:
       G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
       break;
@@ -3167,6 +3226,8 @@ gst_video_box_set_info (GstVideoFilter * vfilter, GstCaps * in,
   if (video_box->autocrop)
     gst_video_box_autocrop (video_box);
 
+  video_box->border_cookie = gst_util_seqnum_next ();
+
   /* recalc the transformation strategy */
   ret = gst_video_box_recalc_transform (video_box);
 
@@ -3223,6 +3284,30 @@ gst_video_box_src_event (GstBaseTransform * trans, GstEvent * event)
   return GST_BASE_TRANSFORM_CLASS (parent_class)->src_event (trans, event);
 }
 
+/* Returns TRUE if the borders of the current configuration were already
+ * painted into the memory of @out by a previous call, and marks the memory
+ * as painted otherwise. */
+static gboolean
+gst_video_box_borders_valid (GstVideoBox * video_box, GstVideoFrame * out)
+{
+  GstMemory *mem;
+  guint32 cookie;
+
+  if (!video_box->reuse_borders || gst_buffer_n_memory (out->buffer) != 1)
+    return FALSE;
+
+  mem = gst_buffer_peek_memory (out->buffer, 0);
+  cookie = GPOINTER_TO_UINT (gst_mini_object_get_qdata (GST_MINI_OBJECT_CAST
+          (mem), border_cookie_quark));
+  if (cookie == video_box->border_cookie)
+    return TRUE;
+
+  gst_mini_object_set_qdata (GST_MINI_OBJECT_CAST (mem), border_cookie_quark,
+      GUINT_TO_POINTER (video_box->border_cookie), NULL);
+
+  return FALSE;
+}
+
 static void
 gst_video_box_process (GstVideoBox * video_box, GstVideoFrame * in,
     GstVideoFrame * out)
@@ -3266,7 +3351,8 @@ gst_video_box_process (GstVideoBox * video_box, GstVideoFrame * in,
       i_alpha, b_alpha);
 
   if (crop_h < 0 || crop_w < 0) {
-    video_box->fill (fill_type, b_alpha, out, video_box->out_sdtv);
+    if (!gst_video_box_borders_valid (video_box, out))
+      video_box->fill (fill_type, b_alpha, out, video_box->out_sdtv);
   } else if (bb == 0 && bt == 0 && br == 0 && bl == 0) {
     video_box->copy (i_alpha, out, video_box->out_sdtv, 0, 0, in,
         video_box->in_sdtv, 0, 0, crop_w, crop_h);
@@ -3275,7 +3361,8 @@ gst_video_box_process (GstVideoBox * video_box, GstVideoFrame * in,
     gint dest_x = 0, dest_y = 0;
 
     /* Fill everything if a border should be added somewhere */
-    if (bt < 0 || bb < 0 || br < 0 || bl < 0)
+    if ((bt < 0 || bb < 0 || br < 0 || bl < 0)
+        && !gst_video_box_borders_valid (video_box, out))
       video_box->fill (fill_type, b_alpha, out, video_box->out_sdtv);
 
     /* Top border */
@@ -3300,6 +3387,178 @@ gst_video_box_process (GstVideoBox * video_box, GstVideoFrame * in,
   GST_LOG_OBJECT (video_box, "image created");
 }
 
+static gboolean
+gst_video_box_decide_allocation (GstBaseTransform * trans, GstQuery * query)
+{
+  GstVideoBox *video_box = GST_VIDEO_BOX (trans);
+
+  g_mutex_lock (&video_box->mutex);
+  video_box->use_video_meta =
+      gst_query_find_allocation_meta (query, GST_VIDEO_META_API_TYPE, NULL);
+  video_box->use_crop_meta = video_box->use_video_meta
+      && gst_query_find_allocation_meta (query, GST_VIDEO_CROP_META_API_TYPE,
+      NULL);
+  GST_DEBUG_OBJECT (video_box, "downstream video meta: %d, crop meta: %d",
+      video_box->use_video_meta, video_box->use_crop_meta);
+  g_mutex_unlock (&video_box->mutex);
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->decide_allocation (trans,
+      query);
+}
+
+/* Pure cropping without any conversion, the output can reference the
+ * input memory */
+static gboolean
+gst_video_box_is_pure_crop (GstVideoBox * video_box)
+{
+  return video_box->in_format == video_box->out_format &&
+      video_box->in_sdtv == video_box->out_sdtv &&
+      video_box->box_left >= 0 && video_box->box_right >= 0 &&
+      video_box->box_top >= 0 && video_box->box_bottom >= 0 &&
+      (video_box->alpha == 1.0 ||
+      !GST_VIDEO_FORMAT_INFO_HAS_ALPHA (GST_VIDEO_FILTER (video_box)->
+          in_info.finfo));
+}
+
+/* Can the crop offsets be expressed as plane offsets, i.e. are they
+ * aligned to the chroma subsampling of the format */
+static gboolean
+gst_video_box_crop_is_aligned (GstVideoBox * video_box)
+{
+  const GstVideoFormatInfo *finfo = GST_VIDEO_FILTER (video_box)->in_info.finfo;
+  guint i;
+
+  for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); i++) {
+    if (video_box->box_left % (1 << GST_VIDEO_FORMAT_INFO_W_SUB (finfo, i)))
+      return FALSE;
+    if (video_box->box_top % (1 << GST_VIDEO_FORMAT_INFO_H_SUB (finfo, i)))
+      return FALSE;
+  }
+
+  return TRUE;
+}
+
+static GstBuffer *
+gst_video_box_crop_zero_copy (GstVideoBox * video_box, GstBuffer * inbuf)
+{
+  GstBaseTransform *trans = GST_BASE_TRANSFORM_CAST (video_box);
+  GstVideoInfo *in_info = &GST_VIDEO_FILTER (video_box)->in_info;
+  GstVideoInfo *out_info = &GST_VIDEO_FILTER (video_box)->out_info;
+  const GstVideoFormatInfo *finfo = in_info->finfo;
+  GstVideoMeta *in_meta;
+  GstVideoFrameFlags flags = GST_VIDEO_FRAME_FLAG_NONE;
+  gsize offset[GST_VIDEO_MAX_PLANES];
+  gint stride[GST_VIDEO_MAX_PLANES];
+  gint n_planes = GST_VIDEO_INFO_N_PLANES (in_info);
+  GstBuffer *outbuf;
+  gboolean aligned;
+  gint i;
+
+  in_meta = gst_buffer_get_video_meta (inbuf);
+  for (i = 0; i < n_planes; i++) {
+    offset[i] = in_meta ? in_meta->offset[i] : in_info->offset[i];
+    stride[i] = in_meta ? in_meta->stride[i] : in_info->stride[i];
+  }
+  if (in_meta)
+    flags = in_meta->flags;
+
+  aligned = gst_video_box_crop_is_aligned (video_box);
+
+  /* Only top/bottom cropping of a single plane with the default layout is
+   * just a region of the input and needs no meta at all */
+  if (aligned && !in_meta && n_planes == 1 && video_box->box_left == 0
+      && video_box->box_right == 0
+      && in_info->offset[0] + video_box->box_top * in_info->stride[0] +
+      out_info->size <= gst_buffer_get_size (inbuf)) {
+    GST_LOG_OBJECT (video_box, "cropping with a sub-buffer");
+    outbuf = gst_buffer_copy_region (inbuf, GST_BUFFER_COPY_MEMORY,
+        in_info->offset[0] + video_box->box_top * in_info->stride[0],
+        out_info->size);
+    GST_BASE_TRANSFORM_GET_CLASS (trans)->copy_metadata (trans, inbuf, outbuf);
+    return outbuf;
+  }
+
+  if (!video_box->use_video_meta || (!aligned && !video_box->use_crop_meta))
+    return NULL;
+
+  outbuf = gst_buffer_copy_region (inbuf, GST_BUFFER_COPY_MEMORY, 0, -1);
+  GST_BASE_TRANSFORM_GET_CLASS (trans)->copy_metadata (trans, inbuf, outbuf);
+
+  if (aligned) {
+    gboolean done[GST_VIDEO_MAX_PLANES] = { FALSE, };
+
+    /* Point the planes at the top left corner of the cropped picture */
+    GST_LOG_OBJECT (video_box, "cropping with video meta plane offsets");
+    for (i = 0; i < GST_VIDEO_FORMAT_INFO_N_COMPONENTS (finfo); i++) {
+      gint plane = GST_VIDEO_FORMAT_INFO_PLANE (finfo, i);
+
+      if (done[plane])
+        continue;
+      done[plane] = TRUE;
+
+      offset[plane] +=
+          GST_VIDEO_FORMAT_INFO_SCALE_HEIGHT (finfo, i,
+          video_box->box_top) * stride[plane] +
+          GST_VIDEO_FORMAT_INFO_SCALE_WIDTH (finfo, i,
+          video_box->box_left) * GST_VIDEO_FORMAT_INFO_PSTRIDE (finfo, i);
+    }
+    gst_buffer_add_video_meta_full (outbuf, flags,
+        GST_VIDEO_INFO_FORMAT (out_info), GST_VIDEO_INFO_WIDTH (out_info),
+        GST_VIDEO_INFO_HEIGHT (out_info), n_planes, offset, stride);
+  } else {
+    GstVideoCropMeta *crop_meta;
+
+    /* Describe the full input frame and let downstream crop it */
+    GST_LOG_OBJECT (video_box, "cropping with crop meta");
+    gst_buffer_add_video_meta_full (outbuf, flags,
+        GST_VIDEO_INFO_FORMAT (in_info), GST_VIDEO_INFO_WIDTH (in_info),
+        GST_VIDEO_INFO_HEIGHT (in_info), n_planes, offset, stride);
+    crop_meta = gst_buffer_add_video_crop_meta (outbuf);
+    crop_meta->x = video_box->box_left;
+    crop_meta->y = video_box->box_top;
+    crop_meta->width = GST_VIDEO_INFO_WIDTH (out_info);
+    crop_meta->height = GST_VIDEO_INFO_HEIGHT (out_info);
+  }
+
+  return outbuf;
+}
+
+static GstFlowReturn
+gst_video_box_prepare_output_buffer (GstBaseTransform * trans,
+    GstBuffer * input, GstBuffer ** outbuf)
+{
+  GstVideoBox *video_box = GST_VIDEO_BOX (trans);
+
+  g_mutex_lock (&video_box->mutex);
+  video_box->zero_copy = FALSE;
+  if (!gst_base_transform_is_passthrough (trans)
+      && gst_video_box_is_pure_crop (video_box)) {
+    *outbuf = gst_video_box_crop_zero_copy (video_box, input);
+    video_box->zero_copy = (*outbuf != NULL);
+  }
+  g_mutex_unlock (&video_box->mutex);
+
+  if (video_box->zero_copy)
+    return GST_FLOW_OK;
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->prepare_output_buffer (trans,
+      input, outbuf);
+}
+
+static GstFlowReturn
+gst_video_box_transform (GstBaseTransform * trans, GstBuffer * inbuf,
+    GstBuffer * outbuf)
+{
+  GstVideoBox *video_box = GST_VIDEO_BOX (trans);
+
+  /* output references the cropped input already */
+  if (video_box->zero_copy)
+    return GST_FLOW_OK;
+
+  return GST_BASE_TRANSFORM_CLASS (parent_class)->transform (trans, inbuf,
+      outbuf);
+}
+
 static void
 gst_video_box_before_transform (GstBaseTransform * trans, GstBuffer * in)
 {
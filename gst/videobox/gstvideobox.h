@@ -77,6 +77,18 @@ struct _GstVideoBox
   GstVideoBoxFill fill_type;
 
   gboolean autocrop;
+  gboolean reuse_borders;
+
+  /* downstream allocation capabilities */
+  gboolean use_video_meta;
+  gboolean use_crop_meta;
+
+  /* current output buffer shares the input memory, nothing to process */
+  gboolean zero_copy;
+
+  /* identifies the current border configuration, stored on output memory
+   * with painted borders */
+  guint32 border_cookie;
 
   void (*fill) (GstVideoBoxFill fill_type, guint b_alpha, GstVideoFrame *dest, gboolean sdtv);
   void (*copy) (guint i_alpha, GstVideoFrame * dest, gboolean dest_sdtv, gint dest_x, gint dest_y, GstVideoFrame * src, gboolean src_sdtv, gint src_x, gint src_y, gint w, gint h);
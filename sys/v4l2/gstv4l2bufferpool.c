@@ -32,6 +32,7 @@
 #include <fcntl.h>
 
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <string.h>
 #include <unistd.h>
 
@@ -68,6 +69,8 @@ enum _GstV4l2BufferPoolAcquireFlags
 
 static void gst_v4l2_buffer_pool_release_buffer (GstBufferPool * bpool,
     GstBuffer * buffer);
+static GstFlowReturn gst_v4l2_buffer_pool_dqbuf (GstV4l2BufferPool * pool,
+    GstBuffer ** buffer);
 
 static gboolean
 gst_v4l2_is_buffer_valid (GstBuffer * buffer, GstV4l2MemoryGroup ** out_group)
@@ -153,6 +156,7 @@ gst_v4l2_buffer_pool_copy_buffer (GstV4l2BufferPool * pool, GstBuffer * dest,
       GST_BUFFER_COPY_FLAGS | GST_BUFFER_COPY_TIMESTAMPS, 0, -1);
 
   GST_CAT_LOG_OBJECT (CAT_PERFORMANCE, pool, "slow copy into buffer %p", dest);
+  g_atomic_int_inc (&pool->num_copies);
 
   return GST_FLOW_OK;
 
@@ -322,6 +326,22 @@ import_failed:
   }
 }
 
+static guint64
+gst_v4l2_buffer_pool_dmabuf_id (GstMemory * mem)
+{
+  struct stat st;
+
+  if (!gst_is_dmabuf_memory (mem))
+    return 0;
+
+  /* all DMABUFs live on the same anonymous filesystem, the inode identifies
+   * the buffer whichever fd refers to it */
+  if (fstat (gst_dmabuf_memory_get_fd (mem), &st) < 0)
+    return 0;
+
+  return st.st_ino;
+}
+
 static GstFlowReturn
 gst_v4l2_buffer_pool_import_dmabuf (GstV4l2BufferPool * pool,
     GstBuffer * dest, GstBuffer * src)
@@ -329,6 +349,7 @@ gst_v4l2_buffer_pool_import_dmabuf (GstV4l2BufferPool * pool,
   GstV4l2MemoryGroup *group = NULL;
   GstMemory *dma_mem[GST_VIDEO_MAX_PLANES] = { 0 };
   guint n_mem = gst_buffer_n_memory (src);
+  guint64 id;
   gint i;
 
   GST_LOG_OBJECT (pool, "importing dmabuf");
@@ -346,6 +367,15 @@ gst_v4l2_buffer_pool_import_dmabuf (GstV4l2BufferPool * pool,
           dma_mem))
     goto import_failed;
 
+  id = gst_v4l2_buffer_pool_dmabuf_id (dma_mem[0]);
+  g_atomic_int_inc (&pool->num_imports);
+  if (id != 0 && pool->import_ids[group->buffer.index] == id)
+    g_atomic_int_inc (&pool->num_import_hits);
+  else
+    GST_CAT_LOG_OBJECT (CAT_PERFORMANCE, pool, "DMABUF imported at new "
+        "index %d", group->buffer.index);
+  pool->import_ids[group->buffer.index] = id;
+
   gst_mini_object_set_qdata (GST_MINI_OBJECT (dest), GST_V4L2_IMPORT_QUARK,
       gst_buffer_ref (src), (GDestroyNotify) gst_buffer_unref);
 
@@ -415,6 +445,60 @@ done:
   return ret;
 }
 
+/* Acquires the free buffer at the index the DMABUF of @src was imported at
+ * last time, or any free buffer if that one is not available */
+static GstFlowReturn
+gst_v4l2_buffer_pool_acquire_for_import (GstV4l2BufferPool * pool,
+    GstBuffer * src, GstBuffer ** buffer)
+{
+  GstBufferPool *bpool = GST_BUFFER_POOL_CAST (pool);
+  GstBufferPoolAcquireParams params = { 0 };
+  GstBuffer *others[VIDEO_MAX_FRAME];
+  GstFlowReturn ret = GST_FLOW_OK;
+  gint i, index = -1, n_others = 0;
+  guint64 id;
+
+  params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
+
+  id = gst_v4l2_buffer_pool_dmabuf_id (gst_buffer_peek_memory (src, 0));
+  for (i = 0; id != 0 && i < VIDEO_MAX_FRAME; i++) {
+    if (pool->import_ids[i] == id && g_atomic_int_get (&pool->free_index[i])) {
+      index = i;
+      break;
+    }
+  }
+
+  if (index < 0)
+    return gst_buffer_pool_acquire_buffer (bpool, buffer, &params);
+
+  /* The buffer is on the free list, so we get to it before the pool would
+   * allocate new buffers. Put back the ones in front of it. */
+  *buffer = NULL;
+  while (n_others < VIDEO_MAX_FRAME) {
+    GstV4l2MemoryGroup *group;
+    GstBuffer *tmp;
+
+    ret = gst_buffer_pool_acquire_buffer (bpool, &tmp, &params);
+    if (ret != GST_FLOW_OK)
+      break;
+
+    if (gst_v4l2_is_buffer_valid (tmp, &group)
+        && group->buffer.index == index) {
+      *buffer = tmp;
+      break;
+    }
+    others[n_others++] = tmp;
+  }
+
+  if (*buffer == NULL && n_others > 0)
+    *buffer = others[--n_others];
+
+  for (i = 0; i < n_others; i++)
+    gst_buffer_unref (others[i]);
+
+  return *buffer ? GST_FLOW_OK : ret;
+}
+
 static GstFlowReturn
 gst_v4l2_buffer_pool_alloc_buffer (GstBufferPool * bpool, GstBuffer ** buffer,
     GstBufferPoolAcquireParams * params)
@@ -692,6 +776,91 @@ gst_v4l2_buffer_pool_resurect_buffer (GstV4l2BufferPool * pool)
   return ret;
 }
 
+/* Dequeues buffers as soon as the driver is done with them, so that the
+ * streaming thread finds them ready and the driver timestamps are not
+ * delayed by downstream processing. Stops on the first error, which is
+ * usually the poll being set flushing. */
+static gpointer
+gst_v4l2_buffer_pool_dqbuf_loop (GstV4l2BufferPool * pool)
+{
+  GstFlowReturn ret;
+
+  GST_DEBUG_OBJECT (pool, "dequeue thread started");
+
+  do {
+    GstBuffer *buffer = NULL;
+
+    ret = gst_v4l2_buffer_pool_dqbuf (pool, &buffer);
+    if (ret == GST_FLOW_OK)
+      gst_atomic_queue_push (pool->dqbuf_queue, buffer);
+
+    g_mutex_lock (&pool->dqbuf_lock);
+    if (ret != GST_FLOW_OK)
+      pool->dqbuf_ret = ret;
+    g_cond_signal (&pool->dqbuf_cond);
+    g_mutex_unlock (&pool->dqbuf_lock);
+  } while (ret == GST_FLOW_OK);
+
+  GST_DEBUG_OBJECT (pool, "dequeue thread stopped: %s",
+      gst_flow_get_name (ret));
+
+  return NULL;
+}
+
+static void
+gst_v4l2_buffer_pool_start_dqbuf_thread (GstV4l2BufferPool * pool)
+{
+  GError *error = NULL;
+
+  if (!pool->use_dqbuf_thread || pool->dqbuf_thread)
+    return;
+
+  if (V4L2_TYPE_IS_OUTPUT (pool->obj->type)
+      || pool->obj->mode == GST_V4L2_IO_RW)
+    return;
+
+  pool->dqbuf_ret = GST_FLOW_OK;
+  pool->dqbuf_thread = g_thread_try_new ("v4l2-dqbuf",
+      (GThreadFunc) gst_v4l2_buffer_pool_dqbuf_loop, pool, &error);
+
+  if (!pool->dqbuf_thread) {
+    GST_WARNING_OBJECT (pool, "could not start dequeue thread: %s",
+        error->message);
+    g_error_free (error);
+  }
+}
+
+/* The poll must be flushing, so that the thread returns */
+static void
+gst_v4l2_buffer_pool_stop_dqbuf_thread (GstV4l2BufferPool * pool)
+{
+  if (!pool->dqbuf_thread)
+    return;
+
+  g_thread_join (pool->dqbuf_thread);
+  pool->dqbuf_thread = NULL;
+}
+
+static GstFlowReturn
+gst_v4l2_buffer_pool_pop_dequeued (GstV4l2BufferPool * pool,
+    GstBuffer ** buffer)
+{
+  GstFlowReturn ret = GST_FLOW_OK;
+
+  if ((*buffer = gst_atomic_queue_pop (pool->dqbuf_queue)))
+    return GST_FLOW_OK;
+
+  g_mutex_lock (&pool->dqbuf_lock);
+  while (!(*buffer = gst_atomic_queue_pop (pool->dqbuf_queue))) {
+    if ((ret = pool->dqbuf_ret) != GST_FLOW_OK)
+      break;
+    g_cond_wait (&pool->dqbuf_cond, &pool->dqbuf_lock);
+  }
+  g_mutex_unlock (&pool->dqbuf_lock);
+
+  return *buffer ? GST_FLOW_OK : ret;
+}
+
 static gboolean
 gst_v4l2_buffer_pool_start (GstBufferPool * bpool)
 {
@@ -817,6 +986,17 @@ gst_v4l2_buffer_pool_start (GstBufferPool * bpool)
   pool->min_latency = min_latency;
   pool->num_queued = 0;
 
+  memset (pool->import_ids, 0, sizeof (pool->import_ids));
+  memset (pool->free_index, 0, sizeof (pool->free_index));
+  pool->num_copies = 0;
+  pool->num_imports = 0;
+  pool->num_import_hits = 0;
+  pool->num_dequeued = 0;
+  pool->max_queued = 0;
+  pool->num_latencies = 0;
+  pool->dqbuf_latency_sum = 0;
+  pool->dqbuf_latency_max = 0;
+
   if (max_buffers != 0 && max_buffers < min_buffers)
     max_buffers = min_buffers;
 
@@ -873,11 +1053,23 @@ gst_v4l2_buffer_pool_stop (GstBufferPool * bpool)
 {
   GstV4l2BufferPool *pool = GST_V4L2_BUFFER_POOL (bpool);
   GstBufferPoolClass *pclass = GST_BUFFER_POOL_CLASS (parent_class);
+  GstBuffer *dequeued;
   gboolean ret;
   gint i;
 
   GST_DEBUG_OBJECT (pool, "stopping pool");
 
+#ifndef GST_DISABLE_GST_DEBUG
+  {
+    GstStructure *stats = gst_v4l2_buffer_pool_get_stats (pool);
+    GST_CAT_INFO_OBJECT (CAT_PERFORMANCE, pool, "%" GST_PTR_FORMAT, stats);
+    gst_structure_free (stats);
+  }
+#endif
+
+  /* we are flushing, so the thread is on its way out */
+  gst_v4l2_buffer_pool_stop_dqbuf_thread (pool);
+
   if (pool->group_released_handler > 0) {
     g_signal_handler_disconnect (pool->vallocator,
         pool->group_released_handler);
@@ -907,6 +1099,10 @@ gst_v4l2_buffer_pool_stop (GstBufferPool * bpool)
     }
   }
 
+  /* Nor the ones dequeued by the thread but not handed out yet */
+  while ((dequeued = gst_atomic_queue_pop (pool->dqbuf_queue)))
+    pclass->release_buffer (bpool, dequeued);
+
   ret = GST_BUFFER_POOL_CLASS (parent_class)->stop (bpool);
 
   if (ret && pool->vallocator) {
@@ -947,6 +1143,7 @@ gst_v4l2_buffer_pool_flush_stop (GstBufferPool * bpool)
   GstV4l2BufferPool *pool = GST_V4L2_BUFFER_POOL (bpool);
   GstV4l2Object *obj = pool->obj;
   GstBuffer *buffers[VIDEO_MAX_FRAME];
+  GstBuffer *dequeued;
   gint i;
 
   GST_DEBUG_OBJECT (pool, "stop flushing");
@@ -958,6 +1155,8 @@ gst_v4l2_buffer_pool_flush_stop (GstBufferPool * bpool)
   if (pool->other_pool)
     gst_buffer_pool_set_flushing (pool->other_pool, FALSE);
 
+  gst_v4l2_buffer_pool_stop_dqbuf_thread (pool);
+
   GST_OBJECT_LOCK (pool);
   gst_v4l2_buffer_pool_streamoff (pool);
   /* Remember buffers to re-enqueue */
@@ -992,6 +1191,13 @@ gst_v4l2_buffer_pool_flush_stop (GstBufferPool * bpool)
         }
       }
 
+      /* These were already dequeued, simply queue them again */
+      while ((dequeued = gst_atomic_queue_pop (pool->dqbuf_queue))) {
+        gst_mini_object_set_qdata (GST_MINI_OBJECT (dequeued),
+            GST_V4L2_IMPORT_QUARK, NULL, NULL);
+        gst_v4l2_buffer_pool_release_buffer (bpool, dequeued);
+      }
+
       break;
     }
     default:
@@ -1005,6 +1211,8 @@ streamon:
     gst_v4l2_buffer_pool_streamon (pool);
 
   gst_poll_set_flushing (pool->poll, FALSE);
+
+  gst_v4l2_buffer_pool_start_dqbuf_thread (pool);
 }
 
 static GstFlowReturn
@@ -1117,6 +1325,7 @@ gst_v4l2_buffer_pool_qbuf (GstV4l2BufferPool * pool, GstBuffer * buf)
   GST_OBJECT_LOCK (pool);
   g_atomic_int_inc (&pool->num_queued);
   pool->buffers[index] = buf;
+  pool->max_queued = MAX (pool->max_queued, (guint) pool->num_queued);
 
   if (!gst_v4l2_allocator_qbuf (pool->vallocator, group))
     goto queue_failed;
@@ -1181,6 +1390,26 @@ gst_v4l2_buffer_pool_dqbuf (GstV4l2BufferPool * pool, GstBuffer ** buffer)
   }
 
   timestamp = GST_TIMEVAL_TO_TIME (group->buffer.timestamp);
+  g_atomic_int_inc (&pool->num_dequeued);
+
+  /* With monotonic timestamps, we know how long the frame has been waiting
+   * since the driver completed it */
+  if (!V4L2_TYPE_IS_OUTPUT (obj->type) && GST_CLOCK_TIME_IS_VALID (timestamp)
+      && (group->buffer.flags & V4L2_BUF_FLAG_TIMESTAMP_MASK) ==
+      V4L2_BUF_FLAG_TIMESTAMP_MONOTONIC) {
+    GstClockTime now = g_get_monotonic_time () * GST_USECOND;
+
+    if (now >= timestamp) {
+      GstClockTime latency = now - timestamp;
+
+      /* read together by gst_v4l2_buffer_pool_get_stats() */
+      GST_OBJECT_LOCK (pool);
+      pool->dqbuf_latency_sum += latency;
+      pool->dqbuf_latency_max = MAX (pool->dqbuf_latency_max, latency);
+      pool->num_latencies++;
+      GST_OBJECT_UNLOCK (pool);
+    }
+  }
 
 #ifndef GST_DISABLE_GST_DEBUG
   for (i = 0; i < group->n_mem; i++) {
@@ -1334,8 +1563,12 @@ gst_v4l2_buffer_pool_acquire_buffer (GstBufferPool * bpool, GstBuffer ** buffer,
         {
           /* just dequeue a buffer, we basically use the queue of v4l2 as the
            * storage for our buffers. This function does poll first so we can
-           * interrupt it fine. */
-          ret = gst_v4l2_buffer_pool_dqbuf (pool, buffer);
+           * interrupt it fine. When the dequeue thread runs, it has
+           * already done that for us. */
+          if (pool->dqbuf_thread)
+            ret = gst_v4l2_buffer_pool_pop_dequeued (pool, buffer);
+          else
+            ret = gst_v4l2_buffer_pool_dqbuf (pool, buffer);
           break;
         }
         default:
@@ -1359,9 +1592,15 @@ gst_v4l2_buffer_pool_acquire_buffer (GstBufferPool * bpool, GstBuffer ** buffer,
         case GST_V4L2_IO_DMABUF:
         case GST_V4L2_IO_USERPTR:
         case GST_V4L2_IO_DMABUF_IMPORT:
+        {
+          GstV4l2MemoryGroup *group;
+
           /* get a free unqueued buffer */
           ret = pclass->acquire_buffer (bpool, buffer, params);
+          if (ret == GST_FLOW_OK && gst_v4l2_is_buffer_valid (*buffer, &group))
+            g_atomic_int_set (&pool->free_index[group->buffer.index], FALSE);
           break;
+        }
 
         default:
           ret = GST_FLOW_ERROR;
@@ -1464,6 +1703,7 @@ gst_v4l2_buffer_pool_release_buffer (GstBufferPool * bpool, GstBuffer * buffer)
             gst_v4l2_allocator_reset_group (pool->vallocator, group);
 
             /* playback, put the buffer back in the queue to refill later. */
+            g_atomic_int_set (&pool->free_index[index], TRUE);
             pclass->release_buffer (bpool, buffer);
           } else {
             /* the buffer is queued in the device but maybe not played yet. We just
@@ -1524,6 +1764,10 @@ gst_v4l2_buffer_pool_finalize (GObject * object)
 
   g_cond_clear (&pool->empty_cond);
 
+  gst_atomic_queue_unref (pool->dqbuf_queue);
+  g_mutex_clear (&pool->dqbuf_lock);
+  g_cond_clear (&pool->dqbuf_cond);
+
   /* FIXME have we done enough here ? */
 
   G_OBJECT_CLASS (parent_class)->finalize (object);
@@ -1536,6 +1780,9 @@ gst_v4l2_buffer_pool_init (GstV4l2BufferPool * pool)
   pool->can_poll_device = TRUE;
   g_cond_init (&pool->empty_cond);
   pool->empty = TRUE;
+  pool->dqbuf_queue = gst_atomic_queue_new (VIDEO_MAX_FRAME);
+  g_mutex_init (&pool->dqbuf_lock);
+  g_cond_init (&pool->dqbuf_cond);
 }
 
 static void
@@ -1779,6 +2026,7 @@ gst_v4l2_buffer_pool_process (GstV4l2BufferPool * pool, GstBuffer ** buf)
               copy = gst_buffer_copy_region (*buf,
                   GST_BUFFER_COPY_ALL | GST_BUFFER_COPY_DEEP, 0, -1);
               GST_LOG_OBJECT (pool, "copy buffer %p->%p", *buf, copy);
+              g_atomic_int_inc (&pool->num_copies);
 
               /* and requeue so that we can continue capturing */
               gst_buffer_unref (*buf);
@@ -1791,7 +2039,11 @@ gst_v4l2_buffer_pool_process (GstV4l2BufferPool * pool, GstBuffer ** buf)
           }
 
           /* buffer not from our pool, grab a frame and copy it into the target */
-          if ((ret = gst_v4l2_buffer_pool_dqbuf (pool, &tmp)) != GST_FLOW_OK)
+          if (pool->dqbuf_thread)
+            ret = gst_v4l2_buffer_pool_pop_dequeued (pool, &tmp);
+          else
+            ret = gst_v4l2_buffer_pool_dqbuf (pool, &tmp);
+          if (ret != GST_FLOW_OK)
             goto done;
 
           /* An empty buffer on capture indicates the end of stream */
@@ -1893,7 +2145,11 @@ gst_v4l2_buffer_pool_process (GstV4l2BufferPool * pool, GstBuffer ** buf)
              * be strange because we would expect the upstream element to have
              * allocated them and returned to us.. */
             params.flags = GST_BUFFER_POOL_ACQUIRE_FLAG_DONTWAIT;
-            ret = gst_buffer_pool_acquire_buffer (bpool, &to_queue, &params);
+            if (obj->mode == GST_V4L2_IO_DMABUF_IMPORT)
+              ret = gst_v4l2_buffer_pool_acquire_for_import (pool, *buf,
+                  &to_queue);
+            else
+              ret = gst_buffer_pool_acquire_buffer (bpool, &to_queue, &params);
             if (ret != GST_FLOW_OK)
               goto acquire_failed;
 
@@ -2020,3 +2276,60 @@ gst_v4l2_buffer_pool_copy_at_threshold (GstV4l2BufferPool * pool, gboolean copy)
   pool->enable_copy_threshold = copy;
   GST_OBJECT_UNLOCK (pool);
 }
+
+/**
+ * gst_v4l2_buffer_pool_enable_dqbuf_thread:
+ * @pool: a #GstBufferPool
+ * @enable: whether to dequeue capture buffers from a dedicated thread
+ *
+ * When enabled, capture buffers are dequeued by a thread as soon as the
+ * driver is done with them, and acquire only picks them up. This keeps the
+ * streaming thread away from the poll and lets it drain every ready buffer
+ * at once. Must be called while the pool is inactive.
+ */
+void
+gst_v4l2_buffer_pool_enable_dqbuf_thread (GstV4l2BufferPool * pool,
+    gboolean enable)
+{
+  g_return_if_fail (!gst_buffer_pool_is_active (GST_BUFFER_POOL (pool)));
+
+  pool->use_dqbuf_thread = enable;
+}
+
+/**
+ * gst_v4l2_buffer_pool_get_stats:
+ * @pool: a #GstBufferPool
+ *
+ * Returns: (transfer full): a #GstStructure with the number of copies and
+ * DMABUF imports done since the pool was started, the number of imports
+ * that reused the buffer index of the previous import, the number of
+ * dequeued, queued and ready buffers and the latency between the driver
+ * timestamp and the dequeue of the capture buffers.
+ */
+GstStructure *
+gst_v4l2_buffer_pool_get_stats (GstV4l2BufferPool * pool)
+{
+  GstClockTime avg_latency = GST_CLOCK_TIME_NONE;
+  GstClockTime max_latency = GST_CLOCK_TIME_NONE;
+  GstStructure *stats;
+
+  GST_OBJECT_LOCK (pool);
+  if (pool->num_latencies > 0) {
+    avg_latency = pool->dqbuf_latency_sum / pool->num_latencies;
+    max_latency = pool->dqbuf_latency_max;
+  }
+
+  stats = gst_structure_new ("GstV4l2BufferPoolStats",
+      "copies", G_TYPE_UINT, g_atomic_int_get (&pool->num_copies),
+      "imports", G_TYPE_UINT, g_atomic_int_get (&pool->num_imports),
+      "import-hits", G_TYPE_UINT, g_atomic_int_get (&pool->num_import_hits),
+      "dequeued", G_TYPE_UINT, g_atomic_int_get (&pool->num_dequeued),
+      "queued", G_TYPE_UINT, g_atomic_int_get (&pool->num_queued),
+      "max-queued", G_TYPE_UINT, pool->max_queued,
+      "ready", G_TYPE_UINT, gst_atomic_queue_length (pool->dqbuf_queue),
+      "dequeue-latency-average", G_TYPE_UINT64, avg_latency,
+      "dequeue-latency-max", G_TYPE_UINT64, max_latency, NULL);
+  GST_OBJECT_UNLOCK (pool);
+
+  return stats;
+}
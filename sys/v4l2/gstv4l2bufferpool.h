@@ -87,6 +87,30 @@ struct _GstV4l2BufferPool
 
   GstBuffer *buffers[VIDEO_MAX_FRAME];
 
+  /* identity of the DMABUF last imported at each index, and whether that
+   * index is on the free list. Importing the same DMABUF at the same index
+   * again lets the driver keep its mapping */
+  guint64 import_ids[VIDEO_MAX_FRAME];
+  gint free_index[VIDEO_MAX_FRAME];
+
+  /* capture only, dequeue from a separate thread into a queue */
+  gboolean use_dqbuf_thread;
+  GThread *dqbuf_thread;
+  GstAtomicQueue *dqbuf_queue;
+  GMutex dqbuf_lock;
+  GCond dqbuf_cond;
+  GstFlowReturn dqbuf_ret;
+
+  /* statistics */
+  guint num_copies;          /* buffers we had to copy */
+  guint num_imports;         /* DMABUF imports */
+  guint num_import_hits;     /* of which at the same index as last time */
+  guint num_dequeued;
+  guint max_queued;          /* protected by OBJECT_LOCK */
+  guint num_latencies;       /* protected by OBJECT_LOCK, as the latencies */
+  GstClockTime dqbuf_latency_sum;   /* capture time to dequeue */
+  GstClockTime dqbuf_latency_max;
+
   /* signal handlers */
   gulong group_released_handler;
 
@@ -110,6 +134,11 @@ void                gst_v4l2_buffer_pool_set_other_pool (GstV4l2BufferPool * poo
 void                gst_v4l2_buffer_pool_copy_at_threshold (GstV4l2BufferPool * pool,
                                                             gboolean copy);
 
+void                gst_v4l2_buffer_pool_enable_dqbuf_thread (GstV4l2BufferPool * pool,
+                                                              gboolean enable);
+
+GstStructure *      gst_v4l2_buffer_pool_get_stats (GstV4l2BufferPool * pool);
+
 G_END_DECLS
 
 #endif /*__GST_V4L2_BUFFER_POOL_H__ */
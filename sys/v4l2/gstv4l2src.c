@@ -63,11 +63,13 @@ GST_DEBUG_CATEGORY (v4l2src_debug);
 #define GST_CAT_DEFAULT v4l2src_debug
 
 #define DEFAULT_PROP_DEVICE   "/dev/video0"
+#define DEFAULT_PROP_LOW_LATENCY FALSE
 
 enum
 {
   PROP_0,
   V4L2_STD_OBJECT_PROPS,
+  PROP_LOW_LATENCY,
   PROP_LAST
 };
 
@@ -143,6 +145,24 @@ gst_v4l2src_class_init (GstV4l2SrcClass * klass)
   gst_v4l2_object_install_properties_helper (gobject_class,
       DEFAULT_PROP_DEVICE);
 
+  /**
+   * GstV4l2Src:low-latency:
+   *
+   * Dequeue frames from a separate thread as soon as the driver is done with
+   * them, and push all frames that are ready at once as a buffer list. Frames
+   * are timestamped with the monotonic capture time of the driver, mapped
+   * onto the pipeline clock once per stream, instead of sampling the clock
+   * for every frame. Takes effect when capture starts.
+   *
+   * Since: 1.14
+   */
+  g_object_class_install_property (gobject_class, PROP_LOW_LATENCY,
+      g_param_spec_boolean ("low-latency", "Low latency",
+          "Dequeue frames in a separate thread, push them in batches and "
+          "timestamp them with the driver capture time",
+          DEFAULT_PROP_LOW_LATENCY,
+          G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+
   /**
    * GstV4l2Src::prepare-format:
    * @v4l2src: the v4l2src instance
@@ -202,6 +222,8 @@ gst_v4l2src_init (GstV4l2Src * v4l2src)
 
   gst_base_src_set_format (GST_BASE_SRC (v4l2src), GST_FORMAT_TIME);
   gst_base_src_set_live (GST_BASE_SRC (v4l2src), TRUE);
+
+  v4l2src->low_latency = DEFAULT_PROP_LOW_LATENCY;
 }
 
 
@@ -223,6 +245,9 @@ gst_v4l2src_set_property (GObject * object,
   if (!gst_v4l2_object_set_property_helper (v4l2src->v4l2object,
           prop_id, value, pspec)) {
     switch (prop_id) {
+      case PROP_LOW_LATENCY:
+        v4l2src->low_latency = g_value_get_boolean (value);
+        break;
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -239,6 +264,9 @@ gst_v4l2src_get_property (GObject * object,
   if (!gst_v4l2_object_get_property_helper (v4l2src->v4l2object,
           prop_id, value, pspec)) {
     switch (prop_id) {
+      case PROP_LOW_LATENCY:
+        g_value_set_boolean (value, v4l2src->low_latency);
+        break;
       default:
         G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
         break;
@@ -513,6 +541,9 @@ gst_v4l2src_decide_allocation (GstBaseSrc * bsrc, GstQuery * query)
   }
 
   if (ret) {
+    gst_v4l2_buffer_pool_enable_dqbuf_thread (GST_V4L2_BUFFER_POOL_CAST
+        (src->v4l2object->pool), src->low_latency);
+
     if (!gst_buffer_pool_set_active (src->v4l2object->pool, TRUE))
       goto activate_failed;
   }
@@ -612,6 +643,7 @@ gst_v4l2src_start (GstBaseSrc * src)
 
   v4l2src->has_bad_timestamp = FALSE;
   v4l2src->last_timestamp = 0;
+  v4l2src->has_ts_offset = FALSE;
 
   return TRUE;
 }
@@ -629,6 +661,7 @@ gst_v4l2src_unlock_stop (GstBaseSrc * src)
   GstV4l2Src *v4l2src = GST_V4L2SRC (src);
 
   v4l2src->last_timestamp = 0;
+  v4l2src->has_ts_offset = FALSE;
 
   return gst_v4l2_object_unlock_stop (v4l2src->v4l2object);
 }
@@ -662,6 +695,10 @@ gst_v4l2src_change_state (GstElement * element, GstStateChange transition)
       if (!gst_v4l2_object_open (obj))
         return GST_STATE_CHANGE_FAILURE;
       break;
+    case GST_STATE_CHANGE_PAUSED_TO_PLAYING:
+      /* the base time changes, map the driver timestamps again */
+      v4l2src->has_ts_offset = FALSE;
+      break;
     default:
       break;
   }
@@ -682,20 +719,16 @@ gst_v4l2src_change_state (GstElement * element, GstStateChange transition)
   return ret;
 }
 
+/* Allocates a buffer and fills it with the next frame */
 static GstFlowReturn
-gst_v4l2src_create (GstPushSrc * src, GstBuffer ** buf)
+gst_v4l2src_capture (GstV4l2Src * v4l2src, GstBuffer ** buf)
 {
-  GstV4l2Src *v4l2src = GST_V4L2SRC (src);
   GstV4l2Object *obj = v4l2src->v4l2object;
   GstV4l2BufferPool *pool = GST_V4L2_BUFFER_POOL_CAST (obj->pool);
   GstFlowReturn ret;
-  GstClock *clock;
-  GstClockTime abs_time, base_time, timestamp, duration;
-  GstClockTime delay;
-  GstMessage *qos_msg;
 
   do {
-    ret = GST_BASE_SRC_CLASS (parent_class)->alloc (GST_BASE_SRC (src), 0,
+    ret = GST_BASE_SRC_CLASS (parent_class)->alloc (GST_BASE_SRC (v4l2src), 0,
         obj->info.size, buf);
 
     if (G_UNLIKELY (ret != GST_FLOW_OK))
@@ -708,8 +741,42 @@ gst_v4l2src_create (GstPushSrc * src, GstBuffer ** buf)
   if (G_UNLIKELY (ret != GST_FLOW_OK))
     goto error;
 
-  timestamp = GST_BUFFER_TIMESTAMP (*buf);
-  duration = obj->duration;
+  return ret;
+
+  /* ERROR */
+alloc_failed:
+  {
+    if (ret != GST_FLOW_FLUSHING)
+      GST_ELEMENT_ERROR (v4l2src, RESOURCE, NO_SPACE_LEFT,
+          ("Failed to allocate a buffer"), (NULL));
+    return ret;
+  }
+error:
+  {
+    gst_buffer_replace (buf, NULL);
+    if (ret == GST_V4L2_FLOW_LAST_BUFFER) {
+      GST_ELEMENT_ERROR (v4l2src, RESOURCE, FAILED,
+          ("Driver returned a buffer with no payload, this most likely "
+              "indicate a bug in the driver."), (NULL));
+      ret = GST_FLOW_ERROR;
+    } else {
+      GST_DEBUG_OBJECT (v4l2src, "error processing buffer %d (%s)", ret,
+          gst_flow_get_name (ret));
+    }
+    return ret;
+  }
+}
+
+/* Returns the running time at which a frame was captured, from the current
+ * clock time minus the delay since the driver timestamp, if the driver
+ * timestamp can be trusted, or minus one frame otherwise */
+static GstClockTime
+gst_v4l2src_get_timestamp (GstV4l2Src * v4l2src, GstClockTime timestamp,
+    GstClockTime duration)
+{
+  GstClock *clock;
+  GstClockTime abs_time, base_time;
+  GstClockTime delay;
 
   /* timestamps, LOCK to get clock and base time. */
   /* FIXME: element clock and base_time is rarely changing */
@@ -810,6 +877,86 @@ retry:
     timestamp = GST_CLOCK_TIME_NONE;
   }
 
+  return timestamp;
+}
+
+/* Maps a monotonic driver timestamp to running time. The offset between both
+ * is measured on the first frame only, so that the timestamps keep the
+ * spacing of the capture times and no clock is sampled per frame. Returns
+ * GST_CLOCK_TIME_NONE when the driver timestamps can't be used that way. */
+static GstClockTime
+gst_v4l2src_map_timestamp (GstV4l2Src * v4l2src, GstClockTime timestamp)
+{
+  GstClockTimeDiff running_time;
+
+  if (v4l2src->has_bad_timestamp || !GST_CLOCK_TIME_IS_VALID (timestamp))
+    return GST_CLOCK_TIME_NONE;
+
+  if (v4l2src->last_timestamp > timestamp) {
+    GST_WARNING_OBJECT (v4l2src,
+        "Timestamp going backward, ignoring driver timestamps");
+    v4l2src->has_bad_timestamp = TRUE;
+    return GST_CLOCK_TIME_NONE;
+  }
+
+  if (!v4l2src->has_ts_offset) {
+    GstClock *clock;
+    GstClockTime base_time = 0, abs_time;
+    struct timespec now;
+    GstClockTime gstnow;
+
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    gstnow = GST_TIMESPEC_TO_TIME (now);
+
+    /* only monotonic timestamps keep a fixed offset to the clock */
+    if (timestamp > gstnow || (gstnow - timestamp) > (10 * GST_SECOND))
+      return GST_CLOCK_TIME_NONE;
+
+    GST_OBJECT_LOCK (v4l2src);
+    if ((clock = GST_ELEMENT_CLOCK (v4l2src))) {
+      base_time = GST_ELEMENT (v4l2src)->base_time;
+      gst_object_ref (clock);
+    }
+    GST_OBJECT_UNLOCK (v4l2src);
+
+    if (!clock)
+      return GST_CLOCK_TIME_NONE;
+
+    abs_time = gst_clock_get_time (clock);
+    gst_object_unref (clock);
+
+    v4l2src->ts_offset = GST_CLOCK_DIFF (gstnow, abs_time) -
+        (GstClockTimeDiff) base_time;
+    v4l2src->has_ts_offset = TRUE;
+
+    GST_DEBUG_OBJECT (v4l2src, "mapping driver timestamps to running time "
+        "with offset %" GST_STIME_FORMAT, GST_STIME_ARGS (v4l2src->ts_offset));
+  }
+
+  v4l2src->last_timestamp = timestamp;
+
+  running_time = (GstClockTimeDiff) timestamp + v4l2src->ts_offset;
+
+  return running_time > 0 ? running_time : 0;
+}
+
+/* Sets the timestamp, duration and offsets of a captured frame */
+static void
+gst_v4l2src_timestamp_buffer (GstV4l2Src * v4l2src, GstBuffer * buf)
+{
+  GstV4l2Object *obj = v4l2src->v4l2object;
+  GstClockTime timestamp = GST_CLOCK_TIME_NONE;
+  GstClockTime duration = obj->duration;
+  GstMessage *qos_msg;
+
+  if (v4l2src->low_latency)
+    timestamp = gst_v4l2src_map_timestamp (v4l2src,
+        GST_BUFFER_TIMESTAMP (buf));
+
+  if (!GST_CLOCK_TIME_IS_VALID (timestamp))
+    timestamp = gst_v4l2src_get_timestamp (v4l2src,
+        GST_BUFFER_TIMESTAMP (buf), duration);
+
   /* activate settings for next frame */
   if (GST_CLOCK_TIME_IS_VALID (duration)) {
     v4l2src->ctrl_time += duration;
@@ -819,26 +966,27 @@ retry:
      */
     v4l2src->ctrl_time = timestamp;
   }
-  gst_object_sync_values (GST_OBJECT (src), v4l2src->ctrl_time);
+  gst_object_sync_values (GST_OBJECT (v4l2src), v4l2src->ctrl_time);
 
-  GST_INFO_OBJECT (src, "sync to %" GST_TIME_FORMAT " out ts %" GST_TIME_FORMAT,
-      GST_TIME_ARGS (v4l2src->ctrl_time), GST_TIME_ARGS (timestamp));
+  GST_INFO_OBJECT (v4l2src, "sync to %" GST_TIME_FORMAT " out ts %"
+      GST_TIME_FORMAT, GST_TIME_ARGS (v4l2src->ctrl_time),
+      GST_TIME_ARGS (timestamp));
 
   /* use generated offset values only if there are not already valid ones
    * set by the v4l2 device */
-  if (!GST_BUFFER_OFFSET_IS_VALID (*buf)
-      || !GST_BUFFER_OFFSET_END_IS_VALID (*buf)) {
-    GST_BUFFER_OFFSET (*buf) = v4l2src->offset++;
-    GST_BUFFER_OFFSET_END (*buf) = v4l2src->offset;
+  if (!GST_BUFFER_OFFSET_IS_VALID (buf)
+      || !GST_BUFFER_OFFSET_END_IS_VALID (buf)) {
+    GST_BUFFER_OFFSET (buf) = v4l2src->offset++;
+    GST_BUFFER_OFFSET_END (buf) = v4l2src->offset;
   } else {
     /* adjust raw v4l2 device sequence, will restart at null in case of renegotiation
      * (streamoff/streamon) */
-    GST_BUFFER_OFFSET (*buf) += v4l2src->renegotiation_adjust;
-    GST_BUFFER_OFFSET_END (*buf) += v4l2src->renegotiation_adjust;
+    GST_BUFFER_OFFSET (buf) += v4l2src->renegotiation_adjust;
+    GST_BUFFER_OFFSET_END (buf) += v4l2src->renegotiation_adjust;
     /* check for frame loss with given (from v4l2 device) buffer offset */
     if ((v4l2src->offset != 0)
-        && (GST_BUFFER_OFFSET (*buf) != (v4l2src->offset + 1))) {
-      guint64 lost_frame_count = GST_BUFFER_OFFSET (*buf) - v4l2src->offset - 1;
+        && (GST_BUFFER_OFFSET (buf) != (v4l2src->offset + 1))) {
+      guint64 lost_frame_count = GST_BUFFER_OFFSET (buf) - v4l2src->offset - 1;
       GST_WARNING_OBJECT (v4l2src,
           "lost frames detected: count = %" G_GUINT64_FORMAT " - ts: %"
           GST_TIME_FORMAT, lost_frame_count, GST_TIME_ARGS (timestamp));
@@ -850,36 +998,58 @@ retry:
       gst_element_post_message (GST_ELEMENT_CAST (v4l2src), qos_msg);
 
     }
-    v4l2src->offset = GST_BUFFER_OFFSET (*buf);
+    v4l2src->offset = GST_BUFFER_OFFSET (buf);
   }
 
-  GST_BUFFER_TIMESTAMP (*buf) = timestamp;
-  GST_BUFFER_DURATION (*buf) = duration;
+  GST_BUFFER_TIMESTAMP (buf) = timestamp;
+  GST_BUFFER_DURATION (buf) = duration;
+}
 
-  return ret;
+static GstFlowReturn
+gst_v4l2src_create (GstPushSrc * src, GstBuffer ** buf)
+{
+  GstV4l2Src *v4l2src = GST_V4L2SRC (src);
+#ifdef HAVE_GST_BASE_SRC_SUBMIT_BUFFER_LIST
+  GstV4l2BufferPool *pool =
+      GST_V4L2_BUFFER_POOL_CAST (v4l2src->v4l2object->pool);
+#endif
+  GstFlowReturn ret;
 
-  /* ERROR */
-alloc_failed:
-  {
-    if (ret != GST_FLOW_FLUSHING)
-      GST_ELEMENT_ERROR (src, RESOURCE, NO_SPACE_LEFT,
-          ("Failed to allocate a buffer"), (NULL));
+  ret = gst_v4l2src_capture (v4l2src, buf);
+  if (G_UNLIKELY (ret != GST_FLOW_OK))
     return ret;
-  }
-error:
-  {
-    gst_buffer_replace (buf, NULL);
-    if (ret == GST_V4L2_FLOW_LAST_BUFFER) {
-      GST_ELEMENT_ERROR (src, RESOURCE, FAILED,
-          ("Driver returned a buffer with no payload, this most likely "
-              "indicate a bug in the driver."), (NULL));
-      ret = GST_FLOW_ERROR;
-    } else {
-      GST_DEBUG_OBJECT (src, "error processing buffer %d (%s)", ret,
-          gst_flow_get_name (ret));
+
+  gst_v4l2src_timestamp_buffer (v4l2src, *buf);
+
+#ifdef HAVE_GST_BASE_SRC_SUBMIT_BUFFER_LIST
+  /* In low-latency mode, the dequeue thread may have more frames ready by
+   * now. Push them all at once rather than waking up for each of them.
+   * gst_base_src_submit_buffer_list() is new in GStreamer 1.14, with an
+   * older core they are picked up by the following create() calls. */
+  if (pool->dqbuf_thread && gst_atomic_queue_length (pool->dqbuf_queue) > 0) {
+    GstBufferList *list = gst_buffer_list_new ();
+
+    gst_buffer_list_add (list, *buf);
+    *buf = NULL;
+
+    while (gst_atomic_queue_length (pool->dqbuf_queue) > 0) {
+      GstBuffer *next;
+
+      /* errors show up again on the next call */
+      if (gst_v4l2src_capture (v4l2src, &next) != GST_FLOW_OK)
+        break;
+
+      gst_v4l2src_timestamp_buffer (v4l2src, next);
+      gst_buffer_list_add (list, next);
     }
-    return ret;
+
+    GST_LOG_OBJECT (v4l2src, "pushing %u frames",
+        gst_buffer_list_length (list));
+    gst_base_src_submit_buffer_list (GST_BASE_SRC (src), list);
   }
+#endif
+
+  return GST_FLOW_OK;
 }
 
 
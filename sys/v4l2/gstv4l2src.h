@@ -69,6 +69,12 @@ struct _GstV4l2Src
   /* Timestamp sanity check */
   GstClockTime last_timestamp;
   gboolean has_bad_timestamp;
+
+  /* low-latency mode, driver timestamps are mapped to running time with a
+   * single offset measured on the first frame */
+  gboolean low_latency;
+  GstClockTimeDiff ts_offset;
+  gboolean has_ts_offset;
 };
 
 struct _GstV4l2SrcClass
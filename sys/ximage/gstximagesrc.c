@@ -27,6 +27,12 @@
  * available to also capture your mouse pointer.  By default it will fixate to
  * 25 frames per second.
  *
+ * With XDamage, the images are recycled and only the areas that changed since
+ * an image was last used are retrieved again. The areas that changed since the
+ * previous frame are attached to each buffer as #GstVideoRegionOfInterestMeta
+ * of type "damage", so that downstream elements such as encoders can skip the
+ * rest of the frame. The first frame is marked as damaged entirely.
+ *
  * <refsect2>
  * <title>Example pipelines</title>
  * |[
@@ -55,6 +61,9 @@
 GST_DEBUG_CATEGORY_STATIC (gst_debug_ximage_src);
 #define GST_CAT_DEFAULT gst_debug_ximage_src
 
+/* beyond that, the damage is described by its bounding box only */
+#define MAX_DAMAGE_RECTS 16
+
 static GstStaticPadTemplate t =
 GST_STATIC_PAD_TEMPLATE ("src", GST_PAD_SRC, GST_PAD_ALWAYS,
     GST_STATIC_CAPS ("video/x-raw, "
@@ -83,6 +92,28 @@ G_DEFINE_TYPE (GstXImageSrc, gst_ximage_src, GST_TYPE_PUSH_SRC);
 static GstCaps *gst_ximage_src_fixate (GstBaseSrc * bsrc, GstCaps * caps);
 static void gst_ximage_src_clear_bufpool (GstXImageSrc * ximagesrc);
 
+/* Whether the buffer still wraps the XImage. Downstream gets a copy of the
+ * read-only memory when it maps it for writing, which then replaces the
+ * XImage memory in the buffer. */
+static gboolean
+gst_ximage_src_buffer_holds_image (GstBuffer * ximage, GstMetaXImage * meta)
+{
+  GstMemory *mem;
+  GstMapInfo map;
+  gboolean ret;
+
+  if (gst_buffer_n_memory (ximage) != 1)
+    return FALSE;
+
+  mem = gst_buffer_peek_memory (ximage, 0);
+  if (!gst_memory_map (mem, &map, GST_MAP_READ))
+    return FALSE;
+  ret = (map.data == (guint8 *) meta->ximage->data);
+  gst_memory_unmap (mem, &map);
+
+  return ret;
+}
+
 /* Called when a buffer is returned from the pipeline */
 static gboolean
 gst_ximage_src_return_buf (GstXImageSrc * ximagesrc, GstBuffer * ximage)
@@ -99,6 +130,12 @@ gst_ximage_src_return_buf (GstXImageSrc * ximagesrc, GstBuffer * ximage)
     g_mutex_lock (&ximagesrc->x_lock);
     gst_ximageutil_ximage_destroy (ximagesrc->xcontext, ximage);
     g_mutex_unlock (&ximagesrc->x_lock);
+  } else if (!gst_ximage_src_buffer_holds_image (ximage, meta)) {
+    GST_DEBUG_OBJECT (ximagesrc,
+        "destroy image %p as its memory was replaced downstream", ximage);
+    g_mutex_lock (&ximagesrc->x_lock);
+    gst_ximageutil_ximage_destroy (ximagesrc->xcontext, ximage);
+    g_mutex_unlock (&ximagesrc->x_lock);
   } else {
     /* In that case we can reuse the image and add it to our image pool. */
     GST_LOG_OBJECT (ximagesrc, "recycling image %p in pool", ximage);
@@ -243,11 +280,16 @@ use_root_window:
   {
     int error_base;
     long evmask = NoEventMask;
+    gint i;
 
     s->have_xdamage = FALSE;
     s->damage = None;
     s->damage_copy_gc = None;
     s->damage_region = None;
+    s->refresh_region = None;
+    s->clip_region = None;
+    for (i = 0; i < GST_XIMAGE_SRC_DAMAGE_HISTORY; i++)
+      s->damage_history[i] = None;
 
     if (XDamageQueryExtension (s->xcontext->disp, &s->damage_event_base,
             &error_base)) {
@@ -264,6 +306,12 @@ use_root_window:
               s->xwindow, GCSubwindowMode, &values);
           XSelectInput (s->xcontext->disp, s->xwindow, evmask);
 
+          s->refresh_region = XFixesCreateRegion (s->xcontext->disp, NULL, 0);
+          s->clip_region = XFixesCreateRegion (s->xcontext->disp, NULL, 0);
+          for (i = 0; i < GST_XIMAGE_SRC_DAMAGE_HISTORY; i++)
+            s->damage_history[i] =
+                XFixesCreateRegion (s->xcontext->disp, NULL, 0);
+
           s->have_xdamage = TRUE;
         } else {
           XDamageDestroy (s->xcontext->disp, s->damage);
@@ -293,9 +341,8 @@ gst_ximage_src_start (GstBaseSrc * basesrc)
 
   s->last_frame_no = -1;
 #ifdef HAVE_XDAMAGE
-  if (s->last_ximage)
-    gst_buffer_unref (GST_BUFFER_CAST (s->last_ximage));
-  s->last_ximage = NULL;
+  s->frame_serial = 0;
+  s->last_cursor_rect.width = s->last_cursor_rect.height = 0;
 #endif
   return gst_ximage_src_open_display (s, s->display_name);
 }
@@ -304,11 +351,8 @@ static gboolean
 gst_ximage_src_stop (GstBaseSrc * basesrc)
 {
   GstXImageSrc *src = GST_XIMAGE_SRC (basesrc);
-
 #ifdef HAVE_XDAMAGE
-  if (src->last_ximage)
-    gst_buffer_unref (GST_BUFFER_CAST (src->last_ximage));
-  src->last_ximage = NULL;
+  gint i;
 #endif
 
   gst_ximage_src_clear_bufpool (src);
@@ -323,6 +367,20 @@ gst_ximage_src_stop (GstBaseSrc * basesrc)
     g_mutex_lock (&src->x_lock);
 
 #ifdef HAVE_XDAMAGE
+    for (i = 0; i < GST_XIMAGE_SRC_DAMAGE_HISTORY; i++) {
+      if (src->damage_history[i] != None) {
+        XFixesDestroyRegion (src->xcontext->disp, src->damage_history[i]);
+        src->damage_history[i] = None;
+      }
+    }
+    if (src->refresh_region != None) {
+      XFixesDestroyRegion (src->xcontext->disp, src->refresh_region);
+      src->refresh_region = None;
+    }
+    if (src->clip_region != None) {
+      XFixesDestroyRegion (src->xcontext->disp, src->clip_region);
+      src->clip_region = None;
+    }
     if (src->damage_copy_gc != None) {
       XFreeGC (src->xcontext->disp, src->damage_copy_gc);
       src->damage_copy_gc = None;
@@ -472,14 +530,153 @@ composite_pixel (GstXContext * xcontext, guchar * dest, guchar * src)
 #endif
 
 #ifdef HAVE_XDAMAGE
+/* Takes the damage reported since the previous frame into damage_region and
+ * remembers it, so that older images can be brought up to date later */
 static void
-copy_buffer (GstBuffer * dest, GstBuffer * src)
+gst_ximage_src_collect_damage (GstXImageSrc * ximagesrc)
 {
-  GstMapInfo map;
+  Display *disp = ximagesrc->xcontext->disp;
+  XEvent ev;
+
+  /* we only need the accumulated damage, not the events themselves */
+  while (XPending (disp))
+    XNextEvent (disp, &ev);
+
+  XDamageSubtract (disp, ximagesrc->damage, None, ximagesrc->damage_region);
+
+  ximagesrc->frame_serial++;
+  XFixesCopyRegion (disp, ximagesrc->damage_history[ximagesrc->frame_serial %
+          GST_XIMAGE_SRC_DAMAGE_HISTORY], ximagesrc->damage_region);
+}
+
+/* Brings an image of an earlier frame up to date by retrieving only what
+ * changed since, and what the pointer was drawn over. Returns FALSE when the
+ * image has to be retrieved entirely. */
+static gboolean
+gst_ximage_src_refresh_damaged (GstXImageSrc * ximagesrc, GstMetaXImage * meta)
+{
+  Display *disp = ximagesrc->xcontext->disp;
+  XRectangle area, *rects;
+  guint64 serial;
+  gint i, nrects = 0;
+  gint64 damaged = 0;
+
+  if (meta->serial == 0 ||
+      ximagesrc->frame_serial - meta->serial > GST_XIMAGE_SRC_DAMAGE_HISTORY)
+    return FALSE;
+
+  XFixesSetRegion (disp, ximagesrc->refresh_region, &meta->cursor_rect,
+      meta->cursor_rect.width > 0 ? 1 : 0);
+  for (serial = meta->serial + 1; serial <= ximagesrc->frame_serial; serial++)
+    XFixesUnionRegion (disp, ximagesrc->refresh_region,
+        ximagesrc->refresh_region,
+        ximagesrc->damage_history[serial % GST_XIMAGE_SRC_DAMAGE_HISTORY]);
+
+  /* only what is in the area we capture */
+  area.x = ximagesrc->startx;
+  area.y = ximagesrc->starty;
+  area.width = ximagesrc->width;
+  area.height = ximagesrc->height;
+  XFixesSetRegion (disp, ximagesrc->clip_region, &area, 1);
+  XFixesIntersectRegion (disp, ximagesrc->refresh_region,
+      ximagesrc->refresh_region, ximagesrc->clip_region);
+
+  rects = XFixesFetchRegion (disp, ximagesrc->refresh_region, &nrects);
+  if (rects == NULL)
+    return nrects == 0;
+
+  for (i = 0; i < nrects; i++)
+    damaged += rects[i].width * rects[i].height;
+
+  /* a single XShm transfer is cheaper than many small ones */
+  if (ximagesrc->xcontext->use_xshm &&
+      damaged > (gint64) area.width * area.height / 2) {
+    GST_LOG_OBJECT (ximagesrc, "%d rectangles cover most of the image",
+        nrects);
+    XFree (rects);
+    return FALSE;
+  }
+
+  for (i = 0; i < nrects; i++) {
+    GST_LOG_OBJECT (ximagesrc,
+        "Retrieving damaged sub-region @ %d,%d size %dx%d",
+        rects[i].x, rects[i].y, rects[i].width, rects[i].height);
+
+    XGetSubImage (disp, ximagesrc->xwindow, rects[i].x, rects[i].y,
+        rects[i].width, rects[i].height, AllPlanes, ZPixmap, meta->ximage,
+        rects[i].x - ximagesrc->startx, rects[i].y - ximagesrc->starty);
+  }
+  XFree (rects);
+
+  return TRUE;
+}
+
+/* Lists what changed since the previous frame as region of interest metas
+ * of type "damage", in image coordinates */
+static void
+gst_ximage_src_add_damage_meta (GstXImageSrc * ximagesrc, GstBuffer * ximage,
+    GstMetaXImage * meta)
+{
+  Display *disp = ximagesrc->xcontext->disp;
+  XRectangle area, cursors[2], bounds, *rects;
+  gint i, n_cursors = 0, nrects = 0;
+
+  area.x = ximagesrc->startx;
+  area.y = ximagesrc->starty;
+  area.width = ximagesrc->width;
+  area.height = ximagesrc->height;
+
+  if (ximagesrc->frame_serial == 1) {
+    gst_buffer_add_video_region_of_interest_meta (ximage, "damage", 0, 0,
+        area.width, area.height);
+    goto done;
+  }
+
+  /* the pointer moved away from where it was, or was drawn anew */
+  if (ximagesrc->last_cursor_rect.width > 0)
+    cursors[n_cursors++] = ximagesrc->last_cursor_rect;
+  if (meta->cursor_rect.width > 0)
+    cursors[n_cursors++] = meta->cursor_rect;
+
+  XFixesSetRegion (disp, ximagesrc->clip_region, cursors, n_cursors);
+  XFixesUnionRegion (disp, ximagesrc->refresh_region,
+      ximagesrc->damage_region, ximagesrc->clip_region);
+  XFixesSetRegion (disp, ximagesrc->clip_region, &area, 1);
+  XFixesIntersectRegion (disp, ximagesrc->refresh_region,
+      ximagesrc->refresh_region, ximagesrc->clip_region);
+
+  rects = XFixesFetchRegionAndBounds (disp, ximagesrc->refresh_region,
+      &nrects, &bounds);
+  if (rects == NULL && nrects > 0)
+    goto done;
+
+  /* too many small rectangles are more work downstream than they save */
+  if (nrects > MAX_DAMAGE_RECTS) {
+    XFree (rects);
+    rects = NULL;
+    nrects = 1;
+  }
+
+  for (i = 0; i < nrects; i++) {
+    XRectangle *r = rects ? &rects[i] : &bounds;
+
+    gst_buffer_add_video_region_of_interest_meta (ximage, "damage",
+        r->x - area.x, r->y - area.y, r->width, r->height);
+  }
+  if (rects)
+    XFree (rects);
+
+done:
+  ximagesrc->last_cursor_rect = meta->cursor_rect;
+}
 
-  gst_buffer_map (src, &map, GST_MAP_READ);
-  gst_buffer_fill (dest, 0, map.data, map.size);
-  gst_buffer_unmap (src, &map);
+static gboolean
+remove_damage_meta (GstBuffer * buffer, GstMeta ** meta, gpointer user_data)
+{
+  if ((*meta)->info->api == GST_VIDEO_REGION_OF_INTEREST_META_API_TYPE)
+    *meta = NULL;
+
+  return TRUE;
 }
 #endif
 
@@ -490,6 +687,7 @@ gst_ximage_src_ximage_get (GstXImageSrc * ximagesrc)
 {
   GstBuffer *ximage = NULL;
   GstMetaXImage *meta;
+  gboolean have_frame = FALSE;
 
   g_mutex_lock (&ximagesrc->pool_lock);
   while (ximagesrc->buffer_pool != NULL) {
@@ -533,174 +731,22 @@ gst_ximage_src_ximage_get (GstXImageSrc * ximagesrc)
   meta = GST_META_XIMAGE_GET (ximage);
 
 #ifdef HAVE_XDAMAGE
-  if (ximagesrc->have_xdamage && ximagesrc->use_damage &&
-      ximagesrc->last_ximage != NULL) {
-    XEvent ev;
-    gboolean have_damage = FALSE;
-
-    /* have_frame is TRUE when either the entire screen has been
-     * grabbed or when the last image has been copied */
-    gboolean have_frame = FALSE;
+  if (ximagesrc->have_xdamage && ximagesrc->use_damage) {
+    /* the image still holds an earlier frame, only update what changed
+     * since. Downstream must not modify it, writable mappings get a copy
+     * and such buffers are not recycled. */
+    GST_MINI_OBJECT_FLAG_SET (gst_buffer_peek_memory (ximage, 0),
+        GST_MEMORY_FLAG_READONLY);
+    gst_buffer_foreach_meta (ximage, remove_damage_meta, NULL);
+    gst_ximage_src_collect_damage (ximagesrc);
 
     GST_DEBUG_OBJECT (ximagesrc, "Retrieving screen using XDamage");
-
-    do {
-      XDamageNotifyEvent *damage_ev = (XDamageNotifyEvent *) (&ev);
-
-      XNextEvent (ximagesrc->xcontext->disp, &ev);
-
-      if (ev.type == ximagesrc->damage_event_base + XDamageNotify &&
-          damage_ev->level == XDamageReportNonEmpty) {
-
-        XDamageSubtract (ximagesrc->xcontext->disp, ximagesrc->damage, None,
-            ximagesrc->damage_region);
-        have_damage = TRUE;
-      }
-    } while (XPending (ximagesrc->xcontext->disp));
-
-    if (have_damage) {
-      XRectangle *rects;
-      int nrects;
-
-      /* Now copy out all of the damaged rectangles. */
-      rects =
-          XFixesFetchRegion (ximagesrc->xcontext->disp,
-          ximagesrc->damage_region, &nrects);
-      if (rects != NULL) {
-        int i;
-
-        if (!have_frame) {
-          GST_LOG_OBJECT (ximagesrc,
-              "Copying from last frame ximage->size: %" G_GSIZE_FORMAT,
-              gst_buffer_get_size (ximage));
-          copy_buffer (ximage, ximagesrc->last_ximage);
-          have_frame = TRUE;
-        }
-        for (i = 0; i < nrects; i++) {
-          GST_LOG_OBJECT (ximagesrc,
-              "Damaged sub-region @ %d,%d size %dx%d reported",
-              rects[i].x, rects[i].y, rects[i].width, rects[i].height);
-
-          /* if we only want a small area, clip this damage region to
-           * area we want */
-          if (ximagesrc->endx > ximagesrc->startx &&
-              ximagesrc->endy > ximagesrc->starty) {
-            /* see if damage area intersects */
-            if (rects[i].x + rects[i].width - 1 < ximagesrc->startx ||
-                rects[i].x > ximagesrc->endx) {
-              /* trivial reject */
-            } else if (rects[i].y + rects[i].height - 1 < ximagesrc->starty ||
-                rects[i].y > ximagesrc->endy) {
-              /* trivial reject */
-            } else {
-              /* find intersect region */
-              int startx, starty, width, height;
-
-              startx = (rects[i].x < ximagesrc->startx) ? ximagesrc->startx :
-                  rects[i].x;
-              starty = (rects[i].y < ximagesrc->starty) ? ximagesrc->starty :
-                  rects[i].y;
-              width = (rects[i].x + rects[i].width - 1 < ximagesrc->endx) ?
-                  rects[i].x + rects[i].width - startx :
-                  ximagesrc->endx - startx + 1;
-              height = (rects[i].y + rects[i].height - 1 < ximagesrc->endy) ?
-                  rects[i].y + rects[i].height - starty : ximagesrc->endy -
-                  starty + 1;
-
-              GST_LOG_OBJECT (ximagesrc,
-                  "Retrieving damaged sub-region @ %d,%d size %dx%d as intersect region",
-                  startx, starty, width, height);
-              XGetSubImage (ximagesrc->xcontext->disp, ximagesrc->xwindow,
-                  startx, starty, width, height, AllPlanes, ZPixmap,
-                  meta->ximage, startx - ximagesrc->startx,
-                  starty - ximagesrc->starty);
-            }
-          } else {
-
-            GST_LOG_OBJECT (ximagesrc,
-                "Retrieving damaged sub-region @ %d,%d size %dx%d",
-                rects[i].x, rects[i].y, rects[i].width, rects[i].height);
-
-            XGetSubImage (ximagesrc->xcontext->disp, ximagesrc->xwindow,
-                rects[i].x, rects[i].y,
-                rects[i].width, rects[i].height,
-                AllPlanes, ZPixmap, meta->ximage, rects[i].x, rects[i].y);
-          }
-        }
-        XFree (rects);
-      }
-    }
-    if (!have_frame) {
-      GST_LOG_OBJECT (ximagesrc,
-          "Copying from last frame ximage->size: %" G_GSIZE_FORMAT,
-          gst_buffer_get_size (ximage));
-      copy_buffer (ximage, ximagesrc->last_ximage);
-    }
-#ifdef HAVE_XFIXES
-    /* re-get area where last mouse pointer was  but only if in our clipping
-     * bounds */
-    if (ximagesrc->cursor_image) {
-      gint x, y, width, height;
-
-      x = ximagesrc->cursor_image->x - ximagesrc->cursor_image->xhot -
-          ximagesrc->x;
-      y = ximagesrc->cursor_image->y - ximagesrc->cursor_image->yhot -
-          ximagesrc->y;
-      width = ximagesrc->cursor_image->width;
-      height = ximagesrc->cursor_image->height;
-
-      /* bounds checking */
-      if (x < 0)
-        x = 0;
-      if (y < 0)
-        y = 0;
-      if (x + width > ximagesrc->xcontext->width)
-        width = ximagesrc->xcontext->width - x;
-      if (y + height > ximagesrc->xcontext->height)
-        height = ximagesrc->xcontext->height - y;
-      g_assert (x >= 0);
-      g_assert (y >= 0);
-      GST_DEBUG_OBJECT (ximagesrc,
-          "Cursor was at (%d,%d) width: %d, height: %d and our range is: (%d,%d) - (%d,%d)",
-          x, y, width, height, ximagesrc->startx, ximagesrc->starty,
-          ximagesrc->endx, ximagesrc->endy);
-      /* only get where cursor last was, if it is in our range */
-      if (ximagesrc->endx > ximagesrc->startx &&
-          ximagesrc->endy > ximagesrc->starty) {
-        /* check bounds */
-        if (x + width < ximagesrc->startx || x > ximagesrc->endx) {
-          /* trivial reject */
-        } else if (y + height < ximagesrc->starty || y > ximagesrc->endy) {
-          /* trivial reject */
-        } else {
-          /* find intersect region */
-          int startx, starty, iwidth, iheight;
-
-          startx = (x < ximagesrc->startx) ? ximagesrc->startx : x;
-          starty = (y < ximagesrc->starty) ? ximagesrc->starty : y;
-          iwidth = (x + width < ximagesrc->endx) ?
-              x + width - startx : ximagesrc->endx - startx;
-          iheight = (y + height < ximagesrc->endy) ?
-              y + height - starty : ximagesrc->endy - starty;
-          GST_DEBUG_OBJECT (ximagesrc, "Removing cursor from %d,%d", x, y);
-          XGetSubImage (ximagesrc->xcontext->disp, ximagesrc->xwindow,
-              startx, starty, iwidth, iheight, AllPlanes, ZPixmap,
-              meta->ximage, startx - ximagesrc->startx,
-              starty - ximagesrc->starty);
-        }
-      } else {
-
-        GST_DEBUG_OBJECT (ximagesrc, "Removing cursor from %d,%d", x, y);
-        XGetSubImage (ximagesrc->xcontext->disp, ximagesrc->xwindow,
-            x, y, width, height, AllPlanes, ZPixmap, meta->ximage, x, y);
-      }
-    }
-#endif
-
-
-  } else {
+    have_frame = gst_ximage_src_refresh_damaged (ximagesrc, meta);
+    meta->serial = ximagesrc->frame_serial;
+  }
 #endif
 
+  if (!have_frame) {
 #ifdef HAVE_XSHM
     if (ximagesrc->xcontext->use_xshm) {
       GST_DEBUG_OBJECT (ximagesrc, "Retrieving screen using XShm");
@@ -722,9 +768,9 @@ gst_ximage_src_ximage_get (GstXImageSrc * ximagesrc)
             ximagesrc->height, AllPlanes, ZPixmap);
       }
     }
-#ifdef HAVE_XDAMAGE
   }
-#endif
+
+  meta->cursor_rect.width = meta->cursor_rect.height = 0;
 
 #ifdef HAVE_XFIXES
   if (ximagesrc->show_pointer && ximagesrc->have_xfixes
@@ -805,20 +851,21 @@ gst_ximage_src_ximage_get (GstXImageSrc * ximagesrc)
                 (guint8 *) src);
           }
         }
+
+        /* remember what the pointer covers in this image */
+        meta->cursor_rect.x = startx;
+        meta->cursor_rect.y = starty;
+        meta->cursor_rect.width = MAX (0, MIN (startx + iwidth,
+                (int) (ximagesrc->startx + ximagesrc->width)) - startx);
+        meta->cursor_rect.height = MAX (0, MIN (starty + iheight,
+                (int) (ximagesrc->starty + ximagesrc->height)) - starty);
       }
     }
   }
 #endif
 #ifdef HAVE_XDAMAGE
-  if (ximagesrc->have_xdamage && ximagesrc->use_damage) {
-    /* need to ref ximage to put in last_ximage */
-    gst_buffer_ref (ximage);
-    if (ximagesrc->last_ximage) {
-      gst_buffer_unref (ximagesrc->last_ximage);
-    }
-    ximagesrc->last_ximage = ximage;
-    GST_LOG_OBJECT (ximagesrc, "reffing current buffer for last_ximage");
-  }
+  if (ximagesrc->have_xdamage && ximagesrc->use_damage)
+    gst_ximage_src_add_damage_meta (ximagesrc, ximage, meta);
 #endif
   return ximage;
 }
@@ -38,6 +38,10 @@ G_BEGIN_DECLS
 #define GST_IS_XIMAGE_SRC(obj) (G_TYPE_CHECK_INSTANCE_TYPE((obj),GST_TYPE_XIMAGE_SRC))
 #define GST_IS_XIMAGE_SRC_CLASS(klass) (G_TYPE_CHECK_CLASS_TYPE((klass),GST_TYPE_XIMAGE_SRC))
 
+/* Number of frames whose damage is remembered, images that were last
+ * filled longer ago are retrieved entirely */
+#define GST_XIMAGE_SRC_DAMAGE_HISTORY 8
+
 typedef struct _GstXImageSrc GstXImageSrc;
 typedef struct _GstXImageSrcClass GstXImageSrcClass;
 
@@ -100,7 +104,14 @@ struct _GstXImageSrc
   int damage_event_base;
   XserverRegion damage_region;
   GC damage_copy_gc;
-  GstBuffer *last_ximage;
+
+  /* damage of the last frames, indexed by frame serial */
+  XserverRegion damage_history[GST_XIMAGE_SRC_DAMAGE_HISTORY];
+  guint64 frame_serial;
+  XserverRegion refresh_region;
+  XserverRegion clip_region;
+  /* where the pointer was drawn in the previous frame */
+  XRectangle last_cursor_rect;
 #endif
 };
 
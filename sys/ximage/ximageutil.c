@@ -49,6 +49,9 @@ gst_meta_ximage_init (GstMeta * meta, gpointer params, GstBuffer * buffer)
   emeta->SHMInfo.readOnly = TRUE;
 #endif
   emeta->width = emeta->height = emeta->size = 0;
+  emeta->serial = 0;
+  emeta->cursor_rect.x = emeta->cursor_rect.y = 0;
+  emeta->cursor_rect.width = emeta->cursor_rect.height = 0;
   emeta->return_func = NULL;
 
   return TRUE;
@@ -141,6 +141,8 @@ typedef gboolean (*BufferReturnFunc) (GstElement *parent, GstBuffer *buf);
  * @width: the width in pixels of XImage @ximage
  * @height: the height in pixels of XImage @ximage
  * @size: the size in bytes of XImage @ximage
+ * @serial: the frame whose content @ximage holds, 0 if unknown
+ * @cursor_rect: the area the pointer was drawn over
  *
  * Extra data attached to buffers containing additional information about an XImage.
  */
@@ -159,6 +161,9 @@ struct _GstMetaXImage {
   gint width, height;
   size_t size;
 
+  guint64 serial;
+  XRectangle cursor_rect;
+
   BufferReturnFunc return_func;
 };
 
@@ -116,6 +116,41 @@ create_buffer_rgba32 (FillColor color)
   return buf;
 }
 
+/* a mix of colours around and away from the green key colour */
+static GstBuffer *
+create_buffer_rgba32_pattern (void)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  int i;
+
+  buf = gst_buffer_new_and_alloc (HEIGHT * WIDTH * 4);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  for (i = 0; i < HEIGHT * WIDTH; i++) {
+    map.data[i * 4 + 0] = i * 20;
+    map.data[i * 4 + 1] = 255 - i * 8;
+    map.data[i * 4 + 2] = i * 12;
+    map.data[i * 4 + 3] = 0xff;
+  }
+  gst_buffer_unmap (buf, &map);
+
+  return buf;
+}
+
+/* push the pattern through @alpha and return the output */
+static GstBuffer *
+push_pattern (void)
+{
+  GstBuffer *outbuffer;
+
+  fail_unless_equals_int (gst_pad_push (srcpad,
+          create_buffer_rgba32_pattern ()), GST_FLOW_OK);
+  fail_unless (g_list_length (buffers) == 1);
+  outbuffer = (GstBuffer *) buffers->data;
+  buffers = g_list_remove (buffers, outbuffer);
+
+  return outbuffer;
+}
 
 GST_START_TEST (test_chromakeying)
 {
@@ -248,6 +283,63 @@ GST_START_TEST (test_alpha)
 
 GST_END_TEST;
 
+GST_START_TEST (test_chromakeying_method_change)
+{
+  GstElement *alpha;
+  GstBuffer *expected, *outbuffer;
+  GstCaps *incaps;
+
+  incaps = create_caps_rgba32 ();
+
+  /* keying green from the start */
+  alpha = setup_alpha ();
+  g_object_set (alpha, "method", 1, NULL);      /* Chroma-keying GREEN */
+  fail_unless_equals_int (gst_element_set_state (alpha, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+  gst_check_setup_events (srcpad, alpha, incaps, GST_FORMAT_TIME);
+  expected = push_pattern ();
+  fail_unless_equals_int (gst_element_set_state (alpha, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+  cleanup_alpha (alpha);
+
+  /* keying blue, then setting alpha with the default green target colour
+   * and then keying green has to give the same result */
+  alpha = setup_alpha ();
+  g_object_set (alpha, "method", 2, NULL);      /* Chroma-keying BLUE */
+  fail_unless_equals_int (gst_element_set_state (alpha, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+  gst_check_setup_events (srcpad, alpha, incaps, GST_FORMAT_TIME);
+  gst_buffer_unref (push_pattern ());
+
+  g_object_set (alpha, "method", 0, NULL);      /* Set alpha */
+  gst_buffer_unref (push_pattern ());
+
+  g_object_set (alpha, "method", 1, NULL);      /* Chroma-keying GREEN */
+  outbuffer = push_pattern ();
+  fail_unless (gst_buffer_memcmp (outbuffer, 0, expected, 0,
+          WIDTH * HEIGHT * 4) == 0);
+  gst_buffer_unref (outbuffer);
+
+  /* and changing the target colour away and back as well */
+  g_object_set (alpha, "method", 3, "target-g", 0, "target-b", 255, NULL);
+  gst_buffer_unref (push_pattern ());
+
+  g_object_set (alpha, "method", 1, "target-g", 255, "target-b", 0, NULL);
+  outbuffer = push_pattern ();
+  fail_unless (gst_buffer_memcmp (outbuffer, 0, expected, 0,
+          WIDTH * HEIGHT * 4) == 0);
+  gst_buffer_unref (outbuffer);
+
+  fail_unless_equals_int (gst_element_set_state (alpha, GST_STATE_NULL),
+      GST_STATE_CHANGE_SUCCESS);
+  cleanup_alpha (alpha);
+
+  gst_buffer_unref (expected);
+  gst_caps_unref (incaps);
+}
+
+GST_END_TEST;
+
 
 static Suite *
 alpha_suite (void)
@@ -258,6 +350,7 @@ alpha_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_alpha);
   tcase_add_test (tc_chain, test_chromakeying);
+  tcase_add_test (tc_chain, test_chromakeying_method_change);
 
   return s;
 }
@@ -24,6 +24,10 @@
 
 #include <gst/gst.h>
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+
+#include <math.h>
+#include <string.h>
 
 static gboolean have_eos = FALSE;
 
@@ -178,6 +182,154 @@ GST_START_TEST (test_pipeline)
 
 GST_END_TEST;
 
+#if G_BYTE_ORDER == G_BIG_ENDIAN
+#define F64_FORMAT "F64BE"
+#else
+#define F64_FORMAT "F64LE"
+#endif
+
+#define PARTITIONED_KERNEL_LENGTH 1000
+#define PARTITIONED_CHANNELS 3
+#define PARTITIONED_FRAMES 1024
+#define PARTITIONED_BUFFERS 10
+
+GST_START_TEST (test_partitioned)
+{
+  GstHarness *h;
+  GValueArray *va;
+  GValue v = { 0, };
+  gdouble kernel[PARTITIONED_KERNEL_LENGTH];
+  gdouble *in, *out;
+  guint i, c, u, n_in, n_out = 0;
+  guint max_fft_latency;
+  GstBuffer *buf;
+  GstMapInfo map;
+
+  n_in = PARTITIONED_FRAMES * PARTITIONED_BUFFERS;
+  in = g_new (gdouble, n_in * PARTITIONED_CHANNELS);
+  out = g_new0 (gdouble, n_in * PARTITIONED_CHANNELS);
+  for (i = 0; i < n_in * PARTITIONED_CHANNELS; i++)
+    in[i] = g_random_double_range (-1.0, 1.0);
+
+  va = g_value_array_new (PARTITIONED_KERNEL_LENGTH);
+  g_value_init (&v, G_TYPE_DOUBLE);
+  for (i = 0; i < PARTITIONED_KERNEL_LENGTH; i++) {
+    kernel[i] = g_random_double_range (-1.0, 1.0);
+    g_value_set_double (&v, kernel[i]);
+    g_value_array_append (va, &v);
+  }
+  g_value_unset (&v);
+
+  h = gst_harness_new ("audiofirfilter");
+  /* the kernel is split into 4 partitions of 256 samples */
+  g_object_set (h->element, "max-fft-latency", 300, "kernel", va, NULL);
+  g_object_get (h->element, "max-fft-latency", &max_fft_latency, NULL);
+  fail_unless_equals_int (max_fft_latency, 300);
+  g_value_array_free (va);
+
+  gst_harness_set_src_caps_str (h, "audio/x-raw, format = (string) "
+      F64_FORMAT ", layout = (string) interleaved, rate = (int) 48000, "
+      "channels = (int) 3");
+
+  for (i = 0; i < PARTITIONED_BUFFERS; i++) {
+    gsize size = PARTITIONED_FRAMES * PARTITIONED_CHANNELS * sizeof (gdouble);
+
+    buf = gst_buffer_new_wrapped (g_memdup (in + i * PARTITIONED_FRAMES *
+            PARTITIONED_CHANNELS, size), size);
+    GST_BUFFER_TIMESTAMP (buf) =
+        gst_util_uint64_scale_int (i * PARTITIONED_FRAMES, GST_SECOND, 48000);
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+
+  while ((buf = gst_harness_try_pull (h))) {
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    /* output is generated in whole partitions */
+    fail_unless_equals_int (map.size % (256 * PARTITIONED_CHANNELS *
+            sizeof (gdouble)), 0);
+    fail_unless (n_out + map.size / PARTITIONED_CHANNELS / sizeof (gdouble) <=
+        n_in);
+    memcpy (out + n_out * PARTITIONED_CHANNELS, map.data, map.size);
+    n_out += map.size / PARTITIONED_CHANNELS / sizeof (gdouble);
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+  fail_unless (n_out > n_in - 256);
+
+  /* compare with the plain convolution */
+  for (i = 0; i < n_out; i++) {
+    for (c = 0; c < PARTITIONED_CHANNELS; c++) {
+      gdouble expected = 0.0;
+
+      for (u = 0; u < PARTITIONED_KERNEL_LENGTH && u <= i; u++)
+        expected += in[(i - u) * PARTITIONED_CHANNELS + c] * kernel[u];
+
+      fail_unless (fabs (out[i * PARTITIONED_CHANNELS + c] - expected) < 1e-9,
+          "frame %u channel %u: %g != %g", i, c,
+          out[i * PARTITIONED_CHANNELS + c], expected);
+    }
+  }
+
+  gst_harness_teardown (h);
+  g_free (in);
+  g_free (out);
+}
+
+GST_END_TEST;
+
+static void
+set_random_kernel (GstElement * element, guint length)
+{
+  GValueArray *va;
+  GValue v = { 0, };
+  guint i;
+
+  va = g_value_array_new (length);
+  g_value_init (&v, G_TYPE_DOUBLE);
+  for (i = 0; i < length; i++) {
+    g_value_set_double (&v, g_random_double_range (-1.0, 1.0));
+    g_value_array_append (va, &v);
+  }
+  g_value_unset (&v);
+
+  g_object_set (element, "kernel", va, NULL);
+  g_value_array_free (va);
+}
+
+/* A new kernel with the same partitioning keeps the input history when
+ * draining on changes is enabled, and processing must continue */
+GST_START_TEST (test_partitioned_kernel_change)
+{
+  GstHarness *h;
+  GstBuffer *buf;
+  gsize size = PARTITIONED_FRAMES * sizeof (gdouble);
+  guint i;
+
+  h = gst_harness_new ("audiofirfilter");
+  g_object_set (h->element, "max-fft-latency", 300, NULL);
+  set_random_kernel (h->element, PARTITIONED_KERNEL_LENGTH);
+
+  gst_harness_set_src_caps_str (h, "audio/x-raw, format = (string) "
+      F64_FORMAT ", layout = (string) interleaved, rate = (int) 48000, "
+      "channels = (int) 1");
+
+  for (i = 0; i < 3; i++) {
+    if (i == 2)
+      set_random_kernel (h->element, PARTITIONED_KERNEL_LENGTH);
+
+    buf = gst_buffer_new_wrapped (g_malloc0 (size), size);
+    GST_BUFFER_TIMESTAMP (buf) =
+        gst_util_uint64_scale_int (i * PARTITIONED_FRAMES, GST_SECOND, 48000);
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+
+  /* nothing was drained, all output is for the pushed input */
+  fail_unless_equals_int (gst_harness_buffers_received (h), 3);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 static Suite *
 audiofirfilter_suite (void)
 {
@@ -186,6 +338,8 @@ audiofirfilter_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_pipeline);
+  tcase_add_test (tc_chain, test_partitioned);
+  tcase_add_test (tc_chain, test_partitioned_kernel_change);
 
   return s;
 }
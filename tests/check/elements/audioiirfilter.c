@@ -22,8 +22,12 @@
  * with newer GLib versions (>= 2.31.0) */
 #define GLIB_DISABLE_DEPRECATION_WARNINGS
 
+#include <string.h>
+
 #include <gst/gst.h>
+#include <gst/audio/audio.h>
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
 
 static gboolean have_eos = FALSE;
 
@@ -175,6 +179,153 @@ GST_START_TEST (test_pipeline)
 
 GST_END_TEST;
 
+/* Straightforward direct form implementation that the optimized filter
+ * has to match bit by bit */
+typedef struct
+{
+  gdouble x[16], y[16];
+  gint x_pos, y_pos;
+} RefChannel;
+
+static gdouble
+ref_process (const gdouble * a, gint na, const gdouble * b, gint nb,
+    RefChannel * ctx, gdouble x0)
+{
+  gdouble val = b[0] * x0;
+  gint i, j;
+
+  for (i = 1, j = ctx->x_pos; i < nb; i++) {
+    val += b[i] * ctx->x[j];
+    j = (j > 0) ? j - 1 : nb - 1;
+  }
+  for (i = 1, j = ctx->y_pos; i < na; i++) {
+    val -= a[i] * ctx->y[j];
+    j = (j > 0) ? j - 1 : na - 1;
+  }
+  val /= a[0];
+
+  ctx->x_pos = (ctx->x_pos + 1) % nb;
+  ctx->x[ctx->x_pos] = x0;
+  ctx->y_pos = (ctx->y_pos + 1) % na;
+  ctx->y[ctx->y_pos] = val;
+
+  return val;
+}
+
+static void
+set_coefficients (GstElement * filter, const gchar * name, const gdouble * c,
+    guint n)
+{
+  GValueArray *va;
+  GValue v = { 0, };
+  guint i;
+
+  va = g_value_array_new (n);
+  g_value_init (&v, G_TYPE_DOUBLE);
+  for (i = 0; i < n; i++) {
+    g_value_set_double (&v, c[i]);
+    g_value_array_append (va, &v);
+  }
+  g_value_unset (&v);
+
+  g_object_set (G_OBJECT (filter), name, va, NULL);
+  g_value_array_free (va);
+}
+
+#define BITEXACT_CHANNELS 11
+
+static void
+check_bitexact (gboolean is_double)
+{
+  /* 8th order, stable and not normalized to a[0] == 1 */
+  static const gdouble a[] = { 2.0, -2.4, 1.8, -0.6, 0.24, -0.1, 0.02,
+    -0.006, 0.001
+  };
+  static const gdouble b[] = { 0.2, 0.1, 0.04, 0.02, 0.06, 0.02, 0.01,
+    0.004, 0.002
+  };
+  static const guint frames[] = { 100, 333, 1024, 7, 1, 600 };
+  RefChannel ref[BITEXACT_CHANNELS];
+  GstHarness *h;
+  GRand *rand;
+  guint bps = is_double ? sizeof (gdouble) : sizeof (gfloat);
+  guint i, j;
+
+  memset (ref, 0, sizeof (ref));
+  rand = g_rand_new_with_seed (42);
+
+  h = gst_harness_new ("audioiirfilter");
+  set_coefficients (h->element, "a", a, G_N_ELEMENTS (a));
+  set_coefficients (h->element, "b", b, G_N_ELEMENTS (b));
+  gst_harness_set_src_caps_str (h, is_double ?
+      "audio/x-raw, format=(string)" GST_AUDIO_NE (F64) ", rate=44100, "
+      "channels=11, layout=interleaved" :
+      "audio/x-raw, format=(string)" GST_AUDIO_NE (F32) ", rate=44100, "
+      "channels=11, layout=interleaved");
+
+  for (i = 0; i < G_N_ELEMENTS (frames); i++) {
+    guint n = frames[i] * BITEXACT_CHANNELS;
+    gdouble *in = g_new (gdouble, n);
+    GstBuffer *buf;
+    GstMapInfo map;
+
+    buf = gst_buffer_new_allocate (NULL, n * bps, NULL);
+    gst_buffer_map (buf, &map, GST_MAP_WRITE);
+    for (j = 0; j < n; j++) {
+      in[j] = g_rand_double_range (rand, -1.0, 1.0);
+      if (is_double)
+        ((gdouble *) map.data)[j] = in[j];
+      else
+        ((gfloat *) map.data)[j] = in[j];
+    }
+    gst_buffer_unmap (buf, &map);
+
+    buf = gst_harness_push_and_pull (h, buf);
+    fail_unless (buf != NULL);
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, n * bps);
+
+    for (j = 0; j < n; j++) {
+      RefChannel *ctx = &ref[j % BITEXACT_CHANNELS];
+
+      if (is_double) {
+        gdouble expected = ref_process (a, G_N_ELEMENTS (a), b,
+            G_N_ELEMENTS (b), ctx, in[j]);
+
+        fail_unless (memcmp (&((gdouble *) map.data)[j], &expected,
+                sizeof (gdouble)) == 0, "sample %u differs", j);
+      } else {
+        gfloat expected = ref_process (a, G_N_ELEMENTS (a), b,
+            G_N_ELEMENTS (b), ctx, (gfloat) in[j]);
+
+        fail_unless (memcmp (&((gfloat *) map.data)[j], &expected,
+                sizeof (gfloat)) == 0, "sample %u differs", j);
+      }
+    }
+
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+    g_free (in);
+  }
+
+  gst_harness_teardown (h);
+  g_rand_free (rand);
+}
+
+GST_START_TEST (test_bitexact_32)
+{
+  check_bitexact (FALSE);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_bitexact_64)
+{
+  check_bitexact (TRUE);
+}
+
+GST_END_TEST;
+
 static Suite *
 audioiirfilter_suite (void)
 {
@@ -183,6 +334,8 @@ audioiirfilter_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_pipeline);
+  tcase_add_test (tc_chain, test_bitexact_32);
+  tcase_add_test (tc_chain, test_bitexact_64);
 
   return s;
 }
@@ -24,8 +24,10 @@
 #include <gst/audio/audio.h>
 #include <gst/base/gstbasetransform.h>
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
 
 #include <math.h>
+#include <string.h>
 
 /* For ease of programming we use globals to keep refs for our floating
  * src and sink pads we create; otherwise we always have to do get_pad,
@@ -360,6 +362,97 @@ GST_START_TEST (test_equalizer_presets)
 
 GST_END_TEST;
 
+#define MULTICHANNEL_FRAMES 1000
+
+/* Runs two buffers through a 31 band equalizer and changes the gains of
+ * some bands in between, returns the output of both buffers */
+static gfloat *
+run_31bands (gint channels, const gfloat * in)
+{
+  GstHarness *h;
+  GstBuffer *buf;
+  GstMapInfo map;
+  gfloat *out;
+  gsize size = MULTICHANNEL_FRAMES * channels * sizeof (gfloat);
+  gchar *caps;
+  gint i;
+
+  h = gst_harness_new ("equalizer-nbands");
+  g_object_set (h->element, "num-bands", 31, NULL);
+  for (i = 0; i < 31; i++) {
+    GObject *band =
+        gst_child_proxy_get_child_by_index (GST_CHILD_PROXY (h->element), i);
+
+    g_object_set (band, "gain", (i % 2) ? -6.0 : 4.0, NULL);
+    g_object_unref (band);
+  }
+
+  caps = g_strdup_printf ("audio/x-raw, format = (string) " GST_AUDIO_NE (F32)
+      ", layout = (string) interleaved, rate = (int) 48000, "
+      "channels = (int) %d", channels);
+  gst_harness_set_src_caps_str (h, caps);
+  g_free (caps);
+
+  out = g_malloc (2 * size);
+  for (i = 0; i < 2; i++) {
+    if (i == 1) {
+      /* the new coefficients are ramped to over the next blocks */
+      gst_child_proxy_set (GST_CHILD_PROXY (h->element),
+          "band3::gain", -24.0, "band17::gain", 12.0, NULL);
+    }
+
+    buf = gst_buffer_new_wrapped (g_memdup (in + i * size / sizeof (gfloat),
+            size), size);
+    GST_BUFFER_TIMESTAMP (buf) = i * MULTICHANNEL_FRAMES * GST_SECOND / 48000;
+    buf = gst_harness_push_and_pull (h, buf);
+    fail_unless (buf != NULL);
+
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, size);
+    memcpy ((guint8 *) out + i * size, map.data, size);
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+
+  return out;
+}
+
+GST_START_TEST (test_equalizer_31bands_multichannel)
+{
+  gfloat *mono, *multi, *mono_out, *multi_out;
+  gint i, c, channels = 6;
+
+  mono = g_new (gfloat, 2 * MULTICHANNEL_FRAMES);
+  multi = g_new (gfloat, 2 * MULTICHANNEL_FRAMES * channels);
+  for (i = 0; i < 2 * MULTICHANNEL_FRAMES; i++) {
+    mono[i] = g_random_double_range (-0.5, 0.5);
+    for (c = 0; c < channels; c++)
+      multi[i * channels + c] = mono[i];
+  }
+
+  mono_out = run_31bands (1, mono);
+  multi_out = run_31bands (channels, multi);
+
+  /* every channel is filtered on its own, with the same result as a mono
+   * stream, including while the coefficients are ramped */
+  for (i = 0; i < 2 * MULTICHANNEL_FRAMES; i++) {
+    fail_unless (isfinite (mono_out[i]));
+    for (c = 0; c < channels; c++)
+      fail_unless (multi_out[i * channels + c] == mono_out[i],
+          "frame %d channel %d: %f != %f", i, c, multi_out[i * channels + c],
+          mono_out[i]);
+  }
+
+  g_free (mono);
+  g_free (multi);
+  g_free (mono_out);
+  g_free (multi_out);
+}
+
+GST_END_TEST;
+
 
 static Suite *
 equalizer_suite (void)
@@ -373,6 +466,7 @@ equalizer_suite (void)
   tcase_add_test (tc_chain, test_equalizer_5bands_plus_12);
   tcase_add_test (tc_chain, test_equalizer_band_number_changing);
   tcase_add_test (tc_chain, test_equalizer_presets);
+  tcase_add_test (tc_chain, test_equalizer_31bands_multichannel);
 
   return s;
 }
@@ -20,6 +20,7 @@
 #include <string.h>
 
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
 #include <gst/video/video.h>
 
 static gboolean
@@ -562,6 +563,238 @@ GST_START_TEST (test_imagefreeze_eos)
 
 GST_END_TEST;
 
+static void
+sink_handoff_cb_shared_memory (GstElement * object, GstBuffer * buffer,
+    GstPad * pad, gpointer user_data)
+{
+  GstMemory **memory = (GstMemory **) user_data;
+
+  fail_unless_equals_int (gst_buffer_n_memory (buffer), 1);
+
+  /* all output buffers share the memory of the input frame */
+  if (*memory == NULL)
+    *memory = gst_buffer_get_memory (buffer, 0);
+  else
+    fail_unless (gst_buffer_peek_memory (buffer, 0) == *memory);
+}
+
+GST_START_TEST (test_imagefreeze_shared_memory)
+{
+  GstElement *pipeline;
+  GstCaps *caps1, *caps2;
+  GstBus *bus;
+  GMainLoop *loop;
+  GstMemory *memory = NULL;
+  guint bus_watch = 0;
+  GstVideoInfo i1, i2;
+
+  gst_video_info_init (&i1);
+  gst_video_info_set_format (&i1, GST_VIDEO_FORMAT_xRGB, 640, 480);
+  i1.fps_n = 25;
+  i1.fps_d = 1;
+  caps1 = gst_video_info_to_caps (&i1);
+
+  gst_video_info_init (&i2);
+  gst_video_info_set_format (&i2, GST_VIDEO_FORMAT_xRGB, 640, 480);
+  i2.fps_n = 25;
+  i2.fps_d = 1;
+  caps2 = gst_video_info_to_caps (&i2);
+
+  pipeline =
+      setup_imagefreeze (caps1, caps2,
+      G_CALLBACK (sink_handoff_cb_shared_memory), &memory);
+
+  loop = g_main_loop_new (NULL, TRUE);
+  fail_unless (loop != NULL);
+
+  bus = gst_element_get_bus (pipeline);
+  fail_unless (bus != NULL);
+  bus_watch = gst_bus_add_watch (bus, bus_handler, loop);
+  gst_object_unref (bus);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PAUSED),
+      GST_STATE_CHANGE_SUCCESS);
+
+  fail_unless (gst_element_seek (pipeline, 1.0, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH, GST_SEEK_TYPE_SET, 0, GST_SEEK_TYPE_SET,
+          400 * GST_MSECOND));
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  g_main_loop_run (loop);
+
+  fail_unless (memory != NULL);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  gst_memory_unref (memory);
+  gst_object_unref (pipeline);
+  g_main_loop_unref (loop);
+  gst_caps_unref (caps1);
+  gst_caps_unref (caps2);
+  g_source_remove (bus_watch);
+}
+
+GST_END_TEST;
+
+static void
+sink_handoff_cb_qos (GstElement * object, GstBuffer * buffer, GstPad * pad,
+    gpointer user_data)
+{
+  GList **timestamps = (GList **) user_data;
+
+  /* the first frame was 200ms late, which makes imagefreeze skip everything
+   * up to 400ms to catch up */
+  if (*timestamps == NULL)
+    fail_unless (gst_pad_push_event (pad,
+            gst_event_new_qos (GST_QOS_TYPE_UNDERFLOW, 0.5, 200 * GST_MSECOND,
+                GST_BUFFER_TIMESTAMP (buffer))));
+
+  *timestamps = g_list_append (*timestamps,
+      GUINT_TO_POINTER (GST_BUFFER_TIMESTAMP (buffer) / GST_MSECOND));
+}
+
+static void
+sync_message_qos (GstBus * bus, GstMessage * message, gpointer data)
+{
+  guint *n_qos = (guint *) data;
+
+  if (GST_MESSAGE_TYPE (message) == GST_MESSAGE_QOS) {
+    guint64 processed, dropped;
+    GstFormat format;
+
+    gst_message_parse_qos_stats (message, &format, &processed, &dropped);
+    fail_unless_equals_int (format, GST_FORMAT_BUFFERS);
+    fail_unless_equals_uint64 (processed, 1);
+    *n_qos = *n_qos + 1;
+    fail_unless_equals_uint64 (dropped, *n_qos);
+  }
+}
+
+GST_START_TEST (test_imagefreeze_qos)
+{
+  GstElement *pipeline, *imagefreeze;
+  GstCaps *caps1, *caps2;
+  GstBus *bus;
+  GMainLoop *loop;
+  GList *timestamps = NULL, *l;
+  guint bus_watch = 0, qos_watch = 0, n_qos = 0;
+  GstVideoInfo i1, i2;
+  guint expected;
+
+  gst_video_info_init (&i1);
+  gst_video_info_set_format (&i1, GST_VIDEO_FORMAT_xRGB, 640, 480);
+  i1.fps_n = 25;
+  i1.fps_d = 1;
+  caps1 = gst_video_info_to_caps (&i1);
+
+  gst_video_info_init (&i2);
+  gst_video_info_set_format (&i2, GST_VIDEO_FORMAT_xRGB, 640, 480);
+  i2.fps_n = 25;
+  i2.fps_d = 1;
+  caps2 = gst_video_info_to_caps (&i2);
+
+  pipeline =
+      setup_imagefreeze (caps1, caps2, G_CALLBACK (sink_handoff_cb_qos),
+      &timestamps);
+
+  imagefreeze = gst_bin_get_by_name (GST_BIN (pipeline), "freeze");
+  g_object_set (imagefreeze, "qos", TRUE, NULL);
+  gst_object_unref (imagefreeze);
+
+  loop = g_main_loop_new (NULL, TRUE);
+  fail_unless (loop != NULL);
+
+  bus = gst_element_get_bus (pipeline);
+  fail_unless (bus != NULL);
+  bus_watch = gst_bus_add_watch (bus, bus_handler, loop);
+  gst_bus_enable_sync_message_emission (bus);
+  qos_watch = g_signal_connect (bus, "sync-message::qos",
+      G_CALLBACK (sync_message_qos), &n_qos);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PAUSED),
+      GST_STATE_CHANGE_SUCCESS);
+
+  fail_unless (gst_element_seek (pipeline, 1.0, GST_FORMAT_TIME,
+          GST_SEEK_FLAG_FLUSH, GST_SEEK_TYPE_SET, 0, GST_SEEK_TYPE_SET,
+          1000 * GST_MSECOND));
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PLAYING),
+      GST_STATE_CHANGE_SUCCESS);
+
+  g_main_loop_run (loop);
+
+  /* the frames ending at or before 400ms were dropped */
+  fail_unless_equals_int (n_qos, 9);
+  fail_unless_equals_int (g_list_length (timestamps), 1 + 15);
+  fail_unless_equals_int (GPOINTER_TO_UINT (timestamps->data), 0);
+  expected = 400;
+  for (l = timestamps->next; l; l = l->next) {
+    fail_unless_equals_int (GPOINTER_TO_UINT (l->data), expected);
+    expected += 40;
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+
+  g_signal_handler_disconnect (bus, qos_watch);
+  gst_bus_disable_sync_message_emission (bus);
+  gst_object_unref (bus);
+  g_list_free (timestamps);
+  gst_object_unref (pipeline);
+  g_main_loop_unref (loop);
+  gst_caps_unref (caps1);
+  gst_caps_unref (caps2);
+  g_source_remove (bus_watch);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_imagefreeze_no_share)
+{
+  GstHarness *h;
+  GstBuffer *inbuf, *outbuf;
+  GstMemory *memory = NULL;
+  gint i;
+
+  h = gst_harness_new ("imagefreeze");
+  gst_harness_set_src_caps_str (h, "video/x-raw,format=xRGB,width=64,"
+      "height=48,framerate=25/1");
+
+  /* like the memory of some hardware buffer pools */
+  inbuf = gst_buffer_new_allocate (NULL, 64 * 48 * 4, NULL);
+  GST_MINI_OBJECT_FLAG_SET (gst_buffer_peek_memory (inbuf, 0),
+      GST_MEMORY_FLAG_NO_SHARE);
+
+  fail_unless_equals_int (gst_harness_push (h, gst_buffer_ref (inbuf)),
+      GST_FLOW_OK);
+
+  for (i = 0; i < 3; i++) {
+    outbuf = gst_harness_pull (h);
+    fail_unless (outbuf != NULL);
+    fail_unless_equals_int (gst_buffer_n_memory (outbuf), 1);
+
+    /* copied once on input, then shared by all output frames */
+    if (memory == NULL) {
+      memory = gst_buffer_get_memory (outbuf, 0);
+      fail_if (memory == gst_buffer_peek_memory (inbuf, 0));
+      fail_if (GST_MEMORY_IS_NO_SHARE (memory));
+    } else {
+      fail_unless (gst_buffer_peek_memory (outbuf, 0) == memory);
+    }
+    gst_buffer_unref (outbuf);
+  }
+
+  /* the input buffer was released right away */
+  ASSERT_BUFFER_REFCOUNT (inbuf, "inbuf", 1);
+
+  gst_memory_unref (memory);
+  gst_buffer_unref (inbuf);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 static Suite *
 imagefreeze_suite (void)
 {
@@ -579,6 +812,9 @@ imagefreeze_suite (void)
   tcase_add_test (tc_chain, test_imagefreeze_25_1_220ms_380ms);
 
   tcase_add_test (tc_chain, test_imagefreeze_eos);
+  tcase_add_test (tc_chain, test_imagefreeze_shared_memory);
+  tcase_add_test (tc_chain, test_imagefreeze_qos);
+  tcase_add_test (tc_chain, test_imagefreeze_no_share);
 
   return s;
 }
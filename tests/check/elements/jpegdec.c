@@ -23,7 +23,9 @@
 
 #include <gio/gio.h>
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
 #include <gst/app/gstappsink.h>
+#include <gst/video/video.h>
 #include <gst/pbutils/gstdiscoverer.h>
 
 /* Verify jpegdec is working when explictly requested by a pipeline. */
@@ -78,6 +80,59 @@ GST_START_TEST (test_jpegdec_explicit)
 
 GST_END_TEST;
 
+/* Verify jpegdec decodes at a smaller size if downstream requires that */
+GST_START_TEST (test_jpegdec_scaled)
+{
+  GstElement *pipeline, *source, *dec, *sink;
+  GstSample *sample;
+  GstCaps *caps;
+
+  pipeline = gst_pipeline_new (NULL);
+  source = gst_element_factory_make ("filesrc", NULL);
+  dec = gst_element_factory_make ("jpegdec", NULL);
+  sink = gst_element_factory_make ("appsink", NULL);
+
+  /* image.jpg is 120x160, only allow a quarter of that */
+  caps = gst_caps_from_string ("video/x-raw, width=30, height=40");
+  g_object_set (G_OBJECT (sink), "caps", caps, NULL);
+  gst_caps_unref (caps);
+
+  gst_bin_add_many (GST_BIN (pipeline), source, dec, sink, NULL);
+  gst_element_link_many (source, dec, sink, NULL);
+
+  {
+    char *filename = g_build_filename (GST_TEST_FILES_PATH, "image.jpg", NULL);
+    g_object_set (G_OBJECT (source), "location", filename, NULL);
+    g_free (filename);
+  }
+
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  sample = gst_app_sink_pull_sample (GST_APP_SINK (sink));
+  fail_unless (GST_IS_SAMPLE (sample));
+
+  {
+    GstVideoInfo info;
+
+    fail_unless (gst_video_info_from_caps (&info,
+            gst_sample_get_caps (sample)));
+    fail_unless_equals_int (GST_VIDEO_INFO_WIDTH (&info), 30);
+    fail_unless_equals_int (GST_VIDEO_INFO_HEIGHT (&info), 40);
+    fail_unless (gst_buffer_get_size (gst_sample_get_buffer (sample)) >=
+        GST_VIDEO_INFO_SIZE (&info));
+  }
+  gst_sample_unref (sample);
+
+  sample = gst_app_sink_pull_sample (GST_APP_SINK (sink));
+  fail_unless (sample == NULL);
+  fail_unless (gst_app_sink_is_eos (GST_APP_SINK (sink)));
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+GST_END_TEST;
+
 /* Verify JPEG discovery is working. Right now jpegdec would be used,
  * but I have no idea how to actually verify this. */
 GST_START_TEST (test_jpegdec_discover)
@@ -125,6 +180,164 @@ GST_START_TEST (test_jpegdec_discover)
 
 GST_END_TEST;
 
+#define N_BENCH_FRAMES 200
+
+/* Decodes image.jpg N_BENCH_FRAMES times, returns the output buffers in
+ * a list and the throughput in frames per second */
+static GList *
+decode_frames (gint max_threads, gdouble * fps)
+{
+  GstHarness *h;
+  GstBuffer *jpeg, *buf;
+  GList *outbufs = NULL;
+  gchar *filename, *data, *launch;
+  gsize size;
+  gint64 start;
+  guint i;
+
+  filename = g_build_filename (GST_TEST_FILES_PATH, "image.jpg", NULL);
+  fail_unless (g_file_get_contents (filename, &data, &size, NULL));
+  g_free (filename);
+  jpeg = gst_buffer_new_wrapped (data, size);
+
+  launch = g_strdup_printf ("jpegdec max-threads=%d", max_threads);
+  h = gst_harness_new_parse (launch);
+  g_free (launch);
+  gst_harness_set_src_caps_str (h, "image/jpeg, framerate=(fraction)30/1");
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < N_BENCH_FRAMES; i++) {
+    buf = gst_buffer_copy (jpeg);
+    GST_BUFFER_PTS (buf) = gst_util_uint64_scale (i, GST_SECOND, 30);
+    GST_BUFFER_DURATION (buf) = gst_util_uint64_scale (1, GST_SECOND, 30);
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+
+  for (i = 0; i < N_BENCH_FRAMES; i++)
+    outbufs = g_list_append (outbufs, gst_harness_pull (h));
+  *fps = N_BENCH_FRAMES * (gdouble) G_USEC_PER_SEC /
+      (g_get_monotonic_time () - start);
+
+  gst_buffer_unref (jpeg);
+  gst_harness_teardown (h);
+
+  return outbufs;
+}
+
+/* Verify frames decoded in parallel come out complete and in order */
+GST_START_TEST (test_jpegdec_parallel)
+{
+  GList *serial, *parallel, *s, *p;
+  gdouble serial_fps, parallel_fps;
+  GstMapInfo smap, pmap;
+  guint i = 0;
+
+  serial = decode_frames (1, &serial_fps);
+  parallel = decode_frames (4, &parallel_fps);
+
+  GST_INFO ("serial: %.1f fps, 4 threads: %.1f fps", serial_fps,
+      parallel_fps);
+
+  fail_unless_equals_int (g_list_length (parallel), N_BENCH_FRAMES);
+
+  for (s = serial, p = parallel; s && p; s = s->next, p = p->next, i++) {
+    GstBuffer *sbuf = s->data, *pbuf = p->data;
+
+    fail_unless_equals_uint64 (GST_BUFFER_PTS (pbuf),
+        gst_util_uint64_scale (i, GST_SECOND, 30));
+
+    fail_unless (gst_buffer_map (sbuf, &smap, GST_MAP_READ));
+    fail_unless (gst_buffer_map (pbuf, &pmap, GST_MAP_READ));
+    fail_unless_equals_int (smap.size, pmap.size);
+    fail_unless (memcmp (smap.data, pmap.data, smap.size) == 0);
+    gst_buffer_unmap (sbuf, &smap);
+    gst_buffer_unmap (pbuf, &pmap);
+  }
+
+  g_list_free_full (serial, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (parallel, (GDestroyNotify) gst_buffer_unref);
+}
+
+GST_END_TEST;
+
+/* Decodes image.jpg once with @launch, returns the output buffer and its
+ * video info */
+static GstBuffer *
+decode_image (const gchar * launch, GstVideoInfo * info)
+{
+  GstHarness *h;
+  GstBuffer *buf;
+  GstCaps *caps;
+  gchar *filename, *data;
+  gsize size;
+
+  filename = g_build_filename (GST_TEST_FILES_PATH, "image.jpg", NULL);
+  fail_unless (g_file_get_contents (filename, &data, &size, NULL));
+  g_free (filename);
+
+  h = gst_harness_new_parse (launch);
+  gst_harness_set_src_caps_str (h, "image/jpeg, framerate=(fraction)30/1");
+
+  fail_unless_equals_int (gst_harness_push (h,
+          gst_buffer_new_wrapped (data, size)), GST_FLOW_OK);
+  fail_unless (gst_harness_push_event (h, gst_event_new_eos ()));
+  buf = gst_harness_pull (h);
+  fail_unless (buf != NULL);
+
+  caps = gst_pad_get_current_caps (h->sinkpad);
+  fail_unless (gst_video_info_from_caps (info, caps));
+  gst_caps_unref (caps);
+
+  gst_harness_teardown (h);
+
+  return buf;
+}
+
+/* Verify only the region of interest is output, and that it matches the
+ * same part of the fully decoded image */
+GST_START_TEST (test_jpegdec_crop)
+{
+  GstVideoInfo full_info, crop_info;
+  GstVideoFrame full, crop;
+  GstBuffer *full_buf, *crop_buf;
+  const guint8 *full_y, *crop_y;
+  gint i;
+
+  full_buf = decode_image ("jpegdec", &full_info);
+  crop_buf = decode_image ("jpegdec crop-left=20 crop-right=36 crop-top=40 "
+      "crop-bottom=8", &crop_info);
+
+  /* image.jpg is 120x160 */
+  fail_unless_equals_int (GST_VIDEO_INFO_WIDTH (&crop_info), 64);
+  fail_unless_equals_int (GST_VIDEO_INFO_HEIGHT (&crop_info), 112);
+  fail_unless_equals_int (GST_VIDEO_INFO_FORMAT (&crop_info),
+      GST_VIDEO_INFO_FORMAT (&full_info));
+
+  fail_unless (gst_video_frame_map (&full, &full_info, full_buf,
+          GST_MAP_READ));
+  fail_unless (gst_video_frame_map (&crop, &crop_info, crop_buf,
+          GST_MAP_READ));
+
+  /* the luma is decoded the same way with and without cropping */
+  for (i = 0; i < 112; i++) {
+    full_y = GST_VIDEO_FRAME_COMP_DATA (&full, 0) +
+        (40 + i) * GST_VIDEO_FRAME_COMP_STRIDE (&full, 0) +
+        20 * GST_VIDEO_FRAME_COMP_PSTRIDE (&full, 0);
+    crop_y = GST_VIDEO_FRAME_COMP_DATA (&crop, 0) +
+        i * GST_VIDEO_FRAME_COMP_STRIDE (&crop, 0);
+    fail_unless (memcmp (full_y, crop_y,
+            64 * GST_VIDEO_FRAME_COMP_PSTRIDE (&crop, 0)) == 0);
+  }
+
+  gst_video_frame_unmap (&full);
+  gst_video_frame_unmap (&crop);
+  gst_buffer_unref (full_buf);
+  gst_buffer_unref (crop_buf);
+}
+
+GST_END_TEST;
+
 static Suite *
 jpegdec_suite (void)
 {
@@ -134,6 +347,9 @@ jpegdec_suite (void)
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_jpegdec_explicit);
   tcase_add_test (tc_chain, test_jpegdec_discover);
+  tcase_add_test (tc_chain, test_jpegdec_scaled);
+  tcase_add_test (tc_chain, test_jpegdec_parallel);
+  tcase_add_test (tc_chain, test_jpegdec_crop);
 
   return s;
 }
@@ -20,7 +20,13 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
 #include <unistd.h>
+#include <string.h>
+#include <math.h>
 
 /* suppress warnings for deprecated API such as GValueArray
  * with newer GLib versions (>= 2.31.0) */
@@ -28,6 +34,8 @@
 
 #include <gst/audio/audio.h>
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <glib/gstdio.h>
 
 /* For ease of programming we use globals to keep refs for our floating
  * src and sink pads we create; otherwise we always have to do get_pad,
@@ -590,11 +598,183 @@ GST_START_TEST (test_message_timestamps)
 
 GST_END_TEST;
 
+#define LEVEL_F32_MANY_CHANNELS 24
+
+/* 0.1 sec buffer with a block signal of a different amplitude per channel */
+static GstBuffer *
+create_f32_many_channels_buffer (void)
+{
+  GstBuffer *buf =
+      gst_buffer_new_and_alloc (LEVEL_F32_MANY_CHANNELS * 100 *
+      sizeof (gfloat));
+  GstMapInfo map;
+  gint i, j;
+  gfloat *data;
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  data = (gfloat *) map.data;
+  for (j = 0; j < 100; ++j) {
+    for (i = 0; i < LEVEL_F32_MANY_CHANNELS; ++i)
+      *(data++) = (j % 2 ? 1.0 : -1.0) / (i + 1);
+  }
+  gst_buffer_unmap (buf, &map);
+  GST_BUFFER_TIMESTAMP (buf) = G_GUINT64_CONSTANT (0);
+  return buf;
+}
+
+static GstHarness *
+setup_level_many_channels (void)
+{
+  GstHarness *h;
+  gchar *caps;
+
+  h = gst_harness_new ("level");
+  caps = g_strdup_printf ("audio/x-raw, format = (string) " GST_AUDIO_NE (F32)
+      ", layout = (string) interleaved, rate = (int) 1000, "
+      "channels = (int) %d, channel-mask = (bitmask) 0",
+      LEVEL_F32_MANY_CHANNELS);
+  gst_harness_set_src_caps_str (h, caps);
+  g_free (caps);
+
+  return h;
+}
+
+static void
+check_many_channels_levels (const gdouble * values)
+{
+  gint i;
+
+  /* rms, peak and decay of a block wave are all the amplitude in dB */
+  for (i = 0; i < 3 * LEVEL_F32_MANY_CHANNELS; ++i) {
+    gdouble expected = -20 * log10 (i % LEVEL_F32_MANY_CHANNELS + 1);
+
+    GST_DEBUG ("value %d is %lf", i, values[i]);
+    fail_unless (fabs (values[i] - expected) < 0.001,
+        "value %d is %lf, expected %lf", i, values[i], expected);
+  }
+}
+
+GST_START_TEST (test_packed_messages)
+{
+  GstHarness *h;
+  GstBus *bus;
+  GstMessage *message;
+  const GstStructure *structure;
+  const gchar *fields[3] = { "rms", "peak", "decay" };
+  gdouble values[3 * LEVEL_F32_MANY_CHANNELS];
+  gint j;
+
+  h = setup_level_many_channels ();
+  g_object_set (h->element, "post-messages", TRUE, "packed-messages", TRUE,
+      "interval", (guint64) GST_SECOND / 10, NULL);
+  bus = gst_bus_new ();
+  gst_element_set_bus (h->element, bus);
+
+  fail_unless_equals_int (gst_harness_push (h,
+          create_f32_many_channels_buffer ()), GST_FLOW_OK);
+
+  message = gst_bus_poll (bus, GST_MESSAGE_ELEMENT, -1);
+  structure = gst_message_get_structure (message);
+
+  for (j = 0; j < 3; ++j) {
+    const GValue *value = gst_structure_get_value (structure, fields[j]);
+    GBytes *bytes;
+
+    fail_unless (G_VALUE_HOLDS (value, G_TYPE_BYTES));
+    bytes = g_value_get_boxed (value);
+    fail_unless_equals_int (g_bytes_get_size (bytes),
+        LEVEL_F32_MANY_CHANNELS * sizeof (gdouble));
+    memcpy (values + j * LEVEL_F32_MANY_CHANNELS,
+        g_bytes_get_data (bytes, NULL), g_bytes_get_size (bytes));
+  }
+  check_many_channels_levels (values);
+
+  gst_message_unref (message);
+  gst_bus_set_flushing (bus, TRUE);
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+#ifdef HAVE_MMAP
+static gchar *meter_filename;
+
+static void
+setup_meter_file (void)
+{
+  gint fd;
+
+  meter_filename =
+      g_build_filename (g_get_tmp_dir (), "level-meter-XXXXXX", NULL);
+  fd = g_mkstemp (meter_filename);
+  fail_unless (fd >= 0);
+  close (fd);
+}
+
+static void
+teardown_meter_file (void)
+{
+  g_unlink (meter_filename);
+  g_free (meter_filename);
+  meter_filename = NULL;
+}
+
+GST_START_TEST (test_meter_file)
+{
+  GstHarness *h;
+  GstBus *bus;
+  gchar *contents;
+  gsize length;
+  guint32 header[4];
+  guint64 times[3];
+
+  h = setup_level_many_channels ();
+  g_object_set (h->element, "post-messages", FALSE, "meter-file",
+      meter_filename, "interval", (guint64) GST_SECOND / 10, NULL);
+  bus = gst_bus_new ();
+  gst_element_set_bus (h->element, bus);
+
+  fail_unless_equals_int (gst_harness_push (h,
+          create_f32_many_channels_buffer ()), GST_FLOW_OK);
+
+  /* the levels only go to the meter block */
+  fail_unless (gst_bus_pop_filtered (bus, GST_MESSAGE_ELEMENT) == NULL);
+
+  fail_unless (g_file_get_contents (meter_filename, &contents, &length,
+          NULL));
+  fail_unless_equals_int (length, sizeof (header) + sizeof (times) +
+      3 * LEVEL_F32_MANY_CHANNELS * sizeof (gdouble));
+  memcpy (header, contents, sizeof (header));
+  memcpy (times, contents + sizeof (header), sizeof (times));
+  fail_unless_equals_int (header[0], 0x4c564c47);
+  fail_unless_equals_int (header[1], 1);
+  fail_unless_equals_int (header[2], LEVEL_F32_MANY_CHANNELS);
+  /* one update, even again after it */
+  fail_unless_equals_int (header[3], 2);
+  fail_unless_equals_uint64 (times[0], 0);
+  fail_unless_equals_uint64 (times[2], GST_SECOND / 10);
+  check_many_channels_levels ((const gdouble *) (contents + sizeof (header) +
+          sizeof (times)));
+  g_free (contents);
+
+  gst_element_set_bus (h->element, NULL);
+  gst_object_unref (bus);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+#endif
+
 static Suite *
 level_suite (void)
 {
   Suite *s = suite_create ("level");
   TCase *tc_chain = tcase_create ("general");
+#ifdef HAVE_MMAP
+  TCase *tc_meter = tcase_create ("meter");
+#endif
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_ref_counts);
@@ -605,6 +785,12 @@ level_suite (void)
   tcase_add_test (tc_chain, test_message_on_eos);
   tcase_add_test (tc_chain, test_message_count);
   tcase_add_test (tc_chain, test_message_timestamps);
+  tcase_add_test (tc_chain, test_packed_messages);
+#ifdef HAVE_MMAP
+  suite_add_tcase (s, tc_meter);
+  tcase_add_checked_fixture (tc_meter, setup_meter_file, teardown_meter_file);
+  tcase_add_test (tc_meter, test_meter_file);
+#endif
 
   return s;
 }
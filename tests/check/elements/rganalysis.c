@@ -1227,6 +1227,76 @@ GST_START_TEST (test_gain_album)
 
 GST_END_TEST;
 
+/* Same album as in test_gain_album, but the first two tracks are analyzed
+ * by another element and merged with the album-state property. */
+
+GST_START_TEST (test_gain_album_state)
+{
+  GstElement *element = setup_rganalysis ();
+  GstTagList *tag_list;
+  GBytes *state;
+  gint accumulator;
+  gint i;
+
+  g_object_set (element, "num-tracks", 3, NULL);
+  set_playing_state (element);
+
+  send_stream_start_event (element);
+  send_caps_event (GST_AUDIO_NE (F32), 44100, 2);
+  send_segment_event (element);
+  accumulator = 0;
+  for (i = 8; i--;)
+    push_buffer (test_buffer_square_float_stereo (&accumulator, 44100, 512,
+            0.75, 0.75));
+  send_eos_event (element);
+  tag_list = poll_tags_followed_by_eos (element);
+  fail_unless_track_gain (tag_list, -15.70);
+  fail_if_album_tags (tag_list);
+  gst_tag_list_unref (tag_list);
+
+  send_flush_events (element);
+  send_segment_event (element);
+  accumulator = 0;
+  for (i = 12; i--;)
+    push_buffer (test_buffer_square_float_stereo (&accumulator, 44100, 512,
+            0.5, 0.5));
+  send_eos_event (element);
+  tag_list = poll_tags_followed_by_eos (element);
+  fail_unless_track_gain (tag_list, -12.22);
+  fail_if_album_tags (tag_list);
+  gst_tag_list_unref (tag_list);
+
+  g_object_get (element, "album-state", &state, NULL);
+  fail_unless (state != NULL);
+  cleanup_rganalysis (element);
+
+  element = setup_rganalysis ();
+  g_object_set (element, "num-tracks", 1, NULL);
+  set_playing_state (element);
+  g_object_set (element, "album-state", state, NULL);
+  g_bytes_unref (state);
+
+  send_stream_start_event (element);
+  send_caps_event (GST_AUDIO_NE (F32), 44100, 2);
+  send_segment_event (element);
+  accumulator = 0;
+  for (i = 180; i--;)
+    push_buffer (test_buffer_square_float_stereo (&accumulator, 44100, 512,
+            0.25, 0.25));
+  send_eos_event (element);
+
+  tag_list = poll_tags_followed_by_eos (element);
+  fail_unless_track_peak (tag_list, 0.25);
+  fail_unless_track_gain (tag_list, -6.20);
+  fail_unless_album_peak (tag_list, 0.75);
+  fail_unless_album_gain (tag_list, -12.18);
+  gst_tag_list_unref (tag_list);
+
+  cleanup_rganalysis (element);
+}
+
+GST_END_TEST;
+
 /* Checks ensuring that the "forced" property works as advertised. */
 
 GST_START_TEST (test_forced)
@@ -1920,6 +1990,7 @@ rganalysis_suite (void)
   tcase_add_test (tc_chain, test_peak_album_abort_to_track);
 
   tcase_add_test (tc_chain, test_gain_album);
+  tcase_add_test (tc_chain, test_gain_album_state);
 
   tcase_add_test (tc_chain, test_forced);
   tcase_add_test (tc_chain, test_forced_separate);
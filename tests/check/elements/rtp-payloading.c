@@ -21,7 +21,9 @@
 #include <gst/check/gstharness.h>
 #include <gst/audio/audio.h>
 #include <gst/base/base.h>
+#include <gst/rtp/gstrtpbuffer.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #define RELEASE_ELEMENT(x) if(x) {gst_object_unref(x); x = NULL;}
@@ -1588,6 +1590,631 @@ GST_START_TEST (rtp_vorbis_renegotiate)
 
 GST_END_TEST;
 
+static GstBuffer *
+rtp_vraw_create_frame (gsize size)
+{
+  GstBuffer *frame = gst_buffer_new_allocate (NULL, size, NULL);
+  GstMapInfo map;
+  gsize i;
+
+  gst_buffer_map (frame, &map, GST_MAP_WRITE);
+  for (i = 0; i < size; i++)
+    map.data[i] = (i * 7 + i / 128) & 0xff;
+  gst_buffer_unmap (frame, &map);
+
+  GST_BUFFER_PTS (frame) = 0;
+  GST_BUFFER_DURATION (frame) = GST_SECOND / 30;
+
+  return frame;
+}
+
+static GList *
+rtp_vraw_payload (const gchar * format, gboolean zero_copy, GstBuffer * frame)
+{
+  GstHarness *h = gst_harness_new ("rtpvrawpay");
+  GList *packets = NULL;
+  GstBuffer *buf;
+  gchar *caps;
+
+  caps = g_strdup_printf ("video/x-raw, format = (string) %s, "
+      "width = (int) 64, height = (int) 32, framerate = (fraction) 30/1",
+      format);
+  gst_harness_set_src_caps_str (h, caps);
+  g_free (caps);
+  g_object_set (h->element, "zero-copy", zero_copy, "mtu", 400,
+      "seqnum-offset", 0, "ssrc", 1, "timestamp-offset", 0, NULL);
+
+  fail_unless_equals_int (gst_harness_push (h, gst_buffer_ref (frame)),
+      GST_FLOW_OK);
+  while ((buf = gst_harness_try_pull (h)))
+    packets = g_list_append (packets, buf);
+
+  gst_harness_teardown (h);
+
+  return packets;
+}
+
+GST_START_TEST (rtp_vraw_zero_copy)
+{
+  GstBuffer *frame = rtp_vraw_create_frame (64 * 32 * 2);
+  GList *copied, *referenced, *l, *m;
+
+  copied = rtp_vraw_payload ("UYVY", FALSE, frame);
+  referenced = rtp_vraw_payload ("UYVY", TRUE, frame);
+
+  fail_unless (copied != NULL);
+  fail_unless_equals_int (g_list_length (copied), g_list_length (referenced));
+
+  for (l = copied, m = referenced; l; l = l->next, m = m->next) {
+    GstBuffer *copy = l->data, *ref = m->data;
+    GstMapInfo map;
+
+    /* the lines are not padded, so all segments of a packet are merged into
+     * a single memory that references the frame */
+    fail_unless_equals_int (gst_buffer_n_memory (ref), 2);
+    fail_unless (gst_buffer_peek_memory (ref, 1)->parent ==
+        gst_buffer_peek_memory (frame, 0));
+
+    fail_unless_equals_int (gst_buffer_get_size (copy),
+        gst_buffer_get_size (ref));
+    gst_buffer_map (copy, &map, GST_MAP_READ);
+    fail_unless (gst_buffer_memcmp (ref, 0, map.data, map.size) == 0);
+    gst_buffer_unmap (copy, &map);
+  }
+
+  g_list_free_full (copied, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (referenced, (GDestroyNotify) gst_buffer_unref);
+  gst_buffer_unref (frame);
+}
+
+GST_END_TEST;
+
+static const struct
+{
+  const gchar *format;
+  gsize size;
+} rtp_vraw_pack_formats[] = {
+  {
+  "AYUV", 64 * 32 * 4}, {
+  "I420", 64 * 32 * 3 / 2}, {
+  "Y41B", 64 * 32 * 3 / 2}
+};
+
+GST_START_TEST (rtp_vraw_pack)
+{
+  const gchar *format = rtp_vraw_pack_formats[__i__].format;
+  GstBuffer *frame, *out;
+  GstHarness *h;
+  GstMapInfo map;
+  gchar *caps;
+
+  /* the formats that need repacking must survive a round trip, also with
+   * zero-copy enabled, which does not apply to them */
+  h = gst_harness_new_parse ("rtpvrawpay zero-copy=true mtu=400 ! "
+      "rtpvrawdepay");
+  caps = g_strdup_printf ("video/x-raw, format = (string) %s, "
+      "width = (int) 64, height = (int) 32, framerate = (fraction) 30/1",
+      format);
+  gst_harness_set_src_caps_str (h, caps);
+  g_free (caps);
+
+  if (g_str_equal (format, "AYUV")) {
+    guint8 *data;
+    gsize i;
+
+    /* the alpha channel is not transmitted, the depayloader clears it */
+    frame = rtp_vraw_create_frame (rtp_vraw_pack_formats[__i__].size);
+    gst_buffer_map (frame, &map, GST_MAP_WRITE);
+    data = map.data;
+    for (i = 0; i < map.size; i += 4)
+      data[i] = 0;
+    gst_buffer_unmap (frame, &map);
+  } else {
+    frame = rtp_vraw_create_frame (rtp_vraw_pack_formats[__i__].size);
+  }
+
+  fail_unless_equals_int (gst_harness_push (h, gst_buffer_ref (frame)),
+      GST_FLOW_OK);
+  out = gst_harness_pull (h);
+
+  fail_unless_equals_int (gst_buffer_get_size (out),
+      gst_buffer_get_size (frame));
+  gst_buffer_map (frame, &map, GST_MAP_READ);
+  fail_unless (gst_buffer_memcmp (out, 0, map.data, map.size) == 0);
+  gst_buffer_unmap (frame, &map);
+
+  gst_buffer_unref (out);
+  gst_buffer_unref (frame);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (rtp_vraw_conceal)
+{
+  GstHarness *pay, *depay;
+  GstBuffer *frames[2], *buf, *out;
+  GstMapInfo map, out_map;
+  guint i, n_packets, line;
+
+  /* with this MTU every packet carries exactly two lines of 64 UYVY pixels */
+  pay = gst_harness_new_parse ("rtpvrawpay mtu=284 chunks-per-frame=1");
+  gst_harness_set_src_caps_str (pay, "video/x-raw, format = (string) UYVY, "
+      "width = (int) 64, height = (int) 32, framerate = (fraction) 30/1");
+  depay = gst_harness_new_parse ("rtpvrawdepay conceal=true");
+
+  frames[0] = rtp_vraw_create_frame (64 * 32 * 2);
+  frames[1] = rtp_vraw_create_frame (64 * 32 * 2);
+  gst_buffer_map (frames[1], &map, GST_MAP_WRITE);
+  for (i = 0; i < map.size; i++)
+    map.data[i] ^= 0xff;
+  gst_buffer_unmap (frames[1], &map);
+  GST_BUFFER_PTS (frames[1]) = GST_SECOND / 30;
+
+  for (i = 0; i < 2; i++) {
+    fail_unless_equals_int (gst_harness_push (pay, gst_buffer_ref (frames[i])),
+        GST_FLOW_OK);
+    n_packets = 0;
+    while ((buf = gst_harness_try_pull (pay))) {
+      if (n_packets == 0 && i == 0) {
+        GstCaps *caps = gst_pad_get_current_caps (pay->sinkpad);
+        gst_harness_set_src_caps (depay, caps);
+      }
+      /* lose lines 6 and 7 of the second frame */
+      if (i == 1 && n_packets == 3)
+        gst_buffer_unref (buf);
+      else
+        fail_unless_equals_int (gst_harness_push (depay, buf), GST_FLOW_OK);
+      n_packets++;
+    }
+    fail_unless_equals_int (n_packets, 16);
+  }
+
+  out = gst_harness_pull (depay);
+  gst_buffer_unref (out);
+  out = gst_harness_pull (depay);
+
+  gst_buffer_map (out, &out_map, GST_MAP_READ);
+  for (line = 0; line < 32; line++) {
+    GstBuffer *expected = (line == 6 || line == 7) ? frames[0] : frames[1];
+
+    gst_buffer_map (expected, &map, GST_MAP_READ);
+    fail_unless (memcmp (out_map.data + line * 128, map.data + line * 128,
+            128) == 0, "unexpected content in line %u", line);
+    gst_buffer_unmap (expected, &map);
+  }
+  gst_buffer_unmap (out, &out_map);
+
+  gst_buffer_unref (out);
+  gst_buffer_unref (frames[0]);
+  gst_buffer_unref (frames[1]);
+  gst_harness_teardown (pay);
+  gst_harness_teardown (depay);
+}
+
+GST_END_TEST;
+
+static void
+rtp_vraw_shift_seqnum (GstBuffer * buf, gint shift)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+
+  fail_unless (gst_rtp_buffer_map (buf, GST_MAP_READWRITE, &rtp));
+  gst_rtp_buffer_set_seq (&rtp, gst_rtp_buffer_get_seq (&rtp) + shift);
+  gst_rtp_buffer_unmap (&rtp);
+}
+
+/* Moves the pixels of a single line UYVY packet to offset, and fills them
+ * in from frame */
+static void
+rtp_vraw_move_offset (GstBuffer * buf, GstBuffer * frame, guint line,
+    guint offset)
+{
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  guint8 *payload;
+
+  fail_unless (gst_rtp_buffer_map (buf, GST_MAP_READWRITE, &rtp));
+  payload = gst_rtp_buffer_get_payload (&rtp);
+  /* skip the extended seqnum, length and line number */
+  payload[6] = offset >> 8;
+  payload[7] = offset & 0xff;
+  gst_buffer_extract (frame, line * 64 * 2 + offset * 2, payload + 8,
+      gst_rtp_buffer_get_payload_len (&rtp) - 8);
+  gst_rtp_buffer_unmap (&rtp);
+}
+
+GST_START_TEST (rtp_vraw_duplicate)
+{
+  GstHarness *pay, *depay;
+  GstBuffer *frame, *packets[64], *out;
+  GstMapInfo map, out_map;
+  guint i, n_packets = 0;
+
+  /* with this MTU every packet carries half a line of 64 UYVY pixels */
+  pay = gst_harness_new_parse ("rtpvrawpay mtu=84 chunks-per-frame=1");
+  gst_harness_set_src_caps_str (pay, "video/x-raw, format = (string) UYVY, "
+      "width = (int) 64, height = (int) 32, framerate = (fraction) 30/1");
+  depay = gst_harness_new_parse ("rtpvrawdepay");
+
+  frame = rtp_vraw_create_frame (64 * 32 * 2);
+  fail_unless_equals_int (gst_harness_push (pay, gst_buffer_ref (frame)),
+      GST_FLOW_OK);
+  while ((out = gst_harness_try_pull (pay))) {
+    fail_unless (n_packets < 64);
+    packets[n_packets++] = out;
+  }
+  fail_unless_equals_int (n_packets, 64);
+  gst_harness_set_src_caps (depay, gst_pad_get_current_caps (pay->sinkpad));
+
+  /* the first half of the last line arrives twice, that must not complete
+   * the line. Give the copy the next sequence number, so that only the
+   * payload is duplicated. */
+  for (i = 0; i < 63; i++)
+    fail_unless_equals_int (gst_harness_push (depay,
+            gst_buffer_ref (packets[i])), GST_FLOW_OK);
+  out = gst_buffer_copy (packets[62]);
+  rtp_vraw_shift_seqnum (out, 1);
+  fail_unless_equals_int (gst_harness_push (depay, out), GST_FLOW_OK);
+  fail_unless_equals_int (gst_harness_buffers_received (depay), 0);
+
+  /* neither does a packet that overlaps both halves, the end of the line is
+   * still missing */
+  out = gst_buffer_copy (packets[62]);
+  rtp_vraw_shift_seqnum (out, 2);
+  rtp_vraw_move_offset (out, frame, 31, 16);
+  fail_unless_equals_int (gst_harness_push (depay, out), GST_FLOW_OK);
+  fail_unless_equals_int (gst_harness_buffers_received (depay), 0);
+
+  out = gst_buffer_copy (packets[63]);
+  rtp_vraw_shift_seqnum (out, 2);
+  fail_unless_equals_int (gst_harness_push (depay, out), GST_FLOW_OK);
+  out = gst_harness_pull (depay);
+
+  gst_buffer_map (out, &out_map, GST_MAP_READ);
+  gst_buffer_map (frame, &map, GST_MAP_READ);
+  fail_unless (memcmp (out_map.data, map.data, map.size) == 0);
+  gst_buffer_unmap (frame, &map);
+  gst_buffer_unmap (out, &out_map);
+
+  for (i = 0; i < n_packets; i++)
+    gst_buffer_unref (packets[i]);
+  gst_buffer_unref (out);
+  gst_buffer_unref (frame);
+  gst_harness_teardown (pay);
+  gst_harness_teardown (depay);
+}
+
+GST_END_TEST;
+
+/* 4K60 at about 50 Mbit/s */
+#define H26X_BENCH_FRAMES 60
+#define H26X_BENCH_FRAME_SIZE (50000000 / 8 / 60)
+
+/* A byte-stream AU with a small parameter set NAL, which is sent as a single
+ * NAL packet, and four slices that are fragmented */
+static GstBuffer *
+rtp_h26x_create_frame (gboolean h265, guint frame, gsize size)
+{
+  GstBuffer *buf = gst_buffer_new_allocate (NULL, size, NULL);
+  gsize slice_size = (size - 16) / 4;
+  GstMapInfo map;
+  guint8 *data;
+  gsize i, j;
+
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  data = map.data;
+  /* no zeroes anywhere so that there are no start code emulations */
+  for (i = 0; i < size; i++)
+    data[i] = ((i * 7 + frame) % 255) + 1;
+
+  GST_WRITE_UINT32_BE (data, 1);
+  if (h265) {
+    data[4] = 32 << 1;
+    data[5] = 1;
+  } else {
+    data[4] = 0x67;
+  }
+  data += 16;
+
+  for (j = 0; j < 4; j++) {
+    GST_WRITE_UINT32_BE (data, 1);
+    if (h265) {
+      data[4] = (frame == 0 ? 19 : 1) << 1;
+      data[5] = 1;
+    } else {
+      data[4] = frame == 0 ? 0x65 : 0x41;
+    }
+    data += slice_size;
+  }
+  gst_buffer_unmap (buf, &map);
+
+  gst_buffer_resize (buf, 0, 16 + 4 * slice_size);
+  GST_BUFFER_PTS (buf) = gst_util_uint64_scale (frame, GST_SECOND, 60);
+  GST_BUFFER_DURATION (buf) = gst_util_uint64_scale (1, GST_SECOND, 60);
+
+  return buf;
+}
+
+static GstPadProbeReturn
+count_buffer_lists_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  guint *n_lists = user_data;
+
+  (*n_lists)++;
+
+  return GST_PAD_PROBE_OK;
+}
+
+static GList *
+rtp_h26x_payload (const gchar * codec, gboolean aggregate, GList * frames,
+    GstCaps ** caps, guint * n_lists)
+{
+  GstHarness *h;
+  GList *packets = NULL, *l;
+  GstBuffer *buf;
+  gchar *str;
+
+  str = g_strdup_printf ("rtp%spay mtu=1400 aggregate-mode=%s", codec,
+      aggregate ? "zero-latency" : "none");
+  h = gst_harness_new_parse (str);
+  g_free (str);
+  str = g_strdup_printf ("video/x-%s, stream-format = (string) byte-stream, "
+      "alignment = (string) au", codec);
+  gst_harness_set_src_caps_str (h, str);
+  g_free (str);
+  if (n_lists) {
+    *n_lists = 0;
+    gst_pad_add_probe (h->sinkpad, GST_PAD_PROBE_TYPE_BUFFER_LIST,
+        count_buffer_lists_probe, n_lists, NULL);
+  }
+
+  for (l = frames; l; l = l->next) {
+    fail_unless_equals_int (gst_harness_push (h, gst_buffer_ref (l->data)),
+        GST_FLOW_OK);
+    while ((buf = gst_harness_try_pull (h)))
+      packets = g_list_append (packets, buf);
+  }
+  *caps = gst_pad_get_current_caps (h->sinkpad);
+
+  gst_harness_teardown (h);
+
+  return packets;
+}
+
+static GstPadProbeReturn
+non_contiguous_query_probe (GstPad * pad, GstPadProbeInfo * info,
+    gpointer user_data)
+{
+  GstQuery *query = GST_PAD_PROBE_INFO_QUERY (info);
+
+  if (GST_QUERY_TYPE (query) == GST_QUERY_ALLOCATION)
+    gst_query_add_allocation_meta (query,
+        g_type_from_name ("GstRTPNonContiguousAPI"), NULL);
+
+  return GST_PAD_PROBE_OK;
+}
+
+/* Depayloads @packets, returns the AUs and the throughput in frames per
+ * second */
+static GList *
+rtp_h26x_depayload (const gchar * codec, GstCaps * caps, GList * packets,
+    gboolean non_contiguous, gdouble * fps)
+{
+  GstHarness *h;
+  GList *aus = NULL, *l;
+  GstBuffer *buf;
+  gint64 start;
+  gchar *str;
+
+  str = g_strdup_printf ("rtp%sdepay", codec);
+  h = gst_harness_new_parse (str);
+  g_free (str);
+  gst_harness_set_src_caps (h, gst_caps_ref (caps));
+  str = g_strdup_printf ("video/x-%s, stream-format = (string) byte-stream, "
+      "alignment = (string) au", codec);
+  gst_harness_set_sink_caps_str (h, str);
+  g_free (str);
+  if (non_contiguous)
+    gst_pad_add_probe (h->sinkpad, GST_PAD_PROBE_TYPE_QUERY_DOWNSTREAM,
+        non_contiguous_query_probe, NULL, NULL);
+
+  start = g_get_monotonic_time ();
+  for (l = packets; l; l = l->next) {
+    fail_unless_equals_int (gst_harness_push (h, gst_buffer_ref (l->data)),
+        GST_FLOW_OK);
+    while ((buf = gst_harness_try_pull (h)))
+      aus = g_list_append (aus, buf);
+  }
+  *fps = g_list_length (aus) * (gdouble) G_USEC_PER_SEC /
+      (g_get_monotonic_time () - start);
+
+  gst_harness_teardown (h);
+
+  return aus;
+}
+
+static void
+rtp_h26x_check_non_contiguous (const gchar * codec, guint n_frames,
+    gsize frame_size)
+{
+  gboolean h265 = g_str_equal (codec, "h265");
+  GList *frames = NULL, *packets, *copied, *shared, *l, *m;
+  gdouble copied_fps, shared_fps;
+  GstMapInfo map, shared_map;
+  GstCaps *caps;
+  guint i;
+
+  for (i = 0; i < n_frames; i++)
+    frames = g_list_append (frames, rtp_h26x_create_frame (h265, i,
+            frame_size));
+  packets = rtp_h26x_payload (codec, FALSE, frames, &caps, NULL);
+
+  copied = rtp_h26x_depayload (codec, caps, packets, FALSE, &copied_fps);
+  shared = rtp_h26x_depayload (codec, caps, packets, TRUE, &shared_fps);
+  GST_INFO ("%s, %u packets: copied %.1f fps, shared %.1f fps", codec,
+      g_list_length (packets), copied_fps, shared_fps);
+
+  fail_unless_equals_int (g_list_length (copied), n_frames);
+  fail_unless_equals_int (g_list_length (shared), n_frames);
+
+  for (l = copied, m = shared; l; l = l->next, m = m->next) {
+    /* the fragments are referenced, not merged */
+    fail_unless (gst_buffer_n_memory (m->data) >
+        gst_buffer_n_memory (l->data));
+
+    gst_buffer_map (l->data, &map, GST_MAP_READ);
+    gst_buffer_map (m->data, &shared_map, GST_MAP_READ);
+    fail_unless_equals_int (map.size, shared_map.size);
+    fail_unless (memcmp (map.data, shared_map.data, map.size) == 0);
+    gst_buffer_unmap (l->data, &map);
+    gst_buffer_unmap (m->data, &shared_map);
+  }
+
+  g_list_free_full (frames, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (packets, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (copied, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (shared, (GDestroyNotify) gst_buffer_unref);
+  gst_caps_unref (caps);
+}
+
+GST_START_TEST (rtp_h264depay_non_contiguous)
+{
+  rtp_h26x_check_non_contiguous ("h264", 4, 8000);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (rtp_h265depay_non_contiguous)
+{
+  rtp_h26x_check_non_contiguous ("h265", 4, 8000);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (rtp_h264depay_4k60_throughput)
+{
+  rtp_h26x_check_non_contiguous ("h264", H26X_BENCH_FRAMES,
+      H26X_BENCH_FRAME_SIZE);
+}
+
+GST_END_TEST;
+
+/* VPS, SPS, PPS and an IDR slice, all small */
+static const guint8 h265_small_au_bs[] = {
+  0x00, 0x00, 0x00, 0x01, 0x40, 0x01, 0x0c, 0x01, 0xff, 0xff, 0x01, 0x60,
+  0x00, 0x00, 0x00, 0x01, 0x42, 0x01, 0x01, 0x01, 0x60, 0x70, 0x5d, 0xa0,
+  0x00, 0x00, 0x00, 0x01, 0x44, 0x01, 0xc1, 0x72, 0xb4, 0x62, 0x40, 0x80,
+  0x00, 0x00, 0x00, 0x01, 0x26, 0x01, 0xaf, 0x06, 0xb8, 0x63, 0xef, 0x3a
+};
+
+/* Payloads @data, made of @n_nals NAL units with 4 bytes start codes, with
+ * and without aggregation. All NAL units must go in one aggregation packet
+ * that depayloads to the same AU. */
+static void
+rtp_h26x_check_aggregate (const gchar * codec, const guint8 * data,
+    gsize size, guint n_nals)
+{
+  gboolean h265 = g_str_equal (codec, "h265");
+  GList *frames, *packets, *aggregated, *aus, *aggregated_aus;
+  GstRTPBuffer rtp = GST_RTP_BUFFER_INIT;
+  GstMapInfo map, aggregated_map;
+  GstCaps *caps, *aggregated_caps;
+  guint8 *payload;
+  guint n_lists;
+  gdouble fps;
+
+  frames = g_list_append (NULL, gst_buffer_new_wrapped (g_memdup (data,
+              size), size));
+  packets = rtp_h26x_payload (codec, FALSE, frames, &caps, NULL);
+  aggregated = rtp_h26x_payload (codec, TRUE, frames, &aggregated_caps,
+      &n_lists);
+
+  fail_unless_equals_int (g_list_length (packets), n_nals);
+  fail_unless_equals_int (g_list_length (aggregated), 1);
+  fail_unless_equals_int (n_lists, 1);
+
+  fail_unless (gst_rtp_buffer_map (aggregated->data, GST_MAP_READ, &rtp));
+  fail_unless (gst_rtp_buffer_get_marker (&rtp));
+  payload = gst_rtp_buffer_get_payload (&rtp);
+  if (h265) {
+    /* AP with LayerId 0 and TID 1 */
+    fail_unless_equals_int (payload[0], 48 << 1);
+    fail_unless_equals_int (payload[1], 1);
+  } else {
+    /* STAP-A with the NRI of the SPS */
+    fail_unless_equals_int (payload[0], 0x60 | 24);
+  }
+  /* the start codes are replaced by 16 bits sizes */
+  fail_unless_equals_int (gst_rtp_buffer_get_payload_len (&rtp),
+      (h265 ? 2 : 1) + size - 2 * n_nals);
+  gst_rtp_buffer_unmap (&rtp);
+
+  aus = rtp_h26x_depayload (codec, caps, packets, FALSE, &fps);
+  aggregated_aus = rtp_h26x_depayload (codec, aggregated_caps, aggregated,
+      FALSE, &fps);
+  fail_unless_equals_int (g_list_length (aus), 1);
+  fail_unless_equals_int (g_list_length (aggregated_aus), 1);
+
+  gst_buffer_map (aus->data, &map, GST_MAP_READ);
+  gst_buffer_map (aggregated_aus->data, &aggregated_map, GST_MAP_READ);
+  fail_unless_equals_int (map.size, aggregated_map.size);
+  fail_unless (memcmp (map.data, aggregated_map.data, map.size) == 0);
+  gst_buffer_unmap (aus->data, &map);
+  gst_buffer_unmap (aggregated_aus->data, &aggregated_map);
+
+  g_list_free_full (frames, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (packets, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (aggregated, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (aus, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (aggregated_aus, (GDestroyNotify) gst_buffer_unref);
+  gst_caps_unref (caps);
+  gst_caps_unref (aggregated_caps);
+}
+
+GST_START_TEST (rtp_h264pay_aggregate)
+{
+  rtp_h26x_check_aggregate ("h264", h264_16x16_black_bs,
+      sizeof (h264_16x16_black_bs), 3);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (rtp_h265pay_aggregate)
+{
+  rtp_h26x_check_aggregate ("h265", h265_small_au_bs,
+      sizeof (h265_small_au_bs), 4);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (rtp_h264pay_aggregate_list_per_au)
+{
+  GList *frames = NULL, *packets, *l;
+  guint i, n_lists, n_fragments = 0;
+  GstCaps *caps;
+
+  for (i = 0; i < 4; i++)
+    frames = g_list_append (frames, rtp_h26x_create_frame (FALSE, i, 8000));
+  packets = rtp_h26x_payload ("h264", TRUE, frames, &caps, &n_lists);
+
+  /* one list per AU, each packet a header and a slice of the input */
+  fail_unless_equals_int (n_lists, 4);
+  for (l = packets; l; l = l->next) {
+    if (gst_buffer_get_size (l->data) > 1000) {
+      fail_unless_equals_int (gst_buffer_n_memory (l->data), 2);
+      n_fragments++;
+    }
+  }
+  fail_unless (n_fragments > 0);
+
+  g_list_free_full (frames, (GDestroyNotify) gst_buffer_unref);
+  g_list_free_full (packets, (GDestroyNotify) gst_buffer_unref);
+  gst_caps_unref (caps);
+}
+
+GST_END_TEST;
+
 /*
  * Creates the test suite.
  *
@@ -1650,6 +2277,17 @@ rtp_payloading_suite (void)
   tcase_add_test (tc_chain, rtp_g729);
   tcase_add_test (tc_chain, rtp_gst_custom_event);
   tcase_add_test (tc_chain, rtp_vorbis_renegotiate);
+  tcase_add_test (tc_chain, rtp_vraw_zero_copy);
+  tcase_add_loop_test (tc_chain, rtp_vraw_pack, 0,
+      G_N_ELEMENTS (rtp_vraw_pack_formats));
+  tcase_add_test (tc_chain, rtp_vraw_conceal);
+  tcase_add_test (tc_chain, rtp_vraw_duplicate);
+  tcase_add_test (tc_chain, rtp_h264depay_non_contiguous);
+  tcase_add_test (tc_chain, rtp_h265depay_non_contiguous);
+  tcase_add_test (tc_chain, rtp_h264depay_4k60_throughput);
+  tcase_add_test (tc_chain, rtp_h264pay_aggregate);
+  tcase_add_test (tc_chain, rtp_h265pay_aggregate);
+  tcase_add_test (tc_chain, rtp_h264pay_aggregate_list_per_au);
   return s;
 }
 
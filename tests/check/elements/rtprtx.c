@@ -572,6 +572,174 @@ GST_START_TEST (test_rtxsender_max_size_time)
 
 GST_END_TEST;
 
+GST_START_TEST (test_rtxsender_seqnum_wrap_and_gaps)
+{
+  guint master_ssrc = 1234567;
+  guint master_pt = 96;
+  guint rtx_ssrc = 7654321;
+  guint rtx_pt = 99;
+  guint16 first_seqnum = 65500;
+  gint num_buffers = 500;
+  GstHarness *h;
+  GstStructure *pt_map = gst_structure_new ("application/x-rtp-pt-map",
+      "96", G_TYPE_UINT, rtx_pt, NULL);
+  GstStructure *ssrc_map = gst_structure_new ("application/x-rtp-ssrc-map",
+      "1234567", G_TYPE_UINT, rtx_ssrc, NULL);
+  gint i;
+
+  h = gst_harness_new ("rtprtxsend");
+
+  /* keep everything, so that the history has to grow */
+  g_object_set (h->element, "max-size-packets", 0, "max-size-time", 0,
+      "payload-type-map", pt_map, "ssrc-map", ssrc_map, NULL);
+
+  gst_harness_set_src_caps_str (h, "application/x-rtp, "
+      "media = (string)video, payload = (int)96, "
+      "ssrc = (uint)1234567, clock-rate = (int)90000, "
+      "encoding-name = (string)RAW");
+
+  /* every 7th packet is lost before rtprtxsend and the seqnums wrap around */
+  for (i = 0; i < num_buffers; i++) {
+    guint16 seqnum = first_seqnum + i;
+
+    if (i % 7 == 3)
+      continue;
+
+    push_pull_and_verify (h, create_rtp_buffer (master_ssrc, master_pt,
+            seqnum), FALSE, master_ssrc, master_pt, seqnum);
+  }
+
+  /* request them all, only the ones that we have are retransmitted */
+  for (i = 0; i < num_buffers; i++) {
+    guint16 seqnum = first_seqnum + i;
+
+    gst_harness_push_upstream_event (h,
+        create_rtx_event (master_ssrc, master_pt, seqnum));
+    if (i % 7 != 3)
+      pull_and_verify (h, TRUE, rtx_ssrc, rtx_pt, seqnum);
+  }
+
+  /* packets from before the history are not found */
+  gst_harness_push_upstream_event (h,
+      create_rtx_event (master_ssrc, master_pt, first_seqnum - 1));
+  gst_harness_push_upstream_event (h,
+      create_rtx_event (master_ssrc, master_pt, first_seqnum + num_buffers));
+  /* a last valid request to be sure the ones above were handled */
+  gst_harness_push_upstream_event (h,
+      create_rtx_event (master_ssrc, master_pt, first_seqnum));
+  pull_and_verify (h, TRUE, rtx_ssrc, rtx_pt, first_seqnum);
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 0);
+
+  gst_structure_free (pt_map);
+  gst_structure_free (ssrc_map);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* more packets than fit into the seqnum window of a history */
+#define LONG_RUN_PACKETS 40000
+#define HISTORY_SPAN 32768
+
+GST_START_TEST (test_rtxsender_unlimited_long_run)
+{
+  guint master_ssrc = 1234567;
+  guint master_pt = 96;
+  guint rtx_ssrc = 7654321;
+  guint rtx_pt = 99;
+  guint16 last_seqnum = LONG_RUN_PACKETS - 1;
+  GstHarness *h;
+  GstStructure *pt_map = gst_structure_new ("application/x-rtp-pt-map",
+      "96", G_TYPE_UINT, rtx_pt, NULL);
+  GstStructure *ssrc_map = gst_structure_new ("application/x-rtp-ssrc-map",
+      "1234567", G_TYPE_UINT, rtx_ssrc, NULL);
+  gint i;
+
+  h = gst_harness_new ("rtprtxsend");
+
+  g_object_set (h->element, "max-size-packets", 0, "max-size-time", 0,
+      "payload-type-map", pt_map, "ssrc-map", ssrc_map, NULL);
+
+  gst_harness_set_src_caps_str (h, "application/x-rtp, "
+      "media = (string)video, payload = (int)96, "
+      "ssrc = (uint)1234567, clock-rate = (int)90000, "
+      "encoding-name = (string)RAW");
+
+  for (i = 0; i < LONG_RUN_PACKETS; i++)
+    push_pull_and_verify (h, create_rtp_buffer (master_ssrc, master_pt, i),
+        FALSE, master_ssrc, master_pt, i);
+
+  /* the history keeps taking new packets and covers the last seqnums */
+  gst_harness_push_upstream_event (h,
+      create_rtx_event (master_ssrc, master_pt, last_seqnum));
+  pull_and_verify (h, TRUE, rtx_ssrc, rtx_pt, last_seqnum);
+  gst_harness_push_upstream_event (h,
+      create_rtx_event (master_ssrc, master_pt,
+          last_seqnum - HISTORY_SPAN + 1));
+  pull_and_verify (h, TRUE, rtx_ssrc, rtx_pt, last_seqnum - HISTORY_SPAN + 1);
+
+  /* older ones were dropped to make room */
+  gst_harness_push_upstream_event (h,
+      create_rtx_event (master_ssrc, master_pt, last_seqnum - HISTORY_SPAN));
+  /* a last valid request to be sure the one above was handled */
+  gst_harness_push_upstream_event (h,
+      create_rtx_event (master_ssrc, master_pt, last_seqnum));
+  pull_and_verify (h, TRUE, rtx_ssrc, rtx_pt, last_seqnum);
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 0);
+
+  gst_structure_free (pt_map);
+  gst_structure_free (ssrc_map);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_rtxqueue_max_size_packets_clamped)
+{
+  guint ssrc = 1234567;
+  guint pt = 96;
+  guint16 last_seqnum = LONG_RUN_PACKETS - 1;
+  guint max_size_packets;
+  GstHarness *h;
+  gint i;
+
+  h = gst_harness_new ("rtprtxqueue");
+
+  /* more than a history can hold */
+  g_object_set (h->element, "max-size-packets", 100000, "max-size-time", 0,
+      NULL);
+  g_object_get (h->element, "max-size-packets", &max_size_packets, NULL);
+  fail_unless_equals_int (max_size_packets, HISTORY_SPAN);
+
+  gst_harness_set_src_caps_str (h, "application/x-rtp, "
+      "media = (string)video, payload = (int)96, "
+      "ssrc = (uint)1234567, clock-rate = (int)90000, "
+      "encoding-name = (string)RAW");
+
+  for (i = 0; i < LONG_RUN_PACKETS; i++)
+    push_pull_and_verify (h, create_rtp_buffer (ssrc, pt, i), FALSE, ssrc, pt,
+        i);
+
+  /* the newest and the oldest packet of the window are retransmitted before
+   * the next packet, the one before the window was dropped */
+  gst_harness_push_upstream_event (h,
+      create_rtx_event (ssrc, pt, last_seqnum));
+  gst_harness_push_upstream_event (h,
+      create_rtx_event (ssrc, pt, last_seqnum - HISTORY_SPAN + 1));
+  gst_harness_push_upstream_event (h,
+      create_rtx_event (ssrc, pt, last_seqnum - HISTORY_SPAN));
+  gst_harness_push (h, create_rtp_buffer (ssrc, pt, last_seqnum + 1));
+
+  pull_and_verify (h, FALSE, ssrc, pt, last_seqnum);
+  pull_and_verify (h, FALSE, ssrc, pt, last_seqnum - HISTORY_SPAN + 1);
+  pull_and_verify (h, FALSE, ssrc, pt, last_seqnum + 1);
+  fail_unless_equals_int (gst_harness_buffers_in_queue (h), 0);
+
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
 static void
 test_rtxqueue_packet_retention (gboolean test_with_time)
 {
@@ -667,8 +835,11 @@ rtprtx_suite (void)
   tcase_add_test (tc_chain, test_multi_rtxsend_rtxreceive_with_packet_loss);
   tcase_add_test (tc_chain, test_rtxsender_max_size_packets);
   tcase_add_test (tc_chain, test_rtxsender_max_size_time);
+  tcase_add_test (tc_chain, test_rtxsender_seqnum_wrap_and_gaps);
+  tcase_add_test (tc_chain, test_rtxsender_unlimited_long_run);
   tcase_add_test (tc_chain, test_rtxqueue_max_size_packets);
   tcase_add_test (tc_chain, test_rtxqueue_max_size_time);
+  tcase_add_test (tc_chain, test_rtxqueue_max_size_packets_clamped);
 
   return s;
 }
@@ -30,6 +30,9 @@
 #include <gst/rtp/gstrtcpbuffer.h>
 #include <gst/net/gstnetaddressmeta.h>
 
+#include <stdlib.h>
+#include <string.h>
+
 static const guint payload_size = 160;
 static const guint clock_rate = 8000;
 static const guint payload_type = 0;
@@ -810,6 +813,156 @@ GST_START_TEST (test_ignore_suspicious_bye)
 
 GST_END_TEST;
 
+static gint rtcp_lists_received;
+
+static GstFlowReturn
+test_sink_pad_chain_list_cb (GstPad * pad, GstObject * parent,
+    GstBufferList * list)
+{
+  TestData *data = gst_pad_get_element_private (pad);
+  guint i;
+
+  g_atomic_int_inc (&rtcp_lists_received);
+  for (i = 0; i < gst_buffer_list_length (list); i++)
+    g_async_queue_push (data->rtcp_queue,
+        gst_buffer_ref (gst_buffer_list_get (list, i)));
+  gst_buffer_list_unref (list);
+
+  return GST_FLOW_OK;
+}
+
+/* Generates the RTCP of many internal senders, which all report about each
+ * other. The number of senders can be changed with the RTPSESSION_TEST_SSRCS
+ * environment variable, run with GST_DEBUG=check:4 to see the time spent on
+ * each report round. */
+GST_START_TEST (test_rtcp_scaling)
+{
+  TestData data;
+  GstFlowReturn res;
+  GstClockID id;
+  GstClockTime time;
+  GstBuffer *buf;
+  GstRTCPBuffer rtcp = GST_RTCP_BUFFER_INIT;
+  GstRTCPPacket rtcp_packet;
+  GHashTable *rb_ssrcs, *tmp_set, *round_rbs;
+  const gchar *env;
+  guint n_ssrcs = 200;
+  guint rounds, i, j, k;
+  guint32 ssrc, rb_ssrc, exthighestseq, jitter, lsr, dlsr;
+  gint32 packetslost;
+  guint8 fractionlost;
+  gint64 start;
+
+  if ((env = g_getenv ("RTPSESSION_TEST_SSRCS")))
+    n_ssrcs = MAX (2, atoi (env));
+  rounds = (n_ssrcs - 1 + GST_RTCP_MAX_RB_COUNT - 1) / GST_RTCP_MAX_RB_COUNT;
+
+  setup_testharness (&data, TRUE);
+  gst_pad_set_chain_list_function (data.rtcp_sink,
+      test_sink_pad_chain_list_cb);
+  rtcp_lists_received = 0;
+
+  rb_ssrcs = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+      (GDestroyNotify) g_hash_table_unref);
+  /* the report block of each source in the current round */
+  round_rbs = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL,
+      g_free);
+
+  /* only the RTCP thread waits on the clock */
+  gst_test_clock_wait_for_next_pending_id (GST_TEST_CLOCK (data.clock), &id);
+
+  for (i = 0; i < rounds; i++) {
+    for (j = 0; j < 5; j++) {
+      guint seq = (i * 5) + j;
+
+      gst_test_clock_advance_time (GST_TEST_CLOCK (data.clock),
+          200 * GST_MSECOND);
+
+      for (k = 0; k < n_ssrcs; k++) {
+        buf = generate_test_buffer (seq * 200 * GST_MSECOND, FALSE, seq,
+            seq * 200, 10000 + k);
+        res = gst_pad_push (data.src, buf);
+        fail_unless (res == GST_FLOW_OK || res == GST_FLOW_FLUSHING);
+      }
+    }
+
+    start = g_get_monotonic_time ();
+    crank_rtcp_thread (&data, &time, &id);
+    GST_INFO ("round %u: RTCP for %u senders generated in %" G_GINT64_FORMAT
+        " us", i, n_ssrcs, g_get_monotonic_time () - start);
+
+    /* the packets of all senders are sent in one list */
+    fail_unless_equals_int (g_atomic_int_get (&rtcp_lists_received), i + 1);
+    fail_unless_equals_int (g_async_queue_length (data.rtcp_queue), n_ssrcs);
+
+    for (j = 0; j < n_ssrcs; j++) {
+      buf = g_async_queue_pop (data.rtcp_queue);
+      fail_unless (gst_rtcp_buffer_validate (buf));
+
+      gst_rtcp_buffer_map (buf, GST_MAP_READ, &rtcp);
+      fail_unless (gst_rtcp_buffer_get_first_packet (&rtcp, &rtcp_packet));
+      fail_unless_equals_int (gst_rtcp_packet_get_type (&rtcp_packet),
+          GST_RTCP_TYPE_SR);
+      gst_rtcp_packet_sr_get_sender_info (&rtcp_packet, &ssrc, NULL, NULL,
+          NULL, NULL);
+
+      if (i == 0) {
+        tmp_set = g_hash_table_new (g_direct_hash, g_direct_equal);
+        g_hash_table_insert (rb_ssrcs, GUINT_TO_POINTER (ssrc), tmp_set);
+      } else {
+        tmp_set = g_hash_table_lookup (rb_ssrcs, GUINT_TO_POINTER (ssrc));
+        fail_unless (tmp_set != NULL);
+      }
+
+      fail_unless (gst_rtcp_packet_get_rb_count (&rtcp_packet) <=
+          GST_RTCP_MAX_RB_COUNT);
+      for (k = 0; k < gst_rtcp_packet_get_rb_count (&rtcp_packet); k++) {
+        guint32 rb[6], *prev;
+
+        gst_rtcp_packet_get_rb (&rtcp_packet, k, &rb_ssrc, &fractionlost,
+            &packetslost, &exthighestseq, &jitter, &lsr, &dlsr);
+        fail_unless (rb_ssrc != ssrc);
+        fail_if (g_hash_table_contains (tmp_set, GUINT_TO_POINTER (rb_ssrc)));
+        g_hash_table_add (tmp_set, GUINT_TO_POINTER (rb_ssrc));
+
+        /* all senders report the same stats about a source in one round */
+        rb[0] = fractionlost;
+        rb[1] = packetslost;
+        rb[2] = exthighestseq;
+        rb[3] = jitter;
+        rb[4] = lsr;
+        rb[5] = dlsr;
+        prev = g_hash_table_lookup (round_rbs, GUINT_TO_POINTER (rb_ssrc));
+        if (prev)
+          fail_unless (memcmp (prev, rb, sizeof (rb)) == 0);
+        else
+          g_hash_table_insert (round_rbs, GUINT_TO_POINTER (rb_ssrc),
+              g_memdup (rb, sizeof (rb)));
+      }
+
+      gst_rtcp_buffer_unmap (&rtcp);
+      gst_buffer_unref (buf);
+    }
+    g_hash_table_remove_all (round_rbs);
+  }
+  gst_clock_id_unref (id);
+
+  /* every sender reported about all the others */
+  fail_unless_equals_int (g_hash_table_size (rb_ssrcs), n_ssrcs);
+  for (i = 0; i < n_ssrcs; i++) {
+    tmp_set = g_hash_table_lookup (rb_ssrcs, GUINT_TO_POINTER (10000 + i));
+    fail_unless (tmp_set != NULL);
+    fail_unless_equals_int (g_hash_table_size (tmp_set), n_ssrcs - 1);
+  }
+
+  g_hash_table_unref (round_rbs);
+  g_hash_table_unref (rb_ssrcs);
+
+  destroy_testharness (&data);
+}
+
+GST_END_TEST;
+
 static Suite *
 rtpsession_suite (void)
 {
@@ -823,6 +976,7 @@ rtpsession_suite (void)
   tcase_add_test (tc_chain, test_receive_rtcp_app_packet);
   tcase_add_test (tc_chain, test_dont_lock_on_stats);
   tcase_add_test (tc_chain, test_ignore_suspicious_bye);
+  tcase_add_test (tc_chain, test_rtcp_scaling);
 
   return s;
 }
@@ -0,0 +1,548 @@
+/* GStreamer RTSP source unit tests
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* The tests run a small RTSP server in a thread that streams one audio stream
+ * over UDP or interleaved over TCP to every client. The number of clients of
+ * the scalability test can be changed with the RTSPSRC_TEST_CLIENTS
+ * environment variable, run it with GST_DEBUG=check:4 to see the number of
+ * threads used in each mode. */
+
+#include <gst/check/gstcheck.h>
+#include <gst/rtsp/gstrtspconnection.h>
+#include <gst/rtsp/gstrtsptransport.h>
+#include <gio/gio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define PACKET_INTERVAL_MS 10
+#define PAYLOAD_SIZE 160
+#define MIN_BUFFERS 10
+/* more than one, so that interleaved packets queue up on the connection */
+#define PACKETS_PER_INTERVAL 4
+
+static const gchar sdp_fmt[] =
+    "v=0\r\n"
+    "o=- 1 1 IN IP4 127.0.0.1\r\n"
+    "s=test\r\n"
+    "c=IN IP4 127.0.0.1\r\n"
+    "t=0 0\r\n"
+    "m=audio 0 RTP/AVP 96\r\n"
+    "a=rtpmap:96 L16/8000/1\r\n" "a=control:stream=0\r\n";
+
+typedef struct
+{
+  GMainContext *context;
+  GMainLoop *loop;
+  GThread *thread;
+  GSocket *listen;
+  GSocket *rtp;
+  GSocket *rtcp;
+  guint16 port;
+
+  GMutex lock;
+  GList *clients;
+  guint16 seqnum;
+} TestServer;
+
+typedef struct
+{
+  TestServer *server;
+  GstRTSPConnection *conn;
+  GstRTSPWatch *watch;
+  GSocketAddress *rtp_addr;
+  gboolean tcp;
+  guint8 channel;
+  gboolean playing;
+} TestClient;
+
+static guint16
+socket_get_port (GSocket * socket)
+{
+  GSocketAddress *addr;
+  guint16 port;
+
+  addr = g_socket_get_local_address (socket, NULL);
+  fail_unless (addr != NULL);
+  port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (addr));
+  g_object_unref (addr);
+
+  return port;
+}
+
+static GSocket *
+socket_new_bound (GSocketType type, GSocketProtocol protocol)
+{
+  GInetAddress *ia;
+  GSocketAddress *sa;
+  GSocket *socket;
+
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, type, protocol, NULL);
+  fail_unless (socket != NULL);
+
+  ia = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  sa = g_inet_socket_address_new (ia, 0);
+  fail_unless (g_socket_bind (socket, sa, TRUE, NULL));
+  g_object_unref (sa);
+  g_object_unref (ia);
+
+  return socket;
+}
+
+static void
+send_response (TestClient * client, GstRTSPMessage * response)
+{
+  gst_rtsp_watch_send_message (client->watch, response, NULL);
+  gst_rtsp_message_unset (response);
+}
+
+static void
+handle_setup (TestClient * client, GstRTSPMessage * request,
+    GstRTSPMessage * response)
+{
+  GstRTSPTransport *transport;
+  gchar *value, **transports, *text;
+
+  fail_unless (gst_rtsp_message_get_header (request, GST_RTSP_HDR_TRANSPORT,
+          &value, 0) == GST_RTSP_OK);
+
+  /* we do unicast UDP and TCP, take what the client asks for first */
+  transports = g_strsplit (value, ",", 2);
+  gst_rtsp_transport_new (&transport);
+  fail_unless (gst_rtsp_transport_parse (transports[0],
+          transport) == GST_RTSP_OK);
+  g_strfreev (transports);
+
+  g_mutex_lock (&client->server->lock);
+  if (transport->lower_transport == GST_RTSP_LOWER_TRANS_TCP) {
+    client->tcp = TRUE;
+    client->channel = transport->interleaved.min;
+  } else {
+    g_clear_object (&client->rtp_addr);
+    client->rtp_addr = g_inet_socket_address_new_from_string ("127.0.0.1",
+        transport->client_port.min);
+    transport->server_port.min = socket_get_port (client->server->rtp);
+    transport->server_port.max = socket_get_port (client->server->rtcp);
+  }
+  g_mutex_unlock (&client->server->lock);
+
+  text = gst_rtsp_transport_as_text (transport);
+  gst_rtsp_message_take_header (response, GST_RTSP_HDR_TRANSPORT, text);
+  gst_rtsp_transport_free (transport);
+
+  gst_rtsp_message_add_header (response, GST_RTSP_HDR_SESSION, "12345678");
+}
+
+static GstRTSPResult
+message_received (GstRTSPWatch * watch, GstRTSPMessage * request,
+    gpointer user_data)
+{
+  TestClient *client = user_data;
+  GstRTSPMessage response = { 0 };
+  GstRTSPMethod method;
+  const gchar *uri;
+  gchar *sdp;
+
+  if (gst_rtsp_message_parse_request (request, &method, &uri,
+          NULL) != GST_RTSP_OK)
+    return GST_RTSP_OK;
+
+  gst_rtsp_message_init_response (&response, GST_RTSP_STS_OK, NULL, request);
+
+  switch (method) {
+    case GST_RTSP_OPTIONS:
+      gst_rtsp_message_add_header (&response, GST_RTSP_HDR_PUBLIC,
+          "OPTIONS, DESCRIBE, SETUP, PLAY, TEARDOWN");
+      break;
+    case GST_RTSP_DESCRIBE:
+      gst_rtsp_message_add_header (&response, GST_RTSP_HDR_CONTENT_TYPE,
+          "application/sdp");
+      gst_rtsp_message_take_header (&response, GST_RTSP_HDR_CONTENT_BASE,
+          g_strdup_printf ("%s/", uri));
+      sdp = g_strdup (sdp_fmt);
+      gst_rtsp_message_take_body (&response, (guint8 *) sdp, strlen (sdp));
+      break;
+    case GST_RTSP_SETUP:
+      handle_setup (client, request, &response);
+      break;
+    case GST_RTSP_PLAY:
+      g_mutex_lock (&client->server->lock);
+      client->playing = TRUE;
+      g_mutex_unlock (&client->server->lock);
+      break;
+    case GST_RTSP_TEARDOWN:
+      g_mutex_lock (&client->server->lock);
+      client->playing = FALSE;
+      g_mutex_unlock (&client->server->lock);
+      break;
+    default:
+      gst_rtsp_message_unset (&response);
+      gst_rtsp_message_init_response (&response,
+          GST_RTSP_STS_NOT_IMPLEMENTED, NULL, request);
+      break;
+  }
+
+  send_response (client, &response);
+
+  return GST_RTSP_OK;
+}
+
+static GstRTSPResult
+closed (GstRTSPWatch * watch, gpointer user_data)
+{
+  TestClient *client = user_data;
+  TestServer *server = client->server;
+
+  g_mutex_lock (&server->lock);
+  client->playing = FALSE;
+  g_mutex_unlock (&server->lock);
+
+  return GST_RTSP_OK;
+}
+
+static GstRTSPWatchFuncs watch_funcs;
+
+static void
+client_free (TestClient * client)
+{
+  TestServer *server = client->server;
+
+  g_mutex_lock (&server->lock);
+  server->clients = g_list_remove (server->clients, client);
+  g_mutex_unlock (&server->lock);
+
+  g_clear_object (&client->rtp_addr);
+  gst_rtsp_connection_free (client->conn);
+  g_slice_free (TestClient, client);
+}
+
+static gboolean
+accept_client (GSocket * socket, GIOCondition condition, TestServer * server)
+{
+  TestClient *client;
+  GstRTSPConnection *conn;
+
+  if (gst_rtsp_connection_accept (socket, &conn, NULL) != GST_RTSP_OK)
+    return G_SOURCE_CONTINUE;
+
+  client = g_slice_new0 (TestClient);
+  client->server = server;
+  client->conn = conn;
+
+  g_mutex_lock (&server->lock);
+  server->clients = g_list_prepend (server->clients, client);
+  g_mutex_unlock (&server->lock);
+
+  /* the client is freed when the watch is destroyed */
+  client->watch = gst_rtsp_watch_new (conn, &watch_funcs, client,
+      (GDestroyNotify) client_free);
+  gst_rtsp_watch_attach (client->watch, server->context);
+  gst_rtsp_watch_unref (client->watch);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+send_packet (TestClient * client, guint8 * packet, gsize size)
+{
+  GstRTSPMessage message = { 0 };
+
+  if (!client->tcp) {
+    g_socket_send_to (client->server->rtp, client->rtp_addr,
+        (gchar *) packet, size, NULL, NULL);
+    return;
+  }
+
+  gst_rtsp_message_init_data (&message, client->channel);
+  gst_rtsp_message_set_body (&message, packet, size);
+  gst_rtsp_watch_send_message (client->watch, &message, NULL);
+  gst_rtsp_message_unset (&message);
+}
+
+static gboolean
+send_packets (TestServer * server)
+{
+  guint8 packet[12 + PAYLOAD_SIZE] = { 0x80, 96 };
+  guint32 ts;
+  GList *l;
+  guint i;
+
+  g_mutex_lock (&server->lock);
+  for (i = 0; i < PACKETS_PER_INTERVAL; i++) {
+    /* 2 bytes per sample, the payload is filled with the seqnum */
+    ts = server->seqnum * (PAYLOAD_SIZE / 2);
+    GST_WRITE_UINT16_BE (packet + 2, server->seqnum);
+    GST_WRITE_UINT32_BE (packet + 4, ts);
+    GST_WRITE_UINT32_BE (packet + 8, 0x12345678);
+    memset (packet + 12, server->seqnum & 0xff, PAYLOAD_SIZE);
+    server->seqnum++;
+
+    for (l = server->clients; l; l = l->next) {
+      TestClient *client = l->data;
+
+      if (client->playing && (client->tcp || client->rtp_addr))
+        send_packet (client, packet, sizeof (packet));
+    }
+  }
+  g_mutex_unlock (&server->lock);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gpointer
+server_thread (TestServer * server)
+{
+  g_main_context_push_thread_default (server->context);
+  g_main_loop_run (server->loop);
+  g_main_context_pop_thread_default (server->context);
+
+  return NULL;
+}
+
+static TestServer *
+test_server_new (void)
+{
+  TestServer *server;
+  GSource *source;
+
+  watch_funcs.message_received = message_received;
+  watch_funcs.closed = closed;
+
+  server = g_slice_new0 (TestServer);
+  g_mutex_init (&server->lock);
+  server->context = g_main_context_new ();
+  server->loop = g_main_loop_new (server->context, FALSE);
+
+  server->listen = socket_new_bound (G_SOCKET_TYPE_STREAM,
+      G_SOCKET_PROTOCOL_TCP);
+  fail_unless (g_socket_listen (server->listen, NULL));
+  server->port = socket_get_port (server->listen);
+  server->rtp = socket_new_bound (G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP);
+  server->rtcp = socket_new_bound (G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP);
+
+  source = g_socket_create_source (server->listen, G_IO_IN, NULL);
+  g_source_set_callback (source, (GSourceFunc) accept_client, server, NULL);
+  g_source_attach (source, server->context);
+  g_source_unref (source);
+
+  source = g_timeout_source_new (PACKET_INTERVAL_MS);
+  g_source_set_callback (source, (GSourceFunc) send_packets, server, NULL);
+  g_source_attach (source, server->context);
+  g_source_unref (source);
+
+  server->thread = g_thread_new ("test-rtsp-server",
+      (GThreadFunc) server_thread, server);
+
+  GST_INFO ("RTSP server listening on port %u", server->port);
+
+  return server;
+}
+
+static void
+test_server_free (TestServer * server)
+{
+  g_main_loop_quit (server->loop);
+  g_thread_join (server->thread);
+
+  /* destroying the context destroys the watches, which frees the clients */
+  g_main_loop_unref (server->loop);
+  g_main_context_unref (server->context);
+  fail_unless (server->clients == NULL);
+
+  g_object_unref (server->listen);
+  g_object_unref (server->rtp);
+  g_object_unref (server->rtcp);
+  g_mutex_clear (&server->lock);
+  g_slice_free (TestServer, server);
+}
+
+static GstPadProbeReturn
+count_buffers (GstPad * pad, GstPadProbeInfo * info, gint * n_buffers)
+{
+  GstBuffer *buffer = GST_PAD_PROBE_INFO_BUFFER (info);
+  GstMapInfo map;
+  guint8 seqnum;
+
+  /* check that the packet arrived intact */
+  fail_unless (gst_buffer_map (buffer, &map, GST_MAP_READ));
+  fail_unless_equals_int (map.size, 12 + PAYLOAD_SIZE);
+  seqnum = GST_READ_UINT16_BE (map.data + 2) & 0xff;
+  fail_unless_equals_int (map.data[12], seqnum);
+  fail_unless_equals_int (map.data[map.size - 1], seqnum);
+  gst_buffer_unmap (buffer, &map);
+
+  g_atomic_int_inc (n_buffers);
+
+  return GST_PAD_PROBE_OK;
+}
+
+static void
+pad_added (GstElement * rtspsrc, GstPad * pad, gint * n_buffers)
+{
+  GstElement *pipeline, *sink;
+  GstPad *sinkpad;
+
+  pipeline = GST_ELEMENT (gst_element_get_parent (rtspsrc));
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (sink, "sync", FALSE, "async", FALSE, NULL);
+  gst_bin_add (GST_BIN (pipeline), sink);
+  gst_element_sync_state_with_parent (sink);
+
+  sinkpad = gst_element_get_static_pad (sink, "sink");
+  fail_unless_equals_int (gst_pad_link (pad, sinkpad), GST_PAD_LINK_OK);
+  gst_pad_add_probe (sinkpad, GST_PAD_PROBE_TYPE_BUFFER,
+      (GstPadProbeCallback) count_buffers, n_buffers, NULL);
+  gst_object_unref (sinkpad);
+  gst_object_unref (pipeline);
+}
+
+static guint
+count_threads (void)
+{
+  GDir *dir;
+  guint n = 0;
+
+  if (!(dir = g_dir_open ("/proc/self/task", 0, NULL)))
+    return 0;
+  while (g_dir_read_name (dir))
+    n++;
+  g_dir_close (dir);
+
+  return n;
+}
+
+/* plays @n_clients RTSP sources until they all received some buffers and
+ * returns the number of threads of the process while they were running, or 0
+ * if that is not known */
+static guint
+run_clients (TestServer * server, guint n_clients, const gchar * protocols,
+    guint receive_threads)
+{
+  GstElement *pipeline;
+  gint *n_buffers;
+  gchar *location;
+  gint64 end_time;
+  guint i, n_threads;
+
+  pipeline = gst_pipeline_new (NULL);
+  n_buffers = g_new0 (gint, n_clients);
+  location = g_strdup_printf ("rtsp://127.0.0.1:%u/test", server->port);
+
+  for (i = 0; i < n_clients; i++) {
+    GstElement *src;
+
+    src = gst_element_factory_make ("rtspsrc", NULL);
+    fail_unless (src != NULL);
+    g_object_set (src, "location", location, "receive-threads",
+        receive_threads, NULL);
+    gst_util_set_object_arg (G_OBJECT (src), "protocols", protocols);
+    g_signal_connect (src, "pad-added", G_CALLBACK (pad_added),
+        &n_buffers[i]);
+    gst_bin_add (GST_BIN (pipeline), src);
+  }
+
+  fail_unless (gst_element_set_state (pipeline,
+          GST_STATE_PLAYING) != GST_STATE_CHANGE_FAILURE);
+
+  end_time = g_get_monotonic_time () + 20 * G_TIME_SPAN_SECOND;
+  for (i = 0; i < n_clients; i++) {
+    while (g_atomic_int_get (&n_buffers[i]) < MIN_BUFFERS) {
+      fail_unless (g_get_monotonic_time () < end_time,
+          "client %u received only %d buffers", i,
+          g_atomic_int_get (&n_buffers[i]));
+      g_usleep (10 * 1000);
+    }
+  }
+  n_threads = count_threads ();
+
+  GST_INFO ("%u %s clients with %u receive threads: %u threads", n_clients,
+      protocols, receive_threads, n_threads);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+  g_free (location);
+  g_free (n_buffers);
+
+  return n_threads;
+}
+
+GST_START_TEST (rtspsrc_shared_receive)
+{
+  TestServer *server;
+
+  server = test_server_new ();
+  run_clients (server, 4, "udp", 2);
+  test_server_free (server);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (rtspsrc_interleaved)
+{
+  TestServer *server;
+
+  server = test_server_new ();
+  run_clients (server, 2, "tcp", 0);
+  test_server_free (server);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (rtspsrc_receive_threads_scalability)
+{
+  TestServer *server;
+  const gchar *env;
+  guint n_clients = 16;
+  guint default_threads, shared_threads;
+
+  if ((env = g_getenv ("RTSPSRC_TEST_CLIENTS")))
+    n_clients = MAX (1, atoi (env));
+
+  server = test_server_new ();
+  default_threads = run_clients (server, n_clients, "udp", 0);
+  shared_threads = run_clients (server, n_clients, "udp", 2);
+  test_server_free (server);
+
+  /* every client has a udpsrc thread for RTP and RTCP by default, in shared
+   * mode they use the same two threads. Allow for the idle threads that the
+   * default task pool keeps around after the first run. */
+  if (n_clients >= 4 && default_threads > 0 && shared_threads > 0)
+    fail_unless (shared_threads + n_clients <= default_threads,
+        "%u threads in shared mode, %u by default", shared_threads,
+        default_threads);
+}
+
+GST_END_TEST;
+
+static Suite *
+rtspsrc_suite (void)
+{
+  Suite *s = suite_create ("rtspsrc");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 60);
+  tcase_add_test (tc_chain, rtspsrc_shared_receive);
+  tcase_add_test (tc_chain, rtspsrc_interleaved);
+  tcase_add_test (tc_chain, rtspsrc_receive_threads_scalability);
+
+  return s;
+}
+
+GST_CHECK_MAIN (rtspsrc);
@@ -0,0 +1,378 @@
+/* GStreamer
+ *
+ * unit test for scaletempo
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/gst.h>
+#include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/audio/audio.h>
+
+#include <math.h>
+#include <string.h>
+
+#define RATE 48000
+#define CHANNELS 3
+#define FRAMES (2 * RATE)
+#define FRAMES_PER_BUFFER 4800
+/* default stride, overlap and search of 30 ms, 20% and 14 ms at 48 kHz */
+#define STRIDE 1440
+#define OVERLAP 288
+#define SEARCH 672
+
+enum
+{
+  SEARCH_EXHAUSTIVE,
+  SEARCH_COARSE_TO_FINE,
+  SEARCH_NONE
+};
+
+/* A stationary 220 Hz tone with 8 harmonics, with different phases in each
+ * channel. Both are periodic, so a good overlap position exists for every
+ * stride. */
+static gdouble *
+create_input (void)
+{
+  gdouble *in = g_new (gdouble, FRAMES * CHANNELS);
+  guint i, c, h;
+
+  for (i = 0; i < FRAMES; i++) {
+    for (c = 0; c < CHANNELS; c++) {
+      gdouble v = 0.0;
+
+      for (h = 1; h <= 8; h++)
+        v += 0.3 / h * sin (2.0 * G_PI * 220.0 * h * i / RATE + c * h);
+      in[i * CHANNELS + c] = v;
+    }
+  }
+
+  return in;
+}
+
+/* Plays the input at rate 2.0 and returns the output converted to doubles */
+static gdouble *
+run_scaletempo (const gdouble * in, GstAudioFormat format, gint search_mode,
+    gint max_threads, guint * n_out)
+{
+  GstHarness *h;
+  GstBuffer *buf;
+  GstSegment segment;
+  GstMapInfo map;
+  gdouble *out;
+  guint i, bps = format == GST_AUDIO_FORMAT_S16 ? 2 : 4;
+  gchar *caps;
+
+  h = gst_harness_new ("scaletempo");
+  if (search_mode == SEARCH_NONE)
+    g_object_set (h->element, "search", 0, NULL);
+  else
+    g_object_set (h->element, "search-mode", search_mode, NULL);
+  g_object_set (h->element, "max-threads", max_threads, NULL);
+
+  caps = g_strdup_printf ("audio/x-raw, format = (string) %s, "
+      "layout = (string) interleaved, rate = (int) %d, channels = (int) %d",
+      gst_audio_format_to_string (format), RATE, CHANNELS);
+  gst_harness_set_src_caps_str (h, caps);
+  g_free (caps);
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  segment.rate = 2.0;
+  fail_unless (gst_harness_push_event (h, gst_event_new_segment (&segment)));
+
+  for (i = 0; i < FRAMES; i += FRAMES_PER_BUFFER) {
+    guint j;
+
+    buf = gst_buffer_new_and_alloc (FRAMES_PER_BUFFER * CHANNELS * bps);
+    gst_buffer_map (buf, &map, GST_MAP_WRITE);
+    for (j = 0; j < FRAMES_PER_BUFFER * CHANNELS; j++) {
+      gdouble v = in[i * CHANNELS + j];
+
+      if (format == GST_AUDIO_FORMAT_S16)
+        ((gint16 *) map.data)[j] = v * 32767.0;
+      else
+        ((gfloat *) map.data)[j] = v;
+    }
+    gst_buffer_unmap (buf, &map);
+    GST_BUFFER_TIMESTAMP (buf) =
+        gst_util_uint64_scale_int (i, GST_SECOND, RATE);
+    GST_BUFFER_DURATION (buf) =
+        gst_util_uint64_scale_int (FRAMES_PER_BUFFER, GST_SECOND, RATE);
+    fail_unless_equals_int (gst_harness_push (h, buf), GST_FLOW_OK);
+  }
+
+  out = g_new (gdouble, FRAMES * CHANNELS);
+  *n_out = 0;
+  while ((buf = gst_harness_try_pull (h))) {
+    guint n;
+
+    gst_buffer_map (buf, &map, GST_MAP_READ);
+    n = map.size / bps;
+    fail_unless (*n_out * CHANNELS + n <= FRAMES * CHANNELS);
+    for (i = 0; i < n; i++) {
+      if (format == GST_AUDIO_FORMAT_S16)
+        out[*n_out * CHANNELS + i] = ((gint16 *) map.data)[i] / 32767.0;
+      else
+        out[*n_out * CHANNELS + i] = ((gfloat *) map.data)[i];
+    }
+    *n_out += n / CHANNELS;
+    gst_buffer_unmap (buf, &map);
+    gst_buffer_unref (buf);
+  }
+
+  gst_harness_teardown (h);
+
+  /* 2 s of input at twice the speed, minus what is still queued */
+  fail_unless (*n_out > FRAMES / 2 - 2 * STRIDE, "only %u frames", *n_out);
+
+  return out;
+}
+
+/* Lowest energy of any window of overlap length, relative to the average
+ * energy. Overlaps at a bad position partially cancel and show up as dips,
+ * while for the periodic input this is the same everywhere. */
+static gdouble
+min_window_energy (const gdouble * data, guint n_frames)
+{
+  gdouble total = 0.0, min = G_MAXDOUBLE;
+  guint i, j;
+
+  for (i = 0; i < n_frames * CHANNELS; i++)
+    total += data[i] * data[i];
+  total /= n_frames;
+
+  for (i = 0; i + OVERLAP <= n_frames; i += OVERLAP / 2) {
+    gdouble e = 0.0;
+
+    for (j = 0; j < OVERLAP * CHANNELS; j++)
+      e += data[i * CHANNELS + j] * data[i * CHANNELS + j];
+    min = MIN (min, e / OVERLAP / total);
+  }
+
+  return min;
+}
+
+static void
+check_search_quality (GstAudioFormat format)
+{
+  gdouble *in, *out;
+  gdouble reference, exhaustive, coarse, none;
+  guint n_out;
+
+  in = create_input ();
+  reference = min_window_energy (in, FRAMES);
+
+  /* the first stride is blended with silence, skip it */
+  out = run_scaletempo (in, format, SEARCH_EXHAUSTIVE, 1, &n_out);
+  exhaustive = min_window_energy (out + STRIDE * CHANNELS, n_out - STRIDE);
+  g_free (out);
+
+  out = run_scaletempo (in, format, SEARCH_COARSE_TO_FINE, 1, &n_out);
+  coarse = min_window_energy (out + STRIDE * CHANNELS, n_out - STRIDE);
+  g_free (out);
+
+  out = run_scaletempo (in, format, SEARCH_NONE, 1, &n_out);
+  none = min_window_energy (out + STRIDE * CHANNELS, n_out - STRIDE);
+  g_free (out);
+
+  GST_DEBUG ("input %f, exhaustive %f, coarse-to-fine %f, no search %f",
+      reference, exhaustive, coarse, none);
+
+  /* without search, overlaps cancel out noticeably */
+  fail_unless (none < 0.8 * reference, "%f", none);
+  fail_unless (exhaustive > 0.97 * reference, "%f", exhaustive);
+  fail_unless (coarse > 0.97 * reference, "%f", coarse);
+  fail_unless (coarse > exhaustive - 0.01, "%f < %f", coarse, exhaustive);
+
+  g_free (in);
+}
+
+GST_START_TEST (test_search_quality_f32)
+{
+  check_search_quality (GST_AUDIO_FORMAT_F32);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_search_quality_s16)
+{
+  check_search_quality (GST_AUDIO_FORMAT_S16);
+}
+
+GST_END_TEST;
+
+/* The tone from create_input() with noise, so that one overlap position
+ * correlates clearly best at every stride */
+static gdouble *
+create_noisy_input (void)
+{
+  gdouble *in = create_input ();
+  GRand *rand = g_rand_new_with_seed (42);
+  guint i;
+
+  for (i = 0; i < FRAMES * CHANNELS; i++)
+    in[i] = 0.7 * in[i] + g_rand_double_range (rand, -0.2, 0.2);
+  g_rand_free (rand);
+
+  return in;
+}
+
+/* The F32 processing of scaletempo before the correlation was vectorized,
+ * at rate 2.0 and with the default settings. The correlation is summed up
+ * sample by sample. */
+static gdouble *
+run_previous_f32 (const gdouble * in, guint * n_out)
+{
+  gfloat *input, *overlap, *window, *blend, *pre_corr;
+  gdouble *out;
+  guint pos, i, n_pre_corr = (OVERLAP - 1) * CHANNELS;
+
+  input = g_new (gfloat, FRAMES * CHANNELS);
+  for (i = 0; i < FRAMES * CHANNELS; i++)
+    input[i] = in[i];
+
+  overlap = g_new0 (gfloat, OVERLAP * CHANNELS);
+  blend = g_new (gfloat, OVERLAP * CHANNELS);
+  for (i = 0; i < OVERLAP * CHANNELS; i++)
+    blend[i] = (i / CHANNELS) / (gfloat) OVERLAP;
+  window = g_new (gfloat, n_pre_corr);
+  for (i = 0; i < n_pre_corr; i++) {
+    guint frame = i / CHANNELS + 1;
+
+    window[i] = frame * (OVERLAP - frame);
+  }
+  pre_corr = g_new (gfloat, n_pre_corr);
+
+  out = g_new (gdouble, FRAMES * CHANNELS);
+  *n_out = 0;
+  for (pos = 0; pos + SEARCH + STRIDE + OVERLAP <= FRAMES; pos += 2 * STRIDE) {
+    const gfloat *queue = input + pos * CHANNELS;
+    gfloat best_corr = G_MININT;
+    guint off, best_off = 0;
+    gdouble *pout = out + *n_out * CHANNELS;
+
+    for (i = 0; i < n_pre_corr; i++)
+      pre_corr[i] = window[i] * overlap[CHANNELS + i];
+
+    for (off = 0; off < SEARCH; off++) {
+      const gfloat *ps = queue + (off + 1) * CHANNELS;
+      gfloat corr = 0;
+
+      for (i = 0; i < n_pre_corr; i++)
+        corr += pre_corr[i] * ps[i];
+      if (corr > best_corr) {
+        best_corr = corr;
+        best_off = off;
+      }
+    }
+
+    queue += best_off * CHANNELS;
+    for (i = 0; i < OVERLAP * CHANNELS; i++) {
+      gfloat v = overlap[i] - blend[i] * (overlap[i] - queue[i]);
+
+      pout[i] = v;
+    }
+    for (; i < STRIDE * CHANNELS; i++)
+      pout[i] = queue[i];
+    memcpy (overlap, queue + STRIDE * CHANNELS,
+        OVERLAP * CHANNELS * sizeof (gfloat));
+    *n_out += STRIDE;
+  }
+
+  g_free (input);
+  g_free (overlap);
+  g_free (blend);
+  g_free (window);
+  g_free (pre_corr);
+
+  return out;
+}
+
+GST_START_TEST (test_previous_output_f32)
+{
+  gdouble *in, *out, *previous;
+  gdouble max_diff = 0.0;
+  guint i, n_out, n_previous;
+
+  in = create_noisy_input ();
+  previous = run_previous_f32 (in, &n_previous);
+  out = run_scaletempo (in, GST_AUDIO_FORMAT_F32, SEARCH_EXHAUSTIVE, 1,
+      &n_out);
+
+  /* The float correlation is summed up in a different order now, which
+   * only changes its rounding. With a clear best overlap position the
+   * search picks the same one as before, so the output must match the
+   * previous one to within 1e-6. A different position would differ by
+   * about the signal level. */
+  fail_unless_equals_int (n_out, n_previous);
+  for (i = 0; i < n_out * CHANNELS; i++)
+    max_diff = MAX (max_diff, fabs (out[i] - previous[i]));
+  GST_DEBUG ("largest difference to the previous output: %g", max_diff);
+  fail_unless (max_diff <= 1e-6, "difference %g", max_diff);
+
+  g_free (in);
+  g_free (out);
+  g_free (previous);
+}
+
+GST_END_TEST;
+
+static void
+check_threads (GstAudioFormat format, gint search_mode)
+{
+  gdouble *in, *out1, *out4;
+  guint n_out1, n_out4;
+
+  in = create_input ();
+  out1 = run_scaletempo (in, format, search_mode, 1, &n_out1);
+  out4 = run_scaletempo (in, format, search_mode, 4, &n_out4);
+
+  /* splitting the search must not change its result */
+  fail_unless_equals_int (n_out1, n_out4);
+  fail_unless (memcmp (out1, out4, n_out1 * CHANNELS * sizeof (gdouble)) == 0);
+
+  g_free (in);
+  g_free (out1);
+  g_free (out4);
+}
+
+GST_START_TEST (test_threads)
+{
+  check_threads (GST_AUDIO_FORMAT_F32, SEARCH_EXHAUSTIVE);
+  check_threads (GST_AUDIO_FORMAT_F32, SEARCH_COARSE_TO_FINE);
+  check_threads (GST_AUDIO_FORMAT_S16, SEARCH_EXHAUSTIVE);
+  check_threads (GST_AUDIO_FORMAT_S16, SEARCH_COARSE_TO_FINE);
+}
+
+GST_END_TEST;
+
+static Suite *
+scaletempo_suite (void)
+{
+  Suite *s = suite_create ("scaletempo");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_search_quality_f32);
+  tcase_add_test (tc_chain, test_search_quality_s16);
+  tcase_add_test (tc_chain, test_previous_output_f32);
+  tcase_add_test (tc_chain, test_threads);
+
+  return s;
+}
+
+GST_CHECK_MAIN (scaletempo);
@@ -52,6 +52,13 @@ static const char *realm = "SOUPHTTPSRC_REALM";
 static const char *basic_auth_path = "/basic_auth";
 static const char *digest_auth_path = "/digest_auth";
 
+/* a resource large enough to be fetched in several blocks */
+static const char *large_path = "/large";
+/* the same resource, answering range requests with the complete body */
+static const char *large_no_ranges_path = "/large-no-ranges";
+#define LARGE_SIZE (4 * 1024 * 1024)
+static guint large_gets = 0;
+
 static guint get_port_from_server (SoupServer * server);
 static SoupServer *run_server (gboolean use_https);
 
@@ -421,6 +428,153 @@ GST_START_TEST (test_icy_stream)
 
 GST_END_TEST;
 
+static void
+large_handoff_cb (GstElement * fakesink, GstBuffer * buf, GstPad * pad,
+    guint64 * received)
+{
+  GstMapInfo map;
+  guint64 offset = GST_BUFFER_OFFSET (buf);
+  gsize i;
+
+  gst_buffer_map (buf, &map, GST_MAP_READ);
+  for (i = 0; i < map.size; i++) {
+    if (map.data[i] != (guint8) ((offset + i) % 251)) {
+      GST_ERROR ("wrong byte at offset %" G_GUINT64_FORMAT, offset + i);
+      *received = G_MAXUINT64;
+      break;
+    }
+  }
+  gst_buffer_unmap (buf, &map);
+
+  if (*received != G_MAXUINT64)
+    *received += map.size;
+}
+
+static void
+wait_for_eos (GstElement * pipe)
+{
+  GstMessage *msg;
+
+  /* also runs the server, which is attached to the default main context */
+  msg = gst_bus_poll (GST_ELEMENT_BUS (pipe),
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR, -1);
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+}
+
+GST_START_TEST (test_parallel_fetch)
+{
+  GstElement *pipe, *src, *sink;
+  SoupServer *server;
+  guint64 received = 0;
+  gchar *url;
+
+  server = run_server (FALSE);
+  if (server == NULL) {
+    g_print ("Failed to start up HTTP server");
+    /* skip this test */
+    return;
+  }
+
+  pipe = gst_pipeline_new (NULL);
+
+  src = gst_element_factory_make ("souphttpsrc", NULL);
+  fail_unless (src != NULL);
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  fail_unless (sink != NULL);
+
+  gst_bin_add (GST_BIN (pipe), src);
+  gst_bin_add (GST_BIN (pipe), sink);
+  fail_unless (gst_element_link (src, sink));
+
+  url = g_strdup_printf ("http://127.0.0.1:%u%s",
+      get_port_from_server (server), large_path);
+  g_object_set (src, "location", url, "parallel-connections", 4,
+      "fetch-block-size", 256 * 1024, "cache-size",
+      (guint64) 8 * 1024 * 1024, NULL);
+  g_free (url);
+
+  g_object_set (sink, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (large_handoff_cb),
+      &received);
+
+  large_gets = 0;
+  gst_element_set_state (pipe, GST_STATE_PLAYING);
+  wait_for_eos (pipe);
+
+  fail_unless_equals_uint64 (received, LARGE_SIZE);
+  /* one range request per block */
+  fail_unless_equals_int (large_gets, LARGE_SIZE / (256 * 1024));
+
+  /* the blocks after the seek position are all in the cache */
+  received = 0;
+  fail_unless (gst_element_seek_simple (pipe, GST_FORMAT_BYTES,
+          GST_SEEK_FLAG_FLUSH, 1024 * 1024));
+  wait_for_eos (pipe);
+
+  fail_unless_equals_uint64 (received, LARGE_SIZE - 1024 * 1024);
+  fail_unless_equals_int (large_gets, LARGE_SIZE / (256 * 1024));
+
+  gst_element_set_state (pipe, GST_STATE_NULL);
+  gst_object_unref (pipe);
+  gst_object_unref (server);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_parallel_fetch_no_ranges)
+{
+  GstElement *pipe, *src, *sink;
+  SoupServer *server;
+  guint64 received = 0;
+  gchar *url;
+
+  server = run_server (FALSE);
+  if (server == NULL) {
+    g_print ("Failed to start up HTTP server");
+    /* skip this test */
+    return;
+  }
+
+  pipe = gst_pipeline_new (NULL);
+
+  src = gst_element_factory_make ("souphttpsrc", NULL);
+  fail_unless (src != NULL);
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  fail_unless (sink != NULL);
+
+  gst_bin_add (GST_BIN (pipe), src);
+  gst_bin_add (GST_BIN (pipe), sink);
+  fail_unless (gst_element_link (src, sink));
+
+  /* fails if every block is retried until max-retries */
+  url = g_strdup_printf ("http://127.0.0.1:%u%s",
+      get_port_from_server (server), large_no_ranges_path);
+  g_object_set (src, "location", url, "parallel-connections", 4,
+      "fetch-block-size", 256 * 1024, "retries", 1, NULL);
+  g_free (url);
+
+  g_object_set (sink, "signal-handoffs", TRUE, NULL);
+  g_signal_connect (sink, "handoff", G_CALLBACK (large_handoff_cb),
+      &received);
+
+  large_gets = 0;
+  gst_element_set_state (pipe, GST_STATE_PLAYING);
+  wait_for_eos (pipe);
+
+  /* downloaded sequentially after the first range requests */
+  fail_unless_equals_uint64 (received, LARGE_SIZE);
+  fail_unless (large_gets <= 4 + 1);
+
+  gst_element_set_state (pipe, GST_STATE_NULL);
+  gst_object_unref (pipe);
+  gst_object_unref (server);
+}
+
+GST_END_TEST;
+
 static Suite *
 souphttpsrc_suite (void)
 {
@@ -450,6 +604,8 @@ souphttpsrc_suite (void)
   tcase_add_test (tc_chain, test_bad_user_digest_auth);
   tcase_add_test (tc_chain, test_bad_password_digest_auth);
   tcase_add_test (tc_chain, test_https);
+  tcase_add_test (tc_chain, test_parallel_fetch);
+  tcase_add_test (tc_chain, test_parallel_fetch_no_ranges);
 
   suite_add_tcase (s, tc_internet);
   tcase_set_timeout (tc_internet, 250);
@@ -486,6 +642,11 @@ do_get (SoupMessage * msg, const char *path)
   else if (!strcmp (path, "/404-with-data")) {
     status = SOUP_STATUS_NOT_FOUND;
     send_error_doc = TRUE;
+  } else if (!strcmp (path, large_path))
+    buflen = LARGE_SIZE;
+  else if (!strcmp (path, large_no_ranges_path)) {
+    buflen = LARGE_SIZE;
+    soup_message_headers_remove (msg->request_headers, "Range");
   }
 
   if (SOUP_STATUS_IS_REDIRECTION (status)) {
@@ -502,7 +663,16 @@ do_get (SoupMessage * msg, const char *path)
     char *buf;
 
     buf = g_malloc (buflen);
-    memset (buf, 0, buflen);
+    if (buflen == LARGE_SIZE) {
+      int i;
+
+      /* the server answers range requests from the complete body */
+      for (i = 0; i < buflen; i++)
+        buf[i] = i % 251;
+      large_gets++;
+    } else {
+      memset (buf, 0, buflen);
+    }
     soup_message_body_append (msg->response_body, SOUP_MEMORY_TAKE,
         buf, buflen);
   } else {                      /* msg->method == SOUP_METHOD_HEAD */
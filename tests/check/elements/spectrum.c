@@ -21,6 +21,7 @@
  */
 
 #include <unistd.h>
+#include <math.h>
 
 #include <gst/audio/audio.h>
 #include <gst/check/gstcheck.h>
@@ -71,7 +72,15 @@ GstPad *mysrcpad, *mysinkpad;
     " layout = (string) interleaved, " \
     " format = (string) " GST_AUDIO_NE(F64)
 
+#define SPECT_CAPS_STRING_F32_STEREO \
+    "audio/x-raw, "                                                   \
+    " rate = (int) 44100, "                                           \
+    " channels = (int) 2, "                                           \
+    " layout = (string) interleaved, " \
+    " format = (string) " GST_AUDIO_NE(F32)
+
 #define SPECT_BANDS 256
+#define SPECT_OUTPUT_BANDS 32
 
 static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE ("sink",
     GST_PAD_SINK,
@@ -522,6 +531,84 @@ GST_START_TEST (test_float64)
 
 GST_END_TEST;
 
+GST_START_TEST (test_packed_aggregated)
+{
+  GstElement *spectrum;
+  GstBuffer *inbuffer;
+  GstBus *bus;
+  GstMessage *message;
+  const GstStructure *structure;
+  int i, j;
+  gfloat *data;
+  GstMapInfo map;
+  const GValue *value;
+  GBytes *bytes;
+  const gfloat *levels;
+  gsize size;
+  gfloat max_level = -80.0;
+
+  spectrum = setup_spectrum (SPECT_CAPS_STRING_F32_STEREO);
+  g_object_set (spectrum, "post-messages", TRUE, "interval", GST_SECOND / 100,
+      "bands", SPECT_BANDS, "threshold", -80, "multi-channel", TRUE,
+      "hop-size", SPECT_BANDS / 2, "output-bands", SPECT_OUTPUT_BANDS,
+      "packed-messages", TRUE, NULL);
+
+  fail_unless (gst_element_set_state (spectrum,
+          GST_STATE_PLAYING) == GST_STATE_CHANGE_SUCCESS,
+      "could not set to playing");
+
+  /* create a 1 sec buffer with an 11025 Hz sine wave on the first channel
+   * and silence on the second */
+  inbuffer = gst_buffer_new_allocate (NULL, 2 * 44100 * sizeof (gfloat), 0);
+  gst_buffer_map (inbuffer, &map, GST_MAP_WRITE);
+  data = (gfloat *) map.data;
+  for (j = 0; j < 44100; j++) {
+    data[2 * j] = (j % 2) ? ((j % 4 == 1) ? 1.0 : -1.0) : 0.0;
+    data[2 * j + 1] = 0.0;
+  }
+  gst_buffer_unmap (inbuffer, &map);
+
+  bus = gst_bus_new ();
+  gst_element_set_bus (spectrum, bus);
+
+  fail_unless (gst_pad_push (mysrcpad, inbuffer) == GST_FLOW_OK);
+
+  message = gst_bus_poll (bus, GST_MESSAGE_ELEMENT, -1);
+  fail_unless (message != NULL);
+  structure = gst_message_get_structure (message);
+  fail_unless_equals_string ((char *) gst_structure_get_name (structure),
+      "spectrum");
+  fail_if (gst_structure_has_field (structure, "phase"));
+
+  value = gst_structure_get_value (structure, "magnitude");
+  fail_unless (G_VALUE_HOLDS (value, G_TYPE_BYTES));
+  bytes = g_value_get_boxed (value);
+  levels = g_bytes_get_data (bytes, &size);
+  fail_unless_equals_int (size, 2 * SPECT_OUTPUT_BANDS * sizeof (gfloat));
+
+  /* the 8 FFT bands around the sine end up in the two middle output bands
+   * of the first channel, the second channel is at the threshold */
+  for (i = 0; i < SPECT_OUTPUT_BANDS; i++) {
+    GST_DEBUG ("band[%2d] is %.2f / %.2f", i, levels[i],
+        levels[SPECT_OUTPUT_BANDS + i]);
+    if (i != SPECT_OUTPUT_BANDS / 2 && i != SPECT_OUTPUT_BANDS / 2 - 1)
+      max_level = MAX (max_level, levels[i]);
+    fail_unless (fabs (levels[SPECT_OUTPUT_BANDS + i] + 80.0) < 0.001);
+  }
+  fail_unless (levels[SPECT_OUTPUT_BANDS / 2] > max_level);
+  fail_unless (levels[SPECT_OUTPUT_BANDS / 2 - 1] > max_level);
+
+  gst_message_unref (message);
+  gst_bus_set_flushing (bus, TRUE);
+  gst_element_set_bus (spectrum, NULL);
+  gst_object_unref (bus);
+  fail_unless (gst_element_set_state (spectrum,
+          GST_STATE_NULL) == GST_STATE_CHANGE_SUCCESS, "could not set to null");
+  cleanup_spectrum (spectrum);
+}
+
+GST_END_TEST;
+
 
 static Suite *
 spectrum_suite (void)
@@ -534,6 +621,7 @@ spectrum_suite (void)
   tcase_add_test (tc_chain, test_int32);
   tcase_add_test (tc_chain, test_float32);
   tcase_add_test (tc_chain, test_float64);
+  tcase_add_test (tc_chain, test_packed_aggregated);
 
   return s;
 }
@@ -19,6 +19,7 @@
  */
 #include <gst/check/gstcheck.h>
 #include <gst/base/gstbasesink.h>
+#include <gio/gio.h>
 #include <stdlib.h>
 
 static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE ("src",
@@ -204,6 +205,85 @@ GST_START_TEST (test_udpsink_client_add_remove)
 
 GST_END_TEST;
 
+#define PACED_PACKETS 20
+
+GST_START_TEST (test_udpsink_pacing)
+{
+  GstSegment segment;
+  GstElement *udpsink;
+  GstPad *srcpad;
+  GSocket *socket;
+  GInetAddress *ia;
+  GSocketAddress *sa;
+  GstStructure *stats;
+  gint64 start, elapsed;
+  guint port, max_burst_packets, i;
+  gchar data[RTP_HEADER_SIZE + RTP_PAYLOAD_SIZE];
+
+  /* a socket to receive the packets on */
+  socket = g_socket_new (G_SOCKET_FAMILY_IPV4, G_SOCKET_TYPE_DATAGRAM,
+      G_SOCKET_PROTOCOL_UDP, NULL);
+  fail_unless (socket != NULL);
+  ia = g_inet_address_new_loopback (G_SOCKET_FAMILY_IPV4);
+  sa = g_inet_socket_address_new (ia, 0);
+  fail_unless (g_socket_bind (socket, sa, TRUE, NULL));
+  g_object_unref (sa);
+  g_object_unref (ia);
+  sa = g_socket_get_local_address (socket, NULL);
+  port = g_inet_socket_address_get_port (G_INET_SOCKET_ADDRESS (sa));
+  g_object_unref (sa);
+
+  /* 100000 bytes per second, at most one packet back to back */
+  udpsink = gst_check_setup_element ("udpsink");
+  g_object_set (udpsink, "host", "127.0.0.1", "port", port,
+      "pacing-rate", (guint64) 800000, "pacing-burst", 1500, NULL);
+  gst_util_set_object_arg (G_OBJECT (udpsink), "pacing", "timer");
+
+  srcpad = gst_check_setup_src_pad_by_name (udpsink, &srctemplate, "sink");
+
+  gst_element_set_state (udpsink, GST_STATE_PLAYING);
+  gst_pad_set_active (srcpad, TRUE);
+
+  gst_pad_push_event (srcpad, gst_event_new_stream_start ("hey there!"));
+
+  gst_segment_init (&segment, GST_FORMAT_TIME);
+  gst_pad_push_event (srcpad, gst_event_new_segment (&segment));
+
+  start = g_get_monotonic_time ();
+  for (i = 0; i < PACED_PACKETS; i++) {
+    GstBuffer *buf;
+
+    buf = gst_buffer_new_allocate (NULL, sizeof (data), NULL);
+    gst_buffer_memset (buf, 0, 0, sizeof (data));
+    GST_BUFFER_PTS (buf) = 0;
+    fail_unless_equals_int (gst_pad_push (srcpad, buf), GST_FLOW_OK);
+  }
+  elapsed = g_get_monotonic_time () - start;
+
+  /* the bucket allows the first packet or two right away, the rest go at the
+   * rate: about 190 ms */
+  GST_INFO ("sent %u packets in %" G_GINT64_FORMAT " us", PACED_PACKETS,
+      elapsed);
+  fail_unless (elapsed >= 150 * G_TIME_SPAN_MILLISECOND);
+
+  g_object_get (udpsink, "pacing-stats", &stats, NULL);
+  fail_unless (gst_structure_get_uint (stats, "max-burst-packets",
+          &max_burst_packets));
+  fail_unless (max_burst_packets > 0 && max_burst_packets <= 2);
+  gst_structure_free (stats);
+
+  /* all of them arrived */
+  for (i = 0; i < PACED_PACKETS; i++)
+    fail_unless_equals_int (g_socket_receive (socket, data, sizeof (data),
+            NULL, NULL), sizeof (data));
+
+  gst_check_teardown_pad_by_name (udpsink, "sink");
+  gst_check_teardown_element (udpsink);
+  g_object_unref (socket);
+}
+
+GST_END_TEST;
+
 static Suite *
 udpsink_suite (void)
 {
@@ -215,6 +295,7 @@ udpsink_suite (void)
   tcase_add_test (tc_chain, test_udpsink);
   tcase_add_test (tc_chain, test_udpsink_bufferlist);
   tcase_add_test (tc_chain, test_udpsink_client_add_remove);
+  tcase_add_test (tc_chain, test_udpsink_pacing);
 
   return s;
 }
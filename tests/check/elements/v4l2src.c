@@ -0,0 +1,198 @@
+/* GStreamer
+ *
+ * unit test for v4l2src, run against the vivid virtual driver
+ *
+ *   modprobe vivid
+ *
+ * The tests are skipped when no vivid capture device is found.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/gst.h>
+#include <gst/check/gstcheck.h>
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/videodev2.h>
+
+#define NUM_FRAMES 120
+
+typedef struct
+{
+  GstClockTime base_time;
+  GstClockTime last_pts;
+  guint n_frames;
+  gdouble latency_sum;
+  GstClockTime latency_max;
+  gdouble jitter_sum;
+  GstClockTime duration;
+} LatencyStats;
+
+static gchar *
+find_vivid_device (void)
+{
+  guint i;
+
+  for (i = 0; i < 64; i++) {
+    gchar *device = g_strdup_printf ("/dev/video%u", i);
+    struct v4l2_capability cap;
+    gboolean found = FALSE;
+    gint fd;
+
+    fd = open (device, O_RDWR);
+    if (fd >= 0) {
+      memset (&cap, 0, sizeof (cap));
+      found = ioctl (fd, VIDIOC_QUERYCAP, &cap) == 0
+          && strcmp ((const gchar *) cap.driver, "vivid") == 0
+          && (cap.device_caps & V4L2_CAP_VIDEO_CAPTURE)
+          && (cap.device_caps & V4L2_CAP_STREAMING);
+      close (fd);
+    }
+
+    if (found)
+      return device;
+    g_free (device);
+  }
+
+  return NULL;
+}
+
+static void
+handoff_cb (GstElement * sink, GstBuffer * buf, GstPad * pad,
+    LatencyStats * stats)
+{
+  GstClock *clock = gst_element_get_clock (sink);
+  GstClockTime now, pts = GST_BUFFER_PTS (buf);
+
+  fail_unless (clock != NULL);
+  now = gst_clock_get_time (clock) - stats->base_time;
+  gst_object_unref (clock);
+
+  fail_unless (GST_CLOCK_TIME_IS_VALID (pts));
+  fail_unless (pts <= now + GST_MSECOND, "frame timestamped in the future");
+
+  if (stats->n_frames > 0) {
+    fail_unless (pts > stats->last_pts, "timestamps not increasing");
+    stats->jitter_sum += ABS (GST_CLOCK_DIFF (stats->last_pts, pts) -
+        (GstClockTimeDiff) GST_BUFFER_DURATION (buf));
+  }
+
+  stats->latency_sum += now - pts;
+  stats->latency_max = MAX (stats->latency_max, now - pts);
+  stats->duration = GST_BUFFER_DURATION (buf);
+  stats->last_pts = pts;
+  stats->n_frames++;
+}
+
+static void
+measure_latency (const gchar * device, gboolean low_latency,
+    LatencyStats * stats)
+{
+  GstElement *pipeline, *src, *sink;
+  GstMessage *msg;
+  GstBus *bus;
+
+  pipeline = gst_parse_launch ("v4l2src name=src ! "
+      "video/x-raw, width = (int) 320, height = (int) 240 ! "
+      "fakesink name=sink sync=false signal-handoffs=true", NULL);
+  fail_unless (pipeline != NULL);
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  g_object_set (src, "device", device, "num-buffers", NUM_FRAMES,
+      "low-latency", low_latency, NULL);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+
+  memset (stats, 0, sizeof (LatencyStats));
+  g_signal_connect (sink, "handoff", G_CALLBACK (handoff_cb), stats);
+
+  fail_unless_equals_int (gst_element_set_state (pipeline, GST_STATE_PAUSED),
+      GST_STATE_CHANGE_NO_PREROLL);
+  fail_unless (gst_element_set_state (pipeline, GST_STATE_PLAYING) !=
+      GST_STATE_CHANGE_FAILURE);
+  fail_unless (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) != GST_STATE_CHANGE_FAILURE);
+  stats->base_time = gst_element_get_base_time (pipeline);
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, 30 * GST_SECOND,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL, "timeout");
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (src);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+
+  fail_unless (stats->n_frames >= NUM_FRAMES);
+  fail_unless (GST_CLOCK_TIME_IS_VALID (stats->duration));
+
+  GST_INFO ("low-latency %d: %u frames of %" GST_TIME_FORMAT ", latency "
+      "average %.3f ms, max %" GST_TIME_FORMAT ", jitter %.3f ms",
+      low_latency, stats->n_frames, GST_TIME_ARGS (stats->duration),
+      stats->latency_sum / stats->n_frames / GST_MSECOND,
+      GST_TIME_ARGS (stats->latency_max),
+      stats->jitter_sum / (stats->n_frames - 1) / GST_MSECOND);
+}
+
+GST_START_TEST (test_low_latency)
+{
+  LatencyStats normal, low_latency;
+  gchar *device;
+
+  device = find_vivid_device ();
+  if (device == NULL) {
+    GST_INFO ("no vivid device found, skipping");
+    return;
+  }
+
+  measure_latency (device, FALSE, &normal);
+  measure_latency (device, TRUE, &low_latency);
+
+  /* the timestamps come from the capture times of the driver, which are
+   * regular for vivid, and not from when the frames happen to be
+   * dequeued */
+  fail_unless (low_latency.jitter_sum / (low_latency.n_frames - 1) <
+      low_latency.duration / 10);
+
+  /* frames must not wait any longer than without the dequeue thread */
+  fail_unless (low_latency.latency_sum / low_latency.n_frames <
+      normal.latency_sum / normal.n_frames + low_latency.duration / 2);
+
+  g_free (device);
+}
+
+GST_END_TEST;
+
+static Suite *
+v4l2src_suite (void)
+{
+  Suite *s = suite_create ("v4l2src");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_set_timeout (tc_chain, 120);
+  tcase_add_test (tc_chain, test_low_latency);
+
+  return s;
+}
+
+GST_CHECK_MAIN (v4l2src);
@@ -26,6 +26,8 @@
 #include <unistd.h>
 
 #include <gst/check/gstcheck.h>
+#include <gst/check/gstharness.h>
+#include <gst/video/video.h>
 
 typedef struct _GstVideoBoxTestContext
 {
@@ -208,6 +210,258 @@ GST_START_TEST (test_caps_transform)
 
 GST_END_TEST;
 
+static GstBuffer *
+create_gray8_buffer (gint width, gint height)
+{
+  GstBuffer *buf;
+  GstMapInfo map;
+  gint i;
+
+  buf = gst_buffer_new_allocate (NULL, width * height, NULL);
+  gst_buffer_map (buf, &map, GST_MAP_WRITE);
+  for (i = 0; i < width * height; i++)
+    map.data[i] = i;
+  gst_buffer_unmap (buf, &map);
+
+  return buf;
+}
+
+GST_START_TEST (test_crop_zero_copy)
+{
+  GstHarness *h;
+  GstBuffer *inbuf, *outbuf;
+  GstMapInfo in_map, out_map;
+
+  h = gst_harness_new_parse ("videobox top=2 bottom=2");
+  gst_harness_set_src_caps_str (h,
+      "video/x-raw,format=GRAY8,width=8,height=8,framerate=1/1");
+
+  inbuf = create_gray8_buffer (8, 8);
+  outbuf = gst_harness_push_and_pull (h, gst_buffer_ref (inbuf));
+  fail_unless (outbuf != NULL);
+  fail_unless_equals_int (gst_buffer_get_size (outbuf), 8 * 4);
+
+  /* the output references the input memory */
+  fail_unless_equals_int (gst_buffer_n_memory (outbuf), 1);
+  fail_unless (gst_buffer_peek_memory (outbuf, 0)->parent ==
+      gst_buffer_peek_memory (inbuf, 0));
+
+  gst_buffer_map (inbuf, &in_map, GST_MAP_READ);
+  gst_buffer_map (outbuf, &out_map, GST_MAP_READ);
+  fail_unless (memcmp (out_map.data, in_map.data + 2 * 8, 4 * 8) == 0);
+  gst_buffer_unmap (outbuf, &out_map);
+  gst_buffer_unmap (inbuf, &in_map);
+
+  gst_buffer_unref (outbuf);
+  gst_buffer_unref (inbuf);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_crop_left)
+{
+  GstHarness *h;
+  GstBuffer *inbuf, *outbuf;
+  GstMapInfo in_map, out_map;
+  gint i;
+
+  h = gst_harness_new_parse ("videobox left=4");
+  gst_harness_set_src_caps_str (h,
+      "video/x-raw,format=GRAY8,width=8,height=8,framerate=1/1");
+
+  inbuf = create_gray8_buffer (8, 8);
+  outbuf = gst_harness_push_and_pull (h, gst_buffer_ref (inbuf));
+  fail_unless (outbuf != NULL);
+  fail_unless_equals_int (gst_buffer_get_size (outbuf), 4 * 8);
+
+  gst_buffer_map (inbuf, &in_map, GST_MAP_READ);
+  gst_buffer_map (outbuf, &out_map, GST_MAP_READ);
+  for (i = 0; i < 8; i++)
+    fail_unless (memcmp (out_map.data + i * 4, in_map.data + i * 8 + 4,
+            4) == 0);
+  gst_buffer_unmap (outbuf, &out_map);
+  gst_buffer_unmap (inbuf, &in_map);
+
+  gst_buffer_unref (outbuf);
+  gst_buffer_unref (inbuf);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* the output references the input memory instead of a copy */
+static gboolean
+shares_memory (GstBuffer * outbuf, GstBuffer * inbuf)
+{
+  GstMemory *out_mem, *in_mem;
+
+  if (gst_buffer_n_memory (outbuf) != 1)
+    return FALSE;
+
+  out_mem = gst_buffer_peek_memory (outbuf, 0);
+  in_mem = gst_buffer_peek_memory (inbuf, 0);
+
+  return out_mem == in_mem || out_mem->parent == in_mem;
+}
+
+GST_START_TEST (test_crop_video_meta)
+{
+  GstHarness *h;
+  GstBuffer *inbuf, *outbuf;
+  GstVideoMeta *meta;
+  GstVideoInfo info;
+  GstVideoFrame frame;
+  guint8 *data;
+  gint i;
+
+  h = gst_harness_new_parse ("videobox left=4");
+  gst_harness_add_propose_allocation_meta (h, GST_VIDEO_META_API_TYPE, NULL);
+  gst_harness_set_src_caps_str (h,
+      "video/x-raw,format=GRAY8,width=8,height=8,framerate=1/1");
+
+  inbuf = create_gray8_buffer (8, 8);
+  outbuf = gst_harness_push_and_pull (h, gst_buffer_ref (inbuf));
+  fail_unless (outbuf != NULL);
+  fail_unless (shares_memory (outbuf, inbuf));
+
+  /* the plane starts at the left edge of the cropped picture */
+  meta = gst_buffer_get_video_meta (outbuf);
+  fail_unless (meta != NULL);
+  fail_unless_equals_int (meta->width, 4);
+  fail_unless_equals_int (meta->height, 8);
+  fail_unless_equals_int (meta->offset[0], 4);
+  fail_unless_equals_int (meta->stride[0], 8);
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_GRAY8, 4, 8);
+  fail_unless (gst_video_frame_map (&frame, &info, outbuf, GST_MAP_READ));
+  data = GST_VIDEO_FRAME_PLANE_DATA (&frame, 0);
+  for (i = 0; i < 8; i++)
+    fail_unless_equals_int (data[i * GST_VIDEO_FRAME_PLANE_STRIDE (&frame,
+                0)], i * 8 + 4);
+  gst_video_frame_unmap (&frame);
+
+  gst_buffer_unref (outbuf);
+  gst_buffer_unref (inbuf);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_crop_crop_meta)
+{
+  GstHarness *h;
+  GstBuffer *inbuf, *outbuf;
+  GstVideoCropMeta *crop_meta;
+  GstVideoMeta *meta;
+  GstVideoInfo info;
+
+  /* an odd top crop of I420 can't be expressed with plane offsets */
+  h = gst_harness_new_parse ("videobox top=1");
+  gst_harness_add_propose_allocation_meta (h, GST_VIDEO_META_API_TYPE, NULL);
+  gst_harness_add_propose_allocation_meta (h, GST_VIDEO_CROP_META_API_TYPE,
+      NULL);
+  gst_harness_set_src_caps_str (h,
+      "video/x-raw,format=I420,width=8,height=8,framerate=1/1");
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_I420, 8, 8);
+  inbuf = gst_buffer_new_allocate (NULL, GST_VIDEO_INFO_SIZE (&info), NULL);
+  gst_buffer_memset (inbuf, 0, 0x80, GST_VIDEO_INFO_SIZE (&info));
+
+  outbuf = gst_harness_push_and_pull (h, gst_buffer_ref (inbuf));
+  fail_unless (outbuf != NULL);
+  fail_unless (shares_memory (outbuf, inbuf));
+
+  /* the full input frame is described, downstream crops it */
+  meta = gst_buffer_get_video_meta (outbuf);
+  fail_unless (meta != NULL);
+  fail_unless_equals_int (meta->width, 8);
+  fail_unless_equals_int (meta->height, 8);
+
+  crop_meta = gst_buffer_get_video_crop_meta (outbuf);
+  fail_unless (crop_meta != NULL);
+  fail_unless_equals_int (crop_meta->x, 0);
+  fail_unless_equals_int (crop_meta->y, 1);
+  fail_unless_equals_int (crop_meta->width, 8);
+  fail_unless_equals_int (crop_meta->height, 7);
+
+  gst_buffer_unref (outbuf);
+  gst_buffer_unref (inbuf);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
+
+/* push a frame and return the output, which is 2 pixels wider with a
+ * border on the left */
+static GstBuffer *
+push_bordered (GstHarness * h, GstVideoFrame * frame)
+{
+  GstVideoInfo info;
+  GstBuffer *outbuf;
+  guint8 *data;
+  gint i, stride;
+
+  outbuf = gst_harness_push_and_pull (h, create_gray8_buffer (8, 8));
+  fail_unless (outbuf != NULL);
+
+  gst_video_info_set_format (&info, GST_VIDEO_FORMAT_GRAY8, 10, 8);
+  fail_unless (gst_video_frame_map (frame, &info, outbuf, GST_MAP_READWRITE));
+
+  /* the picture is always there */
+  data = GST_VIDEO_FRAME_PLANE_DATA (frame, 0);
+  stride = GST_VIDEO_FRAME_PLANE_STRIDE (frame, 0);
+  for (i = 0; i < 8; i++)
+    fail_unless_equals_int (data[i * stride + 2], i * 8);
+
+  return outbuf;
+}
+
+GST_START_TEST (test_reuse_borders)
+{
+  GstHarness *h;
+  GstElement *box;
+  GstBuffer *outbuf;
+  GstMemory *mem;
+  GstVideoFrame frame;
+  guint8 *data;
+
+  h = gst_harness_new_parse ("videobox left=-2 reuse-borders=true");
+  gst_harness_set_src_caps_str (h,
+      "video/x-raw,format=GRAY8,width=8,height=8,framerate=1/1");
+  box = gst_harness_find_element (h, "videobox");
+
+  /* mark the border of the first output buffer */
+  outbuf = push_bordered (h, &frame);
+  mem = gst_buffer_peek_memory (outbuf, 0);
+  data = GST_VIDEO_FRAME_PLANE_DATA (&frame, 0);
+  fail_unless_equals_int (data[0], 16);      /* black */
+  data[0] = 0x55;
+  gst_video_frame_unmap (&frame);
+  gst_buffer_unref (outbuf);
+
+  /* the buffer comes back from the pool with the border left alone */
+  outbuf = push_bordered (h, &frame);
+  fail_unless (gst_buffer_peek_memory (outbuf, 0) == mem);
+  data = GST_VIDEO_FRAME_PLANE_DATA (&frame, 0);
+  fail_unless_equals_int (data[0], 0x55);
+  gst_video_frame_unmap (&frame);
+  gst_buffer_unref (outbuf);
+
+  /* a new border configuration is painted again */
+  gst_util_set_object_arg (G_OBJECT (box), "fill", "white");
+  outbuf = push_bordered (h, &frame);
+  fail_unless (gst_buffer_peek_memory (outbuf, 0) == mem);
+  data = GST_VIDEO_FRAME_PLANE_DATA (&frame, 0);
+  fail_unless_equals_int (data[0], 235);
+  gst_video_frame_unmap (&frame);
+  gst_buffer_unref (outbuf);
+
+  gst_object_unref (box);
+  gst_harness_teardown (h);
+}
+
+GST_END_TEST;
 
 static Suite *
 videobox_suite (void)
@@ -217,6 +471,11 @@ videobox_suite (void)
 
   suite_add_tcase (s, tc_chain);
   tcase_add_test (tc_chain, test_caps_transform);
+  tcase_add_test (tc_chain, test_crop_zero_copy);
+  tcase_add_test (tc_chain, test_crop_left);
+  tcase_add_test (tc_chain, test_crop_video_meta);
+  tcase_add_test (tc_chain, test_crop_crop_meta);
+  tcase_add_test (tc_chain, test_reuse_borders);
 
   return s;
 }
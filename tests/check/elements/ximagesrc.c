@@ -0,0 +1,251 @@
+/* GStreamer
+ *
+ * unit test for ximagesrc, needs an X server such as Xvfb
+ *
+ *   Xvfb :99 & DISPLAY=:99 make elements/ximagesrc.check
+ *
+ * The tests are skipped when no display can be opened.
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/gst.h>
+#include <gst/check/gstcheck.h>
+#include <gst/video/video.h>
+
+#include <string.h>
+
+#define NUM_FRAMES 10
+
+static GList *frames;
+
+static void
+handoff_cb (GstElement * sink, GstBuffer * buf, GstPad * pad, gpointer data)
+{
+  frames = g_list_append (frames, gst_buffer_copy_deep (buf));
+}
+
+/* modifies all but the last frame in place, like a downstream element
+ * drawing on top of the image would */
+static GstPadProbeReturn
+scribble_probe (GstPad * pad, GstPadProbeInfo * info, gpointer data)
+{
+  guint *count = data;
+  GstBuffer *buf;
+  GstMapInfo map;
+
+  if (++(*count) == NUM_FRAMES)
+    return GST_PAD_PROBE_OK;
+
+  buf = gst_buffer_make_writable (GST_PAD_PROBE_INFO_BUFFER (info));
+  fail_unless (gst_buffer_map (buf, &map, GST_MAP_WRITE));
+  memset (map.data, *count, map.size);
+  gst_buffer_unmap (buf, &map);
+  GST_PAD_PROBE_INFO_DATA (info) = buf;
+
+  return GST_PAD_PROBE_OK;
+}
+
+static gboolean
+capture (gboolean use_damage, gboolean scribble, gint * width, gint * height)
+{
+  guint count = 0;
+  GstElement *pipeline, *src, *sink;
+  GstStateChangeReturn sret;
+  GstMessage *msg;
+  GstCaps *caps;
+  GstPad *pad;
+  GstBus *bus;
+  GstStructure *s;
+
+  pipeline = gst_parse_launch ("ximagesrc name=src ! "
+      "video/x-raw, framerate = (fraction) 30/1 ! "
+      "fakesink name=sink signal-handoffs=true", NULL);
+  fail_unless (pipeline != NULL);
+
+  src = gst_bin_get_by_name (GST_BIN (pipeline), "src");
+  g_object_set (src, "num-buffers", NUM_FRAMES, "use-damage", use_damage,
+      NULL);
+  sink = gst_bin_get_by_name (GST_BIN (pipeline), "sink");
+  g_signal_connect (sink, "handoff", G_CALLBACK (handoff_cb), NULL);
+
+  if (scribble) {
+    pad = gst_element_get_static_pad (src, "src");
+    gst_pad_add_probe (pad, GST_PAD_PROBE_TYPE_BUFFER, scribble_probe, &count,
+        NULL);
+    gst_object_unref (pad);
+  }
+
+  sret = gst_element_set_state (pipeline, GST_STATE_PLAYING);
+  if (sret == GST_STATE_CHANGE_FAILURE) {
+    /* no display */
+    gst_element_set_state (pipeline, GST_STATE_NULL);
+    gst_object_unref (src);
+    gst_object_unref (sink);
+    gst_object_unref (pipeline);
+    return FALSE;
+  }
+
+  bus = gst_element_get_bus (pipeline);
+  msg = gst_bus_timed_pop_filtered (bus, 10 * GST_SECOND,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  fail_unless (msg != NULL, "timeout");
+  fail_unless_equals_int (GST_MESSAGE_TYPE (msg), GST_MESSAGE_EOS);
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+
+  pad = gst_element_get_static_pad (src, "src");
+  caps = gst_pad_get_current_caps (pad);
+  s = gst_caps_get_structure (caps, 0);
+  fail_unless (gst_structure_get_int (s, "width", width));
+  fail_unless (gst_structure_get_int (s, "height", height));
+  gst_caps_unref (caps);
+  gst_object_unref (pad);
+
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (src);
+  gst_object_unref (sink);
+  gst_object_unref (pipeline);
+
+  fail_unless_equals_int (g_list_length (frames), NUM_FRAMES);
+
+  return TRUE;
+}
+
+static gboolean
+buffers_equal (GstBuffer * a, GstBuffer * b)
+{
+  GstMapInfo map_a, map_b;
+  gboolean equal;
+
+  gst_buffer_map (a, &map_a, GST_MAP_READ);
+  gst_buffer_map (b, &map_b, GST_MAP_READ);
+  equal = map_a.size == map_b.size
+      && memcmp (map_a.data, map_b.data, map_a.size) == 0;
+  gst_buffer_unmap (a, &map_a);
+  gst_buffer_unmap (b, &map_b);
+
+  return equal;
+}
+
+GST_START_TEST (test_damage_meta)
+{
+  GstVideoRegionOfInterestMeta *roi;
+  gint width, height;
+  GList *l;
+
+  if (!capture (TRUE, FALSE, &width, &height)) {
+    GST_INFO ("could not open display, skipping");
+    return;
+  }
+
+  /* the first frame is entirely new */
+  roi = gst_buffer_get_video_region_of_interest_meta_id (frames->data, 0);
+  fail_unless (roi != NULL);
+  fail_unless_equals_int (roi->x, 0);
+  fail_unless_equals_int (roi->y, 0);
+  fail_unless_equals_int (roi->w, width);
+  fail_unless_equals_int (roi->h, height);
+
+  for (l = frames->next; l; l = l->next) {
+    gpointer state = NULL;
+    gboolean damaged = FALSE;
+    GstMeta *meta;
+
+    while ((meta = gst_buffer_iterate_meta_filtered (l->data, &state,
+                GST_VIDEO_REGION_OF_INTEREST_META_API_TYPE))) {
+      roi = (GstVideoRegionOfInterestMeta *) meta;
+
+      fail_unless_equals_int (roi->roi_type, g_quark_from_string ("damage"));
+      fail_unless (roi->x + roi->w <= width);
+      fail_unless (roi->y + roi->h <= height);
+      damaged = TRUE;
+    }
+
+    /* nothing outside the damage may change */
+    if (!damaged)
+      fail_unless (buffers_equal (l->prev->data, l->data));
+  }
+
+  g_list_free_full (frames, (GDestroyNotify) gst_buffer_unref);
+  frames = NULL;
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_same_as_full_capture)
+{
+  GstBuffer *damage_frame;
+  gint width, height;
+
+  /* on an idle display, the recycled images must match a full capture */
+  if (!capture (TRUE, FALSE, &width, &height)) {
+    GST_INFO ("could not open display, skipping");
+    return;
+  }
+  damage_frame = gst_buffer_ref (g_list_last (frames)->data);
+  g_list_free_full (frames, (GDestroyNotify) gst_buffer_unref);
+  frames = NULL;
+
+  fail_unless (capture (FALSE, FALSE, &width, &height));
+  fail_unless (buffers_equal (damage_frame, g_list_last (frames)->data));
+
+  gst_buffer_unref (damage_frame);
+  g_list_free_full (frames, (GDestroyNotify) gst_buffer_unref);
+  frames = NULL;
+}
+
+GST_END_TEST;
+
+GST_START_TEST (test_modified_downstream)
+{
+  GstBuffer *damage_frame;
+  gint width, height;
+
+  /* frames modified downstream must not end up in the recycled images */
+  if (!capture (TRUE, TRUE, &width, &height)) {
+    GST_INFO ("could not open display, skipping");
+    return;
+  }
+  damage_frame = gst_buffer_ref (g_list_last (frames)->data);
+  g_list_free_full (frames, (GDestroyNotify) gst_buffer_unref);
+  frames = NULL;
+
+  fail_unless (capture (FALSE, FALSE, &width, &height));
+  fail_unless (buffers_equal (damage_frame, g_list_last (frames)->data));
+
+  gst_buffer_unref (damage_frame);
+  g_list_free_full (frames, (GDestroyNotify) gst_buffer_unref);
+  frames = NULL;
+}
+
+GST_END_TEST;
+
+static Suite *
+ximagesrc_suite (void)
+{
+  Suite *s = suite_create ("ximagesrc");
+  TCase *tc_chain = tcase_create ("general");
+
+  suite_add_tcase (s, tc_chain);
+  tcase_add_test (tc_chain, test_damage_meta);
+  tcase_add_test (tc_chain, test_same_as_full_capture);
+  tcase_add_test (tc_chain, test_modified_downstream);
+
+  return s;
+}
+
+GST_CHECK_MAIN (ximagesrc);
@@ -0,0 +1,179 @@
+/* GStreamer
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/* This small application compares the CPU usage and latency of the
+ * different convolution modes of audiofirfilter: time-domain convolution,
+ * overlap-save FFT convolution with a single block and partitioned FFT
+ * convolution with a few latency budgets.
+ *
+ * Usage: firfilter-benchmark [kernel-length [channels [seconds]]]
+ */
+
+/* FIXME 0.11: suppress warnings for deprecated API such as GValueArray
+ * with newer GLib versions (>= 2.31.0) */
+#define GLIB_DISABLE_DEPRECATION_WARNINGS
+
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+
+#include <gst/gst.h>
+#include <gst/audio/audio.h>
+
+#define RATE 48000
+#define SAMPLES_PER_BUFFER 1024
+
+typedef struct
+{
+  const gchar *name;
+  gboolean low_latency;
+  guint max_fft_latency;
+} Mode;
+
+static const Mode modes[] = {
+  {"time-domain", TRUE, 0},
+  {"overlap-save", FALSE, 0},
+  {"partitioned 4096", FALSE, 4096},
+  {"partitioned 1024", FALSE, 1024},
+  {"partitioned 256", FALSE, 256},
+};
+
+static GValueArray *
+create_kernel (guint kernel_length)
+{
+  GValueArray *va;
+  GValue v = { 0, };
+  guint i;
+
+  /* exponentially decaying noise, roughly what a room impulse
+   * response looks like */
+  va = g_value_array_new (kernel_length);
+  g_value_init (&v, G_TYPE_DOUBLE);
+  for (i = 0; i < kernel_length; i++) {
+    g_value_set_double (&v, g_random_double_range (-1.0, 1.0) *
+        exp (-5.0 * i / kernel_length));
+    g_value_array_append (va, &v);
+  }
+  g_value_unset (&v);
+
+  return va;
+}
+
+static void
+run_mode (const Mode * mode, GValueArray * kernel, gint channels,
+    gint seconds)
+{
+  GstElement *pipeline, *src, *filter, *sink;
+  GstCaps *caps;
+  GstBus *bus;
+  GstMessage *msg;
+  GstPad *pad;
+  GstQuery *query;
+  GstClockTime latency = GST_CLOCK_TIME_NONE;
+  clock_t start, end;
+
+  pipeline = gst_pipeline_new (NULL);
+
+  src = gst_element_factory_make ("audiotestsrc", NULL);
+  g_object_set (G_OBJECT (src), "wave", 5, "samplesperbuffer",
+      SAMPLES_PER_BUFFER, "num-buffers",
+      seconds * RATE / SAMPLES_PER_BUFFER, NULL);
+
+  filter = gst_element_factory_make ("audiofirfilter", NULL);
+  g_object_set (G_OBJECT (filter), "low-latency", mode->low_latency,
+      "max-fft-latency", mode->max_fft_latency, "kernel", kernel, NULL);
+
+  sink = gst_element_factory_make ("fakesink", NULL);
+  g_object_set (G_OBJECT (sink), "sync", FALSE, NULL);
+
+  gst_bin_add_many (GST_BIN (pipeline), src, filter, sink, NULL);
+
+  caps = gst_caps_new_simple ("audio/x-raw",
+      "format", G_TYPE_STRING, GST_AUDIO_NE (F64),
+      "rate", G_TYPE_INT, RATE, "channels", G_TYPE_INT, channels, NULL);
+  if (!gst_element_link_filtered (src, filter, caps)
+      || !gst_element_link (filter, sink))
+    g_error ("Failed to link elements");
+  gst_caps_unref (caps);
+
+  gst_element_set_state (pipeline, GST_STATE_PAUSED);
+  if (gst_element_get_state (pipeline, NULL, NULL,
+          GST_CLOCK_TIME_NONE) == GST_STATE_CHANGE_FAILURE)
+    g_error ("Failed to go into PAUSED state");
+
+  pad = gst_element_get_static_pad (filter, "src");
+  query = gst_query_new_latency ();
+  if (gst_pad_query (pad, query))
+    gst_query_parse_latency (query, NULL, &latency, NULL);
+  gst_query_unref (query);
+  gst_object_unref (pad);
+
+  start = clock ();
+  gst_element_set_state (pipeline, GST_STATE_PLAYING);
+
+  bus = gst_pipeline_get_bus (GST_PIPELINE (pipeline));
+  msg = gst_bus_timed_pop_filtered (bus, GST_CLOCK_TIME_NONE,
+      GST_MESSAGE_EOS | GST_MESSAGE_ERROR);
+  end = clock ();
+
+  if (GST_MESSAGE_TYPE (msg) == GST_MESSAGE_ERROR)
+    g_error ("Got ERROR");
+
+  g_print ("%-18s CPU %8.3f s (%6.2f%% realtime)   latency %8.2f ms\n",
+      mode->name, (gdouble) (end - start) / CLOCKS_PER_SEC,
+      100.0 * (end - start) / CLOCKS_PER_SEC / seconds,
+      (gdouble) latency / GST_MSECOND);
+
+  gst_message_unref (msg);
+  gst_object_unref (bus);
+  gst_element_set_state (pipeline, GST_STATE_NULL);
+  gst_object_unref (pipeline);
+}
+
+gint
+main (gint argc, gchar * argv[])
+{
+  GValueArray *kernel;
+  guint kernel_length = 8192;
+  gint channels = 2, seconds = 10;
+  guint i;
+
+  gst_init (&argc, &argv);
+
+  if (argc > 1)
+    kernel_length = atoi (argv[1]);
+  if (argc > 2)
+    channels = atoi (argv[2]);
+  if (argc > 3)
+    seconds = atoi (argv[3]);
+
+  if (kernel_length < 1 || channels < 1 || seconds < 1) {
+    g_printerr ("Usage: %s [kernel-length [channels [seconds]]]\n", argv[0]);
+    return -1;
+  }
+
+  g_print ("Kernel length %u, %d channels, %d s at %d Hz\n", kernel_length,
+      channels, seconds, RATE);
+
+  kernel = create_kernel (kernel_length);
+  for (i = 0; i < G_N_ELEMENTS (modes); i++)
+    run_mode (&modes[i], kernel, channels, seconds);
+  g_value_array_free (kernel);
+
+  return 0;
+}